@@ -0,0 +1,246 @@
+//------------------------------------------------------------------------------
+// <copyright file="AudioBlockQueueTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "AudioBlockQueue.h"
+#include "AudioEnergy.h"
+#include "TestHelpers.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+using namespace Concurrency;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // 100 ns ticks of the performance counter
+                static INT64 GetTime()
+                {
+                    LARGE_INTEGER frequency, counter;
+                    QueryPerformanceFrequency(&frequency);
+                    QueryPerformanceCounter(&counter);
+
+                    return static_cast<INT64>(static_cast<double>(counter.QuadPart) * 1e7 / static_cast<double>(frequency.QuadPart));
+                }
+
+                // emits float audio, a tone over noise, at speed times its sample rate, or for speed 0 as fast
+                // as it is read. like the sensor's stream a read waits until there is audio for all of it
+                class SyntheticAudioStream
+                {
+                public:
+                    SyntheticAudioStream()
+                    {
+                        Reset(16000, 1.0f);
+                    }
+
+                    void Reset(UINT sampleRate, float speed)
+                    {
+                        _sampleRate = sampleRate;
+                        _speed = speed;
+                        _dueTime = GetTime() * 1e-7;
+                        _samplesRead = 0;
+                        _random = 1;
+                    }
+
+                    UINT Read(_Out_writes_(sampleCount) float* pSamples, UINT sampleCount)
+                    {
+                        // a 440 Hz tone over white noise, well inside full scale
+                        const double cyclesPerSample = 440.0 / _sampleRate;
+                        for (UINT i = 0; i < sampleCount; ++i)
+                        {
+                            double cycles = (_samplesRead + i) * cyclesPerSample;
+                            _random = _random * 1664525 + 1013904223;
+                            float noise = static_cast<float>(_random >> 8) / 16777216.0f - 0.5f;
+
+                            pSamples[i] = 0.1f * sinf(static_cast<float>((cycles - floor(cycles)) * XM_2PI)) + 0.02f * noise;
+                        }
+
+                        _samplesRead += sampleCount;
+
+                        if (_speed > 0.0f)
+                        {
+                            // the last sample of the read is due this long after the last one of the read before
+                            _dueTime += sampleCount / (_sampleRate * static_cast<double>(_speed));
+
+                            double wait = _dueTime - GetTime() * 1e-7;
+                            if (wait > 0.0)
+                            {
+                                std::this_thread::sleep_for(std::chrono::microseconds(static_cast<INT64>(wait * 1e6)));
+                            }
+                        }
+
+                        return sampleCount;
+                    }
+
+                    UINT64 GetSamplesRead() const { return _samplesRead; }
+
+                private:
+                    UINT        _sampleRate;
+                    float       _speed;
+                    double      _dueTime;       // seconds on the performance counter the next sample is due
+                    UINT64      _samplesRead;
+                    UINT        _random;
+                };
+
+                // reads seconds of synthetic audio at speed through the queue into a DSP stage that spends
+                // processingTime milliseconds on every block, and returns the queue's statistics
+                static void MeasureAudioPipeline(
+                    UINT blockCount,
+                    UINT blockLength,
+                    float speed,
+                    float seconds,
+                    float processingTime,
+                    _Out_ AudioPipelineStatistics* pStatistics)
+                {
+                    ZeroMemory(pStatistics, sizeof(*pStatistics));
+
+                    const UINT sampleRate = 16000;
+                    const UINT64 sampleCount = static_cast<UINT64>(seconds * sampleRate);
+
+                    AudioBlockQueue queue;
+                    queue.Reset(blockCount, blockLength, sampleRate);
+                    std::vector<float> pool(blockCount * blockLength);
+
+                    SyntheticAudioStream stream;
+                    stream.Reset(sampleRate, speed);
+
+                    std::atomic<bool> reading(true);
+                    event resume;
+
+                    // each pass stands for a read and its completion, which issues the next read straight away
+                    std::thread reader([&]()
+                    {
+                        while (stream.GetSamplesRead() < sampleCount)
+                        {
+                            UINT index;
+                            if (!queue.Acquire(GetTime(), &index))
+                            {
+                                // the DSP stage issues the read once it frees a block
+                                resume.wait();
+                                resume.reset();
+                                continue;
+                            }
+
+                            UINT read = stream.Read(&pool[index * blockLength], blockLength);
+                            queue.Complete(index, read, GetTime());
+                        }
+
+                        reading = false;
+                    });
+
+                    AudioEnergyMeter meter;
+                    meter.Reset(15, -90.0f);
+                    std::vector<float> energy(blockLength / 15 + 1);
+
+                    for (;;)
+                    {
+                        // read before waiting, so every block completed before the reader finished is still taken
+                        bool done = !reading;
+
+                        AudioBlock block;
+                        if (!queue.Wait(10, &block))
+                        {
+                            if (done)
+                            {
+                                break;
+                            }
+
+                            continue;
+                        }
+
+                        meter.Process(&pool[block.Index * blockLength], block.SampleCount, energy.data(), static_cast<UINT>(energy.size()), 0);
+                        if (processingTime > 0.0f)
+                        {
+                            std::this_thread::sleep_for(std::chrono::microseconds(static_cast<INT64>(processingTime * 1000.0f)));
+                        }
+
+                        if (queue.Release(block, GetTime()))
+                        {
+                            resume.set();
+                        }
+                    }
+
+                    reader.join();
+
+                    queue.GetStatistics(pStatistics);
+                }
+
+                TEST_CLASS(AudioBlockQueueTests)
+                {
+                public:
+                    TEST_METHOD(BlocksComeOutInReadOrder)
+                    {
+                        AudioBlockQueue queue;
+                        queue.Reset(3, 256, 16000);
+
+                        // fill every block, then the reader is starved
+                        UINT indices[3];
+                        for (UINT i = 0; i < 3; ++i)
+                        {
+                            Assert::IsTrue(!!queue.Acquire(i * 160000, &indices[i]), L"a free block");
+                            queue.Complete(indices[i], 256, i * 160000 + 160000);
+                        }
+
+                        UINT index;
+                        Assert::IsFalse(!!queue.Acquire(480000, &index), L"no free block");
+                        Assert::IsFalse(!!queue.HasFreeBlock(), L"none free");
+
+                        AudioBlock block;
+                        Assert::IsTrue(!!queue.Wait(0, &block), L"a completed block");
+                        Assert::AreEqual(indices[0], block.Index, L"oldest block first");
+                        Assert::AreEqual(static_cast<UINT64>(0), block.Sequence, L"first read");
+
+                        // the release that ends the starvation tells its caller to issue the read
+                        Assert::IsTrue(!!queue.Release(block, 500000), L"release restarts the reader");
+                        Assert::IsTrue(!!queue.HasFreeBlock(), L"the released block is free");
+
+                        Assert::IsTrue(!!queue.Wait(0, &block), L"a completed block");
+                        Assert::AreEqual(indices[1], block.Index, L"second block next");
+                        Assert::IsFalse(!!queue.Release(block, 510000), L"reader was not starved");
+
+                        AudioPipelineStatistics statistics;
+                        queue.GetStatistics(&statistics);
+                        Assert::AreEqual(2u, statistics.Blocks, L"blocks handed over");
+                        Assert::AreEqual(1u, statistics.Stalls, L"one stalled read");
+                    }
+
+                    TEST_METHOD(MeasureRealTime)
+                    {
+                        // 16 ms blocks with 1 ms of DSP on each keep up with the stream
+                        AudioPipelineStatistics statistics;
+                        MeasureAudioPipeline(3, 256, 1.0f, 3.0f, 1.0f, &statistics);
+
+                        LogMessage("%u blocks: read %.2f ms, latency %.2f ms mean %.2f ms max, idle %.2f ms max, %u stalls, %u gaps",
+                            statistics.Blocks, statistics.MeanReadTime, statistics.MeanLatency, statistics.MaxLatency,
+                            statistics.MaxIdleTime, statistics.Stalls, statistics.Gaps);
+
+                        Assert::AreEqual(static_cast<UINT64>(48128), statistics.Samples, L"every sample read is processed");
+                        Assert::AreEqual(0u, statistics.Stalls, L"no stalls");
+                        Assert::AreEqual(0u, statistics.Gaps, L"no gaps");
+                    }
+
+                    TEST_METHOD(MeasureSlowDsp)
+                    {
+                        // 20 ms of DSP on every 16 ms block falls behind
+                        AudioPipelineStatistics statistics;
+                        MeasureAudioPipeline(3, 256, 1.0f, 2.0f, 20.0f, &statistics);
+
+                        LogMessage("%u blocks: %u stalls, %u gaps, %.1f ms behind", statistics.Blocks, statistics.Stalls, statistics.Gaps, statistics.MaxDeficit);
+
+                        Assert::IsTrue(statistics.Stalls > 0, L"reads stall");
+                        Assert::IsTrue(statistics.Gaps > 0, L"gaps reported");
+                    }
+                };
+
+            }
+        }
+    }
+}
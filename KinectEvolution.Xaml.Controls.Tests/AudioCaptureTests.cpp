@@ -0,0 +1,260 @@
+//------------------------------------------------------------------------------
+// <copyright file="AudioCaptureTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "AudioCapture.h"
+#include "TestHelpers.h"
+
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // keeps the bytes in memory, in a buffer the test can read once the writer has stopped; while the
+                // test holds it stalled every flush waits, like a disk that has stopped answering
+                class MemoryCaptureFile : public CaptureFile
+                {
+                public:
+                    MemoryCaptureFile(_In_opt_ const std::atomic<bool>* pStalled, _In_opt_ std::vector<BYTE>* pBytes)
+                        : _pStalled(pStalled)
+                        , _pBytes(pBytes ? pBytes : &_bytes)
+                    {
+                    }
+
+                    virtual bool Open(const std::wstring&) override { _pBytes->clear(); return true; }
+
+                    virtual bool Write(_In_reads_bytes_(size) const void* pData, UINT size) override
+                    {
+                        const BYTE* pBytes = static_cast<const BYTE*>(pData);
+                        _pBytes->insert(_pBytes->end(), pBytes, pBytes + size);
+                        return true;
+                    }
+
+                    virtual bool WriteAt(UINT64 offset, _In_reads_bytes_(size) const void* pData, UINT size) override
+                    {
+                        if (offset + size > _pBytes->size())
+                        {
+                            return false;
+                        }
+
+                        memcpy(&(*_pBytes)[static_cast<size_t>(offset)], pData, size);
+                        return true;
+                    }
+
+                    virtual bool Flush() override
+                    {
+                        while (_pStalled && _pStalled->load())
+                        {
+                            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                        }
+                        return true;
+                    }
+
+                    virtual void Close() override {}
+
+                private:
+                    const std::atomic<bool>*    _pStalled;
+                    std::vector<BYTE>           _bytes;
+                    std::vector<BYTE>*          _pBytes;
+                };
+
+                // 10 msec of 16 kHz audio pushed every 10 msec, as the audio thread reads it
+                static const UINT STALL_SAMPLE_RATE = 16000;
+                static const UINT STALL_PUSH_FRAMES = 160;
+                static const UINT STALL_PUSH_MILLISECONDS = 10;
+
+                // a power of two, so the ring holds exactly this many frames
+                static const UINT STALL_RING_FRAMES = 4096;
+
+                struct AudioCaptureStallMeasurement
+                {
+                    UINT    Pushes;
+                    float   MeanPushTime;           // microseconds in Push
+                    float   MaxPushTime;
+                    float   MaxLateness;            // microseconds a push started after it was due
+                    AudioCaptureStatistics Capture;
+                };
+
+                static AudioCaptureSettings GetCaptureSettings(UINT sampleRate)
+                {
+                    AudioCaptureSettings settings;
+                    settings.BaseName = L"capture";
+                    settings.Format = WaveSampleFormat::Pcm16;
+                    settings.ChannelCount = 1;
+                    settings.SampleRate = sampleRate;
+                    settings.RingFrames = sampleRate;
+                    settings.MaxFileBytes = 0;
+                    settings.MaxFileSeconds = 60;
+                    settings.FlushBytes = 64 * 1024;
+                    return settings;
+                }
+
+                // pushes at the pace of the audio thread, each one due by the performance counter, into files held
+                // in memory. with the disk stalled, every flush waits until the last push is done.
+                static void MeasureAudioCaptureStall(bool stalled, UINT pushes, _Out_ AudioCaptureStallMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    std::vector<float> samples(STALL_PUSH_FRAMES);
+                    for (UINT i = 0; i < STALL_PUSH_FRAMES; ++i)
+                    {
+                        samples[i] = 0.25f * sinf(i * 0.2f);
+                    }
+
+                    AudioCaptureSettings settings = GetCaptureSettings(STALL_SAMPLE_RATE);
+                    settings.RingFrames = STALL_RING_FRAMES;
+
+                    // flushing after every write, the first flush comes before the writer has let go of any of the
+                    // ring, so a stalled disk leaves exactly the ring's worth of frames kept
+                    settings.FlushBytes = 0;
+
+                    std::atomic<bool> stalling(stalled);
+                    AudioCaptureWriter writer;
+                    Assert::IsTrue(writer.Start(settings, [&stalling]() { return std::unique_ptr<CaptureFile>(new MemoryCaptureFile(&stalling, nullptr)); }), L"writer starts");
+
+                    LARGE_INTEGER frequency, first;
+                    QueryPerformanceFrequency(&frequency);
+                    QueryPerformanceCounter(&first);
+
+                    double pushTime = 0.0;
+                    double maxPushTime = 0.0;
+                    double maxLateness = 0.0;
+
+                    for (UINT push = 0; push < pushes; ++push)
+                    {
+                        LARGE_INTEGER due;
+                        due.QuadPart = first.QuadPart + push * frequency.QuadPart * STALL_PUSH_MILLISECONDS / 1000;
+
+                        // asleep until the last couple of msec, then yielding
+                        LARGE_INTEGER start;
+                        for (;;)
+                        {
+                            QueryPerformanceCounter(&start);
+                            if (start.QuadPart >= due.QuadPart)
+                            {
+                                break;
+                            }
+
+                            if (GetMicroseconds(start, due) > 2000.0)
+                            {
+                                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                            }
+                            else
+                            {
+                                std::this_thread::yield();
+                            }
+                        }
+
+                        writer.Push(samples.data(), STALL_PUSH_FRAMES, static_cast<INT64>(push) * STALL_PUSH_MILLISECONDS * 10000);
+
+                        LARGE_INTEGER end;
+                        QueryPerformanceCounter(&end);
+
+                        double time = GetMicroseconds(start, end);
+                        pushTime += time;
+                        maxPushTime = max(maxPushTime, time);
+                        maxLateness = max(maxLateness, GetMicroseconds(due, start));
+                    }
+
+                    stalling.store(false);
+                    writer.Stop();
+
+                    pMeasurement->Pushes = pushes;
+                    pMeasurement->MeanPushTime = static_cast<float>(pushTime / pushes);
+                    pMeasurement->MaxPushTime = static_cast<float>(maxPushTime);
+                    pMeasurement->MaxLateness = static_cast<float>(maxLateness);
+                    writer.GetStatistics(&pMeasurement->Capture);
+                }
+
+                static void LogStallMeasurement(_In_ const char* name, const AudioCaptureStallMeasurement& measurement)
+                {
+                    LogMessage("%s: %u pushes, push %.1f us mean %.1f us max, at most %.0f us late; %llu pushed, %llu written, %llu dropped, ring at most %u, %u flushes",
+                        name, measurement.Pushes, measurement.MeanPushTime, measurement.MaxPushTime, measurement.MaxLateness,
+                        measurement.Capture.Pushed, measurement.Capture.Written, measurement.Capture.Dropped, measurement.Capture.MaxFill, measurement.Capture.Flushes);
+                }
+
+                TEST_CLASS(AudioCaptureTests)
+                {
+                public:
+                    TEST_METHOD(CaptureReadsBackAsWave)
+                    {
+                        const UINT sampleRate = 16000;
+
+                        std::vector<float> samples(sampleRate);
+                        for (UINT i = 0; i < sampleRate; ++i)
+                        {
+                            samples[i] = 0.5f * sinf(i * 0.05f);
+                        }
+
+                        std::vector<BYTE> bytes;
+                        AudioCaptureWriter writer;
+                        Assert::IsTrue(writer.Start(GetCaptureSettings(sampleRate), [&bytes]() { return std::unique_ptr<CaptureFile>(new MemoryCaptureFile(nullptr, &bytes)); }), L"writer starts");
+
+                        for (UINT first = 0; first < sampleRate; first += 160)
+                        {
+                            writer.Push(&samples[first], 160, first * 625);
+                        }
+                        writer.Stop();
+
+                        AudioCaptureStatistics statistics;
+                        writer.GetStatistics(&statistics);
+                        Assert::AreEqual(static_cast<UINT64>(sampleRate), statistics.Written, L"every frame written");
+                        Assert::AreEqual(static_cast<UINT64>(0), statistics.Dropped, L"nothing dropped");
+
+                        WaveFile recording;
+                        Assert::IsTrue(recording.Load(bytes.data(), bytes.size()), L"the file loads");
+                        Assert::AreEqual(sampleRate, recording.GetFrameCount(), L"frames in the file");
+
+                        float maxError = 0.0f;
+                        for (UINT i = 0; i < sampleRate; ++i)
+                        {
+                            maxError = max(maxError, fabsf(recording.GetChannel(0)[i] - samples[i]));
+                        }
+                        Assert::IsTrue(maxError < 1.0f / 16384.0f, L"samples within PCM16 rounding");
+                    }
+
+                    TEST_METHOD(MeasureStalledFlush)
+                    {
+                        // 2 seconds of pushes, the ring holds a quarter of a second
+                        const UINT pushes = 200;
+                        const UINT64 pushed = static_cast<UINT64>(pushes) * STALL_PUSH_FRAMES;
+
+                        AudioCaptureStallMeasurement flowing;
+                        MeasureAudioCaptureStall(false, pushes, &flowing);
+                        LogStallMeasurement("disk answering", flowing);
+
+                        Assert::AreEqual(pushed, flowing.Capture.Pushed, L"every read pushed");
+                        Assert::AreEqual(pushed, flowing.Capture.Written, L"every frame written");
+                        Assert::AreEqual(static_cast<UINT64>(0), flowing.Capture.Dropped, L"nothing dropped");
+
+                        AudioCaptureStallMeasurement stalled;
+                        MeasureAudioCaptureStall(true, pushes, &stalled);
+                        LogStallMeasurement("disk stalled", stalled);
+
+                        // the ring fills and then everything else is dropped, the kept frames written once the disk answers
+                        Assert::AreEqual(pushed, stalled.Capture.Pushed, L"every read pushed");
+                        Assert::AreEqual(static_cast<UINT64>(STALL_RING_FRAMES), stalled.Capture.Written, L"the ring's worth written");
+                        Assert::AreEqual(pushed - STALL_RING_FRAMES, stalled.Capture.Dropped, L"the rest dropped");
+                        Assert::AreEqual(STALL_RING_FRAMES, stalled.Capture.MaxFill, L"the ring filled");
+                        Assert::AreEqual(static_cast<UINT64>(0), stalled.Capture.MarksDropped, L"a mark for every push kept");
+
+#ifdef NDEBUG
+                        // a push is a copy into the ring whatever the disk does
+                        Assert::IsTrue(flowing.MeanPushTime < 20.0f && stalled.MeanPushTime < 20.0f, L"pushes within 20 us on average");
+                        Assert::IsTrue(flowing.MaxPushTime < 500.0f && stalled.MaxPushTime < 500.0f, L"every push within 500 us");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------
+// <copyright file="AudioEnergyTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "AudioEnergy.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                struct AudioEnergyMeasurement
+                {
+                    UINT    Samples;            // per pass
+                    UINT    Energies;           // written per pass
+                    float   MeanTime;           // microseconds per pass
+                    float   MeanReferenceTime;  // microseconds per pass of the scalar loop with log10
+                    float   MaxError;           // largest difference to the scalar loop, in normalized units
+                };
+
+                // runs both paths over the same samples, the fast one repeats times
+                static void MeasureAudioEnergy(
+                    _In_reads_(sampleCount) const float* pSamples,
+                    UINT sampleCount,
+                    UINT samplesPerEnergy,
+                    float minEnergy,
+                    UINT repeats,
+                    _Out_ AudioEnergyMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    AudioEnergyMeter referenceMeter;
+                    AudioEnergyMeter meter;
+                    meter.Reset(samplesPerEnergy, minEnergy);
+
+                    UINT ringLength = meter.GetEnergyCount(sampleCount) + 1;
+                    std::vector<float> reference(ringLength);
+                    std::vector<float> energies(ringLength);
+
+                    double referenceTime = 0.0;
+                    double time = 0.0;
+                    UINT written = 0;
+
+                    for (UINT pass = 0; pass < repeats; ++pass)
+                    {
+                        LARGE_INTEGER start, middle, end;
+
+                        referenceMeter.Reset(samplesPerEnergy, minEnergy);
+                        meter.Reset(samplesPerEnergy, minEnergy);
+
+                        QueryPerformanceCounter(&start);
+                        referenceMeter.ProcessReference(pSamples, sampleCount, reference.data(), ringLength, 0);
+                        QueryPerformanceCounter(&middle);
+                        written = meter.Process(pSamples, sampleCount, energies.data(), ringLength, 0);
+                        QueryPerformanceCounter(&end);
+
+                        referenceTime += GetMicroseconds(start, middle);
+                        time += GetMicroseconds(middle, end);
+                    }
+
+                    float maxError = 0.0f;
+                    for (UINT i = 0; i < written; ++i)
+                    {
+                        maxError = max(maxError, fabsf(energies[i] - reference[i]));
+                    }
+
+                    pMeasurement->Samples = sampleCount;
+                    pMeasurement->Energies = written;
+                    pMeasurement->MeanTime = static_cast<float>(time / repeats);
+                    pMeasurement->MeanReferenceTime = static_cast<float>(referenceTime / repeats);
+                    pMeasurement->MaxError = maxError;
+                }
+
+                // noise swelling slowly, with near silent stretches to reach the bottom of the scale
+                static void MakeEnergyTestSignal(_Out_ std::vector<float>& samples)
+                {
+                    std::mt19937 random(3);
+                    std::normal_distribution<float> noise(0.0f, 1.0f);
+
+                    samples.resize(16000 * 10);
+                    for (size_t i = 0; i < samples.size(); ++i)
+                    {
+                        float swell = 0.5f + 0.5f * sinf(i * 0.0005f);
+                        float quiet = (0 == (i / 4000) % 3) ? 1e-4f : 1.0f;
+                        samples[i] = 0.1f * noise(random) * swell * quiet;
+                    }
+                }
+
+                TEST_CLASS(AudioEnergyTests)
+                {
+                public:
+                    TEST_METHOD(DecibelsMatchLog10)
+                    {
+                        float maxError = 0.0f;
+                        for (double x = 1e-12; x < 10.0; x *= 1.0007)
+                        {
+                            float decibels = XMVectorGetX(XMVectorDecibels(XMVectorReplicate(static_cast<float>(x))));
+                            maxError = max(maxError, fabsf(decibels - 10.0f * log10f(static_cast<float>(x))));
+                        }
+
+                        LogMessage("XMVectorDecibels max error %.2e dB", maxError);
+                        Assert::IsTrue(maxError < 5e-5f, L"10 log10 within 5e-5 dB");
+                    }
+
+                    TEST_METHOD(ProcessMatchesReferenceAcrossReads)
+                    {
+                        std::vector<float> samples;
+                        MakeEnergyTestSignal(samples);
+
+                        const UINT groupLengths[] = { 1, 3, 4, 7, 15, 16, 300 };
+                        for (UINT samplesPerEnergy : groupLengths)
+                        {
+                            AudioEnergyMeter meter, referenceMeter;
+                            meter.Reset(samplesPerEnergy, -90.0f);
+                            referenceMeter.Reset(samplesPerEnergy, -90.0f);
+
+                            const UINT ringLength = 1000;
+                            std::vector<float> ring(ringLength), referenceRing(ringLength);
+                            UINT index = 0, referenceIndex = 0;
+
+                            // reads of any length, so groups are cut off at every possible place
+                            std::mt19937 random(samplesPerEnergy);
+                            float maxError = 0.0f;
+                            for (size_t position = 0; position < samples.size(); )
+                            {
+                                UINT count = static_cast<UINT>((std::min)(static_cast<size_t>(random() % 900), samples.size() - position));
+
+                                UINT written = meter.Process(&samples[position], count, ring.data(), ringLength, index);
+                                UINT referenceWritten = referenceMeter.ProcessReference(&samples[position], count, referenceRing.data(), ringLength, referenceIndex);
+                                Assert::AreEqual(referenceWritten, written, L"energies per read");
+
+                                for (UINT k = 0; k < written; ++k)
+                                {
+                                    maxError = max(maxError, fabsf(ring[(index + k) % ringLength] - referenceRing[(referenceIndex + k) % ringLength]));
+                                }
+
+                                index = (index + written) % ringLength;
+                                referenceIndex = (referenceIndex + referenceWritten) % ringLength;
+                                position += count;
+                            }
+
+                            Assert::IsTrue(maxError < 1e-5f, L"normalized energies agree with the scalar loop");
+                        }
+                    }
+
+                    TEST_METHOD(MeasureOneRead)
+                    {
+                        std::vector<float> samples;
+                        MakeEnergyTestSignal(samples);
+
+                        // one 50 ms read at 16 kHz
+                        AudioEnergyMeasurement measurement;
+                        MeasureAudioEnergy(samples.data(), 800, 15, -90.0f, 2000, &measurement);
+
+                        LogMessage("%u samples, %u energies: %.2f us against %.2f us for the scalar loop, max error %.2e",
+                            measurement.Samples, measurement.Energies, measurement.MeanTime, measurement.MeanReferenceTime, measurement.MaxError);
+
+                        Assert::AreEqual(53u, measurement.Energies, L"one energy per 15 samples");
+                        Assert::IsTrue(measurement.MaxError < 1e-5f, L"agrees with the scalar loop");
+#ifdef NDEBUG
+                        Assert::IsTrue(measurement.MeanTime < measurement.MeanReferenceTime, L"faster than the scalar loop");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
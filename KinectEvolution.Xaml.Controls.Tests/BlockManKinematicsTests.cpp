@@ -0,0 +1,212 @@
+//------------------------------------------------------------------------------
+// <copyright file="BlockManKinematicsTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BlockManKinematics.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::BlockMan;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // frames solved to time each path
+                static const UINT SOLVE_FRAMES = 2000;
+
+                // one body as the panel holds it
+                struct ReferenceBody
+                {
+                    XMVECTOR Orientations[JOINT_COUNT];
+                    XMMATRIX Model;
+                    XMVECTOR Translation;
+                    XMMATRIX BlockTransforms[BLOCK_COUNT];
+                };
+
+                // the per block chain BlockManPanel used before the batch: scale * rotation * translation for the
+                // block, then model * block * translation for the world
+                static void SolveReference(_Inout_ ReferenceBody& body, _Out_writes_(BLOCK_COUNT) XMMATRIX* pWorld)
+                {
+                    for (UINT blockIndex = 0; blockIndex < BLOCK_COUNT; ++blockIndex)
+                    {
+                        UINT jointIndex = static_cast<UINT>(g_SkeletonBlocks[blockIndex].SkeletonJoint);
+                        int parentIndex = g_SkeletonBlocks[blockIndex].ParentBlockIndex;
+
+                        XMMATRIX parentTransform = (parentIndex > -1) ? body.BlockTransforms[parentIndex] : XMMatrixIdentity();
+                        XMVECTOR position = XMVector3Transform(g_SkeletonBlocks[blockIndex].CenterFromParentCenter, parentTransform);
+
+                        XMVECTOR rotationQuat = XMVectorZero();
+                        if (XMVector4Equal(body.Orientations[jointIndex], XMVectorZero()))
+                        {
+                            if (parentIndex > -1)
+                            {
+                                rotationQuat = XMVector4Equal(body.Orientations[parentIndex], XMVectorZero()) ? XMQuaternionIdentity() : body.Orientations[parentIndex];
+                            }
+                        }
+                        else
+                        {
+                            rotationQuat = body.Orientations[jointIndex];
+                        }
+
+                        XMMATRIX translation = XMMatrixTranslationFromVector(position);
+                        XMMATRIX scale = XMMatrixScalingFromVector(g_SkeletonBlocks[blockIndex].Scale);
+                        XMMATRIX rotation = XMMatrixRotationQuaternion(rotationQuat);
+
+                        body.BlockTransforms[blockIndex] = scale * rotation * translation;
+                        pWorld[blockIndex] = body.Model * body.BlockTransforms[blockIndex] * XMMatrixTranslationFromVector(body.Translation);
+                    }
+                }
+
+                // every joint of every body bent its own way; every seventh joint has no orientation, as the sensor
+                // reports for the leaf joints, so the fallback to the parent's is taken
+                static void PoseBodies(float seconds, _Out_writes_(BODY_COUNT) ReferenceBody* pBodies)
+                {
+                    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                    {
+                        ReferenceBody& body = pBodies[bodyIndex];
+                        for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+                        {
+                            float phase = seconds * (1.0f + 0.1f * bodyIndex) + 0.3f * jointIndex;
+                            body.Orientations[jointIndex] = (0 == (jointIndex + bodyIndex) % 7)
+                                ? XMVectorZero()
+                                : XMQuaternionRotationRollPitchYaw(1.2f * sinf(phase), 0.8f * cosf(phase), 0.5f * sinf(2.0f * phase));
+                        }
+
+                        // the panel's model turns and scales each body and moves it out in front of the camera
+                        body.Model = XMMatrixScaling(0.1f, 0.1f, 0.1f) * XMMatrixRotationY(0.2f * bodyIndex + seconds) * XMMatrixTranslation(0.0f, 0.0f, 0.5f);
+                        body.Translation = XMVectorSet(bodyIndex - 2.5f, 0.3f * sinf(seconds), 2.5f, 0.0f);
+                    }
+                }
+
+                static void SetBodies(_In_reads_(BODY_COUNT) const ReferenceBody* pBodies, _Inout_ BlockManKinematics& kinematics)
+                {
+                    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                    {
+                        kinematics.SetJointOrientations(bodyIndex, pBodies[bodyIndex].Orientations);
+                        kinematics.SetBodyTransform(bodyIndex, pBodies[bodyIndex].Model, pBodies[bodyIndex].Translation);
+                    }
+                }
+
+                static void AssertMatricesNear(CXMMATRIX expected, CXMMATRIX actual, float tolerance, _In_z_ const wchar_t* message)
+                {
+                    XMFLOAT4X4 e;
+                    XMFLOAT4X4 a;
+                    XMStoreFloat4x4(&e, expected);
+                    XMStoreFloat4x4(&a, actual);
+
+                    for (UINT row = 0; row < 4; ++row)
+                    {
+                        for (UINT column = 0; column < 4; ++column)
+                        {
+                            Assert::AreEqual(e.m[row][column], a.m[row][column], tolerance, message);
+                        }
+                    }
+                }
+
+                TEST_CLASS(BlockManKinematicsTests)
+                {
+                public:
+                    TEST_METHOD(MatchesThePerBlockChain)
+                    {
+                        ReferenceBody bodies[BODY_COUNT];
+                        BlockManKinematics kinematics;
+
+                        for (UINT frame = 0; frame < 30; ++frame)
+                        {
+                            PoseBodies(frame / 30.0f, bodies);
+                            SetBodies(bodies, kinematics);
+                            kinematics.Solve();
+
+                            for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                            {
+                                XMMATRIX world[BLOCK_COUNT];
+                                SolveReference(bodies[bodyIndex], world);
+
+                                for (UINT blockIndex = 0; blockIndex < BLOCK_COUNT; ++blockIndex)
+                                {
+                                    AssertMatricesNear(bodies[bodyIndex].BlockTransforms[blockIndex], kinematics.GetBlockTransform(bodyIndex, blockIndex), 1e-5f, L"block");
+                                    AssertMatricesNear(world[blockIndex], kinematics.GetWorldTransform(bodyIndex, blockIndex), 1e-5f, L"world");
+                                }
+                            }
+                        }
+                    }
+
+                    TEST_METHOD(ZeroOrientationsGiveTheRestPose)
+                    {
+                        ReferenceBody body;
+                        ZeroMemory(body.Orientations, sizeof(body.Orientations));
+                        body.Model = XMMatrixIdentity();
+                        body.Translation = XMVectorZero();
+
+                        BlockManKinematics kinematics;
+                        kinematics.SetJointOrientations(0, body.Orientations);
+                        kinematics.Solve();
+
+                        XMMATRIX world[BLOCK_COUNT];
+                        SolveReference(body, world);
+
+                        for (UINT blockIndex = 0; blockIndex < BLOCK_COUNT; ++blockIndex)
+                        {
+                            AssertMatricesNear(world[blockIndex], kinematics.GetWorldTransform(0, blockIndex), 1e-6f, L"rest pose");
+                        }
+                    }
+
+                    TEST_METHOD(MeasureSixBodies)
+                    {
+                        ReferenceBody bodies[BODY_COUNT];
+                        BlockManKinematics kinematics;
+                        XMMATRIX world[BLOCK_COUNT];
+
+                        // what the world matrices add up to, so neither path is optimized away
+                        float sums[2] = {};
+                        double microseconds[2] = {};
+
+                        for (UINT frame = 0; frame < SOLVE_FRAMES; ++frame)
+                        {
+                            PoseBodies(frame / 30.0f, bodies);
+
+                            LARGE_INTEGER start;
+                            LARGE_INTEGER end;
+                            QueryPerformanceCounter(&start);
+                            for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                            {
+                                SolveReference(bodies[bodyIndex], world);
+                                sums[0] += XMVectorGetX(world[BLOCK_COUNT - 1].r[3]);
+                            }
+                            QueryPerformanceCounter(&end);
+                            microseconds[0] += GetMicroseconds(start, end);
+
+                            QueryPerformanceCounter(&start);
+                            SetBodies(bodies, kinematics);
+                            kinematics.Solve();
+                            for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                            {
+                                sums[1] += XMVectorGetX(kinematics.GetWorldTransform(bodyIndex, BLOCK_COUNT - 1).r[3]);
+                            }
+                            QueryPerformanceCounter(&end);
+                            microseconds[1] += GetMicroseconds(start, end);
+                        }
+
+                        microseconds[0] /= SOLVE_FRAMES;
+                        microseconds[1] /= SOLVE_FRAMES;
+
+                        LogMessage("%u blocks, 6 bodies: per block chain %.2f us, batch %.2f us a frame",
+                            BLOCK_COUNT, microseconds[0], microseconds[1]);
+
+                        Assert::AreEqual(sums[0], sums[1], 1e-2f, L"same transforms");
+
+#ifdef NDEBUG
+                        Assert::IsTrue(microseconds[1] < microseconds[0], L"batch faster than the per block chain");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,272 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyFrameStoreTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BodyFrameStore.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // frames with every column moving: random positions, orientations, some of them zero, tracking and
+                // hand states, bodies coming and going, and uneven gaps between the frames
+                static void MakeRandomFrames(UINT frameCount, UINT seed, _Out_ std::vector<BodyFrameData>& frames)
+                {
+                    std::mt19937 random(seed);
+                    std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+                    std::uniform_real_distribution<float> component(-1.0f, 1.0f);
+
+                    frames.resize(frameCount);
+
+                    INT64 time = 123456789;
+                    UINT64 trackingIds[BODY_COUNT] = {};
+
+                    for (UINT frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+                    {
+                        BodyFrameData& frame = frames[frameIndex];
+                        frame.Clear();
+
+                        time += 300000 + random() % 70000;
+                        frame.RelativeTime = time;
+                        frame.FloorClipPlane = XMFLOAT4(0.1f * component(random), 0.99f, 0.1f * component(random), 0.8f + 0.1f * component(random));
+
+                        for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                        {
+                            if (0 == random() % 50)
+                            {
+                                trackingIds[bodyIndex] = (0 == random() % 3) ? 0 : (static_cast<UINT64>(random()) << 32) | random();
+                            }
+
+                            if (0 == trackingIds[bodyIndex])
+                            {
+                                continue;
+                            }
+
+                            frame.IsTracked[bodyIndex] = TRUE;
+                            frame.TrackingId[bodyIndex] = trackingIds[bodyIndex];
+                            frame.HandLeftState[bodyIndex] = static_cast<WRK::HandState>(random() % 5);
+                            frame.HandRightState[bodyIndex] = static_cast<WRK::HandState>(random() % 5);
+
+                            for (UINT joint = 0; joint < JOINT_COUNT; ++joint)
+                            {
+                                UINT i = BodyJointIndex(bodyIndex, joint);
+                                frame.PositionX[i] = position(random);
+                                frame.PositionY[i] = position(random);
+                                frame.PositionZ[i] = position(random);
+                                frame.TrackingState[i] = static_cast<WRK::TrackingState>(random() % 3);
+
+                                if (0 == random() % 10)
+                                {
+                                    continue;
+                                }
+
+                                XMVECTOR rotation = XMQuaternionNormalize(XMVectorSet(component(random), component(random), component(random), component(random)));
+                                frame.OrientationX[i] = XMVectorGetX(rotation);
+                                frame.OrientationY[i] = XMVectorGetY(rotation);
+                                frame.OrientationZ[i] = XMVectorGetZ(rotation);
+                                frame.OrientationW[i] = XMVectorGetW(rotation);
+                            }
+                        }
+                    }
+                }
+
+                // asserts a decoded frame is the appended one to within the store's precision
+                static void AssertSameFrame(const BodyFrameData& expected, const BodyFrameData& actual)
+                {
+                    Assert::AreEqual(expected.RelativeTime, actual.RelativeTime, L"time");
+                    Assert::AreEqual(expected.FloorClipPlane.w, actual.FloorClipPlane.w, 1e-4f, L"floor");
+
+                    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                    {
+                        Assert::AreEqual(expected.IsTracked[bodyIndex], actual.IsTracked[bodyIndex], L"tracked");
+                        Assert::AreEqual(expected.TrackingId[bodyIndex], actual.TrackingId[bodyIndex], L"tracking id");
+                        Assert::IsTrue(expected.HandLeftState[bodyIndex] == actual.HandLeftState[bodyIndex], L"left hand");
+                        Assert::IsTrue(expected.HandRightState[bodyIndex] == actual.HandRightState[bodyIndex], L"right hand");
+                    }
+
+                    for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+                    {
+                        Assert::IsTrue(expected.TrackingState[i] == actual.TrackingState[i], L"tracking state");
+
+                        // positions to the millimeter, rounded
+                        Assert::AreEqual(expected.PositionX[i], actual.PositionX[i], 0.00051f, L"position x");
+                        Assert::AreEqual(expected.PositionY[i], actual.PositionY[i], 0.00051f, L"position y");
+                        Assert::AreEqual(expected.PositionZ[i], actual.PositionZ[i], 0.00051f, L"position z");
+
+                        XMVECTOR a = XMVectorSet(expected.OrientationX[i], expected.OrientationY[i], expected.OrientationZ[i], expected.OrientationW[i]);
+                        XMVECTOR b = XMVectorSet(actual.OrientationX[i], actual.OrientationY[i], actual.OrientationZ[i], actual.OrientationW[i]);
+                        if (XMVector4Equal(a, XMVectorZero()))
+                        {
+                            Assert::IsTrue(!!XMVector4Equal(b, XMVectorZero()), L"no orientation");
+                            continue;
+                        }
+
+                        // either sign is the same rotation
+                        Assert::IsTrue(fabsf(XMVectorGetX(XMVector4Dot(a, b))) > 0.99999f, L"orientation");
+                    }
+                }
+
+                TEST_CLASS(BodyFrameStoreTests)
+                {
+                public:
+                    TEST_METHOD(FramesReadBackAsAppended)
+                    {
+                        // a few sealed blocks and some pending frames
+                        std::vector<BodyFrameData> frames;
+                        MakeRandomFrames(3 * BODY_STORE_BLOCK_FRAMES + 77, 1, frames);
+
+                        BodyFrameStore store;
+                        for (const BodyFrameData& frame : frames)
+                        {
+                            Assert::IsTrue(store.Append(frame), L"frame appended");
+                        }
+
+                        Assert::AreEqual(static_cast<UINT>(frames.size()), store.GetFrameCount(), L"frame count");
+                        Assert::IsFalse(store.Append(frames[10]), L"an older frame is dropped");
+
+                        // reads that start and end inside blocks and cross into the pending frames
+                        std::vector<BodyFrameData> decoded(frames.size());
+                        store.GetFrames(0, store.GetFrameCount(), decoded.data());
+                        for (size_t i = 0; i < frames.size(); ++i)
+                        {
+                            AssertSameFrame(frames[i], decoded[i]);
+                        }
+
+                        store.GetFrames(250, 500, decoded.data());
+                        for (UINT i = 0; i < 500; ++i)
+                        {
+                            AssertSameFrame(frames[250 + i], decoded[i]);
+                            Assert::AreEqual(frames[250 + i].RelativeTime, store.GetFrameTime(250 + i), L"frame time");
+                        }
+
+                        XMFLOAT3 positions[100];
+                        store.GetJointPositions(700, 100, 3, 11, positions);
+                        for (UINT i = 0; i < 100; ++i)
+                        {
+                            Assert::AreEqual(frames[700 + i].PositionZ[BodyJointIndex(3, 11)], positions[i].z, 0.00051f, L"joint position");
+                        }
+                    }
+
+                    TEST_METHOD(FindsFramesByTimeAndTrackingId)
+                    {
+                        std::vector<BodyFrameData> frames;
+                        MakeRandomFrames(1000, 2, frames);
+
+                        BodyFrameStore store;
+                        for (const BodyFrameData& frame : frames)
+                        {
+                            store.Append(frame);
+                        }
+
+                        UINT firstFrame;
+                        UINT frameCount = store.FindFrames(frames[300].RelativeTime, frames[700].RelativeTime, &firstFrame);
+                        Assert::AreEqual(300u, firstFrame, L"first frame at the start time");
+                        Assert::AreEqual(400u, frameCount, L"frames before the end time");
+
+                        frameCount = store.FindFrames(frames[300].RelativeTime - 1, frames[300].RelativeTime + 1, &firstFrame);
+                        Assert::AreEqual(1u, frameCount, L"one frame around its time");
+
+                        // every frame a body slot carried the id, in runs
+                        UINT64 trackingId = 0;
+                        for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT && 0 == trackingId; ++bodyIndex)
+                        {
+                            trackingId = frames[500].TrackingId[bodyIndex];
+                        }
+                        Assert::AreNotEqual(static_cast<UINT64>(0), trackingId, L"a tracked body");
+
+                        std::vector<BodyFrameRange> ranges;
+                        store.FindTrackingId(trackingId, frames.front().RelativeTime, frames.back().RelativeTime + 1, ranges);
+
+                        UINT expected = 0;
+                        for (const BodyFrameData& frame : frames)
+                        {
+                            for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                            {
+                                expected += (frame.TrackingId[bodyIndex] == trackingId) ? 1 : 0;
+                            }
+                        }
+
+                        UINT found = 0;
+                        for (const BodyFrameRange& range : ranges)
+                        {
+                            for (UINT frame = range.FirstFrame; frame < range.FirstFrame + range.FrameCount; ++frame)
+                            {
+                                Assert::AreEqual(trackingId, frames[frame].TrackingId[range.BodyIndex], L"the id in the range");
+                            }
+                            found += range.FrameCount;
+                        }
+
+                        Assert::AreEqual(expected, found, L"every frame with the id");
+                    }
+
+                    TEST_METHOD(MaxFramesDropsTheOldestBlocks)
+                    {
+                        std::vector<BodyFrameData> frames;
+                        MakeRandomFrames(20 * BODY_STORE_BLOCK_FRAMES + 13, 3, frames);
+
+                        BodyFrameStore store;
+                        store.SetMaxFrames(1000);
+
+                        size_t largest = 0;
+                        for (size_t i = 0; i < frames.size(); ++i)
+                        {
+                            store.Append(frames[i]);
+
+                            UINT kept = store.GetFrameCount() - store.GetFirstFrame();
+                            Assert::IsTrue(kept >= min(1000u, store.GetFrameCount()), L"at least max frames kept");
+                            Assert::IsTrue(kept < 1000 + 2 * BODY_STORE_BLOCK_FRAMES, L"a sealed and a pending block over at most");
+
+                            if (i >= 10 * BODY_STORE_BLOCK_FRAMES)
+                            {
+                                largest = max(largest, store.GetStorageSize());
+                            }
+                        }
+
+                        // frames keep their index, the kept ones read back
+                        Assert::AreEqual(static_cast<UINT>(frames.size()), store.GetFrameCount(), L"frames keep counting");
+                        Assert::AreEqual(0u, store.GetFirstFrame() % BODY_STORE_BLOCK_FRAMES, L"whole blocks dropped");
+
+                        UINT first = store.GetFirstFrame();
+                        UINT kept = store.GetFrameCount() - first;
+                        std::vector<BodyFrameData> decoded(kept);
+                        store.GetFrames(first, kept, decoded.data());
+                        for (UINT i = 0; i < kept; ++i)
+                        {
+                            AssertSameFrame(frames[first + i], decoded[i]);
+                        }
+
+                        // a time before the kept frames finds the first kept one
+                        UINT firstFrame;
+                        UINT frameCount = store.FindFrames(frames[0].RelativeTime, frames[first + 10].RelativeTime, &firstFrame);
+                        Assert::AreEqual(first, firstFrame, L"first kept frame");
+                        Assert::AreEqual(10u, frameCount, L"kept frames in the window");
+
+                        // the memory stays that of a few thousand frames
+                        BodyFrameStore unbounded;
+                        for (UINT i = 0; i < 2000; ++i)
+                        {
+                            unbounded.Append(frames[i]);
+                        }
+
+                        LogMessage("%u frames kept of %u, %.1f kB at most, %.1f kB for 2000 frames unbounded",
+                            kept, store.GetFrameCount(), largest / 1024.0, unbounded.GetStorageSize() / 1024.0);
+                        Assert::IsTrue(largest < 2 * unbounded.GetStorageSize(), L"storage bounded");
+
+                        // lowering the limit drops at once
+                        store.SetMaxFrames(300);
+                        Assert::IsTrue(store.GetFrameCount() - store.GetFirstFrame() < 300 + 2 * BODY_STORE_BLOCK_FRAMES, L"dropped to the new limit");
+                    }
+                };
+
+            }
+        }
+    }
+}
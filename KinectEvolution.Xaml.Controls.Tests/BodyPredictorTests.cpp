@@ -0,0 +1,267 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyPredictorTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BodyPredictor.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+using namespace WindowsPreview::Kinect;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                struct BodyPredictionMeasurement
+                {
+                    UINT    Samples;            // joints times display frames
+                    float   MeanHorizon;        // seconds predicted past the last frame
+                    float   PredictedError;     // meters, mean distance of the prediction from the truth
+                    float   HeldError;          // meters, the same for showing the last frame
+                    float   PredictedJitter;    // meters, mean second difference between display frames
+                    float   HeldJitter;
+                };
+
+                // position of a joint in the recording at a sensor time, false where the joint is not tracked on both sides
+                static bool InterpolateRecording(
+                    const std::vector<BodyFrameData>& frames,
+                    UINT frameIndex,
+                    INT64 time,
+                    UINT bodyIndex,
+                    UINT jointIndex,
+                    _Out_ XMVECTOR* pPosition)
+                {
+                    const BodyFrameData& a = frames[frameIndex];
+                    const BodyFrameData& b = frames[min(frameIndex + 1, static_cast<UINT>(frames.size()) - 1)];
+                    UINT i = BodyJointIndex(bodyIndex, jointIndex);
+
+                    if (!a.IsTracked[bodyIndex] || !b.IsTracked[bodyIndex] || a.TrackingId[bodyIndex] != b.TrackingId[bodyIndex] ||
+                        a.TrackingState[i] != TrackingState::Tracked || b.TrackingState[i] != TrackingState::Tracked)
+                    {
+                        return false;
+                    }
+
+                    float t = (b.RelativeTime > a.RelativeTime) ? static_cast<float>(time - a.RelativeTime) / static_cast<float>(b.RelativeTime - a.RelativeTime) : 0.0f;
+                    *pPosition = XMVectorLerp(a.GetPosition(bodyIndex, jointIndex), b.GetPosition(bodyIndex, jointIndex), t);
+                    return true;
+                }
+
+                // replays frames [firstFrame, firstFrame + frameCount) of a recording as if shown at displayRate frames
+                // per second, each frame arriving deliveryDelay seconds after its sensor time
+                static void MeasurePrediction(
+                    const BodyFrameStore& store,
+                    UINT firstFrame,
+                    UINT frameCount,
+                    double displayRate,
+                    double deliveryDelay,
+                    const BodyPredictorParameters& parameters,
+                    _Out_ BodyPredictionMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    frameCount = min(frameCount, store.GetFrameCount() - min(firstFrame, store.GetFrameCount()));
+                    if (frameCount < 2 || displayRate <= 0.0)
+                    {
+                        return;
+                    }
+
+                    std::vector<BodyFrameData> frames(frameCount);
+                    store.GetFrames(firstFrame, frameCount, frames.data());
+
+                    BodyPredictor predictor;
+                    predictor.SetParameters(parameters);
+
+                    // the local clock runs deliveryDelay behind the sensor clock
+                    INT64 delay = static_cast<INT64>(deliveryDelay * 1e7);
+                    INT64 latency = static_cast<INT64>(parameters.LatencyCompensation * 1e7f);
+                    INT64 displayInterval = static_cast<INT64>(1e7 / displayRate);
+
+                    // the last two shown positions of every joint, for the second difference
+                    std::vector<XMFLOAT3> shown(BODY_JOINT_COUNT * 4);
+                    std::vector<BYTE> shownCount(BODY_JOINT_COUNT);
+                    std::vector<UINT64> shownId(BODY_COUNT);
+
+                    double horizonSum = 0.0;
+                    double predictedError = 0.0;
+                    double heldError = 0.0;
+                    double predictedJitter = 0.0;
+                    double heldJitter = 0.0;
+                    UINT jitterSamples = 0;
+                    UINT displayFrames = 0;
+
+                    UINT nextFrame = 0;
+                    UINT truthFrame = 0;
+                    for (INT64 now = frames[0].RelativeTime + delay; ; now += displayInterval)
+                    {
+                        while (nextFrame < frameCount && frames[nextFrame].RelativeTime + delay <= now)
+                        {
+                            predictor.AddFrame(frames[nextFrame], frames[nextFrame].RelativeTime + delay);
+                            ++nextFrame;
+                        }
+
+                        // the truth must lie within the recording
+                        INT64 target = now - delay + latency;
+                        if (target > frames[frameCount - 1].RelativeTime)
+                        {
+                            break;
+                        }
+                        if (target < frames[0].RelativeTime)
+                        {
+                            continue;
+                        }
+                        while (truthFrame + 1 < frameCount && frames[truthFrame + 1].RelativeTime <= target)
+                        {
+                            ++truthFrame;
+                        }
+
+                        predictor.Predict(now);
+                        const BodyFrameData& predicted = predictor.GetPredicted();
+                        const BodyFrameData& held = frames[nextFrame - 1];
+
+                        horizonSum += predictor.GetHorizon();
+                        ++displayFrames;
+
+                        for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                        {
+                            if (!held.IsTracked[bodyIndex] || held.TrackingId[bodyIndex] != shownId[bodyIndex])
+                            {
+                                ZeroMemory(&shownCount[BodyJointIndex(bodyIndex, 0)], JOINT_COUNT);
+                                shownId[bodyIndex] = held.IsTracked[bodyIndex] ? held.TrackingId[bodyIndex] : 0;
+                            }
+
+                            for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+                            {
+                                UINT i = BodyJointIndex(bodyIndex, jointIndex);
+
+                                XMVECTOR truth;
+                                if (!held.IsTracked[bodyIndex] || held.TrackingState[i] != TrackingState::Tracked ||
+                                    !InterpolateRecording(frames, truthFrame, target, bodyIndex, jointIndex, &truth))
+                                {
+                                    shownCount[i] = 0;
+                                    continue;
+                                }
+
+                                XMVECTOR p = predicted.GetPosition(bodyIndex, jointIndex);
+                                XMVECTOR q = held.GetPosition(bodyIndex, jointIndex);
+                                predictedError += XMVectorGetX(XMVector3Length(p - truth));
+                                heldError += XMVectorGetX(XMVector3Length(q - truth));
+                                ++pMeasurement->Samples;
+
+                                XMFLOAT3* pShown = &shown[i * 4];
+                                if (shownCount[i] >= 2)
+                                {
+                                    predictedJitter += XMVectorGetX(XMVector3Length(p - 2.0f * XMLoadFloat3(&pShown[0]) + XMLoadFloat3(&pShown[1])));
+                                    heldJitter += XMVectorGetX(XMVector3Length(q - 2.0f * XMLoadFloat3(&pShown[2]) + XMLoadFloat3(&pShown[3])));
+                                    ++jitterSamples;
+                                }
+
+                                pShown[1] = pShown[0];
+                                pShown[3] = pShown[2];
+                                XMStoreFloat3(&pShown[0], p);
+                                XMStoreFloat3(&pShown[2], q);
+                                shownCount[i] = static_cast<BYTE>(min(shownCount[i] + 1, 2));
+                            }
+                        }
+                    }
+
+                    if (0 != displayFrames)
+                    {
+                        pMeasurement->MeanHorizon = static_cast<float>(horizonSum / displayFrames);
+                    }
+
+                    if (0 != pMeasurement->Samples)
+                    {
+                        pMeasurement->PredictedError = static_cast<float>(predictedError / pMeasurement->Samples);
+                        pMeasurement->HeldError = static_cast<float>(heldError / pMeasurement->Samples);
+                    }
+
+                    if (0 != jitterSamples)
+                    {
+                        pMeasurement->PredictedJitter = static_cast<float>(predictedJitter / jitterSamples);
+                        pMeasurement->HeldJitter = static_cast<float>(heldJitter / jitterSamples);
+                    }
+                }
+
+                TEST_CLASS(BodyPredictorTests)
+                {
+                public:
+                    TEST_METHOD(PredictionBeatsHoldingTheLastFrame)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(2, 900, 3, 0, store);
+
+                        const double rates[] = { 60.0, 120.0 };
+                        for (double rate : rates)
+                        {
+                            BodyPredictorParameters parameters;
+                            parameters.LatencyCompensation = 1.0f / 30.0f;
+
+                            BodyPredictionMeasurement measurement;
+                            MeasurePrediction(store, 0, store.GetFrameCount(), rate, 0.012, parameters, &measurement);
+
+                            LogMessage("%.0f Hz: %u samples, horizon %.1f ms, error %.1f mm against %.1f mm held, jitter %.1f mm against %.1f mm held",
+                                rate, measurement.Samples, 1000.0f * measurement.MeanHorizon, 1000.0f * measurement.PredictedError, 1000.0f * measurement.HeldError,
+                                1000.0f * measurement.PredictedJitter, 1000.0f * measurement.HeldJitter);
+
+                            Assert::IsTrue(measurement.Samples > 0, L"joints compared");
+                            Assert::IsTrue(measurement.PredictedError < 0.6f * measurement.HeldError, L"prediction well under the held error");
+                            Assert::IsTrue(measurement.PredictedJitter < measurement.HeldJitter, L"prediction smoother than holding");
+                        }
+                    }
+
+                    TEST_METHOD(NoCompensationRendersTheSensorTime)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(2, 300, 4, 0, store);
+
+                        BodyPredictorParameters parameters;
+                        parameters.LatencyCompensation = 0.0f;
+
+                        // the prediction only bridges the delivery delay and the time since the frame
+                        BodyPredictionMeasurement measurement;
+                        MeasurePrediction(store, 0, store.GetFrameCount(), 60.0, 0.012, parameters, &measurement);
+
+                        Assert::IsTrue(measurement.MeanHorizon < 1.0f / 30.0f, L"horizon under a frame");
+                        Assert::IsTrue(measurement.PredictedError <= measurement.HeldError, L"no worse than holding");
+                    }
+
+                    TEST_METHOD(MeasurePredict)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(6, 10, 5, 0, store);
+
+                        BodyFrameData frames[3];
+                        store.GetFrames(0, 3, frames);
+
+                        BodyPredictor predictor;
+                        for (const BodyFrameData& frame : frames)
+                        {
+                            predictor.AddFrame(frame, frame.RelativeTime);
+                        }
+
+                        const UINT repeats = 10000;
+                        LARGE_INTEGER start, end;
+                        QueryPerformanceCounter(&start);
+                        for (UINT i = 0; i < repeats; ++i)
+                        {
+                            predictor.PredictSensorTime(frames[2].RelativeTime + i % 300000);
+                        }
+                        QueryPerformanceCounter(&end);
+
+                        double time = GetMicroseconds(start, end) / repeats;
+                        LogMessage("Predict of 6 bodies: %.2f us", time);
+#ifdef NDEBUG
+                        Assert::IsTrue(time < 50.0, L"Predict under 50 us");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
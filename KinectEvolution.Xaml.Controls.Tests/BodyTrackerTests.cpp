@@ -0,0 +1,197 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyTrackerTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BodyTracker.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // the sensor losing a body for frames [firstFrame, firstFrame + frameCount) and finding it again
+                // in another slot under a new id
+                struct Occlusion
+                {
+                    UINT    BodyIndex;
+                    UINT    FirstFrame;
+                    UINT    FrameCount;
+                    UINT    SensorIndex;
+                    UINT64  TrackingId;
+                    float   Scale;          // bone lengths of whoever comes back, 1 for the same person
+                };
+
+                // the recorded frame as the sensor reports it with the occlusions applied
+                static void GetSensorFrame(
+                    const BodyFrameStore& store,
+                    UINT frameIndex,
+                    _In_reads_(occlusionCount) const Occlusion* pOcclusions,
+                    UINT occlusionCount,
+                    _Out_ BodyFrameData& frame)
+                {
+                    BodyFrameData recorded;
+                    store.GetFrames(frameIndex, 1, &recorded);
+                    frame = recorded;
+
+                    for (UINT i = 0; i < occlusionCount; ++i)
+                    {
+                        const Occlusion& occlusion = pOcclusions[i];
+                        if (frameIndex < occlusion.FirstFrame)
+                        {
+                            continue;
+                        }
+
+                        frame.ClearBody(occlusion.BodyIndex);
+                        if (frameIndex < occlusion.FirstFrame + occlusion.FrameCount)
+                        {
+                            continue;
+                        }
+
+                        frame.CopyBody(occlusion.SensorIndex, recorded, occlusion.BodyIndex);
+                        frame.TrackingId[occlusion.SensorIndex] = occlusion.TrackingId;
+
+                        // a taller or shorter person standing in the same place
+                        XMVECTOR center = frame.GetPosition(occlusion.SensorIndex, static_cast<UINT>(WRK::JointType::SpineMid));
+                        for (UINT joint = 0; joint < JOINT_COUNT; ++joint)
+                        {
+                            UINT j = BodyJointIndex(occlusion.SensorIndex, joint);
+                            XMVECTOR position = center + occlusion.Scale * (frame.GetPosition(occlusion.SensorIndex, joint) - center);
+                            frame.PositionX[j] = XMVectorGetX(position);
+                            frame.PositionY[j] = XMVectorGetY(position);
+                            frame.PositionZ[j] = XMVectorGetZ(position);
+                        }
+                    }
+                }
+
+                // runs the recording through the tracker, asserting each occluded body is held while lost and, unless
+                // someone else comes back, keeps its slot and first id
+                static void PlayOcclusions(
+                    const BodyFrameStore& store,
+                    _In_reads_(occlusionCount) const Occlusion* pOcclusions,
+                    UINT occlusionCount,
+                    _Inout_ BodyTracker& tracker)
+                {
+                    BodyFrameData frame;
+                    BodyFrameData recorded;
+
+                    for (UINT frameIndex = 0; frameIndex < store.GetFrameCount(); ++frameIndex)
+                    {
+                        GetSensorFrame(store, frameIndex, pOcclusions, occlusionCount, frame);
+                        tracker.Update(frame);
+
+                        store.GetFrames(frameIndex, 1, &recorded);
+                        const BodyFrameData& tracked = tracker.GetTracked();
+
+                        for (UINT i = 0; i < occlusionCount; ++i)
+                        {
+                            const Occlusion& occlusion = pOcclusions[i];
+                            UINT bodyIndex = occlusion.BodyIndex;
+
+                            // held untracked with its id while lost
+                            if (frameIndex >= occlusion.FirstFrame && frameIndex < occlusion.FirstFrame + occlusion.FrameCount)
+                            {
+                                Assert::IsFalse(!!tracked.IsTracked[bodyIndex], L"lost body untracked");
+                                continue;
+                            }
+
+                            if (frameIndex < occlusion.FirstFrame || 1.0f == occlusion.Scale)
+                            {
+                                Assert::IsTrue(!!tracked.IsTracked[bodyIndex], L"body back in its slot");
+                                Assert::AreEqual(recorded.TrackingId[bodyIndex], tracked.TrackingId[bodyIndex], L"first id kept");
+                                Assert::AreEqual(recorded.PositionX[BodyJointIndex(bodyIndex, 0)], tracked.PositionX[BodyJointIndex(bodyIndex, 0)], L"same person");
+                            }
+                        }
+                    }
+                }
+
+                TEST_CLASS(BodyTrackerTests)
+                {
+                public:
+                    TEST_METHOD(OccludedBodyKeepsItsSlot)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(3, 300, 1, 0, store);
+
+                        // gone for a second, back in the fifth sensor slot
+                        Occlusion occlusions[] = { { 1, 100, 30, 4, 0x2001, 1.0f } };
+
+                        BodyTracker tracker;
+                        PlayOcclusions(store, occlusions, _countof(occlusions), tracker);
+
+                        Assert::AreEqual(3u, tracker.GetStatistics().NewTracks, L"no new track");
+                        Assert::AreEqual(1u, tracker.GetStatistics().Reidentified, L"reidentified once");
+                        Assert::AreEqual(4u, tracker.GetSensorIndex(1), L"followed to the new sensor slot");
+                        Assert::IsTrue(BodyTrackState::Free == tracker.GetTrackState(4), L"the sensor slot stays free");
+                    }
+
+                    TEST_METHOD(NeighboursAreNotSwapped)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(4, 300, 2, 0, store);
+
+                        // two people side by side lost together and found the other way round in the sensor's slots
+                        Occlusion occlusions[] =
+                        {
+                            { 1, 100, 20, 5, 0x2001, 1.0f },
+                            { 2, 100, 20, 4, 0x2002, 1.0f },
+                        };
+
+                        BodyTracker tracker;
+                        PlayOcclusions(store, occlusions, _countof(occlusions), tracker);
+
+                        Assert::AreEqual(2u, tracker.GetStatistics().Reidentified, L"both reidentified");
+                        Assert::AreEqual(5u, tracker.GetSensorIndex(1), L"second body");
+                        Assert::AreEqual(4u, tracker.GetSensorIndex(2), L"third body");
+                    }
+
+                    TEST_METHOD(SomeoneElseStartsANewTrack)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(3, 300, 3, 0, store);
+
+                        // a taller person steps in where the second body was lost
+                        Occlusion occlusions[] = { { 1, 100, 15, 4, 0x2001, 1.2f } };
+
+                        BodyTracker tracker;
+                        PlayOcclusions(store, occlusions, _countof(occlusions), tracker);
+
+                        Assert::AreEqual(0u, tracker.GetStatistics().Reidentified, L"not taken for the lost body");
+                        Assert::AreEqual(4u, tracker.GetStatistics().NewTracks, L"a new track");
+                        Assert::IsTrue(BodyTrackState::Lost == tracker.GetTrackState(1) || BodyTrackState::Free == tracker.GetTrackState(1), L"the lost body stays lost");
+                        Assert::AreNotEqual(static_cast<UINT64>(0x1001), tracker.GetTracked().TrackingId[3], L"under its own id");
+                    }
+
+                    TEST_METHOD(LongOcclusionExpires)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(3, 300, 4, 0, store);
+
+                        // gone for longer than the grace period
+                        Occlusion occlusions[] = { { 1, 100, 90, 4, 0x2001, 1.0f } };
+
+                        BodyTracker tracker;
+                        BodyFrameData frame;
+                        for (UINT frameIndex = 0; frameIndex < store.GetFrameCount(); ++frameIndex)
+                        {
+                            GetSensorFrame(store, frameIndex, occlusions, _countof(occlusions), frame);
+                            tracker.Update(frame);
+                        }
+
+                        Assert::AreEqual(1u, tracker.GetStatistics().Expired, L"expired");
+                        Assert::AreEqual(0u, tracker.GetStatistics().Reidentified, L"not reidentified");
+                        Assert::AreEqual(4u, tracker.GetStatistics().NewTracks, L"tracked again as someone new");
+                        Assert::AreEqual(static_cast<UINT64>(0x2001), tracker.GetTracked().TrackingId[1], L"the free slot under the new id");
+                    }
+                };
+
+            }
+        }
+    }
+}
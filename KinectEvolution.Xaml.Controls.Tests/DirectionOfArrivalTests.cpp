@@ -0,0 +1,202 @@
+//------------------------------------------------------------------------------
+// <copyright file="DirectionOfArrivalTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "DirectionOfArrival.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                struct DirectionOfArrivalMeasurement
+                {
+                    UINT    Frames;
+                    float   MeanTime;               // microseconds per frame
+                    float   RealTimeFactor;         // seconds of audio per second of processing
+                    float   MeanAngle;              // radians, weighted by confidence
+                    float   MeanConfidence;
+                };
+
+                // estimates a frame at a time, half overlapped, over the recording's first GetMicrophoneCount channels
+                static void MeasureDirectionOfArrival(
+                    const WaveFile& recording,
+                    _Inout_ DirectionOfArrival& directionOfArrival,
+                    _Out_ DirectionOfArrivalMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    const UINT microphoneCount = directionOfArrival.GetMicrophoneCount();
+                    const UINT frameSize = directionOfArrival.GetFrameSize();
+
+                    std::vector<const float*> channels(microphoneCount);
+                    double time = 0.0;
+                    double angleSum = 0.0;
+                    double confidenceSum = 0.0;
+                    UINT frames = 0;
+
+                    for (UINT first = 0; first + frameSize <= recording.GetFrameCount(); first += frameSize / 2)
+                    {
+                        for (UINT m = 0; m < microphoneCount; ++m)
+                        {
+                            channels[m] = recording.GetChannel(m) + first;
+                        }
+
+                        BeamEstimate estimate;
+                        LARGE_INTEGER start, end;
+                        QueryPerformanceCounter(&start);
+                        BOOL estimated = directionOfArrival.Estimate(channels.data(), &estimate);
+                        QueryPerformanceCounter(&end);
+
+                        time += GetMicroseconds(start, end);
+                        frames++;
+
+                        if (estimated)
+                        {
+                            angleSum += estimate.BeamAngle * estimate.BeamAngleConfidence;
+                            confidenceSum += estimate.BeamAngleConfidence;
+                        }
+                    }
+
+                    // each frame covers half a frame of new audio
+                    double audioTime = 1e6 * frames * (frameSize / 2) / recording.GetSampleRate();
+
+                    pMeasurement->Frames = frames;
+                    pMeasurement->MeanTime = (frames > 0) ? static_cast<float>(time / frames) : 0.0f;
+                    pMeasurement->RealTimeFactor = (time > 0.0) ? static_cast<float>(audioTime / time) : 0.0f;
+                    pMeasurement->MeanAngle = (confidenceSum > 0.0) ? static_cast<float>(angleSum / confidenceSum) : 0.0f;
+                    pMeasurement->MeanConfidence = (frames > 0) ? static_cast<float>(confidenceSum / frames) : 0.0f;
+                }
+
+                // one second of broadband sound from beamAngle, tones between 150 Hz and 5 kHz, over a little noise
+                // at every microphone
+                static void MakeArrayRecording(float beamAngle, UINT seed, _Out_ std::vector<std::vector<float>>& channels)
+                {
+                    const UINT sampleRate = 16000;
+                    const UINT toneCount = 60;
+
+                    std::mt19937 random(seed);
+                    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+                    double frequencies[toneCount], phases[toneCount], amplitudes[toneCount];
+                    for (UINT i = 0; i < toneCount; ++i)
+                    {
+                        frequencies[i] = 150.0 + 4850.0 * uniform(random);
+                        phases[i] = XM_2PI * uniform(random);
+                        amplitudes[i] = 0.02 * uniform(random);
+                    }
+
+                    channels.assign(KINECT_MICROPHONE_COUNT, std::vector<float>(sampleRate, 0.0f));
+                    for (UINT m = 0; m < KINECT_MICROPHONE_COUNT; ++m)
+                    {
+                        // a plane wave from beamAngle reaches the microphones further along it first
+                        double delay = -KinectMicrophonePositions[m] * sin(beamAngle) / 343.0;
+                        for (UINT n = 0; n < sampleRate; ++n)
+                        {
+                            double t = static_cast<double>(n) / sampleRate - delay;
+                            double sample = 0.0;
+                            for (UINT i = 0; i < toneCount; ++i)
+                            {
+                                sample += amplitudes[i] * sin(XM_2PI * frequencies[i] * t + phases[i]);
+                            }
+                            channels[m][n] = static_cast<float>(sample);
+                        }
+
+                        AddNoise(channels[m], 0.01f, random);
+                    }
+                }
+
+                TEST_CLASS(DirectionOfArrivalTests)
+                {
+                public:
+                    TEST_METHOD(SilenceHasNoEstimate)
+                    {
+                        DirectionOfArrival directionOfArrival;
+                        directionOfArrival.Reset(16000, 512, KinectMicrophonePositions, KINECT_MICROPHONE_COUNT, 50.0f * XM_PI / 180.0f, 101);
+
+                        std::vector<float> silence(512, 0.0f);
+                        const float* channels[KINECT_MICROPHONE_COUNT] = { silence.data(), silence.data(), silence.data(), silence.data() };
+
+                        BeamEstimate estimate;
+                        Assert::IsFalse(!!directionOfArrival.Estimate(channels, &estimate), L"no estimate from silence");
+                    }
+
+                    TEST_METHOD(MeasureSyntheticSources)
+                    {
+                        DirectionOfArrival directionOfArrival;
+                        directionOfArrival.Reset(16000, 512, KinectMicrophonePositions, KINECT_MICROPHONE_COUNT, 50.0f * XM_PI / 180.0f, 101);
+
+                        float maxError = 0.0f;
+                        float minRealTimeFactor = FLT_MAX;
+                        for (int degrees = -40; degrees <= 50; degrees += 10)
+                        {
+                            float beamAngle = degrees * XM_PI / 180.0f;
+
+                            std::vector<std::vector<float>> channels;
+                            MakeArrayRecording(beamAngle, degrees + 100, channels);
+
+                            const WaveSampleFormat formats[] = { WaveSampleFormat::Pcm16, WaveSampleFormat::Float32 };
+                            for (WaveSampleFormat format : formats)
+                            {
+                                WaveFile recording;
+                                Assert::IsTrue(LoadRecording(channels, 16000, format, recording), L"recording loads");
+
+                                DirectionOfArrivalMeasurement measurement;
+                                MeasureDirectionOfArrival(recording, directionOfArrival, &measurement);
+
+                                maxError = max(maxError, fabsf(measurement.MeanAngle - beamAngle));
+                                minRealTimeFactor = min(minRealTimeFactor, measurement.RealTimeFactor);
+                                Assert::IsTrue(measurement.MeanConfidence > 0.0f, L"frames have estimates");
+                            }
+                        }
+
+                        LogMessage("max error %.2f degrees, at least %.0fx real time", maxError * 180.0f / XM_PI, minRealTimeFactor);
+                        Assert::IsTrue(maxError < 2.0f * XM_PI / 180.0f, L"within 2 degrees");
+#ifdef NDEBUG
+                        Assert::IsTrue(minRealTimeFactor > 100.0f, L"over 100x real time");
+#endif
+                    }
+
+                    TEST_METHOD(BeamformKeepsTheSteeredVoice)
+                    {
+                        const float beamAngle = 30.0f * XM_PI / 180.0f;
+
+                        std::vector<std::vector<float>> channels;
+                        MakeArrayRecording(beamAngle, 3, channels);
+
+                        DirectionOfArrival directionOfArrival;
+                        directionOfArrival.Reset(16000, 512, KinectMicrophonePositions, KINECT_MICROPHONE_COUNT, 50.0f * XM_PI / 180.0f, 101);
+
+                        const float* pChannels[KINECT_MICROPHONE_COUNT];
+                        for (UINT m = 0; m < KINECT_MICROPHONE_COUNT; ++m)
+                        {
+                            pChannels[m] = channels[m].data();
+                        }
+
+                        // delayed and summed towards the voice it adds up, away from it it partly cancels
+                        std::vector<float> towards(16000), away(16000);
+                        directionOfArrival.Beamform(pChannels, 16000, beamAngle, towards.data());
+                        directionOfArrival.Beamform(pChannels, 16000, -beamAngle, away.data());
+
+                        double towardsPower = 0.0, awayPower = 0.0;
+                        for (UINT i = 0; i < 16000; ++i)
+                        {
+                            towardsPower += towards[i] * towards[i];
+                            awayPower += away[i] * away[i];
+                        }
+
+                        Assert::IsTrue(towardsPower > awayPower, L"more power steered at the voice");
+                    }
+                };
+
+            }
+        }
+    }
+}
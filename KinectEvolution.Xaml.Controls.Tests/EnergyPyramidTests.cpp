@@ -0,0 +1,230 @@
+//------------------------------------------------------------------------------
+// <copyright file="EnergyPyramidTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "EnergyPyramid.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                struct EnergyPyramidMeasurement
+                {
+                    UINT    Appends;            // energies appended, in blocks of one audio read
+                    float   MeanAppendTime;     // nanoseconds per energy
+                    float   MaxBlockTime;       // microseconds, the slowest block
+                    UINT    Queries;            // random windows rendered
+                    UINT    Columns;            // per window
+                    float   MeanQueryTime;      // microseconds per window
+                    float   MaxQueryTime;       // microseconds
+                    UINT    MaxReads;           // most summaries read for one window
+                    float   MaxError;           // largest difference of Summarize to a scan of the energies
+                };
+
+                // a slow swell under noise, in the [0, 1] range of the energy meter
+                static void MakeEnergies(UINT count, _Out_ std::vector<float>& energies)
+                {
+                    std::mt19937 random(1);
+                    std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+
+                    energies.resize(count);
+                    for (UINT i = 0; i < count; ++i)
+                    {
+                        energies[i] = 0.5f + 0.3f * sinf(i * 0.001f) + noise(random);
+                    }
+                }
+
+                // the min, max and mean of energies [start, end) one at a time
+                static EnergySummary ScanEnergies(const std::vector<float>& energies, INT64 start, INT64 end)
+                {
+                    EnergySummary summary = { FLT_MAX, -FLT_MAX, 0.0f };
+
+                    double sum = 0.0;
+                    for (INT64 i = start; i < end; ++i)
+                    {
+                        float energy = energies[static_cast<size_t>(i)];
+                        summary.Min = min(summary.Min, energy);
+                        summary.Max = max(summary.Max, energy);
+                        sum += energy;
+                    }
+
+                    summary.Mean = static_cast<float>(sum / (end - start));
+                    return summary;
+                }
+
+                // appends appendCount energies in blocks of blockLength to an in memory pyramid of capacity, then
+                // renders queries random windows of the kept energies at columns wide
+                static void MeasureEnergyPyramid(
+                    UINT capacity,
+                    UINT appendCount,
+                    UINT blockLength,
+                    UINT queries,
+                    UINT columns,
+                    _Out_ EnergyPyramidMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    EnergyPyramid pyramid;
+                    Assert::IsTrue(!!pyramid.Open(nullptr, capacity), L"pyramid opens in the paging file");
+
+                    std::vector<float> energies;
+                    MakeEnergies(appendCount, energies);
+
+                    double appendTime = 0.0;
+                    double maxBlockTime = 0.0;
+
+                    for (UINT i = 0; i < appendCount; i += blockLength)
+                    {
+                        UINT count = min(blockLength, appendCount - i);
+
+                        LARGE_INTEGER blockStart, blockEnd;
+                        QueryPerformanceCounter(&blockStart);
+                        pyramid.Append(&energies[i], count);
+                        QueryPerformanceCounter(&blockEnd);
+
+                        double blockTime = GetMicroseconds(blockStart, blockEnd);
+                        appendTime += blockTime;
+                        maxBlockTime = max(maxBlockTime, blockTime);
+                    }
+
+                    std::vector<EnergySummary> rendered(columns);
+                    const INT64 first = pyramid.GetFirst();
+                    const INT64 kept = pyramid.GetCount() - first;
+
+                    std::mt19937 random(2);
+                    double queryTime = 0.0;
+                    double maxQueryTime = 0.0;
+                    UINT maxReads = 0;
+                    float maxError = 0.0f;
+
+                    for (UINT query = 0; query < queries; ++query)
+                    {
+                        // windows from a few energies to everything kept, anywhere in it
+                        INT64 length = max(INT64(1), kept >> (random() % pyramid.GetLevelCount()));
+                        INT64 start = first + static_cast<INT64>(random() % static_cast<UINT>(kept - length + 1));
+
+                        LARGE_INTEGER queryStart, queryEnd;
+                        QueryPerformanceCounter(&queryStart);
+                        UINT reads = pyramid.Render(start, start + length, columns, rendered.data());
+                        QueryPerformanceCounter(&queryEnd);
+
+                        double time = GetMicroseconds(queryStart, queryEnd);
+                        queryTime += time;
+                        maxQueryTime = max(maxQueryTime, time);
+                        maxReads = max(maxReads, reads);
+
+                        // the window scanned one energy at a time, for the first few
+                        if (query < 64)
+                        {
+                            EnergySummary summary = pyramid.Summarize(start, start + length);
+                            EnergySummary scan = ScanEnergies(energies, start, start + length);
+
+                            maxError = max(maxError, fabsf(summary.Min - scan.Min));
+                            maxError = max(maxError, fabsf(summary.Max - scan.Max));
+                            maxError = max(maxError, fabsf(summary.Mean - scan.Mean));
+                        }
+                    }
+
+                    pMeasurement->Appends = appendCount;
+                    pMeasurement->MeanAppendTime = static_cast<float>(appendTime * 1000.0 / appendCount);
+                    pMeasurement->MaxBlockTime = static_cast<float>(maxBlockTime);
+                    pMeasurement->Queries = queries;
+                    pMeasurement->Columns = columns;
+                    pMeasurement->MeanQueryTime = (queries > 0) ? static_cast<float>(queryTime / queries) : 0.0f;
+                    pMeasurement->MaxQueryTime = static_cast<float>(maxQueryTime);
+                    pMeasurement->MaxReads = maxReads;
+                    pMeasurement->MaxError = maxError;
+                }
+
+                TEST_CLASS(EnergyPyramidTests)
+                {
+                public:
+                    TEST_METHOD(SummarizeMatchesScanEverywhere)
+                    {
+                        // small enough to wrap the rings several times and check every window
+                        std::vector<float> energies;
+                        MakeEnergies(1000, energies);
+
+                        EnergyPyramid pyramid;
+                        Assert::IsTrue(!!pyramid.Open(nullptr, 64), L"pyramid opens");
+                        pyramid.Append(energies.data(), static_cast<UINT>(energies.size()));
+
+                        const INT64 first = pyramid.GetFirst();
+                        const INT64 count = pyramid.GetCount();
+                        Assert::AreEqual(static_cast<INT64>(1000), count, L"energies appended");
+                        Assert::AreEqual(count - pyramid.GetCapacity(), first, L"the last capacity kept");
+
+                        float maxError = 0.0f;
+                        for (INT64 start = first; start < count; ++start)
+                        {
+                            for (INT64 end = start + 1; end <= count; ++end)
+                            {
+                                EnergySummary summary = pyramid.Summarize(start, end);
+                                EnergySummary scan = ScanEnergies(energies, start, end);
+
+                                maxError = max(maxError, fabsf(summary.Min - scan.Min));
+                                maxError = max(maxError, fabsf(summary.Max - scan.Max));
+                                maxError = max(maxError, fabsf(summary.Mean - scan.Mean));
+                            }
+                        }
+
+                        Assert::IsTrue(maxError < 1e-6f, L"Summarize matches a scan");
+                    }
+
+                    TEST_METHOD(RenderClipsToTheKeptEnergies)
+                    {
+                        std::vector<float> energies;
+                        MakeEnergies(300, energies);
+
+                        EnergyPyramid pyramid;
+                        Assert::IsTrue(!!pyramid.Open(nullptr, 256), L"pyramid opens");
+                        pyramid.Append(energies.data(), static_cast<UINT>(energies.size()));
+
+                        // a window twice as long as what is kept, centred on the newest energy
+                        std::vector<EnergySummary> columns(8);
+                        pyramid.Render(pyramid.GetCount() - 256, pyramid.GetCount() + 256, 8, columns.data());
+
+                        for (UINT column = 0; column < 4; ++column)
+                        {
+                            Assert::IsTrue(columns[column].Max > 0.0f, L"columns over the kept energies hold them");
+                        }
+
+                        // column edges move down to a node edge, so the first column past the newest may still show
+                        // the node it is filling
+                        for (UINT column = 5; column < 8; ++column)
+                        {
+                            Assert::IsTrue(0.0f == columns[column].Min && 0.0f == columns[column].Max, L"columns past the newest are empty");
+                        }
+                    }
+
+                    TEST_METHOD(MeasureHourOfEnergies)
+                    {
+                        // 6M energies of 53 per 50 ms read, about 95 minutes, into 2^22 of history
+                        EnergyPyramidMeasurement measurement;
+                        MeasureEnergyPyramid(1 << 22, 6000000, 53, 2000, 2100, &measurement);
+
+                        LogMessage("%u appends at %.1f ns, slowest block %.1f us; %u windows of %u columns at %.1f us, slowest %.1f us, at most %u reads, max error %.2e",
+                            measurement.Appends, measurement.MeanAppendTime, measurement.MaxBlockTime, measurement.Queries, measurement.Columns,
+                            measurement.MeanQueryTime, measurement.MaxQueryTime, measurement.MaxReads, measurement.MaxError);
+
+                        Assert::IsTrue(measurement.MaxError < 1e-6f, L"Summarize matches a scan");
+                        Assert::IsTrue(measurement.MaxReads <= 8 * measurement.Columns + 64, L"at most 8 reads per column");
+#ifdef NDEBUG
+                        Assert::IsTrue(measurement.MeanAppendTime < 200.0f, L"appends under 200 ns");
+                        Assert::IsTrue(measurement.MeanQueryTime < 1000.0f, L"windows under 1 ms");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
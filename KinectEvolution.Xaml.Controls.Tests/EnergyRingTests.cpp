@@ -0,0 +1,212 @@
+//------------------------------------------------------------------------------
+// <copyright file="EnergyRingTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "EnergyRing.h"
+#include "TestHelpers.h"
+
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // values pushed through the ring by the stress tests, each one its own sequence number; floats hold
+                // every integer this size exactly
+                static const UINT STRESS_VALUE_COUNT = 2000000;
+
+                // small enough that the ring wraps every few calls
+                static const UINT STRESS_CAPACITY = 64;
+
+                // what the consumer saw of the sequence
+                struct ConsumerResult
+                {
+                    UINT64  Read;
+                    UINT64  Gaps;           // values missing between two read ones
+                    UINT64  OutOfOrder;     // values not after the one before
+                    float   Last;           // -1 before the first
+                };
+
+                // writes 0, 1, 2... in chunks of random size; with waitForRoom the producer yields until a chunk fits,
+                // otherwise it writes what fits, drops the rest and now and then yields
+                static void Produce(_Inout_ EnergyRing& ring, bool waitForRoom, UINT seed)
+                {
+                    std::mt19937 random(seed);
+                    std::uniform_int_distribution<UINT> chunkSize(1, 37);
+
+                    UINT next = 0;
+                    while (next < STRESS_VALUE_COUNT)
+                    {
+                        UINT count = min(chunkSize(random), STRESS_VALUE_COUNT - next);
+                        UINT free = ring.GetFreeCount();
+                        if (waitForRoom && free < count)
+                        {
+                            std::this_thread::yield();
+                            continue;
+                        }
+
+                        UINT written = min(count, free);
+                        UINT index = ring.GetWriteIndex();
+                        float* pStorage = ring.GetStorage();
+                        for (UINT i = 0; i < written; ++i)
+                        {
+                            pStorage[(index + i) & (ring.GetCapacity() - 1)] = static_cast<float>(next + i);
+                        }
+
+                        ring.EndWrite(written);
+                        ring.AddDropped(count - written);
+                        next += count;
+
+                        // a capture thread gives up the core between blocks, so the consumer gets to run on one core
+                        if (!waitForRoom && 0 == next % 7)
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                }
+
+                // reads in chunks of random size until the producer is done and the ring is empty
+                static void Consume(_Inout_ EnergyRing& ring, _In_ const std::atomic<bool>& produced, UINT seed, _Out_ ConsumerResult* pResult)
+                {
+                    std::mt19937 random(seed);
+                    std::uniform_int_distribution<UINT> chunkSize(1, 50);
+
+                    ZeroMemory(pResult, sizeof(*pResult));
+                    float last = -1.0f;
+
+                    for (;;)
+                    {
+                        bool done = produced.load(std::memory_order_acquire);
+
+                        EnergySpan span = ring.BeginRead(chunkSize(random));
+                        if (0 == span.GetCount())
+                        {
+                            // the producer finished before the ring was seen empty, so nothing more is coming
+                            if (done)
+                            {
+                                break;
+                            }
+
+                            std::this_thread::yield();
+                            continue;
+                        }
+
+                        for (UINT i = 0; i < span.GetCount(); ++i)
+                        {
+                            float value = i < span.FirstCount ? span.pFirst[i] : span.pSecond[i - span.FirstCount];
+                            pResult->OutOfOrder += value > last ? 0 : 1;
+                            pResult->Gaps += value > last + 1.0f ? static_cast<UINT64>(value - last - 1.0f) : 0;
+                            last = value;
+                        }
+
+                        pResult->Read += span.GetCount();
+                        ring.EndRead(span.GetCount());
+                    }
+
+                    pResult->Last = last;
+                }
+
+                static void RunStress(bool waitForRoom, UINT seed, _Out_ ConsumerResult* pResult, _Out_ EnergyRingStatistics* pStatistics)
+                {
+                    EnergyRing ring;
+                    ring.Reset(STRESS_CAPACITY);
+
+                    std::atomic<bool> produced(false);
+                    std::thread consumer([&]() { Consume(ring, produced, seed + 1, pResult); });
+
+                    Produce(ring, waitForRoom, seed);
+                    produced.store(true, std::memory_order_release);
+                    consumer.join();
+
+                    ring.GetStatistics(pStatistics);
+                }
+
+                TEST_CLASS(EnergyRingTests)
+                {
+                public:
+                    TEST_METHOD(ReadsWrapAroundTheStorage)
+                    {
+                        EnergyRing ring;
+                        ring.Reset(60);
+                        Assert::AreEqual(64u, ring.GetCapacity(), L"rounded up to a power of two");
+
+                        // 50 written and 40 read leaves the next write 14 slots from the end
+                        for (UINT pass = 0; pass < 2; ++pass)
+                        {
+                            UINT index = ring.GetWriteIndex();
+                            for (UINT i = 0; i < 50; ++i)
+                            {
+                                ring.GetStorage()[(index + i) & 63] = static_cast<float>(pass * 50 + i);
+                            }
+                            ring.EndWrite(50);
+
+                            if (0 == pass)
+                            {
+                                ring.EndRead(ring.BeginRead(40).GetCount());
+                            }
+                        }
+
+                        Assert::AreEqual(60u, ring.GetReadableCount(), L"readable");
+                        Assert::AreEqual(4u, ring.GetFreeCount(), L"free");
+
+                        EnergySpan span = ring.BeginRead(100);
+                        Assert::AreEqual(24u, span.FirstCount, L"to the end of the storage");
+                        Assert::AreEqual(36u, span.SecondCount, L"from the start");
+                        for (UINT i = 0; i < span.GetCount(); ++i)
+                        {
+                            float value = i < span.FirstCount ? span.pFirst[i] : span.pSecond[i - span.FirstCount];
+                            Assert::AreEqual(static_cast<float>(40 + i), value, L"in order");
+                        }
+
+                        ring.EndRead(span.GetCount());
+                        Assert::AreEqual(0u, ring.GetReadableCount(), L"empty");
+                        Assert::AreEqual(64u, ring.GetFreeCount(), L"all free");
+                    }
+
+                    TEST_METHOD(StressWithoutDrops)
+                    {
+                        ConsumerResult result;
+                        EnergyRingStatistics statistics;
+                        RunStress(true, 11, &result, &statistics);
+
+                        Assert::AreEqual(static_cast<UINT64>(STRESS_VALUE_COUNT), result.Read, L"every value read");
+                        Assert::AreEqual(static_cast<UINT64>(0), result.Gaps, L"none missing");
+                        Assert::AreEqual(static_cast<UINT64>(0), result.OutOfOrder, L"in order");
+                        Assert::AreEqual(static_cast<UINT64>(0), statistics.Dropped, L"none dropped");
+                        Assert::AreEqual(static_cast<UINT64>(STRESS_VALUE_COUNT), statistics.Written, L"written");
+                        Assert::AreEqual(static_cast<UINT64>(STRESS_VALUE_COUNT), statistics.Read, L"read");
+                        Assert::IsTrue(statistics.MaxFill <= STRESS_CAPACITY, L"never over capacity");
+                    }
+
+                    TEST_METHOD(StressWithDrops)
+                    {
+                        ConsumerResult result;
+                        EnergyRingStatistics statistics;
+                        RunStress(false, 23, &result, &statistics);
+
+                        LogMessage("%u values: %llu read, %llu dropped in %llu overruns, fill at most %u of %u",
+                            STRESS_VALUE_COUNT, result.Read, statistics.Dropped, statistics.Overruns, statistics.MaxFill, STRESS_CAPACITY);
+
+                        // whatever was dropped shows up as a gap and nothing else does
+                        Assert::AreEqual(static_cast<UINT64>(0), result.OutOfOrder, L"in order");
+                        Assert::AreEqual(static_cast<UINT64>(STRESS_VALUE_COUNT), statistics.Written + statistics.Dropped, L"every value written or dropped");
+                        Assert::AreEqual(statistics.Written, result.Read, L"everything written read");
+                        Assert::AreEqual(statistics.Written, statistics.Read, L"read count");
+                        UINT64 droppedAtTheEnd = static_cast<UINT64>(STRESS_VALUE_COUNT - 1 - result.Last);
+                        Assert::AreEqual(statistics.Dropped, result.Gaps + droppedAtTheEnd, L"a gap for every drop");
+                        Assert::IsTrue(statistics.Overruns <= statistics.Dropped, L"every overrun drops a value");
+                        Assert::IsTrue(statistics.MaxFill <= STRESS_CAPACITY, L"never over capacity");
+                    }
+                };
+
+            }
+        }
+    }
+}
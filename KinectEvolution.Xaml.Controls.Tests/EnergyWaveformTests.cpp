@@ -0,0 +1,154 @@
+//------------------------------------------------------------------------------
+// <copyright file="EnergyWaveformTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "EnergyWaveform.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // the panel's colors, as AudioPanel sets them
+                static const UINT BACKGROUND = 0xFFFFFFFF;
+                static const UINT FOREGROUND = 0x8A2BE2;
+
+                // an odd height, so the bars are not symmetric about the middle row
+                static const UINT WAVEFORM_HEIGHT = 61;
+
+                // one pixel at a time, as the per column copies drew it: a bar at least 1 and at most height rows
+                // tall centered on the middle row, background past the energy
+                static UINT ReferencePixel(_In_reads_(energyCount) const float* pEnergy, UINT energyCount, UINT height, UINT x, UINT y)
+                {
+                    if (x >= energyCount)
+                    {
+                        return BACKGROUND;
+                    }
+
+                    INT barHeight = static_cast<INT>(min(max(1.0f, pEnergy[x] * height), static_cast<float>(height)));
+                    INT top = static_cast<INT>(height / 2) - (barHeight / 2);
+                    INT row = static_cast<INT>(y);
+
+                    return (top <= row && row < top + barHeight) ? FOREGROUND : BACKGROUND;
+                }
+
+                // energies across the whole range, with some silence, some clipping and a negative sample
+                static void MakeEnergy(UINT count, UINT seed, _Out_ std::vector<float>& energy)
+                {
+                    std::mt19937 random(seed);
+                    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+                    energy.resize(count);
+                    for (UINT i = 0; i < count; ++i)
+                    {
+                        float roll = unit(random);
+                        energy[i] = roll < 0.1f ? 0.0f : roll < 0.15f ? 1.5f : roll < 0.17f ? -0.2f : unit(random);
+                    }
+                }
+
+                TEST_CLASS(EnergyWaveformTests)
+                {
+                public:
+                    TEST_METHOD(RasterizeMatchesThePerPixelReference)
+                    {
+                        // widths around and between whole 4 column vectors, energy shorter and longer than the image
+                        const UINT widths[] = { 1, 2, 3, 5, 6, 7, 9, 13, 63, 101, 1021 };
+                        const UINT heights[] = { 1, 2, WAVEFORM_HEIGHT, 64 };
+
+                        for (UINT w = 0; w < _countof(widths); ++w)
+                        {
+                            for (UINT h = 0; h < _countof(heights); ++h)
+                            {
+                                UINT width = widths[w];
+                                UINT height = heights[h];
+                                UINT energyCounts[] = { width, width - width / 3, width + 7 };
+
+                                for (UINT e = 0; e < _countof(energyCounts); ++e)
+                                {
+                                    std::vector<float> energy;
+                                    MakeEnergy(energyCounts[e], w * 31 + h * 7 + e, energy);
+
+                                    std::vector<UINT> pixels(width * height, 0);
+                                    RasterizeEnergyWaveform(energy.data(), energyCounts[e], width, height, BACKGROUND, FOREGROUND, pixels.data());
+
+                                    for (UINT y = 0; y < height; ++y)
+                                    {
+                                        for (UINT x = 0; x < width; ++x)
+                                        {
+                                            Assert::AreEqual(ReferencePixel(energy.data(), energyCounts[e], height, x, y), pixels[y * width + x], L"pixel");
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+
+                    TEST_METHOD(DirtyCopiesMatchAFullRasterization)
+                    {
+                        const UINT widths[] = { 7, 101, 1021 };
+
+                        for (UINT w = 0; w < _countof(widths); ++w)
+                        {
+                            UINT width = widths[w];
+
+                            EnergyWaveform waveform;
+                            waveform.Resize(width, WAVEFORM_HEIGHT, BACKGROUND, FOREGROUND);
+
+                            // the bitmap as the panel keeps it, cleared once and then given only the dirty rectangles
+                            std::vector<UINT> bitmap(waveform.GetPixels(), waveform.GetPixels() + width * WAVEFORM_HEIGHT);
+                            std::vector<UINT> expected(width * WAVEFORM_HEIGHT);
+                            std::vector<float> energy;
+                            UINT updates = 0;
+
+                            for (UINT frame = 0; frame < 60; ++frame)
+                            {
+                                // the history fills in from the left and changes every other frame, now and then going quiet
+                                UINT energyCount = min(width, (frame + 1) * width / 20);
+                                MakeEnergy(energyCount, frame / 2, energy);
+                                if (0 == frame % 13)
+                                {
+                                    energy.assign(energyCount, 0.0f);
+                                }
+
+                                EnergyWaveformRect dirty;
+                                if (waveform.Update(energy.data(), energyCount, &dirty))
+                                {
+                                    Assert::IsTrue(dirty.Left < dirty.Right && dirty.Right <= width, L"columns inside the image");
+                                    Assert::IsTrue(dirty.Top < dirty.Bottom && dirty.Bottom <= WAVEFORM_HEIGHT, L"rows inside the image");
+
+                                    const UINT* pSource = waveform.GetPixels(dirty);
+                                    UINT sourceStride = waveform.GetStride() / sizeof(UINT);
+                                    for (UINT y = dirty.Top; y < dirty.Bottom; ++y)
+                                    {
+                                        const UINT* pRow = pSource + (y - dirty.Top) * sourceStride;
+                                        std::copy(pRow, pRow + (dirty.Right - dirty.Left), bitmap.begin() + y * width + dirty.Left);
+                                    }
+
+                                    ++updates;
+                                }
+
+                                RasterizeEnergyWaveform(energy.data(), energyCount, width, WAVEFORM_HEIGHT, BACKGROUND, FOREGROUND, expected.data());
+
+                                Assert::IsTrue(expected == bitmap, L"bitmap matches a full rasterization");
+                                Assert::IsTrue(std::equal(expected.begin(), expected.end(), waveform.GetPixels()), L"image matches a full rasterization");
+
+                                // the same energy again changes nothing
+                                Assert::IsFalse(!!waveform.Update(energy.data(), energyCount, &dirty), L"nothing to copy");
+                            }
+
+                            Assert::IsTrue(updates > 0, L"some frames changed");
+                        }
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,236 @@
+//------------------------------------------------------------------------------
+// <copyright file="GestureRecognizerTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "GestureRecognizer.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // the swaying bodies repeat every 20 s
+                static const UINT SWAY_PERIOD_FRAMES = 600;
+
+                struct GestureMeasurement
+                {
+                    UINT    Frames;
+                    UINT    Matches;
+                    float   MeanUpdateTime;     // microseconds per frame of every body against every template
+                    float   MaxUpdateTime;
+                    float   SkippedFraction;    // columns skipped by the lower bound
+                };
+
+                // frames [firstFrame, firstFrame + frameCount) of bodyCount swaying bodies, seed picks the noise
+                static void MakeSwayingFrames(UINT bodyCount, UINT firstFrame, UINT frameCount, UINT seed, _Out_ std::vector<BodyFrameData>& frames)
+                {
+                    std::mt19937 random(seed);
+
+                    frames.resize(frameCount);
+                    for (UINT i = 0; i < frameCount; ++i)
+                    {
+                        BodyFrameData& frame = frames[i];
+                        frame.Clear();
+                        frame.RelativeTime = static_cast<INT64>(firstFrame + i) * 333333;
+
+                        for (UINT bodyIndex = 0; bodyIndex < bodyCount; ++bodyIndex)
+                        {
+                            MakeSwayingBody(bodyIndex, 0x1000 + bodyIndex, (firstFrame + i) / 30.0f, 0.003f, random, frame);
+                        }
+                    }
+                }
+
+                // feeds the frames to the recognizer and collects every match
+                static void MeasureGestures(
+                    _Inout_ GestureRecognizer& recognizer,
+                    const std::vector<BodyFrameData>& frames,
+                    _Inout_ std::vector<GestureMatch>& matches,
+                    _Out_ GestureMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    double updateTime = 0.0;
+                    double maxUpdateTime = 0.0;
+
+                    for (const BodyFrameData& frame : frames)
+                    {
+                        LARGE_INTEGER start, end;
+                        QueryPerformanceCounter(&start);
+                        recognizer.Update(frame);
+                        QueryPerformanceCounter(&end);
+
+                        double elapsed = GetMicroseconds(start, end);
+                        updateTime += elapsed;
+                        maxUpdateTime = max(maxUpdateTime, elapsed);
+                        pMeasurement->Frames++;
+
+                        matches.insert(matches.end(), recognizer.GetMatches().begin(), recognizer.GetMatches().end());
+                    }
+
+                    UINT64 columns = recognizer.GetUpdatedColumns() + recognizer.GetSkippedColumns();
+
+                    pMeasurement->Matches = static_cast<UINT>(matches.size());
+                    pMeasurement->MeanUpdateTime = (pMeasurement->Frames > 0) ? static_cast<float>(updateTime / pMeasurement->Frames) : 0.0f;
+                    pMeasurement->MaxUpdateTime = static_cast<float>(maxUpdateTime);
+                    pMeasurement->SkippedFraction = (columns > 0) ? static_cast<float>(static_cast<double>(recognizer.GetSkippedColumns()) / columns) : 0.0f;
+                }
+
+                TEST_CLASS(GestureRecognizerTests)
+                {
+                public:
+                    TEST_METHOD(FeaturesIgnoreWhereTheBodyStands)
+                    {
+                        std::mt19937 random(1);
+
+                        // the same pose of two people, one turned and standing elsewhere
+                        BodyFrameData frame;
+                        frame.Clear();
+                        MakeSwayingBody(0, 1, 4.0f, 0.0f, random, frame);
+
+                        BodyFrameData moved = frame;
+                        XMMATRIX transform = XMMatrixRotationY(0.6f) * XMMatrixTranslation(1.0f, 0.2f, 0.7f);
+                        for (UINT joint = 0; joint < JOINT_COUNT; ++joint)
+                        {
+                            UINT i = BodyJointIndex(0, joint);
+                            XMFLOAT3 position;
+                            XMStoreFloat3(&position, XMVector3Transform(XMVectorSet(frame.PositionX[i], frame.PositionY[i], frame.PositionZ[i], 1.0f), transform));
+                            moved.PositionX[i] = position.x;
+                            moved.PositionY[i] = position.y;
+                            moved.PositionZ[i] = position.z;
+                        }
+
+                        XMFLOAT4 features[GESTURE_BONE_COUNT];
+                        XMFLOAT4 movedFeatures[GESTURE_BONE_COUNT];
+                        ComputeGestureFeatures(frame, 0, features);
+                        ComputeGestureFeatures(moved, 0, movedFeatures);
+
+                        for (UINT bone = 0; bone < GESTURE_BONE_COUNT; ++bone)
+                        {
+                            Assert::AreEqual(features[bone].x, movedFeatures[bone].x, 1e-4f, L"x");
+                            Assert::AreEqual(features[bone].y, movedFeatures[bone].y, 1e-4f, L"y");
+                            Assert::AreEqual(features[bone].z, movedFeatures[bone].z, 1e-4f, L"z");
+                        }
+                    }
+
+                    TEST_METHOD(FindsEveryRepeat)
+                    {
+                        // a second and a half of the first body as the template
+                        std::vector<BodyFrameData> recording;
+                        MakeSwayingFrames(1, 60, 45, 1, recording);
+
+                        GestureRecognizer recognizer;
+                        Assert::AreEqual(0u, recognizer.AddTemplate(recording.data(), 45, 0, GestureTemplateParameters()), L"first template");
+
+                        // a minute of the same person with other noise, where the template comes round three times
+                        std::vector<BodyFrameData> frames;
+                        MakeSwayingFrames(1, 0, 3 * SWAY_PERIOD_FRAMES, 2, frames);
+
+                        std::vector<GestureMatch> matches;
+                        GestureMeasurement measurement;
+                        MeasureGestures(recognizer, frames, matches, &measurement);
+
+                        // the swaying is smooth enough for looser matches elsewhere, the repeat is the closest of its period
+                        for (UINT repeat = 0; repeat < 3; ++repeat)
+                        {
+                            UINT start = 60 + repeat * SWAY_PERIOD_FRAMES;
+
+                            const GestureMatch* pBest = nullptr;
+                            for (const GestureMatch& match : matches)
+                            {
+                                if (match.StartFrame / SWAY_PERIOD_FRAMES == repeat && (nullptr == pBest || match.Cost < pBest->Cost))
+                                {
+                                    pBest = &match;
+                                }
+                            }
+
+                            Assert::IsNotNull(pBest, L"a match in the period");
+                            Assert::IsTrue(abs(static_cast<int>(pBest->StartFrame - start)) <= 3, L"the repeat starts where it is");
+                            Assert::IsTrue(abs(static_cast<int>(pBest->EndFrame - (start + 44))) <= 3, L"the repeat ends where it is");
+                        }
+
+                        for (const GestureMatch& match : matches)
+                        {
+                            Assert::AreEqual(0u, match.TemplateIndex, L"template");
+                            Assert::AreEqual(static_cast<UINT64>(0x1000), match.TrackingId, L"tracking id");
+                            Assert::IsTrue(match.Cost <= GestureTemplateParameters().MaxCost, L"under the threshold");
+                        }
+
+                        recognizer.ClearTemplates();
+                        Assert::AreEqual(0u, recognizer.GetTemplateCount(), L"templates cleared");
+                        Assert::AreEqual(0u, recognizer.AddTemplate(recording.data(), 45, 0, GestureTemplateParameters()), L"indices start again");
+                    }
+
+                    TEST_METHOD(UntrackedBodiesDoNotMatch)
+                    {
+                        std::vector<BodyFrameData> recording;
+                        MakeSwayingFrames(1, 60, 45, 1, recording);
+
+                        GestureRecognizer recognizer;
+                        recognizer.AddTemplate(recording.data(), 45, 0, GestureTemplateParameters());
+
+                        // the first body leaves half way through a repeat, the others carry on
+                        std::vector<BodyFrameData> frames;
+                        MakeSwayingFrames(3, 0, SWAY_PERIOD_FRAMES, 3, frames);
+                        for (UINT i = 80; i < SWAY_PERIOD_FRAMES; ++i)
+                        {
+                            frames[i].IsTracked[0] = FALSE;
+                            frames[i].TrackingId[0] = 0;
+                        }
+
+                        std::vector<GestureMatch> matches;
+                        GestureMeasurement measurement;
+                        MeasureGestures(recognizer, frames, matches, &measurement);
+
+                        for (const GestureMatch& match : matches)
+                        {
+                            Assert::IsTrue(0 != match.BodyIndex || match.EndFrame < 80, L"nothing for a body once it is gone");
+                            Assert::AreEqual(frames[match.EndFrame].TrackingId[match.BodyIndex], match.TrackingId, L"the id of the body matched");
+                        }
+                    }
+
+                    TEST_METHOD(MeasureSixBodies)
+                    {
+                        // eight templates from the first body, searched for in six bodies over a minute
+                        std::vector<BodyFrameData> recording;
+                        MakeSwayingFrames(1, 0, 8 * 60, 1, recording);
+
+                        GestureRecognizer recognizer;
+                        for (UINT i = 0; i < 8; ++i)
+                        {
+                            recognizer.AddTemplate(&recording[i * 60], 45, 0, GestureTemplateParameters());
+                        }
+
+                        std::vector<BodyFrameData> frames;
+                        MakeSwayingFrames(BODY_COUNT, 0, 3 * SWAY_PERIOD_FRAMES, 4, frames);
+
+                        std::vector<GestureMatch> matches;
+                        GestureMeasurement measurement;
+                        MeasureGestures(recognizer, frames, matches, &measurement);
+
+                        LogMessage("%u frames of 6 bodies and 8 templates: %.1f us mean %.1f us max, %.1f%% of columns skipped, %u matches",
+                            measurement.Frames, measurement.MeanUpdateTime, measurement.MaxUpdateTime, 100.0f * measurement.SkippedFraction, measurement.Matches);
+
+                        // every template comes round three times on the first body
+                        UINT firstBody = 0;
+                        for (const GestureMatch& match : matches)
+                        {
+                            firstBody += (0 == match.BodyIndex && match.Cost < 0.01f) ? 1 : 0;
+                        }
+                        Assert::IsTrue(firstBody >= 8 * 3, L"every repeat on the first body");
+#ifdef NDEBUG
+                        Assert::IsTrue(measurement.MeanUpdateTime < 1000.0f, L"under 1 ms per frame");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
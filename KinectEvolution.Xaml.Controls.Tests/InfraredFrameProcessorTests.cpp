@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+// <copyright file="InfraredFrameProcessorTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "InfraredFrameProcessor.h"
+#include "TestHelpers.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Infrared;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                static const UINT FRAME_PIXELS = InfraredFrameProcessor::FRAME_WIDTH * InfraredFrameProcessor::FRAME_HEIGHT;
+                static const UINT FRAME_LENGTH = FRAME_PIXELS * sizeof(UINT16);
+
+                // a gradient across the frame with a bright patch that moves a little every frame
+                static void MakeFrame(UINT frameIndex, _Out_ std::vector<UINT16>& frame)
+                {
+                    frame.resize(FRAME_PIXELS);
+                    for (UINT y = 0; y < InfraredFrameProcessor::FRAME_HEIGHT; ++y)
+                    {
+                        for (UINT x = 0; x < InfraredFrameProcessor::FRAME_WIDTH; ++x)
+                        {
+                            UINT value = 1000 + 8 * x + 4 * y;
+                            if (x - 8 * frameIndex < 64 && y < 64)
+                            {
+                                value += 20000;
+                            }
+
+                            frame[y * InfraredFrameProcessor::FRAME_WIDTH + x] = static_cast<UINT16>(value);
+                        }
+                    }
+                }
+
+                TEST_CLASS(InfraredFrameProcessorTests)
+                {
+                public:
+                    TEST_METHOD(ProcessFrameToneMapsEveryFrame)
+                    {
+                        InfraredFrameProcessor^ processor = ref new InfraredFrameProcessor();
+                        Assert::AreEqual(static_cast<UINT64>(0), processor->FrameNumber, L"no frame yet");
+
+                        {
+                            InfraredImageLock lock(processor);
+                            UINT64 frameNumber = 1;
+                            Assert::IsNull(lock.AccessImage(frameNumber), L"no image before the first frame");
+                            Assert::AreEqual(static_cast<UINT64>(0), frameNumber, L"frame number with the image");
+                        }
+
+                        std::vector<UINT16> frame;
+                        MakeFrame(0, frame);
+                        Assert::IsFalse(!!processor->ProcessFrame(FRAME_LENGTH - sizeof(UINT16), frame.data()), L"short frame");
+                        Assert::IsFalse(!!processor->ProcessFrame(FRAME_LENGTH, nullptr), L"no frame");
+                        Assert::AreEqual(static_cast<UINT64>(0), processor->FrameNumber, L"nothing processed");
+
+                        // a mapper of the test's own sees the same frames with the same parameters
+                        InfraredToneParameters parameters;
+                        parameters.Mode = InfraredToneMode::Clahe;
+                        processor->SetToneParameters(parameters);
+
+                        InfraredToneMapper mapper;
+                        mapper.SetParameters(processor->GetToneParameters());
+                        std::vector<BYTE> expected(FRAME_PIXELS);
+
+                        for (UINT frameIndex = 1; frameIndex <= 5; ++frameIndex)
+                        {
+                            MakeFrame(frameIndex, frame);
+                            Assert::IsTrue(!!processor->ProcessFrame(FRAME_LENGTH, frame.data()), L"processed");
+                            mapper.Process(frame.data(), InfraredFrameProcessor::FRAME_WIDTH, InfraredFrameProcessor::FRAME_HEIGHT, expected.data(), InfraredFrameProcessor::FRAME_WIDTH);
+
+                            Assert::AreEqual(static_cast<UINT64>(frameIndex), processor->FrameNumber, L"one number per frame");
+
+                            InfraredImageLock lock(processor);
+                            UINT64 frameNumber = 0;
+                            const BYTE* pImage = lock.AccessImage(frameNumber);
+
+                            Assert::IsNotNull(pImage, L"image");
+                            Assert::AreEqual(static_cast<UINT64>(frameIndex), frameNumber, L"frame number with the image");
+                            Assert::IsTrue(0 == memcmp(expected.data(), pImage, FRAME_PIXELS), L"tone mapped image");
+                        }
+                    }
+
+                    TEST_METHOD(FrameNumberWaitsForTheImageLock)
+                    {
+                        InfraredFrameProcessor^ processor = ref new InfraredFrameProcessor();
+
+                        std::vector<UINT16> frame;
+                        MakeFrame(0, frame);
+                        Assert::IsTrue(!!processor->ProcessFrame(FRAME_LENGTH, frame.data()), L"processed");
+
+                        std::atomic<bool> read(false);
+                        std::atomic<UINT64> frameNumber(0);
+                        std::thread reader;
+                        bool readWhileLocked = false;
+
+                        {
+                            InfraredImageLock lock(processor);
+
+                            reader = std::thread([&]()
+                            {
+                                frameNumber = processor->FrameNumber;
+                                read = true;
+                            });
+
+                            // the frame number is read under the processing lock, so not while a view holds the image
+                            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                            readWhileLocked = read.load();
+                        }
+
+                        reader.join();
+                        Assert::IsFalse(readWhileLocked, L"waits for the image lock");
+                        Assert::IsTrue(read.load(), L"read once the image is released");
+                        Assert::AreEqual(static_cast<UINT64>(1), frameNumber.load(), L"frame number");
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,318 @@
+//------------------------------------------------------------------------------
+// <copyright file="InfraredToneMapperTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "InfraredToneMapper.h"
+#include "TestHelpers.h"
+
+#include <algorithm>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Infrared;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // the sensor's IR frame
+                static const UINT FRAME_WIDTH = 512;
+                static const UINT FRAME_HEIGHT = 424;
+
+                // frames tone mapped to time each mode
+                static const UINT TONE_FRAMES = 100;
+
+                // a dim room lit from the sensor: a falloff from the center, a bright near object, a few
+                // saturated reflections and sensor noise, scaled by gain
+                static void MakeInfraredFrame(UINT width, UINT height, float gain, UINT seed, _Out_ std::vector<UINT16>& frame)
+                {
+                    std::mt19937 random(seed);
+                    std::normal_distribution<float> noise(0.0f, 40.0f);
+
+                    frame.resize(width * height);
+                    for (UINT y = 0; y < height; ++y)
+                    {
+                        for (UINT x = 0; x < width; ++x)
+                        {
+                            float dx = (x - 0.5f * width) / width;
+                            float dy = (y - 0.5f * height) / height;
+                            float value = 1500.0f + 3000.0f * expf(-4.0f * (dx * dx + dy * dy));
+
+                            float ox = (x - 0.3f * width) / width;
+                            float oy = (y - 0.6f * height) / height;
+                            if (ox * ox + oy * oy < 0.01f)
+                            {
+                                value += 9000.0f;
+                            }
+
+                            value = value * gain + noise(random);
+                            if (0 == (x * 7 + y * 13) % 997)
+                            {
+                                value = 65535.0f;
+                            }
+
+                            frame[y * width + x] = static_cast<UINT16>(min(max(value, 0.0f), 65535.0f));
+                        }
+                    }
+                }
+
+                // every value from 0 to 65535 once in raster order, the rest of the frame the brightest
+                static void MakeRampFrame(_Out_ std::vector<UINT16>& frame)
+                {
+                    frame.resize(FRAME_WIDTH * FRAME_HEIGHT);
+                    for (UINT i = 0; i < frame.size(); ++i)
+                    {
+                        frame[i] = static_cast<UINT16>(min(i, 65535u));
+                    }
+                }
+
+                static InfraredToneParameters MakeParameters(InfraredToneMode mode, float smoothing)
+                {
+                    InfraredToneParameters parameters;
+                    parameters.Mode = mode;
+                    parameters.Smoothing = smoothing;
+
+                    return parameters;
+                }
+
+                // the value below which fraction of the histogram's samples lie, from every other pixel of every
+                // other row as the mapper samples
+                static UINT SampledPercentile(const std::vector<UINT16>& frame, UINT width, UINT height, float fraction)
+                {
+                    std::vector<UINT16> samples;
+                    for (UINT y = 0; y < height; y += 2)
+                    {
+                        for (UINT x = 0; x < width; x += 2)
+                        {
+                            samples.push_back(frame[y * width + x]);
+                        }
+                    }
+
+                    size_t rank = min(static_cast<size_t>(fraction * samples.size()), samples.size() - 1);
+                    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+
+                    return samples[rank];
+                }
+
+                TEST_CLASS(InfraredToneMapperTests)
+                {
+                public:
+                    TEST_METHOD(OutputIsMonotonic)
+                    {
+                        std::vector<UINT16> frame;
+                        MakeRampFrame(frame);
+
+                        const InfraredToneMode modes[] = { InfraredToneMode::FixedRamp, InfraredToneMode::AutoExposure };
+                        for (UINT m = 0; m < _countof(modes); ++m)
+                        {
+                            InfraredToneMapper mapper;
+                            mapper.SetParameters(MakeParameters(modes[m], 1.0f));
+
+                            std::vector<BYTE> output(FRAME_WIDTH * FRAME_HEIGHT);
+                            mapper.Process(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, output.data(), FRAME_WIDTH);
+
+                            for (UINT i = 1; i < 65536; ++i)
+                            {
+                                Assert::IsTrue(output[i - 1] <= output[i], L"brighter input never maps darker");
+                            }
+
+                            Assert::AreEqual(static_cast<BYTE>(0), output[0], L"black");
+                            Assert::AreEqual(static_cast<BYTE>(255), output[65535], L"white");
+                        }
+                    }
+
+                    TEST_METHOD(FixedRampIsWithinAStepOfTheGpuRamp)
+                    {
+                        std::vector<UINT16> frame;
+                        MakeRampFrame(frame);
+
+                        InfraredToneMapper mapper;
+                        mapper.SetParameters(MakeParameters(InfraredToneMode::FixedRamp, 1.0f));
+
+                        std::vector<BYTE> output(FRAME_WIDTH * FRAME_HEIGHT);
+                        mapper.Process(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, output.data(), FRAME_WIDTH);
+
+                        // the ramp texture as InfraredRenderer filled it
+                        UINT ramp[512];
+                        for (UINT i = 0; i < 512; ++i)
+                        {
+                            ramp[i] = static_cast<UINT>(min(1.0f, powf(static_cast<float>(i) / 511, 0.32f)) * 255);
+                        }
+
+                        UINT equal = 0;
+                        for (UINT v = 0; v < 65536; ++v)
+                        {
+                            // the ramp shader sampled at value * 511 / 512 + 0.5 / 512 with a point sampler
+                            UINT texel = min(static_cast<UINT>(v / 65535.0f * 511.0f + 0.5f), 511u);
+                            UINT step = ramp[min(texel + 1, 511u)] - ramp[max(texel, 1u) - 1];
+
+                            Assert::IsTrue(static_cast<UINT>(abs(static_cast<INT>(output[v]) - static_cast<INT>(ramp[texel]))) <= step, L"within a step");
+                            equal += (output[v] == ramp[texel]) ? 1 : 0;
+                        }
+
+                        LogMessage("fixed ramp equal to the GPU ramp for %u of 65536 values", equal);
+                    }
+
+                    TEST_METHOD(PercentilesSetTheBlackAndWhitePoints)
+                    {
+                        // a width that leaves a tail after the 16 pixel loads
+                        const UINT widths[] = { FRAME_WIDTH, FRAME_WIDTH - 3 };
+
+                        for (UINT w = 0; w < _countof(widths); ++w)
+                        {
+                            std::vector<UINT16> frame;
+                            MakeInfraredFrame(widths[w], FRAME_HEIGHT, 1.0f, 11, frame);
+
+                            InfraredToneMapper mapper;
+                            InfraredToneParameters parameters = MakeParameters(InfraredToneMode::AutoExposure, 0.15f);
+                            mapper.SetParameters(parameters);
+
+                            std::vector<BYTE> output(widths[w] * FRAME_HEIGHT);
+                            mapper.Process(frame.data(), widths[w], FRAME_HEIGHT, output.data(), widths[w]);
+
+                            // the first frame sets the points without smoothing, to the histogram bin of each percentile
+                            float black = static_cast<float>(SampledPercentile(frame, widths[w], FRAME_HEIGHT, parameters.BlackPercentile));
+                            float white = static_cast<float>(SampledPercentile(frame, widths[w], FRAME_HEIGHT, parameters.WhitePercentile));
+
+                            Assert::AreEqual(black, mapper.GetBlackPoint(), 16.0f, L"black point");
+                            Assert::AreEqual(white, mapper.GetWhitePoint(), 16.0f, L"white point");
+                        }
+                    }
+
+                    TEST_METHOD(ToneTableRebuiltOnlyWhenThePointsMove)
+                    {
+                        InfraredToneMapper mapper;
+                        mapper.SetParameters(MakeParameters(InfraredToneMode::AutoExposure, 0.15f));
+
+                        std::vector<UINT16> frame;
+                        std::vector<BYTE> output(FRAME_WIDTH * FRAME_HEIGHT);
+
+                        // the same scene for a second, then the gain steps up and the points follow it over a
+                        // number of frames
+                        UINT expected = 0;
+                        UINT lastBlack = 0;
+                        UINT lastWhite = 0;
+                        for (UINT frameIndex = 0; frameIndex < 90; ++frameIndex)
+                        {
+                            MakeInfraredFrame(FRAME_WIDTH, FRAME_HEIGHT, frameIndex < 30 ? 1.0f : 1.8f, 5, frame);
+                            mapper.Process(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, output.data(), FRAME_WIDTH);
+
+                            // the table is keyed on the points rounded down to a histogram bin
+                            UINT black = static_cast<UINT>(mapper.GetBlackPoint()) & ~15u;
+                            UINT white = static_cast<UINT>(mapper.GetWhitePoint()) & ~15u;
+                            if (0 == frameIndex || black != lastBlack || white != lastWhite)
+                            {
+                                ++expected;
+                            }
+
+                            lastBlack = black;
+                            lastWhite = white;
+
+                            Assert::AreEqual(expected, mapper.GetToneTableBuildCount(), L"one build per move of the points");
+                        }
+
+                        Assert::IsTrue(expected > 1, L"the gain step moved the points");
+                        Assert::IsTrue(expected < 60, L"the points settled");
+
+                        // a new gamma rebuilds the table on the next frame
+                        InfraredToneParameters parameters = MakeParameters(InfraredToneMode::AutoExposure, 0.15f);
+                        parameters.Gamma = 0.5f;
+                        mapper.SetParameters(parameters);
+                        mapper.Process(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, output.data(), FRAME_WIDTH);
+                        Assert::AreEqual(expected + 1, mapper.GetToneTableBuildCount(), L"gamma");
+
+                        // the fixed ramp is built once whatever the frames
+                        InfraredToneMapper fixed;
+                        fixed.SetParameters(MakeParameters(InfraredToneMode::FixedRamp, 0.15f));
+                        for (UINT frameIndex = 0; frameIndex < 10; ++frameIndex)
+                        {
+                            MakeInfraredFrame(FRAME_WIDTH, FRAME_HEIGHT, 1.0f + 0.1f * frameIndex, frameIndex, frame);
+                            fixed.Process(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, output.data(), FRAME_WIDTH);
+                        }
+                        Assert::AreEqual(1u, fixed.GetToneTableBuildCount(), L"fixed ramp");
+                    }
+
+                    TEST_METHOD(ClaheStaysInsideTheToneRange)
+                    {
+                        std::vector<UINT16> frame;
+                        MakeInfraredFrame(FRAME_WIDTH, FRAME_HEIGHT, 1.0f, 3, frame);
+
+                        InfraredToneMapper exposure;
+                        exposure.SetParameters(MakeParameters(InfraredToneMode::AutoExposure, 1.0f));
+                        InfraredToneMapper clahe;
+                        clahe.SetParameters(MakeParameters(InfraredToneMode::Clahe, 1.0f));
+
+                        std::vector<BYTE> exposed(FRAME_WIDTH * FRAME_HEIGHT);
+                        std::vector<BYTE> equalized(FRAME_WIDTH * FRAME_HEIGHT);
+                        exposure.Process(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, exposed.data(), FRAME_WIDTH);
+                        clahe.Process(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, equalized.data(), FRAME_WIDTH);
+
+                        // equalization spreads the dim background: more distinct levels than exposure alone
+                        bool exposedLevels[256] = {};
+                        bool equalizedLevels[256] = {};
+                        for (UINT i = 0; i < exposed.size(); ++i)
+                        {
+                            exposedLevels[exposed[i]] = true;
+                            equalizedLevels[equalized[i]] = true;
+                        }
+
+                        UINT exposedCount = static_cast<UINT>(std::count(exposedLevels, exposedLevels + 256, true));
+                        UINT equalizedCount = static_cast<UINT>(std::count(equalizedLevels, equalizedLevels + 256, true));
+                        LogMessage("distinct levels: auto exposure %u, clahe %u", exposedCount, equalizedCount);
+
+                        Assert::IsTrue(equalizedCount >= exposedCount, L"clahe keeps or adds levels");
+                        Assert::AreEqual(exposure.GetBlackPoint(), clahe.GetBlackPoint(), L"same exposure");
+                        Assert::AreEqual(exposure.GetWhitePoint(), clahe.GetWhitePoint(), L"same exposure");
+                    }
+
+                    TEST_METHOD(MeasureFrame)
+                    {
+                        std::vector<UINT16> frames[2];
+                        MakeInfraredFrame(FRAME_WIDTH, FRAME_HEIGHT, 1.0f, 1, frames[0]);
+                        MakeInfraredFrame(FRAME_WIDTH, FRAME_HEIGHT, 1.2f, 2, frames[1]);
+
+                        std::vector<BYTE> output(FRAME_WIDTH * FRAME_HEIGHT);
+
+                        const InfraredToneMode modes[] = { InfraredToneMode::FixedRamp, InfraredToneMode::AutoExposure, InfraredToneMode::Clahe };
+                        const char* names[] = { "fixed ramp", "auto exposure", "clahe" };
+                        double microseconds[_countof(modes)] = {};
+
+                        for (UINT m = 0; m < _countof(modes); ++m)
+                        {
+                            InfraredToneMapper mapper;
+                            mapper.SetParameters(MakeParameters(modes[m], 0.15f));
+
+                            // alternating frames keep the exposure moving, so the table rebuilds are timed too
+                            for (UINT frameIndex = 0; frameIndex < TONE_FRAMES; ++frameIndex)
+                            {
+                                const std::vector<UINT16>& frame = frames[(frameIndex / 10) % 2];
+
+                                LARGE_INTEGER start;
+                                LARGE_INTEGER end;
+                                QueryPerformanceCounter(&start);
+                                mapper.Process(frame.data(), FRAME_WIDTH, FRAME_HEIGHT, output.data(), FRAME_WIDTH);
+                                QueryPerformanceCounter(&end);
+
+                                microseconds[m] += GetMicroseconds(start, end);
+                            }
+
+                            microseconds[m] /= TONE_FRAMES;
+                            LogMessage("%ux%u %s: %.0f us a frame, %u table builds", FRAME_WIDTH, FRAME_HEIGHT, names[m], microseconds[m], mapper.GetToneTableBuildCount());
+                        }
+
+#ifdef NDEBUG
+                        for (UINT m = 0; m < _countof(modes); ++m)
+                        {
+                            Assert::IsTrue(microseconds[m] < 1000.0, L"tone mapping within 1 ms");
+                        }
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,193 @@
+//------------------------------------------------------------------------------
+// <copyright file="JointFilterTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "JointFilter.h"
+#include "TestHelpers.h"
+
+#include <new>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                struct JointFilterMeasurement
+                {
+                    UINT    Frames;
+                    float   MeanUpdateTime;     // microseconds to filter every body of a frame
+                    float   MaxUpdateTime;
+                    JointFilterStatistics Statistics;
+                };
+
+                // filters every frame of the store with parameters for all joints
+                static void MeasureJointFilter(
+                    const JointFilterParameters& parameters,
+                    const BodyFrameStore& store,
+                    _Out_ JointFilterMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    JointFilter filter;
+                    filter.SetParameters(parameters);
+
+                    BodyFrameData frame;
+                    double updateTime = 0.0;
+                    double maxUpdateTime = 0.0;
+
+                    for (UINT frameIndex = 0; frameIndex < store.GetFrameCount(); ++frameIndex)
+                    {
+                        store.GetFrames(frameIndex, 1, &frame);
+
+                        LARGE_INTEGER start, end;
+                        QueryPerformanceCounter(&start);
+                        filter.Update(frame);
+                        QueryPerformanceCounter(&end);
+
+                        double elapsed = GetMicroseconds(start, end);
+                        updateTime += elapsed;
+                        maxUpdateTime = max(maxUpdateTime, elapsed);
+                        pMeasurement->Frames++;
+                    }
+
+                    pMeasurement->MeanUpdateTime = (pMeasurement->Frames > 0) ? static_cast<float>(updateTime / pMeasurement->Frames) : 0.0f;
+                    pMeasurement->MaxUpdateTime = static_cast<float>(maxUpdateTime);
+                    filter.GetStatistics(&pMeasurement->Statistics);
+                }
+
+                // largest difference between the filtered joints of two filters
+                static float GetFilteredDifference(const JointFilter& first, const JointFilter& second)
+                {
+                    const BodyFrameData& a = first.GetFiltered();
+                    const BodyFrameData& b = second.GetFiltered();
+
+                    float difference = 0.0f;
+                    for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+                    {
+                        difference = max(difference, fabsf(a.PositionX[i] - b.PositionX[i]));
+                        difference = max(difference, fabsf(a.PositionY[i] - b.PositionY[i]));
+                        difference = max(difference, fabsf(a.PositionZ[i] - b.PositionZ[i]));
+                        difference = max(difference, fabsf(a.OrientationX[i] - b.OrientationX[i]));
+                        difference = max(difference, fabsf(a.OrientationY[i] - b.OrientationY[i]));
+                        difference = max(difference, fabsf(a.OrientationZ[i] - b.OrientationZ[i]));
+                        difference = max(difference, fabsf(a.OrientationW[i] - b.OrientationW[i]));
+                    }
+
+                    return difference;
+                }
+
+                TEST_CLASS(JointFilterTests)
+                {
+                public:
+                    TEST_METHOD(ConstructionDoesNotDependOnMemory)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(6, 60, 4, 0, store);
+
+                        JointFilterParameters parameters;
+                        parameters.OrientationFilter = OrientationFilterType::Slerp;
+
+                        // one filter built over zeroed memory, one over memory full of garbage
+                        std::vector<BYTE> zeroed(sizeof(JointFilter), 0x00);
+                        std::vector<BYTE> garbage(sizeof(JointFilter), 0xCD);
+                        JointFilter* pFirst = new (zeroed.data()) JointFilter();
+                        JointFilter* pSecond = new (garbage.data()) JointFilter();
+                        pFirst->SetParameters(parameters);
+                        pSecond->SetParameters(parameters);
+
+                        BodyFrameData frame;
+                        float difference = 0.0f;
+                        for (UINT frameIndex = 0; frameIndex < store.GetFrameCount(); ++frameIndex)
+                        {
+                            store.GetFrames(frameIndex, 1, &frame);
+                            pFirst->Update(frame);
+                            pSecond->Update(frame);
+                            difference = max(difference, GetFilteredDifference(*pFirst, *pSecond));
+                        }
+
+                        pFirst->~JointFilter();
+                        pSecond->~JointFilter();
+
+                        Assert::AreEqual(0.0f, difference, L"same output");
+                    }
+
+                    TEST_METHOD(ResetStartsOver)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(6, 90, 5, 0, store);
+
+                        JointFilterParameters oneEuro;
+                        oneEuro.PositionFilter = PositionFilterType::OneEuro;
+                        oneEuro.OrientationFilter = OrientationFilterType::Slerp;
+
+                        // a filter used with other parameters and reset matches a new one
+                        JointFilter used;
+                        used.SetParameters(oneEuro);
+
+                        BodyFrameData frame;
+                        for (UINT frameIndex = 0; frameIndex < 30; ++frameIndex)
+                        {
+                            store.GetFrames(frameIndex, 1, &frame);
+                            used.Update(frame);
+                        }
+
+                        used.Reset();
+                        used.SetParameters(JointFilterParameters());
+
+                        JointFilter fresh;
+                        float difference = 0.0f;
+                        for (UINT frameIndex = 30; frameIndex < store.GetFrameCount(); ++frameIndex)
+                        {
+                            store.GetFrames(frameIndex, 1, &frame);
+                            used.Update(frame);
+                            fresh.Update(frame);
+                            difference = max(difference, GetFilteredDifference(used, fresh));
+                        }
+
+                        Assert::AreEqual(0.0f, difference, L"same output");
+                    }
+
+                    TEST_METHOD(MeasureSmoothing)
+                    {
+                        // thirty seconds of six people
+                        BodyFrameStore store;
+                        RecordSwayingBodies(6, 900, 6, 0, store);
+
+                        JointFilterParameters holt;
+                        holt.OrientationFilter = OrientationFilterType::Slerp;
+
+                        JointFilterParameters oneEuro;
+                        oneEuro.PositionFilter = PositionFilterType::OneEuro;
+
+                        const JointFilterParameters* filters[] = { &holt, &oneEuro };
+                        const char* names[] = { "Holt", "One Euro" };
+
+                        for (UINT filter = 0; filter < _countof(filters); ++filter)
+                        {
+                            JointFilterMeasurement measurement;
+                            MeasureJointFilter(*filters[filter], store, &measurement);
+
+                            LogMessage("%s: %u frames, %.2f us mean %.2f us max; jitter %.2f mm raw %.2f mm filtered, lag %.1f mm",
+                                names[filter], measurement.Frames, measurement.MeanUpdateTime, measurement.MaxUpdateTime,
+                                1000.0f * measurement.Statistics.RawJitter, 1000.0f * measurement.Statistics.FilteredJitter, 1000.0f * measurement.Statistics.MeanLag);
+
+                            Assert::IsTrue(measurement.Statistics.Samples > 0, L"tracked joints measured");
+                            Assert::IsTrue(measurement.Statistics.FilteredJitter < 0.5f * measurement.Statistics.RawJitter, L"jitter at least halved");
+                            Assert::IsTrue(measurement.Statistics.MeanLag < 0.05f, L"lag under 5 cm");
+#ifdef NDEBUG
+                            Assert::IsTrue(measurement.MeanUpdateTime < 50.0f, L"6 bodies under 50 us");
+#endif
+                        }
+                    }
+                };
+
+            }
+        }
+    }
+}
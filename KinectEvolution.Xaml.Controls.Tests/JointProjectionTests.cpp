@@ -0,0 +1,160 @@
+//------------------------------------------------------------------------------
+// <copyright file="JointProjectionTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "JointProjection.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // one point through the camera without any vector math, as a mapper would place it
+                static XMFLOAT2 ProjectPoint(const CameraModel& camera, const XMFLOAT3& point)
+                {
+                    const XMFLOAT3X3& r = camera.Rotation;
+                    XMFLOAT3 p(
+                        r._11 * point.x + r._12 * point.y + r._13 * point.z + camera.Translation.x,
+                        r._21 * point.x + r._22 * point.y + r._23 * point.z + camera.Translation.y,
+                        r._31 * point.x + r._32 * point.y + r._33 * point.z + camera.Translation.z);
+
+                    float nx = p.x / p.z;
+                    float ny = -p.y / p.z;
+                    float r2 = nx * nx + ny * ny;
+                    float distortion = 1.0f + r2 * (camera.RadialDistortion2 + r2 * (camera.RadialDistortion4 + r2 * camera.RadialDistortion6));
+
+                    return XMFLOAT2(camera.FocalLengthX * nx * distortion + camera.PrincipalPointX, camera.FocalLengthY * ny * distortion + camera.PrincipalPointY);
+                }
+
+                // three swaying bodies, the second one gone
+                static void MakeBodies(_Out_ BodyFrameData& frame)
+                {
+                    std::mt19937 random(1);
+
+                    frame.Clear();
+                    for (UINT bodyIndex = 0; bodyIndex < 3; ++bodyIndex)
+                    {
+                        MakeSwayingBody(bodyIndex, 0x1000 + bodyIndex, 2.0f, 0.003f, random, frame);
+                    }
+
+                    frame.IsTracked[1] = FALSE;
+                }
+
+                TEST_CLASS(JointProjectionTests)
+                {
+                public:
+                    TEST_METHOD(ProjectMatchesThePinhole)
+                    {
+                        BodyFrameData frame;
+                        MakeBodies(frame);
+
+                        CameraModel camera = CameraModel::GetDefault(Body2DMode::DepthIR);
+                        XMStoreFloat3x3(&camera.Rotation, XMMatrixRotationY(0.05f));
+                        camera.Translation = XMFLOAT3(0.01f, -0.02f, 0.03f);
+
+                        JointProjection projection;
+                        projection.SetCamera(camera);
+                        projection.Project(frame);
+
+                        for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+                        {
+                            UINT bodyIndex = i / JOINT_COUNT;
+                            Assert::AreEqual(!!frame.IsTracked[bodyIndex], !!projection.IsValid(bodyIndex, i % JOINT_COUNT), L"valid where tracked");
+                            if (!frame.IsTracked[bodyIndex])
+                            {
+                                continue;
+                            }
+
+                            XMFLOAT2 pixel = ProjectPoint(camera, XMFLOAT3(frame.PositionX[i], frame.PositionY[i], frame.PositionZ[i]));
+                            Assert::AreEqual(pixel.x, projection.GetPixelX()[i], 0.01f, L"x");
+                            Assert::AreEqual(pixel.y, projection.GetPixelY()[i], 0.01f, L"y");
+                        }
+                    }
+
+                    TEST_METHOD(FitRecoversTheColorCamera)
+                    {
+                        CameraModel camera = CameraModel::GetDefault(Body2DMode::Color);
+                        camera.FocalLengthX = 1050.0f;
+                        camera.FocalLengthY = 1062.0f;
+                        camera.PrincipalPointX = 971.0f;
+                        camera.PrincipalPointY = 528.0f;
+                        camera.Translation = XMFLOAT3(0.048f, 0.004f, 0.0f);
+
+                        // a grid at several depths, with a point the mapper could not place
+                        std::vector<XMFLOAT3> points;
+                        std::vector<XMFLOAT2> pixels;
+                        for (UINT i = 0; i < 5 * 5 * 4; ++i)
+                        {
+                            points.push_back(XMFLOAT3(-1.5f + 0.75f * (i % 5), -1.0f + 0.5f * ((i / 5) % 5), 1.0f + i / 25));
+                            pixels.push_back(ProjectPoint(camera, points.back()));
+                        }
+
+                        points.push_back(XMFLOAT3(0.0f, 0.0f, 2.0f));
+                        pixels.push_back(XMFLOAT2(-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()));
+
+                        CameraModel fitted;
+                        Assert::IsTrue(CameraModel::Fit(points.data(), pixels.data(), static_cast<UINT>(points.size()), 1920, 1080, &fitted), L"fitted");
+                        Assert::AreEqual(camera.FocalLengthX, fitted.FocalLengthX, 0.1f, L"fx");
+                        Assert::AreEqual(camera.FocalLengthY, fitted.FocalLengthY, 0.1f, L"fy");
+                        Assert::AreEqual(camera.PrincipalPointX, fitted.PrincipalPointX, 0.1f, L"cx");
+                        Assert::AreEqual(camera.PrincipalPointY, fitted.PrincipalPointY, 0.1f, L"cy");
+                        Assert::AreEqual(camera.Translation.x, fitted.Translation.x, 1e-4f, L"tx");
+                        Assert::AreEqual(camera.Translation.y, fitted.Translation.y, 1e-4f, L"ty");
+                        Assert::AreEqual(1920u, fitted.Width, L"width");
+
+                        // every depth the same, the translation cannot be told from the principal point
+                        for (XMFLOAT3& point : points)
+                        {
+                            point.z = 2.0f;
+                        }
+                        Assert::IsFalse(CameraModel::Fit(points.data(), pixels.data(), static_cast<UINT>(points.size()), 1920, 1080, &fitted), L"one depth");
+                        Assert::IsFalse(CameraModel::Fit(points.data(), pixels.data(), 5, 1920, 1080, &fitted), L"too few points");
+                    }
+
+                    TEST_METHOD(MappedPixelsAreCompared)
+                    {
+                        BodyFrameData frame;
+                        MakeBodies(frame);
+
+                        JointProjection projection;
+                        projection.SetCamera(CameraModel::GetDefault(Body2DMode::DepthIR));
+                        projection.Project(frame);
+
+                        // the mapper agrees except for one joint 5 pixels away and one it cannot map
+                        std::vector<XMFLOAT2> pixels(BODY_JOINT_COUNT);
+                        for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+                        {
+                            pixels[i] = XMFLOAT2(projection.GetPixelX()[i], projection.GetPixelY()[i]);
+                        }
+
+                        UINT moved = BodyJointIndex(2, 7);
+                        UINT lost = BodyJointIndex(0, 3);
+                        pixels[moved].x += 3.0f;
+                        pixels[moved].y += 4.0f;
+                        pixels[lost].x = std::numeric_limits<float>::infinity();
+
+                        JointProjection mapped;
+                        mapped.SetPixels(frame, pixels.data());
+
+                        Assert::AreEqual(5.0f, projection.GetMaxDistance(mapped), 1e-3f, L"the moved joint");
+                        Assert::IsFalse(!!mapped.IsValid(0, 3), L"unmapped joint invalid");
+                        Assert::IsFalse(!!mapped.IsValid(1, 0), L"untracked body invalid");
+                        Assert::IsTrue(!!mapped.IsValid(2, 7), L"mapped joint valid");
+
+                        pixels[moved] = XMFLOAT2(projection.GetPixelX()[moved], projection.GetPixelY()[moved]);
+                        mapped.SetPixels(frame, pixels.data());
+                        Assert::AreEqual(0.0f, projection.GetMaxDistance(mapped), 1e-3f, L"in agreement");
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,321 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseIndexTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "PoseIndex.h"
+#include "PoseIndexThread.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // frames decoded at once from the store while measuring
+                static const UINT MEASURE_BATCH_FRAMES = 256;
+
+                struct PoseIndexMeasurement
+                {
+                    UINT    Frames;
+                    UINT    Queries;            // one per tracked body
+                    float   Recall;             // fraction of the exact k nearest found
+                    float   MeanFrameTime;      // microseconds to search every body of a frame
+                    float   MaxFrameTime;
+                    float   MeanExactTime;      // microseconds of the linear scan the recall is against, per body
+                    float   MeanDistances;      // distance evaluations per query
+                };
+
+                // searches the index with every tracked body in a range of recorded frames
+                static void MeasurePoseIndex(
+                    _Inout_ PoseIndex& index,
+                    const BodyFrameStore& store,
+                    UINT firstFrame,
+                    UINT frameCount,
+                    UINT k,
+                    _Out_ PoseIndexMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    std::vector<BodyFrameData> frames(min(frameCount, MEASURE_BATCH_FRAMES));
+                    std::vector<PoseMatch> approximate[BODY_COUNT];
+                    std::vector<PoseMatch> exact;
+
+                    double frameTime = 0.0;
+                    double maxFrameTime = 0.0;
+                    double exactTime = 0.0;
+                    UINT64 found = 0;
+                    UINT64 expected = 0;
+                    UINT64 distances = 0;
+
+                    for (UINT batch = 0; batch < frameCount; batch += MEASURE_BATCH_FRAMES)
+                    {
+                        UINT batchFrames = min(frameCount - batch, MEASURE_BATCH_FRAMES);
+                        store.GetFrames(firstFrame + batch, batchFrames, frames.data());
+
+                        for (UINT i = 0; i < batchFrames; ++i)
+                        {
+                            UINT64 distanceCount = index.GetDistanceCount();
+
+                            LARGE_INTEGER start, end;
+                            QueryPerformanceCounter(&start);
+                            index.SearchFrame(frames[i], k, approximate);
+                            QueryPerformanceCounter(&end);
+
+                            double elapsed = GetMicroseconds(start, end);
+                            frameTime += elapsed;
+                            maxFrameTime = max(maxFrameTime, elapsed);
+                            distances += index.GetDistanceCount() - distanceCount;
+                            ++pMeasurement->Frames;
+
+                            for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                            {
+                                if (approximate[bodyIndex].empty())
+                                {
+                                    continue;
+                                }
+
+                                XMFLOAT4 features[POSE_FEATURE_COUNT];
+                                ComputeGestureFeatures(frames[i], bodyIndex, features);
+
+                                QueryPerformanceCounter(&start);
+                                index.SearchExact(features, k, exact);
+                                QueryPerformanceCounter(&end);
+                                exactTime += GetMicroseconds(start, end);
+
+                                // found only as the same pose, SearchExact breaks ties by pose id as Search does
+                                for (const PoseMatch& match : exact)
+                                {
+                                    bool hit = false;
+                                    for (const PoseMatch& candidate : approximate[bodyIndex])
+                                    {
+                                        hit = hit || candidate.PoseId == match.PoseId;
+                                    }
+                                    found += hit ? 1 : 0;
+                                }
+                                expected += exact.size();
+
+                                ++pMeasurement->Queries;
+                            }
+                        }
+                    }
+
+                    if (0 == pMeasurement->Queries)
+                    {
+                        return;
+                    }
+
+                    double queries = static_cast<double>(pMeasurement->Queries);
+                    pMeasurement->Recall = static_cast<float>(static_cast<double>(found) / static_cast<double>(max(1ull, expected)));
+                    pMeasurement->MeanFrameTime = static_cast<float>(frameTime / pMeasurement->Frames);
+                    pMeasurement->MaxFrameTime = static_cast<float>(maxFrameTime);
+                    pMeasurement->MeanExactTime = static_cast<float>(exactTime / queries);
+                    pMeasurement->MeanDistances = static_cast<float>(static_cast<double>(distances) / queries);
+                }
+
+                // every tracked body of frames [firstFrame, firstFrame + frameCount) of the store
+                static UINT IndexRecording(const BodyFrameStore& store, UINT firstFrame, UINT frameCount, _Inout_ PoseIndex& index)
+                {
+                    std::vector<BodyFrameData> frames(MEASURE_BATCH_FRAMES);
+                    UINT added = 0;
+
+                    for (UINT batch = 0; batch < frameCount; batch += MEASURE_BATCH_FRAMES)
+                    {
+                        UINT batchFrames = min(frameCount - batch, MEASURE_BATCH_FRAMES);
+                        store.GetFrames(firstFrame + batch, batchFrames, frames.data());
+
+                        for (UINT i = 0; i < batchFrames; ++i)
+                        {
+                            for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                            {
+                                added += index.AddPose(frames[i], bodyIndex, firstFrame + batch + i) ? 1 : 0;
+                            }
+                        }
+                    }
+
+                    return added;
+                }
+
+                // the poses of bodyCount swaying bodies over frameCount frames, added straight to the index without
+                // keeping the frames; returns the seconds it took
+                static double IndexSwayingBodies(UINT bodyCount, UINT frameCount, UINT seed, _Inout_ PoseIndex& index)
+                {
+                    std::mt19937 random(seed);
+                    BodyFrameData frame;
+                    frame.Clear();
+
+                    LARGE_INTEGER start, end;
+                    QueryPerformanceCounter(&start);
+
+                    for (UINT frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+                    {
+                        for (UINT bodyIndex = 0; bodyIndex < bodyCount; ++bodyIndex)
+                        {
+                            MakeSwayingBody(bodyIndex, 0x1000 + bodyIndex, frameIndex / 30.0f, 0.003f, random, frame);
+                            index.AddPose(frame, bodyIndex, frameIndex);
+                        }
+                    }
+
+                    QueryPerformanceCounter(&end);
+                    return GetMicroseconds(start, end) / 1e6;
+                }
+
+                TEST_CLASS(PoseIndexTests)
+                {
+                public:
+                    TEST_METHOD(FindsTheSamePose)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(6, 300, 1, 0, store);
+
+                        PoseIndex index;
+                        index.Reset(PoseIndexParameters());
+                        Assert::AreEqual(6u * 300u, IndexRecording(store, 0, 300, index), L"every body indexed");
+
+                        // a stored pose is its own nearest
+                        BodyFrameData frame;
+                        store.GetFrames(123, 1, &frame);
+
+                        std::vector<PoseMatch> matches[BODY_COUNT];
+                        index.SearchFrame(frame, 1, matches);
+                        for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                        {
+                            Assert::AreEqual(static_cast<size_t>(1), matches[bodyIndex].size(), L"one match");
+                            Assert::AreEqual(0.0f, matches[bodyIndex][0].Distance, 1e-3f, L"same pose");
+                        }
+                    }
+
+                    TEST_METHOD(UntrackedBodiesGetNoMatches)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(2, 100, 2, 0, store);
+
+                        PoseIndex index;
+                        index.Reset(PoseIndexParameters());
+                        IndexRecording(store, 0, 100, index);
+
+                        BodyFrameData frame;
+                        store.GetFrames(50, 1, &frame);
+
+                        std::vector<PoseMatch> matches[BODY_COUNT];
+                        index.SearchFrame(frame, 5, matches);
+                        for (UINT bodyIndex = 2; bodyIndex < BODY_COUNT; ++bodyIndex)
+                        {
+                            Assert::IsTrue(matches[bodyIndex].empty(), L"no matches for an untracked body");
+                        }
+                    }
+
+                    TEST_METHOD(IndexesOnItsOwnThread)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(6, 300, 11, 0, store);
+
+                        PoseIndex index;
+                        index.Reset(PoseIndexParameters());
+                        IndexRecording(store, 0, 300, index);
+
+                        // handed over as the panel does, a search and then the frame to index
+                        PoseIndexThread thread;
+                        thread.Start(PoseIndexParameters(), 4);
+
+                        BodyFrameData frame;
+                        for (UINT frameIndex = 0; frameIndex < 300; ++frameIndex)
+                        {
+                            store.GetFrames(frameIndex, 1, &frame);
+                            thread.Search(frame);
+                            thread.Index(frame, frameIndex);
+                        }
+
+                        // searches go ahead of the queued frames, so this one waits for them
+                        thread.WaitIdle();
+                        store.GetFrames(123, 1, &frame);
+                        thread.Search(frame);
+                        thread.WaitIdle();
+
+                        PoseIndexThreadStatistics statistics;
+                        thread.GetStatistics(&statistics);
+                        Assert::AreEqual(static_cast<UINT64>(300), statistics.FramesIndexed, L"every frame indexed");
+                        Assert::AreEqual(static_cast<UINT64>(0), statistics.FramesDropped, L"none dropped");
+                        Assert::AreEqual(6u * 300u, statistics.PoseCount, L"every body indexed");
+                        Assert::AreEqual(static_cast<UINT64>(301), statistics.FramesSearched + statistics.SearchesReplaced, L"every search taken or replaced");
+
+                        // inserted in the same order, so the same graph as built here
+                        std::vector<PoseMatch> expected[BODY_COUNT];
+                        index.SearchFrame(frame, 4, expected);
+
+                        std::vector<PoseMatch> matches;
+                        for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                        {
+                            thread.GetMatches(bodyIndex, matches);
+                            Assert::AreEqual(expected[bodyIndex].size(), matches.size(), L"match count");
+                            for (size_t i = 0; i < matches.size(); ++i)
+                            {
+                                Assert::AreEqual(expected[bodyIndex][i].PoseId, matches[i].PoseId, L"same matches");
+                            }
+                        }
+
+                        thread.Stop();
+                        thread.Index(frame, 300);
+                        Assert::AreEqual(6u * 300u, thread.GetIndex().GetPoseCount(), L"nothing taken once stopped");
+                    }
+
+                    TEST_METHOD(MeasureRecordedPoses)
+                    {
+                        // over three minutes of six people to index, ten seconds of others to search with
+                        BodyFrameStore recording;
+                        RecordSwayingBodies(6, 6000, 7, 0, recording);
+
+                        PoseIndex index;
+                        index.Reset(PoseIndexParameters());
+                        UINT poses = IndexRecording(recording, 0, 6000, index);
+
+                        BodyFrameStore live;
+                        RecordSwayingBodies(6, 300, 8, 0, live);
+
+                        PoseIndexMeasurement measurement;
+                        MeasurePoseIndex(index, live, 0, 300, 10, &measurement);
+
+                        LogMessage("%u poses, %u queries: recall@10 %.4f, %.1f us per frame of 6 bodies, slowest %.1f us, exact scan %.1f us per body, %.0f distances per query",
+                            poses, measurement.Queries, measurement.Recall, measurement.MeanFrameTime, measurement.MaxFrameTime, measurement.MeanExactTime, measurement.MeanDistances);
+
+                        Assert::AreEqual(6u * 300u, measurement.Queries, L"every body searched");
+                        Assert::IsTrue(measurement.Recall > 0.95f, L"recall@10 over 0.95");
+#ifdef NDEBUG
+                        Assert::IsTrue(measurement.MeanFrameTime < 1000.0f, L"6 bodies under 1 ms");
+#endif
+                    }
+
+                    TEST_METHOD(MeasureMillionPoses)
+                    {
+                        // over an hour and a half of six people, a little over a million poses
+                        PoseIndex index;
+                        index.Reset(PoseIndexParameters());
+                        double buildTime = IndexSwayingBodies(6, 170000, 9, index);
+
+                        BodyFrameStore live;
+                        RecordSwayingBodies(6, 100, 10, 0, live);
+
+                        PoseIndexMeasurement measurement;
+                        MeasurePoseIndex(index, live, 0, 100, 10, &measurement);
+
+                        LogMessage("%u poses in %.1f s, %.0f us each, %.0f MB: recall@10 %.4f, %.1f us per frame of 6 bodies, slowest %.1f us, exact scan %.1f us per body, %.0f distances per query",
+                            index.GetPoseCount(), buildTime, 1e6 * buildTime / index.GetPoseCount(), index.GetStorageSize() / 1048576.0,
+                            measurement.Recall, measurement.MeanFrameTime, measurement.MaxFrameTime, measurement.MeanExactTime, measurement.MeanDistances);
+
+                        Assert::AreEqual(6u * 170000u, index.GetPoseCount(), L"every body indexed");
+                        Assert::IsTrue(measurement.Recall > 0.95f, L"recall@10 over 0.95");
+#ifdef NDEBUG
+                        Assert::IsTrue(measurement.MeanFrameTime < 1000.0f, L"6 bodies under 1 ms");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
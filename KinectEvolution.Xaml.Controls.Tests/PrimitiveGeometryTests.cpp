@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+// <copyright file="PrimitiveGeometryTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "PrimitiveGeometry.h"
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Base;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                typedef std::array<float, 7> VertexKey;
+                typedef std::array<VertexKey, 3> TriangleKey;
+
+                // the shapes as GetPrimitiveGeometry makes its default ones
+                static const float CONE_RADIUS = 0.3f;
+                static const float PYRAMID_SIZE = 1.0f;
+
+                static VertexKey GetVertexKey(const PrimitiveVertex& vertex)
+                {
+                    VertexKey key = { vertex._x, vertex._y, vertex._z, vertex._nx, vertex._ny, vertex._nz, static_cast<float>(vertex._color) };
+                    return key;
+                }
+
+                // every triangle by its vertices, each started at its smallest so the winding is kept, sorted
+                static std::vector<TriangleKey> GetTriangles(const PrimitiveGeometry& geometry)
+                {
+                    std::vector<TriangleKey> triangles;
+                    for (size_t i = 0; i + 2 < geometry.Indices.size(); i += 3)
+                    {
+                        TriangleKey triangle;
+                        for (UINT corner = 0; corner < 3; ++corner)
+                        {
+                            triangle[corner] = GetVertexKey(geometry.Vertices[geometry.Indices[i + corner]]);
+                        }
+
+                        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+                        triangles.push_back(triangle);
+                    }
+
+                    std::sort(triangles.begin(), triangles.end());
+                    return triangles;
+                }
+
+                static void Generate(DefaultPrimitive primitiveType, UINT segments, _Out_ PrimitiveGeometry* pGeometry)
+                {
+                    switch (primitiveType)
+                    {
+                    case DefaultPrimitive::Cube:
+                        GenerateCube(pGeometry);
+                        break;
+                    case DefaultPrimitive::Sphere:
+                        GenerateSphere(segments, pGeometry);
+                        break;
+                    case DefaultPrimitive::Cylinder:
+                        GenerateCylinder(segments, pGeometry);
+                        break;
+                    case DefaultPrimitive::Cone:
+                        GenerateCone(CONE_RADIUS, segments, pGeometry);
+                        break;
+                    default:
+                        GeneratePyramid(PYRAMID_SIZE, pGeometry);
+                        break;
+                    }
+                }
+
+                TEST_CLASS(PrimitiveGeometryTests)
+                {
+                public:
+                    TEST_METHOD(OptimizingKeepsTheTriangles)
+                    {
+                        for (UINT type = 0; type < static_cast<UINT>(DefaultPrimitive::Count); ++type)
+                        {
+                            for (UINT lod = 0; lod < PRIMITIVE_LOD_COUNT; ++lod)
+                            {
+                                PrimitiveGeometry generated;
+                                Generate(static_cast<DefaultPrimitive>(type), PrimitiveLodSegments[lod], &generated);
+
+                                const PrimitiveGeometry& optimized = GetPrimitiveGeometry(static_cast<DefaultPrimitive>(type), lod);
+                                Assert::AreEqual(generated.GetTriangleCount(), optimized.GetTriangleCount(), L"triangle count");
+                                Assert::IsTrue(GetTriangles(generated) == GetTriangles(optimized), L"same triangles, same winding");
+
+                                // vertices in the order the triangles first use them, none left over
+                                UINT16 next = 0;
+                                for (UINT16 index : optimized.Indices)
+                                {
+                                    Assert::IsTrue(index <= next, L"vertices in order of first use");
+                                    next = max(next, static_cast<UINT16>(index + 1));
+                                }
+                                Assert::AreEqual(optimized.Vertices.size(), static_cast<size_t>(next), L"every vertex used");
+                            }
+                        }
+                    }
+
+                    TEST_METHOD(OptimizingNeverMissesMore)
+                    {
+                        for (UINT type = 0; type < static_cast<UINT>(DefaultPrimitive::Count); ++type)
+                        {
+                            for (UINT lod = 0; lod < PRIMITIVE_LOD_COUNT; ++lod)
+                            {
+                                const PrimitiveGeometry& geometry = GetPrimitiveGeometry(static_cast<DefaultPrimitive>(type), lod);
+                                Assert::IsTrue(geometry.MissRatio <= geometry.GeneratedMissRatio, L"no worse than generated");
+                                Assert::IsTrue(geometry.MissRatio >= 0.5f && geometry.MissRatio <= 3.0f, L"between 0.5 and 3");
+                            }
+                        }
+
+                        const PrimitiveGeometry& sphere = GetPrimitiveGeometry(DefaultPrimitive::Sphere, 0);
+                        LogMessage("finest sphere: %.2f vertices per triangle as generated, %.2f optimized", sphere.GeneratedMissRatio, sphere.MissRatio);
+                        Assert::IsTrue(sphere.MissRatio < 0.9f * sphere.GeneratedMissRatio, L"the finest sphere gains");
+                    }
+
+                    TEST_METHOD(EachShapeIsBuiltOnce)
+                    {
+                        const PrimitiveGeometry* pSphere = &GetPrimitiveGeometry(DefaultPrimitive::Sphere, 1);
+                        Assert::IsTrue(pSphere == &GetPrimitiveGeometry(DefaultPrimitive::Sphere, 1), L"the same level again");
+                        Assert::IsTrue(pSphere == &GetPrimitiveGeometry(DefaultPrimitive::Sphere, PrimitiveLodSegments[1], 0.0f), L"the level by its segments");
+                        Assert::IsTrue(pSphere == &GetPrimitiveGeometry(DefaultPrimitive::Sphere, PrimitiveLodSegments[1], 2.0f), L"a sphere has no size");
+                        Assert::IsTrue(pSphere != &GetPrimitiveGeometry(DefaultPrimitive::Sphere, 0), L"another level");
+
+                        // the cube has one shape at every level
+                        Assert::IsTrue(&GetPrimitiveGeometry(DefaultPrimitive::Cube, 0) == &GetPrimitiveGeometry(DefaultPrimitive::Cube, 2), L"one cube");
+                        Assert::IsTrue(&GetPrimitiveGeometry(DefaultPrimitive::Pyramid, 0) == &GetPrimitiveGeometry(DefaultPrimitive::Pyramid, 7, PYRAMID_SIZE), L"one pyramid");
+
+                        const PrimitiveGeometry& wide = GetPrimitiveGeometry(DefaultPrimitive::Cone, 9, 0.5f);
+                        Assert::IsTrue(&wide == &GetPrimitiveGeometry(DefaultPrimitive::Cone, 9, 0.5f), L"the same cone again");
+                        Assert::IsTrue(&wide != &GetPrimitiveGeometry(DefaultPrimitive::Cone, 9, CONE_RADIUS), L"another radius");
+
+                        PrimitiveGeometry generated;
+                        GenerateCone(0.5f, 9, &generated);
+                        Assert::IsTrue(GetTriangles(generated) == GetTriangles(wide), L"the cone asked for");
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,344 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonBroadcasterTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SkeletonBroadcaster.h"
+#include "TestHelpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace Concurrency;
+using namespace Platform;
+using namespace Windows::Foundation;
+using namespace Windows::Networking;
+using namespace Windows::Networking::Sockets;
+using namespace Windows::Storage::Streams;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // away from the panel's default, so a running app does not get in the way
+                static const USHORT LOOPBACK_PORT = 8531;
+
+                static const UINT TCP_SUBSCRIBERS = 10;
+                static const UINT UDP_SUBSCRIBERS = 10;
+                static const UINT FRAME_COUNT = 150;        // 5 s at 30 fps
+                static const UINT READ_BUFFER_SIZE = 4096;
+
+                // one subscriber's end, shared with its socket callbacks
+                struct LoopbackSubscriber
+                {
+                    critical_section        Lock;
+                    SkeletonWireDecoder     Decoder;
+                    std::vector<BYTE>       Pending;        // TCP bytes short of a whole frame
+                    std::vector<double>     Latencies;      // microseconds from Publish to decoded
+                    UINT                    Decoded;
+                    UINT                    Failed;
+                    IOutputStream^          Acknowledge;    // UDP subscribers acknowledge what they decode
+
+                    LoopbackSubscriber()
+                        : Decoded(0)
+                        , Failed(0)
+                    {
+                    }
+                };
+
+                static IBuffer^ ToBuffer(_In_reads_bytes_(size) const void* pBytes, UINT size)
+                {
+                    DataWriter^ writer = ref new DataWriter();
+                    writer->WriteBytes(ArrayReference<BYTE>(static_cast<BYTE*>(const_cast<void*>(pBytes)), size));
+                    return writer->DetachBuffer();
+                }
+
+                static void SendDatagram(IOutputStream^ output, BYTE type, UINT sequence)
+                {
+                    SkeletonWireDatagram datagram = { SKELETON_WIRE_MAGIC, type, 0, sequence };
+
+                    // a missing acknowledgement only means a larger delta, a closed socket throws on the write itself
+                    try
+                    {
+                        create_task(output->WriteAsync(ToBuffer(&datagram, sizeof(datagram)))).then([](task<UINT> writeTask)
+                        {
+                            try
+                            {
+                                writeTask.get();
+                            }
+                            catch (Exception^)
+                            {
+                            }
+                        });
+                    }
+                    catch (Exception^)
+                    {
+                    }
+                }
+
+                // under the subscriber's lock. the publish time travels in the frame's RelativeTime as a performance
+                // counter reading
+                static void ReceiveFrame(_Inout_ LoopbackSubscriber& subscriber, _In_reads_bytes_(size) const BYTE* pBytes, UINT size)
+                {
+                    LARGE_INTEGER received;
+                    QueryPerformanceCounter(&received);
+
+                    if (!subscriber.Decoder.Decode(pBytes, size))
+                    {
+                        ++subscriber.Failed;
+                        return;
+                    }
+
+                    LARGE_INTEGER published;
+                    published.QuadPart = subscriber.Decoder.GetFrame().RelativeTime;
+                    subscriber.Latencies.push_back(GetMicroseconds(published, received));
+                    ++subscriber.Decoded;
+
+                    if (nullptr != subscriber.Acknowledge)
+                    {
+                        SendDatagram(subscriber.Acknowledge, SKELETON_WIRE_ACK, subscriber.Decoder.GetFrame().Sequence);
+                    }
+                }
+
+                // frames come back to back over TCP, each header gives its size
+                static void ReceiveStream(std::shared_ptr<LoopbackSubscriber> subscriber, StreamSocket^ socket)
+                {
+                    Buffer^ buffer = ref new Buffer(READ_BUFFER_SIZE);
+
+                    create_task(socket->InputStream->ReadAsync(buffer, READ_BUFFER_SIZE, InputStreamOptions::Partial)).then(
+                        [subscriber, socket](task<IBuffer^> readTask)
+                    {
+                        IBuffer^ read = nullptr;
+                        try
+                        {
+                            read = readTask.get();
+                        }
+                        catch (Exception^)
+                        {
+                        }
+
+                        if (nullptr == read || 0 == read->Length)
+                        {
+                            return;
+                        }
+
+                        {
+                            critical_section::scoped_lock lock(subscriber->Lock);
+
+                            std::vector<BYTE>& pending = subscriber->Pending;
+                            size_t offset = pending.size();
+                            pending.resize(offset + read->Length);
+                            DataReader::FromBuffer(read)->ReadBytes(ArrayReference<BYTE>(pending.data() + offset, read->Length));
+
+                            UINT consumed = 0;
+                            UINT size = static_cast<UINT>(pending.size());
+                            SkeletonWireHeader header;
+                            while (ReadSkeletonFrameHeader(pending.data() + consumed, size - consumed, &header) && header.Size <= size - consumed)
+                            {
+                                ReceiveFrame(*subscriber, pending.data() + consumed, header.Size);
+                                consumed += header.Size;
+                            }
+
+                            pending.erase(pending.begin(), pending.begin() + consumed);
+                        }
+
+                        ReceiveStream(subscriber, socket);
+                    });
+                }
+
+                static StreamSocket^ ConnectStream(std::shared_ptr<LoopbackSubscriber> subscriber)
+                {
+                    StreamSocket^ socket = ref new StreamSocket();
+                    socket->Control->NoDelay = true;
+                    create_task(socket->ConnectAsync(ref new HostName("127.0.0.1"), ref new String(std::to_wstring(LOOPBACK_PORT).c_str()))).get();
+
+                    ReceiveStream(subscriber, socket);
+                    return socket;
+                }
+
+                static DatagramSocket^ ConnectDatagrams(std::shared_ptr<LoopbackSubscriber> subscriber)
+                {
+                    DatagramSocket^ socket = ref new DatagramSocket();
+                    socket->MessageReceived += ref new TypedEventHandler<DatagramSocket^, DatagramSocketMessageReceivedEventArgs^>(
+                        [subscriber](DatagramSocket^, DatagramSocketMessageReceivedEventArgs^ args)
+                    {
+                        std::vector<BYTE> bytes;
+                        try
+                        {
+                            DataReader^ reader = args->GetDataReader();
+                            bytes.resize(reader->UnconsumedBufferLength);
+                            if (bytes.empty())
+                            {
+                                return;
+                            }
+
+                            reader->ReadBytes(ArrayReference<BYTE>(bytes.data(), static_cast<UINT>(bytes.size())));
+                        }
+                        catch (Exception^)
+                        {
+                            return;
+                        }
+
+                        critical_section::scoped_lock lock(subscriber->Lock);
+                        ReceiveFrame(*subscriber, bytes.data(), static_cast<UINT>(bytes.size()));
+                    });
+
+                    create_task(socket->ConnectAsync(ref new HostName("127.0.0.1"), ref new String(std::to_wstring(LOOPBACK_PORT).c_str()))).get();
+
+                    subscriber->Acknowledge = socket->OutputStream;
+                    SendDatagram(socket->OutputStream, SKELETON_WIRE_SUBSCRIBE, 0);
+                    return socket;
+                }
+
+                // polls until done returns true, false when the time runs out first
+                template <typename Predicate>
+                static bool WaitFor(Predicate done, UINT milliseconds)
+                {
+                    ULONGLONG deadline = GetTickCount64() + milliseconds;
+                    while (!done())
+                    {
+                        if (GetTickCount64() > deadline)
+                        {
+                            return false;
+                        }
+
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    }
+
+                    return true;
+                }
+
+                TEST_CLASS(SkeletonBroadcasterTests)
+                {
+                public:
+                    TEST_METHOD(LoopbackSubscribersGetEveryFrame)
+                    {
+                        SkeletonBroadcasterParameters parameters;
+                        parameters.TcpPort = LOOPBACK_PORT;
+                        parameters.UdpPort = LOOPBACK_PORT;
+
+                        SkeletonBroadcaster broadcaster;
+                        Assert::IsTrue(broadcaster.Start(parameters), L"bound");
+
+                        std::vector<std::shared_ptr<LoopbackSubscriber>> subscribers;
+                        std::vector<StreamSocket^> streamSockets;
+                        std::vector<DatagramSocket^> datagramSockets;
+
+                        for (UINT i = 0; i < TCP_SUBSCRIBERS; ++i)
+                        {
+                            subscribers.push_back(std::make_shared<LoopbackSubscriber>());
+                            streamSockets.push_back(ConnectStream(subscribers.back()));
+                        }
+
+                        for (UINT i = 0; i < UDP_SUBSCRIBERS; ++i)
+                        {
+                            subscribers.push_back(std::make_shared<LoopbackSubscriber>());
+                            datagramSockets.push_back(ConnectDatagrams(subscribers.back()));
+                        }
+
+                        bool subscribed = WaitFor([&]()
+                        {
+                            return broadcaster.GetSubscriberCount() == TCP_SUBSCRIBERS + UDP_SUBSCRIBERS;
+                        }, 5000);
+
+                        // six people at the sensor's 30 fps
+                        std::mt19937 random(19);
+                        BodyFrameData frame;
+                        auto next = std::chrono::steady_clock::now();
+
+                        for (UINT frameIndex = 0; subscribed && frameIndex < FRAME_COUNT; ++frameIndex)
+                        {
+                            frame.Clear();
+                            frame.FloorClipPlane = XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f);
+                            for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                            {
+                                MakeSwayingBody(bodyIndex, 0x1000 + bodyIndex, frameIndex / 30.0f, 0.003f, random, frame);
+                            }
+
+                            LARGE_INTEGER published;
+                            QueryPerformanceCounter(&published);
+                            frame.RelativeTime = published.QuadPart;
+                            broadcaster.Publish(frame);
+
+                            next += std::chrono::microseconds(33333);
+                            std::this_thread::sleep_until(next);
+                        }
+
+                        WaitFor([&]()
+                        {
+                            for (auto& subscriber : subscribers)
+                            {
+                                critical_section::scoped_lock lock(subscriber->Lock);
+                                if (subscriber->Decoded < FRAME_COUNT)
+                                {
+                                    return false;
+                                }
+                            }
+
+                            return true;
+                        }, 2000);
+
+                        SkeletonBroadcasterStatistics statistics;
+                        broadcaster.GetStatistics(&statistics);
+
+                        for (auto socket : datagramSockets)
+                        {
+                            SendDatagram(socket->OutputStream, SKELETON_WIRE_LEAVE, 0);
+                        }
+
+                        // deleting a socket closes it, the callbacks still holding one then fail
+                        for (auto socket : streamSockets)
+                        {
+                            delete socket;
+                        }
+                        for (auto socket : datagramSockets)
+                        {
+                            delete socket;
+                        }
+
+                        broadcaster.Stop();
+
+                        Assert::IsTrue(subscribed, L"every subscriber joined");
+                        Assert::AreEqual(static_cast<UINT64>(FRAME_COUNT), statistics.FramesPublished, L"published");
+                        Assert::AreEqual(static_cast<UINT64>(0), statistics.FramesDropped, L"nothing dropped");
+
+                        std::vector<double> latencies;
+                        for (UINT i = 0; i < subscribers.size(); ++i)
+                        {
+                            critical_section::scoped_lock lock(subscribers[i]->Lock);
+
+                            std::wstring message = (i < TCP_SUBSCRIBERS ? L"TCP subscriber " : L"UDP subscriber ") + std::to_wstring(i);
+                            Assert::AreEqual(FRAME_COUNT, subscribers[i]->Decoded, (message + L" decoded every frame").c_str());
+                            Assert::AreEqual(0u, subscribers[i]->Failed, (message + L" decoded all it got").c_str());
+
+                            latencies.insert(latencies.end(), subscribers[i]->Latencies.begin(), subscribers[i]->Latencies.end());
+                        }
+
+                        std::sort(latencies.begin(), latencies.end());
+                        double p50 = latencies[latencies.size() / 2];
+                        double p99 = latencies[latencies.size() * 99 / 100];
+
+                        LogMessage("%u subscribers, %u frames: publish to decoded p50 %.0f us, p99 %.0f us, max %.0f us",
+                            TCP_SUBSCRIBERS + UDP_SUBSCRIBERS, FRAME_COUNT, p50, p99, latencies.back());
+                        LogMessage("%llu frames sent, %llu key frames, %.1f B a frame",
+                            statistics.FramesSent, statistics.KeyFrames, statistics.BytesSent / static_cast<double>(max(statistics.FramesSent, 1ULL)));
+
+#ifdef NDEBUG
+                        Assert::IsTrue(p99 < 1000.0, L"p99 under 1 ms");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
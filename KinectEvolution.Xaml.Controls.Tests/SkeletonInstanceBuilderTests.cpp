@@ -0,0 +1,138 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonInstanceBuilderTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SkeletonInstanceBuilder.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // frames decoded at once from the store while measuring
+                static const UINT MEASURE_BATCH_FRAMES = 256;
+
+                struct SkeletonLodMeasurement
+                {
+                    UINT    Frames;
+                    float   MeanInstances;      // per frame
+                    float   MeanTriangles;      // per frame with every instance at the finest level
+                    float   MeanLodTriangles;   // per frame at the selected levels
+                    float   MeanSelectTime;     // microseconds per frame
+                };
+
+                // triangles submitted for the bodies of recorded frames with and without levels of detail
+                static void MeasureSkeletonLods(
+                    const BodyFrameStore& store,
+                    UINT firstFrame,
+                    UINT frameCount,
+                    FXMMATRIX view,
+                    CXMMATRIX projection,
+                    float viewportHeight,
+                    _Out_ SkeletonLodMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    std::vector<BodyFrameData> frames(min(frameCount, MEASURE_BATCH_FRAMES));
+                    SkeletonInstanceBuilder builder;
+
+                    UINT64 instances = 0;
+                    UINT64 triangles = 0;
+                    UINT64 lodTriangles = 0;
+                    double selectTime = 0.0;
+
+                    for (UINT batch = 0; batch < frameCount; batch += MEASURE_BATCH_FRAMES)
+                    {
+                        UINT batchFrames = min(frameCount - batch, MEASURE_BATCH_FRAMES);
+                        store.GetFrames(firstFrame + batch, batchFrames, frames.data());
+
+                        for (UINT i = 0; i < batchFrames; ++i)
+                        {
+                            builder.Build(frames[i], TRUE, TRUE, TRUE, TRUE);
+                            triangles += builder.GetTriangleCount();
+
+                            LARGE_INTEGER start, end;
+                            QueryPerformanceCounter(&start);
+                            builder.SelectLods(view, projection, viewportHeight);
+                            QueryPerformanceCounter(&end);
+
+                            selectTime += GetMicroseconds(start, end);
+                            lodTriangles += builder.GetTriangleCount();
+
+                            for (UINT j = 0; j < static_cast<UINT>(SkeletonBatch::Count); ++j)
+                            {
+                                instances += builder.GetInstanceCount(static_cast<SkeletonBatch>(j));
+                            }
+                        }
+                    }
+
+                    pMeasurement->Frames = frameCount;
+                    pMeasurement->MeanInstances = static_cast<float>(static_cast<double>(instances) / frameCount);
+                    pMeasurement->MeanTriangles = static_cast<float>(static_cast<double>(triangles) / frameCount);
+                    pMeasurement->MeanLodTriangles = static_cast<float>(static_cast<double>(lodTriangles) / frameCount);
+                    pMeasurement->MeanSelectTime = static_cast<float>(selectTime / frameCount);
+                }
+
+                TEST_CLASS(SkeletonInstanceBuilderTests)
+                {
+                public:
+                    TEST_METHOD(EveryTrackedBodyIsBuilt)
+                    {
+                        BodyFrameStore store;
+                        RecordSwayingBodies(3, 1, 1, 0, store);
+
+                        BodyFrameData frame;
+                        store.GetFrames(0, 1, &frame);
+
+                        SkeletonInstanceBuilder builder;
+                        builder.Build(frame, FALSE, TRUE, FALSE, FALSE);
+
+                        UINT joints = 0;
+                        for (UINT batch = 0; batch < static_cast<UINT>(SkeletonBatch::Count); ++batch)
+                        {
+                            joints += builder.GetInstanceCount(static_cast<SkeletonBatch>(batch));
+                        }
+
+                        Assert::AreEqual(3u * JOINT_COUNT, joints, L"an instance per joint of every tracked body");
+                    }
+
+                    TEST_METHOD(MeasureLevelsOfDetail)
+                    {
+                        // six people 2.5 m away seen through a 60 degree lens
+                        BodyFrameStore store;
+                        RecordSwayingBodies(6, 600, 1, 0, store);
+
+                        XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PI / 3.0f, 16.0f / 9.0f, 0.01f, 100.0f);
+
+                        const float heights[] = { 720.0f, 1080.0f, 2160.0f };
+                        float lastTriangles = 0.0f;
+                        for (float height : heights)
+                        {
+                            SkeletonLodMeasurement measurement;
+                            MeasureSkeletonLods(store, 0, 600, XMMatrixIdentity(), projection, height, &measurement);
+
+                            LogMessage("%.0f lines: %.0f instances, %.0f triangles at the finest level, %.0f selected (%.1f%%), select %.2f us",
+                                height, measurement.MeanInstances, measurement.MeanTriangles, measurement.MeanLodTriangles,
+                                100.0f * measurement.MeanLodTriangles / measurement.MeanTriangles, measurement.MeanSelectTime);
+
+                            Assert::IsTrue(measurement.MeanLodTriangles < measurement.MeanTriangles, L"fewer triangles with levels of detail");
+                            Assert::IsTrue(measurement.MeanLodTriangles >= lastTriangles, L"more triangles at higher resolutions");
+                            lastTriangles = measurement.MeanLodTriangles;
+#ifdef NDEBUG
+                            Assert::IsTrue(measurement.MeanSelectTime < 100.0f, L"selection under 100 us");
+#endif
+                        }
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,314 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonWireFormatTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SkeletonWireFormat.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                static const UINT WIRE_HEADER_SIZE = 32;
+
+                // six swaying bodies 1/30 s apart, with the noise of a real sensor
+                static void MakeFrame(UINT frameIndex, UINT bodyCount, _Inout_ std::mt19937& random, _Out_ BodyFrameData& frame)
+                {
+                    frame.Clear();
+                    frame.RelativeTime = static_cast<INT64>(frameIndex) * 333333;
+                    frame.FloorClipPlane = XMFLOAT4(0.02f, 0.98f, -0.1f, 0.95f);
+
+                    for (UINT bodyIndex = 0; bodyIndex < bodyCount; ++bodyIndex)
+                    {
+                        MakeSwayingBody(bodyIndex, 0x1000 + bodyIndex, frameIndex / 30.0f, 0.003f, random, frame);
+                    }
+                }
+
+                static UINT Encode(_In_ const SkeletonWireFrame& frame, _In_opt_ const SkeletonWireFrame* pBase, BOOL orientations, _Out_ std::vector<BYTE>& bytes)
+                {
+                    bytes.resize(SKELETON_WIRE_MAX_SIZE);
+                    UINT size = EncodeSkeletonFrame(frame, pBase, orientations, bytes.data(), SKELETON_WIRE_MAX_SIZE);
+                    bytes.resize(size);
+                    return size;
+                }
+
+                // what goes over the wire comes back unchanged, the rotations only when they are sent
+                static void AssertSameFrame(_In_ const SkeletonWireFrame& expected, _In_ const SkeletonWireFrame& actual, BOOL orientations)
+                {
+                    Assert::AreEqual(expected.Sequence, actual.Sequence, L"sequence");
+                    Assert::AreEqual(expected.RelativeTime, actual.RelativeTime, L"time");
+                    Assert::IsTrue(0 == memcmp(expected.FloorClipPlane, actual.FloorClipPlane, sizeof(expected.FloorClipPlane)), L"floor");
+
+                    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                    {
+                        const SkeletonWireBody& e = expected.Bodies[bodyIndex];
+                        const SkeletonWireBody& a = actual.Bodies[bodyIndex];
+
+                        Assert::AreEqual(e.IsTracked, a.IsTracked, L"tracked");
+                        if (!e.IsTracked)
+                        {
+                            continue;
+                        }
+
+                        Assert::AreEqual(e.TrackingId, a.TrackingId, L"tracking id");
+                        Assert::AreEqual(e.HandLeftState, a.HandLeftState, L"left hand");
+                        Assert::AreEqual(e.HandRightState, a.HandRightState, L"right hand");
+                        Assert::IsTrue(0 == memcmp(e.Position, a.Position, sizeof(e.Position)), L"positions");
+
+                        for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+                        {
+                            if (orientations)
+                            {
+                                Assert::AreEqual(e.JointFlags[jointIndex], a.JointFlags[jointIndex], L"joint flags");
+                            }
+                            else
+                            {
+                                Assert::AreEqual(
+                                    static_cast<BYTE>((e.JointFlags[jointIndex] & SKELETON_JOINT_STATE_MASK) | SKELETON_JOINT_ZERO_ROTATION),
+                                    a.JointFlags[jointIndex],
+                                    L"tracking state, no rotation");
+                            }
+                        }
+
+                        if (orientations)
+                        {
+                            Assert::IsTrue(0 == memcmp(e.Rotation, a.Rotation, sizeof(e.Rotation)), L"rotations");
+                        }
+                    }
+                }
+
+                TEST_CLASS(SkeletonWireFormatTests)
+                {
+                public:
+                    TEST_METHOD(QuantizeRoundTrip)
+                    {
+                        std::mt19937 random(7);
+                        BodyFrameData frame;
+                        MakeFrame(12, 4, random, frame);
+                        frame.TrackingState[BodyJointIndex(1, 3)] = WRK::TrackingState::Inferred;
+                        frame.TrackingState[BodyJointIndex(2, 7)] = WRK::TrackingState::NotTracked;
+                        frame.HandLeftState[3] = WRK::HandState::Lasso;
+
+                        // a joint the sensor gave no orientation
+                        UINT unrotated = BodyJointIndex(0, 15);
+                        frame.OrientationX[unrotated] = frame.OrientationY[unrotated] = frame.OrientationZ[unrotated] = frame.OrientationW[unrotated] = 0.0f;
+
+                        SkeletonWireFrame wire;
+                        QuantizeSkeletonFrame(frame, 99, &wire);
+                        Assert::AreEqual(99u, wire.Sequence, L"sequence");
+
+                        BodyFrameData decoded;
+                        DequantizeSkeletonFrame(wire, &decoded);
+
+                        Assert::AreEqual(frame.RelativeTime, decoded.RelativeTime, L"time");
+                        Assert::AreEqual(frame.FloorClipPlane.y, decoded.FloorClipPlane.y, 1.0f / 32767.0f, L"floor normal");
+                        Assert::AreEqual(frame.FloorClipPlane.w, decoded.FloorClipPlane.w, 1.0f / 8192.0f, L"floor height");
+
+                        for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                        {
+                            Assert::AreEqual(frame.IsTracked[bodyIndex], decoded.IsTracked[bodyIndex], L"tracked");
+                            if (!frame.IsTracked[bodyIndex])
+                            {
+                                continue;
+                            }
+
+                            Assert::AreEqual(frame.TrackingId[bodyIndex], decoded.TrackingId[bodyIndex], L"tracking id");
+                            Assert::IsTrue(frame.HandLeftState[bodyIndex] == decoded.HandLeftState[bodyIndex], L"left hand");
+                            Assert::IsTrue(frame.HandRightState[bodyIndex] == decoded.HandRightState[bodyIndex], L"right hand");
+
+                            for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+                            {
+                                UINT i = BodyJointIndex(bodyIndex, jointIndex);
+                                Assert::IsTrue(frame.TrackingState[i] == decoded.TrackingState[i], L"tracking state");
+
+                                // half a step of 1/4096 m
+                                Assert::AreEqual(frame.PositionX[i], decoded.PositionX[i], 1.0f / 8192.0f, L"x");
+                                Assert::AreEqual(frame.PositionY[i], decoded.PositionY[i], 1.0f / 8192.0f, L"y");
+                                Assert::AreEqual(frame.PositionZ[i], decoded.PositionZ[i], 1.0f / 8192.0f, L"z");
+
+                                XMVECTOR original = frame.GetOrientation(bodyIndex, jointIndex);
+                                XMVECTOR restored = decoded.GetOrientation(bodyIndex, jointIndex);
+                                if (i == unrotated)
+                                {
+                                    Assert::IsTrue(XMVector4Equal(XMVectorZero(), restored), L"no orientation stays none");
+                                    continue;
+                                }
+
+                                // q and -q are the same rotation
+                                float dot = fabsf(XMVectorGetX(XMVector4Dot(original, restored)));
+                                Assert::IsTrue(dot > 0.9999f, L"orientation");
+                                Assert::AreEqual(1.0f, XMVectorGetX(XMVector4Length(restored)), 1e-4f, L"unit orientation");
+                            }
+                        }
+                    }
+
+                    TEST_METHOD(KeyFramesAndDeltas)
+                    {
+                        std::mt19937 random(11);
+                        BodyFrameData frame;
+                        SkeletonWireFrame base;
+                        SkeletonWireFrame next;
+
+                        MakeFrame(0, BODY_COUNT, random, frame);
+                        QuantizeSkeletonFrame(frame, 40, &base);
+                        MakeFrame(1, BODY_COUNT, random, frame);
+                        QuantizeSkeletonFrame(frame, 41, &next);
+
+                        const BOOL orientations[] = { FALSE, TRUE };
+                        for (UINT o = 0; o < _countof(orientations); ++o)
+                        {
+                            std::vector<BYTE> keyFrame;
+                            std::vector<BYTE> delta;
+                            Assert::IsTrue(Encode(next, nullptr, orientations[o], keyFrame) > WIRE_HEADER_SIZE, L"key frame");
+                            Assert::IsTrue(Encode(next, &base, orientations[o], delta) > WIRE_HEADER_SIZE, L"delta");
+                            Assert::IsTrue(delta.size() < keyFrame.size(), L"the delta is smaller");
+
+                            SkeletonWireHeader header;
+                            Assert::IsTrue(ReadSkeletonFrameHeader(keyFrame.data(), static_cast<UINT>(keyFrame.size()), &header), L"key frame header");
+                            Assert::AreEqual(static_cast<BYTE>(SKELETON_WIRE_KEYFRAME | (orientations[o] ? SKELETON_WIRE_ORIENTATIONS : 0)), header.Flags, L"key frame flags");
+                            Assert::AreEqual(static_cast<UINT>(keyFrame.size()), header.Size, L"key frame size");
+                            Assert::AreEqual(41u, header.Sequence, L"key frame sequence");
+
+                            Assert::IsTrue(ReadSkeletonFrameHeader(delta.data(), static_cast<UINT>(delta.size()), &header), L"delta header");
+                            Assert::AreEqual(static_cast<BYTE>(orientations[o] ? SKELETON_WIRE_ORIENTATIONS : 0), header.Flags, L"delta flags");
+                            Assert::AreEqual(static_cast<UINT>(delta.size()), header.Size, L"delta size");
+                            Assert::AreEqual(40u, header.BaseSequence, L"delta base");
+
+                            // a key frame needs no base, a delta needs its own
+                            SkeletonWireFrame decoded;
+                            Assert::IsTrue(DecodeSkeletonFrame(keyFrame.data(), static_cast<UINT>(keyFrame.size()), nullptr, &decoded), L"key frame decodes");
+                            AssertSameFrame(next, decoded, orientations[o]);
+
+                            Assert::IsTrue(DecodeSkeletonFrame(delta.data(), static_cast<UINT>(delta.size()), &base, &decoded), L"delta decodes");
+                            AssertSameFrame(next, decoded, orientations[o]);
+
+                            Assert::IsFalse(DecodeSkeletonFrame(delta.data(), static_cast<UINT>(delta.size()), nullptr, &decoded), L"no base");
+                            Assert::IsFalse(DecodeSkeletonFrame(delta.data(), static_cast<UINT>(delta.size()), &next, &decoded), L"wrong base");
+                            Assert::IsFalse(DecodeSkeletonFrame(delta.data(), static_cast<UINT>(delta.size()) - 1, &base, &decoded), L"cut short");
+                        }
+
+                        // a new person in a slot is sent in full, a slot that empties is simply left out
+                        SkeletonWireFrame changed = next;
+                        changed.Bodies[2].TrackingId = 0x2000;
+                        changed.Bodies[4].IsTracked = FALSE;
+
+                        std::vector<BYTE> delta;
+                        Assert::IsTrue(Encode(changed, &base, FALSE, delta) > WIRE_HEADER_SIZE, L"delta");
+                        Assert::AreEqual(static_cast<BYTE>(0x2F), delta[6], L"body mask");
+                        Assert::AreEqual(static_cast<BYTE>(0x2B), delta[7], L"delta mask");
+
+                        SkeletonWireFrame decoded;
+                        Assert::IsTrue(DecodeSkeletonFrame(delta.data(), static_cast<UINT>(delta.size()), &base, &decoded), L"decodes");
+                        AssertSameFrame(changed, decoded, FALSE);
+                    }
+
+                    TEST_METHOD(DecoderResolvesBasesInItsHistory)
+                    {
+                        std::mt19937 random(13);
+                        BodyFrameData frame;
+                        std::vector<SkeletonWireFrame> frames(70);
+                        for (UINT sequence = 0; sequence < frames.size(); ++sequence)
+                        {
+                            MakeFrame(sequence, 3, random, frame);
+                            QuantizeSkeletonFrame(frame, sequence, &frames[sequence]);
+                        }
+
+                        SkeletonWireDecoder decoder;
+                        Assert::IsFalse(!!decoder.HasFrame(), L"nothing yet");
+
+                        std::vector<BYTE> bytes;
+                        Encode(frames[1], &frames[0], FALSE, bytes);
+                        Assert::IsFalse(decoder.Decode(bytes.data(), static_cast<UINT>(bytes.size())), L"a delta before any frame");
+
+                        Encode(frames[0], nullptr, FALSE, bytes);
+                        Assert::IsTrue(decoder.Decode(bytes.data(), static_cast<UINT>(bytes.size())), L"key frame");
+                        Assert::IsTrue(!!decoder.HasFrame(), L"has a frame");
+
+                        // an unacknowledged UDP stream: every frame against the one key frame the subscriber holds
+                        for (UINT sequence = 1; sequence < 64; ++sequence)
+                        {
+                            Encode(frames[sequence], &frames[0], FALSE, bytes);
+                            Assert::IsTrue(decoder.Decode(bytes.data(), static_cast<UINT>(bytes.size())), L"delta against a held base");
+                            AssertSameFrame(frames[sequence], decoder.GetFrame(), FALSE);
+                        }
+
+                        // 64 frames back the base has been overwritten
+                        Encode(frames[64], &frames[0], FALSE, bytes);
+                        Assert::IsFalse(decoder.Decode(bytes.data(), static_cast<UINT>(bytes.size())), L"base out of the history");
+                        Assert::AreEqual(63u, decoder.GetFrame().Sequence, L"latest frame kept");
+
+                        Encode(frames[64], &frames[1], FALSE, bytes);
+                        Assert::IsTrue(decoder.Decode(bytes.data(), static_cast<UINT>(bytes.size())), L"63 frames back");
+                        AssertSameFrame(frames[64], decoder.GetFrame(), FALSE);
+
+                        // a frame that arrives after a later one is dropped, even a key frame
+                        Encode(frames[62], nullptr, FALSE, bytes);
+                        Assert::IsFalse(decoder.Decode(bytes.data(), static_cast<UINT>(bytes.size())), L"late frame");
+                        Encode(frames[64], nullptr, FALSE, bytes);
+                        Assert::IsFalse(decoder.Decode(bytes.data(), static_cast<UINT>(bytes.size())), L"repeated frame");
+                        Assert::AreEqual(64u, decoder.GetFrame().Sequence, L"latest frame kept");
+
+                        // skipped frames are fine as long as the base is held
+                        Encode(frames[69], &frames[64], FALSE, bytes);
+                        Assert::IsTrue(decoder.Decode(bytes.data(), static_cast<UINT>(bytes.size())), L"gap");
+                        AssertSameFrame(frames[69], decoder.GetFrame(), FALSE);
+
+                        bytes[0] ^= 0xFF;
+                        Assert::IsFalse(decoder.Decode(bytes.data(), static_cast<UINT>(bytes.size())), L"damaged header");
+                    }
+
+                    TEST_METHOD(MeasureBytesPerBody)
+                    {
+                        const UINT frameCount = 300;
+
+                        std::mt19937 random(17);
+                        BodyFrameData frame;
+                        std::vector<SkeletonWireFrame> frames(frameCount);
+                        for (UINT sequence = 0; sequence < frameCount; ++sequence)
+                        {
+                            MakeFrame(sequence, BODY_COUNT, random, frame);
+                            QuantizeSkeletonFrame(frame, sequence, &frames[sequence]);
+                        }
+
+                        const BOOL orientations[] = { FALSE, TRUE };
+                        for (UINT o = 0; o < _countof(orientations); ++o)
+                        {
+                            std::vector<BYTE> bytes;
+                            UINT keyFrame = Encode(frames[0], nullptr, orientations[o], bytes);
+
+                            // a TCP subscriber: every frame against the one before
+                            UINT64 deltaBytes = 0;
+                            for (UINT sequence = 1; sequence < frameCount; ++sequence)
+                            {
+                                UINT size = Encode(frames[sequence], &frames[sequence - 1], orientations[o], bytes);
+                                Assert::IsTrue(size > WIRE_HEADER_SIZE, L"encoded");
+                                deltaBytes += size - WIRE_HEADER_SIZE;
+                            }
+
+                            double keyBody = (keyFrame - WIRE_HEADER_SIZE) / static_cast<double>(BODY_COUNT);
+                            double deltaBody = deltaBytes / static_cast<double>((frameCount - 1) * BODY_COUNT);
+
+                            LogMessage("orientations %s: key frame %u B, %.1f B a body; deltas %.1f B a body",
+                                orientations[o] ? "on" : "off", keyFrame, keyBody, deltaBody);
+
+                            // the default stream, without orientations: a body in full once, then under 150 B a frame
+                            if (!orientations[o])
+                            {
+                                Assert::AreEqual(184.0, keyBody, 0.0, L"key frame body");
+                                Assert::IsTrue(deltaBody < 150.0, L"delta body");
+                            }
+                        }
+                    }
+                };
+
+            }
+        }
+    }
+}
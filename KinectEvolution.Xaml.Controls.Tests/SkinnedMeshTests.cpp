@@ -0,0 +1,220 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkinnedMeshTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SkinnedMesh.h"
+#include "TestHelpers.h"
+
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::BlockMan;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // a character of about the size the panel is meant for
+                static const UINT MESH_VERTEX_COUNT = 20000;
+
+                // frames skinned to time each mode
+                static const UINT SKIN_FRAMES = 200;
+
+                // a mesh file in memory: every bone gets a ring of vertices around its block, most weighted to one
+                // or two bones as an artist would, a few to three or four
+                static void MakeMeshFile(UINT vertexCount, UINT seed, _Out_ std::vector<BYTE>& file)
+                {
+                    std::mt19937 random(seed);
+                    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+                    SkinnedMeshFileHeader header;
+                    header.Magic = SKINNED_MESH_MAGIC;
+                    header.Version = SKINNED_MESH_VERSION;
+                    header.VertexCount = vertexCount;
+                    header.IndexCount = (vertexCount / 3) * 3;
+                    header.BoneCount = BLOCK_COUNT;
+
+                    file.assign(sizeof(header) + BLOCK_COUNT * sizeof(XMFLOAT4X3) + vertexCount * sizeof(SkinnedMeshFileVertex) + header.IndexCount * sizeof(UINT32), 0);
+                    BYTE* pWrite = file.data();
+                    memcpy(pWrite, &header, sizeof(header));
+                    pWrite += sizeof(header);
+
+                    // bone i sits a little above bone i - 1 in the bind pose
+                    for (UINT boneIndex = 0; boneIndex < BLOCK_COUNT; ++boneIndex)
+                    {
+                        XMFLOAT4X3 inverseBind;
+                        XMStoreFloat4x3(&inverseBind, XMMatrixTranslation(0.0f, -0.1f * boneIndex, 0.0f));
+                        memcpy(pWrite, &inverseBind, sizeof(inverseBind));
+                        pWrite += sizeof(inverseBind);
+                    }
+
+                    for (UINT i = 0; i < vertexCount; ++i)
+                    {
+                        SkinnedMeshFileVertex vertex;
+                        BYTE boneIndex = static_cast<BYTE>(i % BLOCK_COUNT);
+                        float angle = XM_2PI * unit(random);
+
+                        vertex.Position = XMFLOAT3(0.1f * cosf(angle), 0.1f * boneIndex + 0.1f * unit(random), 0.1f * sinf(angle));
+                        vertex.Normal = XMFLOAT3(cosf(angle), 0.0f, sinf(angle));
+                        vertex.Tex = XMFLOAT2(unit(random), unit(random));
+
+                        float roll = unit(random);
+                        UINT influences = roll < 0.5f ? 1 : roll < 0.85f ? 2 : roll < 0.95f ? 3 : 4;
+                        float weights[SKINNED_MESH_INFLUENCES] = {};
+                        for (UINT k = 0; k < SKINNED_MESH_INFLUENCES; ++k)
+                        {
+                            vertex.Bones[k] = static_cast<BYTE>((boneIndex + k) % BLOCK_COUNT);
+                            weights[k] = k < influences ? 0.1f + unit(random) : 0.0f;
+                        }
+                        vertex.Weights = XMFLOAT4(weights[0], weights[1], weights[2], weights[3]);
+
+                        memcpy(pWrite, &vertex, sizeof(vertex));
+                        pWrite += sizeof(vertex);
+                    }
+
+                    for (UINT32 i = 0; i < header.IndexCount; ++i)
+                    {
+                        memcpy(pWrite, &i, sizeof(i));
+                        pWrite += sizeof(i);
+                    }
+                }
+
+                // every joint of every body bent its own way, some of them far
+                static void PoseBodies(float seconds, _Inout_ BlockManKinematics& kinematics, _Inout_ SkinnedMesh& mesh)
+                {
+                    XMVECTOR orientations[JOINT_COUNT];
+                    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                    {
+                        for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+                        {
+                            float phase = seconds * (1.0f + 0.1f * bodyIndex) + 0.3f * jointIndex;
+                            orientations[jointIndex] = XMQuaternionRotationRollPitchYaw(1.2f * sinf(phase), 0.8f * cosf(phase), 0.5f * sinf(2.0f * phase));
+                        }
+
+                        kinematics.SetJointOrientations(bodyIndex, orientations);
+                        kinematics.SetBodyTransform(bodyIndex, XMMatrixIdentity(), XMVectorSet(bodyIndex - 2.5f, 0.0f, 2.5f, 0.0f));
+                    }
+
+                    kinematics.Solve();
+
+                    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                    {
+                        mesh.SetPose(bodyIndex, kinematics, XMMatrixScaling(-1.0f, 1.0f, 1.0f));
+                    }
+                }
+
+                static void CheckAgainstReference(const SkinnedMesh& mesh, SkinningMode mode)
+                {
+                    std::vector<SkinnedVertex> vertices(mesh.GetVertexCount());
+                    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                    {
+                        mesh.WriteVertices(bodyIndex, vertices.data());
+
+                        for (UINT i = 0; i < mesh.GetVertexCount(); ++i)
+                        {
+                            XMFLOAT3 position;
+                            XMFLOAT3 normal;
+                            mesh.SkinReference(bodyIndex, i, mode, &position, &normal);
+
+                            Assert::AreEqual(position.x, vertices[i].Position.x, 1e-4f, L"x");
+                            Assert::AreEqual(position.y, vertices[i].Position.y, 1e-4f, L"y");
+                            Assert::AreEqual(position.z, vertices[i].Position.z, 1e-4f, L"z");
+                            Assert::AreEqual(normal.x, vertices[i].Normal.x, 1e-3f, L"normal x");
+                            Assert::AreEqual(normal.y, vertices[i].Normal.y, 1e-3f, L"normal y");
+                            Assert::AreEqual(normal.z, vertices[i].Normal.z, 1e-3f, L"normal z");
+                        }
+                    }
+                }
+
+                TEST_CLASS(SkinnedMeshTests)
+                {
+                public:
+                    TEST_METHOD(SkinMatchesTheReference)
+                    {
+                        std::vector<BYTE> file;
+                        MakeMeshFile(1001, 3, file);
+
+                        SkinnedMesh mesh;
+                        Assert::IsTrue(mesh.Load(file.data(), file.size()), L"loaded");
+                        Assert::AreEqual(1001u, mesh.GetVertexCount(), L"every vertex");
+
+                        BlockManKinematics kinematics;
+                        PoseBodies(0.7f, kinematics, mesh);
+
+                        mesh.Skin((1u << BODY_COUNT) - 1, SkinningMode::Linear);
+                        CheckAgainstReference(mesh, SkinningMode::Linear);
+
+                        mesh.Skin((1u << BODY_COUNT) - 1, SkinningMode::DualQuaternion);
+                        CheckAgainstReference(mesh, SkinningMode::DualQuaternion);
+                    }
+
+                    TEST_METHOD(RejectsDamagedFiles)
+                    {
+                        std::vector<BYTE> file;
+                        MakeMeshFile(30, 5, file);
+
+                        SkinnedMesh mesh;
+                        Assert::IsFalse(mesh.Load(file.data(), file.size() - 1), L"truncated");
+
+                        // the first vertex bound to a bone past the last block
+                        std::vector<BYTE> badBone(file);
+                        size_t vertexOffset = sizeof(SkinnedMeshFileHeader) + BLOCK_COUNT * sizeof(XMFLOAT4X3);
+                        badBone[vertexOffset + offsetof(SkinnedMeshFileVertex, Bones)] = static_cast<BYTE>(BLOCK_COUNT);
+                        Assert::IsFalse(mesh.Load(badBone.data(), badBone.size()), L"bone outside the hierarchy");
+
+                        Assert::IsFalse(!!mesh.IsLoaded(), L"nothing loaded");
+                        Assert::IsTrue(mesh.Load(file.data(), file.size()), L"intact");
+                    }
+
+                    TEST_METHOD(MeasureSixBodies)
+                    {
+                        std::vector<BYTE> file;
+                        MakeMeshFile(MESH_VERTEX_COUNT, 7, file);
+
+                        SkinnedMesh mesh;
+                        Assert::IsTrue(mesh.Load(file.data(), file.size()), L"loaded");
+
+                        BlockManKinematics kinematics;
+                        double microseconds[2] = {};
+                        double slowest[2] = {};
+                        SkinningMode modes[2] = { SkinningMode::Linear, SkinningMode::DualQuaternion };
+
+                        for (UINT m = 0; m < 2; ++m)
+                        {
+                            for (UINT frame = 0; frame < SKIN_FRAMES; ++frame)
+                            {
+                                PoseBodies(frame / 30.0f, kinematics, mesh);
+
+                                LARGE_INTEGER start;
+                                LARGE_INTEGER end;
+                                QueryPerformanceCounter(&start);
+                                mesh.Skin((1u << BODY_COUNT) - 1, modes[m]);
+                                QueryPerformanceCounter(&end);
+
+                                double elapsed = GetMicroseconds(start, end);
+                                microseconds[m] += elapsed;
+                                slowest[m] = max(slowest[m], elapsed);
+                            }
+
+                            microseconds[m] /= SKIN_FRAMES;
+                        }
+
+                        // the worker threads only help with more than one core, so say how many there were
+                        LogMessage("%u vertices, 6 bodies on %u cores: linear %.0f us (slowest %.0f), dual quaternion %.0f us (slowest %.0f)",
+                            MESH_VERTEX_COUNT, std::thread::hardware_concurrency(), microseconds[0], slowest[0], microseconds[1], slowest[1]);
+
+#ifdef NDEBUG
+                        // linear is the default and has to fit in 2 ms of the frame
+                        Assert::IsTrue(microseconds[0] < 2000.0, L"linear skinning within 2 ms");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,302 @@
+//------------------------------------------------------------------------------
+// <copyright file="SpeakerAttributionTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SpeakerAttribution.h"
+#include "DirectionOfArrival.h"
+#include "VoiceActivity.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                struct SpeakerAttributionMeasurement
+                {
+                    UINT    Updates;            // one per body frame
+                    UINT    SpeechUpdates;      // with speech in the recent slots
+                    float   Agreement;          // share of the speech updates whose most likely speaker is the expected one
+                    float   MeanUpdateTime;     // microseconds
+                    float   MaxUpdateTime;      // microseconds
+                };
+
+                // plays body frames from the store against a 4 channel recording of the microphone array starting at
+                // recordingStartTime on the bodies' clock, and updates on every body frame. the beam comes from
+                // DirectionOfArrival and the speech from VoiceActivityDetector on the first channel;
+                // speakerTrackingId is who is known to be talking, when speech is heard
+                static void MeasureSpeakerAttribution(
+                    const BodyFrameStore& bodies,
+                    const WaveFile& recording,
+                    INT64 recordingStartTime,
+                    UINT64 speakerTrackingId,
+                    _Out_ SpeakerAttributionMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    const UINT sampleRate = recording.GetSampleRate();
+
+                    DirectionOfArrival directionOfArrival;
+                    directionOfArrival.Reset(sampleRate, 512, KinectMicrophonePositions, KINECT_MICROPHONE_COUNT, 50.0f * XM_PI / 180.0f, 101);
+                    const UINT frameSize = directionOfArrival.GetFrameSize();
+
+                    VoiceActivityDetector voiceActivity;
+                    voiceActivity.Reset(sampleRate);
+
+                    SpeakerAttribution attribution;
+
+                    const float* pChannels[KINECT_MICROPHONE_COUNT];
+                    UINT audioFirst = 0;
+
+                    BodyFrameData frame;
+                    double updateTime = 0.0;
+                    double maxUpdateTime = 0.0;
+                    UINT agreements = 0;
+
+                    for (UINT frameIndex = 0; frameIndex < bodies.GetFrameCount(); ++frameIndex)
+                    {
+                        bodies.GetFrames(frameIndex, 1, &frame);
+                        INT64 time = frame.RelativeTime;
+
+                        // the audio up to the body frame, stamped with the time of its last sample
+                        while (audioFirst + frameSize <= recording.GetFrameCount())
+                        {
+                            INT64 audioTime = recordingStartTime + static_cast<INT64>((audioFirst + frameSize) * 1e7 / sampleRate);
+                            if (audioTime > time)
+                            {
+                                break;
+                            }
+
+                            for (UINT m = 0; m < KINECT_MICROPHONE_COUNT; ++m)
+                            {
+                                pChannels[m] = recording.GetChannel(m) + audioFirst;
+                            }
+
+                            BeamEstimate estimate = { 0.0f, 0.0f };
+                            directionOfArrival.Estimate(pChannels, &estimate);
+
+                            voiceActivity.Process(pChannels[0], frameSize, estimate.BeamAngle, estimate.BeamAngleConfidence);
+                            attribution.AddBeam(audioTime, estimate.BeamAngle, estimate.BeamAngleConfidence, voiceActivity.IsSpeaking());
+
+                            audioFirst += frameSize;
+                        }
+
+                        attribution.AddBodies(frame, time);
+
+                        LARGE_INTEGER start, end;
+                        QueryPerformanceCounter(&start);
+                        attribution.Update(time);
+                        QueryPerformanceCounter(&end);
+
+                        double elapsed = GetMicroseconds(start, end);
+                        updateTime += elapsed;
+                        maxUpdateTime = max(maxUpdateTime, elapsed);
+                        pMeasurement->Updates++;
+
+                        SpeakerAttributionResult result;
+                        attribution.GetResult(&result);
+                        if (result.SpeechActivity <= 0.0f)
+                        {
+                            continue;
+                        }
+
+                        pMeasurement->SpeechUpdates++;
+
+                        // the most likely speaker, nobody included
+                        UINT64 speaker = 0;
+                        float best = result.NoSpeakerProbability;
+                        for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+                        {
+                            if (result.Probability[bodyIndex] > best)
+                            {
+                                best = result.Probability[bodyIndex];
+                                speaker = result.TrackingId[bodyIndex];
+                            }
+                        }
+
+                        if (speaker == speakerTrackingId)
+                        {
+                            agreements++;
+                        }
+                    }
+
+                    pMeasurement->Agreement = (pMeasurement->SpeechUpdates > 0) ? static_cast<float>(agreements) / pMeasurement->SpeechUpdates : 0.0f;
+                    pMeasurement->MeanUpdateTime = (pMeasurement->Updates > 0) ? static_cast<float>(updateTime / pMeasurement->Updates) : 0.0f;
+                    pMeasurement->MaxUpdateTime = static_cast<float>(maxUpdateTime);
+                }
+
+                static const UINT64 SPEAKER_IDS[2] = { 0x7000000001, 0x7000000002 };
+
+                // azimuths of the two people, radians positive towards camera space +x
+                static const float SPEAKER_AZIMUTHS[2] = { 20.0f * XM_PI / 180.0f, -25.0f * XM_PI / 180.0f };
+
+                // one body standing at azimuth 2.2 m from the sensor, drifting a little
+                static void SetStandingBody(UINT bodyIndex, UINT64 trackingId, float azimuth, _Inout_ BodyFrameData& frame)
+                {
+                    frame.IsTracked[bodyIndex] = TRUE;
+                    frame.TrackingId[bodyIndex] = trackingId;
+
+                    for (UINT joint = 0; joint < JOINT_COUNT; ++joint)
+                    {
+                        UINT index = BodyJointIndex(bodyIndex, joint);
+                        frame.PositionX[index] = 2.2f * sinf(azimuth);
+                        frame.PositionY[index] = 0.5f - 0.05f * joint;
+                        frame.PositionZ[index] = 2.2f * cosf(azimuth);
+                        frame.OrientationW[index] = 1.0f;
+                        frame.TrackingState[index] = WRK::TrackingState::Tracked;
+                    }
+                }
+
+                // both people for seconds from firstTime, one frame every 1/30 s
+                static void RecordTwoSpeakers(float seconds, INT64 firstTime, _Inout_ BodyFrameStore& store)
+                {
+                    BodyFrameData frame;
+                    for (UINT frameIndex = 0; frameIndex < seconds * 30; ++frameIndex)
+                    {
+                        frame.Clear();
+                        frame.RelativeTime = firstTime + static_cast<INT64>(frameIndex) * SPEAKER_SLOT_TICKS;
+                        frame.FloorClipPlane = XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f);
+
+                        for (UINT body = 0; body < 2; ++body)
+                        {
+                            SetStandingBody(body, SPEAKER_IDS[body], SPEAKER_AZIMUTHS[body] + 0.02f * sinf(frameIndex * 0.1f + body), frame);
+                        }
+
+                        store.Append(frame);
+                    }
+                }
+
+                TEST_CLASS(SpeakerAttributionTests)
+                {
+                public:
+                    TEST_METHOD(NoBodiesNoSpeech)
+                    {
+                        SpeakerAttribution attribution;
+                        attribution.Reset(1.0f, 0.1f, 0.15f);
+                        attribution.Update(5000000000);
+
+                        SpeakerAttributionResult result;
+                        attribution.GetResult(&result);
+                        Assert::AreEqual(0.0f, result.SpeechActivity, L"no speech");
+                        Assert::AreEqual(0.0f, result.Probability[0], L"no speaker");
+                    }
+
+                    TEST_METHOD(BeamAwayFromEveryoneIsNobody)
+                    {
+                        SpeakerAttribution attribution;
+                        attribution.Reset(1.0f, 0.1f, 0.15f);
+
+                        BodyFrameData frame;
+                        frame.Clear();
+                        for (UINT body = 0; body < 2; ++body)
+                        {
+                            SetStandingBody(body, SPEAKER_IDS[body], SPEAKER_AZIMUTHS[body], frame);
+                        }
+
+                        // speech first from the second person, then from well to the side of both
+                        SpeakerAttributionResult result;
+                        for (UINT frameIndex = 0; frameIndex < 120; ++frameIndex)
+                        {
+                            INT64 time = 5000000000 + static_cast<INT64>(frameIndex) * SPEAKER_SLOT_TICKS;
+                            float beamAngle = (frameIndex < 60) ? SPEAKER_AZIMUTHS[1] + 0.02f : 0.8f;
+
+                            attribution.AddBodies(frame, time);
+                            attribution.AddBeam(time + 1000, beamAngle, 0.6f, frameIndex > 20);
+                            attribution.Update(time);
+
+                            if (59 == frameIndex)
+                            {
+                                attribution.GetResult(&result);
+                                Assert::AreEqual(SPEAKER_IDS[1], result.TrackingId[1], L"tracking id");
+                                Assert::IsTrue(result.Probability[1] > 0.8f, L"second person speaking");
+                                Assert::IsTrue(result.Probability[0] < 0.1f, L"first person silent");
+                            }
+                        }
+
+                        attribution.GetResult(&result);
+                        Assert::IsTrue(result.NoSpeakerProbability > result.Probability[0] && result.NoSpeakerProbability > result.Probability[1], L"nobody tracked is speaking");
+                    }
+
+                    TEST_METHOD(FlippedBeamAngle)
+                    {
+                        SpeakerAttribution attribution;
+                        attribution.Reset(1.0f, 0.1f, 0.15f);
+                        attribution.SetBeamAngleFlipped(TRUE);
+
+                        BodyFrameData frame;
+                        frame.Clear();
+                        for (UINT body = 0; body < 2; ++body)
+                        {
+                            SetStandingBody(body, SPEAKER_IDS[body], SPEAKER_AZIMUTHS[body], frame);
+                        }
+
+                        // a beam reported the other way round points at the second person once flipped
+                        for (UINT frameIndex = 0; frameIndex < 60; ++frameIndex)
+                        {
+                            INT64 time = 5000000000 + static_cast<INT64>(frameIndex) * SPEAKER_SLOT_TICKS;
+
+                            attribution.AddBodies(frame, time);
+                            attribution.AddBeam(time + 1000, -SPEAKER_AZIMUTHS[1], 0.6f, frameIndex > 20);
+                            attribution.Update(time);
+                        }
+
+                        SpeakerAttributionResult result;
+                        attribution.GetResult(&result);
+                        Assert::IsTrue(result.Probability[1] > 0.8f, L"second person speaking");
+                        Assert::IsTrue(result.Probability[0] < 0.1f, L"first person silent");
+                    }
+
+                    TEST_METHOD(MeasureTwoSpeakers)
+                    {
+                        const UINT sampleRate = 16000;
+                        const float seconds = 10.0f;
+                        const INT64 firstTime = 5000000000;
+
+                        BodyFrameStore store;
+                        RecordTwoSpeakers(seconds, firstTime, store);
+
+                        std::mt19937 random(3);
+                        for (UINT speaker = 0; speaker < 2; ++speaker)
+                        {
+                            // bursts of speech from the speaker's direction over a little noise
+                            std::vector<std::vector<float>> channels(KINECT_MICROPHONE_COUNT, std::vector<float>(static_cast<size_t>(seconds * sampleRate), 0.0f));
+                            for (std::vector<float>& channel : channels)
+                            {
+                                AddNoise(channel, 0.002f, random);
+                            }
+
+                            const float starts[] = { 1.0f, 2.6f, 4.5f, 6.2f, 8.0f };
+                            for (float start : starts)
+                            {
+                                AddArrayBurst(channels, sampleRate, static_cast<UINT>(start * sampleRate), sampleRate * 11 / 10, 120.0f + 40.0f * speaker, 0.08f, SPEAKER_AZIMUTHS[speaker]);
+                            }
+
+                            WaveFile recording;
+                            Assert::IsTrue(LoadRecording(channels, sampleRate, WaveSampleFormat::Pcm16, recording), L"recording loads");
+
+                            SpeakerAttributionMeasurement measurement;
+                            MeasureSpeakerAttribution(store, recording, firstTime, SPEAKER_IDS[speaker], &measurement);
+
+                            LogMessage("speaker %u: %u updates, %u with speech, agreement %.1f%%, update %.2f us mean %.2f us max",
+                                speaker, measurement.Updates, measurement.SpeechUpdates, 100.0f * measurement.Agreement, measurement.MeanUpdateTime, measurement.MaxUpdateTime);
+
+                            Assert::IsTrue(measurement.SpeechUpdates > 30, L"speech heard");
+                            Assert::IsTrue(measurement.Agreement > 0.95f, L"the talker picked");
+#ifdef NDEBUG
+                            Assert::IsTrue(measurement.MeanUpdateTime < 50.0f, L"updates under 50 us");
+#endif
+                        }
+                    }
+                };
+
+            }
+        }
+    }
+}
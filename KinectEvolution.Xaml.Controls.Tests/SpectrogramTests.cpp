@@ -0,0 +1,269 @@
+//------------------------------------------------------------------------------
+// <copyright file="SpectrogramTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Spectrogram.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                struct SpectrogramMeasurement
+                {
+                    UINT    Samples;            // per pass
+                    UINT    Columns;            // added per pass
+                    float   MeanTime;           // microseconds per pass
+                    float   RealTimeFactor;     // seconds of audio per second of processing
+                };
+
+                // runs the spectrogram over the samples repeats times
+                static void MeasureSpectrogram(
+                    _In_reads_(sampleCount) const float* pSamples,
+                    UINT sampleCount,
+                    UINT sampleRate,
+                    UINT fftSize,
+                    UINT hopSize,
+                    UINT repeats,
+                    _Out_ SpectrogramMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    Spectrogram spectrogram;
+                    double time = 0.0;
+                    UINT columns = 0;
+
+                    for (UINT pass = 0; pass < repeats; ++pass)
+                    {
+                        spectrogram.Reset(fftSize, hopSize, 256, -90.0f);
+
+                        LARGE_INTEGER start, end;
+                        QueryPerformanceCounter(&start);
+                        columns = spectrogram.Process(pSamples, sampleCount);
+                        QueryPerformanceCounter(&end);
+
+                        time += GetMicroseconds(start, end);
+                    }
+
+                    double meanTime = time / repeats;
+
+                    pMeasurement->Samples = sampleCount;
+                    pMeasurement->Columns = columns;
+                    pMeasurement->MeanTime = static_cast<float>(meanTime);
+                    pMeasurement->RealTimeFactor = (meanTime > 0.0) ? static_cast<float>((1e6 * sampleCount / sampleRate) / meanTime) : 0.0f;
+                }
+
+                // two tones and a little noise
+                static void MakeToneRecording(UINT sampleRate, UINT seconds, _Out_ std::vector<float>& samples)
+                {
+                    std::mt19937 random(5);
+                    std::normal_distribution<float> noise(0.0f, 0.01f);
+
+                    samples.resize(sampleRate * seconds);
+                    for (size_t i = 0; i < samples.size(); ++i)
+                    {
+                        float t = static_cast<float>(i) / sampleRate;
+                        samples[i] = 0.5f * sinf(2.0f * XM_PI * 440.0f * t) + 0.1f * sinf(2.0f * XM_PI * 3000.0f * t) + noise(random);
+                    }
+                }
+
+                // largest difference to the direct transform, over its largest bin magnitude
+                static float GetFftError(UINT size, UINT seed)
+                {
+                    std::mt19937 random(seed);
+                    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+                    std::vector<float> samples(size);
+                    for (float& sample : samples)
+                    {
+                        sample = uniform(random);
+                    }
+
+                    RealFft fft;
+                    fft.Reset(size);
+
+                    UINT binCount = fft.GetBinCount();
+                    std::vector<float> real(binCount), imaginary(binCount), referenceReal(binCount), referenceImaginary(binCount);
+                    fft.Forward(samples.data(), real.data(), imaginary.data());
+                    fft.ForwardReference(samples.data(), referenceReal.data(), referenceImaginary.data());
+
+                    float maxMagnitude = 0.0f;
+                    float maxError = 0.0f;
+                    for (UINT k = 0; k < binCount; ++k)
+                    {
+                        maxMagnitude = max(maxMagnitude, sqrtf(referenceReal[k] * referenceReal[k] + referenceImaginary[k] * referenceImaginary[k]));
+                        maxError = max(maxError, max(fabsf(real[k] - referenceReal[k]), fabsf(imaginary[k] - referenceImaginary[k])));
+                    }
+
+                    return maxError / maxMagnitude;
+                }
+
+                TEST_CLASS(SpectrogramTests)
+                {
+                public:
+                    TEST_METHOD(ForwardMatchesDirectTransform)
+                    {
+                        for (UINT size = 8; size <= 4096; size *= 2)
+                        {
+                            float error = GetFftError(size, size);
+                            LogMessage("%u points: relative error %.2e", size, error);
+                            Assert::IsTrue(error < 1e-6f, L"FFT within 1e-6 of the direct transform");
+                        }
+                    }
+
+                    TEST_METHOD(InverseRestoresSamples)
+                    {
+                        const UINT size = 512;
+                        std::mt19937 random(9);
+                        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+                        std::vector<float> samples(size), restored(size);
+                        for (float& sample : samples)
+                        {
+                            sample = uniform(random);
+                        }
+
+                        RealFft fft;
+                        fft.Reset(size);
+
+                        std::vector<float> real(fft.GetBinCount()), imaginary(fft.GetBinCount());
+                        fft.Forward(samples.data(), real.data(), imaginary.data());
+                        fft.Inverse(real.data(), imaginary.data(), restored.data());
+
+                        float maxError = 0.0f;
+                        for (UINT n = 0; n < size; ++n)
+                        {
+                            maxError = max(maxError, fabsf(restored[n] - samples[n]));
+                        }
+
+                        Assert::IsTrue(maxError < 1e-5f, L"inverse of forward within 1e-5");
+                    }
+
+                    TEST_METHOD(ColumnsMatchDirectTransform)
+                    {
+                        const UINT sampleRate = 16000;
+                        const UINT fftSize = 512;
+                        const UINT hopSize = 160;
+                        const float minEnergy = -90.0f;
+
+                        std::vector<float> samples;
+                        MakeToneRecording(sampleRate, 2, samples);
+
+                        Spectrogram spectrogram;
+                        spectrogram.Reset(fftSize, hopSize, 64, minEnergy);
+
+                        RealFft fft;
+                        fft.Reset(fftSize);
+
+                        // the window and scale the spectrogram documents
+                        std::vector<float> window(fftSize);
+                        double windowSum = 0.0;
+                        for (UINT n = 0; n < fftSize; ++n)
+                        {
+                            window[n] = static_cast<float>(0.5 - 0.5 * cos(2.0 * XM_PI * n / fftSize));
+                            windowSum += window[n];
+                        }
+                        double powerScale = 2.0 / (windowSum * windowSum);
+
+                        UINT binCount = spectrogram.GetBinCount();
+                        std::vector<float> windowed(fftSize), real(binCount), imaginary(binCount);
+
+                        // reads that split frames anywhere
+                        std::mt19937 random(11);
+                        float maxError = 0.0f;
+                        UINT checked = 0;
+                        for (size_t position = 0; position < samples.size(); )
+                        {
+                            UINT count = static_cast<UINT>((std::min)(static_cast<size_t>(1 + random() % 300), samples.size() - position));
+                            UINT columns = spectrogram.Process(&samples[position], count);
+                            position += count;
+
+                            if (0 == columns)
+                            {
+                                continue;
+                            }
+
+                            // the newest column starts hopSize samples after the one before it
+                            size_t start = static_cast<size_t>(spectrogram.GetColumnsWritten() - 1) * hopSize;
+                            for (UINT n = 0; n < fftSize; ++n)
+                            {
+                                windowed[n] = samples[start + n] * window[n];
+                            }
+                            fft.ForwardReference(windowed.data(), real.data(), imaginary.data());
+
+                            const float* pColumn = spectrogram.GetColumn(0);
+                            for (UINT k = 0; k < binCount; ++k)
+                            {
+                                double power = powerScale * (real[k] * real[k] + imaginary[k] * imaginary[k]);
+                                double decibels = 10.0 * log10((std::max)(power, pow(10.0, minEnergy / 10.0)));
+                                float expected = static_cast<float>(1.0 - decibels / minEnergy);
+                                maxError = max(maxError, fabsf(pColumn[k] - expected));
+                            }
+                            checked++;
+                        }
+
+                        LogMessage("%u columns, max error %.2e", checked, maxError);
+                        Assert::AreEqual(static_cast<UINT64>((samples.size() - fftSize) / hopSize + 1), spectrogram.GetColumnsWritten(), L"one column per hop");
+                        Assert::IsTrue(maxError < 1e-4f, L"columns within 1e-4 of the direct transform");
+                    }
+
+                    TEST_METHOD(ToneLandsInItsBin)
+                    {
+                        const UINT sampleRate = 16000;
+                        const UINT fftSize = 512;
+
+                        std::vector<float> samples(fftSize * 4);
+                        for (size_t i = 0; i < samples.size(); ++i)
+                        {
+                            samples[i] = 0.5f * sinf(2.0f * XM_PI * 1000.0f * i / sampleRate);
+                        }
+
+                        Spectrogram spectrogram;
+                        spectrogram.Reset(fftSize, fftSize, 4, -90.0f);
+                        spectrogram.Process(samples.data(), static_cast<UINT>(samples.size()));
+
+                        // 1000 Hz is bin 32 of 512 at 16 kHz; a sine of amplitude a has mean square a^2 / 2
+                        const float* pPower = spectrogram.GetPower();
+                        UINT peak = 0;
+                        for (UINT k = 1; k < spectrogram.GetBinCount(); ++k)
+                        {
+                            if (pPower[k] > pPower[peak])
+                            {
+                                peak = k;
+                            }
+                        }
+
+                        Assert::AreEqual(32u, peak, L"peak bin");
+                        Assert::AreEqual(0.125f, pPower[peak], 1e-3f, L"peak power is the mean square");
+                    }
+
+                    TEST_METHOD(MeasureTenSeconds)
+                    {
+                        std::vector<float> samples;
+                        MakeToneRecording(16000, 10, samples);
+
+                        SpectrogramMeasurement measurement;
+                        MeasureSpectrogram(samples.data(), static_cast<UINT>(samples.size()), 16000, 512, 160, 10, &measurement);
+
+                        LogMessage("%u samples, %u columns: %.0f us, %.0fx real time",
+                            measurement.Samples, measurement.Columns, measurement.MeanTime, measurement.RealTimeFactor);
+
+                        Assert::AreEqual(997u, measurement.Columns, L"columns of 10 s");
+#ifdef NDEBUG
+                        // the audio thread has a 50 ms block to spend, keep this well under 1% of it
+                        Assert::IsTrue(measurement.RealTimeFactor > 200.0f, L"over 200x real time");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,282 @@
+//------------------------------------------------------------------------------
+// <copyright file="TestHelpers.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "TestHelpers.h"
+#include "DirectionOfArrival.h"
+
+#include <cstdarg>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+using namespace KinectEvolution::Xaml::Controls::Tests;
+
+static const float SPEED_OF_SOUND = 343.0f;
+
+// joints of a person standing with the arms down, x and y in meters from the spine base, in JointType order
+static const XMFLOAT3 StandingPose[JOINT_COUNT] =
+{
+    XMFLOAT3(0.0f, 0.0f, 0.0f),         // SpineBase
+    XMFLOAT3(0.0f, 0.3f, 0.0f),         // SpineMid
+    XMFLOAT3(0.0f, 0.62f, 0.0f),        // Neck
+    XMFLOAT3(0.0f, 0.76f, 0.0f),        // Head
+    XMFLOAT3(-0.18f, 0.52f, 0.0f),      // ShoulderLeft
+    XMFLOAT3(-0.22f, 0.25f, 0.0f),      // ElbowLeft
+    XMFLOAT3(-0.24f, 0.02f, 0.0f),      // WristLeft
+    XMFLOAT3(-0.25f, -0.05f, 0.0f),     // HandLeft
+    XMFLOAT3(0.18f, 0.52f, 0.0f),       // ShoulderRight
+    XMFLOAT3(0.22f, 0.25f, 0.0f),       // ElbowRight
+    XMFLOAT3(0.24f, 0.02f, 0.0f),       // WristRight
+    XMFLOAT3(0.25f, -0.05f, 0.0f),      // HandRight
+    XMFLOAT3(-0.08f, -0.05f, 0.0f),     // HipLeft
+    XMFLOAT3(-0.1f, -0.48f, 0.0f),      // KneeLeft
+    XMFLOAT3(-0.1f, -0.88f, 0.0f),      // AnkleLeft
+    XMFLOAT3(-0.1f, -0.93f, -0.1f),     // FootLeft
+    XMFLOAT3(0.08f, -0.05f, 0.0f),      // HipRight
+    XMFLOAT3(0.1f, -0.48f, 0.0f),       // KneeRight
+    XMFLOAT3(0.1f, -0.88f, 0.0f),       // AnkleRight
+    XMFLOAT3(0.1f, -0.93f, -0.1f),      // FootRight
+    XMFLOAT3(0.0f, 0.52f, 0.0f),        // SpineShoulder
+    XMFLOAT3(-0.26f, -0.12f, 0.0f),     // HandTipLeft
+    XMFLOAT3(-0.22f, -0.06f, -0.03f),   // ThumbLeft
+    XMFLOAT3(0.26f, -0.12f, 0.0f),      // HandTipRight
+    XMFLOAT3(0.22f, -0.06f, -0.03f),    // ThumbRight
+};
+
+void KinectEvolution::Xaml::Controls::Tests::LogMessage(_In_ const char* format, ...)
+{
+    char message[512];
+
+    va_list arguments;
+    va_start(arguments, format);
+    vsprintf_s(message, format, arguments);
+    va_end(arguments);
+
+    Logger::WriteMessage(message);
+}
+
+double KinectEvolution::Xaml::Controls::Tests::GetMicroseconds(const LARGE_INTEGER& start, const LARGE_INTEGER& end)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+
+    return static_cast<double>(end.QuadPart - start.QuadPart) * 1e6 / static_cast<double>(frequency.QuadPart);
+}
+
+void KinectEvolution::Xaml::Controls::Tests::AddNoise(_Inout_ std::vector<float>& samples, float deviation, _Inout_ std::mt19937& random)
+{
+    std::normal_distribution<float> noise(0.0f, deviation);
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        samples[i] += noise(random);
+    }
+}
+
+void KinectEvolution::Xaml::Controls::Tests::MakeSpeechRecording(
+    UINT sampleRate,
+    UINT seconds,
+    UINT seed,
+    _Out_ std::vector<float>& samples,
+    _Out_ std::vector<SpeechLabel>& labels)
+{
+    std::mt19937 random(seed);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+
+    samples.assign(sampleRate * seconds, 0.0f);
+    labels.clear();
+
+    AddNoise(samples, 0.003f, random);
+
+    // voiced at a pitch of 110 to 230 Hz with a few harmonics, every third 100 ms a little fricative noise
+    UINT64 start = 2 * sampleRate;
+    while (start + 3 * sampleRate < samples.size())
+    {
+        UINT length = sampleRate / 2 + random() % (3 * sampleRate / 2);
+        float pitch = 110.0f + static_cast<float>(random() % 120);
+        float amplitude = 0.05f + 0.2f * static_cast<float>(random() % 100) / 100.0f;
+
+        for (UINT i = 0; i < length; ++i)
+        {
+            float envelope = sinf(XM_PI * i / length);
+            float phase = XM_2PI * pitch * i / sampleRate;
+
+            float voiced = 0.0f;
+            for (int harmonic = 1; harmonic <= 8; ++harmonic)
+            {
+                voiced += sinf(harmonic * phase) / harmonic;
+            }
+
+            float fricative = 0.02f * noise(random) * ((2 == (i / (sampleRate / 10)) % 3) ? 5.0f : 1.0f);
+            samples[static_cast<size_t>(start) + i] += amplitude * envelope * (0.3f * voiced + fricative);
+        }
+
+        SpeechLabel label = { start, start + length };
+        labels.push_back(label);
+
+        start += length + sampleRate / 2 + random() % (2 * sampleRate);
+    }
+
+    // the room gets noisier half way through
+    std::normal_distribution<float> louder(0.0f, 0.006f);
+    for (size_t i = samples.size() / 2; i < samples.size(); ++i)
+    {
+        samples[i] += louder(random);
+    }
+}
+
+void KinectEvolution::Xaml::Controls::Tests::AddArrayBurst(
+    _Inout_ std::vector<std::vector<float>>& channels,
+    UINT sampleRate,
+    UINT startSample,
+    UINT length,
+    float pitch,
+    float amplitude,
+    float beamAngle)
+{
+    const double duration = static_cast<double>(length) / sampleRate;
+
+    for (UINT m = 0; m < channels.size() && m < KINECT_MICROPHONE_COUNT; ++m)
+    {
+        // a plane wave from beamAngle reaches the microphones further along it first
+        double delay = -KinectMicrophonePositions[m] * sin(beamAngle) / SPEED_OF_SOUND;
+
+        std::vector<float>& channel = channels[m];
+        for (UINT i = 0; i < length && startSample + i < channel.size(); ++i)
+        {
+            double t = static_cast<double>(i) / sampleRate - delay;
+            double envelope = max(0.0, sin(XM_PI * t / duration));
+
+            // a little vibrato keeps the harmonics from lining up with the transform's bins
+            double voiced = 0.0;
+            for (int harmonic = 1; harmonic <= 12; ++harmonic)
+            {
+                voiced += sin(XM_2PI * harmonic * pitch * t * (1.0 + 0.05 * sin(XM_2PI * 3.0 * t))) / harmonic;
+            }
+
+            channel[startSample + i] += static_cast<float>(amplitude * envelope * voiced);
+        }
+    }
+}
+
+bool KinectEvolution::Xaml::Controls::Tests::LoadRecording(
+    const std::vector<std::vector<float>>& channels,
+    UINT sampleRate,
+    WaveSampleFormat format,
+    _Out_ WaveFile& recording)
+{
+    const UINT channelCount = static_cast<UINT>(channels.size());
+    const UINT frameCount = channels.empty() ? 0 : static_cast<UINT>(channels[0].size());
+    const UINT sampleSize = (WaveSampleFormat::Pcm16 == format) ? 2 : 4;
+    const UINT32 dataSize = frameCount * channelCount * sampleSize;
+
+    std::vector<BYTE> file(WAVE_HEADER_SIZE + dataSize);
+    BuildWaveHeader(format, channelCount, sampleRate, dataSize, 0, file.data());
+
+    BYTE* pData = &file[WAVE_HEADER_SIZE];
+    for (UINT frame = 0; frame < frameCount; ++frame)
+    {
+        for (UINT channel = 0; channel < channelCount; ++channel)
+        {
+            float sample = channels[channel][frame];
+            if (WaveSampleFormat::Pcm16 == format)
+            {
+                INT16 value = static_cast<INT16>(max(-1.0f, min(1.0f, sample)) * 32767.0f);
+                memcpy(pData, &value, sizeof(value));
+            }
+            else
+            {
+                memcpy(pData, &sample, sizeof(sample));
+            }
+
+            pData += sampleSize;
+        }
+    }
+
+    return recording.Load(file.data(), file.size());
+}
+
+void KinectEvolution::Xaml::Controls::Tests::MakeSwayingBody(
+    UINT bodyIndex,
+    UINT64 trackingId,
+    float seconds,
+    float noise,
+    _Inout_ std::mt19937& random,
+    _Inout_ BodyFrameData& frame)
+{
+    std::normal_distribution<float> jitter(0.0f, max(noise, 1e-9f));
+
+    // each body at its own pace, so no two poses repeat together
+    const float pace = 1.0f + 0.13f * bodyIndex;
+    const float sway = 0.1f * sinf(XM_2PI * 0.3f * pace * seconds + bodyIndex);
+    const float turn = 0.4f * sinf(XM_2PI * 0.2f * pace * seconds + 2.0f * bodyIndex);
+    const float leftRaise = 0.9f + 0.8f * sinf(XM_2PI * 0.4f * pace * seconds + bodyIndex);
+    const float rightRaise = 0.9f + 0.8f * sinf(XM_2PI * 0.55f * pace * seconds + 3.0f * bodyIndex);
+
+    XMVECTOR rotation = XMQuaternionRotationRollPitchYaw(0.0f, turn, sway);
+    XMVECTOR origin = XMVectorSet(-1.5f + 0.6f * bodyIndex + sway, 0.0f, 2.5f + 0.2f * (bodyIndex % 2), 0.0f);
+
+    frame.IsTracked[bodyIndex] = TRUE;
+    frame.TrackingId[bodyIndex] = trackingId;
+    frame.HandLeftState[bodyIndex] = WRK::HandState::Open;
+    frame.HandRightState[bodyIndex] = WRK::HandState::Closed;
+
+    for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+    {
+        XMVECTOR position = XMLoadFloat3(&StandingPose[jointIndex]);
+
+        // the arm below the shoulder swings out sideways about it
+        BOOL left = (jointIndex >= 5 && jointIndex <= 7) || 21 == jointIndex || 22 == jointIndex;
+        BOOL right = (jointIndex >= 9 && jointIndex <= 11) || 23 == jointIndex || 24 == jointIndex;
+        if (left || right)
+        {
+            XMVECTOR shoulder = XMLoadFloat3(&StandingPose[left ? 4 : 8]);
+            XMVECTOR raise = XMQuaternionRotationRollPitchYaw(0.0f, 0.0f, left ? -leftRaise : rightRaise);
+            position = shoulder + XMVector3Rotate(position - shoulder, raise);
+        }
+
+        position = XMVector3Rotate(position, rotation) + origin;
+
+        UINT i = BodyJointIndex(bodyIndex, jointIndex);
+        frame.PositionX[i] = XMVectorGetX(position) + jitter(random);
+        frame.PositionY[i] = XMVectorGetY(position) + jitter(random);
+        frame.PositionZ[i] = XMVectorGetZ(position) + jitter(random);
+
+        XMFLOAT4 orientation;
+        XMStoreFloat4(&orientation, rotation);
+        frame.OrientationX[i] = orientation.x;
+        frame.OrientationY[i] = orientation.y;
+        frame.OrientationZ[i] = orientation.z;
+        frame.OrientationW[i] = orientation.w;
+
+        frame.TrackingState[i] = WRK::TrackingState::Tracked;
+    }
+}
+
+void KinectEvolution::Xaml::Controls::Tests::RecordSwayingBodies(
+    UINT bodyCount,
+    UINT frameCount,
+    UINT seed,
+    INT64 firstTime,
+    _Inout_ BodyFrameStore& store)
+{
+    std::mt19937 random(seed);
+
+    BodyFrameData frame;
+    for (UINT frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+    {
+        frame.Clear();
+        frame.RelativeTime = firstTime + static_cast<INT64>(frameIndex) * 333333;
+        frame.FloorClipPlane = XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f);
+
+        for (UINT bodyIndex = 0; bodyIndex < bodyCount && bodyIndex < BODY_COUNT; ++bodyIndex)
+        {
+            MakeSwayingBody(bodyIndex, 0x1000 + bodyIndex, frameIndex / 30.0f, 0.003f, random, frame);
+        }
+
+        store.Append(frame);
+    }
+}
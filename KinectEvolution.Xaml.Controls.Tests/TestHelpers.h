@@ -0,0 +1,80 @@
+//------------------------------------------------------------------------------
+// <copyright file="TestHelpers.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameStore.h"
+#include "WaveFile.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                // [StartSample, EndSample) of speech in a labelled recording
+                struct SpeechLabel
+                {
+                    UINT64  StartSample;
+                    UINT64  EndSample;
+                };
+
+                // one line of the test's output, printf style
+                void LogMessage(_In_ const char* format, ...);
+
+                // microseconds between two readings of the performance counter
+                double GetMicroseconds(const LARGE_INTEGER& start, const LARGE_INTEGER& end);
+
+                // bursts of voiced speech between half a second and two seconds long over background noise that
+                // gets louder half way through, labelled where the bursts are
+                void MakeSpeechRecording(
+                    UINT sampleRate,
+                    UINT seconds,
+                    UINT seed,
+                    _Out_ std::vector<float>& samples,
+                    _Out_ std::vector<SpeechLabel>& labels);
+
+                // adds a voiced burst to each channel as the microphone of the sensor's array with the same index
+                // hears it from beamAngle, radians positive towards the array's +x
+                void AddArrayBurst(
+                    _Inout_ std::vector<std::vector<float>>& channels,
+                    UINT sampleRate,
+                    UINT startSample,
+                    UINT length,
+                    float pitch,
+                    float amplitude,
+                    float beamAngle);
+
+                void AddNoise(_Inout_ std::vector<float>& samples, float deviation, _Inout_ std::mt19937& random);
+
+                // writes the channels to a WAV file in memory and reads it back
+                bool LoadRecording(
+                    const std::vector<std::vector<float>>& channels,
+                    UINT sampleRate,
+                    Audio::WaveSampleFormat format,
+                    _Out_ Audio::WaveFile& recording);
+
+                // bodyCount people side by side 2.5 m in front of the sensor, swaying and waving both arms at their
+                // own pace, with a few mm of noise on every joint; one frame every 1/30 s from firstTime
+                void RecordSwayingBodies(
+                    UINT bodyCount,
+                    UINT frameCount,
+                    UINT seed,
+                    INT64 firstTime,
+                    _Inout_ Skeleton::BodyFrameStore& store);
+
+                // the pose of one of the swaying bodies at time seconds
+                void MakeSwayingBody(
+                    UINT bodyIndex,
+                    UINT64 trackingId,
+                    float seconds,
+                    float noise,
+                    _Inout_ std::mt19937& random,
+                    _Inout_ Skeleton::BodyFrameData& frame);
+
+            }
+        }
+    }
+}
@@ -0,0 +1,168 @@
+//------------------------------------------------------------------------------
+// <copyright file="VoiceActivityTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "VoiceActivity.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Tests {
+
+                struct VoiceActivityMeasurement
+                {
+                    UINT    Frames;
+                    float   MeanTime;               // microseconds per pass
+                    float   RealTimeFactor;         // seconds of audio per second of processing
+                    float   FrameAccuracy;          // frames where the detector agrees with the labels
+                    float   SpeechRecall;           // labelled speech frames detected
+                    float   FalseAlarmRate;         // labelled silent frames detected as speech
+                    UINT    Segments;
+                    UINT    LabelledSegments;
+                };
+
+                // the detection of each frame against the labels, and the time of a pass over the whole recording
+                static void MeasureVoiceActivity(
+                    _In_reads_(sampleCount) const float* pSamples,
+                    UINT sampleCount,
+                    UINT sampleRate,
+                    _In_reads_(labelCount) const SpeechLabel* pLabels,
+                    UINT labelCount,
+                    UINT repeats,
+                    _Out_ VoiceActivityMeasurement* pMeasurement)
+                {
+                    ZeroMemory(pMeasurement, sizeof(*pMeasurement));
+
+                    VoiceActivityDetector detector;
+                    double time = 0.0;
+
+                    for (UINT pass = 0; pass < repeats; ++pass)
+                    {
+                        detector.Reset(sampleRate);
+
+                        LARGE_INTEGER start, end;
+                        QueryPerformanceCounter(&start);
+                        detector.Process(pSamples, sampleCount, 0.0f, 0.0f);
+                        QueryPerformanceCounter(&end);
+
+                        time += GetMicroseconds(start, end);
+                    }
+
+                    // once more a frame at a time, a frame is labelled speech when its middle sample is
+                    detector.Reset(sampleRate);
+                    const UINT frameSize = detector.GetFrameSize();
+
+                    UINT frames = 0, agreed = 0, speech = 0, detected = 0, silence = 0, falseAlarms = 0, segments = 0;
+                    BOOL wasSpeaking = FALSE;
+                    for (UINT first = 0; first + frameSize <= sampleCount; first += frameSize)
+                    {
+                        detector.Process(pSamples + first, frameSize, 0.0f, 0.0f);
+
+                        UINT64 middle = first + frameSize / 2;
+                        BOOL labelled = FALSE;
+                        for (UINT i = 0; i < labelCount && !labelled; ++i)
+                        {
+                            labelled = (pLabels[i].StartSample <= middle && middle < pLabels[i].EndSample);
+                        }
+
+                        BOOL speaking = detector.IsSpeaking();
+                        segments += (speaking && !wasSpeaking) ? 1 : 0;
+                        wasSpeaking = speaking;
+
+                        frames++;
+                        agreed += (labelled == speaking) ? 1 : 0;
+                        speech += labelled ? 1 : 0;
+                        detected += (labelled && speaking) ? 1 : 0;
+                        silence += labelled ? 0 : 1;
+                        falseAlarms += (!labelled && speaking) ? 1 : 0;
+                    }
+
+                    double meanTime = time / repeats;
+
+                    pMeasurement->Frames = frames;
+                    pMeasurement->MeanTime = static_cast<float>(meanTime);
+                    pMeasurement->RealTimeFactor = (meanTime > 0.0) ? static_cast<float>((1e6 * sampleCount / sampleRate) / meanTime) : 0.0f;
+                    pMeasurement->FrameAccuracy = (frames > 0) ? static_cast<float>(agreed) / frames : 0.0f;
+                    pMeasurement->SpeechRecall = (speech > 0) ? static_cast<float>(detected) / speech : 0.0f;
+                    pMeasurement->FalseAlarmRate = (silence > 0) ? static_cast<float>(falseAlarms) / silence : 0.0f;
+                    pMeasurement->Segments = segments;
+                    pMeasurement->LabelledSegments = labelCount;
+                }
+
+                TEST_CLASS(VoiceActivityTests)
+                {
+                public:
+                    TEST_METHOD(SilenceIsNotSpeech)
+                    {
+                        std::mt19937 random(1);
+                        std::vector<float> samples(16000 * 5, 0.0f);
+                        AddNoise(samples, 0.003f, random);
+
+                        VoiceActivityDetector detector;
+                        detector.Reset(16000);
+                        detector.Process(samples.data(), static_cast<UINT>(samples.size()), 0.0f, 0.0f);
+
+                        SpeechSegment segment;
+                        Assert::IsFalse(detector.IsSpeaking() || detector.PopSegment(&segment), L"no speech in noise");
+                    }
+
+                    TEST_METHOD(SegmentsCarryTheBeam)
+                    {
+                        std::vector<float> samples;
+                        std::vector<SpeechLabel> labels;
+                        MakeSpeechRecording(16000, 20, 7, samples, labels);
+
+                        // the same recording in reads of 50 ms, from a beam at 0.3 rad
+                        VoiceActivityDetector detector;
+                        detector.Reset(16000);
+                        for (UINT first = 0; first < samples.size(); first += 800)
+                        {
+                            detector.Process(&samples[first], (std::min)(800u, static_cast<UINT>(samples.size()) - first), 0.3f, 0.9f);
+                        }
+
+                        UINT segments = 0;
+                        SpeechSegment segment;
+                        while (detector.PopSegment(&segment))
+                        {
+                            Assert::IsTrue(segment.StartSample < segment.EndSample, L"segment has samples");
+                            Assert::AreEqual(0.3f, segment.BeamAngle, 1e-5f, L"beam angle");
+                            segments++;
+                        }
+
+                        Assert::IsTrue(segments > 0 && segments <= labels.size() + 1, L"about one segment per burst");
+                    }
+
+                    TEST_METHOD(MeasureLabelledRecording)
+                    {
+                        std::vector<float> samples;
+                        std::vector<SpeechLabel> labels;
+                        MakeSpeechRecording(16000, 60, 1, samples, labels);
+
+                        VoiceActivityMeasurement measurement;
+                        MeasureVoiceActivity(samples.data(), static_cast<UINT>(samples.size()), 16000, labels.data(), static_cast<UINT>(labels.size()), 5, &measurement);
+
+                        LogMessage("%u frames: accuracy %.1f%%, recall %.1f%%, false alarms %.1f%%, %u segments for %u labels, %.0fx real time",
+                            measurement.Frames, 100.0f * measurement.FrameAccuracy, 100.0f * measurement.SpeechRecall, 100.0f * measurement.FalseAlarmRate,
+                            measurement.Segments, measurement.LabelledSegments, measurement.RealTimeFactor);
+
+                        // the 300 ms hangover counts against the false alarms
+                        Assert::IsTrue(measurement.FrameAccuracy > 0.8f, L"frame accuracy over 80%");
+                        Assert::IsTrue(measurement.SpeechRecall > 0.75f, L"recall over 75%");
+                        Assert::IsTrue(measurement.FalseAlarmRate < 0.3f, L"false alarms under 30%");
+#ifdef NDEBUG
+                        Assert::IsTrue(measurement.RealTimeFactor > 1000.0f, L"over 1000x real time");
+#endif
+                    }
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,14 @@
+//------------------------------------------------------------------------------
+// <copyright file="pch.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+// the component's sources are built into the tests, with its headers
+#include "..\KinectEvolution.Xaml.Controls\pch.h"
+
+#include "CppUnitTest.h"
+
+#include <random>
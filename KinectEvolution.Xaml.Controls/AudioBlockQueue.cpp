@@ -0,0 +1,189 @@
+//------------------------------------------------------------------------------
+// <copyright file="AudioBlockQueue.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "AudioBlockQueue.h"
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+using namespace Concurrency;
+
+static const double TICKS_PER_MILLISECOND = 10000.0;
+
+AudioBlockQueue::AudioBlockQueue()
+{
+    Reset(3, 256, 16000);
+}
+
+void AudioBlockQueue::Reset(UINT blockCount, UINT blockLength, UINT sampleRate)
+{
+    ASSERT(blockCount > 0 && blockLength > 0 && sampleRate > 0);
+
+    critical_section::scoped_lock lock(_lock);
+
+    AudioBlock empty = { 0, 0, 0, 0, 0 };
+    _blocks.assign(blockCount, empty);
+
+    // handed out from the back, lowest index first
+    _free.clear();
+    _free.reserve(blockCount);
+    for (UINT i = blockCount; i > 0; --i)
+    {
+        _free.push_back(i - 1);
+        _blocks[i - 1].Index = i - 1;
+    }
+
+    _queue.assign(blockCount, 0);
+    _queueHead = 0;
+    _queueCount = 0;
+    _starved = FALSE;
+    _ready.reset();
+
+    _blockLength = blockLength;
+    _sampleRate = sampleRate;
+
+    _completed = 0;
+    _firstIssueTime = -1;
+    _lastCompleteTime = -1;
+    _readTime = 0.0;
+    _latency = 0.0;
+    _gapDeficit = 0.0;
+    ZeroMemory(&_statistics, sizeof(_statistics));
+}
+
+BOOL AudioBlockQueue::Acquire(INT64 time, _Out_ UINT* pIndex)
+{
+    critical_section::scoped_lock lock(_lock);
+
+    if (_free.empty())
+    {
+        if (!_starved)
+        {
+            _starved = TRUE;
+            _statistics.Stalls++;
+        }
+
+        return FALSE;
+    }
+
+    UINT index = _free.back();
+    _free.pop_back();
+
+    _blocks[index].IssueTime = time;
+
+    if (_firstIssueTime < 0)
+    {
+        _firstIssueTime = time;
+    }
+
+    if (_lastCompleteTime >= 0)
+    {
+        _statistics.MaxIdleTime = max(_statistics.MaxIdleTime, static_cast<float>((time - _lastCompleteTime) / TICKS_PER_MILLISECOND));
+    }
+
+    *pIndex = index;
+    return TRUE;
+}
+
+BOOL AudioBlockQueue::HasFreeBlock() const
+{
+    critical_section::scoped_lock lock(_lock);
+
+    return _free.empty() ? FALSE : TRUE;
+}
+
+void AudioBlockQueue::Complete(UINT index, UINT sampleCount, INT64 time)
+{
+    critical_section::scoped_lock lock(_lock);
+
+    AudioBlock& block = _blocks[index];
+    block.SampleCount = sampleCount;
+    block.Sequence = _completed++;
+    block.CompleteTime = time;
+
+    _readTime += (time - block.IssueTime) / TICKS_PER_MILLISECOND;
+    _lastCompleteTime = time;
+    _statistics.Samples += sampleCount;
+
+    // how far the audio read so far trails the clock; it only grows when audio went missing upstream or
+    // the stream stopped
+    double deficit = (time - _firstIssueTime) / TICKS_PER_MILLISECOND - 1000.0 * _statistics.Samples / _sampleRate;
+    double blockTime = 1000.0 * _blockLength / _sampleRate;
+
+    if (1 == _completed || deficit < _gapDeficit)
+    {
+        _gapDeficit = deficit;
+    }
+    else if (deficit > _gapDeficit + blockTime)
+    {
+        _statistics.Gaps++;
+        _gapDeficit = deficit;
+    }
+
+    _statistics.MaxDeficit = max(_statistics.MaxDeficit, static_cast<float>(deficit));
+
+    UINT blockCount = static_cast<UINT>(_blocks.size());
+    _queue[(_queueHead + _queueCount) % blockCount] = index;
+    _queueCount++;
+    _statistics.MaxQueued = max(_statistics.MaxQueued, _queueCount);
+
+    _ready.set();
+}
+
+BOOL AudioBlockQueue::Pop(_Out_ AudioBlock* pBlock)
+{
+    critical_section::scoped_lock lock(_lock);
+
+    if (0 == _queueCount)
+    {
+        // a block completed from here on sets it again
+        _ready.reset();
+        return FALSE;
+    }
+
+    *pBlock = _blocks[_queue[_queueHead]];
+    _queueHead = (_queueHead + 1) % static_cast<UINT>(_blocks.size());
+    _queueCount--;
+
+    return TRUE;
+}
+
+BOOL AudioBlockQueue::Wait(UINT timeout, _Out_ AudioBlock* pBlock)
+{
+    if (Pop(pBlock))
+    {
+        return TRUE;
+    }
+
+    _ready.wait(timeout);
+
+    return Pop(pBlock);
+}
+
+BOOL AudioBlockQueue::Release(const AudioBlock& block, INT64 time)
+{
+    critical_section::scoped_lock lock(_lock);
+
+    double latency = (time - block.CompleteTime) / TICKS_PER_MILLISECOND;
+    _latency += latency;
+    _statistics.MaxLatency = max(_statistics.MaxLatency, static_cast<float>(latency));
+    _statistics.Blocks++;
+
+    _free.push_back(block.Index);
+
+    BOOL starved = _starved;
+    _starved = FALSE;
+
+    return starved;
+}
+
+void AudioBlockQueue::GetStatistics(_Out_ AudioPipelineStatistics* pStatistics) const
+{
+    critical_section::scoped_lock lock(_lock);
+
+    *pStatistics = _statistics;
+    pStatistics->MeanReadTime = (_completed > 0) ? static_cast<float>(_readTime / _completed) : 0.0f;
+    pStatistics->MeanLatency = (_statistics.Blocks > 0) ? static_cast<float>(_latency / _statistics.Blocks) : 0.0f;
+}
@@ -0,0 +1,97 @@
+//------------------------------------------------------------------------------
+// <copyright file="AudioBlockQueue.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // one read of the audio stream into a block of the pool; times are in 100 ns ticks
+                struct AudioBlock
+                {
+                    UINT    Index;              // into the reader's pool of buffers
+                    UINT    SampleCount;
+                    UINT64  Sequence;           // reads completed before this one
+                    INT64   IssueTime;
+                    INT64   CompleteTime;
+                };
+
+                struct AudioPipelineStatistics
+                {
+                    UINT    Blocks;             // handed to the DSP stage
+                    UINT64  Samples;
+                    UINT    Stalls;             // reads that waited for the DSP stage to free a block
+                    UINT    MaxQueued;          // blocks waiting for the DSP stage at once
+                    float   MeanReadTime;       // milliseconds from issuing a read to its completion
+                    float   MeanLatency;        // milliseconds from a read's completion to the DSP stage being done with it
+                    float   MaxLatency;         // milliseconds
+                    float   MaxIdleTime;        // milliseconds with no read in flight
+                    UINT    Gaps;               // reads after which the audio fell another block behind the clock
+                    float   MaxDeficit;         // milliseconds the audio read trails the time since the first read
+                };
+
+                // hands the blocks of a continuous read of the audio stream from the read completions to the DSP
+                // stage. the reader takes a free block for each read and queues it when the read completes, the DSP
+                // stage takes the blocks in order and frees them when done, so there is always a block to read into
+                // while the DSP stage works on earlier ones. the queue also times every block on the way through.
+                class AudioBlockQueue
+                {
+                public:
+                    AudioBlockQueue();
+
+                    // blockLength samples in each of blockCount blocks; drops any queued blocks
+                    void Reset(UINT blockCount, UINT blockLength, UINT sampleRate);
+
+                    UINT GetBlockCount() const { return static_cast<UINT>(_blocks.size()); }
+                    UINT GetBlockLength() const { return _blockLength; }
+
+                    // reader: a free block for the next read, FALSE when all of them wait on the DSP stage, in which
+                    // case the Release that frees one returns TRUE and its caller issues the read
+                    BOOL Acquire(INT64 time, _Out_ UINT* pIndex);
+                    BOOL HasFreeBlock() const;
+                    void Complete(UINT index, UINT sampleCount, INT64 time);
+
+                    // DSP stage: the oldest completed block, waiting up to timeout milliseconds for one
+                    BOOL Wait(UINT timeout, _Out_ AudioBlock* pBlock);
+                    BOOL Release(const AudioBlock& block, INT64 time);
+
+                    void GetStatistics(_Out_ AudioPipelineStatistics* pStatistics) const;
+
+                private:
+                    BOOL Pop(_Out_ AudioBlock* pBlock);
+
+                private:
+                    mutable Concurrency::critical_section _lock;
+                    Concurrency::event          _ready;
+
+                    std::vector<AudioBlock>     _blocks;
+                    std::vector<UINT>           _free;
+                    std::vector<UINT>           _queue;         // ring of completed block indices
+                    UINT                        _queueHead;
+                    UINT                        _queueCount;
+                    BOOL                        _starved;       // the reader found no free block
+
+                    UINT                        _blockLength;
+                    UINT                        _sampleRate;
+
+                    // for the statistics
+                    UINT64                      _completed;
+                    INT64                       _firstIssueTime;
+                    INT64                       _lastCompleteTime;
+                    double                      _readTime;
+                    double                      _latency;
+                    double                      _gapDeficit;    // milliseconds behind at the last gap, or the least since
+                    AudioPipelineStatistics     _statistics;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,431 @@
+//------------------------------------------------------------------------------
+// <copyright file="AudioCapture.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "AudioCapture.h"
+
+#include <chrono>
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+// how long the writer sleeps when the ring is empty, the most a pushed sample waits before it is written
+static const UINT WRITER_PERIOD_MILLISECONDS = 10;
+
+// samples converted and written at a time
+static const UINT WRITE_SAMPLES = 4096;
+
+static const UINT MARK_RING_LENGTH = 256;
+
+// a file written through CreateFile2
+class DiskCaptureFile : public CaptureFile
+{
+public:
+    DiskCaptureFile()
+        : _file(INVALID_HANDLE_VALUE)
+    {
+    }
+
+    virtual ~DiskCaptureFile()
+    {
+        Close();
+    }
+
+    virtual bool Open(const std::wstring& path) override
+    {
+        Close();
+
+        _file = CreateFile2(path.c_str(), GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr);
+        return INVALID_HANDLE_VALUE != _file;
+    }
+
+    virtual bool Write(_In_reads_bytes_(size) const void* pData, UINT size) override
+    {
+        DWORD written = 0;
+        return FALSE != WriteFile(_file, pData, size, &written, nullptr) && written == size;
+    }
+
+    virtual bool WriteAt(UINT64 offset, _In_reads_bytes_(size) const void* pData, UINT size) override
+    {
+        LARGE_INTEGER position, end;
+        position.QuadPart = static_cast<LONGLONG>(offset);
+
+        LARGE_INTEGER zero = {};
+        if (!SetFilePointerEx(_file, zero, &end, FILE_CURRENT) || !SetFilePointerEx(_file, position, nullptr, FILE_BEGIN))
+        {
+            return false;
+        }
+
+        bool written = Write(pData, size);
+        return SetFilePointerEx(_file, end, nullptr, FILE_BEGIN) && written;
+    }
+
+    virtual bool Flush() override
+    {
+        return FALSE != FlushFileBuffers(_file);
+    }
+
+    virtual void Close() override
+    {
+        if (INVALID_HANDLE_VALUE != _file)
+        {
+            CloseHandle(_file);
+            _file = INVALID_HANDLE_VALUE;
+        }
+    }
+
+private:
+    HANDLE  _file;
+};
+
+AudioCaptureWriter::AudioCaptureWriter()
+    : _stopping(false)
+    , _pushedFrames(0)
+    , _pushed(0)
+    , _fileIndex(0)
+    , _fileStartFrame(0)
+    , _fileFrames(0)
+    , _fileBytes(0)
+    , _unflushedBytes(0)
+    , _writtenFrames(0)
+    , _milliseconds(0.0)
+    , _written(0)
+    , _files(0)
+    , _flushes(0)
+    , _failures(0)
+    , _maxWriteTime(0.0f)
+{
+    _settings.Format = WaveSampleFormat::Float32;
+    _settings.ChannelCount = 0;
+    _settings.SampleRate = 0;
+    _settings.RingFrames = 0;
+    _settings.MaxFileBytes = 0;
+    _settings.MaxFileSeconds = 0;
+    _settings.FlushBytes = 0;
+}
+
+AudioCaptureWriter::~AudioCaptureWriter()
+{
+    Stop();
+}
+
+bool AudioCaptureWriter::Start(const AudioCaptureSettings& settings, CaptureFileFactory createFile)
+{
+    Stop();
+
+    if (0 == settings.ChannelCount || 0 == settings.SampleRate || 0 == settings.RingFrames)
+    {
+        return false;
+    }
+
+    _settings = settings;
+    _createFile = createFile ? createFile : []() { return std::unique_ptr<CaptureFile>(new DiskCaptureFile()); };
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    _milliseconds = 1e3 / static_cast<double>(frequency.QuadPart);
+
+    // everything the producer touches is allocated here
+    _ring.Reset(settings.RingFrames * settings.ChannelCount);
+    _pushedFrames = 0;
+    _pushed = 0;
+
+    _marks.Reset(MARK_RING_LENGTH);
+
+    _fileIndex = 0;
+    _fileFrames = 0;
+    _fileBytes = 0;
+    _unflushedBytes = 0;
+    _fileMarks.clear();
+    _converted.resize(WRITE_SAMPLES * sizeof(float));
+    _writtenFrames = 0;
+
+    _written = 0;
+    _files = 0;
+    _flushes = 0;
+    _failures = 0;
+    _maxWriteTime = 0.0f;
+
+    _stopping = false;
+    _writer = std::thread([this]() { WriterLoop(); });
+
+    return true;
+}
+
+void AudioCaptureWriter::Stop()
+{
+    if (!_writer.joinable())
+    {
+        return;
+    }
+
+    _stopping.store(true, std::memory_order_release);
+    _writer.join();
+}
+
+void AudioCaptureWriter::Push(_In_reads_(frameCount * _settings.ChannelCount) const float* pSamples, UINT frameCount, INT64 time)
+{
+    const UINT channelCount = _settings.ChannelCount;
+
+    _pushed.store(_pushed.load(std::memory_order_relaxed) + frameCount, std::memory_order_relaxed);
+
+    // whole frames that fit, the rest is dropped
+    UINT frames = min(frameCount, _ring.GetFreeCount() / channelCount);
+    if (frames < frameCount)
+    {
+        _ring.AddDropped((frameCount - frames) * channelCount);
+    }
+
+    if (0 == frames)
+    {
+        return;
+    }
+
+    // the mark is published before the samples it points at, a full mark ring drops the mark
+    AudioCaptureMark mark;
+    mark.Frame = _pushedFrames;
+    mark.Time = time;
+    _marks.Write(&mark, 1);
+
+    _ring.Write(pSamples, frames * channelCount);
+
+    _pushedFrames += frames;
+}
+
+void AudioCaptureWriter::WriterLoop()
+{
+    const UINT channelCount = _settings.ChannelCount;
+
+    for (;;)
+    {
+        // once stopping is seen, everything pushed before Stop is in the ring
+        bool stopping = _stopping.load(std::memory_order_acquire);
+
+        UINT readable = _ring.GetReadableCount();
+        if (0 == readable)
+        {
+            if (stopping)
+            {
+                break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_PERIOD_MILLISECONDS));
+            continue;
+        }
+
+        Base::RingSpan<float> span = _ring.BeginRead(readable - readable % channelCount);
+        WriteSamples(span.pFirst, span.FirstCount);
+        WriteSamples(span.pSecond, span.SecondCount);
+        _ring.EndRead(span.GetCount());
+    }
+
+    CloseFile();
+}
+
+void AudioCaptureWriter::WriteSamples(_In_reads_(sampleCount) const float* pSamples, UINT sampleCount)
+{
+    const UINT channelCount = _settings.ChannelCount;
+    const UINT bytesPerSample = (WaveSampleFormat::Pcm16 == _settings.Format) ? 2 : 4;
+    const UINT64 maxFileFrames = static_cast<UINT64>(_settings.MaxFileSeconds) * _settings.SampleRate;
+
+    while (sampleCount > 0)
+    {
+        if (!_file && !OpenFile())
+        {
+            // nowhere to write, these samples and their marks are lost
+            _writtenFrames += sampleCount / channelCount;
+            TakeMarks(_writtenFrames);
+            _fileMarks.clear();
+            return;
+        }
+
+        // whole frames up to the end of the file
+        UINT frames = min(sampleCount, WRITE_SAMPLES) / channelCount;
+        if (0 != maxFileFrames)
+        {
+            frames = static_cast<UINT>(min(static_cast<UINT64>(frames), max(maxFileFrames - _fileFrames, 1ull)));
+        }
+        if (0 != _settings.MaxFileBytes)
+        {
+            UINT64 bytesLeft = (_settings.MaxFileBytes > _fileBytes) ? _settings.MaxFileBytes - _fileBytes : 0;
+            frames = static_cast<UINT>(min(static_cast<UINT64>(frames), max(bytesLeft / (channelCount * bytesPerSample), 1ull)));
+        }
+
+        UINT count = frames * channelCount;
+        UINT size = count * bytesPerSample;
+
+        if (WaveSampleFormat::Pcm16 == _settings.Format)
+        {
+            SHORT* pConverted = reinterpret_cast<SHORT*>(_converted.data());
+            for (UINT i = 0; i < count; ++i)
+            {
+                pConverted[i] = static_cast<SHORT>(min(max(pSamples[i], -1.0f), 32767.0f / 32768.0f) * 32768.0f);
+            }
+        }
+        else
+        {
+            memcpy(_converted.data(), pSamples, size);
+        }
+
+        TakeMarks(_writtenFrames + frames);
+
+        LARGE_INTEGER start;
+        QueryPerformanceCounter(&start);
+        if (!_file->Write(_converted.data(), size))
+        {
+            _failures.store(_failures.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        TimeWrite(start);
+
+        pSamples += count;
+        sampleCount -= count;
+
+        _writtenFrames += frames;
+        _fileFrames += frames;
+        _fileBytes += size;
+        _unflushedBytes += size;
+        _written.store(_writtenFrames, std::memory_order_relaxed);
+
+        // a batch of writes at a time goes to the disk
+        if (_unflushedBytes >= _settings.FlushBytes)
+        {
+            QueryPerformanceCounter(&start);
+            _file->Flush();
+            TimeWrite(start);
+
+            _unflushedBytes = 0;
+            _flushes.store(_flushes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        if ((0 != maxFileFrames && _fileFrames >= maxFileFrames) ||
+            (0 != _settings.MaxFileBytes && _fileBytes >= _settings.MaxFileBytes))
+        {
+            CloseFile();
+        }
+    }
+}
+
+void AudioCaptureWriter::TakeMarks(UINT64 endFrame)
+{
+    for (;;)
+    {
+        Base::RingSpan<AudioCaptureMark> span = _marks.BeginRead(1);
+        if (0 == span.GetCount() || span.pFirst->Frame >= endFrame)
+        {
+            break;
+        }
+
+        const AudioCaptureMark& mark = *span.pFirst;
+
+        // frames dropped on the way in are not in the file, the mark counts the frames kept
+        AudioCaptureMark fileMark;
+        fileMark.Frame = mark.Frame - _fileStartFrame;
+        fileMark.Time = mark.Time;
+        _fileMarks.push_back(fileMark);
+
+        _marks.EndRead(1);
+    }
+}
+
+void AudioCaptureWriter::TimeWrite(LARGE_INTEGER start)
+{
+    LARGE_INTEGER end;
+    QueryPerformanceCounter(&end);
+
+    float time = static_cast<float>((end.QuadPart - start.QuadPart) * _milliseconds);
+    if (time > _maxWriteTime.load(std::memory_order_relaxed))
+    {
+        _maxWriteTime.store(time, std::memory_order_relaxed);
+    }
+}
+
+bool AudioCaptureWriter::OpenFile()
+{
+    wchar_t name[32];
+    swprintf_s(name, L"_%04u.wav", _fileIndex++);
+
+    std::unique_ptr<CaptureFile> file = _createFile();
+
+    // the header is written again with the sizes when the file is closed
+    BYTE header[WAVE_HEADER_SIZE];
+    BuildWaveHeader(_settings.Format, _settings.ChannelCount, _settings.SampleRate, 0, 0, header);
+
+    if (!file || !file->Open(_settings.Folder + L"\\" + _settings.BaseName + name) || !file->Write(header, WAVE_HEADER_SIZE))
+    {
+        _failures.store(_failures.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    _file = std::move(file);
+    _fileStartFrame = _writtenFrames;
+    _fileFrames = 0;
+    _fileBytes = WAVE_HEADER_SIZE;
+    _unflushedBytes = 0;
+    _fileMarks.clear();
+
+    _files.store(_files.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+void AudioCaptureWriter::CloseFile()
+{
+    if (!_file)
+    {
+        return;
+    }
+
+    UINT32 dataSize = static_cast<UINT32>(_fileBytes - WAVE_HEADER_SIZE);
+    if (dataSize & 1)
+    {
+        BYTE padding = 0;
+        _file->Write(&padding, 1);
+    }
+
+    // the marks in a "time" chunk, which readers of the samples skip
+    UINT32 marksSize = static_cast<UINT32>(_fileMarks.size() * sizeof(AudioCaptureMark));
+    BYTE chunkHeader[8];
+    memcpy(chunkHeader, "time", 4);
+    memcpy(chunkHeader + 4, &marksSize, sizeof(marksSize));
+    _file->Write(chunkHeader, sizeof(chunkHeader));
+    if (marksSize > 0)
+    {
+        _file->Write(_fileMarks.data(), marksSize);
+    }
+
+    BYTE header[WAVE_HEADER_SIZE];
+    BuildWaveHeader(_settings.Format, _settings.ChannelCount, _settings.SampleRate, dataSize, sizeof(chunkHeader) + marksSize, header);
+    _file->WriteAt(0, header, WAVE_HEADER_SIZE);
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+    _file->Flush();
+    TimeWrite(start);
+    _flushes.store(_flushes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    _file->Close();
+    _file.reset();
+}
+
+void AudioCaptureWriter::GetStatistics(_Out_ AudioCaptureStatistics* pStatistics) const
+{
+    Base::RingStatistics ring;
+    _ring.GetStatistics(&ring);
+
+    Base::RingStatistics marks;
+    _marks.GetStatistics(&marks);
+
+    const UINT channelCount = max(_settings.ChannelCount, 1u);
+
+    pStatistics->Pushed = _pushed.load(std::memory_order_relaxed);
+    pStatistics->Written = _written.load(std::memory_order_relaxed);
+    pStatistics->Dropped = ring.Dropped / channelCount;
+    pStatistics->MarksDropped = marks.Dropped;
+    pStatistics->Files = _files.load(std::memory_order_relaxed);
+    pStatistics->Flushes = _flushes.load(std::memory_order_relaxed);
+    pStatistics->Failures = _failures.load(std::memory_order_relaxed);
+    pStatistics->MaxFill = ring.MaxFill;
+    pStatistics->MaxWriteTime = _maxWriteTime.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,138 @@
+//------------------------------------------------------------------------------
+// <copyright file="AudioCapture.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "SpscRing.h"
+#include "WaveFile.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                struct AudioCaptureSettings
+                {
+                    std::wstring        Folder;             // files are Folder\BaseName_0000.wav, Folder\BaseName_0001.wav ...
+                    std::wstring        BaseName;
+                    WaveSampleFormat    Format;
+                    UINT                ChannelCount;       // samples are pushed interleaved
+                    UINT                SampleRate;
+                    UINT                RingFrames;         // frames the writer may fall behind before they are dropped
+                    UINT64              MaxFileBytes;       // the next file is started past either limit, 0 for none
+                    UINT                MaxFileSeconds;
+                    UINT                FlushBytes;         // written bytes between flushes to the disk
+                };
+
+                struct AudioCaptureStatistics
+                {
+                    UINT64  Pushed;                 // frames
+                    UINT64  Written;
+                    UINT64  Dropped;
+                    UINT64  MarksDropped;
+                    UINT    Files;
+                    UINT    Flushes;
+                    UINT    Failures;               // files that could not be opened or written
+                    UINT    MaxFill;                // most samples waiting in the ring
+                    float   MaxWriteTime;           // milliseconds, longest write or flush
+                };
+
+                // the time a frame of a file was pushed with, kept in a "time" chunk after the samples
+                struct AudioCaptureMark
+                {
+                    UINT64  Frame;
+                    INT64   Time;
+                };
+
+                // where the writer puts its bytes; the default writes a file through CreateFile2
+                class CaptureFile
+                {
+                public:
+                    virtual ~CaptureFile() {}
+
+                    virtual bool Open(const std::wstring& path) = 0;
+                    virtual bool Write(_In_reads_bytes_(size) const void* pData, UINT size) = 0;
+                    virtual bool WriteAt(UINT64 offset, _In_reads_bytes_(size) const void* pData, UINT size) = 0;
+                    virtual bool Flush() = 0;
+                    virtual void Close() = 0;
+                };
+
+                typedef std::function<std::unique_ptr<CaptureFile>()> CaptureFileFactory;
+
+                // copies pushed samples into a ring allocated up front and returns at once; a writer thread of its
+                // own drains the ring into WAV files, flushing in batches and starting a new file by size or
+                // duration. a stalled disk only fills the ring, and what does not fit is dropped and counted, so the
+                // pushing thread never waits on the disk. each push's time is kept with its first frame.
+                class AudioCaptureWriter
+                {
+                public:
+                    AudioCaptureWriter();
+                    ~AudioCaptureWriter();
+
+                    // starts the writer thread, files come from createFile when it is given
+                    bool Start(const AudioCaptureSettings& settings, CaptureFileFactory createFile = nullptr);
+
+                    // writes what is in the ring, closes the file and joins the writer thread
+                    void Stop();
+
+                    BOOL IsRunning() const { return _writer.joinable(); }
+
+                    // frameCount interleaved frames, with the time of the first in 100 ns ticks
+                    void Push(_In_reads_(frameCount * _settings.ChannelCount) const float* pSamples, UINT frameCount, INT64 time);
+
+                    // from any thread, the counts may be a moment apart
+                    void GetStatistics(_Out_ AudioCaptureStatistics* pStatistics) const;
+
+                private:
+                    void WriterLoop();
+                    void WriteSamples(_In_reads_(sampleCount) const float* pSamples, UINT sampleCount);
+                    bool OpenFile();
+                    void CloseFile();
+                    void TakeMarks(UINT64 endFrame);
+                    void TimeWrite(LARGE_INTEGER start);
+
+                private:
+                    AudioCaptureSettings        _settings;
+                    CaptureFileFactory          _createFile;
+                    std::thread                 _writer;
+                    std::atomic<bool>           _stopping;
+
+                    // producer
+                    Base::SpscRing<float>       _ring;
+                    UINT64                      _pushedFrames;
+                    std::atomic<UINT64>         _pushed;
+
+                    // marks of the frames pushed, each published before the frames' samples
+                    Base::SpscRing<AudioCaptureMark> _marks;
+
+                    // writer
+                    std::unique_ptr<CaptureFile> _file;
+                    UINT                        _fileIndex;
+                    UINT64                      _fileStartFrame;
+                    UINT64                      _fileFrames;
+                    UINT64                      _fileBytes;
+                    UINT                        _unflushedBytes;
+                    std::vector<AudioCaptureMark> _fileMarks;
+                    std::vector<BYTE>           _converted;
+                    UINT64                      _writtenFrames;
+                    double                      _milliseconds;  // per performance counter tick
+
+                    std::atomic<UINT64>         _written;
+                    std::atomic<UINT>           _files;
+                    std::atomic<UINT>           _flushes;
+                    std::atomic<UINT>           _failures;
+                    std::atomic<float>          _maxWriteTime;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,224 @@
+//------------------------------------------------------------------------------
+// <copyright file="AudioEnergy.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "AudioEnergy.h"
+
+#include <vector>
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+static const XMVECTORU32 MantissaMask = { 0x007FFFFF, 0x007FFFFF, 0x007FFFFF, 0x007FFFFF };
+static const XMVECTORF32 Sqrt2 = { 1.41421356f, 1.41421356f, 1.41421356f, 1.41421356f };
+static const XMVECTORF32 Ln2 = { 0.69314718f, 0.69314718f, 0.69314718f, 0.69314718f };
+static const XMVECTORF32 DecibelsPerNeper = { 4.34294482f, 4.34294482f, 4.34294482f, 4.34294482f };    // 10 / ln(10)
+static const XMVECTORF32 LaneIndex = { 0.0f, 1.0f, 2.0f, 3.0f };
+
+// 2 atanh(t) = ln((1 + t) / (1 - t)) as 2 (t + t^3 / 3 + t^5 / 5 + t^7 / 7 + t^9 / 9)
+static const float AtanhSeries[] = { 2.0f, 2.0f / 3.0f, 2.0f / 5.0f, 2.0f / 7.0f, 2.0f / 9.0f };
+
+// largest group the vector path sums, the rest go one sample at a time
+static const UINT MAX_VECTOR_GROUP = 256;
+
+XMVECTOR KinectEvolution::Xaml::Controls::Audio::XMVectorDecibels(FXMVECTOR x)
+{
+    // x = m 2^e with m in [1, 2)
+    __m128i bits = _mm_castps_si128(x);
+    XMVECTOR e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    const XMVECTOR one = XMVectorSplatOne();
+    XMVECTOR m = XMVectorOrInt(XMVectorAndInt(x, MantissaMask), one);
+
+    // moved to [sqrt(1/2), sqrt(2)) so |t| stays below 0.172 and the series converges in 5 terms
+    XMVECTOR above = XMVectorGreater(m, Sqrt2);
+    m = XMVectorSelect(m, m * 0.5f, above);
+    e = XMVectorSelect(e, e + one, above);
+
+    XMVECTOR t = XMVectorDivide(m - one, m + one);
+    XMVECTOR t2 = t * t;
+
+    XMVECTOR series = XMVectorReplicate(AtanhSeries[4]);
+    series = XMVectorMultiplyAdd(series, t2, XMVectorReplicate(AtanhSeries[3]));
+    series = XMVectorMultiplyAdd(series, t2, XMVectorReplicate(AtanhSeries[2]));
+    series = XMVectorMultiplyAdd(series, t2, XMVectorReplicate(AtanhSeries[1]));
+    series = XMVectorMultiplyAdd(series, t2, XMVectorReplicate(AtanhSeries[0]));
+
+    XMVECTOR ln = XMVectorMultiplyAdd(e, Ln2, series * t);
+
+    return XMVectorMultiply(ln, DecibelsPerNeper);
+}
+
+AudioEnergyMeter::AudioEnergyMeter()
+{
+    Reset(15, -90.0f);
+}
+
+void AudioEnergyMeter::Reset(UINT samplesPerEnergy, float minEnergy)
+{
+    ASSERT(samplesPerEnergy > 0 && minEnergy < 0.0f);
+
+    _samplesPerEnergy = samplesPerEnergy;
+    _minEnergy = minEnergy;
+    _minMeanSquare = powf(10.0f, minEnergy / 10.0f);
+
+    _carrySum = 0.0f;
+    _carryCount = 0;
+}
+
+float AudioEnergyMeter::Normalize(float sumOfSquares) const
+{
+    float meanSquare = max(sumOfSquares / _samplesPerEnergy, _minMeanSquare);
+
+    // renormalize signal above noise floor to [0,1] range for visualization
+    return (_minEnergy - 10.0f * log10f(meanSquare)) / _minEnergy;
+}
+
+UINT AudioEnergyMeter::ProcessReference(
+    _In_reads_(sampleCount) const float* pSamples,
+    UINT sampleCount,
+    _Out_writes_(ringLength) float* pRing,
+    UINT ringLength,
+    UINT ringIndex)
+{
+    UINT written = 0;
+
+    for (UINT i = 0; i < sampleCount; ++i)
+    {
+        _carrySum += pSamples[i] * pSamples[i];
+
+        if (++_carryCount < _samplesPerEnergy)
+        {
+            continue;
+        }
+
+        pRing[ringIndex] = Normalize(_carrySum);
+        ringIndex = (ringIndex + 1) % ringLength;
+        written++;
+
+        _carrySum = 0.0f;
+        _carryCount = 0;
+    }
+
+    return written;
+}
+
+UINT AudioEnergyMeter::Process(
+    _In_reads_(sampleCount) const float* pSamples,
+    UINT sampleCount,
+    _Out_writes_(ringLength) float* pRing,
+    UINT ringLength,
+    UINT ringIndex)
+{
+    const UINT groupLength = _samplesPerEnergy;
+
+    UINT written = 0;
+    UINT i = 0;
+
+    // complete the group the last call cut off
+    if (_carryCount > 0)
+    {
+        UINT needed = min(groupLength - _carryCount, sampleCount);
+        written = ProcessReference(pSamples, needed, pRing, ringLength, ringIndex);
+        ringIndex = (ringIndex + written) % ringLength;
+        i = needed;
+    }
+
+    if (groupLength <= MAX_VECTOR_GROUP)
+    {
+        // each group is summed over whole vectors, the last one masked to the lanes inside the group
+        const UINT vectorCount = (groupLength + 3) / 4;
+        const UINT tail = groupLength & 3;
+        const XMVECTOR tailMask = (0 == tail) ? XMVectorTrueInt() : XMVectorLess(LaneIndex, XMVectorReplicate(static_cast<float>(tail)));
+
+        const XMVECTOR one = XMVectorSplatOne();
+        const XMVECTOR invGroupLength = XMVectorReplicate(1.0f / groupLength);
+        const XMVECTOR minSum = XMVectorReplicate(_minMeanSquare * groupLength);
+        const XMVECTOR invMinEnergy = XMVectorReplicate(1.0f / _minEnergy);
+
+        // 4 groups at a time while the loads of the fourth stay inside the samples
+        while (sampleCount - i >= 3 * groupLength + 4 * vectorCount)
+        {
+            XMVECTOR sums[4];
+
+            for (UINT group = 0; group < 4; ++group)
+            {
+                const float* pGroup = pSamples + i + group * groupLength;
+
+                XMVECTOR sum = XMVectorZero();
+                for (UINT v = 0; v + 1 < vectorCount; ++v)
+                {
+                    XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pGroup + 4 * v));
+                    sum = XMVectorMultiplyAdd(x, x, sum);
+                }
+
+                XMVECTOR x = XMVectorAndInt(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pGroup + 4 * (vectorCount - 1))), tailMask);
+                sums[group] = XMVectorMultiplyAdd(x, x, sum);
+            }
+
+            // lane g of the transposed rows' sum is the total of group g
+            XMMATRIX lanes = XMMatrixTranspose(XMMATRIX(sums[0], sums[1], sums[2], sums[3]));
+            XMVECTOR meanSquare = XMVectorMax((lanes.r[0] + lanes.r[1]) + (lanes.r[2] + lanes.r[3]), minSum) * invGroupLength;
+
+            // (minEnergy - dB) / minEnergy
+            XMVECTOR energy = one - XMVectorDecibels(meanSquare) * invMinEnergy;
+
+            if (ringIndex + 4 <= ringLength)
+            {
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pRing + ringIndex), energy);
+            }
+            else
+            {
+                XMFLOAT4 values;
+                XMStoreFloat4(&values, energy);
+
+                const float* pValues = &values.x;
+                for (UINT lane = 0; lane < 4; ++lane)
+                {
+                    pRing[(ringIndex + lane) % ringLength] = pValues[lane];
+                }
+            }
+
+            ringIndex = (ringIndex + 4) % ringLength;
+            written += 4;
+            i += 4 * groupLength;
+        }
+    }
+
+    // the last few groups and the start of the next one
+    written += ProcessReference(pSamples + i, sampleCount - i, pRing, ringLength, ringIndex);
+
+    return written;
+}
+
+UINT AudioEnergyMeter::Process(
+    _In_reads_(sampleCount) const float* pSamples,
+    UINT sampleCount,
+    _Inout_ EnergyRing& ring)
+{
+    UINT freeCount = ring.GetFreeCount();
+    UINT energyCount = GetEnergyCount(sampleCount);
+
+    BOOL overrun = (energyCount > freeCount);
+    if (overrun)
+    {
+        // up to the end of the last group that fits
+        UINT keptSamples = freeCount * _samplesPerEnergy;
+        sampleCount = (keptSamples > _carryCount) ? keptSamples - _carryCount : 0;
+
+        ring.AddDropped(energyCount - freeCount);
+    }
+
+    UINT written = Process(pSamples, sampleCount, ring.GetStorage(), ring.GetCapacity(), ring.GetWriteIndex());
+    ring.EndWrite(written);
+
+    if (overrun)
+    {
+        // the next group starts with the next read
+        _carrySum = 0.0f;
+        _carryCount = 0;
+    }
+
+    return written;
+}
@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------------
+// <copyright file="AudioEnergy.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "EnergyRing.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // 10 log10(x) for 4 positive normal values, within 2e-5 dB
+                DirectX::XMVECTOR XMVectorDecibels(DirectX::FXMVECTOR x);
+
+                // turns samples into the energy display values: the mean square of every group of samples in dB,
+                // mapped from [minEnergy, 0] dB onto [0, 1]. groups are summed 4 at a time and a group cut off at
+                // the end of one call is completed by the next.
+                class AudioEnergyMeter
+                {
+                public:
+                    AudioEnergyMeter();
+
+                    // drops any partial group
+                    void Reset(UINT samplesPerEnergy, float minEnergy);
+
+                    UINT GetSamplesPerEnergy() const { return _samplesPerEnergy; }
+
+                    // energies the next Process call of sampleCount samples writes
+                    UINT GetEnergyCount(UINT sampleCount) const { return (_carryCount + sampleCount) / _samplesPerEnergy; }
+
+                    // writes the energies into the ring from ringIndex on, wrapping at ringLength; returns how many
+                    UINT Process(
+                        _In_reads_(sampleCount) const float* pSamples,
+                        UINT sampleCount,
+                        _Out_writes_(ringLength) float* pRing,
+                        UINT ringLength,
+                        UINT ringIndex);
+
+                    // publishes the energies to the ring's consumer. when it has fallen behind, the groups that fit
+                    // are kept and the rest of the samples dropped and counted, the producer never waits
+                    UINT Process(
+                        _In_reads_(sampleCount) const float* pSamples,
+                        UINT sampleCount,
+                        _Inout_ EnergyRing& ring);
+
+                    // the same one sample and one log10 at a time, to check Process against
+                    UINT ProcessReference(
+                        _In_reads_(sampleCount) const float* pSamples,
+                        UINT sampleCount,
+                        _Out_writes_(ringLength) float* pRing,
+                        UINT ringLength,
+                        UINT ringIndex);
+
+                private:
+                    float Normalize(float sumOfSquares) const;
+
+                private:
+                    UINT    _samplesPerEnergy;
+                    float   _minEnergy;
+                    float   _minMeanSquare;     // mean square at minEnergy, anything quieter shows as silence
+
+                    // partial group carried over from the last call
+                    float   _carrySum;
+                    UINT    _carryCount;
+                };
+
+            }
+        }
+    }
+}
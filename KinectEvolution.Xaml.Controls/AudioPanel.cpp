@@ -25,13 +25,14 @@ static XMVECTOR vAudioTextColor = { 0, 1.0f, 0, 1.0f };
 
 AudioPanel::AudioPanel()
     : Panel()
-    , _fAccumulatedSquareSum(0.0)
     , _fEnergyError(0.0)
-    , _nAccumulatedSampleCount(0)
-    , _nEnergyIndex(0)
-    , _nEnergyRefreshIndex(0)
-    , _nNewEnergyAvailable(0)
     , _nLastEnergyRefreshTime(0)
+    , _reading(false)
+    , _readPending(false)
+    , _energyHistoryLength(0)
+    , _speaking(false)
+    , _computeSpectrogram(false)
+    , _recordingTime(0.0)
     , _loadingComplete(FALSE)
 {
     critical_section::scoped_lock lock(_criticalSection);
@@ -39,8 +40,36 @@ AudioPanel::AudioPanel()
     CreateDeviceResources();
     CreateSizeDependentResources();
 
-    _fEnergyBuffer = ref new Platform::Array<float>(cEnergyBufferLength);
+    _audioBlocks.Reset(cAudioReadBlockCount, cAudioReadBlockLength, cAudioSamplesPerSecond);
+    for (int i = 0; i < cAudioReadBlockCount; ++i)
+    {
+        _readBuffers.push_back(ref new Windows::Storage::Streams::Buffer(cAudioReadBlockLength * sizeof(FLOAT)));
+    }
+    _readResults.resize(cAudioReadBlockCount);
+
     _fEnergyDisplayBuffer = ref new Platform::Array<float>(cEnergySamplesToDisplay);
+
+    _energyMeter.Reset(cAudioSamplesPerEnergySample, cMinEnergy);
+    _energyRing.Reset(cEnergyBufferLength);
+    _voiceActivity.Reset(cAudioSamplesPerSecond);
+
+    // the history lives in a temporary file of this panel's own mapped into memory, or in the paging file when
+    // that fails
+    GUID historyId;
+    wchar_t historyName[48] = L"energy";
+    if (SUCCEEDED(CoCreateGuid(&historyId)))
+    {
+        StringFromGUID2(historyId, historyName + 6, ARRAYSIZE(historyName) - 6);
+    }
+
+    Platform::String^ historyPath = Windows::Storage::ApplicationData::Current->TemporaryFolder->Path + L"\\" + ref new Platform::String(historyName) + L".bin";
+    if (!_energyHistory.Open(historyPath->Data(), cEnergyHistoryLength))
+    {
+        _energyHistory.Open(nullptr, cEnergyHistoryLength);
+    }
+
+    _energyHistoryColumns.resize(cEnergySamplesToDisplay);
+    _energyHistoryDisplay.resize(cEnergySamplesToDisplay);
 }
 
 AudioPanel::~AudioPanel()
@@ -56,19 +85,34 @@ void AudioPanel::StartRenderLoop()
         return;
     }
 
-    _audioTimer.SecondsToTicks(cAudioReadTimerInterval / 1000.0);
+    _reading = true;
 
     auto audioHandler = ref new WorkItemHandler([this](IAsyncAction ^ action)
     {
+        IssueRead();
+
         while (action->Status == AsyncStatus::Started)
         {
-            _audioTimer.Tick([&]()
+            // process each block as soon as its read completes
+            Audio::AudioBlock block;
+            if (!_audioBlocks.Wait(cAudioReadTimeout, &block))
+            {
+                // nothing read for a while: a new source, or a read that failed and was not issued again
+                IssueRead();
+                continue;
+            }
+
             {
                 critical_section::scoped_lock lock(_processingLock);
 
-                ProcessAudio();
-            });
+                ProcessAudio(block);
+            }
 
+            // the reads stopped for want of a free block, and this one is free now
+            if (_audioBlocks.Release(block, Audio::SpeakerAttribution::GetTime()))
+            {
+                IssueRead();
+            }
         }
     });
 
@@ -80,7 +124,9 @@ void AudioPanel::StartRenderLoop()
 
 void AudioPanel::StopRenderLoop()
 {
-    // Cancel the asynchronous task and let the render thread exit.
+    // Cancel the asynchronous task and let the render thread exit, the read in flight is the last.
+    _reading = false;
+
     if (nullptr != _audioLoopWorker)
     {
         _audioLoopWorker->Cancel();
@@ -91,7 +137,7 @@ void AudioPanel::StopRenderLoop()
 
 void AudioPanel::Update(double elapsedTime)
 {
-    UpdateBeamAngle();
+    UpdateBeamAngle(elapsedTime);
 
     UpdateEnergy();
 }
@@ -152,18 +198,204 @@ void AudioPanel::AudioSource::set(_In_ WRK::AudioSource^ value)
         Windows::Foundation::Collections::IVectorView<AudioBeam^>^ audioBeamList = _audioSource->AudioBeams;
         _audioBeam = audioBeamList->GetAt(0);
         _audioStream = _audioBeam->OpenInputStream();
-        _dataBuffer = ref new Windows::Storage::Streams::Buffer(cEnergyBufferLength);
     }
     else
     {
         _audioBeam = nullptr;
         _audioStream = nullptr;
-        _dataBuffer = nullptr;
     }
 
+    // start reading the new stream, or the read in flight moves on to it when it completes
+    IssueRead();
+
     NotifyPropertyChanged("AudioSource");
 }
 
+// recording property
+void AudioPanel::RecordingFile::set(Platform::String^ value)
+{
+    {
+        critical_section::scoped_lock lock(_recordingLock);
+
+        if (_recordingFile == value)
+        {
+            return;
+        }
+
+        _recordingFile = value;
+
+        // back to the sensor's beam until the new recording is read
+        _recording = Audio::WaveFile();
+        _recordingTime = 0.0;
+    }
+
+    if (nullptr != value && !value->IsEmpty())
+    {
+        DX::ReadDataAsync(value->Data()).then([this, value](const std::vector<byte>& fileData)
+        {
+            critical_section::scoped_lock lock(_recordingLock);
+
+            // a later file may have been set while this one was read
+            if (_recordingFile == value && !fileData.empty() && _recording.Load(fileData.data(), fileData.size()))
+            {
+                _directionOfArrival.Reset(_recording.GetSampleRate(), cDirectionFrameSize, Audio::KinectMicrophonePositions, Audio::KINECT_MICROPHONE_COUNT, 50.0f * XM_PI / 180.0f, cDirectionAngleCount);
+            }
+        });
+    }
+
+    NotifyPropertyChanged("RecordingFile");
+}
+
+Platform::String^ AudioPanel::RecordingFile::get()
+{
+    return _recordingFile;
+}
+
+// capture property
+void AudioPanel::CaptureAudio::set(bool value)
+{
+    if (value == CaptureAudio)
+    {
+        return;
+    }
+
+    std::unique_ptr<Audio::AudioCaptureWriter> writer;
+
+    if (value)
+    {
+        Audio::AudioCaptureSettings settings;
+        settings.Folder = Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data();
+        settings.BaseName = L"audio";
+        settings.Format = Audio::WaveSampleFormat::Float32;
+        settings.ChannelCount = 1;
+        settings.SampleRate = cAudioSamplesPerSecond;
+        settings.RingFrames = cCaptureRingSeconds * cAudioSamplesPerSecond;
+        settings.MaxFileBytes = 0;
+        settings.MaxFileSeconds = cCaptureFileSeconds;
+        settings.FlushBytes = cCaptureFlushBytes;
+
+        writer.reset(new Audio::AudioCaptureWriter());
+        if (!writer->Start(settings))
+        {
+            return;
+        }
+    }
+
+    {
+        critical_section::scoped_lock lock(_processingLock);
+
+        if (value == (nullptr != _captureWriter))
+        {
+            return;
+        }
+
+        _captureWriter.swap(writer);
+    }
+
+    // a stopped writer finishes its file here, without holding up the audio
+    writer.reset();
+
+    NotifyPropertyChanged("CaptureAudio");
+}
+
+bool AudioPanel::CaptureAudio::get()
+{
+    critical_section::scoped_lock lock(_processingLock);
+
+    return nullptr != _captureWriter;
+}
+
+// energy history property
+void AudioPanel::EnergyHistorySeconds::set(double value)
+{
+    double energiesPerSecond = static_cast<double>(cAudioSamplesPerSecond) / cAudioSamplesPerEnergySample;
+    double length = min(max(value, 0.0) * energiesPerSecond, static_cast<double>(cEnergyHistoryLength));
+
+    _energyHistoryLength = static_cast<UINT>(length);
+
+    NotifyPropertyChanged("EnergyHistorySeconds");
+}
+
+double AudioPanel::EnergyHistorySeconds::get()
+{
+    return static_cast<double>(_energyHistoryLength) * cAudioSamplesPerEnergySample / cAudioSamplesPerSecond;
+}
+
+// speech property
+bool AudioPanel::IsSpeaking::get()
+{
+    return _speaking;
+}
+
+// speaker attribution property
+Audio::SpeakerAttributionSource^ AudioPanel::Speakers::get()
+{
+    critical_section::scoped_lock lock(_processingLock);
+
+    return _speakers;
+}
+
+void AudioPanel::Speakers::set(_In_ Audio::SpeakerAttributionSource^ value)
+{
+    {
+        critical_section::scoped_lock lock(_processingLock);
+
+        if (_speakers == value)
+        {
+            return;
+        }
+
+        _speakers = value;
+    }
+
+    NotifyPropertyChanged("Speakers");
+}
+
+// spectrogram property
+void AudioPanel::ComputeSpectrogram::set(bool value)
+{
+    {
+        critical_section::scoped_lock lock(_processingLock);
+
+        if (value == _computeSpectrogram)
+        {
+            return;
+        }
+
+        // no columns left from before it was last turned off
+        if (value)
+        {
+            _spectrogram.Reset(cSpectrogramFftSize, cSpectrogramHopSize, cSpectrogramColumns, cMinEnergy);
+        }
+
+        _computeSpectrogram = value;
+    }
+
+    NotifyPropertyChanged("ComputeSpectrogram");
+}
+
+bool AudioPanel::ComputeSpectrogram::get()
+{
+    return _computeSpectrogram;
+}
+
+Platform::Array<float>^ AudioPanel::GetSpectrogramColumn(unsigned int age)
+{
+    critical_section::scoped_lock lock(_processingLock);
+
+    if (!_computeSpectrogram)
+    {
+        return ref new Platform::Array<float>(0);
+    }
+
+    if (age >= _spectrogram.GetColumnCount())
+    {
+        throw ref new Platform::InvalidArgumentException();
+    }
+
+    return ref new Platform::Array<float>(const_cast<float*>(_spectrogram.GetColumn(age)), _spectrogram.GetBinCount());
+}
+
 void AudioPanel::NotifyPropertyChanged(_In_ Platform::String^ prop)
 {
     PropertyChangedEventArgs^ args = ref new PropertyChangedEventArgs(prop);
@@ -171,85 +403,111 @@ void AudioPanel::NotifyPropertyChanged(_In_ Platform::String^ prop)
 }
 
 
-// process the avaiable audio data
-void AudioPanel::ProcessAudio()
+// keep one read of the audio stream in flight, each into a free block of the pool
+void AudioPanel::IssueRead()
 {
-    if (nullptr == _audioSource)
+    Windows::Storage::Streams::IInputStream^ audioStream = _audioStream;
+    UINT index;
+
+    for (;;)
     {
-        return;
+        if (!_reading || nullptr == audioStream || _readPending.exchange(true))
+        {
+            return;
+        }
+
+        if (_audioBlocks.Acquire(Audio::SpeakerAttribution::GetTime(), &index))
+        {
+            break;
+        }
+
+        // the audio thread issues the read when it frees a block. a block freed since Acquire failed went to an
+        // IssueRead that found this one pending and left the read to it, so look again once it is not pending
+        _readPending = false;
+        if (!_audioBlocks.HasFreeBlock())
+        {
+            return;
+        }
     }
 
-    if (_audioSource->AudioBeams->Size > 0)
+    Windows::Storage::Streams::Buffer^ readBuffer = _readBuffers[index];
+    auto asyncReadOp = audioStream->ReadAsync(readBuffer, readBuffer->Capacity, Windows::Storage::Streams::InputStreamOptions::None);
+
+    Concurrency::create_task(asyncReadOp).then([this, index](Concurrency::task<Windows::Storage::Streams::IBuffer^> readTask)
     {
-        if (!_processingAudio)
+        UINT sampleCount = 0;
+
+        try
+        {
+            Windows::Storage::Streams::IBuffer^ audioBuffer = readTask.get();
+            _readResults[index] = audioBuffer;
+            sampleCount = audioBuffer->Length / sizeof(FLOAT);
+        }
+        catch (Platform::Exception^)
         {
-            _processingAudio = true;
+            // the stream closed under the read, the audio thread starts over on the next one
+        }
 
-            // create async task to get buffer from stream
-            auto asyncReadOp = _audioStream->ReadAsync(_dataBuffer, cEnergyBufferLength, Windows::Storage::Streams::InputStreamOptions::None);
+        _audioBlocks.Complete(index, sampleCount, Audio::SpeakerAttribution::GetTime());
+        _readPending = false;
 
-            Concurrency::create_task(asyncReadOp).then([this](Windows::Storage::Streams::IBuffer^ audioBuffer)
-            {
-                critical_section::scoped_lock lock(_processingLock);
+        // the next read goes out before the audio thread gets to this one
+        if (sampleCount > 0)
+        {
+            IssueRead();
+        }
+    });
+}
 
-                // if there is data in the buffer
-                if (audioBuffer->Length > 0)
-                {
-                    // extract audio samples from buffer
-                    byte* pData = DX::GetPointerToPixelData(audioBuffer);
+// process the audio of one read
+void AudioPanel::ProcessAudio(const Audio::AudioBlock& block)
+{
+    if (0 == block.SampleCount || nullptr == _audioBeam)
+    {
+        return;
+    }
 
-                    if (nullptr != pData)
-                    {
-                        // Calculate energy from audio
-                        UINT64 nSampleCount = audioBuffer->Length / sizeof(FLOAT);
-
-                        for (UINT i = 0; i < nSampleCount; ++i)
-                        {
-                            // compute the sum of squares of audio samples that will get accumulated
-                            // into a single energy value.
-                            float fData = *reinterpret_cast<float*>(&pData[i*sizeof(float)]);
-
-                            _fAccumulatedSquareSum += fData * fData;
-                            ++_nAccumulatedSampleCount;
-
-                            if (_nAccumulatedSampleCount < cAudioSamplesPerEnergySample)
-                            {
-                                continue;
-                            }
-
-                            // Each energy value will represent the logarithm of the mean of the
-                            // sum of squares of a group of audio samples.
-                            float fMeanSquare = _fAccumulatedSquareSum / cAudioSamplesPerEnergySample;
-                            float fEnergy = cMinEnergy;
-                            if (fMeanSquare > 0.f)
-                            {
-                                // Convert to dB
-                                fEnergy = 10.0f * log10(fMeanSquare);
-                            }
-
-                            // Renormalize signal above noise floor to [0,1] range for visualization.
-                            _fEnergyBuffer[_nEnergyIndex] = (cMinEnergy - fEnergy) / cMinEnergy;
-                            _nNewEnergyAvailable++;
-                            _nEnergyIndex = (_nEnergyIndex + 1) % cEnergyBufferLength;
-
-                            _fAccumulatedSquareSum = 0.f;
-                            _nAccumulatedSampleCount = 0;
-                        }
+    // extract audio samples from buffer
+    byte* pData = DX::GetPointerToPixelData(_readResults[block.Index]);
+    if (nullptr == pData)
+    {
+        return;
+    }
 
-                    }
-                }
+    const float* pSamples = reinterpret_cast<const float*>(pData);
+    UINT sampleCount = block.SampleCount;
 
-                // process more audio
-                _processingAudio = false;
-            });
+    // Calculate energy from audio, straight into the ring the render thread reads
+    _energyMeter.Process(pSamples, sampleCount, _energyRing);
 
-        }
+    if (_computeSpectrogram)
+    {
+        _spectrogram.Process(pSamples, sampleCount);
+    }
+
+    _voiceActivity.Process(pSamples, sampleCount, _audioBeam->BeamAngle, _audioBeam->BeamAngleConfidence);
+    _speaking = (FALSE != _voiceActivity.IsSpeaking());
+
+    // the skeleton panel matches the beam to the heads of the tracked bodies
+    if (nullptr != _speakers)
+    {
+        _speakers->GetAttribution().AddBeam(block.CompleteTime, _audioBeam->BeamAngle, _audioBeam->BeamAngleConfidence, _voiceActivity.IsSpeaking());
+    }
 
+    // Copy the audio for the capture writer, which never waits on the disk
+    if (_captureWriter)
+    {
+        _captureWriter->Push(pSamples, sampleCount, block.CompleteTime);
     }
 }
 
-void AudioPanel::UpdateBeamAngle()
+void AudioPanel::UpdateBeamAngle(double elapsedTime)
 {
+    if (UpdateRecordedBeamAngle(elapsedTime))
+    {
+        return;
+    }
+
     if (nullptr == _audioSource)
     {
         return;
@@ -258,25 +516,76 @@ void AudioPanel::UpdateBeamAngle()
     if (_audioSource->AudioBeams->Size > 0)
     {
         // Get most recent audio beam angle and confidence
-        FLOAT fBeamAngle = _audioBeam->BeamAngle;
-        FLOAT fBeamAngleConfidence = _audioBeam->BeamAngleConfidence;
+        UpdateBeamGauge(_audioBeam->BeamAngle, _audioBeam->BeamAngleConfidence);
+    }
+}
 
-        // Convert angles to degrees and set values in audio panel
-        float beamAngle = 180.0f * fBeamAngle / XM_PI;
+// estimates the beam of the recording at the point it has played to, looping at its end
+BOOL AudioPanel::UpdateRecordedBeamAngle(double elapsedTime)
+{
+    critical_section::scoped_lock lock(_recordingLock);
 
-        // Maximum possible confidence corresponds to this gradient width
-        const float cMinGradientWidth = 0.04f;
+    const UINT frameSize = _directionOfArrival.GetFrameSize();
+    if (!_recording.IsLoaded() || _recording.GetChannelCount() < Audio::KINECT_MICROPHONE_COUNT || _recording.GetFrameCount() < frameSize)
+    {
+        return FALSE;
+    }
 
-        // Set width of mark based on confidence.
-        // A confidence of 0 would give us a gradient that fills whole area diffusely.
-        // A confidence of 1 would give us the narrowest allowed gradient width.
-        float width = max((1 - fBeamAngleConfidence), cMinGradientWidth);
+    _recordingTime += elapsedTime;
 
-        // Update the gradient representing to reflect confidence
-        CreateConfidenceGaugeFill(width);
+    UINT first = static_cast<UINT>(_recordingTime * _recording.GetSampleRate());
+    if (first + frameSize > _recording.GetFrameCount())
+    {
+        _recordingTime = 0.0;
+        first = 0;
+    }
 
-        _beamNeedleTransform = D2D1::Matrix3x2F::Rotation(-beamAngle, D2D1::Point2F(0.5f, cVisTop + (-0.033f)));
+    const float* channels[Audio::KINECT_MICROPHONE_COUNT];
+    for (UINT m = 0; m < Audio::KINECT_MICROPHONE_COUNT; ++m)
+    {
+        channels[m] = _recording.GetChannel(m) + first;
+    }
+
+    // a silent frame leaves the gauge where it was
+    Audio::BeamEstimate estimate;
+    if (_directionOfArrival.Estimate(channels, &estimate))
+    {
+        UpdateBeamGauge(estimate.BeamAngle, estimate.BeamAngleConfidence);
     }
+
+    return TRUE;
+}
+
+void AudioPanel::UpdateBeamGauge(float fBeamAngle, float fBeamAngleConfidence)
+{
+    // Convert angles to degrees and set values in audio panel
+    float beamAngle = 180.0f * fBeamAngle / XM_PI;
+
+    // Maximum possible confidence corresponds to this gradient width
+    const float cMinGradientWidth = 0.04f;
+
+    // Set width of mark based on confidence.
+    // A confidence of 0 would give us a gradient that fills whole area diffusely.
+    // A confidence of 1 would give us the narrowest allowed gradient width.
+    float width = max((1 - fBeamAngleConfidence), cMinGradientWidth);
+
+    // Update the gradient representing to reflect confidence
+    CreateConfidenceGaugeFill(width);
+
+    _beamNeedleTransform = D2D1::Matrix3x2F::Rotation(-beamAngle, D2D1::Point2F(0.5f, cVisTop + (-0.033f)));
+}
+
+// moves the displayed energy on by count samples, the newest last
+static void ScrollEnergy(_Inout_updates_(displayLength) float* pDisplay, UINT displayLength, _In_reads_(count) const float* pEnergy, UINT count)
+{
+    if (count >= displayLength)
+    {
+        memcpy(pDisplay, pEnergy + count - displayLength, displayLength * sizeof(float));
+        return;
+    }
+
+    memmove(pDisplay, pDisplay + count, (displayLength - count) * sizeof(float));
+    memcpy(pDisplay + displayLength - count, pEnergy, count * sizeof(float));
 }
 
 void AudioPanel::UpdateEnergy()
@@ -289,7 +598,8 @@ void AudioPanel::UpdateEnergy()
     _nLastEnergyRefreshTime = now;
 
     // No need to refresh if there is no new energy available to render
-    if (0 >= _nNewEnergyAvailable)
+    UINT energyAvailable = _energyRing.GetReadableCount();
+    if (0 == energyAvailable)
     {
         return;
     }
@@ -297,30 +607,38 @@ void AudioPanel::UpdateEnergy()
     if (0 != previousRefreshTime)
     {
         float energyToAdvance = _fEnergyError + (((now - previousRefreshTime) * cAudioSamplesPerSecond / 1000.0f) / cAudioSamplesPerEnergySample);
-        int energySamplesToAdvance = min(_nNewEnergyAvailable, (int)(energyToAdvance));
+        UINT energySamplesToAdvance = min(energyAvailable, static_cast<UINT>(energyToAdvance));
         _fEnergyError = energyToAdvance - energySamplesToAdvance;
-        _nEnergyRefreshIndex = (_nEnergyRefreshIndex + energySamplesToAdvance) % cEnergyBufferLength;
-        _nNewEnergyAvailable -= energySamplesToAdvance;
-    }
 
-    // Copy energy samples into buffer to be displayed, taking into account that energy
-    // wraps around in a circular buffer.
-    int baseIndex = (_nEnergyRefreshIndex + cEnergyBufferLength - cEnergySamplesToDisplay) % cEnergyBufferLength;
-    int samplesUntilEnd = cEnergyBufferLength - baseIndex;
-    if (samplesUntilEnd > cEnergySamplesToDisplay)
-    {
-        critical_section::scoped_lock lock(_processingLock);
+        // scroll the new energy samples into the display buffer straight from the ring, without waiting on the audio thread
+        Audio::EnergySpan span = _energyRing.BeginRead(energySamplesToAdvance);
+        ScrollEnergy(_fEnergyDisplayBuffer->Data, cEnergySamplesToDisplay, span.pFirst, span.FirstCount);
+        ScrollEnergy(_fEnergyDisplayBuffer->Data, cEnergySamplesToDisplay, span.pSecond, span.SecondCount);
+
+        // and keep them for the zoomed out display
+        if (_energyHistory.IsOpen())
+        {
+            _energyHistory.Append(span.pFirst, span.FirstCount);
+            _energyHistory.Append(span.pSecond, span.SecondCount);
+        }
 
-        memcpy_s(_fEnergyDisplayBuffer->Data, cEnergySamplesToDisplay * sizeof(float), _fEnergyBuffer->Data + baseIndex, cEnergySamplesToDisplay * sizeof(float));
+        _energyRing.EndRead(span.GetCount());
     }
-    else
+
+    UINT historyLength = _energyHistoryLength;
+    if (historyLength > static_cast<UINT>(cEnergySamplesToDisplay) && _energyHistory.IsOpen())
     {
-        critical_section::scoped_lock lock(_processingLock);
+        // the loudest energy under each column of the span up to the latest energy
+        INT64 historyEnd = _energyHistory.GetCount();
+        _energyHistory.Render(historyEnd - historyLength, historyEnd, cEnergySamplesToDisplay, _energyHistoryColumns.data());
 
-        int samplesFromBeginning = cEnergySamplesToDisplay - samplesUntilEnd;
+        for (int i = 0; i < cEnergySamplesToDisplay; ++i)
+        {
+            _energyHistoryDisplay[i] = _energyHistoryColumns[i].Max;
+        }
 
-        memcpy_s(_fEnergyDisplayBuffer->Data, cEnergySamplesToDisplay * sizeof(float), _fEnergyBuffer->Data + baseIndex, samplesUntilEnd * sizeof(float));
-        memcpy_s(_fEnergyDisplayBuffer->Data + samplesUntilEnd, (cEnergySamplesToDisplay - samplesUntilEnd) * sizeof(float), _fEnergyBuffer->Data, samplesFromBeginning * sizeof(float));
+        UpdateEnergyDisplay(_energyHistoryDisplay.data(), cEnergySamplesToDisplay);
+        return;
     }
 
     //update the energy to display in the rendered output panel
@@ -330,24 +648,12 @@ void AudioPanel::UpdateEnergy()
 
 void AudioPanel::UpdateEnergyDisplay(const float *pEnergy, const UINT energyLength)
 {
-    // Clear whole display to background color
-    _energyDisplay->CopyFromMemory(nullptr, _pbEnergyBackground, _uiEnergyBackgroundStride);
-
-    const int cHalfImageHeight = _uiEnergyDisplayHeight / 2;
-
-    for (UINT i = 0; i < min(energyLength, _uiEnergyDisplayWidth); ++i)
+    // Draw the bars on the CPU and copy only the rectangle that changed
+    Audio::EnergyWaveformRect dirty;
+    if (_energyWaveform.Update(pEnergy, energyLength, &dirty))
     {
-        // Each bar has a minimum height of 1 (to get a steady signal down the middle) and a maximum height
-        // equal to the bitmap height.
-        int barHeight = static_cast<int>(max(1.0f, (pEnergy[i] * _uiEnergyDisplayHeight)));
-
-        // Center bar vertically on image
-        int top = cHalfImageHeight - (barHeight / 2);
-        int bottom = top + barHeight;
-        D2D1_RECT_U barRect = D2D1::RectU(i, top, i + 1, bottom);
-
-        // Draw bar in foreground color
-        _energyDisplay->CopyFromMemory(&barRect, _pbEnergyForeground, _uiEnergyForegroundStride);
+        D2D1_RECT_U dirtyRect = D2D1::RectU(dirty.Left, dirty.Top, dirty.Right, dirty.Bottom);
+        _energyDisplay->CopyFromMemory(&dirtyRect, _energyWaveform.GetPixels(dirty), _energyWaveform.GetStride());
     }
 };
 
@@ -405,26 +711,11 @@ void AudioPanel::CreateSizeDependentResources()
 
 HRESULT AudioPanel::CreateEnergyDisplay()
 {
-    const int cBytesPerPixel = 4;
-    const int cMaxPixelChannelIntensity = 0xff;
-
     D2D1_SIZE_U size = D2D1::SizeU(_uiEnergyDisplayWidth, _uiEnergyDisplayHeight);
     HRESULT hr = S_OK;
 
-    // Allocate background and set to white
-    _uiEnergyBackgroundStride = cBytesPerPixel * _uiEnergyDisplayWidth;
-    int numBackgroundBytes = _uiEnergyBackgroundStride * _uiEnergyDisplayHeight;
-    _pbEnergyBackground = new BYTE[numBackgroundBytes];
-    memset(_pbEnergyBackground, cMaxPixelChannelIntensity, numBackgroundBytes);
-
-    // Allocate foreground and set to blue/violet color
-    _uiEnergyForegroundStride = cBytesPerPixel;
-    _pbEnergyForeground = new BYTE[cBytesPerPixel * _uiEnergyDisplayHeight];
-    UINT *pPixels = reinterpret_cast<UINT*>(_pbEnergyForeground);
-    for (UINT iPixel = 0; iPixel < _uiEnergyDisplayHeight; ++iPixel)
-    {
-        pPixels[iPixel] = 0x8A2BE2;
-    }
+    // White background, blue/violet bars
+    _energyWaveform.Resize(_uiEnergyDisplayWidth, _uiEnergyDisplayHeight, 0xFFFFFFFF, 0x8A2BE2);
 
     // Specify layout position for energy display
     _energyDisplayPosition = D2D1::RectF(0.13f, cVisTop, 0.87f, cVisTop + 0.185f);
@@ -437,7 +728,7 @@ HRESULT AudioPanel::CreateEnergyDisplay()
 
     if (SUCCEEDED(hr))
     {
-        _energyDisplay->CopyFromMemory(nullptr, _pbEnergyBackground, _uiEnergyBackgroundStride);
+        _energyDisplay->CopyFromMemory(nullptr, _energyWaveform.GetPixels(), _energyWaveform.GetStride());
     }
 
     return hr;
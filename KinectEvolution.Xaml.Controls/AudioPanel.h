@@ -7,7 +7,15 @@
 #pragma once
 
 #include "Panel.h"
-#include "StepTimer.h"
+#include "AudioEnergy.h"
+#include "EnergyWaveform.h"
+#include "Spectrogram.h"
+#include "VoiceActivity.h"
+#include "DirectionOfArrival.h"
+#include "AudioCapture.h"
+#include "EnergyPyramid.h"
+#include "AudioBlockQueue.h"
+#include "SpeakerAttributionSource.h"
 
 using namespace KinectEvolution::Xaml::Controls::Base;
 
@@ -28,6 +36,55 @@ namespace KinectEvolution {
                     void set(_In_ WRK::AudioSource^ value);
                 }
 
+                // packaged 4 channel WAV recording of the microphone array played in a loop, whose estimated
+                // beam angle the gauge shows in place of the sensor's; empty for the sensor's beam
+                property Platform::String^ RecordingFile
+                {
+                    Platform::String^ get();
+                    void set(Platform::String^ value);
+                }
+
+                // write the audio as it is read into WAV files in the app's local folder
+                property bool CaptureAudio
+                {
+                    bool get();
+                    void set(bool value);
+                }
+
+                // seconds of energy the display spans, zoomed out over the history kept up to the latest
+                // energy; 0 to scroll the energies past one at a time
+                property double EnergyHistorySeconds
+                {
+                    double get();
+                    void set(double value);
+                }
+
+                // someone is speaking in the audio read so far
+                property bool IsSpeaking
+                {
+                    bool get();
+                }
+
+                // gets the beam of every block read with whether it had speech, for a skeleton panel given the same
+                // one to match to the heads of the tracked bodies; null for none
+                property Audio::SpeakerAttributionSource^ Speakers
+                {
+                    Audio::SpeakerAttributionSource^ get();
+                    void set(_In_ Audio::SpeakerAttributionSource^ value);
+                }
+
+                // compute the short time spectrum of the audio as it is read, off by default; starts from silence
+                // each time it is turned on
+                property bool ComputeSpectrogram
+                {
+                    bool get();
+                    void set(bool value);
+                }
+
+                // one column of the spectrogram, a value in [0, 1] per frequency bin from 0 Hz up; age 0 is the
+                // newest column. empty while the spectrogram is off
+                Platform::Array<float>^ GetSpectrogramColumn(unsigned int age);
+
             protected private:
                 virtual event Windows::UI::Xaml::Data::PropertyChangedEventHandler^ PropertyChanged;
 
@@ -48,8 +105,11 @@ namespace KinectEvolution {
             private:
                 ~AudioPanel();
 
-                void ProcessAudio();
-                void UpdateBeamAngle();
+                void IssueRead();
+                void ProcessAudio(const Audio::AudioBlock& block);
+                void UpdateBeamAngle(double elapsedTime);
+                BOOL UpdateRecordedBeamAngle(double elapsedTime);
+                void UpdateBeamGauge(float fBeamAngle, float fBeamAngleConfidence);
                 void UpdateEnergy();
                 void UpdateEnergyDisplay(const float *pEnergy, const UINT energyLength);
 
@@ -62,11 +122,9 @@ namespace KinectEvolution {
 
             private:
                 BOOL                                        _loadingComplete;
-                BOOL                                        _processingAudio;
                 Concurrency::critical_section               _processingLock;
 
                 // audio thread
-                DX::StepTimer                               _audioTimer;
                 Windows::Foundation::IAsyncAction^          _audioLoopWorker;
 
 
@@ -74,18 +132,20 @@ namespace KinectEvolution {
                 WRK::AudioBeam^                             _audioBeam;
                 Windows::Storage::Streams::IInputStream^    _audioStream;
 
-                // Data buffer for audio stream
-                Windows::Storage::Streams::Buffer^          _dataBuffer;
+                // Pool of buffers the audio stream is read into one after another, with what each read returned.
+                // A read is always in flight while the audio thread processes the ones before it.
+                std::vector<Windows::Storage::Streams::Buffer^>     _readBuffers;
+                std::vector<Windows::Storage::Streams::IBuffer^>    _readResults;
+                Audio::AudioBlockQueue                      _audioBlocks;
+                std::atomic<bool>                           _reading;
+                std::atomic<bool>                           _readPending;
 
                 /// Width/Height of engery visualization.
                 UINT                        _uiEnergyDisplayWidth;
                 UINT                        _uiEnergyDisplayHeight;
 
                 D2D_MATRIX_3X2_F            _renderTargetTransform;
-                BYTE*                       _pbEnergyBackground;
-                UINT                        _uiEnergyBackgroundStride;
-                BYTE*                       _pbEnergyForeground;
-                UINT                        _uiEnergyForegroundStride;
+                Audio::EnergyWaveform       _energyWaveform;
                 Microsoft::WRL::ComPtr<ID2D1Bitmap>                _energyDisplay;
 
                 D2D1_RECT_F                 _energyDisplayPosition;
@@ -101,15 +161,16 @@ namespace KinectEvolution {
                 Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>       _panelOutlineStroke;
 
             private:
-                // Time interval, in milliseconds, for timer that drives audio capture.
-                static const int        cAudioReadTimerInterval = 50;
-
                 // Audio samples per second in Kinect audio stream
                 static const int        cAudioSamplesPerSecond = 16000;
 
-                // Number of float samples in the audio beffer we allocate for reading every time the audio capture timer fires
-                // (should be larger than the amount of audio corresponding to cAudioReadTimerInterval msec).
-                static const int        cAudioBufferLength = (int) (2 * cAudioReadTimerInterval * cAudioSamplesPerSecond * .001);
+                // Audio is read in blocks of 16 msec into a pool of 3, so up to 2 can wait on the audio thread
+                // while the next is read.
+                static const int        cAudioReadBlockLength = 256;
+                static const int        cAudioReadBlockCount = 3;
+
+                // Time, in milliseconds, the audio thread waits for a read before it checks the reads are running.
+                static const int        cAudioReadTimeout = 50;
 
                 // Number of audio samples captured from Kinect audio stream accumulated into a single
                 // energy measurement that will get displayed.
@@ -122,35 +183,68 @@ namespace KinectEvolution {
                 // Always keep it higher than the energy display length to avoid overflow.
                 static const int        cEnergyBufferLength = 2300;
 
+                // Number of energy samples kept for the zoomed out display, a little over an hour of audio.
+                static const int        cEnergyHistoryLength = 1 << 22;
+
                 // Minimum energy of audio to display (in dB value, where 0 dB is full scale)
                 static const int        cMinEnergy = -90;
 
+                // Spectrogram frames of 32 msec every 8 msec, and the number of them kept.
+                static const int        cSpectrogramFftSize = 512;
+                static const int        cSpectrogramHopSize = 128;
+                static const int        cSpectrogramColumns = 256;
+
+                // Direction of arrival frames of 32 msec, over +/-50 degrees in 1 degree steps like the sensor's beam.
+                static const int        cDirectionFrameSize = 512;
+                static const int        cDirectionAngleCount = 101;
+
+                // Captured audio may fall 2 sec behind the disk, and goes into a new file every 10 minutes.
+                static const int        cCaptureRingSeconds = 2;
+                static const int        cCaptureFileSeconds = 600;
+                static const int        cCaptureFlushBytes = 256 * 1024;
+
                 const FLOAT             cVisTop = 0.052f;
 
-                // Buffer used to store audio stream energy data as we read audio.
-                Platform::Array<float>^ _fEnergyBuffer;
+                // Audio stream energy data as we read audio, handed from the audio thread to the render thread.
+                Audio::EnergyRing       _energyRing;
 
                 // Buffer used to store audio stream energy data ready to be displayed.
                 Platform::Array<float>^ _fEnergyDisplayBuffer;
 
-                // Sum of squares of audio samples being accumulated to compute the next energy value.
-                float                   _fAccumulatedSquareSum;
+                // Every energy read over the last hour or so, the display's zoomed out span of it in energies,
+                // and the envelope of that span one value per display column.
+                Audio::EnergyPyramid    _energyHistory;
+                std::atomic<UINT>       _energyHistoryLength;
+                std::vector<Audio::EnergySummary> _energyHistoryColumns;
+                std::vector<float>      _energyHistoryDisplay;
 
-                // Error between time slice we wanted to display and time slice that we ended up
-                // displaying, given that we have to display in integer pixels.
-                float                   _fEnergyError;
+                // Mean square of each group of audio samples in dB, carrying a partial group between reads.
+                Audio::AudioEnergyMeter _energyMeter;
+
+                // Short time spectrum of the same audio, in the same dB range as the energy, while it is asked for.
+                Audio::Spectrogram      _spectrogram;
+                std::atomic<bool>       _computeSpectrogram;
 
-                // Number of audio samples accumulated so far to compute the next energy value.
-                int                     _nAccumulatedSampleCount;
+                // Speech in the same audio, with the beam it came from; the last decision for other threads.
+                Audio::VoiceActivityDetector _voiceActivity;
+                std::atomic<bool>       _speaking;
 
-                // Index of next element available in audio energy buffer.
-                int                     _nEnergyIndex;
+                // Where the beam and speech of each block go, set under the processing lock.
+                Audio::SpeakerAttributionSource^ _speakers;
 
-                // Number of newly calculated audio stream energy values that have not yet been displayed.
-                int                     _nNewEnergyAvailable;
+                // Recording whose direction of arrival is shown, and how far it has played.
+                Platform::String^       _recordingFile;
+                Audio::WaveFile         _recording;
+                Audio::DirectionOfArrival _directionOfArrival;
+                double                  _recordingTime;
+                Concurrency::critical_section _recordingLock;
 
-                // Index of first energy element that has never (yet) been displayed to screen.
-                int                     _nEnergyRefreshIndex;
+                // Writes the audio read to disk on a thread of its own, while capturing.
+                std::unique_ptr<Audio::AudioCaptureWriter> _captureWriter;
+
+                // Error between time slice we wanted to display and time slice that we ended up
+                // displaying, given that we have to display in integer pixels.
+                float                   _fEnergyError;
 
                 // Last time energy visualization was rendered to screen.
                 ULONGLONG               _nLastEnergyRefreshTime;
@@ -0,0 +1,275 @@
+//------------------------------------------------------------------------------
+// <copyright file="BlockManKinematics.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BlockManKinematics.h"
+
+#include <algorithm>
+
+using namespace KinectEvolution::Xaml::Controls::BlockMan;
+
+inline XMVECTOR LoadLanes(_In_reads_(4) const float* pSource)
+{
+    return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource));
+}
+
+inline void StoreLanes(_Out_writes_(4) float* pDestination, FXMVECTOR value)
+{
+    XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pDestination), value);
+}
+
+// all bits set in the lanes whose quaternion is zero
+inline XMVECTOR IsZeroQuaternion(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, GXMVECTOR w)
+{
+    XMVECTOR zero = XMVectorZero();
+
+    return XMVectorAndInt(
+        XMVectorAndInt(XMVectorEqual(x, zero), XMVectorEqual(y, zero)),
+        XMVectorAndInt(XMVectorEqual(z, zero), XMVectorEqual(w, zero)));
+}
+
+BlockManKinematics::BlockManKinematics()
+{
+    // order the blocks by depth so every parent is solved before its children
+    UINT depth[BLOCK_COUNT];
+    for (UINT blockIndex = 0; blockIndex < BLOCK_COUNT; ++blockIndex)
+    {
+        depth[blockIndex] = 0;
+        for (int parentIndex = g_SkeletonBlocks[blockIndex].ParentBlockIndex; parentIndex > -1; parentIndex = g_SkeletonBlocks[parentIndex].ParentBlockIndex)
+        {
+            ASSERT(depth[blockIndex] < BLOCK_COUNT);
+            ++depth[blockIndex];
+        }
+
+        _order[blockIndex] = blockIndex;
+    }
+
+    std::stable_sort(_order, _order + BLOCK_COUNT, [&depth](UINT a, UINT b) { return depth[a] < depth[b]; });
+
+    Reset();
+}
+
+void BlockManKinematics::Reset()
+{
+    ZeroMemory(_orientations, sizeof(_orientations));
+    ZeroMemory(_model, sizeof(_model));
+    ZeroMemory(_translation, sizeof(_translation));
+    ZeroMemory(_blockRows, sizeof(_blockRows));
+
+    // identity model
+    for (UINT lane = 0; lane < BODY_LANE_COUNT; ++lane)
+    {
+        _model[0][lane] = _model[5][lane] = _model[10][lane] = _model[15][lane] = 1.0f;
+    }
+
+    XMMATRIX identity = XMMatrixIdentity();
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        for (UINT blockIndex = 0; blockIndex < BLOCK_COUNT; ++blockIndex)
+        {
+            XMStoreFloat4x4(&_worldTransforms[bodyIndex][blockIndex], identity);
+        }
+    }
+}
+
+void BlockManKinematics::SetJointOrientations(UINT bodyIndex, _In_reads_(JOINT_COUNT) const XMVECTOR* pOrientations)
+{
+    if (bodyIndex >= BODY_COUNT)
+    {
+        return;
+    }
+
+    for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+    {
+        XMFLOAT4 orientation;
+        XMStoreFloat4(&orientation, pOrientations[jointIndex]);
+
+        _orientations[0][jointIndex][bodyIndex] = orientation.x;
+        _orientations[1][jointIndex][bodyIndex] = orientation.y;
+        _orientations[2][jointIndex][bodyIndex] = orientation.z;
+        _orientations[3][jointIndex][bodyIndex] = orientation.w;
+    }
+}
+
+void BlockManKinematics::SetBodyTransform(UINT bodyIndex, _In_ CXMMATRIX model, FXMVECTOR translation)
+{
+    if (bodyIndex >= BODY_COUNT)
+    {
+        return;
+    }
+
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, model);
+
+    for (UINT i = 0; i < MODEL_COUNT; ++i)
+    {
+        _model[i][bodyIndex] = m.m[i / 4][i % 4];
+    }
+
+    XMFLOAT3 t;
+    XMStoreFloat3(&t, translation);
+
+    _translation[0][bodyIndex] = t.x;
+    _translation[1][bodyIndex] = t.y;
+    _translation[2][bodyIndex] = t.z;
+}
+
+XMMATRIX BlockManKinematics::GetBlockTransform(UINT bodyIndex, UINT blockIndex) const
+{
+    const float (*rows)[BODY_LANE_COUNT] = _blockRows[blockIndex];
+
+    return XMMATRIX(
+        rows[0][bodyIndex], rows[1][bodyIndex], rows[2][bodyIndex], 0.0f,
+        rows[3][bodyIndex], rows[4][bodyIndex], rows[5][bodyIndex], 0.0f,
+        rows[6][bodyIndex], rows[7][bodyIndex], rows[8][bodyIndex], 0.0f,
+        rows[9][bodyIndex], rows[10][bodyIndex], rows[11][bodyIndex], 1.0f);
+}
+
+void BlockManKinematics::Solve()
+{
+    for (UINT i = 0; i < BLOCK_COUNT; ++i)
+    {
+        for (UINT lane = 0; lane < BODY_LANE_COUNT; lane += 4)
+        {
+            SolveBlock(_order[i], lane);
+        }
+    }
+}
+
+void BlockManKinematics::SolveBlock(UINT blockIndex, UINT lane)
+{
+    const SkeletonBlock& block = g_SkeletonBlocks[blockIndex];
+    const UINT jointIndex = static_cast<UINT>(block.SkeletonJoint);
+    const int parentIndex = block.ParentBlockIndex;
+
+    XMVECTOR x = LoadLanes(&_orientations[0][jointIndex][lane]);
+    XMVECTOR y = LoadLanes(&_orientations[1][jointIndex][lane]);
+    XMVECTOR z = LoadLanes(&_orientations[2][jointIndex][lane]);
+    XMVECTOR w = LoadLanes(&_orientations[3][jointIndex][lane]);
+
+    // without an orientation the block takes the one stored at its parent's block index, as the per block code did;
+    // a zero quaternion gives the identity below
+    if (parentIndex > -1)
+    {
+        XMVECTOR missing = IsZeroQuaternion(x, y, z, w);
+
+        x = XMVectorSelect(x, LoadLanes(&_orientations[0][parentIndex][lane]), missing);
+        y = XMVectorSelect(y, LoadLanes(&_orientations[1][parentIndex][lane]), missing);
+        z = XMVectorSelect(z, LoadLanes(&_orientations[2][parentIndex][lane]), missing);
+        w = XMVectorSelect(w, LoadLanes(&_orientations[3][parentIndex][lane]), missing);
+    }
+
+    // quaternion to rotation rows, as XMMatrixRotationQuaternion
+    const XMVECTOR one = XMVectorSplatOne();
+    const XMVECTOR two = XMVectorReplicate(2.0f);
+
+    XMVECTOR x2 = x * two;
+    XMVECTOR y2 = y * two;
+    XMVECTOR z2 = z * two;
+
+    XMVECTOR xx = x * x2;
+    XMVECTOR yy = y * y2;
+    XMVECTOR zz = z * z2;
+    XMVECTOR xy = x * y2;
+    XMVECTOR xz = x * z2;
+    XMVECTOR yz = y * z2;
+    XMVECTOR wx = w * x2;
+    XMVECTOR wy = w * y2;
+    XMVECTOR wz = w * z2;
+
+    XMFLOAT4 scale;
+    XMStoreFloat4(&scale, block.Scale);
+
+    XMVECTOR sx = XMVectorReplicate(scale.x);
+    XMVECTOR sy = XMVectorReplicate(scale.y);
+    XMVECTOR sz = XMVectorReplicate(scale.z);
+
+    XMVECTOR rows[ROW_COUNT];
+    rows[0] = (one - yy - zz) * sx;
+    rows[1] = (xy + wz) * sx;
+    rows[2] = (xz - wy) * sx;
+    rows[3] = (xy - wz) * sy;
+    rows[4] = (one - xx - zz) * sy;
+    rows[5] = (yz + wx) * sy;
+    rows[6] = (xz + wy) * sz;
+    rows[7] = (yz - wx) * sz;
+    rows[8] = (one - xx - yy) * sz;
+
+    // the block center is offset in the space of the parent block
+    XMFLOAT4 center;
+    XMStoreFloat4(&center, block.CenterFromParentCenter);
+
+    if (parentIndex > -1)
+    {
+        const float (*parent)[BODY_LANE_COUNT] = _blockRows[parentIndex];
+
+        XMVECTOR cx = XMVectorReplicate(center.x);
+        XMVECTOR cy = XMVectorReplicate(center.y);
+        XMVECTOR cz = XMVectorReplicate(center.z);
+
+        for (UINT axis = 0; axis < 3; ++axis)
+        {
+            XMVECTOR position = LoadLanes(&parent[9 + axis][lane]);
+            position = XMVectorMultiplyAdd(cx, LoadLanes(&parent[0 + axis][lane]), position);
+            position = XMVectorMultiplyAdd(cy, LoadLanes(&parent[3 + axis][lane]), position);
+            position = XMVectorMultiplyAdd(cz, LoadLanes(&parent[6 + axis][lane]), position);
+            rows[9 + axis] = position;
+        }
+    }
+    else
+    {
+        rows[9] = XMVectorReplicate(center.x);
+        rows[10] = XMVectorReplicate(center.y);
+        rows[11] = XMVectorReplicate(center.z);
+    }
+
+    for (UINT i = 0; i < ROW_COUNT; ++i)
+    {
+        StoreLanes(&_blockRows[blockIndex][i][lane], rows[i]);
+    }
+
+    // world = model * block * translation, the block rows have w = 0 and the translated origin w = 1
+    XMVECTOR local[4][3] =
+    {
+        { rows[0], rows[1], rows[2] },
+        { rows[3], rows[4], rows[5] },
+        { rows[6], rows[7], rows[8] },
+        {
+            rows[9] + LoadLanes(&_translation[0][lane]),
+            rows[10] + LoadLanes(&_translation[1][lane]),
+            rows[11] + LoadLanes(&_translation[2][lane])
+        },
+    };
+
+    float world[MODEL_COUNT][4];
+    for (UINT row = 0; row < 4; ++row)
+    {
+        XMVECTOR m0 = LoadLanes(&_model[row * 4 + 0][lane]);
+        XMVECTOR m1 = LoadLanes(&_model[row * 4 + 1][lane]);
+        XMVECTOR m2 = LoadLanes(&_model[row * 4 + 2][lane]);
+        XMVECTOR m3 = LoadLanes(&_model[row * 4 + 3][lane]);
+
+        for (UINT column = 0; column < 3; ++column)
+        {
+            XMVECTOR value = m0 * local[0][column];
+            value = XMVectorMultiplyAdd(m1, local[1][column], value);
+            value = XMVectorMultiplyAdd(m2, local[2][column], value);
+            value = XMVectorMultiplyAdd(m3, local[3][column], value);
+            StoreLanes(world[row * 4 + column], value);
+        }
+
+        StoreLanes(world[row * 4 + 3], m3);
+    }
+
+    for (UINT i = 0; i < 4 && lane + i < BODY_COUNT; ++i)
+    {
+        XMFLOAT4X4& transform = _worldTransforms[lane + i][blockIndex];
+        for (UINT element = 0; element < MODEL_COUNT; ++element)
+        {
+            transform.m[element / 4][element % 4] = world[element][i];
+        }
+    }
+}
@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------
+// <copyright file="BlockManKinematics.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace BlockMan {
+
+                struct SkeletonBlock
+                {
+                    DirectX::XMVECTOR Scale;
+                    DirectX::XMVECTOR CenterFromParentCenter;
+                    WRK::JointType SkeletonJoint;
+                    int ParentBlockIndex;
+                };
+
+                const SkeletonBlock g_SkeletonBlocks [] = {
+                        { { 0.75f, 1.0f, 0.5f, 0.0f }, { 0.0f, 0.0f, 0.0f, 0.0f }, WRK::JointType::SpineMid, -1 },      //  0 - lower torso
+                        { { 0.75f, 1.0f, 0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::SpineShoulder, 0 },  //  1 - upper torso
+
+                        { { 0.25f, 0.25f, 0.25f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::Neck, 1 },         //  2 - neck
+                        { { 0.5f, 0.5f, 0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::Head, 2 },            //  3 - head
+
+                        { { 0.35f, 0.4f, 0.35f, 0.0f }, { 0.5f, 1.0f, 0.0f, 0.0f }, WRK::JointType::ShoulderLeft, 1 },  //  4 - Left shoulderblade
+                        { { 0.25f, 1.0f, 0.25f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::ElbowLeft, 4 },     //  5 - Left upper arm
+                        { { 0.15f, 1.0f, 0.15f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::WristLeft, 5 },     //  6 - Left forearm
+                        { { 0.10f, 0.4f, 0.30f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::HandLeft, 6 },      //  7 - Left hand
+
+                        { { 0.35f, 0.4f, 0.35f, 0.0f }, { -0.5f, 1.0f, 0.0f, 0.0f }, WRK::JointType::ShoulderRight, 1 },//   8 - Right shoulderblade
+                        { { 0.25f, 1.0f, 0.25f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::ElbowRight, 8 },    //   9 - Right upper arm
+                        { { 0.15f, 1.0f, 0.15f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::WristRight, 9 },    //  10 - Right forearm
+                        { { 0.10f, 0.4f, 0.30f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::HandRight, 10 },    //  11 - Right hand
+
+                        { { 0.35f, 0.4f, 0.35f, 0.0f }, { 0.5f, 0.0f, 0.0f, 0.0f }, WRK::JointType::HipLeft, 0 },       //  12 - Left hipblade
+                        { { .4f, 1.0f, .4f, 0.0f }, { 0.5f, 0.0f, 0.0f, 0.0f }, WRK::JointType::KneeLeft, 12 },         //  13 - Left thigh
+                        { { .3f, 1.0f, .3f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::AnkleLeft, 13 },        //  14 - Left calf
+                        //{ { .35f, .6f, .20f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::FootLeft , 14 },     //     - Left foot
+
+                        { { 0.35f, 0.4f, 0.35f, 0.0f }, { -0.5f, 0.0f, 0.0f, 0.0f }, WRK::JointType::HipRight, 0 },     //  15  - Right hipblade
+                        { { .4f, 1.0f, .4f, 0.0f }, { -0.5f, 0.0f, 0.0f, 0.0f }, WRK::JointType::KneeRight, 15 },       //  16  - Right thigh
+                        { { .3f, 1.0f, .3f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::AnkleRight, 16 },       //  17  - Right calf
+                        //{ { .35f, .6f, .20f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, WRK::JointType::FootRight, 18 },     //      - Right foot
+
+                };
+
+                const UINT BLOCK_COUNT = _countof(g_SkeletonBlocks);
+                const UINT BODY_COUNT = 6;
+                const UINT JOINT_COUNT = 25;
+
+                // bodies rounded up to whole 4 wide vectors
+                const UINT BODY_LANE_COUNT = (BODY_COUNT + 3) & ~3;
+
+                // forward kinematics of the block hierarchy for all bodies at once, needs no device
+                class BlockManKinematics
+                {
+                public:
+                    BlockManKinematics();
+
+                    void Reset();
+
+                    // joint orientations of a body, a zero quaternion where the sensor has none
+                    void SetJointOrientations(UINT bodyIndex, _In_reads_(JOINT_COUNT) const DirectX::XMVECTOR* pOrientations);
+
+                    // world = model * block * translation
+                    void SetBodyTransform(UINT bodyIndex, _In_ DirectX::CXMMATRIX model, DirectX::FXMVECTOR translation);
+
+                    // computes the world matrix of every block of every body
+                    void Solve();
+
+                    DirectX::XMMATRIX GetWorldTransform(UINT bodyIndex, UINT blockIndex) const
+                    {
+                        return DirectX::XMLoadFloat4x4(&_worldTransforms[bodyIndex][blockIndex]);
+                    }
+
+                    // block relative to the body, without the model and translation of SetBodyTransform
+                    DirectX::XMMATRIX GetBlockTransform(UINT bodyIndex, UINT blockIndex) const;
+
+                private:
+                    enum
+                    {
+                        ROW_COUNT = 12,     // 3x3 scale rotation followed by the translation
+                        MODEL_COUNT = 16,
+                    };
+
+                    void SolveBlock(UINT blockIndex, UINT lane);
+
+                private:
+                    // parents before children
+                    UINT                _order[BLOCK_COUNT];
+
+                    // x, y, z, w streams of the joint orientations
+                    float               _orientations[4][JOINT_COUNT][BODY_LANE_COUNT];
+
+                    float               _model[MODEL_COUNT][BODY_LANE_COUNT];
+                    float               _translation[3][BODY_LANE_COUNT];
+
+                    // block transforms relative to the body
+                    float               _blockRows[BLOCK_COUNT][ROW_COUNT][BODY_LANE_COUNT];
+
+                    DirectX::XMFLOAT4X4 _worldTransforms[BODY_COUNT][BLOCK_COUNT];
+                };
+
+            }
+        }
+    }
+}
@@ -29,6 +29,15 @@ BlockManPanel::BlockManPanel()
 {
     critical_section::scoped_lock lock(_criticalSection);
 
+    // the blocks only follow the joint orientations
+    Skeleton::JointFilterParameters filterParameters;
+    filterParameters.PositionFilter = Skeleton::PositionFilterType::None;
+    filterParameters.OrientationFilter = Skeleton::OrientationFilterType::Slerp;
+    filterParameters.OrientationSmoothing = QUATERNION_SMOOTHNESS;
+    _jointFilter.SetParameters(filterParameters);
+
+    DualQuaternionSkinning = FALSE;
+
     CreateDeviceResources();
     CreateSizeDependentResources();
 }
@@ -77,6 +86,45 @@ BodyFrameSource^ BlockManPanel::BodySource::get()
     return _frameSource;
 }
 
+void BlockManPanel::SkinnedMeshFile::set(Platform::String^ value)
+{
+    {
+        critical_section::scoped_lock lock(_criticalSection);
+
+        if (_skinnedMeshFile == value)
+        {
+            return;
+        }
+
+        _skinnedMeshFile = value;
+
+        // back to the blocks until the new mesh is read
+        _skinnedMesh = SkinnedMesh();
+        _skinnedMeshRenderer = nullptr;
+    }
+
+    if (nullptr != value && !value->IsEmpty())
+    {
+        DX::ReadDataAsync(value->Data()).then([this, value](const std::vector<byte>& fileData)
+        {
+            critical_section::scoped_lock lock(_criticalSection);
+
+            // a later file may have been set while this one was read
+            if (_skinnedMeshFile == value && !fileData.empty())
+            {
+                _skinnedMesh.Load(fileData.data(), fileData.size());
+            }
+        });
+    }
+
+    NotifyPropertyChanged("SkinnedMeshFile");
+}
+
+Platform::String^ BlockManPanel::SkinnedMeshFile::get()
+{
+    return _skinnedMeshFile;
+}
+
 void BlockManPanel::NotifyPropertyChanged(Platform::String^ prop)
 {
     PropertyChangedEventArgs^ args = ref new PropertyChangedEventArgs(prop);
@@ -109,26 +157,33 @@ void BlockManPanel::OnBodyFrame(_In_ BodyFrame^ bodyFrame)
 
     bodyFrame->GetAndRefreshBodyData(_bodies);
 
-    for (int iBody = 0; iBody < bodyFrame->BodyCount; ++iBody)
-    {
-        IBody^ body = _bodies->GetAt(iBody);
-        if (nullptr == body)
-        {
-            continue;
-        }
+    _bodyData.Load(_bodies, bodyFrame->RelativeTime, bodyFrame->FloorClipPlane);
+    _bodyTracker.Update(_bodyData);
 
-        BOOLEAN bTracked = false;
-        if (!body->IsTracked)
+    const Skeleton::BodyFrameData& tracked = _bodyTracker.GetTracked();
+    _jointFilter.Update(tracked);
+
+    const Skeleton::BodyFrameData& filtered = _jointFilter.GetFiltered();
+
+    for (UINT iBody = 0; iBody < BODY_COUNT; ++iBody)
+    {
+        if (!tracked.IsTracked[iBody])
         {
-            _blockMen[iBody].Reset();
+            // a body lost for a moment keeps its orientations until it is found again
+            if (0 == tracked.TrackingId[iBody])
+            {
+                _blockMen[iBody].Reset();
+            }
+            else
+            {
+                _blockMen[iBody]._position = XMVectorZero();
+            }
 
             continue;
         }
 
-        IMapView<JointType, Joint>^ joints = body->Joints;
-        IMapView<JointType, JointOrientation>^ jointOrientations = body->JointOrientations;
         {
-            for (UINT i = 0; i < joints->Size; i++)
+            for (UINT i = 0; i < JOINT_COUNT; i++)
             {
                 JointType jt = static_cast<JointType>(i);
 
@@ -138,50 +193,13 @@ void BlockManPanel::OnBodyFrame(_In_ BodyFrame^ bodyFrame)
                     continue;
                 }
 
-                JointOrientation jo = jointOrientations->Lookup(jt);
-                _blockMen[iBody]._JointOrientations[i] = SmoothQuaternion(_blockMen[iBody]._JointOrientations[i], XMLoadFloat4((XMFLOAT4*) &jo.Orientation));
+                // the filter holds the last orientation while the sensor reports none
+                _blockMen[iBody]._JointOrientations[i] = filtered.GetOrientation(iBody, i);
             }
 
-            for (int blockIndex = 0; blockIndex < BLOCK_COUNT; ++blockIndex)
-            {
-                JointType jointIndex = g_SkeletonBlocks[blockIndex].SkeletonJoint;
-                int parentIndex = g_SkeletonBlocks[blockIndex].ParentBlockIndex;
-
-                XMVECTOR translateFromParent = g_SkeletonBlocks[blockIndex].CenterFromParentCenter;
-                XMMATRIX parentTransform = (parentIndex > -1) ? _blockMen[iBody]._BlockTransforms[parentIndex] : XMMatrixIdentity();
-                XMVECTOR position = XMVector3Transform(translateFromParent, parentTransform);
-
-                XMVECTOR rotationQuat = XMVectorZero();
-
-                if (XMVector4Equal(_blockMen[iBody]._JointOrientations[(int)jointIndex], XMVectorZero()))
-                {
-                    if (parentIndex > -1)
-                    {
-                        if (XMVector4Equal(_blockMen[iBody]._JointOrientations[parentIndex], XMVectorZero()))
-                        {
-                            rotationQuat = XMQuaternionIdentity();
-                        }
-                        else
-                        {
-                            rotationQuat = _blockMen[iBody]._JointOrientations[parentIndex];
-                        }
-                    }
-                }
-                else
-                {
-                    rotationQuat = _blockMen[iBody]._JointOrientations[(int) jointIndex];
-                }
-
-                XMMATRIX translation = XMMatrixTranslationFromVector(position);
-                XMMATRIX scale = XMMatrixScalingFromVector(g_SkeletonBlocks[blockIndex].Scale);
-                XMMATRIX rotation = XMMatrixRotationQuaternion(rotationQuat);
+            _kinematics.SetJointOrientations(iBody, _blockMen[iBody]._JointOrientations);
 
-                _blockMen[iBody]._BlockTransforms[blockIndex] = scale * rotation * translation;
-            }
-
-            Joint joint = joints->Lookup(JointType::SpineBase);
-
-            _blockMen[iBody]._position = XMLoadFloat4((XMFLOAT4*) &(joint.Position));
+            _blockMen[iBody]._position = filtered.GetPosition(iBody, static_cast<UINT>(JointType::SpineBase));
         }
     }
 }
@@ -224,6 +242,38 @@ void BlockManPanel::Render()
 
     BlockManEffect::BlockManParams fxParams;
 
+    XMVECTOR bodyTranslation[BODY_COUNT];
+    for (int iBody = 0; iBody < BODY_COUNT; ++iBody)
+    {
+        bodyTranslation[iBody] = _blockMen[iBody]._position * XMVectorSet(_scale, _scale, _scale, 1.0f) + XMVectorSet(_offsetX, _offsetY, _offsetZ, 0);
+        _kinematics.SetBodyTransform(iBody, _blockMen[iBody]._mWorld, bodyTranslation[iBody]);
+    }
+
+    _kinematics.Solve();
+
+    // the device side of a newly read mesh
+    if (_skinnedMesh.IsLoaded() && nullptr == _skinnedMeshRenderer)
+    {
+        _skinnedMeshRenderer = ref new BlockManSkinnedMesh();
+        _skinnedMeshRenderer->Initialize(_d3dDevice.Get(), _d3dContext.Get(), _skinnedMesh);
+    }
+
+    BOOL skinned = (nullptr != _skinnedMeshRenderer);
+    if (skinned)
+    {
+        UINT bodyMask = 0;
+        for (UINT iBody = 0; iBody < BODY_COUNT; ++iBody)
+        {
+            if (!XMVector3Equal(_blockMen[iBody]._position, XMVectorZero()))
+            {
+                _skinnedMesh.SetPose(iBody, _kinematics, _blockMen[iBody]._mWorld);
+                bodyMask |= 1u << iBody;
+            }
+        }
+
+        _skinnedMesh.Skin(bodyMask, DualQuaternionSkinning ? SkinningMode::DualQuaternion : SkinningMode::Linear);
+    }
+
     for (int iBody = 0; iBody < BODY_COUNT; ++iBody)
     {
         if (XMVector3Equal(_blockMen[iBody]._position, XMVectorZero()))
@@ -240,14 +290,24 @@ void BlockManPanel::Render()
         fxParams.lightColor[1] = lightColors[1];
         fxParams.outputColor = XMFLOAT4(0, 0, 0, 0);
 
-        //
-        // Render the cubes
-        //
-        for (int blockIndex = 0; blockIndex < BLOCK_COUNT; ++blockIndex)
+        if (skinned)
+        {
+            // the skinned vertices are in the body's space, as the block transforms without the model
+            fxParams.mWorld = _blockMen[iBody]._mWorld * XMMatrixTranslationFromVector(bodyTranslation[iBody]);
+
+            _skinnedMeshRenderer->Render(_d3dContext.Get(), _skinnedMesh, iBody, &fxParams);
+        }
+        else
         {
-            fxParams.mWorld = _blockMen[iBody]._mWorld * _blockMen[iBody]._BlockTransforms[blockIndex] * XMMatrixTranslationFromVector(_blockMen[iBody]._position * XMVectorSet(_scale, _scale, _scale, 1.0f) + XMVectorSet(_offsetX, _offsetY, _offsetZ, 0));
+            //
+            // Render the cubes
+            //
+            for (int blockIndex = 0; blockIndex < BLOCK_COUNT; ++blockIndex)
+            {
+                fxParams.mWorld = _kinematics.GetWorldTransform(iBody, blockIndex);
 
-            _blockManMesh->Render(_d3dContext.Get(), TRUE, &fxParams);
+                _blockManMesh->Render(_d3dContext.Get(), TRUE, &fxParams);
+            }
         }
 
         ID3D11Buffer* buffer = nullptr;
@@ -267,6 +327,7 @@ void BlockManPanel::ResetDeviceResources()
 {
     Panel::ResetDeviceResources();
     _blockManMesh = nullptr;
+    _skinnedMeshRenderer = nullptr;
 }
 
 void BlockManPanel::CreateDeviceResources()
@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+// <copyright file="BlockManSkinnedMesh.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BlockManSkinnedMesh.h"
+
+using namespace KinectEvolution::Xaml::Controls::BlockMan;
+
+BlockManSkinnedMesh::BlockManSkinnedMesh()
+    : Mesh()
+    , _loadingComplete(FALSE)
+    , _blockManFX(nullptr)
+{
+}
+
+void BlockManSkinnedMesh::Initialize(_In_ ID3D11Device1* pD3DDevice, _In_ ID3D11DeviceContext1* const pD3DContext, _In_ const SkinnedMesh& skinnedMesh)
+{
+    _blockManFX = ref new BlockManEffect();
+    _blockManFX->Initialize(pD3DDevice);
+
+    const std::vector<UINT32>& indices = skinnedMesh.GetIndices();
+    BOOL use16BitIndex = skinnedMesh.GetVertexCount() <= 0x10000;
+
+    Mesh::Initialize(pD3DDevice, skinnedMesh.GetVertexCount(), sizeof(SkinnedVertex), static_cast<UINT>(indices.size()), use16BitIndex);
+
+    void* pIndex = Mesh::LockIndexBuffer(pD3DContext);
+    if (nullptr == pIndex)
+    {
+        return;
+    }
+
+    if (use16BitIndex)
+    {
+        UINT16* pIndex16 = reinterpret_cast<UINT16*>(pIndex);
+        for (UINT32 index : indices)
+        {
+            *pIndex16++ = static_cast<UINT16>(index);
+        }
+    }
+    else
+    {
+        memcpy(pIndex, indices.data(), indices.size() * sizeof(UINT32));
+    }
+
+    Mesh::UnlockIndexBuffer(pD3DContext);
+
+    _loadingComplete = TRUE;
+}
+
+void BlockManSkinnedMesh::Render(_In_ ID3D11DeviceContext1* pD3DContext, _In_ const SkinnedMesh& skinnedMesh, UINT bodyIndex, _In_ BlockManEffect::BlockManParams* pParams)
+{
+    if (!_loadingComplete)
+    {
+        return;
+    }
+
+    SkinnedVertex* pVertex = reinterpret_cast<SkinnedVertex*>(Mesh::LockVertexBuffer(pD3DContext));
+    if (nullptr == pVertex)
+    {
+        return;
+    }
+
+    skinnedMesh.WriteVertices(bodyIndex, pVertex);
+
+    Mesh::UnlockVertexBuffer(pD3DContext);
+
+    if (!_blockManFX->Apply(pD3DContext, pParams))
+    {
+        return;
+    }
+
+    Mesh::RenderTriangleList(pD3DContext, TRUE);
+}
@@ -0,0 +1,43 @@
+//------------------------------------------------------------------------------
+// <copyright file="BlockManSkinnedMesh.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Mesh.h"
+#include "BlockManEffect.h"
+#include "SkinnedMesh.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace BlockMan {
+
+                using namespace KinectEvolution::Xaml::Controls::Base;
+
+                // draws the vertices a SkinnedMesh skinned on the CPU, one body at a time
+                ref class BlockManSkinnedMesh sealed
+                    : Mesh
+                {
+                internal:
+                    BlockManSkinnedMesh();
+
+                    void Initialize(_In_ ID3D11Device1* pD3DDevice, _In_ ID3D11DeviceContext1* const pD3DContext, _In_ const SkinnedMesh& skinnedMesh);
+
+                    // uploads the skinned vertices of the body and draws them
+                    void Render(_In_ ID3D11DeviceContext1* pD3DContext, _In_ const SkinnedMesh& skinnedMesh, UINT bodyIndex, _In_ BlockManEffect::BlockManParams* pParams);
+
+                    BOOL IsLoadingComplete() override { return _loadingComplete; }
+
+                private:
+                    BlockManEffect^ _blockManFX;
+
+                    BOOL _loadingComplete;
+                };
+
+            }
+        }
+    }
+}
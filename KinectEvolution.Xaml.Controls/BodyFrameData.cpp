@@ -0,0 +1,104 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyFrameData.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BodyFrameData.h"
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace Windows::Foundation;
+using namespace Windows::Foundation::Collections;
+
+using namespace WindowsPreview::Kinect;
+
+void BodyFrameData::ClearBody(UINT bodyIndex)
+{
+    IsTracked[bodyIndex] = FALSE;
+    TrackingId[bodyIndex] = 0;
+    HandLeftState[bodyIndex] = HandState::Unknown;
+    HandRightState[bodyIndex] = HandState::Unknown;
+
+    for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+    {
+        UINT i = BodyJointIndex(bodyIndex, jointIndex);
+
+        PositionX[i] = PositionY[i] = PositionZ[i] = 0.0f;
+        OrientationX[i] = OrientationY[i] = OrientationZ[i] = OrientationW[i] = 0.0f;
+        TrackingState[i] = WRK::TrackingState::NotTracked;
+    }
+}
+
+void BodyFrameData::CopyBody(UINT bodyIndex, _In_ const BodyFrameData& source, UINT sourceIndex)
+{
+    IsTracked[bodyIndex] = source.IsTracked[sourceIndex];
+    TrackingId[bodyIndex] = source.TrackingId[sourceIndex];
+    HandLeftState[bodyIndex] = source.HandLeftState[sourceIndex];
+    HandRightState[bodyIndex] = source.HandRightState[sourceIndex];
+
+    for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+    {
+        UINT i = BodyJointIndex(bodyIndex, jointIndex);
+        UINT j = BodyJointIndex(sourceIndex, jointIndex);
+
+        PositionX[i] = source.PositionX[j];
+        PositionY[i] = source.PositionY[j];
+        PositionZ[i] = source.PositionZ[j];
+        OrientationX[i] = source.OrientationX[j];
+        OrientationY[i] = source.OrientationY[j];
+        OrientationZ[i] = source.OrientationZ[j];
+        OrientationW[i] = source.OrientationW[j];
+        TrackingState[i] = source.TrackingState[j];
+    }
+}
+
+void BodyFrameData::Load(
+    _In_ IVector<Body^>^ bodies,
+    TimeSpan relativeTime,
+    Vector4 floorClipPlane)
+{
+    RelativeTime = relativeTime.Duration;
+    FloorClipPlane = XMFLOAT4(floorClipPlane.X, floorClipPlane.Y, floorClipPlane.Z, floorClipPlane.W);
+
+    UINT bodyCount = (nullptr != bodies) ? min(bodies->Size, static_cast<UINT>(BODY_COUNT)) : 0;
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        Body^ body = (bodyIndex < bodyCount) ? bodies->GetAt(bodyIndex) : nullptr;
+
+        if (nullptr == body || !body->IsTracked)
+        {
+            ClearBody(bodyIndex);
+            continue;
+        }
+
+        IsTracked[bodyIndex] = TRUE;
+        TrackingId[bodyIndex] = body->TrackingId;
+        HandLeftState[bodyIndex] = body->HandLeftState;
+        HandRightState[bodyIndex] = body->HandRightState;
+
+        for (auto pair : body->Joints)
+        {
+            Joint joint = pair->Value;
+            UINT i = BodyJointIndex(bodyIndex, static_cast<UINT>(pair->Key));
+
+            PositionX[i] = joint.Position.X;
+            PositionY[i] = joint.Position.Y;
+            PositionZ[i] = joint.Position.Z;
+            TrackingState[i] = joint.TrackingState;
+        }
+
+        for (auto pair : body->JointOrientations)
+        {
+            Vector4 orientation = pair->Value.Orientation;
+            UINT i = BodyJointIndex(bodyIndex, static_cast<UINT>(pair->Key));
+
+            OrientationX[i] = orientation.X;
+            OrientationY[i] = orientation.Y;
+            OrientationZ[i] = orientation.Z;
+            OrientationW[i] = orientation.W;
+        }
+    }
+}
@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyFrameData.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                struct Bone
+                {
+                    WRK::JointType JointA;
+                    WRK::JointType JointB;
+                };
+
+                static const struct Bone BodyBones [] =
+                {
+                    { WRK::JointType::SpineBase, WRK::JointType::SpineMid },
+                    { WRK::JointType::SpineMid, WRK::JointType::SpineShoulder },
+                    { WRK::JointType::SpineShoulder, WRK::JointType::Neck },
+                    { WRK::JointType::Neck, WRK::JointType::Head },
+                    { WRK::JointType::SpineShoulder, WRK::JointType::ShoulderLeft },
+                    { WRK::JointType::ShoulderLeft, WRK::JointType::ElbowLeft },
+                    { WRK::JointType::ElbowLeft, WRK::JointType::WristLeft },
+                    { WRK::JointType::WristLeft, WRK::JointType::HandLeft },
+                    { WRK::JointType::HandLeft, WRK::JointType::HandTipLeft },
+                    { WRK::JointType::WristLeft, WRK::JointType::ThumbLeft },
+                    { WRK::JointType::SpineShoulder, WRK::JointType::ShoulderRight },
+                    { WRK::JointType::ShoulderRight, WRK::JointType::ElbowRight },
+                    { WRK::JointType::ElbowRight, WRK::JointType::WristRight },
+                    { WRK::JointType::WristRight, WRK::JointType::HandRight },
+                    { WRK::JointType::HandRight, WRK::JointType::HandTipRight },
+                    { WRK::JointType::WristRight, WRK::JointType::ThumbRight },
+                    { WRK::JointType::SpineBase, WRK::JointType::HipLeft },
+                    { WRK::JointType::HipLeft, WRK::JointType::KneeLeft },
+                    { WRK::JointType::KneeLeft, WRK::JointType::AnkleLeft },
+                    { WRK::JointType::AnkleLeft, WRK::JointType::FootLeft },
+                    { WRK::JointType::SpineBase, WRK::JointType::HipRight },
+                    { WRK::JointType::HipRight, WRK::JointType::KneeRight },
+                    { WRK::JointType::KneeRight, WRK::JointType::AnkleRight },
+                    { WRK::JointType::AnkleRight, WRK::JointType::FootRight },
+                };
+
+                static const UINT BONE_COUNT = _countof(BodyBones);
+
+                static const int BODY_COUNT = 6;
+                static const int JOINT_COUNT = 25;
+
+                // joints of all bodies, body major, padded to a whole number of 4 wide vectors
+                static const UINT BODY_JOINT_COUNT = BODY_COUNT * JOINT_COUNT;
+                static const UINT BODY_JOINT_STRIDE = (BODY_JOINT_COUNT + 3) & ~3;
+
+                inline UINT BodyJointIndex(UINT bodyIndex, UINT jointIndex)
+                {
+                    return bodyIndex * JOINT_COUNT + jointIndex;
+                }
+
+                // one body frame in structure of arrays form
+                struct BodyFrameData
+                {
+                    float   PositionX[BODY_JOINT_STRIDE];
+                    float   PositionY[BODY_JOINT_STRIDE];
+                    float   PositionZ[BODY_JOINT_STRIDE];
+
+                    float   OrientationX[BODY_JOINT_STRIDE];
+                    float   OrientationY[BODY_JOINT_STRIDE];
+                    float   OrientationZ[BODY_JOINT_STRIDE];
+                    float   OrientationW[BODY_JOINT_STRIDE];
+
+                    WRK::TrackingState  TrackingState[BODY_JOINT_STRIDE];
+
+                    UINT64              TrackingId[BODY_COUNT];
+                    BOOL                IsTracked[BODY_COUNT];
+                    WRK::HandState      HandLeftState[BODY_COUNT];
+                    WRK::HandState      HandRightState[BODY_COUNT];
+
+                    // sensor time of the frame in 100ns units
+                    INT64               RelativeTime;
+                    XMFLOAT4            FloorClipPlane;
+
+                    BodyFrameData()
+                    {
+                        Clear();
+                    }
+
+                    void Clear()
+                    {
+                        ZeroMemory(this, sizeof(*this));
+                    }
+
+                    // marks a body slot as empty
+                    void ClearBody(UINT bodyIndex);
+
+                    // copies one body of another frame into a slot of this one
+                    void CopyBody(UINT bodyIndex, _In_ const BodyFrameData& source, UINT sourceIndex);
+
+                    // copies the bodies refreshed by BodyFrame::GetAndRefreshBodyData
+                    void Load(
+                        _In_ Windows::Foundation::Collections::IVector<WRK::Body^>^ bodies,
+                        Windows::Foundation::TimeSpan relativeTime,
+                        WRK::Vector4 floorClipPlane);
+
+                    XMVECTOR GetPosition(UINT bodyIndex, UINT jointIndex) const
+                    {
+                        UINT i = BodyJointIndex(bodyIndex, jointIndex);
+                        return XMVectorSet(PositionX[i], PositionY[i], PositionZ[i], 0.0f);
+                    }
+
+                    XMVECTOR GetOrientation(UINT bodyIndex, UINT jointIndex) const
+                    {
+                        UINT i = BodyJointIndex(bodyIndex, jointIndex);
+                        return XMVectorSet(OrientationX[i], OrientationY[i], OrientationZ[i], OrientationW[i]);
+                    }
+
+                    WRK::TrackingState GetTrackingState(UINT bodyIndex, UINT jointIndex) const
+                    {
+                        return TrackingState[BodyJointIndex(bodyIndex, jointIndex)];
+                    }
+                };
+
+            }
+        }
+    }
+}
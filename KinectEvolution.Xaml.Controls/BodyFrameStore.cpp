@@ -0,0 +1,706 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyFrameStore.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BodyFrameStore.h"
+
+#include <algorithm>
+#include <climits>
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace WindowsPreview::Kinect;
+
+// quantization steps
+static const float POSITION_SCALE = 1000.0f;            // millimeters
+static const float FLOOR_SCALE = 10000.0f;
+static const float ROTATION_SCALE = 32767.0f * 1.41421356f; // smallest three components are within +-1/sqrt(2)
+
+// joint flags
+static const INT32 ROTATION_LARGEST_MASK = 0x3;
+static const INT32 ROTATION_ZERO = 0x4;
+static const INT32 TRACKING_STATE_SHIFT = 3;
+
+// body flags
+static const INT32 BODY_TRACKED = 0x1;
+static const INT32 HAND_LEFT_SHIFT = 1;
+static const INT32 HAND_RIGHT_SHIFT = 4;
+static const INT32 HAND_STATE_MASK = 0x7;
+
+// values of one 32 bit lane in a packed column, the 4 lanes hold consecutive frames
+static const UINT LANE_VALUES = BODY_STORE_BLOCK_FRAMES / 4;
+
+inline INT32 Quantize(float value, float scale)
+{
+    // keeps garbage input from overflowing the conversion
+    float scaled = min(max(value * scale, -1.0e9f), 1.0e9f);
+    return static_cast<INT32>(floorf(scaled + 0.5f));
+}
+
+inline void EncodeRotation(float x, float y, float z, float w, _Out_writes_(3) INT32* pSmallest, _Out_ INT32* pFlags)
+{
+    float q[4] = { x, y, z, w };
+
+    // a zero quaternion marks a joint without orientation and must come back as zero
+    if (0.0f == x && 0.0f == y && 0.0f == z && 0.0f == w)
+    {
+        pSmallest[0] = pSmallest[1] = pSmallest[2] = 0;
+        *pFlags = ROTATION_ZERO;
+        return;
+    }
+
+    UINT largest = 0;
+    for (UINT i = 1; i < 4; ++i)
+    {
+        if (fabsf(q[i]) > fabsf(q[largest]))
+        {
+            largest = i;
+        }
+    }
+
+    // q and -q are the same rotation, keep the dropped component positive
+    float scale = ROTATION_SCALE / sqrtf(x * x + y * y + z * z + w * w);
+    if (q[largest] < 0.0f)
+    {
+        scale = -scale;
+    }
+
+    UINT k = 0;
+    for (UINT i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+        {
+            pSmallest[k++] = Quantize(q[i], scale);
+        }
+    }
+
+    *pFlags = static_cast<INT32>(largest);
+}
+
+inline void DecodeRotation(INT32 a, INT32 b, INT32 c, INT32 flags, _Out_writes_(4) float* pRotation)
+{
+    if (flags & ROTATION_ZERO)
+    {
+        pRotation[0] = pRotation[1] = pRotation[2] = pRotation[3] = 0.0f;
+        return;
+    }
+
+    float smallest[3] =
+    {
+        static_cast<float>(a) / ROTATION_SCALE,
+        static_cast<float>(b) / ROTATION_SCALE,
+        static_cast<float>(c) / ROTATION_SCALE,
+    };
+
+    UINT largest = static_cast<UINT>(flags & ROTATION_LARGEST_MASK);
+    float sum = smallest[0] * smallest[0] + smallest[1] * smallest[1] + smallest[2] * smallest[2];
+
+    UINT k = 0;
+    for (UINT i = 0; i < 4; ++i)
+    {
+        pRotation[i] = (i == largest) ? sqrtf(max(0.0f, 1.0f - sum)) : smallest[k++];
+    }
+}
+
+BodyFrameStore::BodyFrameStore()
+    : _maxFrames(0)
+    , _pending(COLUMN_COUNT * BODY_STORE_BLOCK_FRAMES)
+{
+    Clear();
+}
+
+void BodyFrameStore::Clear()
+{
+    _blocks.clear();
+    _columns.clear();
+    _packed.clear();
+
+    _firstFrame = 0;
+    _frameCount = 0;
+    _pendingCount = 0;
+    _pendingStartTime = 0;
+    _lastTime = 0;
+}
+
+void BodyFrameStore::SetMaxFrames(UINT maxFrames)
+{
+    _maxFrames = maxFrames;
+    DropBlocks();
+}
+
+size_t BodyFrameStore::GetStorageSize() const
+{
+    size_t size = _packed.size() * sizeof(UINT32) + _columns.size() * sizeof(ColumnHeader) + _pending.size() * sizeof(INT32);
+
+    for (const BlockHeader& block : _blocks)
+    {
+        size += sizeof(BlockHeader) + block.TrackingIds.size() * sizeof(UINT64);
+    }
+
+    return size;
+}
+
+bool BodyFrameStore::Append(_In_ const BodyFrameData& frame)
+{
+    if (_frameCount > 0 && frame.RelativeTime <= _lastTime)
+    {
+        return false;
+    }
+
+    // the time column holds 32 bit offsets from the block start
+    if (_pendingCount > 0 && frame.RelativeTime - _pendingStartTime > INT_MAX)
+    {
+        SealBlock();
+    }
+
+    if (0 == _pendingCount)
+    {
+        _pendingStartTime = frame.RelativeTime;
+    }
+
+    INT32* pValues = &_pending[_pendingCount];
+
+    for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+    {
+        pValues[GetJointColumn(PositionX, i) * BODY_STORE_BLOCK_FRAMES] = Quantize(frame.PositionX[i], POSITION_SCALE);
+        pValues[GetJointColumn(PositionY, i) * BODY_STORE_BLOCK_FRAMES] = Quantize(frame.PositionY[i], POSITION_SCALE);
+        pValues[GetJointColumn(PositionZ, i) * BODY_STORE_BLOCK_FRAMES] = Quantize(frame.PositionZ[i], POSITION_SCALE);
+
+        INT32 smallest[3];
+        INT32 flags;
+        EncodeRotation(frame.OrientationX[i], frame.OrientationY[i], frame.OrientationZ[i], frame.OrientationW[i], smallest, &flags);
+
+        pValues[GetJointColumn(RotationA, i) * BODY_STORE_BLOCK_FRAMES] = smallest[0];
+        pValues[GetJointColumn(RotationB, i) * BODY_STORE_BLOCK_FRAMES] = smallest[1];
+        pValues[GetJointColumn(RotationC, i) * BODY_STORE_BLOCK_FRAMES] = smallest[2];
+        pValues[GetJointColumn(JointFlags, i) * BODY_STORE_BLOCK_FRAMES] = flags | (static_cast<INT32>(frame.TrackingState[i]) << TRACKING_STATE_SHIFT);
+    }
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        INT32 flags = (frame.IsTracked[bodyIndex] ? BODY_TRACKED : 0)
+            | (static_cast<INT32>(frame.HandLeftState[bodyIndex]) << HAND_LEFT_SHIFT)
+            | (static_cast<INT32>(frame.HandRightState[bodyIndex]) << HAND_RIGHT_SHIFT);
+
+        pValues[GetBodyColumn(TrackingIdLow, bodyIndex) * BODY_STORE_BLOCK_FRAMES] = static_cast<INT32>(frame.TrackingId[bodyIndex] & 0xFFFFFFFF);
+        pValues[GetBodyColumn(TrackingIdHigh, bodyIndex) * BODY_STORE_BLOCK_FRAMES] = static_cast<INT32>(frame.TrackingId[bodyIndex] >> 32);
+        pValues[GetBodyColumn(BodyFlags, bodyIndex) * BODY_STORE_BLOCK_FRAMES] = flags;
+    }
+
+    pValues[GetFrameColumn(FrameTime) * BODY_STORE_BLOCK_FRAMES] = static_cast<INT32>(frame.RelativeTime - _pendingStartTime);
+    pValues[GetFrameColumn(FloorX) * BODY_STORE_BLOCK_FRAMES] = Quantize(frame.FloorClipPlane.x, FLOOR_SCALE);
+    pValues[GetFrameColumn(FloorY) * BODY_STORE_BLOCK_FRAMES] = Quantize(frame.FloorClipPlane.y, FLOOR_SCALE);
+    pValues[GetFrameColumn(FloorZ) * BODY_STORE_BLOCK_FRAMES] = Quantize(frame.FloorClipPlane.z, FLOOR_SCALE);
+    pValues[GetFrameColumn(FloorW) * BODY_STORE_BLOCK_FRAMES] = Quantize(frame.FloorClipPlane.w, FLOOR_SCALE);
+
+    _lastTime = frame.RelativeTime;
+    ++_pendingCount;
+    ++_frameCount;
+
+    if (BODY_STORE_BLOCK_FRAMES == _pendingCount)
+    {
+        SealBlock();
+    }
+
+    return true;
+}
+
+void BodyFrameStore::SealBlock()
+{
+    if (0 == _pendingCount)
+    {
+        return;
+    }
+
+    BlockHeader block;
+    block.StartTime = _pendingStartTime;
+    block.EndTime = _lastTime;
+    block.FirstFrame = GetPendingFirstFrame();
+    block.FrameCount = _pendingCount;
+
+    for (UINT column = 0; column < COLUMN_COUNT; ++column)
+    {
+        INT32* pValues = &_pending[column * BODY_STORE_BLOCK_FRAMES];
+
+        // repeating the last value pads a short block with zero deltas
+        for (UINT i = _pendingCount; i < BODY_STORE_BLOCK_FRAMES; ++i)
+        {
+            pValues[i] = pValues[_pendingCount - 1];
+        }
+
+        ColumnHeader header;
+        PackColumn(pValues, header);
+        _columns.push_back(header);
+    }
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        const INT32* pLow = &_pending[GetBodyColumn(TrackingIdLow, bodyIndex) * BODY_STORE_BLOCK_FRAMES];
+        const INT32* pHigh = &_pending[GetBodyColumn(TrackingIdHigh, bodyIndex) * BODY_STORE_BLOCK_FRAMES];
+
+        UINT64 previous = 0;
+        for (UINT i = 0; i < _pendingCount; ++i)
+        {
+            UINT64 trackingId = static_cast<UINT32>(pLow[i]) | (static_cast<UINT64>(static_cast<UINT32>(pHigh[i])) << 32);
+            if (0 != trackingId && previous != trackingId)
+            {
+                block.TrackingIds.push_back(trackingId);
+            }
+
+            previous = trackingId;
+        }
+    }
+
+    std::sort(block.TrackingIds.begin(), block.TrackingIds.end());
+    block.TrackingIds.erase(std::unique(block.TrackingIds.begin(), block.TrackingIds.end()), block.TrackingIds.end());
+
+    _blocks.push_back(block);
+    _pendingCount = 0;
+
+    DropBlocks();
+}
+
+void BodyFrameStore::DropBlocks()
+{
+    if (0 == _maxFrames)
+    {
+        return;
+    }
+
+    // whole sealed blocks go, as long as maxFrames are left after them
+    size_t drop = 0;
+    while (drop < _blocks.size() && _frameCount - GetBlockFirstFrame(drop + 1) >= _maxFrames)
+    {
+        ++drop;
+    }
+
+    if (0 == drop)
+    {
+        return;
+    }
+
+    _blocks.erase(_blocks.begin(), _blocks.begin() + drop);
+    _columns.erase(_columns.begin(), _columns.begin() + drop * COLUMN_COUNT);
+    _firstFrame = GetBlockFirstFrame(0);
+
+    // the words of dropped blocks are reclaimed once they are half the packed buffer, so a full store
+    // does not move everything it keeps on every block
+    UINT dropped = _columns.empty() ? static_cast<UINT>(_packed.size()) : _columns[0].Offset;
+    if (2 * static_cast<size_t>(dropped) < _packed.size())
+    {
+        return;
+    }
+
+    _packed.erase(_packed.begin(), _packed.begin() + dropped);
+    for (ColumnHeader& header : _columns)
+    {
+        header.Offset -= dropped;
+    }
+}
+
+void BodyFrameStore::PackColumn(_In_reads_(BODY_STORE_BLOCK_FRAMES) const INT32* pValues, _Out_ ColumnHeader& header)
+{
+    UINT32 deltas[BODY_STORE_BLOCK_FRAMES];
+    UINT32 all = 0;
+
+    INT32 previous = pValues[0];
+    for (UINT i = 0; i < BODY_STORE_BLOCK_FRAMES; ++i)
+    {
+        // zigzag keeps small negative deltas small
+        INT32 delta = static_cast<INT32>(static_cast<UINT32>(pValues[i]) - static_cast<UINT32>(previous));
+        deltas[i] = (static_cast<UINT32>(delta) << 1) ^ static_cast<UINT32>(delta >> 31);
+        all |= deltas[i];
+        previous = pValues[i];
+    }
+
+    UINT bits = 0;
+    for (; 0 != all; all >>= 1)
+    {
+        ++bits;
+    }
+
+    header.Base = pValues[0];
+    header.Offset = static_cast<UINT>(_packed.size());
+    header.Bits = bits;
+
+    if (0 == bits)
+    {
+        return;
+    }
+
+    // value i goes to lane i % 4, each lane is a little endian bit stream of LANE_VALUES values
+    _packed.resize(_packed.size() + 4 * LANE_VALUES * bits / 32, 0);
+
+    for (UINT lane = 0; lane < 4; ++lane)
+    {
+        UINT32* pOut = &_packed[header.Offset + lane];
+        UINT64 accumulator = 0;
+        UINT accumulatorBits = 0;
+
+        for (UINT i = 0; i < LANE_VALUES; ++i)
+        {
+            accumulator |= static_cast<UINT64>(deltas[i * 4 + lane]) << accumulatorBits;
+            accumulatorBits += bits;
+
+            if (accumulatorBits >= 32)
+            {
+                *pOut = static_cast<UINT32>(accumulator);
+                pOut += 4;
+                accumulator >>= 32;
+                accumulatorBits -= 32;
+            }
+        }
+    }
+}
+
+void BodyFrameStore::DecodeColumn(size_t blockIndex, UINT column, _Out_writes_(BODY_STORE_BLOCK_FRAMES) INT32* pValues) const
+{
+    if (blockIndex >= _blocks.size())
+    {
+        CopyMemory(pValues, &_pending[column * BODY_STORE_BLOCK_FRAMES], BODY_STORE_BLOCK_FRAMES * sizeof(INT32));
+        return;
+    }
+
+    const ColumnHeader& header = _columns[blockIndex * COLUMN_COUNT + column];
+    __m128i running = _mm_set1_epi32(header.Base);
+
+    if (0 == header.Bits)
+    {
+        for (UINT i = 0; i < BODY_STORE_BLOCK_FRAMES; i += 4)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pValues + i), running);
+        }
+
+        return;
+    }
+
+    const UINT bits = header.Bits;
+    const __m128i mask = _mm_set1_epi32(bits < 32 ? static_cast<int>((1u << bits) - 1) : -1);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i zero = _mm_setzero_si128();
+
+    const __m128i* pIn = reinterpret_cast<const __m128i*>(&_packed[header.Offset]);
+    __m128i word = _mm_loadu_si128(pIn);
+    UINT offset = 0;
+
+    for (UINT i = 0; i < LANE_VALUES; ++i)
+    {
+        // unpack the next value of every lane
+        __m128i value = _mm_srl_epi32(word, _mm_cvtsi32_si128(offset));
+        offset += bits;
+
+        if (offset >= 32 && i + 1 < LANE_VALUES)
+        {
+            offset -= 32;
+            word = _mm_loadu_si128(++pIn);
+
+            if (offset > 0)
+            {
+                value = _mm_or_si128(value, _mm_sll_epi32(word, _mm_cvtsi32_si128(bits - offset)));
+            }
+        }
+
+        value = _mm_and_si128(value, mask);
+
+        // undo the zigzag
+        value = _mm_xor_si128(_mm_srli_epi32(value, 1), _mm_sub_epi32(zero, _mm_and_si128(value, one)));
+
+        // the lanes are consecutive frames, prefix sum them onto the last value
+        value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+        value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+        value = _mm_add_epi32(value, running);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pValues + i * 4), value);
+        running = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+}
+
+size_t BodyFrameStore::FindBlock(UINT frameIndex) const
+{
+    if (frameIndex >= GetPendingFirstFrame())
+    {
+        return _blocks.size();
+    }
+
+    auto it = std::upper_bound(_blocks.begin(), _blocks.end(), frameIndex,
+        [](UINT frame, const BlockHeader& block) { return frame < block.FirstFrame; });
+
+    return static_cast<size_t>(it - _blocks.begin()) - 1;
+}
+
+UINT BodyFrameStore::GetBlockFirstFrame(size_t blockIndex) const
+{
+    return (blockIndex < _blocks.size()) ? _blocks[blockIndex].FirstFrame : GetPendingFirstFrame();
+}
+
+UINT BodyFrameStore::GetBlockFrameCount(size_t blockIndex) const
+{
+    return (blockIndex < _blocks.size()) ? _blocks[blockIndex].FrameCount : _pendingCount;
+}
+
+INT64 BodyFrameStore::GetBlockStartTime(size_t blockIndex) const
+{
+    return (blockIndex < _blocks.size()) ? _blocks[blockIndex].StartTime : _pendingStartTime;
+}
+
+INT64 BodyFrameStore::GetFrameTime(UINT frameIndex) const
+{
+    ASSERT(frameIndex >= _firstFrame && frameIndex < _frameCount);
+
+    size_t blockIndex = FindBlock(frameIndex);
+
+    INT32 offsets[BODY_STORE_BLOCK_FRAMES];
+    DecodeColumn(blockIndex, GetFrameColumn(FrameTime), offsets);
+
+    return GetBlockStartTime(blockIndex) + offsets[frameIndex - GetBlockFirstFrame(blockIndex)];
+}
+
+UINT BodyFrameStore::LowerBoundTime(INT64 time) const
+{
+    if (0 == _frameCount || time > _lastTime)
+    {
+        return _frameCount;
+    }
+
+    // first block ending at or after time, the pending frames otherwise
+    auto it = std::partition_point(_blocks.begin(), _blocks.end(),
+        [time](const BlockHeader& block) { return block.EndTime < time; });
+    size_t blockIndex = static_cast<size_t>(it - _blocks.begin());
+
+    INT64 startTime = GetBlockStartTime(blockIndex);
+    if (time <= startTime)
+    {
+        return GetBlockFirstFrame(blockIndex);
+    }
+
+    INT32 offsets[BODY_STORE_BLOCK_FRAMES];
+    DecodeColumn(blockIndex, GetFrameColumn(FrameTime), offsets);
+
+    // offsets only grow within a block
+    UINT count = GetBlockFrameCount(blockIndex);
+    const INT32* pFound = std::lower_bound(offsets, offsets + count, static_cast<INT32>(time - startTime));
+
+    return GetBlockFirstFrame(blockIndex) + static_cast<UINT>(pFound - offsets);
+}
+
+UINT BodyFrameStore::FindFrames(INT64 startTime, INT64 endTime, _Out_ UINT* pFirstFrame) const
+{
+    *pFirstFrame = 0;
+
+    if (startTime >= endTime)
+    {
+        return 0;
+    }
+
+    UINT first = LowerBoundTime(startTime);
+    UINT last = LowerBoundTime(endTime);
+
+    *pFirstFrame = first;
+    return last - first;
+}
+
+void BodyFrameStore::FindTrackingId(UINT64 trackingId, INT64 startTime, INT64 endTime, _Inout_ std::vector<BodyFrameRange>& ranges) const
+{
+    UINT firstFrame;
+    UINT frameCount = FindFrames(startTime, endTime, &firstFrame);
+    if (0 == frameCount || 0 == trackingId)
+    {
+        return;
+    }
+
+    const UINT endFrame = firstFrame + frameCount;
+    const INT32 low = static_cast<INT32>(trackingId & 0xFFFFFFFF);
+    const INT32 high = static_cast<INT32>(trackingId >> 32);
+
+    // index in ranges of the run each body slot is extending
+    size_t openRange[BODY_COUNT];
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        openRange[bodyIndex] = SIZE_MAX;
+    }
+
+    INT32 lowValues[BODY_STORE_BLOCK_FRAMES];
+    INT32 highValues[BODY_STORE_BLOCK_FRAMES];
+
+    for (size_t blockIndex = FindBlock(firstFrame); blockIndex <= _blocks.size(); ++blockIndex)
+    {
+        UINT blockFirst = GetBlockFirstFrame(blockIndex);
+        if (blockFirst >= endFrame)
+        {
+            break;
+        }
+
+        // the block index skips blocks that never saw the id
+        if (blockIndex < _blocks.size() &&
+            !std::binary_search(_blocks[blockIndex].TrackingIds.begin(), _blocks[blockIndex].TrackingIds.end(), trackingId))
+        {
+            continue;
+        }
+
+        UINT begin = max(firstFrame, blockFirst);
+        UINT end = min(endFrame, blockFirst + GetBlockFrameCount(blockIndex));
+
+        for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+        {
+            DecodeColumn(blockIndex, GetBodyColumn(TrackingIdLow, bodyIndex), lowValues);
+            DecodeColumn(blockIndex, GetBodyColumn(TrackingIdHigh, bodyIndex), highValues);
+
+            for (UINT frame = begin; frame < end; ++frame)
+            {
+                UINT i = frame - blockFirst;
+                if (lowValues[i] != low || highValues[i] != high)
+                {
+                    continue;
+                }
+
+                size_t open = openRange[bodyIndex];
+                if (SIZE_MAX != open && ranges[open].FirstFrame + ranges[open].FrameCount == frame)
+                {
+                    ++ranges[open].FrameCount;
+                }
+                else
+                {
+                    BodyFrameRange range = { frame, 1, bodyIndex };
+                    openRange[bodyIndex] = ranges.size();
+                    ranges.push_back(range);
+                }
+            }
+        }
+    }
+}
+
+void BodyFrameStore::GetFrames(UINT firstFrame, UINT frameCount, _Out_writes_(frameCount) BodyFrameData* pFrames) const
+{
+    ASSERT(firstFrame >= _firstFrame && firstFrame + frameCount <= _frameCount);
+
+    UINT done = 0;
+    while (done < frameCount)
+    {
+        UINT frame = firstFrame + done;
+        size_t blockIndex = FindBlock(frame);
+        UINT blockFirst = GetBlockFirstFrame(blockIndex);
+        UINT count = min(frameCount - done, blockFirst + GetBlockFrameCount(blockIndex) - frame);
+
+        DecodeFrames(blockIndex, frame - blockFirst, count, pFrames + done);
+        done += count;
+    }
+}
+
+void BodyFrameStore::DecodeFrames(size_t blockIndex, UINT first, UINT count, _Out_writes_(count) BodyFrameData* pFrames) const
+{
+    INT32 values[4][BODY_STORE_BLOCK_FRAMES];
+
+    for (UINT k = 0; k < count; ++k)
+    {
+        pFrames[k].Clear();
+    }
+
+    for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+    {
+        DecodeColumn(blockIndex, GetJointColumn(PositionX, i), values[0]);
+        DecodeColumn(blockIndex, GetJointColumn(PositionY, i), values[1]);
+        DecodeColumn(blockIndex, GetJointColumn(PositionZ, i), values[2]);
+
+        for (UINT k = 0; k < count; ++k)
+        {
+            pFrames[k].PositionX[i] = static_cast<float>(values[0][first + k]) / POSITION_SCALE;
+            pFrames[k].PositionY[i] = static_cast<float>(values[1][first + k]) / POSITION_SCALE;
+            pFrames[k].PositionZ[i] = static_cast<float>(values[2][first + k]) / POSITION_SCALE;
+        }
+
+        DecodeColumn(blockIndex, GetJointColumn(RotationA, i), values[0]);
+        DecodeColumn(blockIndex, GetJointColumn(RotationB, i), values[1]);
+        DecodeColumn(blockIndex, GetJointColumn(RotationC, i), values[2]);
+        DecodeColumn(blockIndex, GetJointColumn(JointFlags, i), values[3]);
+
+        for (UINT k = 0; k < count; ++k)
+        {
+            UINT j = first + k;
+
+            float rotation[4];
+            DecodeRotation(values[0][j], values[1][j], values[2][j], values[3][j], rotation);
+
+            pFrames[k].OrientationX[i] = rotation[0];
+            pFrames[k].OrientationY[i] = rotation[1];
+            pFrames[k].OrientationZ[i] = rotation[2];
+            pFrames[k].OrientationW[i] = rotation[3];
+            pFrames[k].TrackingState[i] = static_cast<WRK::TrackingState>(values[3][j] >> TRACKING_STATE_SHIFT);
+        }
+    }
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        DecodeColumn(blockIndex, GetBodyColumn(TrackingIdLow, bodyIndex), values[0]);
+        DecodeColumn(blockIndex, GetBodyColumn(TrackingIdHigh, bodyIndex), values[1]);
+        DecodeColumn(blockIndex, GetBodyColumn(BodyFlags, bodyIndex), values[2]);
+
+        for (UINT k = 0; k < count; ++k)
+        {
+            UINT j = first + k;
+            INT32 flags = values[2][j];
+
+            pFrames[k].TrackingId[bodyIndex] = static_cast<UINT32>(values[0][j]) | (static_cast<UINT64>(static_cast<UINT32>(values[1][j])) << 32);
+            pFrames[k].IsTracked[bodyIndex] = (flags & BODY_TRACKED) ? TRUE : FALSE;
+            pFrames[k].HandLeftState[bodyIndex] = static_cast<WRK::HandState>((flags >> HAND_LEFT_SHIFT) & HAND_STATE_MASK);
+            pFrames[k].HandRightState[bodyIndex] = static_cast<WRK::HandState>((flags >> HAND_RIGHT_SHIFT) & HAND_STATE_MASK);
+        }
+    }
+
+    INT64 startTime = GetBlockStartTime(blockIndex);
+    DecodeColumn(blockIndex, GetFrameColumn(FrameTime), values[0]);
+
+    for (UINT k = 0; k < count; ++k)
+    {
+        pFrames[k].RelativeTime = startTime + values[0][first + k];
+    }
+
+    DecodeColumn(blockIndex, GetFrameColumn(FloorX), values[0]);
+    DecodeColumn(blockIndex, GetFrameColumn(FloorY), values[1]);
+    DecodeColumn(blockIndex, GetFrameColumn(FloorZ), values[2]);
+    DecodeColumn(blockIndex, GetFrameColumn(FloorW), values[3]);
+
+    for (UINT k = 0; k < count; ++k)
+    {
+        UINT j = first + k;
+        pFrames[k].FloorClipPlane = XMFLOAT4(
+            static_cast<float>(values[0][j]) / FLOOR_SCALE,
+            static_cast<float>(values[1][j]) / FLOOR_SCALE,
+            static_cast<float>(values[2][j]) / FLOOR_SCALE,
+            static_cast<float>(values[3][j]) / FLOOR_SCALE);
+    }
+}
+
+void BodyFrameStore::GetJointPositions(UINT firstFrame, UINT frameCount, UINT bodyIndex, UINT jointIndex, _Out_writes_(frameCount) XMFLOAT3* pPositions) const
+{
+    ASSERT(firstFrame >= _firstFrame && firstFrame + frameCount <= _frameCount);
+    ASSERT(bodyIndex < BODY_COUNT && jointIndex < JOINT_COUNT);
+
+    UINT i = BodyJointIndex(bodyIndex, jointIndex);
+    INT32 values[3][BODY_STORE_BLOCK_FRAMES];
+
+    UINT done = 0;
+    while (done < frameCount)
+    {
+        UINT frame = firstFrame + done;
+        size_t blockIndex = FindBlock(frame);
+        UINT first = frame - GetBlockFirstFrame(blockIndex);
+        UINT count = min(frameCount - done, GetBlockFrameCount(blockIndex) - first);
+
+        DecodeColumn(blockIndex, GetJointColumn(PositionX, i), values[0]);
+        DecodeColumn(blockIndex, GetJointColumn(PositionY, i), values[1]);
+        DecodeColumn(blockIndex, GetJointColumn(PositionZ, i), values[2]);
+
+        for (UINT k = 0; k < count; ++k)
+        {
+            pPositions[done + k] = XMFLOAT3(
+                static_cast<float>(values[0][first + k]) / POSITION_SCALE,
+                static_cast<float>(values[1][first + k]) / POSITION_SCALE,
+                static_cast<float>(values[2][first + k]) / POSITION_SCALE);
+        }
+
+        done += count;
+    }
+}
@@ -0,0 +1,162 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyFrameStore.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                // frames per compressed block
+                static const UINT BODY_STORE_BLOCK_FRAMES = 256;
+
+                // frames [FirstFrame, FirstFrame + FrameCount) in which BodyIndex carried a tracking id
+                struct BodyFrameRange
+                {
+                    UINT    FirstFrame;
+                    UINT    FrameCount;
+                    UINT    BodyIndex;
+                };
+
+                // in memory recording of body frames, one column per joint component.
+                // positions are kept to the millimeter and orientations as smallest three quaternions;
+                // every block of 256 frames stores each column as zigzag deltas bit packed to the widest delta.
+                class BodyFrameStore
+                {
+                public:
+                    BodyFrameStore();
+
+                    void Clear();
+
+                    // once more than maxFrames are kept the oldest blocks are dropped, at least maxFrames stay.
+                    // 0 keeps every frame
+                    void SetMaxFrames(UINT maxFrames);
+                    UINT GetMaxFrames() const { return _maxFrames; }
+
+                    // frames must arrive in increasing RelativeTime, older frames are dropped and return false
+                    bool Append(_In_ const BodyFrameData& frame);
+
+                    // frames keep the index they were appended with, [GetFirstFrame(), GetFrameCount()) are kept
+                    UINT GetFirstFrame() const { return _firstFrame; }
+                    UINT GetFrameCount() const { return _frameCount; }
+
+                    // bytes held by the packed blocks and the pending frames
+                    size_t GetStorageSize() const;
+
+                    // frames with startTime <= RelativeTime < endTime, returns the count and the first frame
+                    UINT FindFrames(INT64 startTime, INT64 endTime, _Out_ UINT* pFirstFrame) const;
+
+                    // runs of frames between startTime and endTime in which a body slot carried trackingId
+                    void FindTrackingId(UINT64 trackingId, INT64 startTime, INT64 endTime, _Inout_ std::vector<BodyFrameRange>& ranges) const;
+
+                    // decodes frames [firstFrame, firstFrame + frameCount)
+                    void GetFrames(UINT firstFrame, UINT frameCount, _Out_writes_(frameCount) BodyFrameData* pFrames) const;
+
+                    // decodes only the position columns of one joint
+                    void GetJointPositions(UINT firstFrame, UINT frameCount, UINT bodyIndex, UINT jointIndex, _Out_writes_(frameCount) XMFLOAT3* pPositions) const;
+
+                    INT64 GetFrameTime(UINT frameIndex) const;
+
+                private:
+                    enum JointColumn
+                    {
+                        PositionX,
+                        PositionY,
+                        PositionZ,
+                        RotationA,      // the three smallest quaternion components
+                        RotationB,
+                        RotationC,
+                        JointFlags,     // largest component, zero orientation and tracking state
+                        JointColumnCount
+                    };
+
+                    enum BodyColumn
+                    {
+                        TrackingIdLow,
+                        TrackingIdHigh,
+                        BodyFlags,      // tracked and hand states
+                        BodyColumnCount
+                    };
+
+                    enum FrameColumn
+                    {
+                        FrameTime,      // 100ns since the block start
+                        FloorX,
+                        FloorY,
+                        FloorZ,
+                        FloorW,
+                        FrameColumnCount
+                    };
+
+                    static const UINT JOINT_COLUMNS = JointColumnCount * BODY_JOINT_COUNT;
+                    static const UINT BODY_COLUMNS = BodyColumnCount * BODY_COUNT;
+                    static const UINT COLUMN_COUNT = JOINT_COLUMNS + BODY_COLUMNS + FrameColumnCount;
+
+                    static UINT GetJointColumn(JointColumn column, UINT bodyJointIndex) { return column * BODY_JOINT_COUNT + bodyJointIndex; }
+                    static UINT GetBodyColumn(BodyColumn column, UINT bodyIndex) { return JOINT_COLUMNS + column * BODY_COUNT + bodyIndex; }
+                    static UINT GetFrameColumn(FrameColumn column) { return JOINT_COLUMNS + BODY_COLUMNS + column; }
+
+                    struct ColumnHeader
+                    {
+                        INT32   Base;       // first value of the block
+                        UINT    Offset;     // in 32 bit words from the start of _packed
+                        UINT    Bits;       // width of each delta, 0 when the column is constant
+                    };
+
+                    struct BlockHeader
+                    {
+                        INT64   StartTime;
+                        INT64   EndTime;    // time of the last frame
+                        UINT    FirstFrame;
+                        UINT    FrameCount;
+                        std::vector<UINT64> TrackingIds;    // sorted ids seen in the block
+                    };
+
+                    // the unsealed frames are held as a block of raw column values
+                    UINT GetPendingFirstFrame() const { return _frameCount - _pendingCount; }
+
+                    void SealBlock();
+                    void DropBlocks();
+                    void PackColumn(_In_reads_(BODY_STORE_BLOCK_FRAMES) const INT32* pValues, _Out_ ColumnHeader& header);
+
+                    // block holding frameIndex, _blocks.size() for the pending frames
+                    size_t FindBlock(UINT frameIndex) const;
+                    UINT GetBlockFirstFrame(size_t blockIndex) const;
+                    UINT GetBlockFrameCount(size_t blockIndex) const;
+                    INT64 GetBlockStartTime(size_t blockIndex) const;
+
+                    // first frame with RelativeTime >= time
+                    UINT LowerBoundTime(INT64 time) const;
+
+                    // all BODY_STORE_BLOCK_FRAMES values of a column in a block or in the pending frames
+                    void DecodeColumn(size_t blockIndex, UINT column, _Out_writes_(BODY_STORE_BLOCK_FRAMES) INT32* pValues) const;
+
+                    void DecodeFrames(size_t blockIndex, UINT first, UINT count, _Out_writes_(count) BodyFrameData* pFrames) const;
+
+                private:
+                    std::vector<BlockHeader>    _blocks;
+                    std::vector<ColumnHeader>   _columns;   // COLUMN_COUNT per block
+                    std::vector<UINT32>         _packed;
+
+                    UINT                        _firstFrame;
+                    UINT                        _frameCount;
+                    UINT                        _maxFrames;
+
+                    std::vector<INT32>          _pending;   // column major, BODY_STORE_BLOCK_FRAMES values per column
+                    UINT                        _pendingCount;
+                    INT64                       _pendingStartTime;
+                    INT64                       _lastTime;
+                };
+
+            }
+        }
+    }
+}
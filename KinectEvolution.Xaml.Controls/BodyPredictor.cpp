@@ -0,0 +1,374 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyPredictor.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BodyPredictor.h"
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace WindowsPreview::Kinect;
+
+// frame intervals outside this range are from a stall or a duplicate, the history starts over past the largest
+static const float MIN_FRAME_TIME = 1.0f / 120.0f;
+static const float MAX_FRAME_TIME = 0.2f;
+
+// 100ns ticks the clock offset may rise per frame, so it follows drift between the two clocks
+static const INT64 CLOCK_DRIFT_TICKS = 1000;
+
+// half angles below this use the small angle limit of angle / sin
+static const float SMALL_ANGLE = 1e-4f;
+
+inline XMVECTOR LoadLanes(_In_reads_(4) const float* pSource)
+{
+    return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource));
+}
+
+inline void StoreLanes(_Out_writes_(4) float* pDestination, FXMVECTOR value)
+{
+    XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pDestination), value);
+}
+
+inline XMVECTOR LoadMask(_In_reads_(4) const UINT* pSource)
+{
+    return XMLoadInt4(reinterpret_cast<const uint32_t*>(pSource));
+}
+
+inline void StoreMask(_Out_writes_(4) UINT* pDestination, FXMVECTOR value)
+{
+    XMStoreInt4(reinterpret_cast<uint32_t*>(pDestination), value);
+}
+
+inline XMVECTOR LaneLength(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+{
+    return XMVectorSqrt(XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, XMVectorMultiply(z, z))));
+}
+
+// scale that brings a length down to the limit
+inline XMVECTOR LimitScale(FXMVECTOR length, FXMVECTOR limit)
+{
+    return XMVectorSelect(XMVectorSplatOne(), XMVectorDivide(limit, length), XMVectorGreater(length, limit));
+}
+
+BodyPredictor::BodyPredictor()
+{
+    SetParameters(BodyPredictorParameters());
+    Reset();
+}
+
+void BodyPredictor::SetParameters(_In_ const BodyPredictorParameters& parameters)
+{
+    _parameters = parameters;
+    _parameters.HistoryFrames = min(max(parameters.HistoryFrames, 2u), MAX_PREDICTION_HISTORY);
+    _parameters.MaxPrediction = max(parameters.MaxPrediction, 0.0f);
+    _parameters.MaxSpeed = max(parameters.MaxSpeed, 0.0f);
+    _parameters.MaxAngularSpeed = max(parameters.MaxAngularSpeed, 0.0f);
+    _parameters.MaxResidual = max(parameters.MaxResidual, FLT_EPSILON);
+}
+
+void BodyPredictor::Reset()
+{
+    ZeroMemory(_historyTime, sizeof(_historyTime));
+    ZeroMemory(_trackedFrames, sizeof(_trackedFrames));
+    ZeroMemory(_trackingId, sizeof(_trackingId));
+    ZeroMemory(_velocityX, sizeof(_velocityX));
+    ZeroMemory(_velocityY, sizeof(_velocityY));
+    ZeroMemory(_velocityZ, sizeof(_velocityZ));
+    ZeroMemory(_stepX, sizeof(_stepX));
+    ZeroMemory(_stepY, sizeof(_stepY));
+    ZeroMemory(_stepZ, sizeof(_stepZ));
+    ZeroMemory(_angularX, sizeof(_angularX));
+    ZeroMemory(_angularY, sizeof(_angularY));
+    ZeroMemory(_angularZ, sizeof(_angularZ));
+    ZeroMemory(_previousRotation, sizeof(_previousRotation));
+    ZeroMemory(_previousRotationValid, sizeof(_previousRotationValid));
+
+    _historyNext = 0;
+    _historyCount = 0;
+    _clockOffset = 0;
+    _clockValid = FALSE;
+    _frameInterval = 1.0f / 30.0f;
+    _horizon = 0.0f;
+
+    _last.Clear();
+    _predicted.Clear();
+}
+
+void BodyPredictor::AddFrame(_In_ const BodyFrameData& frame, INT64 arrivalTime)
+{
+    // the same frame again
+    if (0 != _historyCount && frame.RelativeTime <= _last.RelativeTime)
+    {
+        return;
+    }
+
+    // the smallest delay seen is taken as the delivery latency, drift lets it creep up again
+    INT64 offset = arrivalTime - frame.RelativeTime;
+    if (!_clockValid || offset < _clockOffset)
+    {
+        _clockOffset = offset;
+        _clockValid = TRUE;
+    }
+    else
+    {
+        _clockOffset += min(offset - _clockOffset, CLOCK_DRIFT_TICKS);
+    }
+
+    float interval = (0 != _historyCount) ? static_cast<float>(frame.RelativeTime - _last.RelativeTime) * 1e-7f : 0.0f;
+    if (interval > MAX_FRAME_TIME)
+    {
+        _historyCount = 0;
+        ZeroMemory(_trackedFrames, sizeof(_trackedFrames));
+    }
+    _frameInterval = (0 != _historyCount) ? max(interval, MIN_FRAME_TIME) : 1.0f / 30.0f;
+
+    // joints count their run of tracked frames, a new person in the slot starts over
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        BOOL sameBody = frame.IsTracked[bodyIndex] && frame.TrackingId[bodyIndex] == _trackingId[bodyIndex];
+        _trackingId[bodyIndex] = frame.IsTracked[bodyIndex] ? frame.TrackingId[bodyIndex] : 0;
+
+        for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+        {
+            UINT i = BodyJointIndex(bodyIndex, jointIndex);
+            if (!frame.IsTracked[bodyIndex] || frame.TrackingState[i] != TrackingState::Tracked)
+            {
+                _trackedFrames[i] = 0;
+            }
+            else
+            {
+                _trackedFrames[i] = sameBody ? min(_trackedFrames[i] + 1, MAX_PREDICTION_HISTORY) : 1;
+            }
+        }
+    }
+
+    _historyTime[_historyNext] = frame.RelativeTime;
+    CopyMemory(_historyX[_historyNext], frame.PositionX, sizeof(frame.PositionX));
+    CopyMemory(_historyY[_historyNext], frame.PositionY, sizeof(frame.PositionY));
+    CopyMemory(_historyZ[_historyNext], frame.PositionZ, sizeof(frame.PositionZ));
+    _historyNext = (_historyNext + 1) % MAX_PREDICTION_HISTORY;
+    _historyCount = min(_historyCount + 1, MAX_PREDICTION_HISTORY);
+
+    _last = frame;
+
+    FitVelocities();
+}
+
+void BodyPredictor::FitVelocities()
+{
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR one = XMVectorSplatOne();
+
+    // the fit covers the frames every lane in it was tracked for, shorter runs stay put
+    UINT frameCount = min(_parameters.HistoryFrames, _historyCount);
+    UINT slots[MAX_PREDICTION_HISTORY];
+    float times[MAX_PREDICTION_HISTORY];
+    float meanTime = 0.0f;
+    for (UINT k = 0; k < frameCount; ++k)
+    {
+        slots[k] = (_historyNext + MAX_PREDICTION_HISTORY - 1 - k) % MAX_PREDICTION_HISTORY;
+        times[k] = static_cast<float>(_historyTime[slots[k]] - _historyTime[slots[0]]) * 1e-7f;
+        meanTime += times[k];
+    }
+    meanTime /= max(frameCount, 1u);
+
+    // least squares slope as a weighted sum of the samples, the weights sum to zero
+    XMVECTOR weights[MAX_PREDICTION_HISTORY];
+    XMVECTOR centered[MAX_PREDICTION_HISTORY];
+    float spread = 0.0f;
+    for (UINT k = 0; k < frameCount; ++k)
+    {
+        spread += (times[k] - meanTime) * (times[k] - meanTime);
+    }
+    for (UINT k = 0; k < frameCount; ++k)
+    {
+        centered[k] = XMVectorReplicate(times[k] - meanTime);
+        weights[k] = XMVectorReplicate((spread > 0.0f) ? (times[k] - meanTime) / spread : 0.0f);
+    }
+
+    const XMVECTOR fitFrames = XMVectorReplicate(static_cast<float>(frameCount));
+    const XMVECTOR stepFrames = XMVectorReplicate(2.0f);
+    const XMVECTOR canFit = (frameCount >= 2) ? XMVectorTrueInt() : XMVectorFalseInt();
+    const XMVECTOR invCount = XMVectorReplicate(1.0f / max(frameCount, 1u));
+    const XMVECTOR invInterval = XMVectorReplicate(1.0f / _frameInterval);
+    const XMVECTOR invMaxResidual = XMVectorReplicate(1.0f / _parameters.MaxResidual);
+    const XMVECTOR maxSpeed = XMVectorReplicate(_parameters.MaxSpeed);
+    const XMVECTOR maxAngularSpeed = XMVectorReplicate(_parameters.MaxAngularSpeed);
+    const XMVECTOR two = XMVectorReplicate(2.0f);
+    const XMVECTOR smallAngle = XMVectorReplicate(SMALL_ANGLE);
+
+    for (UINT i = 0; i < BODY_JOINT_STRIDE; i += 4)
+    {
+        XMVECTOR tracked = XMConvertVectorUIntToFloat(LoadMask(&_trackedFrames[i]), 0);
+        XMVECTOR fitValid = XMVectorAndInt(XMVectorGreaterOrEqual(tracked, fitFrames), canFit);
+        XMVECTOR stepValid = XMVectorGreaterOrEqual(tracked, stepFrames);
+
+        XMVECTOR velocityX = zero, velocityY = zero, velocityZ = zero;
+        XMVECTOR meanX = zero, meanY = zero, meanZ = zero;
+        for (UINT k = 0; k < frameCount; ++k)
+        {
+            XMVECTOR x = LoadLanes(&_historyX[slots[k]][i]);
+            XMVECTOR y = LoadLanes(&_historyY[slots[k]][i]);
+            XMVECTOR z = LoadLanes(&_historyZ[slots[k]][i]);
+            velocityX = XMVectorMultiplyAdd(weights[k], x, velocityX);
+            velocityY = XMVectorMultiplyAdd(weights[k], y, velocityY);
+            velocityZ = XMVectorMultiplyAdd(weights[k], z, velocityZ);
+            meanX += x;
+            meanY += y;
+            meanZ += z;
+        }
+        meanX *= invCount;
+        meanY *= invCount;
+        meanZ *= invCount;
+
+        // rms distance of the samples from the fitted line
+        XMVECTOR residual = zero;
+        for (UINT k = 0; k < frameCount; ++k)
+        {
+            XMVECTOR dx = LoadLanes(&_historyX[slots[k]][i]) - XMVectorMultiplyAdd(velocityX, centered[k], meanX);
+            XMVECTOR dy = LoadLanes(&_historyY[slots[k]][i]) - XMVectorMultiplyAdd(velocityY, centered[k], meanY);
+            XMVECTOR dz = LoadLanes(&_historyZ[slots[k]][i]) - XMVectorMultiplyAdd(velocityZ, centered[k], meanZ);
+            residual = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiplyAdd(dz, dz, residual)));
+        }
+        residual = XMVectorSqrt(residual * invCount);
+
+        // erratic joints fade to the last position, fast ones are held to the speed limit
+        XMVECTOR confidence = XMVectorSaturate(one - residual * invMaxResidual);
+        XMVECTOR scale = confidence * LimitScale(LaneLength(velocityX, velocityY, velocityZ), maxSpeed);
+        scale = XMVectorSelect(zero, scale, fitValid);
+
+        StoreLanes(&_velocityX[i], velocityX * scale);
+        StoreLanes(&_velocityY[i], velocityY * scale);
+        StoreLanes(&_velocityZ[i], velocityZ * scale);
+
+        // renders behind the last frame interpolate between the last two
+        XMVECTOR stepX = zero, stepY = zero, stepZ = zero;
+        if (frameCount >= 2)
+        {
+            stepX = (LoadLanes(&_historyX[slots[0]][i]) - LoadLanes(&_historyX[slots[1]][i])) * invInterval;
+            stepY = (LoadLanes(&_historyY[slots[0]][i]) - LoadLanes(&_historyY[slots[1]][i])) * invInterval;
+            stepZ = (LoadLanes(&_historyZ[slots[0]][i]) - LoadLanes(&_historyZ[slots[1]][i])) * invInterval;
+        }
+        StoreLanes(&_stepX[i], XMVectorSelect(zero, stepX, stepValid));
+        StoreLanes(&_stepY[i], XMVectorSelect(zero, stepY, stepValid));
+        StoreLanes(&_stepZ[i], XMVectorSelect(zero, stepZ, stepValid));
+
+        // angular velocity from the rotation between the last two orientations
+        XMVECTOR inputX = LoadLanes(&_last.OrientationX[i]);
+        XMVECTOR inputY = LoadLanes(&_last.OrientationY[i]);
+        XMVECTOR inputZ = LoadLanes(&_last.OrientationZ[i]);
+        XMVECTOR inputW = LoadLanes(&_last.OrientationW[i]);
+        XMVECTOR lengthSq = XMVectorMultiplyAdd(inputX, inputX, XMVectorMultiplyAdd(inputY, inputY, XMVectorMultiplyAdd(inputZ, inputZ, XMVectorMultiply(inputW, inputW))));
+        XMVECTOR present = XMVectorGreater(lengthSq, zero);
+        XMVECTOR invLength = XMVectorSelect(zero, XMVectorReciprocalSqrt(lengthSq), present);
+        XMVECTOR ax = inputX * invLength;
+        XMVECTOR ay = inputY * invLength;
+        XMVECTOR az = inputZ * invLength;
+        XMVECTOR aw = inputW * invLength;
+
+        // conjugate of the previous orientation
+        XMVECTOR bx = XMVectorNegate(LoadLanes(&_previousRotation[0][i]));
+        XMVECTOR by = XMVectorNegate(LoadLanes(&_previousRotation[1][i]));
+        XMVECTOR bz = XMVectorNegate(LoadLanes(&_previousRotation[2][i]));
+        XMVECTOR bw = LoadLanes(&_previousRotation[3][i]);
+
+        XMVECTOR deltaW = aw * bw - ax * bx - ay * by - az * bz;
+        XMVECTOR deltaX = aw * bx + ax * bw + ay * bz - az * by;
+        XMVECTOR deltaY = aw * by - ax * bz + ay * bw + az * bx;
+        XMVECTOR deltaZ = aw * bz + ax * by - ay * bx + az * bw;
+
+        // the shorter way round
+        XMVECTOR flip = XMVectorLess(deltaW, zero);
+        deltaW = XMVectorAbs(deltaW);
+        deltaX = XMVectorSelect(deltaX, XMVectorNegate(deltaX), flip);
+        deltaY = XMVectorSelect(deltaY, XMVectorNegate(deltaY), flip);
+        deltaZ = XMVectorSelect(deltaZ, XMVectorNegate(deltaZ), flip);
+
+        XMVECTOR sinHalf = LaneLength(deltaX, deltaY, deltaZ);
+        XMVECTOR halfAngle = XMVectorATan2(sinHalf, deltaW);
+        XMVECTOR ratio = XMVectorSelect(two, two * halfAngle / sinHalf, XMVectorGreater(sinHalf, smallAngle));
+        ratio *= invInterval;
+
+        XMVECTOR angularX = deltaX * ratio;
+        XMVECTOR angularY = deltaY * ratio;
+        XMVECTOR angularZ = deltaZ * ratio;
+        XMVECTOR angularScale = LimitScale(LaneLength(angularX, angularY, angularZ), maxAngularSpeed);
+
+        XMVECTOR rotationValid = XMVectorAndInt(XMVectorAndInt(present, LoadMask(&_previousRotationValid[i])), stepValid);
+        angularScale = XMVectorSelect(zero, angularScale, rotationValid);
+
+        StoreLanes(&_angularX[i], angularX * angularScale);
+        StoreLanes(&_angularY[i], angularY * angularScale);
+        StoreLanes(&_angularZ[i], angularZ * angularScale);
+
+        StoreLanes(&_previousRotation[0][i], ax);
+        StoreLanes(&_previousRotation[1][i], ay);
+        StoreLanes(&_previousRotation[2][i], az);
+        StoreLanes(&_previousRotation[3][i], aw);
+        StoreMask(&_previousRotationValid[i], present);
+    }
+}
+
+void BodyPredictor::Predict(INT64 renderTime)
+{
+    INT64 latency = static_cast<INT64>(_parameters.LatencyCompensation * 1e7f);
+    PredictSensorTime(renderTime - _clockOffset + latency);
+}
+
+void BodyPredictor::PredictSensorTime(INT64 sensorTime)
+{
+    _predicted = _last;
+
+    if (0 == _historyCount)
+    {
+        _horizon = 0.0f;
+        return;
+    }
+
+    // back to the previous frame at most, ahead no further than allowed
+    float horizon = static_cast<float>(sensorTime - _last.RelativeTime) * 1e-7f;
+    horizon = min(max(horizon, -_frameInterval), _parameters.MaxPrediction);
+    _horizon = horizon;
+
+    const float* pVelocityX = (horizon < 0.0f) ? _stepX : _velocityX;
+    const float* pVelocityY = (horizon < 0.0f) ? _stepY : _velocityY;
+    const float* pVelocityZ = (horizon < 0.0f) ? _stepZ : _velocityZ;
+
+    const XMVECTOR h = XMVectorReplicate(horizon);
+    const XMVECTOR half = XMVectorReplicate(0.5f);
+    const XMVECTOR smallAngle = XMVectorReplicate(SMALL_ANGLE);
+
+    for (UINT i = 0; i < BODY_JOINT_STRIDE; i += 4)
+    {
+        StoreLanes(&_predicted.PositionX[i], XMVectorMultiplyAdd(LoadLanes(&pVelocityX[i]), h, LoadLanes(&_last.PositionX[i])));
+        StoreLanes(&_predicted.PositionY[i], XMVectorMultiplyAdd(LoadLanes(&pVelocityY[i]), h, LoadLanes(&_last.PositionY[i])));
+        StoreLanes(&_predicted.PositionZ[i], XMVectorMultiplyAdd(LoadLanes(&pVelocityZ[i]), h, LoadLanes(&_last.PositionZ[i])));
+
+        // rotation by the angular velocity over the horizon, applied after the last orientation
+        XMVECTOR rx = LoadLanes(&_angularX[i]) * h;
+        XMVECTOR ry = LoadLanes(&_angularY[i]) * h;
+        XMVECTOR rz = LoadLanes(&_angularZ[i]) * h;
+        XMVECTOR halfAngle = LaneLength(rx, ry, rz) * half;
+
+        XMVECTOR sinHalf, cosHalf;
+        XMVectorSinCos(&sinHalf, &cosHalf, halfAngle);
+        XMVECTOR axisScale = XMVectorSelect(half, sinHalf * half / halfAngle, XMVectorGreater(halfAngle, smallAngle));
+
+        XMVECTOR ax = rx * axisScale;
+        XMVECTOR ay = ry * axisScale;
+        XMVECTOR az = rz * axisScale;
+        XMVECTOR aw = cosHalf;
+
+        XMVECTOR bx = LoadLanes(&_last.OrientationX[i]);
+        XMVECTOR by = LoadLanes(&_last.OrientationY[i]);
+        XMVECTOR bz = LoadLanes(&_last.OrientationZ[i]);
+        XMVECTOR bw = LoadLanes(&_last.OrientationW[i]);
+
+        StoreLanes(&_predicted.OrientationX[i], aw * bx + ax * bw + ay * bz - az * by);
+        StoreLanes(&_predicted.OrientationY[i], aw * by - ax * bz + ay * bw + az * bx);
+        StoreLanes(&_predicted.OrientationZ[i], aw * bz + ax * by - ay * bx + az * bw);
+        StoreLanes(&_predicted.OrientationW[i], aw * bw - ax * bx - ay * by - az * bz);
+    }
+}
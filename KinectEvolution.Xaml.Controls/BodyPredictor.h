@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyPredictor.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                // most frames the velocity is fitted over
+                static const UINT MAX_PREDICTION_HISTORY = 8;
+
+                struct BodyPredictorParameters
+                {
+                    UINT    HistoryFrames;          // [2..MAX_PREDICTION_HISTORY], frames in the velocity fit
+                    float   LatencyCompensation;    // seconds predicted past the render time, negative renders behind
+                    float   MaxPrediction;          // seconds ahead of the last frame at most
+                    float   MaxSpeed;               // meters per second, faster fits are clamped
+                    float   MaxAngularSpeed;        // radians per second
+                    float   MaxResidual;            // meters rms, the fit's velocity fades out towards it
+
+                    BodyPredictorParameters()
+                        : HistoryFrames(4)
+                        , LatencyCompensation(1.0f / 30.0f)
+                        , MaxPrediction(0.1f)
+                        , MaxSpeed(5.0f)
+                        , MaxAngularSpeed(4.0f * XM_PI)
+                        , MaxResidual(0.02f)
+                    {
+                    }
+                };
+
+                // replay of a recording at a display rate, errors are against the recording at the predicted time
+                // predicts the joints of all bodies at a render time from the last few body frames, 4 joints per
+                // vector operation. positions move along a least squares velocity and orientations along the angular
+                // velocity of the last two frames; joints that are inferred, newly tracked or fit badly stay put.
+                class BodyPredictor
+                {
+                public:
+                    BodyPredictor();
+
+                    void SetParameters(_In_ const BodyPredictorParameters& parameters);
+                    const BodyPredictorParameters& GetParameters() const { return _parameters; }
+
+                    void Reset();
+
+                    // arrivalTime is the local clock in 100ns units, it is matched to the sensor clock of the frame
+                    void AddFrame(_In_ const BodyFrameData& frame, INT64 arrivalTime);
+
+                    // predicts the frame shown at renderTime on the local clock into GetPredicted()
+                    void Predict(INT64 renderTime);
+
+                    // the same at a time on the sensor clock
+                    void PredictSensorTime(INT64 sensorTime);
+
+                    const BodyFrameData& GetPredicted() const { return _predicted; }
+
+                    // seconds the last prediction went past the last frame
+                    float GetHorizon() const { return _horizon; }
+
+                private:
+                    void FitVelocities();
+
+                private:
+                    BodyPredictorParameters _parameters;
+
+                    // ring of the last frames' positions, _historyTime in seconds relative to the newest frame
+                    float   _historyX[MAX_PREDICTION_HISTORY][BODY_JOINT_STRIDE];
+                    float   _historyY[MAX_PREDICTION_HISTORY][BODY_JOINT_STRIDE];
+                    float   _historyZ[MAX_PREDICTION_HISTORY][BODY_JOINT_STRIDE];
+                    INT64   _historyTime[MAX_PREDICTION_HISTORY];
+                    UINT    _historyNext;
+                    UINT    _historyCount;
+
+                    // consecutive frames each joint was tracked by the same body
+                    UINT    _trackedFrames[BODY_JOINT_STRIDE];
+                    UINT64  _trackingId[BODY_COUNT];
+
+                    // velocities of the newest frame, the interpolation velocity spans the last two frames
+                    float   _velocityX[BODY_JOINT_STRIDE];
+                    float   _velocityY[BODY_JOINT_STRIDE];
+                    float   _velocityZ[BODY_JOINT_STRIDE];
+                    float   _stepX[BODY_JOINT_STRIDE];
+                    float   _stepY[BODY_JOINT_STRIDE];
+                    float   _stepZ[BODY_JOINT_STRIDE];
+                    float   _angularX[BODY_JOINT_STRIDE];
+                    float   _angularY[BODY_JOINT_STRIDE];
+                    float   _angularZ[BODY_JOINT_STRIDE];
+
+                    float   _previousRotation[4][BODY_JOINT_STRIDE];
+                    UINT    _previousRotationValid[BODY_JOINT_STRIDE];
+
+                    // local minus sensor clock, the smallest delivery delay seen
+                    INT64   _clockOffset;
+                    BOOL    _clockValid;
+
+                    float   _frameInterval;
+                    float   _horizon;
+
+                    BodyFrameData   _last;
+                    BodyFrameData   _predicted;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,384 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyTracker.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "BodyTracker.h"
+
+#include <cfloat>
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace WindowsPreview::Kinect;
+
+// bones both signatures must share before the bone lengths count
+static const UINT MIN_SIGNATURE_BONES = 6;
+
+// halving the running sums past this many samples lets the mean follow slow changes
+static const UINT MAX_BONE_SAMPLES = 256;
+
+// assignment cost of pairs that must not be matched, finite so the Hungarian method stays exact
+static const float FORBIDDEN_COST = 1.0e6f;
+
+// joint the distance of a lost body is measured at
+static const JointType ANCHOR_JOINT = JointType::SpineMid;
+
+inline bool IsBoneTracked(_In_ const BodyFrameData& frame, UINT bodyIndex, UINT boneIndex)
+{
+    return TrackingState::Tracked == frame.GetTrackingState(bodyIndex, static_cast<UINT>(BodyBones[boneIndex].JointA)) &&
+        TrackingState::Tracked == frame.GetTrackingState(bodyIndex, static_cast<UINT>(BodyBones[boneIndex].JointB));
+}
+
+inline float GetBoneLength(_In_ const BodyFrameData& frame, UINT bodyIndex, UINT boneIndex)
+{
+    XMVECTOR a = frame.GetPosition(bodyIndex, static_cast<UINT>(BodyBones[boneIndex].JointA));
+    XMVECTOR b = frame.GetPosition(bodyIndex, static_cast<UINT>(BodyBones[boneIndex].JointB));
+
+    return XMVectorGetX(XMVector3Length(b - a));
+}
+
+// minimum cost perfect matching of a square matrix, pAssignment[row] receives the column
+static void SolveAssignment(const float cost[BODY_COUNT][BODY_COUNT], UINT size, _Out_writes_(size) UINT* pAssignment)
+{
+    // potentials and augmenting paths over 1 based rows and columns, column 0 is the free root
+    float u[BODY_COUNT + 1] = { 0.0f };
+    float v[BODY_COUNT + 1] = { 0.0f };
+    UINT match[BODY_COUNT + 1] = { 0 };
+    UINT way[BODY_COUNT + 1] = { 0 };
+
+    for (UINT row = 1; row <= size; ++row)
+    {
+        float minimum[BODY_COUNT + 1];
+        BOOL used[BODY_COUNT + 1];
+        for (UINT column = 0; column <= size; ++column)
+        {
+            minimum[column] = FLT_MAX;
+            used[column] = FALSE;
+        }
+
+        match[0] = row;
+        UINT column0 = 0;
+
+        do
+        {
+            used[column0] = TRUE;
+
+            UINT row0 = match[column0];
+            UINT column1 = 0;
+            float delta = FLT_MAX;
+
+            for (UINT column = 1; column <= size; ++column)
+            {
+                if (used[column])
+                {
+                    continue;
+                }
+
+                float reduced = cost[row0 - 1][column - 1] - u[row0] - v[column];
+                if (reduced < minimum[column])
+                {
+                    minimum[column] = reduced;
+                    way[column] = column0;
+                }
+
+                if (minimum[column] < delta)
+                {
+                    delta = minimum[column];
+                    column1 = column;
+                }
+            }
+
+            for (UINT column = 0; column <= size; ++column)
+            {
+                if (used[column])
+                {
+                    u[match[column]] += delta;
+                    v[column] -= delta;
+                }
+                else
+                {
+                    minimum[column] -= delta;
+                }
+            }
+
+            column0 = column1;
+        } while (0 != match[column0]);
+
+        // flip the augmenting path
+        do
+        {
+            UINT column1 = way[column0];
+            match[column0] = match[column1];
+            column0 = column1;
+        } while (0 != column0);
+    }
+
+    for (UINT column = 1; column <= size; ++column)
+    {
+        pAssignment[match[column] - 1] = column - 1;
+    }
+}
+
+BodyTracker::BodyTracker()
+{
+    Reset();
+}
+
+void BodyTracker::Reset()
+{
+    ZeroMemory(_tracks, sizeof(_tracks));
+    ZeroMemory(&_statistics, sizeof(_statistics));
+
+    for (UINT trackIndex = 0; trackIndex < BODY_COUNT; ++trackIndex)
+    {
+        _tracks[trackIndex].State = BodyTrackState::Free;
+    }
+
+    _tracked.Clear();
+}
+
+void BodyTracker::StartTrack(UINT trackIndex, _In_ const BodyFrameData& frame, UINT sensorIndex)
+{
+    BodyTrack& track = _tracks[trackIndex];
+
+    ZeroMemory(&track, sizeof(track));
+    track.Id = frame.TrackingId[sensorIndex];
+
+    ++_statistics.NewTracks;
+
+    UpdateTrack(trackIndex, frame, sensorIndex);
+}
+
+void BodyTracker::UpdateTrack(UINT trackIndex, _In_ const BodyFrameData& frame, UINT sensorIndex)
+{
+    BodyTrack& track = _tracks[trackIndex];
+
+    track.State = BodyTrackState::Active;
+    track.SensorId = frame.TrackingId[sensorIndex];
+    track.SensorIndex = sensorIndex;
+    track.LastSeenTime = frame.RelativeTime;
+    XMStoreFloat3(&track.LastPosition, frame.GetPosition(sensorIndex, static_cast<UINT>(ANCHOR_JOINT)));
+
+    for (UINT boneIndex = 0; boneIndex < BONE_COUNT; ++boneIndex)
+    {
+        if (!IsBoneTracked(frame, sensorIndex, boneIndex))
+        {
+            continue;
+        }
+
+        if (track.BoneLengthCount[boneIndex] >= MAX_BONE_SAMPLES)
+        {
+            track.BoneLengthSum[boneIndex] *= 0.5f;
+            track.BoneLengthCount[boneIndex] /= 2;
+        }
+
+        track.BoneLengthSum[boneIndex] += GetBoneLength(frame, sensorIndex, boneIndex);
+        ++track.BoneLengthCount[boneIndex];
+    }
+}
+
+float BodyTracker::GetMatchCost(UINT trackIndex, _In_ const BodyFrameData& frame, UINT sensorIndex) const
+{
+    const BodyTrack& track = _tracks[trackIndex];
+
+    // how far the body may have walked while it was out of sight
+    float lostTime = static_cast<float>(frame.RelativeTime - track.LastSeenTime) * 1e-7f;
+    float maxDistance = _parameters.MaxDistance + _parameters.MaxSpeed * max(lostTime, 0.0f);
+
+    XMVECTOR lastPosition = XMLoadFloat3(&track.LastPosition);
+    float distance = XMVectorGetX(XMVector3Length(frame.GetPosition(sensorIndex, static_cast<UINT>(ANCHOR_JOINT)) - lastPosition));
+    if (distance > maxDistance)
+    {
+        return FLT_MAX;
+    }
+
+    float cost = (distance * distance) / (maxDistance * maxDistance);
+
+    // rms bone length difference over the bones known to both
+    float errorSum = 0.0f;
+    UINT bones = 0;
+    for (UINT boneIndex = 0; boneIndex < BONE_COUNT; ++boneIndex)
+    {
+        if (0 == track.BoneLengthCount[boneIndex] || !IsBoneTracked(frame, sensorIndex, boneIndex))
+        {
+            continue;
+        }
+
+        float error = GetBoneLength(frame, sensorIndex, boneIndex) - track.BoneLengthSum[boneIndex] / static_cast<float>(track.BoneLengthCount[boneIndex]);
+        errorSum += error * error;
+        ++bones;
+    }
+
+    // too few shared bones to tell people apart, only the distance counts and an unknown signature costs the limit
+    if (bones < MIN_SIGNATURE_BONES)
+    {
+        return cost + 1.0f;
+    }
+
+    float error = sqrtf(errorSum / static_cast<float>(bones));
+    if (error > _parameters.MaxBoneLengthError)
+    {
+        return FLT_MAX;
+    }
+
+    return cost + (error * error) / (_parameters.MaxBoneLengthError * _parameters.MaxBoneLengthError);
+}
+
+void BodyTracker::Reidentify(_In_ const BodyFrameData& frame, _Inout_updates_(BODY_COUNT) BOOL* pSensorUsed)
+{
+    UINT sensorBodies[BODY_COUNT];
+    UINT sensorCount = 0;
+    for (UINT sensorIndex = 0; sensorIndex < BODY_COUNT; ++sensorIndex)
+    {
+        if (frame.IsTracked[sensorIndex] && !pSensorUsed[sensorIndex])
+        {
+            sensorBodies[sensorCount++] = sensorIndex;
+        }
+    }
+
+    UINT lostTracks[BODY_COUNT];
+    UINT lostCount = 0;
+    for (UINT trackIndex = 0; trackIndex < BODY_COUNT; ++trackIndex)
+    {
+        if (BodyTrackState::Lost == _tracks[trackIndex].State)
+        {
+            lostTracks[lostCount++] = trackIndex;
+        }
+    }
+
+    if (0 == sensorCount || 0 == lostCount)
+    {
+        return;
+    }
+
+    // rows are new sensor bodies and columns lost tracks, padded to a square with forbidden pairs
+    UINT size = max(sensorCount, lostCount);
+    float cost[BODY_COUNT][BODY_COUNT];
+
+    for (UINT row = 0; row < size; ++row)
+    {
+        for (UINT column = 0; column < size; ++column)
+        {
+            float value = FORBIDDEN_COST;
+            if (row < sensorCount && column < lostCount)
+            {
+                value = min(GetMatchCost(lostTracks[column], frame, sensorBodies[row]), FORBIDDEN_COST);
+            }
+
+            cost[row][column] = value;
+        }
+    }
+
+    UINT assignment[BODY_COUNT];
+    SolveAssignment(cost, size, assignment);
+
+    for (UINT row = 0; row < sensorCount; ++row)
+    {
+        UINT column = assignment[row];
+        if (column >= lostCount || cost[row][column] >= FORBIDDEN_COST)
+        {
+            continue;
+        }
+
+        UpdateTrack(lostTracks[column], frame, sensorBodies[row]);
+        pSensorUsed[sensorBodies[row]] = TRUE;
+
+        ++_statistics.Reidentified;
+    }
+}
+
+void BodyTracker::Update(_In_ const BodyFrameData& frame)
+{
+    BOOL sensorUsed[BODY_COUNT] = { FALSE };
+
+    // tracks whose sensor body is still there
+    for (UINT trackIndex = 0; trackIndex < BODY_COUNT; ++trackIndex)
+    {
+        BodyTrack& track = _tracks[trackIndex];
+        if (BodyTrackState::Active != track.State)
+        {
+            continue;
+        }
+
+        track.State = BodyTrackState::Lost;
+
+        for (UINT sensorIndex = 0; sensorIndex < BODY_COUNT; ++sensorIndex)
+        {
+            if (frame.IsTracked[sensorIndex] && !sensorUsed[sensorIndex] && frame.TrackingId[sensorIndex] == track.SensorId)
+            {
+                UpdateTrack(trackIndex, frame, sensorIndex);
+                sensorUsed[sensorIndex] = TRUE;
+                break;
+            }
+        }
+    }
+
+    // lost tracks past the grace period give up their slot
+    INT64 gracePeriod = static_cast<INT64>(_parameters.GracePeriod * 1e7f);
+    for (UINT trackIndex = 0; trackIndex < BODY_COUNT; ++trackIndex)
+    {
+        BodyTrack& track = _tracks[trackIndex];
+        if (BodyTrackState::Lost == track.State && frame.RelativeTime - track.LastSeenTime > gracePeriod)
+        {
+            track.State = BodyTrackState::Free;
+            ++_statistics.Expired;
+        }
+    }
+
+    Reidentify(frame, sensorUsed);
+
+    // the remaining sensor bodies are new people, taking a free slot or else the longest lost one
+    for (UINT sensorIndex = 0; sensorIndex < BODY_COUNT; ++sensorIndex)
+    {
+        if (!frame.IsTracked[sensorIndex] || sensorUsed[sensorIndex])
+        {
+            continue;
+        }
+
+        UINT slot = BODY_COUNT;
+        for (UINT trackIndex = 0; trackIndex < BODY_COUNT; ++trackIndex)
+        {
+            const BodyTrack& track = _tracks[trackIndex];
+            if (BodyTrackState::Free == track.State)
+            {
+                slot = trackIndex;
+                break;
+            }
+
+            if (BodyTrackState::Lost == track.State && (BODY_COUNT == slot || track.LastSeenTime < _tracks[slot].LastSeenTime))
+            {
+                slot = trackIndex;
+            }
+        }
+
+        if (BODY_COUNT == slot)
+        {
+            continue;
+        }
+
+        StartTrack(slot, frame, sensorIndex);
+        sensorUsed[sensorIndex] = TRUE;
+    }
+
+    _tracked.RelativeTime = frame.RelativeTime;
+    _tracked.FloorClipPlane = frame.FloorClipPlane;
+
+    for (UINT trackIndex = 0; trackIndex < BODY_COUNT; ++trackIndex)
+    {
+        const BodyTrack& track = _tracks[trackIndex];
+
+        _tracked.ClearBody(trackIndex);
+
+        if (BodyTrackState::Active == track.State)
+        {
+            _tracked.CopyBody(trackIndex, frame, track.SensorIndex);
+        }
+
+        if (BodyTrackState::Free != track.State)
+        {
+            _tracked.TrackingId[trackIndex] = track.Id;
+        }
+    }
+}
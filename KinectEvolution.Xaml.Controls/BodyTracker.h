@@ -0,0 +1,105 @@
+//------------------------------------------------------------------------------
+// <copyright file="BodyTracker.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                struct BodyTrackerParameters
+                {
+                    float   GracePeriod;            // seconds a lost body keeps its slot and filter state
+                    float   MaxBoneLengthError;     // meters, rms bone length difference of the same person
+                    float   MaxDistance;            // meters a body may move while lost, at once
+                    float   MaxSpeed;               // meters per second added to MaxDistance while lost
+
+                    BodyTrackerParameters()
+                        : GracePeriod(2.0f)
+                        , MaxBoneLengthError(0.03f)
+                        , MaxDistance(0.3f)
+                        , MaxSpeed(1.0f)
+                    {
+                    }
+                };
+
+                struct BodyTrackerStatistics
+                {
+                    UINT    NewTracks;
+                    UINT    Reidentified;   // lost tracks taken over by a new sensor body
+                    UINT    Expired;        // lost tracks that ran out of grace
+                };
+
+                enum class BodyTrackState
+                {
+                    Free,
+                    Active,
+                    Lost,
+                };
+
+                // keeps a person in the same output slot under the same tracking id while the sensor
+                // drops and re-acquires them. a lost track waits out the grace period; new sensor bodies are
+                // assigned to lost tracks by the Hungarian method on bone lengths and distance from where the
+                // track was lost. lost tracks stay in the output untracked with their id, so JointFilter holds them.
+                class BodyTracker
+                {
+                public:
+                    BodyTracker();
+
+                    void SetParameters(_In_ const BodyTrackerParameters& parameters) { _parameters = parameters; }
+                    const BodyTrackerParameters& GetParameters() const { return _parameters; }
+
+                    void Reset();
+
+                    void Update(_In_ const BodyFrameData& frame);
+
+                    // bodies by track slot, tracking ids are those of the first sensor body of each track
+                    const BodyFrameData& GetTracked() const { return _tracked; }
+
+                    BodyTrackState GetTrackState(UINT trackIndex) const { return _tracks[trackIndex].State; }
+
+                    // sensor slot a track was last seen in
+                    UINT GetSensorIndex(UINT trackIndex) const { return _tracks[trackIndex].SensorIndex; }
+
+                    const BodyTrackerStatistics& GetStatistics() const { return _statistics; }
+
+                private:
+                    struct BodyTrack
+                    {
+                        BodyTrackState  State;
+                        UINT64          Id;
+                        UINT64          SensorId;
+                        UINT            SensorIndex;
+                        INT64           LastSeenTime;
+                        XMFLOAT3        LastPosition;
+
+                        // running mean of the bone lengths measured with both ends tracked
+                        float           BoneLengthSum[BONE_COUNT];
+                        UINT            BoneLengthCount[BONE_COUNT];
+                    };
+
+                    void StartTrack(UINT trackIndex, _In_ const BodyFrameData& frame, UINT sensorIndex);
+                    void UpdateTrack(UINT trackIndex, _In_ const BodyFrameData& frame, UINT sensorIndex);
+
+                    // cost of giving a sensor body to a lost track, FLT_MAX when it cannot be the same person
+                    float GetMatchCost(UINT trackIndex, _In_ const BodyFrameData& frame, UINT sensorIndex) const;
+
+                    void Reidentify(_In_ const BodyFrameData& frame, _Inout_updates_(BODY_COUNT) BOOL* pSensorUsed);
+
+                private:
+                    BodyTrackerParameters   _parameters;
+                    BodyTrack               _tracks[BODY_COUNT];
+                    BodyFrameData           _tracked;
+                    BodyTrackerStatistics   _statistics;
+                };
+
+            }
+        }
+    }
+}
@@ -22,6 +22,7 @@ using namespace WindowsPreview::Kinect;
 
 ColorPanel::ColorPanel()
     : Panel()
+    , _overlay(Skeleton::Body2DMode::Color)
 {
     critical_section::scoped_lock lock(_criticalSection);
 
@@ -69,6 +70,44 @@ ColorFrameSource^ ColorPanel::ColorSource::get()
     return _frameSource;
 }
 
+void ColorPanel::BodySource::set(BodyFrameSource^ value)
+{
+    critical_section::scoped_lock lock(_criticalSection);
+
+    if (_overlay.GetBodySource() == value)
+    {
+        return;
+    }
+
+    _overlay.SetBodySource(value);
+
+    NotifyPropertyChanged("BodySource");
+}
+
+BodyFrameSource^ ColorPanel::BodySource::get()
+{
+    return _overlay.GetBodySource();
+}
+
+void ColorPanel::CoordinateMapper::set(WRK::CoordinateMapper^ value)
+{
+    critical_section::scoped_lock lock(_criticalSection);
+
+    if (_overlay.GetCoordinateMapper() == value)
+    {
+        return;
+    }
+
+    _overlay.SetCoordinateMapper(value);
+
+    NotifyPropertyChanged("CoordinateMapper");
+}
+
+WRK::CoordinateMapper^ ColorPanel::CoordinateMapper::get()
+{
+    return _overlay.GetCoordinateMapper();
+}
+
 void ColorPanel::NotifyPropertyChanged(Platform::String^ prop)
 {
     PropertyChangedEventArgs^ args = ref new PropertyChangedEventArgs(prop);
@@ -85,6 +124,8 @@ void ColorPanel::Update(double elapsedTime)
             OnColorFrame(frame);
         }
     }
+
+    _overlay.Update();
 }
 
 void ColorPanel::Render()
@@ -107,6 +148,8 @@ void ColorPanel::Render()
         RenderTexture(_colorFrame);
     }
 
+    _overlay.Render(_d2dContext.Get(), _width, _height);
+
     EndRender();
 }
 
@@ -135,6 +178,8 @@ void ColorPanel::ResetDeviceResources()
 {
     Panel::ResetDeviceResources();
 
+    _overlay.ResetDeviceResources();
+
     _colorFrame = nullptr;
 }
 
@@ -150,6 +195,8 @@ void ColorPanel::CreateDeviceResources()
         DXGI_FORMAT_G8R8_G8B8_UNORM,
         FALSE);
 
+    _overlay.CreateDeviceResources(_d2dContext.Get());
+
     Render(); // render one frame to force resize
 }
 
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "Panel.h"
+#include "SkeletonOverlay.h"
 
 namespace KinectEvolution {
     namespace Xaml {
@@ -28,6 +29,20 @@ namespace KinectEvolution {
                         void set(WRK::ColorFrameSource^ value);
                     }
 
+                    // bodies drawn over the image
+                    property WRK::BodyFrameSource^ BodySource
+                    {
+                        WRK::BodyFrameSource^ get();
+                        void set(WRK::BodyFrameSource^ value);
+                    }
+
+                    // places the bodies on the image, without one they are placed with a typical sensor's camera
+                    property WRK::CoordinateMapper^ CoordinateMapper
+                    {
+                        WRK::CoordinateMapper^ get();
+                        void set(WRK::CoordinateMapper^ value);
+                    }
+
                 protected private:
                     virtual event Windows::UI::Xaml::Data::PropertyChangedEventHandler^ PropertyChanged;
                     void NotifyPropertyChanged(Platform::String^ prop);
@@ -57,6 +72,7 @@ namespace KinectEvolution {
 
                     WRK::ColorFrameSource^              _frameSource;
                     WRK::ColorFrameReader^              _frameReader;
+                    Skeleton::SkeletonOverlay           _overlay;
                 };
 
             }
@@ -22,6 +22,7 @@ using namespace WindowsPreview::Kinect;
 
 DepthMapPanel::DepthMapPanel()
     : Panel()
+    , _overlay(Skeleton::Body2DMode::DepthIR)
 {
     critical_section::scoped_lock lock(_criticalSection);
 
@@ -32,6 +33,11 @@ DepthMapPanel::DepthMapPanel()
 DepthMapPanel::~DepthMapPanel()
 {
     Stop();
+
+    if (nullptr != _irProcessor)
+    {
+        _irProcessor->Unsubscribe();
+    }
 }
 
 void DepthMapPanel::StartRenderLoop()
@@ -63,6 +69,7 @@ void DepthMapPanel::CoordinateMapper::set(_In_ WRK::CoordinateMapper^ value)
     }
 
     _coordinateMapper = value;
+    _overlay.SetCoordinateMapper(value);
     _mapperChangedEventToken = _coordinateMapper->CoordinateMappingChanged += ref new TypedEventHandler<WRK::CoordinateMapper^, CoordinateMappingChangedEventArgs^>(this, &DepthMapPanel::OnMapperChanged);
 
     CopyXYTableToDepthMap();
@@ -102,14 +109,19 @@ void DepthMapPanel::InfraredSource::set(_In_ WRK::InfraredFrameSource^ value)
         return;
     }
 
-    // close the previous reader
-    _irReader = nullptr;
+    // release the previous processor
+    if (nullptr != _irProcessor)
+    {
+        _irProcessor->Unsubscribe();
+        _irProcessor = nullptr;
+    }
 
-    // set the new source
+    // set the new source, frames are shared with every other view of it
     _irSource = value;
     if (nullptr != _irSource)
     {
-        _irReader = _irSource->OpenReader();
+        _irProcessor = Infrared::InfraredFrameProcessor::GetForSource(_irSource);
+        _irProcessor->Subscribe();
     }
 
     NotifyPropertyChanged("InfraredSource");
@@ -145,6 +157,25 @@ WRK::ColorFrameSource^ DepthMapPanel::ColorSource::get()
     return _colorSource;
 }
 
+void DepthMapPanel::BodySource::set(_In_ WRK::BodyFrameSource^ value)
+{
+    critical_section::scoped_lock lock(_criticalSection);
+
+    if (_overlay.GetBodySource() == value)
+    {
+        return;
+    }
+
+    _overlay.SetBodySource(value);
+
+    NotifyPropertyChanged("BodySource");
+}
+
+WRK::BodyFrameSource^ DepthMapPanel::BodySource::get()
+{
+    return _overlay.GetBodySource();
+}
+
 void DepthMapPanel::NotifyPropertyChanged(Platform::String^ prop)
 {
     PropertyChangedEventArgs^ args = ref new PropertyChangedEventArgs(prop);
@@ -159,6 +190,10 @@ void DepthMapPanel::Update(double elapsedTime)
         _mapperChanged = false;
     }
 
+    // bodies over the IR image, or the color image in color mode
+    _overlay.SetMode(DEPTH_PANEL_MODE::COLOR == PanelMode ? Skeleton::Body2DMode::Color : Skeleton::Body2DMode::DepthIR);
+    _overlay.Update();
+
     if (DEPTH_PANEL_MODE::DEPTH_RAMP == PanelMode)
     {
         if (nullptr != _depthReader)
@@ -179,13 +214,10 @@ void DepthMapPanel::Update(double elapsedTime)
             if (nullptr != frame)
             {
 
-                if (nullptr != _irReader)
+                if (nullptr != _irProcessor)
                 {
-                    InfraredFrame^ ir = _irReader->AcquireLatestFrame();
-                    if (nullptr != ir)
-                    {
-                        OnInfraredFrame(ir);
-                    }
+                    _irProcessor->Update();
+                    _irRenderer->UpdateFrameImage(_d3dContext.Get(), _irProcessor);
                 }
 
                 if (nullptr != _depthReader)
@@ -228,8 +260,13 @@ void DepthMapPanel::Render()
         Render(nullptr, nullptr);
         break;
     case DEPTH_PANEL_MODE::IR:
-        _irRenderer->Render(_d3dContext.Get());
+    {
+        // lock texture(s)
+        RenderLock lock(_irRenderer->InfraredImage);
         RenderTexture(_irRenderer->InfraredImage);
+    }
+
+        _overlay.Render(_d2dContext.Get(), _width, _height);
         break;
     case DEPTH_PANEL_MODE::COLOR:
     {
@@ -237,10 +274,15 @@ void DepthMapPanel::Render()
         RenderLock lock(_colorFrame);
         RenderTexture(_colorFrame);
     }
+
+        _overlay.Render(_d2dContext.Get(), _width, _height);
         break;
     case DEPTH_PANEL_MODE::COLOR_AND_IR:
-        _irRenderer->Render(_d3dContext.Get());
-        RenderTexture(_irRenderer->InfraredImage);
+        {
+            // lock texture(s)
+            RenderLock irLock(_irRenderer->InfraredImage);
+            RenderTexture(_irRenderer->InfraredImage);
+        }
 
         //clear depth stensil for overlay
         _d3dContext->ClearDepthStencilView(_backBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
@@ -267,6 +309,8 @@ void DepthMapPanel::ResetDeviceResources()
 {
     Panel::ResetDeviceResources();
 
+    _overlay.ResetDeviceResources();
+
     _uvSamplerState.ReleaseAndGetAddressOf();
 
     _pointEffect = nullptr;
@@ -282,6 +326,8 @@ void DepthMapPanel::CreateDeviceResources()
 {
     Panel::CreateDeviceResources();
 
+    _overlay.CreateDeviceResources(_d2dContext.Get());
+
     // depth point
     _pointEffect = ref new DepthPointEffect();
     _pointEffect->Initialize(_d3dDevice.Get(), DEPTH_FRAME_WIDTH, DEPTH_FRAME_HEIGHT, DEPTH_MINMM, DEPTH_MAXMM);
@@ -704,21 +750,6 @@ void DepthMapPanel::OnDepthFrame(_In_ WRK::DepthFrame^ frame)
     UpdateData(_depthFrame->Data, frame->FrameDescription->LengthInPixels);
 }
 
-void DepthMapPanel::OnInfraredFrame(_In_ WRK::InfraredFrame^ frame)
-{
-    if (nullptr == frame)
-    {
-        return;
-    }
-
-    UINT length = frame->FrameDescription->LengthInPixels * frame->FrameDescription->BytesPerPixel;
-
-    IBuffer^ buffer = frame->LockImageBuffer();
-    UINT16* pSrc = reinterpret_cast<UINT16*>(DX::GetPointerToPixelData(buffer));
-
-    _irRenderer->UpdateFrameImage(_d3dContext.Get(), length, pSrc);
-}
-
 void DepthMapPanel::OnColorFrame(_In_ WRK::ColorFrame^ frame)
 {
     if (nullptr == frame)
@@ -13,6 +13,7 @@
 #include "DepthMesh.h"
 #include "Texture.h"
 #include "InfraredRenderer.h"
+#include "SkeletonOverlay.h"
 
 namespace KinectEvolution {
     namespace Xaml {
@@ -73,6 +74,13 @@ namespace KinectEvolution {
                         void set(_In_ WRK::ColorFrameSource^ value);
                     }
 
+                    // bodies drawn over the IR and color images
+                    property WRK::BodyFrameSource^ BodySource
+                    {
+                        WRK::BodyFrameSource^ get();
+                        void set(_In_ WRK::BodyFrameSource^ value);
+                    }
+
                 protected private:
                     virtual event Windows::UI::Xaml::Data::PropertyChangedEventHandler^ PropertyChanged;
                     void NotifyPropertyChanged(Platform::String^ prop);
@@ -96,7 +104,6 @@ namespace KinectEvolution {
                     void CopyXYTableToDepthMap();
 
                     void OnDepthFrame(_In_ WRK::DepthFrame^ frame);
-                    void OnInfraredFrame(_In_ WRK::InfraredFrame^ frame);
                     void OnColorFrame(_In_ WRK::ColorFrame^ frame);
 
                     void UpdateDepthTexture(_In_reads_(pixels) const UINT16* pZ, UINT pixels);
@@ -174,6 +181,7 @@ namespace KinectEvolution {
                     InfraredRenderer^           _irRenderer;
 
                     WRK::CoordinateMapper^      _coordinateMapper;
+                    Skeleton::SkeletonOverlay   _overlay;
                     BOOL                        _mapperChanged;
 
                     WRK::DepthFrameSource^      _depthSource;
@@ -183,7 +191,7 @@ namespace KinectEvolution {
                     WRK::ColorFrameReader^      _colorReader;
 
                     WRK::InfraredFrameSource^   _irSource;
-                    WRK::InfraredFrameReader^   _irReader;
+                    Infrared::InfraredFrameProcessor^   _irProcessor;
 
                     Windows::Foundation::EventRegistrationToken _mapperChangedEventToken;
                 };
@@ -0,0 +1,247 @@
+//------------------------------------------------------------------------------
+// <copyright file="DirectionOfArrival.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "DirectionOfArrival.h"
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+static const double PI = 3.14159265358979323846;
+
+static const float SPEED_OF_SOUND = 343.0f;     // m/s
+
+// frames quieter than this mean square have no direction
+static const float MIN_MEAN_SQUARE = 1e-9f;
+
+// keeps the whitening finite on empty bins
+static const float MIN_CROSS_MAGNITUDE = 1e-20f;
+
+// the weighted samples at source and source + 1, silence outside the channel
+static float InterpolateSample(_In_reads_(count) const float* pChannel, INT count, INT source, float early, float late)
+{
+    float a = (source >= 0 && source < count) ? pChannel[source] : 0.0f;
+    float b = (source + 1 >= 0 && source + 1 < count) ? pChannel[source + 1] : 0.0f;
+
+    return a * early + b * late;
+}
+
+DirectionOfArrival::DirectionOfArrival()
+    : _sampleRate(0)
+    , _microphoneCount(0)
+    , _pairCount(0)
+    , _binStride(0)
+    , _angleCount(0)
+{
+}
+
+void DirectionOfArrival::Reset(
+    UINT sampleRate,
+    UINT frameSize,
+    _In_reads_(microphoneCount) const float* pMicrophonePositions,
+    UINT microphoneCount,
+    float maxAngle,
+    UINT angleCount)
+{
+    ASSERT(microphoneCount >= 2 && angleCount >= 2);
+
+    _fft.Reset(frameSize);
+    _sampleRate = sampleRate;
+    _microphoneCount = microphoneCount;
+    _pairCount = microphoneCount * (microphoneCount - 1) / 2;
+    _binStride = (_fft.GetBinCount() + 3) & ~3;
+    _positions.assign(pMicrophonePositions, pMicrophonePositions + microphoneCount);
+
+    _window.resize(frameSize);
+    for (UINT n = 0; n < frameSize; ++n)
+    {
+        _window[n] = static_cast<float>(0.5 - 0.5 * cos(2.0 * PI * n / frameSize));
+    }
+    _windowed.resize(frameSize);
+
+    // the bins past the last stay zero
+    _real.assign(microphoneCount * _binStride, 0.0f);
+    _imaginary.assign(microphoneCount * _binStride, 0.0f);
+    _crossReal.assign(_binStride, 0.0f);
+    _crossImaginary.assign(_binStride, 0.0f);
+    _correlation.assign(_pairCount * frameSize, 0.0f);
+
+    // a plane wave from angle a reaches microphone m x_m sin(a) / c early, so the correlation of the
+    // pair (m, n) peaks at the lag (x_n - x_m) sin(a) / c
+    _angleCount = angleCount;
+    _angles.resize(angleCount);
+    _lag.resize(angleCount * _pairCount);
+    _lagFraction.resize(angleCount * _pairCount);
+    _response.assign(angleCount, 0.0f);
+
+    for (UINT a = 0; a < angleCount; ++a)
+    {
+        _angles[a] = -maxAngle + 2.0f * maxAngle * a / (angleCount - 1);
+        float samplesPerMeter = sinf(_angles[a]) / SPEED_OF_SOUND * sampleRate;
+
+        UINT pair = 0;
+        for (UINT m = 0; m < microphoneCount; ++m)
+        {
+            for (UINT n = m + 1; n < microphoneCount; ++n, ++pair)
+            {
+                float lag = (_positions[n] - _positions[m]) * samplesPerMeter;
+                float whole = floorf(lag);
+
+                _lag[a * _pairCount + pair] = static_cast<UINT>(static_cast<INT>(whole) + static_cast<INT>(frameSize)) & (frameSize - 1);
+                _lagFraction[a * _pairCount + pair] = lag - whole;
+            }
+        }
+    }
+}
+
+BOOL DirectionOfArrival::Estimate(
+    _In_reads_(GetMicrophoneCount()) const float* const* ppChannels,
+    _Out_ BeamEstimate* pEstimate)
+{
+    ZeroMemory(pEstimate, sizeof(*pEstimate));
+
+    const UINT frameSize = _fft.GetSize();
+
+    float sumOfSquares = 0.0f;
+    for (UINT n = 0; n < frameSize; ++n)
+    {
+        sumOfSquares += ppChannels[0][n] * ppChannels[0][n];
+    }
+
+    if (sumOfSquares < MIN_MEAN_SQUARE * frameSize)
+    {
+        return FALSE;
+    }
+
+    for (UINT m = 0; m < _microphoneCount; ++m)
+    {
+        for (UINT n = 0; n < frameSize; ++n)
+        {
+            _windowed[n] = ppChannels[m][n] * _window[n];
+        }
+
+        _fft.Forward(_windowed.data(), &_real[m * _binStride], &_imaginary[m * _binStride]);
+    }
+
+    const XMVECTOR minMagnitude = XMVectorReplicate(MIN_CROSS_MAGNITUDE);
+
+    UINT pair = 0;
+    for (UINT m = 0; m < _microphoneCount; ++m)
+    {
+        for (UINT n = m + 1; n < _microphoneCount; ++n, ++pair)
+        {
+            const float* pReal = &_real[m * _binStride];
+            const float* pImaginary = &_imaginary[m * _binStride];
+            const float* pOtherReal = &_real[n * _binStride];
+            const float* pOtherImaginary = &_imaginary[n * _binStride];
+
+            // X_m conj(X_n) / |X_m conj(X_n)|, 4 bins at a time
+            for (UINT k = 0; k < _binStride; k += 4)
+            {
+                XMVECTOR ar = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pReal + k));
+                XMVECTOR ai = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pImaginary + k));
+                XMVECTOR br = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pOtherReal + k));
+                XMVECTOR bi = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pOtherImaginary + k));
+
+                XMVECTOR cr = XMVectorMultiplyAdd(ar, br, XMVectorMultiply(ai, bi));
+                XMVECTOR ci = XMVectorSubtract(XMVectorMultiply(ai, br), XMVectorMultiply(ar, bi));
+
+                XMVECTOR magnitude = XMVectorSqrt(XMVectorMultiplyAdd(cr, cr, XMVectorMultiply(ci, ci)));
+                XMVECTOR scale = XMVectorReciprocal(XMVectorMax(magnitude, minMagnitude));
+
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&_crossReal[k]), XMVectorMultiply(cr, scale));
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&_crossImaginary[k]), XMVectorMultiply(ci, scale));
+            }
+
+            _fft.Inverse(_crossReal.data(), _crossImaginary.data(), &_correlation[pair * frameSize]);
+        }
+    }
+
+    // steered response power over the grid, each pair's correlation read between its two nearest lags
+    UINT peak = 0;
+    float sum = 0.0f;
+    for (UINT a = 0; a < _angleCount; ++a)
+    {
+        const UINT* pLag = &_lag[a * _pairCount];
+        const float* pFraction = &_lagFraction[a * _pairCount];
+
+        float response = 0.0f;
+        for (UINT p = 0; p < _pairCount; ++p)
+        {
+            const float* pCorrelation = &_correlation[p * frameSize];
+            float early = pCorrelation[pLag[p]];
+            float late = pCorrelation[(pLag[p] + 1) & (frameSize - 1)];
+
+            response += early + (late - early) * pFraction[p];
+        }
+
+        _response[a] = response;
+        sum += response;
+        peak = (response > _response[peak]) ? a : peak;
+    }
+
+    // how far the peak stands above the rest, against the most a fully correlated frame reaches
+    float mean = sum / _angleCount;
+    float range = _pairCount - mean;
+
+    pEstimate->BeamAngle = _angles[peak];
+    pEstimate->BeamAngleConfidence = (range > 0.0f) ? min(max((_response[peak] - mean) / range, 0.0f), 1.0f) : 0.0f;
+
+    return TRUE;
+}
+
+void DirectionOfArrival::Beamform(
+    _In_reads_(GetMicrophoneCount()) const float* const* ppChannels,
+    UINT sampleCount,
+    float angle,
+    _Out_writes_(sampleCount) float* pOutput) const
+{
+    ZeroMemory(pOutput, sampleCount * sizeof(float));
+
+    const float scale = 1.0f / _microphoneCount;
+    const float samplesPerMeter = sinf(angle) / SPEED_OF_SOUND * _sampleRate;
+
+    for (UINT m = 0; m < _microphoneCount; ++m)
+    {
+        // the source's sample t reached this microphone at t - x_m sin(a) / c
+        float delay = -_positions[m] * samplesPerMeter;
+        float whole = floorf(delay);
+        INT shift = static_cast<INT>(whole);
+        float fraction = delay - whole;
+
+        const float* pChannel = ppChannels[m];
+        const float early = (1.0f - fraction) * scale;
+        const float late = fraction * scale;
+
+        // both samples inside the channel for t in [first, last), 4 at a time
+        INT count = static_cast<INT>(sampleCount);
+        INT first = min(max(-shift, 0), count);
+        INT last = max(min(count - shift - 1, count), first);
+
+        const XMVECTOR earlyWeight = XMVectorReplicate(early);
+        const XMVECTOR lateWeight = XMVectorReplicate(late);
+
+        INT t = first;
+        for (; t + 4 <= last; t += 4)
+        {
+            XMVECTOR a = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pChannel + t + shift));
+            XMVECTOR b = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pChannel + t + shift + 1));
+            XMVECTOR output = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pOutput + t));
+
+            output = XMVectorMultiplyAdd(a, earlyWeight, XMVectorMultiplyAdd(b, lateWeight, output));
+            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pOutput + t), output);
+        }
+
+        // the rest one at a time
+        for (INT u = 0; u < first; ++u)
+        {
+            pOutput[u] += InterpolateSample(pChannel, count, u + shift, early, late);
+        }
+        for (; t < count; ++t)
+        {
+            pOutput[t] += InterpolateSample(pChannel, count, t + shift, early, late);
+        }
+    }
+}
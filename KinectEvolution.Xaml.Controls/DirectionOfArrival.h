@@ -0,0 +1,96 @@
+//------------------------------------------------------------------------------
+// <copyright file="DirectionOfArrival.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "RealFft.h"
+#include "WaveFile.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // the angle and confidence AudioBeam reports
+                struct BeamEstimate
+                {
+                    float   BeamAngle;              // radians from the array's normal, positive towards larger microphone x
+                    float   BeamAngleConfidence;    // [0, 1]
+                };
+
+                // microphone x in meters along the sensor's linear array
+                static const UINT KINECT_MICROPHONE_COUNT = 4;
+                static const float KinectMicrophonePositions[KINECT_MICROPHONE_COUNT] = { -0.113f, 0.036f, 0.076f, 0.113f };
+
+                // direction of arrival of a far source at a linear microphone array by SRP-PHAT. each channel of a
+                // frame is windowed and transformed; every pair's cross spectrum is whitened to unit magnitude (PHAT)
+                // and transformed back to a generalized cross correlation (GCC-PHAT). the steered response power of
+                // the delay and sum beamformer at an angle is then the sum of the pairs' correlations at the delays
+                // the angle implies, and the estimate is the grid angle where it peaks.
+                class DirectionOfArrival
+                {
+                public:
+                    DirectionOfArrival();
+
+                    // angles from -maxAngle to maxAngle in angleCount steps
+                    void Reset(
+                        UINT sampleRate,
+                        UINT frameSize,
+                        _In_reads_(microphoneCount) const float* pMicrophonePositions,
+                        UINT microphoneCount,
+                        float maxAngle,
+                        UINT angleCount);
+
+                    UINT GetFrameSize() const { return _fft.GetSize(); }
+                    UINT GetMicrophoneCount() const { return _microphoneCount; }
+                    UINT GetAngleCount() const { return _angleCount; }
+                    float GetAngle(UINT index) const { return _angles[index]; }
+
+                    // GetFrameSize samples from each channel; FALSE with no estimate when the frame is silent
+                    BOOL Estimate(
+                        _In_reads_(GetMicrophoneCount()) const float* const* ppChannels,
+                        _Out_ BeamEstimate* pEstimate);
+
+                    // steered response power of the last frame at each grid angle
+                    const float* GetSteeredResponse() const { return _response.data(); }
+
+                    // the channels delayed towards the angle and averaged, samples outside the channels count as silence
+                    void Beamform(
+                        _In_reads_(GetMicrophoneCount()) const float* const* ppChannels,
+                        UINT sampleCount,
+                        float angle,
+                        _Out_writes_(sampleCount) float* pOutput) const;
+
+                private:
+                    RealFft             _fft;
+                    UINT                _sampleRate;
+                    UINT                _microphoneCount;
+                    UINT                _pairCount;
+                    UINT                _binStride;         // bins rounded up to whole vectors
+                    std::vector<float>  _positions;
+
+                    std::vector<float>  _window;
+                    std::vector<float>  _windowed;
+
+                    // each microphone's spectrum, then each pair's whitened cross spectrum and correlation
+                    std::vector<float>  _real;
+                    std::vector<float>  _imaginary;
+                    std::vector<float>  _crossReal;
+                    std::vector<float>  _crossImaginary;
+                    std::vector<float>  _correlation;
+
+                    // for each angle and pair, the circular lag of the correlation and the weight of the next one
+                    UINT                _angleCount;
+                    std::vector<float>  _angles;
+                    std::vector<UINT>   _lag;
+                    std::vector<float>  _lagFraction;
+                    std::vector<float>  _response;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,277 @@
+//------------------------------------------------------------------------------
+// <copyright file="EnergyPyramid.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "EnergyPyramid.h"
+
+#include <cfloat>
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+// adds the energies of a span to a running min, max and sum
+static void Accumulate(const EnergySummary& summary, INT64 length, _Inout_ EnergySummary* pTotal, _Inout_ double* pSum, _Inout_ INT64* pLength)
+{
+    if (0 == *pLength)
+    {
+        pTotal->Min = summary.Min;
+        pTotal->Max = summary.Max;
+    }
+    else
+    {
+        pTotal->Min = min(pTotal->Min, summary.Min);
+        pTotal->Max = max(pTotal->Max, summary.Max);
+    }
+
+    *pSum += static_cast<double>(summary.Mean) * length;
+    *pLength += length;
+}
+
+EnergyPyramid::EnergyPyramid()
+    : _file(INVALID_HANDLE_VALUE)
+    , _mapping(nullptr)
+    , _pView(nullptr)
+    , _capacity(0)
+    , _levelCount(0)
+    , _pEnergy(nullptr)
+    , _count(0)
+{
+}
+
+EnergyPyramid::~EnergyPyramid()
+{
+    Close();
+}
+
+BOOL EnergyPyramid::Open(_In_opt_ const wchar_t* path, UINT minCapacity)
+{
+    ASSERT(minCapacity > 0);
+
+    Close();
+
+    UINT capacity = 1;
+    UINT levelCount = 1;
+    while (capacity < minCapacity)
+    {
+        capacity <<= 1;
+        levelCount++;
+    }
+
+    // the energies, then each level above them in turn
+    UINT64 size = static_cast<UINT64>(capacity) * sizeof(float) + static_cast<UINT64>(capacity - 1) * sizeof(EnergySummary);
+
+    if (nullptr != path)
+    {
+        // the file goes when its last handle does, after Close or when the process dies
+        CREATEFILE2_EXTENDED_PARAMETERS parameters = {};
+        parameters.dwSize = sizeof(parameters);
+        parameters.dwFileAttributes = FILE_ATTRIBUTE_TEMPORARY;
+        parameters.dwFileFlags = FILE_FLAG_DELETE_ON_CLOSE;
+
+        _file = CreateFile2(path, GENERIC_READ | GENERIC_WRITE, 0, CREATE_ALWAYS, &parameters);
+        if (INVALID_HANDLE_VALUE == _file)
+        {
+            Close();
+            return FALSE;
+        }
+    }
+
+    _mapping = CreateFileMappingFromApp(_file, nullptr, PAGE_READWRITE, size, nullptr);
+    if (nullptr == _mapping)
+    {
+        Close();
+        return FALSE;
+    }
+
+    _pView = MapViewOfFileFromApp(_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, static_cast<SIZE_T>(size));
+    if (nullptr == _pView)
+    {
+        Close();
+        return FALSE;
+    }
+
+    _capacity = capacity;
+    _levelCount = levelCount;
+    _pEnergy = static_cast<float*>(_pView);
+
+    _levels.assign(levelCount, nullptr);
+    EnergySummary* pNodes = reinterpret_cast<EnergySummary*>(_pEnergy + capacity);
+    for (UINT level = 1; level < levelCount; ++level)
+    {
+        _levels[level] = pNodes;
+        pNodes += capacity >> level;
+    }
+
+    _count = 0;
+
+    return TRUE;
+}
+
+void EnergyPyramid::Close()
+{
+    if (nullptr != _pView)
+    {
+        UnmapViewOfFile(_pView);
+        _pView = nullptr;
+    }
+
+    if (nullptr != _mapping)
+    {
+        CloseHandle(_mapping);
+        _mapping = nullptr;
+    }
+
+    if (INVALID_HANDLE_VALUE != _file)
+    {
+        CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+
+    _capacity = 0;
+    _levelCount = 0;
+    _pEnergy = nullptr;
+    _levels.clear();
+    _count = 0;
+}
+
+EnergySummary EnergyPyramid::ReadNode(UINT level, INT64 node) const
+{
+    if (0 == level)
+    {
+        float energy = _pEnergy[node & (_capacity - 1)];
+        EnergySummary summary = { energy, energy, energy };
+        return summary;
+    }
+
+    return _levels[level][node & ((_capacity >> level) - 1)];
+}
+
+void EnergyPyramid::Append(float energy)
+{
+    ASSERT(IsOpen());
+
+    _pEnergy[_count & (_capacity - 1)] = energy;
+    _count++;
+
+    // the energy completes a node of level k every 2^k energies, half as often for each level up
+    for (UINT level = 1; level < _levelCount && 0 == (_count & ((INT64(1) << level) - 1)); ++level)
+    {
+        INT64 node = (_count >> level) - 1;
+
+        EnergySummary left = ReadNode(level - 1, 2 * node);
+        EnergySummary right = ReadNode(level - 1, 2 * node + 1);
+
+        EnergySummary& summary = _levels[level][node & ((_capacity >> level) - 1)];
+        summary.Min = min(left.Min, right.Min);
+        summary.Max = max(left.Max, right.Max);
+        summary.Mean = 0.5f * (left.Mean + right.Mean);
+    }
+}
+
+void EnergyPyramid::Append(_In_reads_(count) const float* pEnergy, UINT count)
+{
+    for (UINT i = 0; i < count; ++i)
+    {
+        Append(pEnergy[i]);
+    }
+}
+
+EnergySummary EnergyPyramid::Summarize(INT64 start, INT64 end, _Out_opt_ UINT* pReads) const
+{
+    EnergySummary total = { 0.0f, 0.0f, 0.0f };
+    double sum = 0.0;
+    INT64 length = 0;
+    UINT reads = 0;
+
+    start = max(start, GetFirst());
+    end = min(end, _count);
+
+    // the largest aligned node that starts at start and ends by end, each time
+    while (start < end)
+    {
+        UINT level = 0;
+        while (level + 1 < _levelCount && 0 == (start & ((INT64(2) << level) - 1)) && start + (INT64(2) << level) <= end)
+        {
+            level++;
+        }
+
+        Accumulate(ReadNode(level, start >> level), INT64(1) << level, &total, &sum, &length);
+        reads++;
+
+        start += INT64(1) << level;
+    }
+
+    if (length > 0)
+    {
+        total.Mean = static_cast<float>(sum / length);
+    }
+
+    if (nullptr != pReads)
+    {
+        *pReads = reads;
+    }
+
+    return total;
+}
+
+UINT EnergyPyramid::Render(INT64 start, INT64 end, UINT columns, _Out_writes_(columns) EnergySummary* pColumns) const
+{
+    ZeroMemory(pColumns, columns * sizeof(EnergySummary));
+
+    if (!IsOpen() || 0 == columns || end <= start)
+    {
+        return 0;
+    }
+
+    const double width = static_cast<double>(end - start) / columns;
+
+    UINT level = 0;
+    while (level + 1 < _levelCount && static_cast<double>(INT64(4) << (level + 1)) <= width)
+    {
+        level++;
+    }
+
+    const INT64 nodeLength = INT64(1) << level;
+
+    // the complete nodes kept at this level, then the one the latest energies are filling
+    const INT64 firstNode = GetFirst() >> level;
+    const INT64 tailNode = _count >> level;
+    const INT64 tailLength = _count & (nodeLength - 1);
+
+    UINT reads = 0;
+
+    for (UINT column = 0; column < columns; ++column)
+    {
+        // zoomed in past one energy per column, neighbouring columns show the same node
+        INT64 nodeStart = static_cast<INT64>(floor((start + column * width) / nodeLength));
+        INT64 nodeEnd = static_cast<INT64>(floor((start + (column + 1) * width) / nodeLength));
+        nodeEnd = max(nodeEnd, nodeStart + 1);
+
+        EnergySummary total = { 0.0f, 0.0f, 0.0f };
+        double sum = 0.0;
+        INT64 length = 0;
+
+        for (INT64 node = max(nodeStart, firstNode); node < min(nodeEnd, tailNode); ++node)
+        {
+            Accumulate(ReadNode(level, node), nodeLength, &total, &sum, &length);
+            reads++;
+        }
+
+        if (tailLength > 0 && nodeStart <= tailNode && tailNode < nodeEnd)
+        {
+            UINT tailReads;
+            Accumulate(Summarize(tailNode << level, _count, &tailReads), tailLength, &total, &sum, &length);
+            reads += tailReads;
+        }
+
+        if (length > 0)
+        {
+            total.Mean = static_cast<float>(sum / length);
+            pColumns[column] = total;
+        }
+    }
+
+    return reads;
+}
@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+// <copyright file="EnergyPyramid.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // the energies of a span of the stream, all zero when it holds none
+                struct EnergySummary
+                {
+                    float   Min;
+                    float   Max;
+                    float   Mean;
+                };
+
+                // min, max and mean of the energy stream at every power of 2 decimation, for a timeline that can
+                // be zoomed from single energies out to hours. level 0 holds the energies and each node of
+                // level k summarizes 2^k of them; a node is written once its last energy arrives, so appending
+                // costs 2 nodes per energy on average. every level is a ring over the same last capacity energies,
+                // mapped from a file so the history lives in the page cache rather than the heap.
+                class EnergyPyramid
+                {
+                public:
+                    EnergyPyramid();
+                    ~EnergyPyramid();
+
+                    // keeps the last minCapacity energies, rounded up to a power of 2, in the file at path, which
+                    // is deleted once closed, or in the paging file when path is null. FALSE when the file could not
+                    // be created or mapped, as when another pyramid has it open
+                    BOOL Open(_In_opt_ const wchar_t* path, UINT minCapacity);
+                    void Close();
+
+                    BOOL IsOpen() const { return nullptr != _pView; }
+                    UINT GetCapacity() const { return _capacity; }
+                    UINT GetLevelCount() const { return _levelCount; }
+
+                    // energies appended since Open, and the oldest one still kept
+                    INT64 GetCount() const { return _count; }
+                    INT64 GetFirst() const { return (_count > _capacity) ? _count - _capacity : 0; }
+
+                    void Append(float energy);
+                    void Append(_In_reads_(count) const float* pEnergy, UINT count);
+
+                    // energies [start, end) clipped to the ones kept, from at most 2 nodes per level
+                    EnergySummary Summarize(INT64 start, INT64 end, _Out_opt_ UINT* pReads = nullptr) const;
+
+                    // one summary per column of the window [start, end), which may reach past the energies kept
+                    // on either side. columns are read from the level whose nodes fit at least 4 times into one,
+                    // their edges moved down to a node edge, so a window costs at most 8 reads per column however
+                    // long it is, and a few more for the node still filling. returns the number of nodes read
+                    UINT Render(INT64 start, INT64 end, UINT columns, _Out_writes_(columns) EnergySummary* pColumns) const;
+
+                private:
+                    EnergySummary ReadNode(UINT level, INT64 node) const;
+
+                private:
+                    HANDLE                      _file;
+                    HANDLE                      _mapping;
+                    void*                       _pView;
+
+                    UINT                        _capacity;
+                    UINT                        _levelCount;
+
+                    // level 0, and the nodes of level k at _levels[k] for k > 0
+                    float*                      _pEnergy;
+                    std::vector<EnergySummary*> _levels;
+
+                    INT64                       _count;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,24 @@
+//------------------------------------------------------------------------------
+// <copyright file="EnergyRing.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpscRing.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // the energy values the audio thread hands the render thread
+                typedef Base::SpscRing<float> EnergyRing;
+                typedef Base::RingSpan<float> EnergySpan;
+                typedef Base::RingStatistics EnergyRingStatistics;
+
+            }
+        }
+    }
+}
@@ -0,0 +1,178 @@
+//------------------------------------------------------------------------------
+// <copyright file="EnergyWaveform.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "EnergyWaveform.h"
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+// rows [top, bottom) of the bars of the first count columns, the rest are empty
+static void ComputeBars(
+    _In_reads_(energyCount) const float* pEnergy,
+    UINT energyCount,
+    UINT width,
+    UINT height,
+    _Out_writes_(width) INT* pTop,
+    _Out_writes_(width) INT* pBottom)
+{
+    const INT halfHeight = height / 2;
+    const UINT count = min(energyCount, width);
+
+    for (UINT i = 0; i < count; ++i)
+    {
+        // Each bar has a minimum height of 1 (to get a steady signal down the middle) and a maximum height
+        // equal to the bitmap height.
+        INT barHeight = static_cast<INT>(min(max(1.0f, pEnergy[i] * height), static_cast<float>(height)));
+
+        // Center bar vertically on image
+        pTop[i] = halfHeight - (barHeight / 2);
+        pBottom[i] = pTop[i] + barHeight;
+    }
+
+    for (UINT i = count; i < width; ++i)
+    {
+        pTop[i] = 0;
+        pBottom[i] = 0;
+    }
+}
+
+// one pass over the rows, each row filled 4 columns at a time: foreground where the row is inside the column's bar
+static void RasterizeColumns(
+    _In_reads_(right) const INT* pTop,
+    _In_reads_(right) const INT* pBottom,
+    const EnergyWaveformRect& rect,
+    UINT stride,
+    UINT background,
+    UINT foreground,
+    _Inout_ UINT* pPixels)
+{
+    const __m128i backgroundColor = _mm_set1_epi32(background);
+    const __m128i foregroundColor = _mm_set1_epi32(foreground);
+
+    for (UINT y = rect.Top; y < rect.Bottom; ++y)
+    {
+        UINT* pRow = pPixels + y * stride;
+        const __m128i row = _mm_set1_epi32(y);
+
+        UINT x = rect.Left;
+        for (; x + 4 <= rect.Right; x += 4)
+        {
+            __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pTop + x));
+            __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBottom + x));
+
+            // top <= y < bottom
+            __m128i inside = _mm_andnot_si128(_mm_cmpgt_epi32(top, row), _mm_cmpgt_epi32(bottom, row));
+            __m128i color = _mm_or_si128(_mm_and_si128(inside, foregroundColor), _mm_andnot_si128(inside, backgroundColor));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pRow + x), color);
+        }
+
+        for (; x < rect.Right; ++x)
+        {
+            pRow[x] = (pTop[x] <= static_cast<INT>(y) && static_cast<INT>(y) < pBottom[x]) ? foreground : background;
+        }
+    }
+}
+
+void KinectEvolution::Xaml::Controls::Audio::RasterizeEnergyWaveform(
+    _In_reads_(energyCount) const float* pEnergy,
+    UINT energyCount,
+    UINT width,
+    UINT height,
+    UINT background,
+    UINT foreground,
+    _Out_writes_(width * height) UINT* pPixels)
+{
+    std::vector<INT> top(width);
+    std::vector<INT> bottom(width);
+    ComputeBars(pEnergy, energyCount, width, height, top.data(), bottom.data());
+
+    EnergyWaveformRect rect = { 0, 0, width, height };
+    RasterizeColumns(top.data(), bottom.data(), rect, width, background, foreground, pPixels);
+}
+
+EnergyWaveform::EnergyWaveform()
+    : _width(0)
+    , _height(0)
+    , _background(0)
+    , _foreground(0)
+{
+}
+
+void EnergyWaveform::Resize(UINT width, UINT height, UINT background, UINT foreground)
+{
+    _width = width;
+    _height = height;
+    _background = background;
+    _foreground = foreground;
+
+    _pixels.assign(width * height, background);
+
+    // nothing drawn yet
+    _top.assign(width, 0);
+    _bottom.assign(width, 0);
+    _nextTop.resize(width);
+    _nextBottom.resize(width);
+}
+
+BOOL EnergyWaveform::Update(
+    _In_reads_(energyCount) const float* pEnergy,
+    UINT energyCount,
+    _Out_ EnergyWaveformRect* pDirty)
+{
+    ZeroMemory(pDirty, sizeof(*pDirty));
+
+    ComputeBars(pEnergy, energyCount, _width, _height, _nextTop.data(), _nextBottom.data());
+
+    // the columns from the first to the last changed bar, and the rows either bar covers
+    INT left = -1;
+    INT right = -1;
+    INT top = _height;
+    INT bottom = 0;
+
+    for (UINT x = 0; x < _width; ++x)
+    {
+        if (_top[x] == _nextTop[x] && _bottom[x] == _nextBottom[x])
+        {
+            continue;
+        }
+
+        if (left < 0)
+        {
+            left = x;
+        }
+        right = x + 1;
+
+        if (_top[x] < _bottom[x])
+        {
+            top = min(top, _top[x]);
+            bottom = max(bottom, _bottom[x]);
+        }
+
+        if (_nextTop[x] < _nextBottom[x])
+        {
+            top = min(top, _nextTop[x]);
+            bottom = max(bottom, _nextBottom[x]);
+        }
+    }
+
+    if (left < 0 || top >= bottom)
+    {
+        return FALSE;
+    }
+
+    pDirty->Left = left;
+    pDirty->Top = top;
+    pDirty->Right = right;
+    pDirty->Bottom = bottom;
+
+    RasterizeColumns(_nextTop.data(), _nextBottom.data(), *pDirty, _width, _background, _foreground, _pixels.data());
+
+    _top.swap(_nextTop);
+    _bottom.swap(_nextBottom);
+
+    return TRUE;
+}
@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------
+// <copyright file="EnergyWaveform.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // pixels [Left, Right) x [Top, Bottom)
+                struct EnergyWaveformRect
+                {
+                    UINT    Left;
+                    UINT    Top;
+                    UINT    Right;
+                    UINT    Bottom;
+                };
+
+                // draws the energy waveform, one vertical bar per column centered on the middle row, into
+                // width x height 32 bit pixels with no padding between rows. columns past energyCount are background.
+                void RasterizeEnergyWaveform(
+                    _In_reads_(energyCount) const float* pEnergy,
+                    UINT energyCount,
+                    UINT width,
+                    UINT height,
+                    UINT background,
+                    UINT foreground,
+                    _Out_writes_(width * height) UINT* pPixels);
+
+                // keeps the waveform image on the CPU and redraws only the columns whose bar changed, so the
+                // bitmap can be brought up to date with one copy of the dirty rectangle
+                class EnergyWaveform
+                {
+                public:
+                    EnergyWaveform();
+
+                    // clears the image to the background
+                    void Resize(UINT width, UINT height, UINT background, UINT foreground);
+
+                    // returns FALSE when no pixel changed
+                    BOOL Update(
+                        _In_reads_(energyCount) const float* pEnergy,
+                        UINT energyCount,
+                        _Out_ EnergyWaveformRect* pDirty);
+
+                    UINT GetWidth() const { return _width; }
+                    UINT GetHeight() const { return _height; }
+                    UINT GetStride() const { return _width * sizeof(UINT); }
+                    const UINT* GetPixels() const { return _pixels.data(); }
+                    const UINT* GetPixels(const EnergyWaveformRect& rect) const { return _pixels.data() + rect.Top * _width + rect.Left; }
+
+                private:
+                    UINT                _width;
+                    UINT                _height;
+                    UINT                _background;
+                    UINT                _foreground;
+                    std::vector<UINT>   _pixels;
+
+                    // rows [top, bottom) of each column's bar as drawn, and as the next update draws them
+                    std::vector<INT>    _top;
+                    std::vector<INT>    _bottom;
+                    std::vector<INT>    _nextTop;
+                    std::vector<INT>    _nextBottom;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,393 @@
+//------------------------------------------------------------------------------
+// <copyright file="GestureRecognizer.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "GestureRecognizer.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace WindowsPreview::Kinect;
+
+// cost of a cell no path can reach within the threshold
+static const float DEAD_COST = FLT_MAX;
+
+void KinectEvolution::Xaml::Controls::Skeleton::ComputeGestureFeatures(_In_ const BodyFrameData& frame, UINT bodyIndex, _Out_writes_(GESTURE_BONE_COUNT) XMFLOAT4* pFeatures)
+{
+    XMVECTOR spineBase = frame.GetPosition(bodyIndex, static_cast<UINT>(JointType::SpineBase));
+    XMVECTOR spineShoulder = frame.GetPosition(bodyIndex, static_cast<UINT>(JointType::SpineShoulder));
+    XMVECTOR shoulderLeft = frame.GetPosition(bodyIndex, static_cast<UINT>(JointType::ShoulderLeft));
+    XMVECTOR shoulderRight = frame.GetPosition(bodyIndex, static_cast<UINT>(JointType::ShoulderRight));
+
+    // body frame, independent of where the body stands and which way it faces the sensor
+    XMVECTOR up = XMVector3Normalize(spineShoulder - spineBase);
+    XMVECTOR right = shoulderRight - shoulderLeft;
+    right = XMVector3Normalize(right - up * XMVector3Dot(right, up));
+    XMVECTOR forward = XMVector3Cross(right, up);
+
+    for (UINT i = 0; i < GESTURE_BONE_COUNT; ++i)
+    {
+        UINT jointA = static_cast<UINT>(BodyBones[i].JointA);
+        UINT jointB = static_cast<UINT>(BodyBones[i].JointB);
+
+        if (TrackingState::NotTracked == frame.GetTrackingState(bodyIndex, jointA) ||
+            TrackingState::NotTracked == frame.GetTrackingState(bodyIndex, jointB))
+        {
+            pFeatures[i] = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+            continue;
+        }
+
+        XMVECTOR direction = XMVector3Normalize(frame.GetPosition(bodyIndex, jointB) - frame.GetPosition(bodyIndex, jointA));
+
+        pFeatures[i] = XMFLOAT4(
+            XMVectorGetX(XMVector3Dot(direction, right)),
+            XMVectorGetX(XMVector3Dot(direction, up)),
+            XMVectorGetX(XMVector3Dot(direction, forward)),
+            0.0f);
+    }
+}
+
+// squared distance of the query to one template frame over the template's bones
+inline float FeatureDistance(_In_reads_(GESTURE_BONE_COUNT) const XMVECTOR* pQuery, _In_reads_(GESTURE_BONE_COUNT) const XMFLOAT4* pFrame, _In_ const std::vector<UINT>& bones)
+{
+    XMVECTOR sum = XMVectorZero();
+
+    for (UINT bone : bones)
+    {
+        XMVECTOR difference = pQuery[bone] - XMLoadFloat4(&pFrame[bone]);
+        sum = XMVectorMultiplyAdd(difference, difference, sum);
+    }
+
+    // the w of the features is zero
+    return XMVectorGetX(XMVector4Dot(sum, XMVectorSplatOne()));
+}
+
+// a path from start that is at template frame index at frame now stays within the band
+inline bool InBand(UINT now, UINT start, UINT index, UINT band)
+{
+    int length = static_cast<int>(now - start) + 1;
+    int progress = static_cast<int>(index) + 1;
+
+    return abs(length - progress) <= static_cast<int>(band);
+}
+
+GestureRecognizer::GestureRecognizer()
+{
+    Reset();
+}
+
+void GestureRecognizer::Reset()
+{
+    for (ColumnState& state : _columns)
+    {
+        ResetColumn(state);
+    }
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        _trackingId[bodyIndex] = 0;
+    }
+
+    _frame = 0;
+    _matches.clear();
+    _updatedColumns = 0;
+    _skippedColumns = 0;
+}
+
+void GestureRecognizer::ClearTemplates()
+{
+    _templates.clear();
+    _columns.clear();
+
+    Reset();
+}
+
+void GestureRecognizer::ResetColumn(_Inout_ ColumnState& state)
+{
+    std::fill(state.Cost.begin(), state.Cost.end(), DEAD_COST);
+    std::fill(state.Start.begin(), state.Start.end(), 0);
+
+    state.Alive = FALSE;
+    state.BestCost = DEAD_COST;
+    state.BestStart = 0;
+    state.BestEnd = 0;
+}
+
+void GestureRecognizer::ResetBody(UINT bodyIndex)
+{
+    for (UINT templateIndex = 0; templateIndex < _templates.size(); ++templateIndex)
+    {
+        ColumnState& state = _columns[templateIndex * BODY_COUNT + bodyIndex];
+
+        if (state.BestCost < DEAD_COST)
+        {
+            ReportMatch(templateIndex, bodyIndex, state);
+        }
+
+        ResetColumn(state);
+    }
+}
+
+UINT GestureRecognizer::AddTemplate(
+    _In_reads_(frameCount) const BodyFrameData* pFrames,
+    UINT frameCount,
+    UINT bodyIndex,
+    _In_ const GestureTemplateParameters& parameters)
+{
+    ASSERT(frameCount > 0 && bodyIndex < BODY_COUNT);
+
+    GestureTemplate gesture;
+    gesture.Length = min(frameCount, MAX_GESTURE_FRAMES);
+    gesture.Band = max(1u, static_cast<UINT>(parameters.BandFraction * gesture.Length + 0.5f));
+
+    for (UINT i = 0; i < GESTURE_BONE_COUNT; ++i)
+    {
+        if (parameters.BoneMask & (1u << i))
+        {
+            gesture.Bones.push_back(i);
+        }
+    }
+
+    ASSERT(!gesture.Bones.empty());
+
+    float scale = static_cast<float>(gesture.Length * max(1u, static_cast<UINT>(gesture.Bones.size())));
+    gesture.Threshold = parameters.MaxCost * scale;
+    gesture.FrameBudget = parameters.MaxCost * static_cast<float>(gesture.Bones.size());
+    gesture.CostScale = 1.0f / scale;
+
+    // long recordings are resampled to the nearest frame
+    gesture.Features.resize(gesture.Length * GESTURE_BONE_COUNT);
+    for (UINT i = 0; i < gesture.Length; ++i)
+    {
+        UINT source = (gesture.Length < frameCount) ? (i * (frameCount - 1) + (gesture.Length - 1) / 2) / max(1u, gesture.Length - 1) : i;
+        ComputeGestureFeatures(pFrames[min(source, frameCount - 1)], bodyIndex, &gesture.Features[i * GESTURE_BONE_COUNT]);
+    }
+
+    // envelope of the frames a path can reach on its first frame
+    UINT startFrames = min(gesture.Band + 1, gesture.Length);
+    for (UINT bone = 0; bone < GESTURE_BONE_COUNT; ++bone)
+    {
+        XMVECTOR lower = XMLoadFloat4(&gesture.Features[bone]);
+        XMVECTOR upper = lower;
+
+        for (UINT i = 1; i < startFrames; ++i)
+        {
+            XMVECTOR feature = XMLoadFloat4(&gesture.Features[i * GESTURE_BONE_COUNT + bone]);
+            lower = XMVectorMin(lower, feature);
+            upper = XMVectorMax(upper, feature);
+        }
+
+        XMStoreFloat4(&gesture.StartLower[bone], lower);
+        XMStoreFloat4(&gesture.StartUpper[bone], upper);
+    }
+
+    UINT templateIndex = static_cast<UINT>(_templates.size());
+    _templates.push_back(gesture);
+
+    for (UINT i = 0; i < BODY_COUNT; ++i)
+    {
+        ColumnState state;
+        state.Cost.resize(gesture.Length);
+        state.Start.resize(gesture.Length);
+        ResetColumn(state);
+
+        _columns.push_back(state);
+    }
+
+    return templateIndex;
+}
+
+float GestureRecognizer::StartLowerBound(_In_ const GestureTemplate& gesture, _In_reads_(GESTURE_BONE_COUNT) const XMVECTOR* pQuery) const
+{
+    XMVECTOR zero = XMVectorZero();
+    XMVECTOR sum = zero;
+
+    // LB_Keogh, distance of the query to the envelope
+    for (UINT bone : gesture.Bones)
+    {
+        XMVECTOR above = XMVectorMax(pQuery[bone] - XMLoadFloat4(&gesture.StartUpper[bone]), zero);
+        XMVECTOR below = XMVectorMax(XMLoadFloat4(&gesture.StartLower[bone]) - pQuery[bone], zero);
+        XMVECTOR outside = above + below;
+        sum = XMVectorMultiplyAdd(outside, outside, sum);
+    }
+
+    return XMVectorGetX(XMVector4Dot(sum, XMVectorSplatOne()));
+}
+
+void GestureRecognizer::UpdateColumn(UINT templateIndex, UINT bodyIndex, _In_reads_(GESTURE_BONE_COUNT) const XMVECTOR* pQuery)
+{
+    const GestureTemplate& gesture = _templates[templateIndex];
+    ColumnState& state = _columns[templateIndex * BODY_COUNT + bodyIndex];
+
+    // without live paths only a path starting now can appear, and its first cells cost at least the bound
+    if (!state.Alive && state.BestCost >= DEAD_COST && StartLowerBound(gesture, pQuery) > GetBudget(gesture, gesture.Band))
+    {
+        ++_skippedColumns;
+        return;
+    }
+
+    ++_updatedColumns;
+
+    const UINT now = _frame;
+    const UINT band = gesture.Band;
+    const XMFLOAT4* pFeatures = &gesture.Features[0];
+    float* pCost = &state.Cost[0];
+    UINT* pStart = &state.Start[0];
+
+    float leftCost = DEAD_COST;
+    UINT leftStart = 0;
+    float diagonalCost = DEAD_COST;
+    UINT diagonalStart = 0;
+
+    BOOL alive = FALSE;
+    BOOL canImprove = FALSE;
+
+    for (UINT i = 0; i < gesture.Length; ++i)
+    {
+        float upCost = pCost[i];
+        UINT upStart = pStart[i];
+
+        // every frame may start a path at the first template frame
+        float best = DEAD_COST;
+        UINT bestStart = now;
+
+        if (0 == i)
+        {
+            best = 0.0f;
+        }
+        else
+        {
+            if (leftCost < best && InBand(now, leftStart, i, band))
+            {
+                best = leftCost;
+                bestStart = leftStart;
+            }
+
+            if (diagonalCost < best && InBand(now, diagonalStart, i, band))
+            {
+                best = diagonalCost;
+                bestStart = diagonalStart;
+            }
+
+            if (upCost < best && InBand(now, upStart, i, band))
+            {
+                best = upCost;
+                bestStart = upStart;
+            }
+        }
+
+        float cost = DEAD_COST;
+        if (best < DEAD_COST)
+        {
+            // costs only grow along a path, abandon it once over budget
+            cost = best + FeatureDistance(pQuery, pFeatures + i * GESTURE_BONE_COUNT, gesture.Bones);
+            if (cost > GetBudget(gesture, i))
+            {
+                cost = DEAD_COST;
+            }
+        }
+
+        pCost[i] = cost;
+        pStart[i] = bestStart;
+
+        if (cost < DEAD_COST)
+        {
+            alive = TRUE;
+
+            if (cost < state.BestCost && bestStart <= state.BestEnd)
+            {
+                canImprove = TRUE;
+            }
+        }
+
+        diagonalCost = upCost;
+        diagonalStart = upStart;
+        leftCost = cost;
+        leftStart = bestStart;
+    }
+
+    // the best match is final once no path overlapping it can still end cheaper
+    if (state.BestCost < DEAD_COST && !canImprove)
+    {
+        ReportMatch(templateIndex, bodyIndex, state);
+
+        alive = FALSE;
+        for (UINT i = 0; i < gesture.Length; ++i)
+        {
+            if (pStart[i] <= state.BestEnd)
+            {
+                pCost[i] = DEAD_COST;
+            }
+            else if (pCost[i] < DEAD_COST)
+            {
+                alive = TRUE;
+            }
+        }
+
+        state.BestCost = DEAD_COST;
+    }
+
+    float endCost = pCost[gesture.Length - 1];
+    if (endCost < state.BestCost)
+    {
+        state.BestCost = endCost;
+        state.BestStart = pStart[gesture.Length - 1];
+        state.BestEnd = now;
+    }
+
+    state.Alive = alive;
+}
+
+void GestureRecognizer::ReportMatch(UINT templateIndex, UINT bodyIndex, _Inout_ ColumnState& state)
+{
+    GestureMatch match;
+    match.TemplateIndex = templateIndex;
+    match.BodyIndex = bodyIndex;
+    match.TrackingId = _trackingId[bodyIndex];
+    match.StartFrame = state.BestStart;
+    match.EndFrame = state.BestEnd;
+    match.Cost = state.BestCost * _templates[templateIndex].CostScale;
+
+    _matches.push_back(match);
+}
+
+void GestureRecognizer::Update(_In_ const BodyFrameData& frame)
+{
+    _matches.clear();
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        UINT64 trackingId = frame.IsTracked[bodyIndex] ? frame.TrackingId[bodyIndex] : 0;
+        if (trackingId != _trackingId[bodyIndex])
+        {
+            ResetBody(bodyIndex);
+            _trackingId[bodyIndex] = trackingId;
+        }
+
+        if (0 == trackingId)
+        {
+            continue;
+        }
+
+        XMFLOAT4 features[GESTURE_BONE_COUNT];
+        ComputeGestureFeatures(frame, bodyIndex, features);
+
+        XMVECTOR query[GESTURE_BONE_COUNT];
+        for (UINT i = 0; i < GESTURE_BONE_COUNT; ++i)
+        {
+            query[i] = XMLoadFloat4(&features[i]);
+        }
+
+        for (UINT templateIndex = 0; templateIndex < _templates.size(); ++templateIndex)
+        {
+            UpdateColumn(templateIndex, bodyIndex, query);
+        }
+    }
+
+    ++_frame;
+}
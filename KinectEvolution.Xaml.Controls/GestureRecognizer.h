@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------
+// <copyright file="GestureRecognizer.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                // one feature per entry of BodyBones
+                static const UINT GESTURE_BONE_COUNT = BONE_COUNT;
+
+                // longest template kept, longer recordings are resampled
+                static const UINT MAX_GESTURE_FRAMES = 120;
+
+                struct GestureTemplateParameters
+                {
+                    UINT    BoneMask;       // bit i compares BodyBones[i]
+                    float   MaxCost;        // mean squared feature distance per bone and frame of a match
+                    float   BandFraction;   // Sakoe-Chiba radius as a fraction of the template length
+
+                    GestureTemplateParameters()
+                        : BoneMask((1u << GESTURE_BONE_COUNT) - 1)
+                        , MaxCost(0.1f)
+                        , BandFraction(0.25f)
+                    {
+                    }
+                };
+
+                struct GestureMatch
+                {
+                    UINT    TemplateIndex;
+                    UINT    BodyIndex;
+                    UINT64  TrackingId;
+                    UINT    StartFrame;     // in Update calls since the last Reset
+                    UINT    EndFrame;
+                    float   Cost;           // mean squared feature distance per bone and frame
+                };
+
+                // bone directions of one body in its own frame: x from the left to the right shoulder,
+                // y up the spine and z completing a right handed frame; zero for bones with an untracked end
+                void ComputeGestureFeatures(_In_ const BodyFrameData& frame, UINT bodyIndex, _Out_writes_(GESTURE_BONE_COUNT) XMFLOAT4* pFeatures);
+
+                // subsequence DTW (SPRING) of every tracked body against every template.
+                // one cumulative cost column per body and template is advanced each frame. a path is abandoned once
+                // it costs more than MaxCost for the template frames it covered plus the band, and a column without
+                // live paths is skipped while the frame's LB_Keogh bound against the template start is over that budget.
+                class GestureRecognizer
+                {
+                public:
+                    GestureRecognizer();
+
+                    void Reset();
+
+                    // template from consecutive frames of one body, returns its index
+                    UINT AddTemplate(
+                        _In_reads_(frameCount) const BodyFrameData* pFrames,
+                        UINT frameCount,
+                        UINT bodyIndex,
+                        _In_ const GestureTemplateParameters& parameters);
+
+                    UINT GetTemplateCount() const { return static_cast<UINT>(_templates.size()); }
+
+                    // drops every template, indices start from zero again
+                    void ClearTemplates();
+
+                    // matches completed by this frame are returned by GetMatches
+                    void Update(_In_ const BodyFrameData& frame);
+
+                    const std::vector<GestureMatch>& GetMatches() const { return _matches; }
+
+                    // columns advanced and skipped by the lower bound since the last Reset
+                    UINT64 GetUpdatedColumns() const { return _updatedColumns; }
+                    UINT64 GetSkippedColumns() const { return _skippedColumns; }
+
+                private:
+                    struct GestureTemplate
+                    {
+                        UINT                    Length;
+                        UINT                    Band;
+                        float                   Threshold;          // on the summed cost
+                        float                   FrameBudget;        // summed cost allowed per template frame
+                        float                   CostScale;          // summed cost to mean per bone and frame
+                        std::vector<UINT>       Bones;
+                        std::vector<XMFLOAT4>   Features;           // Length x GESTURE_BONE_COUNT
+
+                        // envelope of the frames a path starting now can reach first
+                        XMFLOAT4                StartLower[GESTURE_BONE_COUNT];
+                        XMFLOAT4                StartUpper[GESTURE_BONE_COUNT];
+                    };
+
+                    // SPRING state of one body against one template
+                    struct ColumnState
+                    {
+                        std::vector<float>      Cost;
+                        std::vector<UINT>       Start;
+                        BOOL                    Alive;
+
+                        float                   BestCost;
+                        UINT                    BestStart;
+                        UINT                    BestEnd;
+                    };
+
+                    void ResetColumn(_Inout_ ColumnState& state);
+
+                    // flushes the pending matches of the body before clearing its columns
+                    void ResetBody(UINT bodyIndex);
+                    void ReportMatch(UINT templateIndex, UINT bodyIndex, _Inout_ ColumnState& state);
+
+                    // most a path may cost at a template frame
+                    static float GetBudget(_In_ const GestureTemplate& gesture, UINT index)
+                    {
+                        return min(gesture.Threshold, gesture.FrameBudget * static_cast<float>(index + 1 + gesture.Band));
+                    }
+
+                    float StartLowerBound(_In_ const GestureTemplate& gesture, _In_reads_(GESTURE_BONE_COUNT) const XMVECTOR* pQuery) const;
+                    void UpdateColumn(UINT templateIndex, UINT bodyIndex, _In_reads_(GESTURE_BONE_COUNT) const XMVECTOR* pQuery);
+
+                private:
+                    std::vector<GestureTemplate>    _templates;
+                    std::vector<ColumnState>        _columns;   // BODY_COUNT per template
+
+                    UINT64                          _trackingId[BODY_COUNT];
+                    UINT                            _frame;
+
+                    std::vector<GestureMatch>       _matches;
+                    UINT64                          _updatedColumns;
+                    UINT64                          _skippedColumns;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,186 @@
+//------------------------------------------------------------------------------
+// <copyright file="InfraredFrameProcessor.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "InfraredFrameProcessor.h"
+
+using namespace KinectEvolution::Xaml::Controls::Infrared;
+
+using namespace Concurrency;
+using namespace Windows::Storage::Streams;
+using namespace WindowsPreview::Kinect;
+
+// one processor per source, held weakly so it goes away with its last view
+static critical_section             g_processorsLock;
+static std::vector<Platform::WeakReference> g_processors;
+
+InfraredFrameProcessor^ InfraredFrameProcessor::GetForSource(_In_ InfraredFrameSource^ source)
+{
+    if (nullptr == source)
+    {
+        return nullptr;
+    }
+
+    critical_section::scoped_lock lock(g_processorsLock);
+
+    InfraredFrameProcessor^ processor = nullptr;
+    for (auto it = g_processors.begin(); it != g_processors.end();)
+    {
+        InfraredFrameProcessor^ existing = it->Resolve<InfraredFrameProcessor>();
+        if (nullptr == existing)
+        {
+            it = g_processors.erase(it);
+            continue;
+        }
+
+        if (existing->Source == source)
+        {
+            processor = existing;
+        }
+
+        ++it;
+    }
+
+    if (nullptr == processor)
+    {
+        processor = ref new InfraredFrameProcessor(source);
+        g_processors.push_back(Platform::WeakReference(processor));
+    }
+
+    return processor;
+}
+
+InfraredFrameProcessor::InfraredFrameProcessor()
+    : _subscribers(0)
+    , _image(FRAME_WIDTH * FRAME_HEIGHT)
+    , _frameNumber(0)
+{
+}
+
+InfraredFrameProcessor::InfraredFrameProcessor(_In_ InfraredFrameSource^ source)
+    : _source(source)
+    , _subscribers(0)
+    , _image(FRAME_WIDTH * FRAME_HEIGHT)
+    , _frameNumber(0)
+{
+    _reader = _source->OpenReader();
+    _reader->IsPaused = true;
+}
+
+InfraredFrameProcessor::~InfraredFrameProcessor()
+{
+    // close the reader
+    _reader = nullptr;
+}
+
+void InfraredFrameProcessor::Subscribe()
+{
+    critical_section::scoped_lock lock(_processingLock);
+
+    if (0 == _subscribers++ && nullptr != _reader)
+    {
+        _reader->IsPaused = false;
+    }
+}
+
+void InfraredFrameProcessor::Unsubscribe()
+{
+    critical_section::scoped_lock lock(_processingLock);
+
+    if (0 == _subscribers)
+    {
+        return;
+    }
+
+    if (0 == --_subscribers && nullptr != _reader)
+    {
+        _reader->IsPaused = true;
+    }
+}
+
+UINT64 InfraredFrameProcessor::Update()
+{
+    critical_section::scoped_lock lock(_processingLock);
+
+    // the first view to poll after a sensor frame does the work, the rest see the new frame number
+    if (nullptr != _reader && _subscribers > 0)
+    {
+        InfraredFrame^ frame = _reader->AcquireLatestFrame();
+        if (nullptr != frame)
+        {
+            OnInfraredFrame(frame);
+        }
+    }
+
+    return _frameNumber;
+}
+
+// called with _processingLock held
+void InfraredFrameProcessor::OnInfraredFrame(_In_ InfraredFrame^ frame)
+{
+    UINT length = frame->FrameDescription->LengthInPixels * frame->FrameDescription->BytesPerPixel;
+
+    IBuffer^ buffer = frame->LockImageBuffer();
+    UINT16* pSrc = reinterpret_cast<UINT16*>(DX::GetPointerToPixelData(buffer));
+
+    ToneMapFrame(length, pSrc);
+}
+
+BOOL InfraredFrameProcessor::ProcessFrame(UINT length, _In_reads_bytes_(length) const UINT16* pFrameData)
+{
+    critical_section::scoped_lock lock(_processingLock);
+
+    return ToneMapFrame(length, pFrameData);
+}
+
+BOOL InfraredFrameProcessor::ToneMapFrame(UINT length, _In_reads_bytes_(length) const UINT16* pFrameData)
+{
+    if (nullptr == pFrameData || length < FRAME_WIDTH * FRAME_HEIGHT * sizeof(UINT16))
+    {
+        return FALSE;
+    }
+
+    _toneMapper.Process(pFrameData, FRAME_WIDTH, FRAME_HEIGHT, &_image[0], FRAME_WIDTH);
+    ++_frameNumber;
+
+    return TRUE;
+}
+
+void InfraredFrameProcessor::SetToneParameters(_In_ const InfraredToneParameters& parameters)
+{
+    critical_section::scoped_lock lock(_processingLock);
+
+    _toneMapper.SetParameters(parameters);
+}
+
+InfraredToneParameters InfraredFrameProcessor::GetToneParameters()
+{
+    critical_section::scoped_lock lock(_processingLock);
+
+    return _toneMapper.GetParameters();
+}
+
+UINT64 InfraredFrameProcessor::FrameNumber::get()
+{
+    // 64-bit, so not read in one access on x86
+    critical_section::scoped_lock lock(_processingLock);
+
+    return _frameNumber;
+}
+
+const BYTE* InfraredFrameProcessor::LockImage(_Out_ UINT64* pFrameNumber)
+{
+    _processingLock.lock();
+
+    *pFrameNumber = _frameNumber;
+
+    return (_frameNumber > 0) ? &_image[0] : nullptr;
+}
+
+void InfraredFrameProcessor::UnlockImage()
+{
+    _processingLock.unlock();
+}
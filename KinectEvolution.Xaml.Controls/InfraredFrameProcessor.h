@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+// <copyright file="InfraredFrameProcessor.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "InfraredToneMapper.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Infrared {
+
+                struct InfraredImageLock;
+
+                // reads and tone maps IR frames once per sensor frame for every view of a source
+                ref class InfraredFrameProcessor sealed
+                {
+                internal:
+                    // returns the processor shared by all views of the source, creating it if needed
+                    static InfraredFrameProcessor^ GetForSource(_In_ WRK::InfraredFrameSource^ source);
+
+                    // not bound to a sensor, frames come from ProcessFrame
+                    InfraredFrameProcessor();
+
+                    // views hold a subscription while they display the image; the reader pauses with none
+                    void Subscribe();
+                    void Unsubscribe();
+
+                    // polls the reader and processes a new frame if there is one, returns the frame number
+                    UINT64 Update();
+
+                    // tone maps a frame supplied by the caller, length is in bytes
+                    BOOL ProcessFrame(UINT length, _In_reads_bytes_(length) const UINT16* pFrameData);
+
+                    void SetToneParameters(_In_ const InfraredToneParameters& parameters);
+                    InfraredToneParameters GetToneParameters();
+
+                    property WRK::InfraredFrameSource^ Source { WRK::InfraredFrameSource^ get() { return _source; } }
+
+                    // incremented for every processed frame, 0 until the first one
+                    property UINT64 FrameNumber { UINT64 get(); }
+
+                    static const UINT FRAME_WIDTH = 512;
+                    static const UINT FRAME_HEIGHT = 424;
+
+                protected private:
+                    friend struct InfraredImageLock;
+
+                    const BYTE* LockImage(_Out_ UINT64* pFrameNumber);
+                    void UnlockImage();
+
+                private:
+                    InfraredFrameProcessor(_In_ WRK::InfraredFrameSource^ source);
+                    ~InfraredFrameProcessor();
+
+                    void OnInfraredFrame(_In_ WRK::InfraredFrame^ frame);
+                    BOOL ToneMapFrame(UINT length, _In_reads_bytes_(length) const UINT16* pFrameData);
+
+                private:
+                    WRK::InfraredFrameSource^       _source;
+                    WRK::InfraredFrameReader^       _reader;
+                    UINT                            _subscribers;
+
+                    // guards the tone mapper, the image and the frame number
+                    Concurrency::critical_section   _processingLock;
+
+                    InfraredToneMapper              _toneMapper;
+                    std::vector<BYTE>               _image;
+                    UINT64                          _frameNumber;
+                };
+
+                // read access to the 8-bit image of an InfraredFrameProcessor
+                struct InfraredImageLock
+                {
+                private:
+                    InfraredFrameProcessor^     _processor;
+                    const BYTE*                 _pImage;
+                    UINT64                      _frameNumber;
+
+                public:
+                    InfraredImageLock(_In_ InfraredFrameProcessor^ processor)
+                        : _processor(processor)
+                        , _pImage(nullptr)
+                        , _frameNumber(0)
+                    {
+                        if (nullptr != _processor)
+                        {
+                            _pImage = _processor->LockImage(&_frameNumber);
+                        }
+                    }
+
+                    ~InfraredImageLock()
+                    {
+                        if (nullptr != _processor)
+                        {
+                            _processor->UnlockImage();
+                        }
+                    }
+
+                    // FRAME_WIDTH x FRAME_HEIGHT bytes, nullptr before the first frame
+                    const BYTE* AccessImage(_Out_ UINT64& frameNumber) const
+                    {
+                        frameNumber = _frameNumber;
+
+                        return _pImage;
+                    }
+                };
+
+            }
+        }
+    }
+}
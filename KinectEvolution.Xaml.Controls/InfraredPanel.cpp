@@ -24,6 +24,7 @@ using namespace WindowsPreview::Kinect;
 
 InfraredPanel::InfraredPanel()
     : Panel()
+    , _overlay(Skeleton::Body2DMode::DepthIR)
 {
     critical_section::scoped_lock lock(_criticalSection);
 
@@ -34,6 +35,11 @@ InfraredPanel::InfraredPanel()
 InfraredPanel::~InfraredPanel()
 {
     Stop();
+
+    if (nullptr != _irProcessor)
+    {
+        _irProcessor->Unsubscribe();
+    }
 }
 
 void InfraredPanel::StartRenderLoop()
@@ -56,12 +62,20 @@ void InfraredPanel::InfraredSource::set(InfraredFrameSource^ value)
         return;
     }
 
-    // close the previous reader
-    _frameReader = nullptr;
+    // release the previous processor
+    if (nullptr != _irProcessor)
+    {
+        _irProcessor->Unsubscribe();
+        _irProcessor = nullptr;
+    }
 
-    // set the new source
+    // set the new source, frames are shared with every other view of it
     _frameSource = value;
-    _frameReader = _frameSource->OpenReader();
+    if (nullptr != _frameSource)
+    {
+        _irProcessor = InfraredFrameProcessor::GetForSource(_frameSource);
+        _irProcessor->Subscribe();
+    }
 
     NotifyPropertyChanged("InfraredSource");
 }
@@ -71,69 +85,67 @@ InfraredFrameSource^ InfraredPanel::InfraredSource::get()
     return _frameSource;
 }
 
-void InfraredPanel::NotifyPropertyChanged(Platform::String^ prop)
+void InfraredPanel::BodySource::set(BodyFrameSource^ value)
 {
-    PropertyChangedEventArgs^ args = ref new PropertyChangedEventArgs(prop);
-    PropertyChanged(this, args);
-}
+    critical_section::scoped_lock lock(_criticalSection);
 
-void InfraredPanel::Update(double elapsedTime)
-{
-    if (nullptr != _frameReader)
+    if (_overlay.GetBodySource() == value)
     {
-        InfraredFrame^ frame = _frameReader->AcquireLatestFrame();
-        if (nullptr != frame)
-        {
-            OnInfraredFrame(frame);
-        }
+        return;
     }
+
+    _overlay.SetBodySource(value);
+
+    NotifyPropertyChanged("BodySource");
 }
 
-void InfraredPanel::Render()
+BodyFrameSource^ InfraredPanel::BodySource::get()
+{
+    return _overlay.GetBodySource();
+}
+
+void InfraredPanel::CoordinateMapper::set(WRK::CoordinateMapper^ value)
 {
-    if (!IsLoadingComplete())
+    critical_section::scoped_lock lock(_criticalSection);
+
+    if (_overlay.GetCoordinateMapper() == value)
     {
         return;
     }
 
-    // Set render target to the texture.
-    BeginRender(_rampRTV.Get(), _rampDSV.Get(), nullptr);
-
-    // Create and set viewport.
-    const D3D11_VIEWPORT txtView = CD3D11_VIEWPORT(0.0f, 0.0f, static_cast<float>(IR_FRAME_WIDTH), static_cast<float>(IR_FRAME_HEIGHT));
-
-    _d3dContext->RSSetViewports(1, &txtView);
+    _overlay.SetCoordinateMapper(value);
 
-    {
-        // lock texture(s)
-        RenderLock irRampLock(_irRampTexture);
-        RenderLock irLock(_irTexture);
-
-        // do the conversion on GPU
-        RampEffect::RampParameter param
-            = { XMVectorZero(), 1.0f, 0.0f, FLT_MAX, static_cast<float>(max(_irRampTexture->Width, _irRampTexture->Height)) };
+    NotifyPropertyChanged("CoordinateMapper");
+}
 
-        // apply ramp conversion effect
-        if (!_rampEffect->Apply(_d3dContext.Get(), _irTexture->TextureSRV, _irRampTexture->TextureSRV, &param))
-        {
-            return;
-        }
+WRK::CoordinateMapper^ InfraredPanel::CoordinateMapper::get()
+{
+    return _overlay.GetCoordinateMapper();
+}
 
-        // Set primitive topology
-        _d3dContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+void InfraredPanel::NotifyPropertyChanged(Platform::String^ prop)
+{
+    PropertyChangedEventArgs^ args = ref new PropertyChangedEventArgs(prop);
+    PropertyChanged(this, args);
+}
 
-        // Draw the scene
-        _d3dContext->Draw(1, 0);
+void InfraredPanel::Update(double elapsedTime)
+{
+    if (nullptr != _irProcessor && nullptr != _irRenderer)
+    {
+        _irProcessor->Update();
+        _irRenderer->UpdateFrameImage(_d3dContext.Get(), _irProcessor);
     }
 
-    // reset what we did
-    ID3D11Buffer* buffer = nullptr;
-    _d3dContext->GSSetConstantBuffers(0, 1, &buffer);
-    _d3dContext->PSSetConstantBuffers(0, 1, &buffer);
-
-    ID3D11ShaderResourceView* nullSRV = nullptr;
-    _d3dContext->PSSetShaderResources(0, 1, &nullSRV);
+    _overlay.Update();
+}
 
+void InfraredPanel::Render()
+{
+    if (!IsLoadingComplete() || nullptr == _irRenderer)
+    {
+        return;
+    }
 
     // Render texture to the back buffer for correct aspect ratio and size for control
     BeginRender(nullptr, nullptr, nullptr);
@@ -143,49 +155,29 @@ void InfraredPanel::Render()
 
     {
         // lock texture(s)
-        RenderLock lock(_irTargetFrame);
+        RenderLock lock(_irRenderer->InfraredImage);
 
-        RenderTexture(_irTargetFrame);
+        RenderTexture(_irRenderer->InfraredImage);
     }
 
+    _overlay.Render(_d2dContext.Get(), _width, _height);
+
     EndRender();
 
 }
 
-void InfraredPanel::OnInfraredFrame(_In_ InfraredFrame^ frame)
+void InfraredPanel::ResetDeviceResources()
 {
-    if (nullptr == frame)
-    {
-        return;
-    }
-
-    UINT length = frame->FrameDescription->LengthInPixels;
+    Panel::ResetDeviceResources();
 
-    IBuffer^ buffer = frame->LockImageBuffer();
-    UINT16* pSrc = reinterpret_cast<UINT16*>(DX::GetPointerToPixelData(buffer));
+    _overlay.ResetDeviceResources();
 
-    UINT rowPitch = 0;
+    if (nullptr != _irRenderer)
     {
-        TextureLock lock(_irTexture, _d3dContext.Get());
-        UINT16* pDest = static_cast<UINT16*>(lock.AccessBuffer(rowPitch));
-        if (nullptr != pDest)
-        {
-            memcpy(pDest, pSrc, length);
-        }
+        _irRenderer->Reset();
     }
-}
-
-void InfraredPanel::ResetDeviceResources()
-{
-    Panel::ResetDeviceResources();
-
-    _rampRTV.ReleaseAndGetAddressOf();
-    _rampDSV.ReleaseAndGetAddressOf();
 
-    _rampEffect = nullptr;
-    _irTargetFrame = nullptr;
-    _irTexture = nullptr;
-    _irRampTexture = nullptr;
+    _irRenderer = nullptr;
 
     Render(); // render one frame to force resize
 }
@@ -194,65 +186,10 @@ void InfraredPanel::CreateDeviceResources()
 {
     Panel::CreateDeviceResources();
 
-    _rampEffect = ref new RampEffect();
-    _rampEffect->Initialize(_d3dDevice.Get());
-
-    // if everything is loaded, then we can create the texture
-    _irTexture = ref new Texture();
-    _irTexture->Initialize(_d3dDevice.Get(), IR_FRAME_WIDTH, IR_FRAME_HEIGHT, DXGI_FORMAT_R16_UNORM, FALSE);
-
-    // grey scale ramp to use for shader
-    _irRampTexture = ref new Texture();
-    _irRampTexture->Initialize(_d3dDevice.Get(), IR_FRAME_WIDTH, 1, DXGI_FORMAT_R8G8B8A8_UNORM, FALSE);
-
-    UINT rowPitch = 0;
-    {
-        TextureLock lock(_irRampTexture, _d3dContext.Get());
-        UINT16* pRamp = static_cast<UINT16*>(lock.AccessBuffer(rowPitch));
-        if (nullptr != pRamp)
-        {
-            for (UINT i = 0; i < IR_FRAME_WIDTH; ++i)
-            {
-                float value = min(1, 1.0f * powf(static_cast<float>(i) / 511, 0.32f));
-                UINT greyLevel = static_cast<UINT>(value * 255);
-                *pRamp++ = 0xFF000000 | (greyLevel << 16) | (greyLevel << 8) | greyLevel;
-            }
-        }
-    }
-
-    // render target creation
-    _irTargetFrame = ref new Texture();
-    _irTargetFrame->Initialize(
-        _d3dDevice.Get(),
-        IR_FRAME_WIDTH, IR_FRAME_HEIGHT,
-        DXGI_FORMAT_R8G8B8A8_UNORM, TRUE);
-
-    DX::ThrowIfFailed(
-        _d3dDevice->CreateRenderTargetView(_irTargetFrame->Texture2D, nullptr, &_rampRTV)
-        );
-
-    // Create depth/stencil buffer descriptor.
-    CD3D11_TEXTURE2D_DESC depthStencilDesc(
-        DXGI_FORMAT_D24_UNORM_S8_UINT,
-        static_cast<UINT>(IR_FRAME_WIDTH),
-        static_cast<UINT>(IR_FRAME_HEIGHT),
-        1,
-        1,
-        D3D11_BIND_DEPTH_STENCIL);
-
-    // Allocate a 2-D surface as the depth/stencil buffer.
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> depthStencil;
-    DX::ThrowIfFailed(
-        _d3dDevice->CreateTexture2D(&depthStencilDesc, nullptr, &depthStencil)
-        );
-
-    // Create depth/stencil view based on depth/stencil buffer.
-    const CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc
-        = CD3D11_DEPTH_STENCIL_VIEW_DESC(D3D11_DSV_DIMENSION_TEXTURE2D);
-    DX::ThrowIfFailed(
-        _d3dDevice->CreateDepthStencilView(depthStencil.Get(), &depthStencilViewDesc, &_rampDSV)
-        );
+    _irRenderer = ref new DepthMap::InfraredRenderer();
+    _irRenderer->Initialize(_d3dDevice.Get(), _d3dContext.Get());
 
+    _overlay.CreateDeviceResources(_d2dContext.Get());
 }
 
 void InfraredPanel::CreateSizeDependentResources()
@@ -6,7 +6,8 @@
 
 #pragma once
 #include "Panel.h"
-#include "RampEffect.h"
+#include "SkeletonOverlay.h"
+#include "InfraredRenderer.h"
 
 namespace KinectEvolution {
     namespace Xaml {
@@ -29,6 +30,20 @@ namespace KinectEvolution {
                         void set(WRK::InfraredFrameSource^ value);
                     }
 
+                    // bodies drawn over the image
+                    property WRK::BodyFrameSource^ BodySource
+                    {
+                        WRK::BodyFrameSource^ get();
+                        void set(WRK::BodyFrameSource^ value);
+                    }
+
+                    // places the bodies on the image, without one they are placed with a typical sensor's camera
+                    property WRK::CoordinateMapper^ CoordinateMapper
+                    {
+                        WRK::CoordinateMapper^ get();
+                        void set(WRK::CoordinateMapper^ value);
+                    }
+
                 protected private:
                     virtual event Windows::UI::Xaml::Data::PropertyChangedEventHandler^ PropertyChanged;
                     void NotifyPropertyChanged(Platform::String^ prop);
@@ -45,28 +60,12 @@ namespace KinectEvolution {
                     virtual void StopRenderLoop() override;
 
                 private:
-                    void OnInfraredFrame(_In_ WRK::InfraredFrame^ frame);
-
-                private:
-                    const UINT IR_FRAME_WIDTH = 512;
-                    const UINT IR_FRAME_HEIGHT = 424;
-
-                    // render target view for first stage
-                    Microsoft::WRL::ComPtr<ID3D11RenderTargetView>      _rampRTV;
-                    Microsoft::WRL::ComPtr<ID3D11DepthStencilView>      _rampDSV;
-
-                    // shader effect
-                    RampEffect^                                         _rampEffect;
-
-                    // texture resources for Kinect frame and ramp
-                    Texture^                                            _irTexture;
-                    Texture^                                            _irRampTexture;
-
-                    // final output rendered IR image
-                    Texture^                                            _irTargetFrame;
+                    // output IR image for this panel's device
+                    DepthMap::InfraredRenderer^                         _irRenderer;
 
                     WRK::InfraredFrameSource^                           _frameSource;
-                    WRK::InfraredFrameReader^                           _frameReader;
+                    InfraredFrameProcessor^                             _irProcessor;
+                    Skeleton::SkeletonOverlay                           _overlay;
 
                 };
 
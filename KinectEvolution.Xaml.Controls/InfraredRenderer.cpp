@@ -10,8 +10,10 @@
 
 using namespace KinectEvolution::Xaml::Controls::Base;
 using namespace KinectEvolution::Xaml::Controls::DepthMap;
+using namespace KinectEvolution::Xaml::Controls::Infrared;
 
 InfraredRenderer::InfraredRenderer()
+    : _uploadedFrameNumber(0)
 {
 }
 
@@ -21,144 +23,56 @@ InfraredRenderer::~InfraredRenderer()
 
 void InfraredRenderer::Reset()
 {
-    _rampRTV.ReleaseAndGetAddressOf();
-    _rampDSV.ReleaseAndGetAddressOf();
-
-    _rampEffect = nullptr;
-    _irTexture = nullptr;
-    _irRampTexture = nullptr;
     _irTargetFrame = nullptr;
+
+    _uploadedProcessor = nullptr;
+    _uploadedFrameNumber = 0;
 }
 
 void InfraredRenderer::Initialize(_In_ ID3D11Device1* pD3DDevice, _In_ ID3D11DeviceContext1* pD3DContext)
 {
-    _rampEffect = ref new RampEffect();
-    _rampEffect->Initialize(pD3DDevice);
-
-    // if everything is loaded, then we can create the texture
-    _irTexture = ref new Texture();
-    _irTexture->Initialize(pD3DDevice, IR_FRAME_WIDTH, IR_FRAME_HEIGHT, DXGI_FORMAT_R16_UNORM, FALSE);
-
-    // grey scale ramp to use for shader
-    _irRampTexture = ref new Texture();
-    _irRampTexture->Initialize(pD3DDevice, IR_FRAME_WIDTH, 1, DXGI_FORMAT_R8G8B8A8_UNORM, FALSE);
-
-    UINT rowPitch = 0;
-    {
-        TextureLock lock(_irRampTexture, pD3DContext);
-        UINT* pRamp = static_cast<UINT*>(lock.AccessBuffer(rowPitch));
-        if (nullptr != pRamp)
-        {
-            for (UINT i = 0; i < IR_FRAME_WIDTH; ++i)
-            {
-                float value = min(1, 1.0f * powf(static_cast<float>(i) / 511, 0.32f));
-                UINT greyLevel = static_cast<UINT>(value * 255);
-                *pRamp++ = 0xFF000000 | (greyLevel << 16) | (greyLevel << 8) | greyLevel;
-            }
-        }
-    }
+    UNREFERENCED_PARAMETER(pD3DContext);
 
-    // render target creation
+    // processed frames are written straight into the display texture
     _irTargetFrame = ref new Texture();
-    _irTargetFrame->Initialize(pD3DDevice, IR_FRAME_WIDTH, IR_FRAME_HEIGHT, DXGI_FORMAT_R8G8B8A8_UNORM, TRUE);
+    _irTargetFrame->Initialize(
+        pD3DDevice,
+        InfraredFrameProcessor::FRAME_WIDTH, InfraredFrameProcessor::FRAME_HEIGHT,
+        DXGI_FORMAT_R8G8B8A8_UNORM, FALSE);
 
-    DX::ThrowIfFailed(
-        pD3DDevice->CreateRenderTargetView(_irTargetFrame->Texture2D, nullptr, &_rampRTV)
-        );
-
-    // Create depth/stencil buffer descriptor.
-    CD3D11_TEXTURE2D_DESC depthStencilDesc(
-        DXGI_FORMAT_D24_UNORM_S8_UINT,
-        static_cast<UINT>(IR_FRAME_WIDTH),
-        static_cast<UINT>(IR_FRAME_HEIGHT),
-        1,
-        1,
-        D3D11_BIND_DEPTH_STENCIL);
-
-    // Allocate a 2-D surface as the depth/stencil buffer.
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> depthStencil;
-    DX::ThrowIfFailed(
-        pD3DDevice->CreateTexture2D(&depthStencilDesc, nullptr, &depthStencil)
-        );
-
-    // Create depth/stencil view based on depth/stencil buffer.
-    const CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc
-        = CD3D11_DEPTH_STENCIL_VIEW_DESC(D3D11_DSV_DIMENSION_TEXTURE2D);
-    DX::ThrowIfFailed(
-        pD3DDevice->CreateDepthStencilView(depthStencil.Get(), &depthStencilViewDesc, &_rampDSV)
-        );
+    _uploadedProcessor = nullptr;
+    _uploadedFrameNumber = 0;
 }
 
-void InfraredRenderer::UpdateFrameImage(_In_ ID3D11DeviceContext1* pD3DContext, UINT length, _In_count_(length) UINT16* pFrameData)
+void InfraredRenderer::UpdateFrameImage(_In_ ID3D11DeviceContext1* pD3DContext, _In_ InfraredFrameProcessor^ processor)
 {
-    UINT rowPitch = 0;
+    if (nullptr == processor || nullptr == _irTargetFrame)
     {
-        TextureLock lock(_irTexture, pD3DContext);
-        BYTE* pDest = static_cast<BYTE*>(lock.AccessBuffer(rowPitch));
-        if (nullptr != pDest)
-        {
-            memcpy(pDest, pFrameData, length);
-        }
+        return;
     }
-}
 
-void InfraredRenderer::Render(_In_ ID3D11DeviceContext1* pD3DContext)
-{
-    Microsoft::WRL::ComPtr<ID3D11RenderTargetView> tempRTV;
-    Microsoft::WRL::ComPtr<ID3D11DepthStencilView> tempDSV;
-
-    UINT numViewport = 1;
-    D3D11_VIEWPORT vp;
-
-    // get current render target
-    pD3DContext->OMGetRenderTargets(1, &tempRTV, &tempDSV);
-    pD3DContext->RSGetViewports(&numViewport, &vp);
-
-    // set the render target
-    pD3DContext->OMSetRenderTargets(1, _rampRTV.GetAddressOf(), _rampDSV.Get());
-
-    // Clear the back buffer
-    float ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
-    pD3DContext->ClearRenderTargetView(_rampRTV.Get(), ClearColor);
-
-    // Clear the depth buffer to 1.0 (max depth)
-    pD3DContext->ClearDepthStencilView(_rampDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-
-    // Create and set viewport.
-    const D3D11_VIEWPORT txView = CD3D11_VIEWPORT(0.0f, 0.0f, static_cast<float>(IR_FRAME_WIDTH), static_cast<float>(IR_FRAME_HEIGHT));
-
-    pD3DContext->RSSetViewports(1, &txView);
+    InfraredImageLock imageLock(processor);
 
+    UINT64 frameNumber = 0;
+    const BYTE* pImage = imageLock.AccessImage(frameNumber);
+    if (nullptr == pImage || (processor == _uploadedProcessor && frameNumber == _uploadedFrameNumber))
     {
-        // lock texture(s)
-        RenderLock irLock(_irTexture);
-        RenderLock irRamplock(_irRampTexture);
-
-        // apply ramp shader
-        RampEffect::RampParameter param
-            = { XMVectorZero(), 1.0f, 0.0f, FLT_MAX, static_cast<float>(max(_irRampTexture->Width, _irRampTexture->Height)) };
+        return;
+    }
 
-        if (!_rampEffect->Apply(pD3DContext, _irTexture->TextureSRV, _irRampTexture->TextureSRV, &param))
+    UINT rowPitch = 0;
+    {
+        TextureLock lock(_irTargetFrame, pD3DContext);
+        UINT* pDest = static_cast<UINT*>(lock.AccessBuffer(rowPitch));
+        if (nullptr != pDest)
         {
-            return;
-        }
-
-        // Set primitive topology
-        pD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+            InfraredToneMapper::ExpandToRGBA(
+                pImage, InfraredFrameProcessor::FRAME_WIDTH,
+                InfraredFrameProcessor::FRAME_WIDTH, InfraredFrameProcessor::FRAME_HEIGHT,
+                pDest, rowPitch);
 
-        // Draw to the texture
-        pD3DContext->Draw(1, 0);
+            _uploadedProcessor = processor;
+            _uploadedFrameNumber = frameNumber;
+        }
     }
-
-    // reset what we did
-    ID3D11Buffer* buffer = nullptr;
-    pD3DContext->GSSetConstantBuffers(0, 1, &buffer);
-    pD3DContext->PSSetConstantBuffers(0, 1, &buffer);
-
-    ID3D11ShaderResourceView* nullSRV = nullptr;
-    pD3DContext->PSSetShaderResources(0, 1, &nullSRV);
-
-    // restore previous target
-    pD3DContext->OMSetRenderTargets(1, tempRTV.GetAddressOf(), tempDSV.Get());
-    pD3DContext->RSSetViewports(numViewport, &vp);
 }
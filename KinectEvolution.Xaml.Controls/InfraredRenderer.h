@@ -6,7 +6,7 @@
 
 #pragma once
 
-#include "RampEffect.h"
+#include "InfraredFrameProcessor.h"
 #include "Texture.h"
 
 namespace KinectEvolution {
@@ -26,9 +26,8 @@ namespace KinectEvolution {
 
                     void Reset();
 
-                    void UpdateFrameImage(_In_ ID3D11DeviceContext1* pD3DContext, UINT length, _In_count_(length) UINT16* pFrameData);
-
-                    void Render(_In_ ID3D11DeviceContext1* pD3DContext);
+                    // uploads the processor image to InfraredImage if it changed since the last call
+                    void UpdateFrameImage(_In_ ID3D11DeviceContext1* pD3DContext, _In_ Infrared::InfraredFrameProcessor^ processor);
 
                     property Texture^ InfraredImage { Texture^ get() { return _irTargetFrame; } }
 
@@ -36,22 +35,12 @@ namespace KinectEvolution {
                     ~InfraredRenderer();
 
                 private:
-                    const UINT IR_FRAME_WIDTH = 512;
-                    const UINT IR_FRAME_HEIGHT = 424;
-
-                    // render target view for first stage
-                    Microsoft::WRL::ComPtr<ID3D11RenderTargetView>  _rampRTV;
-                    Microsoft::WRL::ComPtr<ID3D11DepthStencilView>  _rampDSV;
-
-                    // shader effect
-                    RampEffect^            _rampEffect;
-
-                    // texture resources for Kinect frame and ramp
-                    Texture^               _irTexture;
-                    Texture^               _irRampTexture;
+                    // last processor frame copied to the texture
+                    Infrared::InfraredFrameProcessor^   _uploadedProcessor;
+                    UINT64                              _uploadedFrameNumber;
 
-                    // final output rendered IR image
-                    Texture^               _irTargetFrame;
+                    // final output IR image
+                    Texture^                            _irTargetFrame;
 
                 };
 
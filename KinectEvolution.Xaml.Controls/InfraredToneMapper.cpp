@@ -0,0 +1,515 @@
+//------------------------------------------------------------------------------
+// <copyright file="InfraredToneMapper.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "InfraredToneMapper.h"
+
+using namespace KinectEvolution::Xaml::Controls::Infrared;
+
+// resolution of the gamma curve used to fill the tone table
+static const UINT TONE_CURVE_LENGTH = 1024;
+
+// smallest black to white distance, keeps a dark empty scene from amplifying sensor noise
+static const float MIN_EXPOSURE_RANGE = 512.0f;
+
+InfraredToneMapper::InfraredToneMapper()
+    : _histogram(HISTOGRAM_LANES * HISTOGRAM_BINS)
+    , _sampleCount(0)
+    , _toneTable(TONE_TABLE_SIZE)
+    , _tileTables(CLAHE_TILES_X * CLAHE_TILES_Y * 256)
+    , _claheQuads(CLAHE_TILES_X * CLAHE_TILES_Y * 256)
+{
+    Reset();
+}
+
+void InfraredToneMapper::Reset()
+{
+    _exposureValid = FALSE;
+    _blackPoint = 0.0f;
+    _whitePoint = 65535.0f;
+
+    _toneTableValid = FALSE;
+    _tableMode = InfraredToneMode::FixedRamp;
+    _tableBlack = 0;
+    _tableWhite = 0;
+    _tableGamma = 0.0f;
+    _toneTableBuilds = 0;
+}
+
+void InfraredToneMapper::SetParameters(_In_ const InfraredToneParameters& parameters)
+{
+    _parameters = parameters;
+
+    _parameters.BlackPercentile = min(max(_parameters.BlackPercentile, 0.0f), 1.0f);
+    _parameters.WhitePercentile = min(max(_parameters.WhitePercentile, _parameters.BlackPercentile), 1.0f);
+    _parameters.Smoothing = min(max(_parameters.Smoothing, 0.0f), 1.0f);
+    _parameters.Gamma = max(_parameters.Gamma, 0.01f);
+    _parameters.ClipLimit = max(_parameters.ClipLimit, 1.0f);
+}
+
+void InfraredToneMapper::Process(
+    _In_reads_(width * height) const UINT16* pFrame,
+    UINT width, UINT height,
+    _Out_writes_bytes_(outputPitch * height) BYTE* pOutput, UINT outputPitch)
+{
+    if (nullptr == pFrame || nullptr == pOutput || 0 == width || 0 == height || outputPitch < width)
+    {
+        return;
+    }
+
+    if (_parameters.Mode != InfraredToneMode::FixedRamp)
+    {
+        BuildHistogram(pFrame, width, height);
+        UpdateExposure();
+    }
+
+    UpdateToneTable();
+    ApplyToneTable(pFrame, width, height, pOutput, outputPitch);
+
+    if (_parameters.Mode == InfraredToneMode::Clahe)
+    {
+        ApplyClahe(width, height, pOutput, outputPitch);
+    }
+}
+
+void InfraredToneMapper::BuildHistogram(_In_reads_(width * height) const UINT16* pFrame, UINT width, UINT height)
+{
+    UINT* pLane0 = &_histogram[0];
+    UINT* pLane1 = pLane0 + HISTOGRAM_BINS;
+    UINT* pLane2 = pLane1 + HISTOGRAM_BINS;
+    UINT* pLane3 = pLane2 + HISTOGRAM_BINS;
+
+    memset(pLane0, 0, _histogram.size() * sizeof(UINT));
+
+    // sample every other pixel of every other row, exposure does not need the full frame
+    const UINT simdWidth = width & ~15u;
+    UINT samples = 0;
+
+    for (UINT y = 0; y < height; y += 2)
+    {
+        const UINT16* pRow = pFrame + y * width;
+
+        UINT x = 0;
+        for (; x < simdWidth; x += 16)
+        {
+            __m128i a = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x)), HISTOGRAM_SHIFT);
+            __m128i b = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x + 8)), HISTOGRAM_SHIFT);
+
+            ++pLane0[_mm_extract_epi16(a, 0)];
+            ++pLane1[_mm_extract_epi16(a, 2)];
+            ++pLane2[_mm_extract_epi16(a, 4)];
+            ++pLane3[_mm_extract_epi16(a, 6)];
+            ++pLane0[_mm_extract_epi16(b, 0)];
+            ++pLane1[_mm_extract_epi16(b, 2)];
+            ++pLane2[_mm_extract_epi16(b, 4)];
+            ++pLane3[_mm_extract_epi16(b, 6)];
+        }
+
+        samples += x / 2;
+
+        for (; x < width; x += 2)
+        {
+            ++pLane0[pRow[x] >> HISTOGRAM_SHIFT];
+            ++samples;
+        }
+    }
+
+    // fold the sub-histograms into the first lane
+    for (UINT i = 0; i < HISTOGRAM_BINS; ++i)
+    {
+        pLane0[i] += pLane1[i] + pLane2[i] + pLane3[i];
+    }
+
+    _sampleCount = samples;
+}
+
+void InfraredToneMapper::UpdateExposure()
+{
+    if (0 == _sampleCount)
+    {
+        return;
+    }
+
+    const UINT* pHistogram = &_histogram[0];
+
+    const UINT blackCount = static_cast<UINT>(_parameters.BlackPercentile * _sampleCount);
+    const UINT whiteCount = static_cast<UINT>(_parameters.WhitePercentile * _sampleCount);
+
+    UINT blackBin = 0;
+    UINT whiteBin = HISTOGRAM_BINS - 1;
+    UINT cumulative = 0;
+    BOOL blackFound = FALSE;
+
+    for (UINT i = 0; i < HISTOGRAM_BINS; ++i)
+    {
+        cumulative += pHistogram[i];
+
+        if (!blackFound && cumulative > blackCount)
+        {
+            blackBin = i;
+            blackFound = TRUE;
+        }
+
+        if (cumulative >= whiteCount)
+        {
+            whiteBin = i;
+            break;
+        }
+    }
+
+    float black = static_cast<float>(blackBin << HISTOGRAM_SHIFT);
+    float white = static_cast<float>((whiteBin + 1) << HISTOGRAM_SHIFT);
+
+    if (white - black < MIN_EXPOSURE_RANGE)
+    {
+        white = min(black + MIN_EXPOSURE_RANGE, 65535.0f);
+        black = white - MIN_EXPOSURE_RANGE;
+    }
+
+    if (!_exposureValid)
+    {
+        _blackPoint = black;
+        _whitePoint = white;
+        _exposureValid = TRUE;
+    }
+    else
+    {
+        _blackPoint += _parameters.Smoothing * (black - _blackPoint);
+        _whitePoint += _parameters.Smoothing * (white - _whitePoint);
+    }
+}
+
+void InfraredToneMapper::UpdateToneTable()
+{
+    const InfraredToneMode mode = _parameters.Mode;
+
+    // quantize to histogram bins so slow drift does not rebuild the table every frame
+    const UINT black = static_cast<UINT>(_blackPoint) & ~((1u << HISTOGRAM_SHIFT) - 1);
+    const UINT white = max(static_cast<UINT>(_whitePoint) & ~((1u << HISTOGRAM_SHIFT) - 1), black + (1u << HISTOGRAM_SHIFT));
+
+    if (_toneTableValid && mode == _tableMode)
+    {
+        if (mode == InfraredToneMode::FixedRamp
+            || (black == _tableBlack && white == _tableWhite && _parameters.Gamma == _tableGamma))
+        {
+            return;
+        }
+    }
+
+    BYTE* pTable = &_toneTable[0];
+
+    if (mode == InfraredToneMode::FixedRamp)
+    {
+        // the 512 step ramp the GPU ramp texture held, indexed by the top 9 bits. the GPU sampler picked the
+        // texel nearest to value * 511, so this is within one step of the old output rather than equal to it.
+        for (UINT i = 0; i < 512; ++i)
+        {
+            float value = min(1, 1.0f * powf(static_cast<float>(i) / 511, 0.32f));
+            memset(pTable + (i << 7), static_cast<BYTE>(value * 255), 1 << 7);
+        }
+    }
+    else
+    {
+        BYTE curve[TONE_CURVE_LENGTH];
+        for (UINT i = 0; i < TONE_CURVE_LENGTH; ++i)
+        {
+            float value = powf(static_cast<float>(i) / (TONE_CURVE_LENGTH - 1), _parameters.Gamma);
+            curve[i] = static_cast<BYTE>(min(255.0f, value * 255.0f + 0.5f));
+        }
+
+        const float scale = static_cast<float>(TONE_CURVE_LENGTH - 1) / static_cast<float>(white - black);
+        const UINT top = min(white, TONE_TABLE_SIZE);
+
+        memset(pTable, 0, black);
+        for (UINT v = black; v < top; ++v)
+        {
+            pTable[v] = curve[static_cast<UINT>((v - black) * scale + 0.5f)];
+        }
+        if (top < TONE_TABLE_SIZE)
+        {
+            memset(pTable + top, 255, TONE_TABLE_SIZE - top);
+        }
+    }
+
+    _toneTableValid = TRUE;
+    _tableMode = mode;
+    _tableBlack = black;
+    _tableWhite = white;
+    _tableGamma = _parameters.Gamma;
+    ++_toneTableBuilds;
+}
+
+void InfraredToneMapper::ApplyToneTable(
+    _In_reads_(width * height) const UINT16* pFrame,
+    UINT width, UINT height,
+    _Out_writes_bytes_(outputPitch * height) BYTE* pOutput, UINT outputPitch)
+{
+    const BYTE* pTable = &_toneTable[0];
+    const UINT unrolledWidth = width & ~3u;
+
+    for (UINT y = 0; y < height; ++y)
+    {
+        const UINT16* pSrc = pFrame + y * width;
+        BYTE* pDst = pOutput + y * outputPitch;
+
+        UINT x = 0;
+        for (; x < unrolledWidth; x += 4)
+        {
+            pDst[x + 0] = pTable[pSrc[x + 0]];
+            pDst[x + 1] = pTable[pSrc[x + 1]];
+            pDst[x + 2] = pTable[pSrc[x + 2]];
+            pDst[x + 3] = pTable[pSrc[x + 3]];
+        }
+
+        for (; x < width; ++x)
+        {
+            pDst[x] = pTable[pSrc[x]];
+        }
+    }
+}
+
+// gives each pixel the two tile centers around it
+void InfraredToneMapper::BuildClaheSpans(UINT length, UINT tiles, _Inout_ std::vector<ClaheSpan>& spans)
+{
+    const float tileSize = static_cast<float>(length) / tiles;
+
+    spans.resize(length);
+    for (UINT i = 0; i < length; ++i)
+    {
+        float position = (i + 0.5f) / tileSize - 0.5f;
+        int nearTile = static_cast<int>(floorf(position));
+        float weight = position - nearTile;
+
+        if (nearTile < 0)
+        {
+            nearTile = 0;
+            weight = 0.0f;
+        }
+        else if (nearTile >= static_cast<int>(tiles) - 1)
+        {
+            nearTile = tiles - 1;
+            weight = 0.0f;
+        }
+
+        spans[i].Near = nearTile;
+        spans[i].Far = min(static_cast<UINT>(nearTile) + 1, tiles - 1);
+        spans[i].Weight = static_cast<UINT>(weight * 256.0f + 0.5f);
+    }
+}
+
+void InfraredToneMapper::ApplyClahe(UINT width, UINT height, _Inout_updates_bytes_(outputPitch * height) BYTE* pOutput, UINT outputPitch)
+{
+    if (width < CLAHE_TILES_X || height < CLAHE_TILES_Y)
+    {
+        return;
+    }
+
+    // equalization table for each tile from its clipped histogram
+    for (UINT ty = 0; ty < CLAHE_TILES_Y; ++ty)
+    {
+        const UINT y0 = ty * height / CLAHE_TILES_Y;
+        const UINT y1 = (ty + 1) * height / CLAHE_TILES_Y;
+
+        for (UINT tx = 0; tx < CLAHE_TILES_X; ++tx)
+        {
+            const UINT x0 = tx * width / CLAHE_TILES_X;
+            const UINT x1 = (tx + 1) * width / CLAHE_TILES_X;
+
+            // neighbouring pixels mostly share a value, alternate two histograms so the increments do not wait
+            // on each other
+            UINT histogram[256] = { 0 };
+            UINT oddHistogram[256] = { 0 };
+            for (UINT y = y0; y < y1; ++y)
+            {
+                const BYTE* pRow = pOutput + y * outputPitch;
+
+                UINT x = x0;
+                for (; x + 2 <= x1; x += 2)
+                {
+                    ++histogram[pRow[x]];
+                    ++oddHistogram[pRow[x + 1]];
+                }
+
+                for (; x < x1; ++x)
+                {
+                    ++histogram[pRow[x]];
+                }
+            }
+
+            for (UINT i = 0; i < 256; ++i)
+            {
+                histogram[i] += oddHistogram[i];
+            }
+
+            const UINT pixelCount = (x1 - x0) * (y1 - y0);
+            const UINT clipLimit = max(1u, static_cast<UINT>(_parameters.ClipLimit * pixelCount / 256));
+
+            UINT excess = 0;
+            for (UINT i = 0; i < 256; ++i)
+            {
+                if (histogram[i] > clipLimit)
+                {
+                    excess += histogram[i] - clipLimit;
+                    histogram[i] = clipLimit;
+                }
+            }
+
+            // hand the clipped counts back evenly, remainder spread across the range
+            const UINT increment = excess / 256;
+            const UINT remainder = excess % 256;
+            const UINT remainderStep = (remainder > 0) ? max(1u, 256 / remainder) : 256;
+            for (UINT i = 0; i < 256; ++i)
+            {
+                histogram[i] += increment;
+            }
+            for (UINT i = 0, n = 0; i < 256 && n < remainder; i += remainderStep, ++n)
+            {
+                ++histogram[i];
+            }
+
+            BYTE* pTable = &_tileTables[(ty * CLAHE_TILES_X + tx) * 256];
+            UINT cdf = 0;
+            for (UINT i = 0; i < 256; ++i)
+            {
+                cdf += histogram[i];
+                pTable[i] = static_cast<BYTE>(min(255u, (cdf * 255 + pixelCount / 2) / pixelCount));
+            }
+        }
+    }
+
+    if (_claheColumns.size() != width)
+    {
+        BuildClaheSpans(width, CLAHE_TILES_X, _claheColumns);
+    }
+
+    if (_claheRows.size() != height)
+    {
+        BuildClaheSpans(height, CLAHE_TILES_Y, _claheRows);
+    }
+
+    if (_claheWeights.size() != 4 * width)
+    {
+        // (256 - w, w) twice per column, the horizontal weights of the upper and lower tile pairs
+        _claheWeights.resize(4 * width);
+        for (UINT x = 0; x < width; ++x)
+        {
+            const INT16 weight = static_cast<INT16>(_claheColumns[x].Weight);
+            _claheWeights[4 * x + 0] = _claheWeights[4 * x + 2] = 256 - weight;
+            _claheWeights[4 * x + 1] = _claheWeights[4 * x + 3] = weight;
+        }
+    }
+
+    // the four tile tables around each tile center as one value per entry, near near in the low byte, then
+    // near far, far near and far far
+    for (UINT ty = 0; ty < CLAHE_TILES_Y; ++ty)
+    {
+        const BYTE* pNearRow = &_tileTables[ty * CLAHE_TILES_X * 256];
+        const BYTE* pFarRow = &_tileTables[min(ty + 1, CLAHE_TILES_Y - 1) * CLAHE_TILES_X * 256];
+
+        for (UINT tx = 0; tx < CLAHE_TILES_X; ++tx)
+        {
+            const UINT nearColumn = tx * 256;
+            const UINT farColumn = min(tx + 1, CLAHE_TILES_X - 1) * 256;
+            UINT32* pQuads = &_claheQuads[(ty * CLAHE_TILES_X + tx) * 256];
+
+            for (UINT i = 0; i < 256; ++i)
+            {
+                pQuads[i] = pNearRow[nearColumn + i]
+                    | (pNearRow[farColumn + i] << 8)
+                    | (pFarRow[nearColumn + i] << 16)
+                    | (pFarRow[farColumn + i] << 24);
+            }
+        }
+    }
+
+    // blend the four surrounding tile tables, 4 pixels at a time: each pixel's four table values are widened to
+    // 16 bits, blended across with the column weights into an upper and lower value, then down with the row weight
+    const ClaheSpan* pColumns = &_claheColumns[0];
+    const INT16* pWeights = &_claheWeights[0];
+    const UINT simdWidth = width & ~3u;
+
+    for (UINT y = 0; y < height; ++y)
+    {
+        const ClaheSpan& row = _claheRows[y];
+        const UINT32* pRowQuads = &_claheQuads[row.Near * CLAHE_TILES_X * 256];
+        const UINT wy = row.Weight;
+        const __m128i rowWeights = _mm_setr_epi32(256 - wy, wy, 256 - wy, wy);
+
+        BYTE* pLine = pOutput + y * outputPitch;
+
+        UINT x = 0;
+        for (; x < simdWidth; x += 4)
+        {
+            const __m128i quads = _mm_setr_epi32(
+                pRowQuads[pColumns[x + 0].Near * 256 + pLine[x + 0]],
+                pRowQuads[pColumns[x + 1].Near * 256 + pLine[x + 1]],
+                pRowQuads[pColumns[x + 2].Near * 256 + pLine[x + 2]],
+                pRowQuads[pColumns[x + 3].Near * 256 + pLine[x + 3]]);
+
+            // (upper, lower) pairs of pixels 0 and 1, then 2 and 3
+            __m128i low = _mm_madd_epi16(
+                _mm_unpacklo_epi8(quads, _mm_setzero_si128()),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(pWeights + 4 * x)));
+            __m128i high = _mm_madd_epi16(
+                _mm_unpackhi_epi8(quads, _mm_setzero_si128()),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(pWeights + 4 * x + 8)));
+
+            __m128i blended = _mm_hadd_epi32(_mm_mullo_epi32(low, rowWeights), _mm_mullo_epi32(high, rowWeights));
+            blended = _mm_srli_epi32(_mm_add_epi32(blended, _mm_set1_epi32(32768)), 16);
+            blended = _mm_packus_epi16(_mm_packus_epi32(blended, blended), blended);
+
+            *reinterpret_cast<UINT32*>(pLine + x) = static_cast<UINT32>(_mm_cvtsi128_si32(blended));
+        }
+
+        for (; x < width; ++x)
+        {
+            const UINT32 quad = pRowQuads[pColumns[x].Near * 256 + pLine[x]];
+            const UINT wx = pColumns[x].Weight;
+
+            const UINT top = (quad & 0xFF) * (256 - wx) + ((quad >> 8) & 0xFF) * wx;
+            const UINT bottom = ((quad >> 16) & 0xFF) * (256 - wx) + (quad >> 24) * wx;
+
+            pLine[x] = static_cast<BYTE>((top * (256 - wy) + bottom * wy + 32768) >> 16);
+        }
+    }
+}
+
+void InfraredToneMapper::ExpandToRGBA(
+    _In_reads_bytes_(srcPitch * height) const BYTE* pSrc, UINT srcPitch,
+    UINT width, UINT height,
+    _Out_writes_bytes_(dstPitch * height) UINT* pDst, UINT dstPitch)
+{
+    const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+    const UINT simdWidth = width & ~15u;
+
+    for (UINT y = 0; y < height; ++y)
+    {
+        const BYTE* pIn = pSrc + y * srcPitch;
+        UINT* pOut = reinterpret_cast<UINT*>(reinterpret_cast<BYTE*>(pDst) + y * dstPitch);
+
+        UINT x = 0;
+        for (; x < simdWidth; x += 16)
+        {
+            // g -> (g, g) and (g, 0xFF) pairs, interleaved into (g, g, g, 0xFF) texels
+            __m128i grey = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn + x));
+            __m128i lowGG = _mm_unpacklo_epi8(grey, grey);
+            __m128i highGG = _mm_unpackhi_epi8(grey, grey);
+            __m128i lowGA = _mm_unpacklo_epi8(grey, alpha);
+            __m128i highGA = _mm_unpackhi_epi8(grey, alpha);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + x + 0), _mm_unpacklo_epi16(lowGG, lowGA));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + x + 4), _mm_unpackhi_epi16(lowGG, lowGA));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + x + 8), _mm_unpacklo_epi16(highGG, highGA));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + x + 12), _mm_unpackhi_epi16(highGG, highGA));
+        }
+
+        for (; x < width; ++x)
+        {
+            UINT greyLevel = pIn[x];
+            pOut[x] = 0xFF000000 | (greyLevel << 16) | (greyLevel << 8) | greyLevel;
+        }
+    }
+}
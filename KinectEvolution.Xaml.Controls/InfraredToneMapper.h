@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------
+// <copyright file="InfraredToneMapper.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Infrared {
+
+                enum class InfraredToneMode
+                {
+                    FixedRamp,      // close to the original powf(i / 511, 0.32f) ramp over the full 16-bit range
+                    AutoExposure,   // black / white points from the frame histogram
+                    Clahe,          // auto exposure followed by contrast limited adaptive equalization
+                };
+
+                struct InfraredToneParameters
+                {
+                    InfraredToneMode Mode;
+
+                    // fraction of sampled pixels clipped to black / white
+                    float BlackPercentile;
+                    float WhitePercentile;
+
+                    // weight of the new frame in the black / white point filter, 1.0f disables smoothing
+                    float Smoothing;
+
+                    // exponent applied after the black / white point stretch
+                    float Gamma;
+
+                    // CLAHE clip limit as a multiple of the mean tile bin count
+                    float ClipLimit;
+
+                    InfraredToneParameters()
+                        : Mode(InfraredToneMode::AutoExposure)
+                        , BlackPercentile(0.01f)
+                        , WhitePercentile(0.995f)
+                        , Smoothing(0.15f)
+                        , Gamma(0.32f)
+                        , ClipLimit(3.0f)
+                    {
+                    }
+                };
+
+                // converts 16-bit IR frames to 8-bit intensities on the CPU
+                class InfraredToneMapper
+                {
+                public:
+                    InfraredToneMapper();
+
+                    void Reset();
+
+                    void SetParameters(_In_ const InfraredToneParameters& parameters);
+                    const InfraredToneParameters& GetParameters() const { return _parameters; }
+
+                    // tone maps one frame into width x height 8-bit values
+                    void Process(
+                        _In_reads_(width * height) const UINT16* pFrame,
+                        UINT width, UINT height,
+                        _Out_writes_bytes_(outputPitch * height) BYTE* pOutput, UINT outputPitch);
+
+                    // current smoothed black / white points in 16-bit IR units
+                    float GetBlackPoint() const { return _blackPoint; }
+                    float GetWhitePoint() const { return _whitePoint; }
+
+                    // times the tone table has been filled since Reset
+                    UINT GetToneTableBuildCount() const { return _toneTableBuilds; }
+
+                    // expands 8-bit intensities to opaque R8G8B8A8 texels
+                    static void ExpandToRGBA(
+                        _In_reads_bytes_(srcPitch * height) const BYTE* pSrc, UINT srcPitch,
+                        UINT width, UINT height,
+                        _Out_writes_bytes_(dstPitch * height) UINT* pDst, UINT dstPitch);
+
+                private:
+                    // neighbouring tiles and 8-bit blend weight for a CLAHE column / row
+                    struct ClaheSpan
+                    {
+                        UINT    Near;
+                        UINT    Far;
+                        UINT    Weight;
+                    };
+
+                    static void BuildClaheSpans(UINT length, UINT tiles, _Inout_ std::vector<ClaheSpan>& spans);
+
+                    void BuildHistogram(_In_reads_(width * height) const UINT16* pFrame, UINT width, UINT height);
+                    void UpdateExposure();
+                    void UpdateToneTable();
+                    void ApplyToneTable(
+                        _In_reads_(width * height) const UINT16* pFrame,
+                        UINT width, UINT height,
+                        _Out_writes_bytes_(outputPitch * height) BYTE* pOutput, UINT outputPitch);
+                    void ApplyClahe(UINT width, UINT height, _Inout_updates_bytes_(outputPitch * height) BYTE* pOutput, UINT outputPitch);
+
+                private:
+                    static const UINT HISTOGRAM_SHIFT = 4;
+                    static const UINT HISTOGRAM_BINS = 65536 >> HISTOGRAM_SHIFT;
+                    static const UINT HISTOGRAM_LANES = 4;
+                    static const UINT TONE_TABLE_SIZE = 65536;
+                    static const UINT CLAHE_TILES_X = 8;
+                    static const UINT CLAHE_TILES_Y = 8;
+
+                    InfraredToneParameters  _parameters;
+
+                    // interleaved sub-histograms avoid store forwarding stalls on repeated bins
+                    std::vector<UINT>       _histogram;
+                    UINT                    _sampleCount;
+
+                    BOOL                    _exposureValid;
+                    float                   _blackPoint;
+                    float                   _whitePoint;
+
+                    // 16-bit value to 8-bit intensity, rebuilt only when its inputs change
+                    std::vector<BYTE>       _toneTable;
+                    BOOL                    _toneTableValid;
+                    InfraredToneMode        _tableMode;
+                    UINT                    _tableBlack;
+                    UINT                    _tableWhite;
+                    float                   _tableGamma;
+                    UINT                    _toneTableBuilds;
+
+                    // per tile equalization tables for CLAHE
+                    std::vector<BYTE>       _tileTables;
+
+                    // the four tables around each tile center, interleaved so a pixel needs one read
+                    std::vector<UINT32>     _claheQuads;
+
+                    std::vector<ClaheSpan>  _claheColumns;
+                    std::vector<ClaheSpan>  _claheRows;
+                    std::vector<INT16>      _claheWeights;
+                };
+
+            }
+        }
+    }
+}
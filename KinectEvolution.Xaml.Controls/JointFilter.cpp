@@ -0,0 +1,496 @@
+//------------------------------------------------------------------------------
+// <copyright file="JointFilter.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "JointFilter.h"
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+// frame interval used when the sensor time is missing or goes backwards
+static const float DEFAULT_FRAME_TIME = 1.0f / 30.0f;
+static const float MAX_FRAME_TIME = 0.5f;
+
+// dot product above which slerp falls back to nlerp
+static const float SLERP_THRESHOLD = 0.9995f;
+
+inline XMVECTOR LoadLanes(_In_reads_(4) const float* pSource)
+{
+    return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource));
+}
+
+inline void StoreLanes(_Out_writes_(4) float* pDestination, FXMVECTOR value)
+{
+    XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pDestination), value);
+}
+
+inline XMVECTOR LoadMask(_In_reads_(4) const UINT* pSource)
+{
+    return XMLoadInt4(reinterpret_cast<const uint32_t*>(pSource));
+}
+
+inline void StoreMask(_Out_writes_(4) UINT* pDestination, FXMVECTOR value)
+{
+    XMStoreInt4(reinterpret_cast<uint32_t*>(pDestination), value);
+}
+
+// length of 4 three component vectors held as x, y and z lanes
+inline XMVECTOR LaneLength(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+{
+    return XMVectorSqrt(XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, XMVectorMultiply(z, z))));
+}
+
+// smoothing factor of a first order low pass with the given cutoff
+inline XMVECTOR LowPassAlpha(FXMVECTOR cutoff, FXMVECTOR deltaTime)
+{
+    XMVECTOR r = XMVectorMultiply(XMVectorMultiply(XMVectorReplicate(XM_2PI), cutoff), deltaTime);
+    return XMVectorDivide(r, XMVectorAdd(r, XMVectorSplatOne()));
+}
+
+JointFilter::JointFilter()
+{
+    SetParameters(JointFilterParameters());
+    Reset();
+    ResetStatistics();
+}
+
+void JointFilter::SetParameters(_In_ const JointFilterParameters& parameters)
+{
+    for (UINT i = 0; i < JOINT_COUNT; ++i)
+    {
+        _jointParameters[i] = parameters;
+    }
+
+    _lanesChanged = TRUE;
+}
+
+void JointFilter::SetJointParameters(WRK::JointType joint, _In_ const JointFilterParameters& parameters)
+{
+    UINT jointIndex = static_cast<UINT>(joint);
+    if (jointIndex >= JOINT_COUNT)
+    {
+        return;
+    }
+
+    _jointParameters[jointIndex] = parameters;
+    _lanesChanged = TRUE;
+}
+
+void JointFilter::Reset()
+{
+    ZeroMemory(_stateX, sizeof(_stateX));
+    ZeroMemory(_stateY, sizeof(_stateY));
+    ZeroMemory(_stateZ, sizeof(_stateZ));
+    ZeroMemory(_trendX, sizeof(_trendX));
+    ZeroMemory(_trendY, sizeof(_trendY));
+    ZeroMemory(_trendZ, sizeof(_trendZ));
+    ZeroMemory(_rotationX, sizeof(_rotationX));
+    ZeroMemory(_rotationY, sizeof(_rotationY));
+    ZeroMemory(_rotationZ, sizeof(_rotationZ));
+    ZeroMemory(_rotationW, sizeof(_rotationW));
+    ZeroMemory(_positionValid, sizeof(_positionValid));
+    ZeroMemory(_orientationValid, sizeof(_orientationValid));
+    ZeroMemory(_trackingId, sizeof(_trackingId));
+    ZeroMemory(_holdMask, sizeof(_holdMask));
+
+    // the lanes are built again from the parameters on the next update
+    ZeroMemory(_holtMask, sizeof(_holtMask));
+    ZeroMemory(_oneEuroMask, sizeof(_oneEuroMask));
+    ZeroMemory(_slerpMask, sizeof(_slerpMask));
+    ZeroMemory(_orientationMask, sizeof(_orientationMask));
+    _anyHolt = FALSE;
+    _anyOneEuro = FALSE;
+    _anySlerp = FALSE;
+    _lanesChanged = TRUE;
+
+    _lastTime = 0;
+    _filtered.Clear();
+}
+
+void JointFilter::UpdateLanes()
+{
+    _anyHolt = FALSE;
+    _anyOneEuro = FALSE;
+    _anySlerp = FALSE;
+
+    for (UINT i = 0; i < BODY_JOINT_STRIDE; ++i)
+    {
+        // the padding lanes copy joint 0, they never hold tracked data
+        const JointFilterParameters& p = _jointParameters[(i < BODY_JOINT_COUNT) ? (i % JOINT_COUNT) : 0];
+
+        _smoothing[i] = min(max(p.Smoothing, 0.0f), 1.0f);
+        _correction[i] = min(max(p.Correction, 0.0f), 1.0f);
+        _prediction[i] = max(p.Prediction, 0.0f);
+        _jitterRadius[i] = max(p.JitterRadius, FLT_EPSILON);
+        _maxDeviation[i] = max(p.MaxDeviationRadius, FLT_EPSILON);
+        _minCutoff[i] = max(p.MinCutoff, FLT_EPSILON);
+        _beta[i] = max(p.Beta, 0.0f);
+        _derivativeCutoff[i] = max(p.DerivativeCutoff, FLT_EPSILON);
+        _orientationWeight[i] = 1.0f - min(max(p.OrientationSmoothing, 0.0f), 1.0f);
+
+        UINT holt = (p.PositionFilter == PositionFilterType::Holt) ? 0xFFFFFFFF : 0;
+        UINT oneEuro = (p.PositionFilter == PositionFilterType::OneEuro) ? 0xFFFFFFFF : 0;
+        UINT slerp = (p.OrientationFilter == OrientationFilterType::Slerp) ? 0xFFFFFFFF : 0;
+        UINT orientation = (p.OrientationFilter != OrientationFilterType::None) ? 0xFFFFFFFF : 0;
+
+        // a lane that changes filter starts over
+        if (holt != _holtMask[i] || oneEuro != _oneEuroMask[i])
+        {
+            _positionValid[i] = 0;
+        }
+
+        _holtMask[i] = holt;
+        _oneEuroMask[i] = oneEuro;
+        _slerpMask[i] = slerp;
+        _orientationMask[i] = orientation;
+
+        _anyHolt |= (0 != holt);
+        _anyOneEuro |= (0 != oneEuro);
+        _anySlerp |= (0 != slerp);
+    }
+
+    _lanesChanged = FALSE;
+}
+
+void JointFilter::UpdateValidity(_In_ const BodyFrameData& frame)
+{
+    // a body that is lost or replaced by another person starts over
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        UINT first = BodyJointIndex(bodyIndex, 0);
+
+        // BodyTracker keeps the id of a body it expects back, its state is held until then
+        UINT hold = (!frame.IsTracked[bodyIndex] && 0 != frame.TrackingId[bodyIndex] && frame.TrackingId[bodyIndex] == _trackingId[bodyIndex]) ? 0xFFFFFFFF : 0;
+        for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+        {
+            _holdMask[first + jointIndex] = hold;
+        }
+
+        if (0 != hold || (frame.IsTracked[bodyIndex] && frame.TrackingId[bodyIndex] == _trackingId[bodyIndex]))
+        {
+            continue;
+        }
+
+        _trackingId[bodyIndex] = frame.IsTracked[bodyIndex] ? frame.TrackingId[bodyIndex] : 0;
+
+        ZeroMemory(&_positionValid[first], JOINT_COUNT * sizeof(UINT));
+        ZeroMemory(&_orientationValid[first], JOINT_COUNT * sizeof(UINT));
+        ZeroMemory(&_statisticsHistory[first], JOINT_COUNT * sizeof(BYTE));
+    }
+}
+
+void JointFilter::Update(_In_ const BodyFrameData& frame)
+{
+    if (_lanesChanged)
+    {
+        UpdateLanes();
+    }
+
+    float deltaTime = DEFAULT_FRAME_TIME;
+    if (0 != _lastTime && frame.RelativeTime > _lastTime)
+    {
+        deltaTime = min(static_cast<float>(frame.RelativeTime - _lastTime) * 1e-7f, MAX_FRAME_TIME);
+    }
+    _lastTime = frame.RelativeTime;
+
+    UpdateValidity(frame);
+
+    // everything that is not filtered passes straight through
+    _filtered = frame;
+
+    FilterPositions(frame, deltaTime);
+    FilterOrientations(frame);
+
+    AccumulateStatistics(frame);
+}
+
+void JointFilter::FilterPositions(_In_ const BodyFrameData& frame, float deltaTime)
+{
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR one = XMVectorSplatOne();
+    const XMVECTOR dt = XMVectorReplicate(deltaTime);
+    const XMVECTOR invDt = XMVectorReplicate(1.0f / deltaTime);
+    const XMVECTOR notTracked = XMVectorZero();
+
+    for (UINT i = 0; i < BODY_JOINT_STRIDE; i += 4)
+    {
+        XMVECTOR rawX = LoadLanes(&frame.PositionX[i]);
+        XMVECTOR rawY = LoadLanes(&frame.PositionY[i]);
+        XMVECTOR rawZ = LoadLanes(&frame.PositionZ[i]);
+
+        // joints without a position are passed through and start over when they return
+        XMVECTOR trackingState = XMLoadInt4(reinterpret_cast<const uint32_t*>(&frame.TrackingState[i]));
+        XMVECTOR present = XMVectorNotEqualInt(trackingState, notTracked);
+        XMVECTOR filterMask = XMVectorOrInt(LoadMask(&_holtMask[i]), LoadMask(&_oneEuroMask[i]));
+        XMVECTOR valid = XMVectorAndInt(LoadMask(&_positionValid[i]), present);
+
+        XMVECTOR stateX = XMVectorSelect(rawX, LoadLanes(&_stateX[i]), valid);
+        XMVECTOR stateY = XMVectorSelect(rawY, LoadLanes(&_stateY[i]), valid);
+        XMVECTOR stateZ = XMVectorSelect(rawZ, LoadLanes(&_stateZ[i]), valid);
+        XMVECTOR trendX = XMVectorSelect(zero, LoadLanes(&_trendX[i]), valid);
+        XMVECTOR trendY = XMVectorSelect(zero, LoadLanes(&_trendY[i]), valid);
+        XMVECTOR trendZ = XMVectorSelect(zero, LoadLanes(&_trendZ[i]), valid);
+
+        XMVECTOR outX = rawX;
+        XMVECTOR outY = rawY;
+        XMVECTOR outZ = rawZ;
+        XMVECTOR newStateX = stateX, newStateY = stateY, newStateZ = stateZ;
+        XMVECTOR newTrendX = trendX, newTrendY = trendY, newTrendZ = trendZ;
+
+        if (_anyHolt)
+        {
+            XMVECTOR holt = LoadMask(&_holtMask[i]);
+            XMVECTOR smoothing = LoadLanes(&_smoothing[i]);
+            XMVECTOR correction = LoadLanes(&_correction[i]);
+            XMVECTOR prediction = LoadLanes(&_prediction[i]);
+            XMVECTOR jitterRadius = LoadLanes(&_jitterRadius[i]);
+            XMVECTOR maxDeviation = LoadLanes(&_maxDeviation[i]);
+
+            // damp moves inside the jitter radius
+            XMVECTOR distance = LaneLength(rawX - stateX, rawY - stateY, rawZ - stateZ);
+            XMVECTOR inJitter = XMVectorLessOrEqual(distance, jitterRadius);
+            XMVECTOR jitterWeight = XMVectorDivide(distance, jitterRadius);
+            XMVECTOR inputX = XMVectorSelect(rawX, XMVectorLerpV(stateX, rawX, jitterWeight), inJitter);
+            XMVECTOR inputY = XMVectorSelect(rawY, XMVectorLerpV(stateY, rawY, jitterWeight), inJitter);
+            XMVECTOR inputZ = XMVectorSelect(rawZ, XMVectorLerpV(stateZ, rawZ, jitterWeight), inJitter);
+
+            // double exponential smoothing
+            XMVECTOR filteredX = XMVectorLerpV(inputX, stateX + trendX, smoothing);
+            XMVECTOR filteredY = XMVectorLerpV(inputY, stateY + trendY, smoothing);
+            XMVECTOR filteredZ = XMVectorLerpV(inputZ, stateZ + trendZ, smoothing);
+
+            XMVECTOR holtTrendX = XMVectorLerpV(trendX, filteredX - stateX, correction);
+            XMVECTOR holtTrendY = XMVectorLerpV(trendY, filteredY - stateY, correction);
+            XMVECTOR holtTrendZ = XMVectorLerpV(trendZ, filteredZ - stateZ, correction);
+
+            XMVECTOR predictedX = XMVectorMultiplyAdd(holtTrendX, prediction, filteredX);
+            XMVECTOR predictedY = XMVectorMultiplyAdd(holtTrendY, prediction, filteredY);
+            XMVECTOR predictedZ = XMVectorMultiplyAdd(holtTrendZ, prediction, filteredZ);
+
+            // keep the prediction within the deviation radius of the raw position
+            XMVECTOR deviationX = predictedX - rawX;
+            XMVECTOR deviationY = predictedY - rawY;
+            XMVECTOR deviationZ = predictedZ - rawZ;
+            XMVECTOR deviation = LaneLength(deviationX, deviationY, deviationZ);
+            XMVECTOR clamp = XMVectorSelect(one, XMVectorDivide(maxDeviation, deviation), XMVectorGreater(deviation, maxDeviation));
+
+            outX = XMVectorSelect(outX, XMVectorMultiplyAdd(deviationX, clamp, rawX), holt);
+            outY = XMVectorSelect(outY, XMVectorMultiplyAdd(deviationY, clamp, rawY), holt);
+            outZ = XMVectorSelect(outZ, XMVectorMultiplyAdd(deviationZ, clamp, rawZ), holt);
+
+            newStateX = XMVectorSelect(newStateX, filteredX, holt);
+            newStateY = XMVectorSelect(newStateY, filteredY, holt);
+            newStateZ = XMVectorSelect(newStateZ, filteredZ, holt);
+            newTrendX = XMVectorSelect(newTrendX, holtTrendX, holt);
+            newTrendY = XMVectorSelect(newTrendY, holtTrendY, holt);
+            newTrendZ = XMVectorSelect(newTrendZ, holtTrendZ, holt);
+        }
+
+        if (_anyOneEuro)
+        {
+            XMVECTOR oneEuro = LoadMask(&_oneEuroMask[i]);
+
+            // smoothed speed drives the cutoff of the position filter
+            XMVECTOR derivativeAlpha = LowPassAlpha(LoadLanes(&_derivativeCutoff[i]), dt);
+            XMVECTOR speedX = XMVectorLerpV(trendX, (rawX - stateX) * invDt, derivativeAlpha);
+            XMVECTOR speedY = XMVectorLerpV(trendY, (rawY - stateY) * invDt, derivativeAlpha);
+            XMVECTOR speedZ = XMVectorLerpV(trendZ, (rawZ - stateZ) * invDt, derivativeAlpha);
+
+            XMVECTOR cutoff = XMVectorMultiplyAdd(LoadLanes(&_beta[i]), LaneLength(speedX, speedY, speedZ), LoadLanes(&_minCutoff[i]));
+            XMVECTOR alpha = LowPassAlpha(cutoff, dt);
+
+            XMVECTOR filteredX = XMVectorLerpV(stateX, rawX, alpha);
+            XMVECTOR filteredY = XMVectorLerpV(stateY, rawY, alpha);
+            XMVECTOR filteredZ = XMVectorLerpV(stateZ, rawZ, alpha);
+
+            outX = XMVectorSelect(outX, filteredX, oneEuro);
+            outY = XMVectorSelect(outY, filteredY, oneEuro);
+            outZ = XMVectorSelect(outZ, filteredZ, oneEuro);
+
+            newStateX = XMVectorSelect(newStateX, filteredX, oneEuro);
+            newStateY = XMVectorSelect(newStateY, filteredY, oneEuro);
+            newStateZ = XMVectorSelect(newStateZ, filteredZ, oneEuro);
+            newTrendX = XMVectorSelect(newTrendX, speedX, oneEuro);
+            newTrendY = XMVectorSelect(newTrendY, speedY, oneEuro);
+            newTrendZ = XMVectorSelect(newTrendZ, speedZ, oneEuro);
+        }
+
+        // a lane starting over outputs the raw position
+        XMVECTOR apply = XMVectorAndInt(filterMask, valid);
+
+        StoreLanes(&_filtered.PositionX[i], XMVectorSelect(rawX, outX, apply));
+        StoreLanes(&_filtered.PositionY[i], XMVectorSelect(rawY, outY, apply));
+        StoreLanes(&_filtered.PositionZ[i], XMVectorSelect(rawZ, outZ, apply));
+
+        // held lanes keep their state untouched
+        XMVECTOR hold = LoadMask(&_holdMask[i]);
+
+        StoreLanes(&_stateX[i], XMVectorSelect(XMVectorSelect(rawX, newStateX, valid), LoadLanes(&_stateX[i]), hold));
+        StoreLanes(&_stateY[i], XMVectorSelect(XMVectorSelect(rawY, newStateY, valid), LoadLanes(&_stateY[i]), hold));
+        StoreLanes(&_stateZ[i], XMVectorSelect(XMVectorSelect(rawZ, newStateZ, valid), LoadLanes(&_stateZ[i]), hold));
+        StoreLanes(&_trendX[i], XMVectorSelect(XMVectorSelect(zero, newTrendX, valid), LoadLanes(&_trendX[i]), hold));
+        StoreLanes(&_trendY[i], XMVectorSelect(XMVectorSelect(zero, newTrendY, valid), LoadLanes(&_trendY[i]), hold));
+        StoreLanes(&_trendZ[i], XMVectorSelect(XMVectorSelect(zero, newTrendZ, valid), LoadLanes(&_trendZ[i]), hold));
+        StoreMask(&_positionValid[i], XMVectorSelect(XMVectorAndInt(present, filterMask), LoadMask(&_positionValid[i]), hold));
+    }
+}
+
+void JointFilter::FilterOrientations(_In_ const BodyFrameData& frame)
+{
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR one = XMVectorSplatOne();
+    const XMVECTOR slerpThreshold = XMVectorReplicate(SLERP_THRESHOLD);
+
+    for (UINT i = 0; i < BODY_JOINT_STRIDE; i += 4)
+    {
+        XMVECTOR inputX = LoadLanes(&frame.OrientationX[i]);
+        XMVECTOR inputY = LoadLanes(&frame.OrientationY[i]);
+        XMVECTOR inputZ = LoadLanes(&frame.OrientationZ[i]);
+        XMVECTOR inputW = LoadLanes(&frame.OrientationW[i]);
+
+        // the sensor reports a zero quaternion for joints it could not orient
+        XMVECTOR lengthSq = XMVectorMultiplyAdd(inputX, inputX, XMVectorMultiplyAdd(inputY, inputY, XMVectorMultiplyAdd(inputZ, inputZ, XMVectorMultiply(inputW, inputW))));
+        XMVECTOR present = XMVectorGreater(lengthSq, zero);
+
+        XMVECTOR filterMask = LoadMask(&_orientationMask[i]);
+        XMVECTOR previous = XMVectorAndInt(LoadMask(&_orientationValid[i]), filterMask);
+        XMVECTOR valid = XMVectorAndInt(previous, present);
+
+        XMVECTOR invLength = XMVectorSelect(zero, XMVectorReciprocalSqrt(lengthSq), present);
+        XMVECTOR rawX = inputX * invLength;
+        XMVECTOR rawY = inputY * invLength;
+        XMVECTOR rawZ = inputZ * invLength;
+        XMVECTOR rawW = inputW * invLength;
+
+        XMVECTOR stateX = LoadLanes(&_rotationX[i]);
+        XMVECTOR stateY = LoadLanes(&_rotationY[i]);
+        XMVECTOR stateZ = LoadLanes(&_rotationZ[i]);
+        XMVECTOR stateW = LoadLanes(&_rotationW[i]);
+
+        // take the shorter way round
+        XMVECTOR cosAngle = XMVectorMultiplyAdd(stateX, rawX, XMVectorMultiplyAdd(stateY, rawY, XMVectorMultiplyAdd(stateZ, rawZ, XMVectorMultiply(stateW, rawW))));
+        XMVECTOR flip = XMVectorLess(cosAngle, zero);
+        rawX = XMVectorSelect(rawX, XMVectorNegate(rawX), flip);
+        rawY = XMVectorSelect(rawY, XMVectorNegate(rawY), flip);
+        rawZ = XMVectorSelect(rawZ, XMVectorNegate(rawZ), flip);
+        rawW = XMVectorSelect(rawW, XMVectorNegate(rawW), flip);
+        cosAngle = XMVectorAbs(cosAngle);
+
+        XMVECTOR weight = LoadLanes(&_orientationWeight[i]);
+        XMVECTOR weightState = one - weight;
+        XMVECTOR weightRaw = weight;
+
+        if (_anySlerp)
+        {
+            // nearly equal rotations divide by a vanishing sine, nlerp is exact enough there
+            XMVECTOR slerp = XMVectorAndInt(LoadMask(&_slerpMask[i]), XMVectorLess(cosAngle, slerpThreshold));
+
+            XMVECTOR angle = XMVectorACos(XMVectorMin(cosAngle, one));
+            XMVECTOR invSin = XMVectorReciprocal(XMVectorSin(angle));
+            weightState = XMVectorSelect(weightState, XMVectorSin(weightState * angle) * invSin, slerp);
+            weightRaw = XMVectorSelect(weightRaw, XMVectorSin(weight * angle) * invSin, slerp);
+        }
+
+        XMVECTOR blendX = XMVectorMultiplyAdd(stateX, weightState, rawX * weightRaw);
+        XMVECTOR blendY = XMVectorMultiplyAdd(stateY, weightState, rawY * weightRaw);
+        XMVECTOR blendZ = XMVectorMultiplyAdd(stateZ, weightState, rawZ * weightRaw);
+        XMVECTOR blendW = XMVectorMultiplyAdd(stateW, weightState, rawW * weightRaw);
+
+        XMVECTOR blendLengthSq = XMVectorMultiplyAdd(blendX, blendX, XMVectorMultiplyAdd(blendY, blendY, XMVectorMultiplyAdd(blendZ, blendZ, XMVectorMultiply(blendW, blendW))));
+        XMVECTOR invBlendLength = XMVectorReciprocalSqrt(XMVectorMax(blendLengthSq, XMVectorReplicate(FLT_EPSILON)));
+
+        // new lanes start from the input, lanes without input hold their last orientation
+        XMVECTOR outX = XMVectorSelect(XMVectorSelect(stateX, rawX, present), blendX * invBlendLength, valid);
+        XMVECTOR outY = XMVectorSelect(XMVectorSelect(stateY, rawY, present), blendY * invBlendLength, valid);
+        XMVECTOR outZ = XMVectorSelect(XMVectorSelect(stateZ, rawZ, present), blendZ * invBlendLength, valid);
+        XMVECTOR outW = XMVectorSelect(XMVectorSelect(stateW, rawW, present), blendW * invBlendLength, valid);
+
+        XMVECTOR output = XMVectorOrInt(present, previous);
+        XMVECTOR hold = LoadMask(&_holdMask[i]);
+
+        StoreLanes(&_rotationX[i], XMVectorSelect(XMVectorSelect(zero, outX, output), stateX, hold));
+        StoreLanes(&_rotationY[i], XMVectorSelect(XMVectorSelect(zero, outY, output), stateY, hold));
+        StoreLanes(&_rotationZ[i], XMVectorSelect(XMVectorSelect(zero, outZ, output), stateZ, hold));
+        StoreLanes(&_rotationW[i], XMVectorSelect(XMVectorSelect(zero, outW, output), stateW, hold));
+        StoreMask(&_orientationValid[i], XMVectorSelect(XMVectorAndInt(output, filterMask), LoadMask(&_orientationValid[i]), hold));
+
+        XMVECTOR filtered = XMVectorAndInt(output, filterMask);
+
+        StoreLanes(&_filtered.OrientationX[i], XMVectorSelect(inputX, outX, filtered));
+        StoreLanes(&_filtered.OrientationY[i], XMVectorSelect(inputY, outY, filtered));
+        StoreLanes(&_filtered.OrientationZ[i], XMVectorSelect(inputZ, outZ, filtered));
+        StoreLanes(&_filtered.OrientationW[i], XMVectorSelect(inputW, outW, filtered));
+    }
+}
+
+void JointFilter::AccumulateStatistics(_In_ const BodyFrameData& frame)
+{
+    for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+    {
+        if (WRK::TrackingState::Tracked != frame.TrackingState[i])
+        {
+            _statisticsHistory[i] = 0;
+            continue;
+        }
+
+        float raw[3] = { frame.PositionX[i], frame.PositionY[i], frame.PositionZ[i] };
+        float filtered[3] = { _filtered.PositionX[i], _filtered.PositionY[i], _filtered.PositionZ[i] };
+
+        float rawAcceleration = 0.0f;
+        float filteredAcceleration = 0.0f;
+        float lag = 0.0f;
+
+        for (UINT axis = 0; axis < 3; ++axis)
+        {
+            float rawVelocity = raw[axis] - _statistics[RawPosition + axis][i];
+            float filteredVelocity = filtered[axis] - _statistics[FilteredPosition + axis][i];
+
+            float rawDelta = rawVelocity - _statistics[RawVelocity + axis][i];
+            float filteredDelta = filteredVelocity - _statistics[FilteredVelocity + axis][i];
+            float lagDelta = filtered[axis] - raw[axis];
+
+            rawAcceleration += rawDelta * rawDelta;
+            filteredAcceleration += filteredDelta * filteredDelta;
+            lag += lagDelta * lagDelta;
+
+            _statistics[RawPosition + axis][i] = raw[axis];
+            _statistics[FilteredPosition + axis][i] = filtered[axis];
+            _statistics[RawVelocity + axis][i] = (_statisticsHistory[i] > 0) ? rawVelocity : 0.0f;
+            _statistics[FilteredVelocity + axis][i] = (_statisticsHistory[i] > 0) ? filteredVelocity : 0.0f;
+        }
+
+        // acceleration needs the two previous positions
+        if (_statisticsHistory[i] >= 2)
+        {
+            _rawJitterSum += sqrt(rawAcceleration);
+            _filteredJitterSum += sqrt(filteredAcceleration);
+            _lagSum += sqrt(lag);
+            ++_samples;
+        }
+        else
+        {
+            ++_statisticsHistory[i];
+        }
+    }
+}
+
+void JointFilter::GetStatistics(_Out_ JointFilterStatistics* pStatistics) const
+{
+    pStatistics->Samples = _samples;
+    pStatistics->RawJitter = (_samples > 0) ? static_cast<float>(_rawJitterSum / _samples) : 0.0f;
+    pStatistics->FilteredJitter = (_samples > 0) ? static_cast<float>(_filteredJitterSum / _samples) : 0.0f;
+    pStatistics->MeanLag = (_samples > 0) ? static_cast<float>(_lagSum / _samples) : 0.0f;
+}
+
+void JointFilter::ResetStatistics()
+{
+    ZeroMemory(_statistics, sizeof(_statistics));
+    ZeroMemory(_statisticsHistory, sizeof(_statisticsHistory));
+
+    _samples = 0;
+    _rawJitterSum = 0.0;
+    _filteredJitterSum = 0.0;
+    _lagSum = 0.0;
+}
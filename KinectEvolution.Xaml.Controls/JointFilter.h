@@ -0,0 +1,158 @@
+//------------------------------------------------------------------------------
+// <copyright file="JointFilter.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                enum class PositionFilterType
+                {
+                    None,
+                    Holt,           // double exponential with jitter and deviation clamping
+                    OneEuro,        // speed adaptive low pass
+                };
+
+                enum class OrientationFilterType
+                {
+                    None,
+                    Nlerp,
+                    Slerp,
+                };
+
+                struct JointFilterParameters
+                {
+                    PositionFilterType PositionFilter;
+
+                    // Holt, same meaning as the v1 SDK transform smoothing parameters
+                    float Smoothing;            // [0..1], weight of the previous estimate
+                    float Correction;           // [0..1], how quickly the trend follows the data
+                    float Prediction;           // frames to predict ahead
+                    float JitterRadius;         // meters, smaller moves are damped
+                    float MaxDeviationRadius;   // meters, furthest the output may be from the raw position
+
+                    // One Euro
+                    float MinCutoff;            // Hz at rest
+                    float Beta;                 // Hz added per m/s of joint speed
+                    float DerivativeCutoff;     // Hz for the speed estimate
+
+                    OrientationFilterType OrientationFilter;
+                    float OrientationSmoothing; // [0..1], weight of the previous orientation
+
+                    JointFilterParameters()
+                        : PositionFilter(PositionFilterType::Holt)
+                        , Smoothing(0.5f)
+                        , Correction(0.5f)
+                        , Prediction(0.5f)
+                        , JitterRadius(0.05f)
+                        , MaxDeviationRadius(0.04f)
+                        , MinCutoff(1.0f)
+                        , Beta(0.5f)
+                        , DerivativeCutoff(1.0f)
+                        , OrientationFilter(OrientationFilterType::Nlerp)
+                        , OrientationSmoothing(0.7f)
+                    {
+                    }
+                };
+
+                // accumulated over tracked joints since the last ResetStatistics
+                struct JointFilterStatistics
+                {
+                    UINT    Samples;
+                    float   RawJitter;          // mean acceleration of the input, meters per frame squared
+                    float   FilteredJitter;     // mean acceleration of the output
+                    float   MeanLag;            // mean distance between output and input, meters
+                };
+
+                // smooths the joints of all bodies at once, 4 joints per vector operation
+                class JointFilter
+                {
+                public:
+                    JointFilter();
+
+                    void SetParameters(_In_ const JointFilterParameters& parameters);
+                    void SetJointParameters(WRK::JointType joint, _In_ const JointFilterParameters& parameters);
+                    const JointFilterParameters& GetJointParameters(WRK::JointType joint) const { return _jointParameters[static_cast<UINT>(joint)]; }
+
+                    void Reset();
+
+                    // filters one frame into GetFiltered()
+                    void Update(_In_ const BodyFrameData& frame);
+
+                    const BodyFrameData& GetFiltered() const { return _filtered; }
+
+                    void GetStatistics(_Out_ JointFilterStatistics* pStatistics) const;
+                    void ResetStatistics();
+
+                private:
+                    void UpdateLanes();
+                    void UpdateValidity(_In_ const BodyFrameData& frame);
+                    void FilterPositions(_In_ const BodyFrameData& frame, float deltaTime);
+                    void FilterOrientations(_In_ const BodyFrameData& frame);
+                    void AccumulateStatistics(_In_ const BodyFrameData& frame);
+
+                private:
+                    JointFilterParameters   _jointParameters[JOINT_COUNT];
+                    BOOL                    _lanesChanged;
+
+                    // per joint parameters replicated over the body lanes
+                    float   _smoothing[BODY_JOINT_STRIDE];
+                    float   _correction[BODY_JOINT_STRIDE];
+                    float   _prediction[BODY_JOINT_STRIDE];
+                    float   _jitterRadius[BODY_JOINT_STRIDE];
+                    float   _maxDeviation[BODY_JOINT_STRIDE];
+                    float   _minCutoff[BODY_JOINT_STRIDE];
+                    float   _beta[BODY_JOINT_STRIDE];
+                    float   _derivativeCutoff[BODY_JOINT_STRIDE];
+                    float   _orientationWeight[BODY_JOINT_STRIDE];
+
+                    // all bits set where the lane uses the filter
+                    UINT    _holtMask[BODY_JOINT_STRIDE];
+                    UINT    _oneEuroMask[BODY_JOINT_STRIDE];
+                    UINT    _slerpMask[BODY_JOINT_STRIDE];
+                    UINT    _orientationMask[BODY_JOINT_STRIDE];
+                    BOOL    _anyHolt;
+                    BOOL    _anyOneEuro;
+                    BOOL    _anySlerp;
+
+                    // filter state, the trend is the Holt trend or the One Euro speed estimate
+                    float   _stateX[BODY_JOINT_STRIDE];
+                    float   _stateY[BODY_JOINT_STRIDE];
+                    float   _stateZ[BODY_JOINT_STRIDE];
+                    float   _trendX[BODY_JOINT_STRIDE];
+                    float   _trendY[BODY_JOINT_STRIDE];
+                    float   _trendZ[BODY_JOINT_STRIDE];
+                    float   _rotationX[BODY_JOINT_STRIDE];
+                    float   _rotationY[BODY_JOINT_STRIDE];
+                    float   _rotationZ[BODY_JOINT_STRIDE];
+                    float   _rotationW[BODY_JOINT_STRIDE];
+                    UINT    _positionValid[BODY_JOINT_STRIDE];
+                    UINT    _orientationValid[BODY_JOINT_STRIDE];
+                    UINT    _holdMask[BODY_JOINT_STRIDE];   // all bits set for the joints of bodies held by BodyTracker
+
+                    UINT64  _trackingId[BODY_COUNT];
+                    INT64   _lastTime;
+
+                    BodyFrameData   _filtered;
+
+                    // previous input and output positions and velocities for the statistics
+                    enum StatisticsRow { RawPosition = 0, RawVelocity = 3, FilteredPosition = 6, FilteredVelocity = 9, StatisticsRows = 12 };
+                    float   _statistics[StatisticsRows][BODY_JOINT_STRIDE];
+                    BYTE    _statisticsHistory[BODY_JOINT_STRIDE];
+                    UINT    _samples;
+                    double  _rawJitterSum;
+                    double  _filteredJitterSum;
+                    double  _lagSum;
+                };
+
+            }
+        }
+    }
+}
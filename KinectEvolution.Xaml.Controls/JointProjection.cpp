@@ -0,0 +1,335 @@
+//------------------------------------------------------------------------------
+// <copyright file="JointProjection.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "JointProjection.h"
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace WindowsPreview::Kinect;
+
+// joints closer to the camera plane than this are not projected
+static const float MIN_DEPTH = 0.05f;
+
+inline XMVECTOR LoadLanes(_In_reads_(4) const float* pSource)
+{
+    return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource));
+}
+
+inline void StoreLanes(_Out_writes_(4) float* pDestination, FXMVECTOR value)
+{
+    XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pDestination), value);
+}
+
+// 3 x 3 system with the right hand side in the last column, by elimination with partial pivoting
+static bool SolveNormalEquations(_Inout_ double system[3][4], _Out_writes_(3) double* pSolution)
+{
+    for (UINT column = 0; column < 3; ++column)
+    {
+        UINT pivot = column;
+        for (UINT row = column + 1; row < 3; ++row)
+        {
+            if (fabs(system[row][column]) > fabs(system[pivot][column]))
+            {
+                pivot = row;
+            }
+        }
+
+        if (fabs(system[pivot][column]) < 1e-12)
+        {
+            return false;
+        }
+
+        for (UINT i = 0; i < 4; ++i)
+        {
+            std::swap(system[column][i], system[pivot][i]);
+        }
+
+        for (UINT row = column + 1; row < 3; ++row)
+        {
+            double factor = system[row][column] / system[column][column];
+            for (UINT i = column; i < 4; ++i)
+            {
+                system[row][i] -= factor * system[column][i];
+            }
+        }
+    }
+
+    for (int row = 2; row >= 0; --row)
+    {
+        double sum = system[row][3];
+        for (UINT column = row + 1; column < 3; ++column)
+        {
+            sum -= system[row][column] * pSolution[column];
+        }
+
+        pSolution[row] = sum / system[row][row];
+    }
+
+    return true;
+}
+
+CameraModel CameraModel::GetDefault(Body2DMode mode)
+{
+    CameraModel camera;
+    ZeroMemory(&camera, sizeof(camera));
+    XMStoreFloat3x3(&camera.Rotation, XMMatrixIdentity());
+
+    if (Body2DMode::Color == mode)
+    {
+        // the color camera sits about 5 cm to the right of the depth camera, seen from the sensor
+        camera.FocalLengthX = 1081.37f;
+        camera.FocalLengthY = 1081.37f;
+        camera.PrincipalPointX = 959.5f;
+        camera.PrincipalPointY = 539.5f;
+        camera.Translation = XMFLOAT3(0.052f, 0.0f, 0.0f);
+        camera.Width = 1920;
+        camera.Height = 1080;
+    }
+    else
+    {
+        camera.FocalLengthX = 364.8f;
+        camera.FocalLengthY = 364.8f;
+        camera.PrincipalPointX = 256.5f;
+        camera.PrincipalPointY = 206.2f;
+        camera.RadialDistortion2 = 0.09f;
+        camera.RadialDistortion4 = -0.27f;
+        camera.RadialDistortion6 = 0.09f;
+        camera.Width = 512;
+        camera.Height = 424;
+    }
+
+    return camera;
+}
+
+CameraModel CameraModel::FromIntrinsics(WRK::CameraIntrinsics intrinsics)
+{
+    CameraModel camera = GetDefault(Body2DMode::DepthIR);
+
+    camera.FocalLengthX = intrinsics.FocalLengthX;
+    camera.FocalLengthY = intrinsics.FocalLengthY;
+    camera.PrincipalPointX = intrinsics.PrincipalPointX;
+    camera.PrincipalPointY = intrinsics.PrincipalPointY;
+    camera.RadialDistortion2 = intrinsics.RadialDistortionSecondOrder;
+    camera.RadialDistortion4 = intrinsics.RadialDistortionFourthOrder;
+    camera.RadialDistortion6 = intrinsics.RadialDistortionSixthOrder;
+
+    return camera;
+}
+
+bool CameraModel::Fit(
+    _In_reads_(count) const XMFLOAT3* pPoints,
+    _In_reads_(count) const XMFLOAT2* pPixels,
+    UINT count,
+    UINT width,
+    UINT height,
+    _Out_ CameraModel* pCamera)
+{
+    *pCamera = GetDefault(Body2DMode::Color);
+    pCamera->Width = width;
+    pCamera->Height = height;
+
+    // u = fx (x + tx) / z + cx and v = -fy (y + ty) / z + cy are linear in fx, fx tx, cx and fy, fy ty, cy
+    double normalU[3][4] = {};
+    double normalV[3][4] = {};
+    UINT used = 0;
+
+    for (UINT i = 0; i < count; ++i)
+    {
+        const XMFLOAT3& point = pPoints[i];
+        const XMFLOAT2& pixel = pPixels[i];
+        if (point.z <= MIN_DEPTH || !_finite(pixel.x) || !_finite(pixel.y))
+        {
+            continue;
+        }
+
+        double invZ = 1.0 / point.z;
+        double featuresU[3] = { point.x * invZ, invZ, 1.0 };
+        double featuresV[3] = { -point.y * invZ, -invZ, 1.0 };
+
+        for (UINT row = 0; row < 3; ++row)
+        {
+            for (UINT column = 0; column < 3; ++column)
+            {
+                normalU[row][column] += featuresU[row] * featuresU[column];
+                normalV[row][column] += featuresV[row] * featuresV[column];
+            }
+
+            normalU[row][3] += featuresU[row] * pixel.x;
+            normalV[row][3] += featuresV[row] * pixel.y;
+        }
+
+        ++used;
+    }
+
+    double solutionU[3];
+    double solutionV[3];
+    if (used < 6 || !SolveNormalEquations(normalU, solutionU) || !SolveNormalEquations(normalV, solutionV))
+    {
+        return false;
+    }
+
+    pCamera->FocalLengthX = static_cast<float>(solutionU[0]);
+    pCamera->FocalLengthY = static_cast<float>(solutionV[0]);
+    pCamera->PrincipalPointX = static_cast<float>(solutionU[2]);
+    pCamera->PrincipalPointY = static_cast<float>(solutionV[2]);
+    pCamera->Translation = XMFLOAT3(static_cast<float>(solutionU[1] / solutionU[0]), static_cast<float>(solutionV[1] / solutionV[0]), 0.0f);
+
+    return true;
+}
+
+JointProjection::JointProjection()
+    : _camera(CameraModel::GetDefault(Body2DMode::DepthIR))
+{
+    ZeroMemory(_pixelX, sizeof(_pixelX));
+    ZeroMemory(_pixelY, sizeof(_pixelY));
+    ZeroMemory(_valid, sizeof(_valid));
+}
+
+void JointProjection::Project(_In_ const BodyFrameData& frame)
+{
+    const XMFLOAT3X3& r = _camera.Rotation;
+    const XMVECTOR r00 = XMVectorReplicate(r._11), r01 = XMVectorReplicate(r._12), r02 = XMVectorReplicate(r._13);
+    const XMVECTOR r10 = XMVectorReplicate(r._21), r11 = XMVectorReplicate(r._22), r12 = XMVectorReplicate(r._23);
+    const XMVECTOR r20 = XMVectorReplicate(r._31), r21 = XMVectorReplicate(r._32), r22 = XMVectorReplicate(r._33);
+    const XMVECTOR tx = XMVectorReplicate(_camera.Translation.x);
+    const XMVECTOR ty = XMVectorReplicate(_camera.Translation.y);
+    const XMVECTOR tz = XMVectorReplicate(_camera.Translation.z);
+
+    const XMVECTOR fx = XMVectorReplicate(_camera.FocalLengthX);
+    const XMVECTOR fy = XMVectorReplicate(_camera.FocalLengthY);
+    const XMVECTOR cx = XMVectorReplicate(_camera.PrincipalPointX);
+    const XMVECTOR cy = XMVectorReplicate(_camera.PrincipalPointY);
+    const XMVECTOR k2 = XMVectorReplicate(_camera.RadialDistortion2);
+    const XMVECTOR k4 = XMVectorReplicate(_camera.RadialDistortion4);
+    const XMVECTOR k6 = XMVectorReplicate(_camera.RadialDistortion6);
+    const XMVECTOR one = XMVectorSplatOne();
+    const XMVECTOR minDepth = XMVectorReplicate(MIN_DEPTH);
+    const XMVECTOR notTracked = XMVectorZero();
+
+    // body validity spread over the joint lanes
+    UINT bodyMask[BODY_JOINT_STRIDE];
+    for (UINT i = 0; i < BODY_JOINT_STRIDE; ++i)
+    {
+        bodyMask[i] = (i < BODY_JOINT_COUNT && frame.IsTracked[i / JOINT_COUNT]) ? 0xFFFFFFFF : 0;
+    }
+
+    for (UINT i = 0; i < BODY_JOINT_STRIDE; i += 4)
+    {
+        XMVECTOR x = LoadLanes(&frame.PositionX[i]);
+        XMVECTOR y = LoadLanes(&frame.PositionY[i]);
+        XMVECTOR z = LoadLanes(&frame.PositionZ[i]);
+
+        XMVECTOR cameraX = XMVectorMultiplyAdd(r00, x, XMVectorMultiplyAdd(r01, y, XMVectorMultiplyAdd(r02, z, tx)));
+        XMVECTOR cameraY = XMVectorMultiplyAdd(r10, x, XMVectorMultiplyAdd(r11, y, XMVectorMultiplyAdd(r12, z, ty)));
+        XMVECTOR cameraZ = XMVectorMultiplyAdd(r20, x, XMVectorMultiplyAdd(r21, y, XMVectorMultiplyAdd(r22, z, tz)));
+
+        // camera space y is up, image rows go down
+        XMVECTOR front = XMVectorGreater(cameraZ, minDepth);
+        XMVECTOR invZ = XMVectorReciprocal(XMVectorSelect(one, cameraZ, front));
+        XMVECTOR nx = cameraX * invZ;
+        XMVECTOR ny = XMVectorNegate(cameraY) * invZ;
+
+        XMVECTOR r2 = XMVectorMultiplyAdd(nx, nx, ny * ny);
+        XMVECTOR distortion = XMVectorMultiplyAdd(XMVectorMultiplyAdd(XMVectorMultiplyAdd(k6, r2, k4), r2, k2), r2, one);
+
+        StoreLanes(&_pixelX[i], XMVectorMultiplyAdd(fx, nx * distortion, cx));
+        StoreLanes(&_pixelY[i], XMVectorMultiplyAdd(fy, ny * distortion, cy));
+
+        XMVECTOR trackingState = XMLoadInt4(reinterpret_cast<const uint32_t*>(&frame.TrackingState[i]));
+        XMVECTOR valid = XMVectorAndInt(XMVectorAndInt(front, XMVectorNotEqualInt(trackingState, notTracked)),
+            XMLoadInt4(reinterpret_cast<const uint32_t*>(&bodyMask[i])));
+        XMStoreInt4(reinterpret_cast<uint32_t*>(&_valid[i]), valid);
+    }
+}
+
+void JointProjection::SetPixels(_In_ const BodyFrameData& frame, _In_reads_(BODY_JOINT_COUNT) const XMFLOAT2* pPixels)
+{
+    for (UINT i = 0; i < BODY_JOINT_STRIDE; ++i)
+    {
+        BOOL inFrame = i < BODY_JOINT_COUNT;
+        _pixelX[i] = inFrame ? pPixels[i].x : 0.0f;
+        _pixelY[i] = inFrame ? pPixels[i].y : 0.0f;
+
+        // the mapper gives joints it cannot map an infinite pixel
+        BOOL valid = inFrame && frame.IsTracked[i / JOINT_COUNT] && TrackingState::NotTracked != frame.TrackingState[i] &&
+            _finite(_pixelX[i]) && _finite(_pixelY[i]);
+        _valid[i] = valid ? 0xFFFFFFFF : 0;
+    }
+}
+
+float JointProjection::GetMaxDistance(_In_ const JointProjection& other) const
+{
+    float distance = 0.0f;
+
+    for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+    {
+        if (0 == _valid[i] || 0 == other._valid[i])
+        {
+            continue;
+        }
+
+        float dx = _pixelX[i] - other._pixelX[i];
+        float dy = _pixelY[i] - other._pixelY[i];
+        distance = max(distance, sqrtf(dx * dx + dy * dy));
+    }
+
+    return distance;
+}
+
+void JointProjection::GetBoneLines(_In_ const BodyFrameData& frame, _Inout_ std::vector<OverlayVertex>& lines) const
+{
+    lines.clear();
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        if (!frame.IsTracked[bodyIndex])
+        {
+            continue;
+        }
+
+        for (UINT boneIndex = 0; boneIndex < BONE_COUNT; ++boneIndex)
+        {
+            UINT a = BodyJointIndex(bodyIndex, static_cast<UINT>(BodyBones[boneIndex].JointA));
+            UINT b = BodyJointIndex(bodyIndex, static_cast<UINT>(BodyBones[boneIndex].JointB));
+            if (0 == _valid[a] || 0 == _valid[b])
+            {
+                continue;
+            }
+
+            OverlayVertex vertex;
+            vertex.BodyIndex = bodyIndex;
+            vertex.Inferred = (frame.TrackingState[a] != TrackingState::Tracked || frame.TrackingState[b] != TrackingState::Tracked);
+
+            vertex.Position = XMFLOAT2(_pixelX[a], _pixelY[a]);
+            lines.push_back(vertex);
+            vertex.Position = XMFLOAT2(_pixelX[b], _pixelY[b]);
+            lines.push_back(vertex);
+        }
+    }
+}
+
+void JointProjection::GetJointPoints(_In_ const BodyFrameData& frame, _Inout_ std::vector<OverlayVertex>& points) const
+{
+    points.clear();
+
+    float width = static_cast<float>(_camera.Width);
+    float height = static_cast<float>(_camera.Height);
+
+    for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+    {
+        if (0 == _valid[i] || _pixelX[i] < 0.0f || _pixelY[i] < 0.0f || _pixelX[i] >= width || _pixelY[i] >= height)
+        {
+            continue;
+        }
+
+        OverlayVertex vertex;
+        vertex.Position = XMFLOAT2(_pixelX[i], _pixelY[i]);
+        vertex.BodyIndex = i / JOINT_COUNT;
+        vertex.Inferred = (frame.TrackingState[i] != TrackingState::Tracked);
+        points.push_back(vertex);
+    }
+}
@@ -0,0 +1,105 @@
+//------------------------------------------------------------------------------
+// <copyright file="JointProjection.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                enum class Body2DMode
+                {
+                    DepthIR,
+                    Color,
+                };
+
+                // pinhole camera with the sensor's radial distortion, placed relative to camera space.
+                // the defaults are typical factory values; SkeletonOverlay takes the depth intrinsics of a connected
+                // sensor from CoordinateMapper::GetDepthCameraIntrinsics and fits the color camera to the mapper
+                struct CameraModel
+                {
+                    float       FocalLengthX;
+                    float       FocalLengthY;
+                    float       PrincipalPointX;
+                    float       PrincipalPointY;
+                    float       RadialDistortion2;      // second, fourth and sixth order
+                    float       RadialDistortion4;
+                    float       RadialDistortion6;
+                    XMFLOAT3X3  Rotation;               // camera space to this camera
+                    XMFLOAT3    Translation;            // meters, added after the rotation
+                    UINT        Width;
+                    UINT        Height;
+
+                    static CameraModel GetDefault(Body2DMode mode);
+
+                    // depth camera from the intrinsics reported by the sensor
+                    static CameraModel FromIntrinsics(WRK::CameraIntrinsics intrinsics);
+
+                    // least squares pinhole without distortion from camera space points and the pixels another mapping
+                    // puts them at, with no rotation and a translation across the image; false when the points are too
+                    // few or all at one depth
+                    static bool Fit(
+                        _In_reads_(count) const XMFLOAT3* pPoints,
+                        _In_reads_(count) const XMFLOAT2* pPixels,
+                        UINT count,
+                        UINT width,
+                        UINT height,
+                        _Out_ CameraModel* pCamera);
+                };
+
+                struct OverlayVertex
+                {
+                    XMFLOAT2    Position;       // pixels
+                    UINT        BodyIndex;
+                    BOOL        Inferred;       // either end of a bone is inferred
+                };
+
+                // maps the joints of all bodies to image pixels at once, 4 joints per vector operation,
+                // instead of a CoordinateMapper call per joint
+                class JointProjection
+                {
+                public:
+                    JointProjection();
+
+                    void SetCamera(_In_ const CameraModel& camera) { _camera = camera; }
+                    const CameraModel& GetCamera() const { return _camera; }
+
+                    void Project(_In_ const BodyFrameData& frame);
+
+                    // pixels mapped elsewhere, by BodyJointIndex; joints are valid as in Project where the pixel is finite
+                    void SetPixels(_In_ const BodyFrameData& frame, _In_reads_(BODY_JOINT_COUNT) const XMFLOAT2* pPixels);
+
+                    // largest pixel distance to another projection over the joints valid in both, 0 with none
+                    float GetMaxDistance(_In_ const JointProjection& other) const;
+
+                    // pixels of the last Project, valid where the joint is tracked and in front of the camera
+                    const float* GetPixelX() const { return _pixelX; }
+                    const float* GetPixelY() const { return _pixelY; }
+                    BOOL IsValid(UINT bodyIndex, UINT jointIndex) const { return 0 != _valid[BodyJointIndex(bodyIndex, jointIndex)]; }
+
+                    // two vertices per bone with both ends valid, a line list
+                    void GetBoneLines(_In_ const BodyFrameData& frame, _Inout_ std::vector<OverlayVertex>& lines) const;
+
+                    // one vertex per valid joint inside the image, a point list
+                    void GetJointPoints(_In_ const BodyFrameData& frame, _Inout_ std::vector<OverlayVertex>& points) const;
+
+                private:
+                    CameraModel _camera;
+
+                    float       _pixelX[BODY_JOINT_STRIDE];
+                    float       _pixelY[BODY_JOINT_STRIDE];
+                    UINT        _valid[BODY_JOINT_STRIDE];
+                };
+
+            }
+        }
+    }
+}
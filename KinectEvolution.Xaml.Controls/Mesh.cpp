@@ -102,3 +102,29 @@ void Mesh::Render(_In_ ID3D11DeviceContext1* pD3DContext, D3D11_PRIMITIVE_TOPOLO
         pD3DContext->Draw(_numVertices, 0);
     }
 }
+
+void Mesh::RenderTriangleListInstanced(
+    _In_ ID3D11DeviceContext1* pD3DContext,
+    _In_ ID3D11Buffer* pInstanceBuffer,
+    UINT instanceStride,
+    UINT instanceCount)
+{
+    pD3DContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    // slot 0 per vertex, slot 1 per instance
+    ID3D11Buffer* buffers[] = { _vertexBuffer.Get(), pInstanceBuffer };
+    UINT strides[] = { _vertexStride, instanceStride };
+    UINT offsets[] = { 0, 0 };
+
+    pD3DContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+
+    if (_numIndices > 0)
+    {
+        pD3DContext->IASetIndexBuffer(_indexBuffer.Get(), _use16BitIndex ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+        pD3DContext->DrawIndexedInstanced(_numIndices, instanceCount, 0, 0, 0);
+    }
+    else
+    {
+        pD3DContext->DrawInstanced(_numVertices, instanceCount, 0, 0);
+    }
+}
@@ -28,6 +28,9 @@ namespace KinectEvolution {
                     void RenderLineList(_In_ ID3D11DeviceContext1* pD3DContext, BOOL useIndex);
                     void RenderPointList(_In_ ID3D11DeviceContext1* pD3DContext);
 
+                    // draws instanceCount copies with per instance data from pInstanceBuffer in slot 1
+                    void RenderTriangleListInstanced(_In_ ID3D11DeviceContext1* pD3DContext, _In_ ID3D11Buffer* pInstanceBuffer, UINT instanceStride, UINT instanceCount);
+
                 protected private:
                     virtual BOOL IsLoadingComplete() = 0;
 
@@ -0,0 +1,503 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseIndex.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "PoseIndex.h"
+
+#include <algorithm>
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace DirectX::PackedVector;
+using namespace WindowsPreview::Kinect;
+
+inline bool CloserThan(const PoseMatch& a, const PoseMatch& b)
+{
+    return a.Distance < b.Distance || (a.Distance == b.Distance && a.PoseId < b.PoseId);
+}
+
+// the joints ComputeGestureFeatures builds the body frame from
+inline bool HasBodyFrame(_In_ const BodyFrameData& frame, UINT bodyIndex)
+{
+    static const JointType FrameJoints [] =
+    {
+        JointType::SpineBase,
+        JointType::SpineShoulder,
+        JointType::ShoulderLeft,
+        JointType::ShoulderRight,
+    };
+
+    if (!frame.IsTracked[bodyIndex])
+    {
+        return false;
+    }
+
+    for (JointType joint : FrameJoints)
+    {
+        if (TrackingState::NotTracked == frame.GetTrackingState(bodyIndex, static_cast<UINT>(joint)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// queries are kept in the stored units, so a distance converts the stored shorts without scaling them
+static const float STORED_SCALE = 32767.0f;
+
+inline void LoadQuery(_In_reads_(POSE_FEATURE_COUNT) const XMFLOAT4* pFeatures, _Out_writes_(POSE_FEATURE_COUNT) XMVECTOR* pQuery)
+{
+    for (UINT i = 0; i < POSE_FEATURE_COUNT; ++i)
+    {
+        pQuery[i] = XMLoadFloat4(&pFeatures[i]) * XMVectorReplicate(STORED_SCALE);
+    }
+}
+
+inline XMVECTOR LoadStored(_In_ const XMSHORTN4* pFeature)
+{
+    return XMLoadShort4(reinterpret_cast<const XMSHORT4*>(pFeature));
+}
+
+inline void LoadStoredQuery(_In_reads_(POSE_FEATURE_COUNT) const XMSHORTN4* pFeatures, _Out_writes_(POSE_FEATURE_COUNT) XMVECTOR* pQuery)
+{
+    for (UINT i = 0; i < POSE_FEATURE_COUNT; ++i)
+    {
+        pQuery[i] = LoadStored(&pFeatures[i]);
+    }
+}
+
+inline void PrefetchFeatures(_In_reads_(POSE_FEATURE_COUNT) const XMSHORTN4* pFeatures)
+{
+    const char* pBytes = reinterpret_cast<const char*>(pFeatures);
+    for (UINT offset = 0; offset < POSE_FEATURE_COUNT * sizeof(XMSHORTN4); offset += 64)
+    {
+        _mm_prefetch(pBytes + offset, _MM_HINT_T0);
+    }
+    _mm_prefetch(pBytes + POSE_FEATURE_COUNT * sizeof(XMSHORTN4) - 1, _MM_HINT_T0);
+}
+
+// the w of the features is zero. two sums, so each add does not wait on the one before
+inline float FeatureDistance(_In_reads_(POSE_FEATURE_COUNT) const XMVECTOR* pQuery, _In_reads_(POSE_FEATURE_COUNT) const XMSHORTN4* pFeatures)
+{
+    XMVECTOR even = XMVectorZero();
+    XMVECTOR odd = XMVectorZero();
+
+    UINT i = 0;
+    for (; i + 1 < POSE_FEATURE_COUNT; i += 2)
+    {
+        XMVECTOR evenDifference = pQuery[i] - LoadStored(&pFeatures[i]);
+        XMVECTOR oddDifference = pQuery[i + 1] - LoadStored(&pFeatures[i + 1]);
+        even = XMVectorMultiplyAdd(evenDifference, evenDifference, even);
+        odd = XMVectorMultiplyAdd(oddDifference, oddDifference, odd);
+    }
+
+    if (i < POSE_FEATURE_COUNT)
+    {
+        XMVECTOR difference = pQuery[i] - LoadStored(&pFeatures[i]);
+        even = XMVectorMultiplyAdd(difference, difference, even);
+    }
+
+    return XMVectorGetX(XMVector4Dot(even + odd, XMVectorSplatOne())) * (1.0f / (STORED_SCALE * STORED_SCALE));
+}
+
+PoseIndex::PoseIndex()
+{
+    Reset(PoseIndexParameters());
+}
+
+void PoseIndex::Reset(_In_ const PoseIndexParameters& parameters)
+{
+    _parameters = parameters;
+    _parameters.Connections = max(2u, _parameters.Connections);
+    _parameters.BuildCandidates = max(_parameters.Connections, _parameters.BuildCandidates);
+    _parameters.SearchCandidates = max(1u, _parameters.SearchCandidates);
+
+    // layer sizes shrink by the number of connections, the graph stays navigable at every scale
+    _levelScale = 1.0f / logf(static_cast<float>(_parameters.Connections));
+    _random = 0x9E3779B97F4A7C15ull;
+
+    _features.clear();
+    _frameIndex.clear();
+    _bodyIndex.clear();
+    _level.clear();
+    _links.clear();
+    _upperLinks.clear();
+    _upperOffset.clear();
+
+    _entry = 0;
+    _topLevel = 0;
+
+    _visited.clear();
+    _visitMark = 0;
+    _distanceCount = 0;
+}
+
+size_t PoseIndex::GetStorageSize() const
+{
+    return _features.size() * sizeof(XMSHORTN4) +
+        _frameIndex.size() * sizeof(UINT) +
+        _bodyIndex.size() + _level.size() +
+        (_links.size() + _upperLinks.size() + _upperOffset.size() + _visited.size()) * sizeof(UINT);
+}
+
+float PoseIndex::Distance(_In_reads_(POSE_FEATURE_COUNT) const XMVECTOR* pQuery, UINT poseId)
+{
+    ++_distanceCount;
+    return FeatureDistance(pQuery, GetFeatures(poseId));
+}
+
+float PoseIndex::Distance(UINT poseA, UINT poseB)
+{
+    XMVECTOR query[POSE_FEATURE_COUNT];
+    LoadStoredQuery(GetFeatures(poseA), query);
+
+    return Distance(query, poseB);
+}
+
+UINT* PoseIndex::GetLinks(UINT poseId, UINT level)
+{
+    if (0 == level)
+    {
+        return &_links[poseId * (1 + GetMaxLinks(0))];
+    }
+
+    return &_upperLinks[_upperOffset[poseId] + (level - 1) * (1 + GetMaxLinks(level))];
+}
+
+UINT PoseIndex::RandomLevel()
+{
+    // xorshift64*
+    _random ^= _random >> 12;
+    _random ^= _random << 25;
+    _random ^= _random >> 27;
+    UINT64 bits = _random * 0x2545F4914F6CDD1Dull;
+
+    // uniform in (0, 1], so the log is finite
+    double uniform = static_cast<double>((bits >> 11) + 1) / 9007199254740992.0;
+
+    return min(MAX_LEVELS - 1, static_cast<UINT>(-log(uniform) * _levelScale));
+}
+
+void PoseIndex::NextVisit()
+{
+    if (0 == ++_visitMark)
+    {
+        std::fill(_visited.begin(), _visited.end(), 0u);
+        _visitMark = 1;
+    }
+}
+
+UINT PoseIndex::SearchGreedy(_In_reads_(POSE_FEATURE_COUNT) const XMVECTOR* pQuery, UINT entry, UINT level)
+{
+    float best = Distance(pQuery, entry);
+
+    for (bool moved = true; moved;)
+    {
+        moved = false;
+
+        const UINT* pLinks = GetLinks(entry, level);
+        for (UINT i = 1; i <= pLinks[0]; ++i)
+        {
+            float distance = Distance(pQuery, pLinks[i]);
+            if (distance < best)
+            {
+                best = distance;
+                entry = pLinks[i];
+                moved = true;
+            }
+        }
+    }
+
+    return entry;
+}
+
+void PoseIndex::SearchLayer(_In_reads_(POSE_FEATURE_COUNT) const XMVECTOR* pQuery, UINT entry, UINT level, UINT candidateCount)
+{
+    auto nearer = [](const Candidate& a, const Candidate& b) { return a.Distance < b.Distance; };
+    auto farther = [](const Candidate& a, const Candidate& b) { return a.Distance > b.Distance; };
+
+    NextVisit();
+    _candidates.clear();
+    _results.clear();
+
+    Candidate start = { Distance(pQuery, entry), entry };
+    _visited[entry] = _visitMark;
+    _candidates.push_back(start);
+    _results.push_back(start);
+
+    while (!_candidates.empty())
+    {
+        std::pop_heap(_candidates.begin(), _candidates.end(), farther);
+        Candidate current = _candidates.back();
+        _candidates.pop_back();
+
+        // every candidate left is farther than the worst result
+        if (current.Distance > _results.front().Distance && _results.size() >= candidateCount)
+        {
+            break;
+        }
+
+        // the neighbours are scattered over the store, start all their loads before the first distance
+        const UINT* pLinks = GetLinks(current.PoseId, level);
+        for (UINT i = 1; i <= pLinks[0]; ++i)
+        {
+            if (_visitMark != _visited[pLinks[i]])
+            {
+                PrefetchFeatures(GetFeatures(pLinks[i]));
+            }
+        }
+
+        for (UINT i = 1; i <= pLinks[0]; ++i)
+        {
+            UINT neighbour = pLinks[i];
+            if (_visitMark == _visited[neighbour])
+            {
+                continue;
+            }
+            _visited[neighbour] = _visitMark;
+
+            float distance = Distance(pQuery, neighbour);
+            if (_results.size() < candidateCount || distance < _results.front().Distance)
+            {
+                Candidate candidate = { distance, neighbour };
+
+                _candidates.push_back(candidate);
+                std::push_heap(_candidates.begin(), _candidates.end(), farther);
+
+                _results.push_back(candidate);
+                std::push_heap(_results.begin(), _results.end(), nearer);
+                if (_results.size() > candidateCount)
+                {
+                    std::pop_heap(_results.begin(), _results.end(), nearer);
+                    _results.pop_back();
+                }
+            }
+        }
+    }
+}
+
+void PoseIndex::SelectNeighbours(_Inout_ std::vector<Candidate>& candidates, UINT maxCount)
+{
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.Distance < b.Distance; });
+
+    if (candidates.size() <= maxCount)
+    {
+        return;
+    }
+
+    // a candidate nearer to a kept neighbour than to the pose is reached through that neighbour
+    UINT kept = 0;
+    for (size_t i = 0; i < candidates.size() && kept < maxCount; ++i)
+    {
+        bool keep = true;
+        for (UINT j = 0; j < kept && keep; ++j)
+        {
+            keep = Distance(candidates[i].PoseId, candidates[j].PoseId) >= candidates[i].Distance;
+        }
+
+        if (keep)
+        {
+            candidates[kept++] = candidates[i];
+        }
+    }
+
+    candidates.resize(kept);
+}
+
+void PoseIndex::Connect(UINT poseId, UINT neighbourId, UINT level)
+{
+    UINT* pLinks = GetLinks(poseId, level);
+    UINT maxLinks = GetMaxLinks(level);
+
+    if (pLinks[0] < maxLinks)
+    {
+        pLinks[1 + pLinks[0]++] = neighbourId;
+        return;
+    }
+
+    // full, choose again among the old links and the new one
+    _neighbours.clear();
+    for (UINT i = 1; i <= pLinks[0]; ++i)
+    {
+        Candidate candidate = { Distance(poseId, pLinks[i]), pLinks[i] };
+        _neighbours.push_back(candidate);
+    }
+    Candidate added = { Distance(poseId, neighbourId), neighbourId };
+    _neighbours.push_back(added);
+
+    SelectNeighbours(_neighbours, maxLinks);
+
+    pLinks[0] = static_cast<UINT>(_neighbours.size());
+    for (UINT i = 0; i < pLinks[0]; ++i)
+    {
+        pLinks[1 + i] = _neighbours[i].PoseId;
+    }
+}
+
+bool PoseIndex::AddPose(_In_ const BodyFrameData& frame, UINT bodyIndex, UINT frameIndex)
+{
+    if (!HasBodyFrame(frame, bodyIndex))
+    {
+        return false;
+    }
+
+    XMFLOAT4 features[POSE_FEATURE_COUNT];
+    ComputeGestureFeatures(frame, bodyIndex, features);
+
+    AddFeatures(features, frameIndex, bodyIndex);
+
+    return true;
+}
+
+UINT PoseIndex::AddFeatures(_In_reads_(POSE_FEATURE_COUNT) const XMFLOAT4* pFeatures, UINT frameIndex, UINT bodyIndex)
+{
+    UINT poseId = GetPoseCount();
+    UINT level = RandomLevel();
+
+    _features.resize(_features.size() + POSE_FEATURE_COUNT);
+    XMSHORTN4* pStored = &_features[poseId * POSE_FEATURE_COUNT];
+    for (UINT i = 0; i < POSE_FEATURE_COUNT; ++i)
+    {
+        XMStoreShortN4(&pStored[i], XMLoadFloat4(&pFeatures[i]));
+    }
+
+    _frameIndex.push_back(frameIndex);
+    _bodyIndex.push_back(static_cast<BYTE>(bodyIndex));
+    _level.push_back(static_cast<BYTE>(level));
+    _visited.push_back(0);
+
+    _links.resize(_links.size() + 1 + GetMaxLinks(0), 0);
+    _upperOffset.push_back(static_cast<UINT>(_upperLinks.size()));
+    _upperLinks.resize(_upperLinks.size() + level * (1 + GetMaxLinks(1)), 0);
+
+    if (0 == poseId)
+    {
+        _entry = poseId;
+        _topLevel = level;
+        return poseId;
+    }
+
+    // the stored values, so the links agree with the distances searches see
+    XMVECTOR query[POSE_FEATURE_COUNT];
+    LoadStoredQuery(pStored, query);
+
+    UINT entry = _entry;
+    for (UINT l = _topLevel; l > level; --l)
+    {
+        entry = SearchGreedy(query, entry, l);
+    }
+
+    for (int l = static_cast<int>(min(level, _topLevel)); l >= 0; --l)
+    {
+        SearchLayer(query, entry, l, _parameters.BuildCandidates);
+
+        _selected.assign(_results.begin(), _results.end());
+        SelectNeighbours(_selected, _parameters.Connections);
+        entry = _selected[0].PoseId;
+
+        UINT* pLinks = GetLinks(poseId, l);
+        pLinks[0] = static_cast<UINT>(_selected.size());
+        for (UINT i = 0; i < pLinks[0]; ++i)
+        {
+            pLinks[1 + i] = _selected[i].PoseId;
+        }
+
+        for (const Candidate& neighbour : _selected)
+        {
+            Connect(neighbour.PoseId, poseId, l);
+        }
+    }
+
+    if (level > _topLevel)
+    {
+        _entry = poseId;
+        _topLevel = level;
+    }
+
+    return poseId;
+}
+
+void PoseIndex::Search(_In_reads_(POSE_FEATURE_COUNT) const XMFLOAT4* pFeatures, UINT k, _Inout_ std::vector<PoseMatch>& matches)
+{
+    matches.clear();
+    if (0 == k || 0 == GetPoseCount())
+    {
+        return;
+    }
+
+    XMVECTOR query[POSE_FEATURE_COUNT];
+    LoadQuery(pFeatures, query);
+
+    UINT entry = _entry;
+    for (UINT l = _topLevel; l > 0; --l)
+    {
+        entry = SearchGreedy(query, entry, l);
+    }
+
+    SearchLayer(query, entry, 0, max(k, _parameters.SearchCandidates));
+
+    for (const Candidate& candidate : _results)
+    {
+        PoseMatch match = { candidate.PoseId, _frameIndex[candidate.PoseId], _bodyIndex[candidate.PoseId], candidate.Distance };
+        matches.push_back(match);
+    }
+
+    std::sort(matches.begin(), matches.end(), CloserThan);
+    if (matches.size() > k)
+    {
+        matches.resize(k);
+    }
+}
+
+void PoseIndex::SearchFrame(_In_ const BodyFrameData& frame, UINT k, _Out_writes_(BODY_COUNT) std::vector<PoseMatch>* pMatches)
+{
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        pMatches[bodyIndex].clear();
+
+        if (HasBodyFrame(frame, bodyIndex))
+        {
+            XMFLOAT4 features[POSE_FEATURE_COUNT];
+            ComputeGestureFeatures(frame, bodyIndex, features);
+
+            Search(features, k, pMatches[bodyIndex]);
+        }
+    }
+}
+
+void PoseIndex::SearchExact(_In_reads_(POSE_FEATURE_COUNT) const XMFLOAT4* pFeatures, UINT k, _Inout_ std::vector<PoseMatch>& matches) const
+{
+    matches.clear();
+    if (0 == k)
+    {
+        return;
+    }
+
+    XMVECTOR query[POSE_FEATURE_COUNT];
+    LoadQuery(pFeatures, query);
+
+    // max heap of the k nearest so far
+    for (UINT poseId = 0; poseId < GetPoseCount(); ++poseId)
+    {
+        float distance = FeatureDistance(query, GetFeatures(poseId));
+        if (matches.size() == k && distance >= matches.front().Distance)
+        {
+            continue;
+        }
+
+        PoseMatch match = { poseId, _frameIndex[poseId], _bodyIndex[poseId], distance };
+        matches.push_back(match);
+        std::push_heap(matches.begin(), matches.end(), CloserThan);
+        if (matches.size() > k)
+        {
+            std::pop_heap(matches.begin(), matches.end(), CloserThan);
+            matches.pop_back();
+        }
+    }
+
+    std::sort_heap(matches.begin(), matches.end(), CloserThan);
+}
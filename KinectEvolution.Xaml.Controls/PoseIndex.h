@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseIndex.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+#include "GestureRecognizer.h"
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                // a pose is the bone directions of ComputeGestureFeatures, one per entry of BodyBones
+                static const UINT POSE_FEATURE_COUNT = GESTURE_BONE_COUNT;
+
+                struct PoseIndexParameters
+                {
+                    UINT    Connections;        // graph neighbours per pose on the upper layers, twice that on the bottom one
+                    UINT    BuildCandidates;    // candidates searched when a pose is inserted
+                    UINT    SearchCandidates;   // candidates searched per query, at least the number of matches asked for
+
+                    PoseIndexParameters()
+                        : Connections(16)
+                        , BuildCandidates(100)
+                        , SearchCandidates(40)
+                    {
+                    }
+                };
+
+                struct PoseMatch
+                {
+                    UINT    PoseId;
+                    UINT    FrameIndex;     // as given to AddPose, a BodyFrameStore frame when recording
+                    UINT    BodyIndex;
+                    float   Distance;       // summed squared difference of the bone directions
+                };
+
+                // nearest stored poses to a live body. poses are independent of where the body stands, which way it
+                // faces and how tall it is, and are kept at 16 bits per component. the search runs over a hierarchical
+                // navigable small world graph: a greedy descent through sparse upper layers picks the entry into the
+                // bottom layer, where a best first search over SearchCandidates poses finds the matches.
+                // poses can be added while recording; searches share scratch state, so calls must not overlap.
+                class PoseIndex
+                {
+                public:
+                    PoseIndex();
+
+                    // drops the stored poses
+                    void Reset(_In_ const PoseIndexParameters& parameters);
+
+                    const PoseIndexParameters& GetParameters() const { return _parameters; }
+
+                    // false when the spine or shoulders of the body are not tracked
+                    bool AddPose(_In_ const BodyFrameData& frame, UINT bodyIndex, UINT frameIndex);
+                    UINT AddFeatures(_In_reads_(POSE_FEATURE_COUNT) const XMFLOAT4* pFeatures, UINT frameIndex, UINT bodyIndex);
+
+                    UINT GetPoseCount() const { return static_cast<UINT>(_frameIndex.size()); }
+
+                    size_t GetStorageSize() const;
+
+                    // k nearest poses, nearest first
+                    void Search(_In_reads_(POSE_FEATURE_COUNT) const XMFLOAT4* pFeatures, UINT k, _Inout_ std::vector<PoseMatch>& matches);
+
+                    // every tracked body of a frame, untracked bodies get no matches
+                    void SearchFrame(_In_ const BodyFrameData& frame, UINT k, _Out_writes_(BODY_COUNT) std::vector<PoseMatch>* pMatches);
+
+                    // linear scan with the same ordering, what Search approximates
+                    void SearchExact(_In_reads_(POSE_FEATURE_COUNT) const XMFLOAT4* pFeatures, UINT k, _Inout_ std::vector<PoseMatch>& matches) const;
+
+                    // distance evaluations since the last Reset
+                    UINT64 GetDistanceCount() const { return _distanceCount; }
+
+                private:
+                    static const UINT MAX_LEVELS = 16;
+
+                    struct Candidate
+                    {
+                        float   Distance;
+                        UINT    PoseId;
+                    };
+
+                    const DirectX::PackedVector::XMSHORTN4* GetFeatures(UINT poseId) const { return &_features[poseId * POSE_FEATURE_COUNT]; }
+
+                    float Distance(_In_reads_(POSE_FEATURE_COUNT) const XMVECTOR* pQuery, UINT poseId);
+                    float Distance(UINT poseA, UINT poseB);
+
+                    // neighbour list of a pose on a layer, the count first
+                    UINT* GetLinks(UINT poseId, UINT level);
+                    UINT GetMaxLinks(UINT level) const { return 0 == level ? 2 * _parameters.Connections : _parameters.Connections; }
+
+                    UINT RandomLevel();
+
+                    // closest pose by greedy descent on one layer
+                    UINT SearchGreedy(_In_reads_(POSE_FEATURE_COUNT) const XMVECTOR* pQuery, UINT entry, UINT level);
+
+                    // best first search on one layer, leaves up to candidateCount nearest in _results as a max heap
+                    void SearchLayer(_In_reads_(POSE_FEATURE_COUNT) const XMVECTOR* pQuery, UINT entry, UINT level, UINT candidateCount);
+
+                    // keeps candidates closer to the pose than to any neighbour already kept, so links spread in all directions
+                    void SelectNeighbours(_Inout_ std::vector<Candidate>& candidates, UINT maxCount);
+
+                    void Connect(UINT poseId, UINT neighbourId, UINT level);
+
+                    void NextVisit();
+
+                private:
+                    PoseIndexParameters                             _parameters;
+                    float                                           _levelScale;
+                    UINT64                                          _random;
+
+                    std::vector<DirectX::PackedVector::XMSHORTN4>   _features;     // POSE_FEATURE_COUNT per pose
+                    std::vector<UINT>                               _frameIndex;
+                    std::vector<BYTE>                               _bodyIndex;
+                    std::vector<BYTE>                               _level;
+
+                    std::vector<UINT>                               _links;        // bottom layer, 1 + 2 * Connections per pose
+                    std::vector<UINT>                               _upperLinks;   // layers above, 1 + Connections each
+                    std::vector<UINT>                               _upperOffset;  // of a pose's first upper layer in _upperLinks
+
+                    UINT                                            _entry;
+                    UINT                                            _topLevel;
+
+                    // search scratch
+                    std::vector<UINT>                               _visited;      // visit mark per pose
+                    UINT                                            _visitMark;
+                    std::vector<Candidate>                          _candidates;   // min heap
+                    std::vector<Candidate>                          _results;      // max heap
+                    std::vector<Candidate>                          _selected;     // links of the pose being added
+                    std::vector<Candidate>                          _neighbours;   // links of a full neighbour
+                    UINT64                                          _distanceCount;
+                };
+
+            }
+        }
+    }
+}
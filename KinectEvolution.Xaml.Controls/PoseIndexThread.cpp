@@ -0,0 +1,198 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseIndexThread.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "PoseIndexThread.h"
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace Concurrency;
+
+PoseIndexThread::PoseIndexThread()
+    : _k(1)
+    , _stopping(false)
+    , _hasSearchFrame(FALSE)
+{
+    ZeroMemory(&_statistics, sizeof(_statistics));
+    _idle.set();
+}
+
+PoseIndexThread::~PoseIndexThread()
+{
+    Stop();
+}
+
+void PoseIndexThread::Start(_In_ const PoseIndexParameters& parameters, UINT k)
+{
+    Stop();
+
+    _index.Reset(parameters);
+    _k = max(1u, k);
+
+    _queue.clear();
+    _hasSearchFrame = FALSE;
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        _matches[bodyIndex].clear();
+    }
+    ZeroMemory(&_statistics, sizeof(_statistics));
+
+    _stopping = false;
+    _ready.reset();
+    _idle.set();
+    _thread = std::thread([this]() { IndexLoop(); });
+}
+
+void PoseIndexThread::Stop()
+{
+    if (!_thread.joinable())
+    {
+        return;
+    }
+
+    // frames not taken yet are dropped
+    _stopping.store(true, std::memory_order_release);
+    _ready.set();
+    _thread.join();
+
+    _idle.set();
+}
+
+void PoseIndexThread::Index(_In_ const BodyFrameData& frame, UINT frameIndex)
+{
+    if (!IsRunning())
+    {
+        return;
+    }
+
+    {
+        critical_section::scoped_lock lock(_lock);
+
+        if (_queue.size() >= MAX_QUEUED_FRAMES)
+        {
+            _queue.pop_front();
+            ++_statistics.FramesDropped;
+        }
+
+        _queue.push_back(QueuedFrame());
+        _queue.back().Frame = frame;
+        _queue.back().FrameIndex = frameIndex;
+        _idle.reset();
+    }
+
+    _ready.set();
+}
+
+void PoseIndexThread::Search(_In_ const BodyFrameData& frame)
+{
+    if (!IsRunning())
+    {
+        return;
+    }
+
+    {
+        critical_section::scoped_lock lock(_lock);
+
+        _statistics.SearchesReplaced += _hasSearchFrame ? 1 : 0;
+        _searchFrame = frame;
+        _hasSearchFrame = TRUE;
+        _idle.reset();
+    }
+
+    _ready.set();
+}
+
+void PoseIndexThread::GetMatches(UINT bodyIndex, _Out_ std::vector<PoseMatch>& matches)
+{
+    critical_section::scoped_lock lock(_lock);
+
+    matches = _matches[bodyIndex];
+}
+
+void PoseIndexThread::WaitIdle()
+{
+    if (IsRunning())
+    {
+        _idle.wait();
+    }
+}
+
+void PoseIndexThread::GetStatistics(_Out_ PoseIndexThreadStatistics* pStatistics)
+{
+    critical_section::scoped_lock lock(_lock);
+
+    *pStatistics = _statistics;
+}
+
+void PoseIndexThread::IndexLoop()
+{
+    BodyFrameData searchFrame;
+    QueuedFrame queued;
+    std::vector<PoseMatch> found[BODY_COUNT];
+
+    while (!_stopping.load(std::memory_order_acquire))
+    {
+        BOOL search = FALSE;
+        BOOL index = FALSE;
+
+        {
+            critical_section::scoped_lock lock(_lock);
+
+            // reset before looking, anything handed over after this sets it again
+            _ready.reset();
+
+            search = _hasSearchFrame;
+            if (search)
+            {
+                searchFrame = _searchFrame;
+                _hasSearchFrame = FALSE;
+            }
+
+            index = !_queue.empty();
+            if (index)
+            {
+                queued = _queue.front();
+                _queue.pop_front();
+            }
+
+            if (!search && !index)
+            {
+                _idle.set();
+            }
+        }
+
+        if (!search && !index)
+        {
+            _ready.wait();
+            continue;
+        }
+
+        // one queued frame a pass, so a search never waits behind more than six inserts
+        if (search)
+        {
+            _index.SearchFrame(searchFrame, _k, found);
+
+            critical_section::scoped_lock lock(_lock);
+            for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+            {
+                _matches[bodyIndex].swap(found[bodyIndex]);
+            }
+            ++_statistics.FramesSearched;
+        }
+
+        if (index)
+        {
+            for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+            {
+                _index.AddPose(queued.Frame, bodyIndex, queued.FrameIndex);
+            }
+
+            critical_section::scoped_lock lock(_lock);
+            ++_statistics.FramesIndexed;
+            _statistics.PoseCount = _index.GetPoseCount();
+        }
+    }
+}
@@ -0,0 +1,93 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseIndexThread.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "PoseIndex.h"
+
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                struct PoseIndexThreadStatistics
+                {
+                    UINT64  FramesIndexed;
+                    UINT64  FramesDropped;      // queued to index while the queue was full, the oldest goes
+                    UINT64  FramesSearched;
+                    UINT64  SearchesReplaced;   // a newer frame to search came before the thread took the last one
+                    UINT    PoseCount;
+                };
+
+                // a PoseIndex owned by a thread of its own, so inserts into a large index do not hold up the render
+                // thread. frames to index are queued in order, frames to search replace each other and are taken
+                // first, so a body is not matched to a pose of the same frame. the matches are those of the last frame
+                // searched, a frame or so behind the caller.
+                class PoseIndexThread
+                {
+                public:
+                    PoseIndexThread();
+                    ~PoseIndexThread();
+
+                    // an empty index, k matches per body
+                    void Start(_In_ const PoseIndexParameters& parameters, UINT k);
+                    void Stop();
+
+                    BOOL IsRunning() const { return _thread.joinable(); }
+
+                    // from any thread, the frames are copied
+                    void Index(_In_ const BodyFrameData& frame, UINT frameIndex);
+                    void Search(_In_ const BodyFrameData& frame);
+
+                    // from any thread, nearest first, empty for a body without a pose or before the first search
+                    void GetMatches(UINT bodyIndex, _Out_ std::vector<PoseMatch>& matches);
+
+                    // waits until everything handed over so far is searched and indexed
+                    void WaitIdle();
+
+                    void GetStatistics(_Out_ PoseIndexThreadStatistics* pStatistics);
+
+                    // only with the thread idle or stopped
+                    const PoseIndex& GetIndex() const { return _index; }
+
+                private:
+                    // ten seconds of frames
+                    static const size_t MAX_QUEUED_FRAMES = 300;
+
+                    struct QueuedFrame
+                    {
+                        BodyFrameData   Frame;
+                        UINT            FrameIndex;
+                    };
+
+                    void IndexLoop();
+
+                private:
+                    PoseIndex                       _index;
+                    UINT                            _k;
+                    std::thread                     _thread;
+                    std::atomic<bool>               _stopping;
+
+                    // handed over under the lock
+                    Concurrency::critical_section   _lock;
+                    Concurrency::event              _ready;
+                    Concurrency::event              _idle;
+                    std::deque<QueuedFrame>         _queue;
+                    BodyFrameData                   _searchFrame;
+                    BOOL                            _hasSearchFrame;
+                    std::vector<PoseMatch>          _matches[BODY_COUNT];
+                    PoseIndexThreadStatistics       _statistics;
+                };
+
+            }
+        }
+    }
+}
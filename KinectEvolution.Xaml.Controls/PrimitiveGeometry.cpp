@@ -0,0 +1,670 @@
+//------------------------------------------------------------------------------
+// <copyright file="PrimitiveGeometry.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "PrimitiveGeometry.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
+using namespace KinectEvolution::Xaml::Controls::Base;
+
+// shapes of the default cone and pyramid
+static const float DEFAULT_CONE_RADIUS = 0.3f;
+static const float DEFAULT_PYRAMID_SIZE = 1.0f;
+
+// vertex scoring of the cache optimisation, the values Forsyth found to work well
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static const UINT NO_TRIANGLE = 0xFFFFFFFF;
+
+void KinectEvolution::Xaml::Controls::Base::GenerateCube(_Out_ PrimitiveGeometry* pGeometry)
+{
+    std::vector<PrimitiveVertex>& vertices = pGeometry->Vertices;
+    std::vector<UINT16>& indices = pGeometry->Indices;
+
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(24);
+    indices.reserve(36);
+
+    // down
+    vertices.push_back(PrimitiveVertex( 0.5f, -0.5f,  0.5f, 0.0f, -1.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f, -0.5f,  0.5f, 0.0f, -1.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex( 0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0xFFFFFFFF));
+
+    // up
+    vertices.push_back(PrimitiveVertex( 0.5f, 0.5f,  0.5f, 0.0f, 1.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f, 0.5f,  0.5f, 0.0f, 1.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex( 0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0xFFFFFFFF));
+
+    // left
+    vertices.push_back(PrimitiveVertex(-0.5f,  0.5f,  0.5f, -1.0f, 0.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f,  0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f, -0.5f,  0.5f, -1.0f, 0.0f, 0.0f, 0xFFFFFFFF));
+
+    // right
+    vertices.push_back(PrimitiveVertex(0.5f,  0.5f,  0.5f, 1.0f, 0.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(0.5f,  0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(0.5f, -0.5f,  0.5f, 1.0f, 0.0f, 0.0f, 0xFFFFFFFF));
+
+    // back
+    vertices.push_back(PrimitiveVertex( 0.5f,  0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f,  0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex( 0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0xFFFFFFFF));
+
+    // front
+    vertices.push_back(PrimitiveVertex( 0.5f,  0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f,  0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(-0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex( 0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0xFFFFFFFF));
+
+    // opposite faces list their corners in the same order, so every second face is wound the other way
+    for (UINT16 face = 0; face < 6; ++face)
+    {
+        UINT16 i0 = face * 4;
+
+        if (0 == (face & 1))
+        {
+            indices.push_back(i0);
+            indices.push_back(i0 + 1);
+            indices.push_back(i0 + 2);
+            indices.push_back(i0);
+            indices.push_back(i0 + 2);
+            indices.push_back(i0 + 3);
+        }
+        else
+        {
+            indices.push_back(i0);
+            indices.push_back(i0 + 2);
+            indices.push_back(i0 + 1);
+            indices.push_back(i0);
+            indices.push_back(i0 + 3);
+            indices.push_back(i0 + 2);
+        }
+    }
+}
+
+void KinectEvolution::Xaml::Controls::Base::GenerateSphere(UINT segments, _Out_ PrimitiveGeometry* pGeometry)
+{
+    ASSERT(segments >= 3 && segments <= 100);
+
+    std::vector<PrimitiveVertex>& vertices = pGeometry->Vertices;
+    std::vector<UINT16>& indices = pGeometry->Indices;
+
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(segments * segments);
+    indices.reserve(segments * (segments - 1) * 6);
+
+    for (UINT y = 0; y < segments; y++)
+    {
+        float latitude = XM_PI * y / (segments - 1) - XM_PI / 2;
+
+        for (UINT x = 0; x < segments; x++)
+        {
+            float longitude = 2 * XM_PI * x / segments;
+            float nx = cosf(latitude) * sinf(longitude);
+            float ny = sinf(latitude);
+            float nz = cosf(latitude) * cosf(longitude);
+
+            vertices.push_back(PrimitiveVertex(0.5f * nx, 0.5f * ny, 0.5f * nz, nx, ny, nz, 0xFFFFFFFF));
+
+            if (y == 0)
+            {
+                continue;
+            }
+
+            UINT x0 = (x > 0) ? x - 1 : segments - 1;
+
+            UINT16 i0 = static_cast<UINT16>((y - 1) * segments + x0);
+            UINT16 i1 = static_cast<UINT16>((y - 1) * segments + x);
+            UINT16 i2 = static_cast<UINT16>(y * segments + x);
+            UINT16 i3 = static_cast<UINT16>(y * segments + x0);
+
+            indices.push_back(i0);
+            indices.push_back(i1);
+            indices.push_back(i2);
+
+            indices.push_back(i0);
+            indices.push_back(i2);
+            indices.push_back(i3);
+        }
+    }
+}
+
+void KinectEvolution::Xaml::Controls::Base::GenerateCylinder(UINT segments, _Out_ PrimitiveGeometry* pGeometry)
+{
+    ASSERT(segments >= 3 && segments <= 100);
+
+    std::vector<PrimitiveVertex>& vertices = pGeometry->Vertices;
+    std::vector<UINT16>& indices = pGeometry->Indices;
+
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(2 * segments + 2);
+    indices.reserve(12 * segments);
+
+    for (UINT x = 0; x < segments; x++)
+    {
+        float angle = 2 * XM_PI * x / segments;
+        float nx = sinf(angle);
+        float ny = 0;
+        float nz = cosf(angle);
+
+        // tube
+
+        vertices.push_back(PrimitiveVertex(nx, 0.0f, nz, nx, ny, nz, 0xFFFFFFFF));
+        vertices.push_back(PrimitiveVertex(nx, 1.0f, nz, nx, ny, nz, 0xFFFFFFFF));
+
+        UINT x0 = (x > 0) ? x - 1 : segments - 1;
+
+        UINT16 i0 = static_cast<UINT16>(2 * x0);
+        UINT16 i1 = static_cast<UINT16>(2 * x);
+        UINT16 i2 = static_cast<UINT16>(2 * x + 1);
+        UINT16 i3 = static_cast<UINT16>(2 * x0 + 1);
+
+        indices.push_back(i0);
+        indices.push_back(i1);
+        indices.push_back(i2);
+
+        indices.push_back(i0);
+        indices.push_back(i2);
+        indices.push_back(i3);
+
+        // cap
+
+        indices.push_back(static_cast<UINT16>(segments * 2));
+        indices.push_back(i1);
+        indices.push_back(i0);
+
+        indices.push_back(static_cast<UINT16>(segments * 2 + 1));
+        indices.push_back(i3);
+        indices.push_back(i2);
+    }
+
+    vertices.push_back(PrimitiveVertex(0, 0.0f, 0, 0, -1.0f, 0, 0xFFFFFFFF));
+    vertices.push_back(PrimitiveVertex(0, 1.0f, 0, 0, 1.0f, 0, 0xFFFFFFFF));
+}
+
+// need this to calculate normal correctly, note when applying non-uniform (different in x/y/z) scale the visual effect might be incorrect for normal
+void KinectEvolution::Xaml::Controls::Base::GenerateCone(float baseRadius, UINT segments, _Out_ PrimitiveGeometry* pGeometry)
+{
+    ASSERT(segments >= 3 && segments <= 100);
+
+    const float waist[] = { 0.5f, 0.75f, 0.875f };
+    const UINT NumVertexPerSegment = 3 + _countof(waist);
+
+    std::vector<PrimitiveVertex>& vertices = pGeometry->Vertices;
+    std::vector<UINT16>& indices = pGeometry->Indices;
+
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(NumVertexPerSegment * segments + 1);
+    indices.reserve(6 * (1 + _countof(waist)) * segments);
+
+    float invSqrt1nR2 = 1 / sqrtf(1 + baseRadius * baseRadius);
+    float rInvSqrt1nR2 = baseRadius / sqrtf(1 + baseRadius * baseRadius);
+
+    for (UINT x = 0; x < segments; x++)
+    {
+        // the vertex on cone base
+        float angle = 2 * XM_PI * x / segments;
+        float nx = sinf(angle) * invSqrt1nR2;
+        float ny = rInvSqrt1nR2;
+        float nz = cosf(angle) * invSqrt1nR2;
+        vertices.push_back(PrimitiveVertex(nx * baseRadius, 0.0f, nz * baseRadius, 0, -1, 0, 0xFFFFFFFF));
+        vertices.push_back(PrimitiveVertex(nx * baseRadius, 0.0f, nz * baseRadius, nx, ny, nz, 0xFFFFFFFF));
+
+        // the vertex on cone body
+        for (int i = 0; i < _countof(waist); i++)
+        {
+            float waistRadius = (1 - waist[i]) * baseRadius;
+            vertices.push_back(PrimitiveVertex(nx * waistRadius, waist[i], nz * waistRadius, nx, ny, nz, 0xFFFFFFFF));
+        }
+
+        // the vertex on cone tip
+        float angleTip = 2 * XM_PI * (x + 0.5f) / segments;
+        float tipnx = sinf(angleTip) * invSqrt1nR2;
+        float tipnz = cosf(angleTip) * invSqrt1nR2;
+        vertices.push_back(PrimitiveVertex(0.0f, 1.0f, 0.0f, tipnx, ny, tipnz, 0xFFFFFFFF));
+
+        // generate triangles, start from the base
+        UINT16 iBase0 = static_cast<UINT16>(NumVertexPerSegment * x);
+        UINT16 iBase1 = (x < segments - 1) ? static_cast<UINT16>(iBase0 + NumVertexPerSegment) : 0;
+
+        // cap
+        indices.push_back(iBase0);
+        indices.push_back(static_cast<UINT16>(NumVertexPerSegment * segments));
+        indices.push_back(iBase1);
+        iBase0++;
+        iBase1++;
+
+        // body
+        for (int i = 0; i < _countof(waist); i++)
+        {
+            UINT16 iUpper0 = iBase0 + 1;
+            UINT16 iUpper1 = iBase1 + 1;
+
+            indices.push_back(iBase0);
+            indices.push_back(iBase1);
+            indices.push_back(iUpper1);
+
+            indices.push_back(iBase0);
+            indices.push_back(iUpper1);
+            indices.push_back(iUpper0);
+
+            iBase0++;
+            iBase1++;
+        }
+
+        // tip
+        indices.push_back(iBase0);
+        indices.push_back(iBase1);
+        indices.push_back(iBase0 + 1);
+    }
+
+    vertices.push_back(PrimitiveVertex(0, 0, 0, 0, -1.0f, 0, 0xFFFFFFFF));
+}
+
+static void AddTriangle(
+    _In_ const XMVECTOR& p0,
+    _In_ const XMVECTOR& p1,
+    _In_ const XMVECTOR& p2,
+    _Inout_ PrimitiveGeometry* pGeometry)
+{
+    XMFLOAT3 v0, v1, v2, n;
+    XMStoreFloat3(&v0, p0);
+    XMStoreFloat3(&v1, p1);
+    XMStoreFloat3(&v2, p2);
+    XMStoreFloat3(&n, XMVector3Cross(p1 - p0, p2 - p0));
+
+    UINT16 baseIndex = static_cast<UINT16>(pGeometry->Vertices.size());
+
+    pGeometry->Vertices.push_back(PrimitiveVertex(v0.x, v0.y, v0.z, n.x, n.y, n.z, 0xFFFFFFFF));
+    pGeometry->Vertices.push_back(PrimitiveVertex(v1.x, v1.y, v1.z, n.x, n.y, n.z, 0xFFFFFFFF));
+    pGeometry->Vertices.push_back(PrimitiveVertex(v2.x, v2.y, v2.z, n.x, n.y, n.z, 0xFFFFFFFF));
+
+    pGeometry->Indices.push_back(baseIndex);
+    pGeometry->Indices.push_back(baseIndex + 1);
+    pGeometry->Indices.push_back(baseIndex + 2);
+}
+
+void KinectEvolution::Xaml::Controls::Base::GeneratePyramid(float baseSize, _Out_ PrimitiveGeometry* pGeometry)
+{
+    pGeometry->Vertices.clear();
+    pGeometry->Indices.clear();
+    pGeometry->Vertices.reserve(16);
+    pGeometry->Indices.reserve(18);
+
+    float halfBaseSize = baseSize / 2;
+    XMVECTOR baseNegXNegZ = XMVectorSet(-halfBaseSize, 0, -halfBaseSize, 0);
+    XMVECTOR basePosXNegZ = XMVectorSet(halfBaseSize, 0, -halfBaseSize, 0);
+    XMVECTOR basePosXPosZ = XMVectorSet(halfBaseSize, 0, halfBaseSize, 0);
+    XMVECTOR baseNegXPosZ = XMVectorSet(-halfBaseSize, 0, halfBaseSize, 0);
+    XMVECTOR tip = XMVectorSet(0, 1, 0, 0);
+
+    // siding
+    AddTriangle(tip, basePosXNegZ, baseNegXNegZ, pGeometry);
+    AddTriangle(tip, baseNegXNegZ, baseNegXPosZ, pGeometry);
+    AddTriangle(tip, baseNegXPosZ, basePosXPosZ, pGeometry);
+    AddTriangle(tip, basePosXPosZ, basePosXNegZ, pGeometry);
+
+    // base
+    UINT16 i0 = static_cast<UINT16>(pGeometry->Vertices.size());
+    UINT16 i1 = i0 + 1;
+    UINT16 i2 = i0 + 2;
+    UINT16 i3 = i0 + 3;
+
+    pGeometry->Vertices.push_back(PrimitiveVertex(halfBaseSize, 0, -halfBaseSize, 0, -1, 0, 0xFFFFFFFF));
+    pGeometry->Vertices.push_back(PrimitiveVertex(-halfBaseSize, 0, -halfBaseSize, 0, -1, 0, 0xFFFFFFFF));
+    pGeometry->Vertices.push_back(PrimitiveVertex(-halfBaseSize, 0, halfBaseSize, 0, -1, 0, 0xFFFFFFFF));
+    pGeometry->Vertices.push_back(PrimitiveVertex(halfBaseSize, 0, halfBaseSize, 0, -1, 0, 0xFFFFFFFF));
+
+    pGeometry->Indices.push_back(i0);
+    pGeometry->Indices.push_back(i2);
+    pGeometry->Indices.push_back(i1);
+
+    pGeometry->Indices.push_back(i0);
+    pGeometry->Indices.push_back(i3);
+    pGeometry->Indices.push_back(i2);
+}
+
+// how much emitting a triangle through this vertex is worth: vertices used most recently score highest,
+// so strips continue, and vertices with few triangles left get a boost so they leave the cache done
+static float VertexScore(int cachePosition, UINT remainingTriangles)
+{
+    if (0 == remainingTriangles)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // used by the last triangle, fixed so no vertex of it is favoured
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            float scale = 1.0f / (VERTEX_CACHE_SIZE - 3);
+            score = powf(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+
+    return score + VALENCE_BOOST_SCALE * powf(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+}
+
+void KinectEvolution::Xaml::Controls::Base::OptimizeVertexCache(_Inout_updates_(indexCount) UINT16* pIndices, UINT indexCount, UINT vertexCount)
+{
+    UINT triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    // triangles of each vertex not yet emitted, the first remaining[v] of its list
+    std::vector<UINT> remaining(vertexCount, 0);
+    for (UINT i = 0; i < triangleCount * 3; ++i)
+    {
+        remaining[pIndices[i]]++;
+    }
+
+    std::vector<UINT> listStart(vertexCount + 1, 0);
+    for (UINT v = 0; v < vertexCount; ++v)
+    {
+        listStart[v + 1] = listStart[v] + remaining[v];
+    }
+
+    std::vector<UINT> triangleLists(triangleCount * 3);
+    std::vector<UINT> listEnd(listStart.begin(), listStart.end() - 1);
+    for (UINT i = 0; i < triangleCount * 3; ++i)
+    {
+        triangleLists[listEnd[pIndices[i]]++] = i / 3;
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (UINT v = 0; v < vertexCount; ++v)
+    {
+        vertexScore[v] = VertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<BYTE> emitted(triangleCount, 0);
+    for (UINT t = 0; t < triangleCount; ++t)
+    {
+        triangleScore[t] = vertexScore[pIndices[3 * t]] + vertexScore[pIndices[3 * t + 1]] + vertexScore[pIndices[3 * t + 2]];
+    }
+
+    std::vector<UINT16> output;
+    output.reserve(triangleCount * 3);
+
+    // most recently used first, with room for the 3 vertices pushing the oldest out
+    UINT cache[VERTEX_CACHE_SIZE + 3];
+    UINT cacheCount = 0;
+
+    UINT best = NO_TRIANGLE;
+
+    for (UINT n = 0; n < triangleCount; ++n)
+    {
+        // nothing in the cache has triangles left, start again from the best anywhere
+        if (NO_TRIANGLE == best)
+        {
+            float bestScore = -FLT_MAX;
+            for (UINT t = 0; t < triangleCount; ++t)
+            {
+                if (!emitted[t] && triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+
+        const UINT16* pTriangle = &pIndices[3 * best];
+        output.push_back(pTriangle[0]);
+        output.push_back(pTriangle[1]);
+        output.push_back(pTriangle[2]);
+        emitted[best] = 1;
+
+        UINT newCache[VERTEX_CACHE_SIZE + 3];
+        UINT newCount = 0;
+
+        for (UINT k = 0; k < 3; ++k)
+        {
+            UINT v = pTriangle[k];
+
+            // take the triangle out of the vertex's list
+            UINT* pList = &triangleLists[listStart[v]];
+            for (UINT i = 0; i < remaining[v]; ++i)
+            {
+                if (pList[i] == best)
+                {
+                    pList[i] = pList[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+
+            if (0 == newCount || (newCache[0] != v && (1 == newCount || newCache[1] != v)))
+            {
+                newCache[newCount++] = v;
+            }
+        }
+
+        for (UINT i = 0; i < cacheCount; ++i)
+        {
+            UINT v = cache[i];
+            if (v != pTriangle[0] && v != pTriangle[1] && v != pTriangle[2])
+            {
+                newCache[newCount++] = v;
+            }
+        }
+
+        for (UINT i = 0; i < newCount; ++i)
+        {
+            UINT v = newCache[i];
+            cachePosition[v] = (i < VERTEX_CACHE_SIZE) ? static_cast<int>(i) : -1;
+            vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // rescore the triangles left on the vertices that moved, the best of them goes next
+        best = NO_TRIANGLE;
+        float bestScore = -FLT_MAX;
+        for (UINT i = 0; i < newCount; ++i)
+        {
+            UINT v = newCache[i];
+            const UINT* pList = &triangleLists[listStart[v]];
+
+            for (UINT j = 0; j < remaining[v]; ++j)
+            {
+                UINT t = pList[j];
+                float score = vertexScore[pIndices[3 * t]] + vertexScore[pIndices[3 * t + 1]] + vertexScore[pIndices[3 * t + 2]];
+                triangleScore[t] = score;
+
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        cacheCount = (newCount < VERTEX_CACHE_SIZE) ? newCount : VERTEX_CACHE_SIZE;
+        memcpy(cache, newCache, cacheCount * sizeof(UINT));
+    }
+
+    memcpy(pIndices, &output[0], output.size() * sizeof(UINT16));
+}
+
+float KinectEvolution::Xaml::Controls::Base::ComputeCacheMissRatio(_In_reads_(indexCount) const UINT16* pIndices, UINT indexCount, UINT cacheSize)
+{
+    UINT triangleCount = indexCount / 3;
+    if (0 == triangleCount || 0 == cacheSize)
+    {
+        return 0.0f;
+    }
+
+    std::vector<UINT> fifo(cacheSize, NO_TRIANGLE);
+    UINT head = 0;
+    UINT misses = 0;
+
+    for (UINT i = 0; i < triangleCount * 3; ++i)
+    {
+        UINT v = pIndices[i];
+        if (std::find(fifo.begin(), fifo.end(), v) == fifo.end())
+        {
+            misses++;
+            fifo[head] = v;
+            head = (head + 1) % cacheSize;
+        }
+    }
+
+    return static_cast<float>(misses) / triangleCount;
+}
+
+void KinectEvolution::Xaml::Controls::Base::OptimizePrimitiveGeometry(_Inout_ PrimitiveGeometry* pGeometry)
+{
+    std::vector<UINT16>& indices = pGeometry->Indices;
+    if (indices.empty())
+    {
+        return;
+    }
+
+    UINT indexCount = static_cast<UINT>(indices.size());
+    UINT vertexCount = static_cast<UINT>(pGeometry->Vertices.size());
+
+    pGeometry->GeneratedMissRatio = ComputeCacheMissRatio(&indices[0], indexCount, VERTEX_CACHE_MEASURE_SIZE);
+
+    // the model cache is larger than the measured one, so a mesh generated as short strips can come out worse
+    std::vector<UINT16> generated(indices);
+    OptimizeVertexCache(&indices[0], indexCount, vertexCount);
+
+    if (ComputeCacheMissRatio(&indices[0], indexCount, VERTEX_CACHE_MEASURE_SIZE) > pGeometry->GeneratedMissRatio)
+    {
+        indices.swap(generated);
+    }
+
+    // vertices in the order they are first drawn, so fetching them walks forward through memory;
+    // vertices no triangle uses are dropped
+    std::vector<UINT16> remap(vertexCount, 0xFFFF);
+    std::vector<PrimitiveVertex> vertices;
+    vertices.reserve(vertexCount);
+
+    for (UINT i = 0; i < indexCount; ++i)
+    {
+        UINT16& index = indices[i];
+        if (0xFFFF == remap[index])
+        {
+            remap[index] = static_cast<UINT16>(vertices.size());
+            vertices.push_back(pGeometry->Vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    pGeometry->Vertices.swap(vertices);
+
+    pGeometry->MissRatio = ComputeCacheMissRatio(&indices[0], indexCount, VERTEX_CACHE_MEASURE_SIZE);
+}
+
+// every shape asked for so far, by type, segments and size. entries are never removed, so a reference handed
+// out stays valid
+struct PrimitiveKey
+{
+    DefaultPrimitive    Type;
+    UINT                Segments;
+    float               Size;
+
+    bool operator<(const PrimitiveKey& other) const
+    {
+        if (Type != other.Type)
+        {
+            return Type < other.Type;
+        }
+
+        return Segments != other.Segments ? Segments < other.Segments : Size < other.Size;
+    }
+};
+
+static std::map<PrimitiveKey, std::unique_ptr<PrimitiveGeometry>> s_geometryCache;
+static Concurrency::critical_section s_geometryCacheLock;
+
+const PrimitiveGeometry& KinectEvolution::Xaml::Controls::Base::GetPrimitiveGeometry(DefaultPrimitive primitiveType, UINT segments, float size)
+{
+    ASSERT(primitiveType < DefaultPrimitive::Count);
+
+    // parameters a shape does not use are left out of the key, so every request for it shares one entry
+    PrimitiveKey key = { primitiveType, segments, size };
+    if (DefaultPrimitive::Cube == primitiveType || DefaultPrimitive::Pyramid == primitiveType)
+    {
+        key.Segments = 0;
+    }
+    if (DefaultPrimitive::Cone != primitiveType && DefaultPrimitive::Pyramid != primitiveType)
+    {
+        key.Size = 0.0f;
+    }
+
+    Concurrency::critical_section::scoped_lock lock(s_geometryCacheLock);
+
+    std::unique_ptr<PrimitiveGeometry>& entry = s_geometryCache[key];
+    if (nullptr == entry)
+    {
+        entry.reset(new PrimitiveGeometry());
+
+        switch (primitiveType)
+        {
+        case DefaultPrimitive::Cube:
+            GenerateCube(entry.get());
+            break;
+        case DefaultPrimitive::Sphere:
+            GenerateSphere(segments, entry.get());
+            break;
+        case DefaultPrimitive::Cylinder:
+            GenerateCylinder(segments, entry.get());
+            break;
+        case DefaultPrimitive::Cone:
+            GenerateCone(size, segments, entry.get());
+            break;
+        case DefaultPrimitive::Pyramid:
+            GeneratePyramid(size, entry.get());
+            break;
+        default:
+            break;
+        }
+
+        OptimizePrimitiveGeometry(entry.get());
+    }
+
+    return *entry;
+}
+
+const PrimitiveGeometry& KinectEvolution::Xaml::Controls::Base::GetPrimitiveGeometry(DefaultPrimitive primitiveType, UINT lod)
+{
+    float size = 0.0f;
+    if (DefaultPrimitive::Cone == primitiveType)
+    {
+        size = DEFAULT_CONE_RADIUS;
+    }
+    else if (DefaultPrimitive::Pyramid == primitiveType)
+    {
+        size = DEFAULT_PYRAMID_SIZE;
+    }
+
+    return GetPrimitiveGeometry(primitiveType, PrimitiveLodSegments[min(lod, PRIMITIVE_LOD_COUNT - 1)], size);
+}
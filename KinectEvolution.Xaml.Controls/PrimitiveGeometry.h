@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------------
+// <copyright file="PrimitiveGeometry.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Base {
+
+                enum class DefaultPrimitive : UINT
+                {
+                    Cube = 0,
+                    Sphere,
+                    Cylinder,
+                    Cone,
+                    Pyramid,
+                    Count
+                };
+
+                struct PrimitiveVertex
+                {
+                    float _x, _y, _z;
+                    float _nx, _ny, _nz;
+                    DWORD _color; // RGBA, where 0xFF000080 means (R = 128, G = 0, B = 0, A = 255), for D3D_FEATURE_LEVEL_9_x compatible
+
+                    PrimitiveVertex(float x, float y, float z, float nx, float ny, float nz, DWORD color)
+                        : _x(x), _y(y), _z(z)
+                        , _nx(nx), _ny(ny), _nz(nz)
+                        , _color(color)
+                    {
+                    }
+                };
+
+                // levels of detail of the default primitives, the first is the finest
+                static const UINT PRIMITIVE_LOD_COUNT = 3;
+
+                // segments around the sphere, cylinder and cone at each level; the cube and pyramid have one shape
+                static const UINT PrimitiveLodSegments[PRIMITIVE_LOD_COUNT] = { 20, 12, 6 };
+
+                // post transform cache the indices are ordered for, and the FIFO size they are measured against
+                static const UINT VERTEX_CACHE_SIZE = 32;
+                static const UINT VERTEX_CACHE_MEASURE_SIZE = 16;
+
+                // vertices and triangle list indices without any device resources
+                struct PrimitiveGeometry
+                {
+                    std::vector<PrimitiveVertex>    Vertices;
+                    std::vector<UINT16>             Indices;
+
+                    // average cache miss ratio, vertices transformed per triangle, as generated and once optimized
+                    float                           GeneratedMissRatio;
+                    float                           MissRatio;
+
+                    PrimitiveGeometry() : GeneratedMissRatio(0.0f), MissRatio(0.0f) {}
+
+                    UINT GetTriangleCount() const { return static_cast<UINT>(Indices.size() / 3); }
+                };
+
+                // a cube centered at (0,0,0) with size 1.0f
+                void GenerateCube(_Out_ PrimitiveGeometry* pGeometry);
+
+                // a sphere centered at (0,0,0) with diameter of 1.0f
+                void GenerateSphere(UINT segments, _Out_ PrimitiveGeometry* pGeometry);
+
+                // a tube of radius 1.0f from (0,0,0) to (0,1,0) with both ends capped
+                void GenerateCylinder(UINT segments, _Out_ PrimitiveGeometry* pGeometry);
+
+                // a cone from (0,0,0) to (0,1,0) with baseRadius, with (0,1,0) being the pointing end
+                void GenerateCone(float baseRadius, UINT segments, _Out_ PrimitiveGeometry* pGeometry);
+
+                // a square based pyramid on (0,0,0) with its tip at (0,1,0)
+                void GeneratePyramid(float baseSize, _Out_ PrimitiveGeometry* pGeometry);
+
+                // reorders the triangles for the post transform cache with Tom Forsyth's linear speed
+                // vertex cache optimisation, then the vertices into the order the triangles first use them
+                void OptimizePrimitiveGeometry(_Inout_ PrimitiveGeometry* pGeometry);
+
+                // triangles only, each ends up in the same winding
+                void OptimizeVertexCache(_Inout_updates_(indexCount) UINT16* pIndices, UINT indexCount, UINT vertexCount);
+
+                // vertices transformed per triangle through a FIFO cache of cacheSize entries, between 0.5 and 3
+                float ComputeCacheMissRatio(_In_reads_(indexCount) const UINT16* pIndices, UINT indexCount, UINT cacheSize);
+
+                // a primitive of any segment count and size, generated and optimized the first time it is asked for
+                // and kept from then on; size is the cone's base radius or the pyramid's base size, the other shapes
+                // ignore it and the cube and pyramid ignore segments
+                const PrimitiveGeometry& GetPrimitiveGeometry(DefaultPrimitive primitiveType, UINT segments, float size);
+
+                // the default primitives at every level, from the same cache
+                const PrimitiveGeometry& GetPrimitiveGeometry(DefaultPrimitive primitiveType, UINT lod);
+
+            }
+        }
+    }
+}
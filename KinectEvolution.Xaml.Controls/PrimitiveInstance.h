@@ -0,0 +1,26 @@
+//------------------------------------------------------------------------------
+// <copyright file="PrimitiveInstance.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Base {
+
+                // per instance vertex data of PrimitiveInstanceVS.hlsl, must match its input layout
+                struct PrimitiveInstance
+                {
+                    XMFLOAT4X4  _world;     // WORLD0-3, row vector convention as XMMATRIX
+                    XMFLOAT4    _ambient;
+                    XMFLOAT4    _diffuse;
+                    XMFLOAT4    _specular;
+                };
+
+            }
+        }
+    }
+}
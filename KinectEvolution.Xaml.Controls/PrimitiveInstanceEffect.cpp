@@ -0,0 +1,167 @@
+//------------------------------------------------------------------------------
+// <copyright file="PrimitiveInstanceEffect.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "PrimitiveInstanceEffect.h"
+
+using namespace KinectEvolution::Xaml::Controls::Base;
+
+struct InstanceCameraConstants
+{
+    // CONST 0-3    view
+    XMMATRIX _view;
+
+    // CONST 4-7    view * projection
+    XMMATRIX _viewProjection;
+};
+
+struct InstanceLightConstants
+{
+    // CONST 0      light direction in view space
+    XMVECTOR _lightDir;
+
+    // CONST 1      x: specular power
+    XMVECTOR _misc;
+};
+
+PrimitiveInstanceEffect::PrimitiveInstanceEffect()
+    : Effect()
+    , _maxInstances(0)
+    , _loadingComplete(FALSE)
+{
+}
+
+void PrimitiveInstanceEffect::Initialize(_In_ ID3D11Device1* const pD3DDevice, UINT maxInstances)
+{
+    _maxInstances = max(maxInstances, 1u);
+
+    // Asynchronously load vertex shader and create input layout.
+    auto loadVSTask = DX::ReadDataAsync(L"KinectEvolution.Xaml.Controls\\PrimitiveInstanceVS.cso");
+    auto createVSTask = loadVSTask.then([this, pD3DDevice](const std::vector<byte>& fileData) {
+
+        CONST D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
+        {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "AMBIENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "DIFFUSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            { "SPECULAR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        };
+
+        Effect::InitializeVS(pD3DDevice, &fileData[0], fileData.size(), vertexDesc, _countof(vertexDesc));
+
+    });
+
+    // Asynchronously load pixel shader and create constant buffer.
+    auto loadPSTask = DX::ReadDataAsync(L"KinectEvolution.Xaml.Controls\\PrimitiveInstancePS.cso");
+    auto createPSTask = loadPSTask.then([this, pD3DDevice](const std::vector<byte>& fileData) {
+
+        Effect::InitializePS(pD3DDevice, &fileData[0], fileData.size());
+
+    });
+
+    auto createShadersTask = (createPSTask && createVSTask).then([this, pD3DDevice]() {
+
+        // create constant buffers
+        D3D11_BUFFER_DESC CBDesc = { 0 };
+        CBDesc.ByteWidth = sizeof(InstanceCameraConstants);
+        CBDesc.Usage = D3D11_USAGE_DYNAMIC;
+        CBDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        CBDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        DX::ThrowIfFailed(
+            pD3DDevice->CreateBuffer(&CBDesc, nullptr, &_cameraConstantBuffer)
+            );
+
+        CBDesc.ByteWidth = sizeof(InstanceLightConstants);
+        DX::ThrowIfFailed(
+            pD3DDevice->CreateBuffer(&CBDesc, nullptr, &_lightConstantBuffer)
+            );
+
+        // create the instance buffer
+        D3D11_BUFFER_DESC instanceDesc = { 0 };
+        instanceDesc.ByteWidth = _maxInstances * sizeof(PrimitiveInstance);
+        instanceDesc.Usage = D3D11_USAGE_DYNAMIC;
+        instanceDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        instanceDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        DX::ThrowIfFailed(
+            pD3DDevice->CreateBuffer(&instanceDesc, nullptr, &_instanceBuffer)
+            );
+
+    });
+
+    // Once the everything is dine, we can start rendering
+    createShadersTask.then([this]() {
+        _loadingComplete = true;
+    });
+}
+
+BOOL PrimitiveInstanceEffect::Apply(
+    _In_ ID3D11DeviceContext1* const pD3DContext,
+    _In_ CXMMATRIX viewMatrix,
+    _In_ CXMMATRIX projectionMatrix,
+    FXMVECTOR lightDirection,
+    float specularPower)
+{
+    if (!Effect::Apply(pD3DContext))
+    {
+        return FALSE;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE map;
+    if (SUCCEEDED(pD3DContext->Map(_cameraConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &map)))
+    {
+        InstanceCameraConstants* pData = static_cast<InstanceCameraConstants*>(map.pData);
+        pData->_view = viewMatrix;
+        pData->_viewProjection = viewMatrix * projectionMatrix;
+        pD3DContext->Unmap(_cameraConstantBuffer.Get(), 0);
+    }
+
+    if (SUCCEEDED(pD3DContext->Map(_lightConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &map)))
+    {
+        InstanceLightConstants* pData = static_cast<InstanceLightConstants*>(map.pData);
+        pData->_lightDir = lightDirection;
+        pData->_misc = XMVectorSet(specularPower, 0.0f, 0.0f, 0.0f);
+        pD3DContext->Unmap(_lightConstantBuffer.Get(), 0);
+    }
+
+    pD3DContext->VSSetConstantBuffers(0, 1, _cameraConstantBuffer.GetAddressOf());
+    pD3DContext->PSSetConstantBuffers(0, 1, _lightConstantBuffer.GetAddressOf());
+
+    return TRUE;
+}
+
+void PrimitiveInstanceEffect::Render(
+    _In_ ID3D11DeviceContext1* const pD3DContext,
+    _In_ Mesh^ mesh,
+    _In_reads_(instanceCount) const PrimitiveInstance* pInstances,
+    UINT instanceCount)
+{
+    if (nullptr == _instanceBuffer || nullptr == mesh)
+    {
+        return;
+    }
+
+    for (UINT first = 0; first < instanceCount; first += _maxInstances)
+    {
+        UINT count = min(instanceCount - first, _maxInstances);
+
+        D3D11_MAPPED_SUBRESOURCE map;
+        if (FAILED(pD3DContext->Map(_instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &map)))
+        {
+            return;
+        }
+
+        memcpy(map.pData, pInstances + first, count * sizeof(PrimitiveInstance));
+        pD3DContext->Unmap(_instanceBuffer.Get(), 0);
+
+        mesh->RenderTriangleListInstanced(pD3DContext, _instanceBuffer.Get(), sizeof(PrimitiveInstance), count);
+    }
+}
@@ -0,0 +1,56 @@
+//------------------------------------------------------------------------------
+// <copyright file="PrimitiveInstanceEffect.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+#include "Effect.h"
+#include "Mesh.h"
+#include "PrimitiveInstance.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Base {
+
+                // PrimitiveEffect lighting with the world matrix and colors taken per instance
+                ref class PrimitiveInstanceEffect sealed
+                    : Effect
+                {
+                internal:
+                    PrimitiveInstanceEffect();
+
+                    // maxInstances is the size of the instance buffer, larger batches are drawn in several calls
+                    void Initialize(_In_ ID3D11Device1* const pD3DDevice, UINT maxInstances);
+
+                    BOOL Apply(
+                        _In_ ID3D11DeviceContext1* const pD3DContext,
+                        _In_ CXMMATRIX viewMatrix,
+                        _In_ CXMMATRIX projectionMatrix,
+                        FXMVECTOR lightDirection,
+                        float specularPower);
+
+                    // draws one copy of the mesh per instance, Apply must have succeeded
+                    void Render(
+                        _In_ ID3D11DeviceContext1* const pD3DContext,
+                        _In_ Mesh^ mesh,
+                        _In_reads_(instanceCount) const PrimitiveInstance* pInstances,
+                        UINT instanceCount);
+
+                    virtual BOOL IsLoadingComplete() override { return _loadingComplete; }
+
+                protected private:
+                    Microsoft::WRL::ComPtr<ID3D11Buffer>    _cameraConstantBuffer;
+                    Microsoft::WRL::ComPtr<ID3D11Buffer>    _lightConstantBuffer;
+                    Microsoft::WRL::ComPtr<ID3D11Buffer>    _instanceBuffer;
+
+                    UINT _maxInstances;
+
+                    BOOL _loadingComplete;
+                };
+
+            }
+        }
+    }
+}
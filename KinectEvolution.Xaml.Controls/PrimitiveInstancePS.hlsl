@@ -0,0 +1,39 @@
+//------------------------------------------------------------------------------
+// <copyright file="PrimitiveInstancePS.hlsl" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Constant Buffer Variables
+cbuffer PSInstanceSet : register(b0)
+{
+    float4 g_lightDir;
+    float4 g_misc; //x: specular power
+};
+
+struct PS_INPUT
+{
+    float4 pos      : SV_POSITION;
+    float3 normal   : TEXCOORD;
+    float3 view     : TEXCOORD1;
+    float4 color    : COLOR;
+    float4 diffuse  : TEXCOORD2;
+    float4 specular : TEXCOORD3;
+};
+
+// Pixel shader, as PrimitivePS with lighting enabled; instances without diffuse and specular are ambient only
+float4 main(PS_INPUT i) : SV_Target
+{
+    float4 color = i.color;
+
+    float3 N = normalize(i.normal);
+    float3 V = normalize(i.view);
+    float3 L = -g_lightDir.xyz;
+    float3 H = normalize(L + V);
+    float  d = max(dot(N, L), 0);
+    float  s = max(dot(N, H), 0);
+
+    color += float4(i.diffuse.rgb * d + i.specular.rgb * pow(s, g_misc.x), 0);
+
+    return color;
+};
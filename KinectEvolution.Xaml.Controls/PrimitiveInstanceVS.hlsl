@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+// <copyright file="PrimitiveInstanceVS.hlsl" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Constant Buffer Variables
+cbuffer VSTransformSet : register(b0)
+{
+    float4x4 g_view;    // view
+    float4x4 g_vp;      // view * projection
+};
+
+struct VS_INPUT
+{
+    float3 pos      : POSITION;
+    float3 normal   : NORMAL;
+    float4 color    : COLOR;
+
+    // per instance
+    float4 world0   : WORLD0;
+    float4 world1   : WORLD1;
+    float4 world2   : WORLD2;
+    float4 world3   : WORLD3;
+    float4 ambient  : AMBIENT;
+    float4 diffuse  : DIFFUSE;
+    float4 specular : SPECULAR;
+};
+
+struct PS_INPUT
+{
+    float4 pos      : SV_POSITION;
+    float3 normal   : TEXCOORD;
+    float3 view     : TEXCOORD1;
+    float4 color    : COLOR;
+    float4 diffuse  : TEXCOORD2;
+    float4 specular : TEXCOORD3;
+};
+
+// Vertex Shader
+PS_INPUT main(VS_INPUT i)
+{
+    PS_INPUT o;
+
+    // the instance rows are laid out as XMMATRIX, row vector on the left
+    float4x4 world = float4x4(i.world0, i.world1, i.world2, i.world3);
+
+    float4 worldPos = mul(float4(i.pos, 1.0f), world);
+    float3 worldNormal = mul(float4(i.normal, 0.0f), world).xyz;
+
+    o.pos = mul(g_vp, worldPos);
+
+    float4 viewPos = mul(g_view, worldPos);
+
+    o.normal = mul(g_view, float4(worldNormal, 0.0f)).xyz;
+
+    float4 eye = float4(0.0f, 0.0f, 0.0f, 1.0f);
+    o.view = (eye - viewPos).xyz;
+
+    o.color = i.color * i.ambient;
+    o.diffuse = i.diffuse;
+    o.specular = i.specular;
+
+    return o;
+};
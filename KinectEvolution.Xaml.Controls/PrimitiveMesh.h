@@ -6,36 +6,13 @@
 
 #pragma once
 #include "Mesh.h"
+#include "PrimitiveGeometry.h"
 
 namespace KinectEvolution {
     namespace Xaml {
         namespace Controls {
             namespace Base {
 
-                enum class DefaultPrimitive : UINT
-                {
-                    Cube = 0,
-                    Sphere,
-                    Cylinder,
-                    Cone,
-                    Pyramid,
-                    Count
-                };
-
-                struct PrimitiveVertex
-                {
-                    float _x, _y, _z;
-                    float _nx, _ny, _nz;
-                    DWORD _color; // RGBA, where 0xFF000080 means (R = 128, G = 0, B = 0, A = 255), for D3D_FEATURE_LEVEL_9_x compatible
-
-                    PrimitiveVertex(float x, float y, float z, float nx, float ny, float nz, DWORD color)
-                        : _x(x), _y(y), _z(z)
-                        , _nx(nx), _ny(ny), _nz(nz)
-                        , _color(color)
-                    {
-                    }
-                };
-
                 ref class PrimitiveMesh abstract
                     : Mesh
                 {
@@ -46,12 +23,23 @@ namespace KinectEvolution {
 
                     virtual DefaultPrimitive GetType() = 0;
 
+                    // one mesh per primitive and level on each device, made on the first call and returned by the
+                    // ones after it until ReleaseDefaultPrimitives
                     static PrimitiveMesh^ GetDefaultPrimitive(
                         _In_ ID3D11Device1* const pD3DDevice,
                         _In_ ID3D11DeviceContext1* const pD3DContext,
-                        DefaultPrimitive primitiveType);
+                        DefaultPrimitive primitiveType,
+                        UINT lod);
+
+                    // drops the meshes made on a device and the reference held on it, before the device is released
+                    static void ReleaseDefaultPrimitives(_In_ ID3D11Device1* const pD3DDevice);
 
-                    static Platform::Array<PrimitiveMesh^>^ Default;
+                protected private:
+                    // copies the prebuilt vertices and indices into the buffers
+                    void InitializeGeometry(
+                        _In_ ID3D11Device1* const pD3DDevice,
+                        _In_ ID3D11DeviceContext1* const pD3DContext,
+                        _In_ const PrimitiveGeometry& geometry);
 
                 private:
                     BOOL _loadingComplete;
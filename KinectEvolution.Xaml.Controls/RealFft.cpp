@@ -0,0 +1,232 @@
+//------------------------------------------------------------------------------
+// <copyright file="RealFft.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "RealFft.h"
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+static const double PI = 3.14159265358979323846;
+
+RealFft::RealFft()
+    : _size(0)
+    , _half(0)
+{
+}
+
+void RealFft::Reset(UINT size)
+{
+    ASSERT(size >= 8 && 0 == (size & (size - 1)));
+
+    _size = size;
+    _half = size / 2;
+
+    UINT bits = 0;
+    while ((1u << bits) < _half)
+    {
+        ++bits;
+    }
+
+    _bitReverse.resize(_half);
+    for (UINT i = 0; i < _half; ++i)
+    {
+        UINT reversed = 0;
+        for (UINT bit = 0; bit < bits; ++bit)
+        {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        _bitReverse[i] = reversed;
+    }
+
+    // stages of span 1, 2, 4 ... half / 2 take 1 + 2 + 4 ... = half - 1 twiddles
+    _twiddleReal.resize(_half);
+    _twiddleImaginary.resize(_half);
+    for (UINT m = 1; m < _half; m <<= 1)
+    {
+        for (UINT j = 0; j < m; ++j)
+        {
+            double angle = -PI * j / m;
+            _twiddleReal[m - 1 + j] = static_cast<float>(cos(angle));
+            _twiddleImaginary[m - 1 + j] = static_cast<float>(sin(angle));
+        }
+    }
+
+    _splitReal.resize(_half + 1);
+    _splitImaginary.resize(_half + 1);
+    for (UINT k = 0; k <= _half; ++k)
+    {
+        double angle = -2.0 * PI * k / _size;
+        _splitReal[k] = static_cast<float>(cos(angle));
+        _splitImaginary[k] = static_cast<float>(sin(angle));
+    }
+
+    _real.resize(_half);
+    _imaginary.resize(_half);
+}
+
+void RealFft::Transform()
+{
+    float* pReal = _real.data();
+    float* pImaginary = _imaginary.data();
+
+    // spans 1 and 2 together, the twiddles are 1 and -i
+    for (UINT b = 0; b < _half; b += 4)
+    {
+        float r0 = pReal[b] + pReal[b + 1];
+        float i0 = pImaginary[b] + pImaginary[b + 1];
+        float r1 = pReal[b] - pReal[b + 1];
+        float i1 = pImaginary[b] - pImaginary[b + 1];
+        float r2 = pReal[b + 2] + pReal[b + 3];
+        float i2 = pImaginary[b + 2] + pImaginary[b + 3];
+        float r3 = pReal[b + 2] - pReal[b + 3];
+        float i3 = pImaginary[b + 2] - pImaginary[b + 3];
+
+        pReal[b] = r0 + r2;
+        pImaginary[b] = i0 + i2;
+        pReal[b + 2] = r0 - r2;
+        pImaginary[b + 2] = i0 - i2;
+
+        // -i (r3 + i i3) = i3 - i r3
+        pReal[b + 1] = r1 + i3;
+        pImaginary[b + 1] = i1 - r3;
+        pReal[b + 3] = r1 - i3;
+        pImaginary[b + 3] = i1 + r3;
+    }
+
+    // the rest 4 butterflies at a time
+    for (UINT m = 4; m < _half; m <<= 1)
+    {
+        const float* pTwiddleReal = &_twiddleReal[m - 1];
+        const float* pTwiddleImaginary = &_twiddleImaginary[m - 1];
+
+        for (UINT b = 0; b < _half; b += 2 * m)
+        {
+            for (UINT j = 0; j < m; j += 4)
+            {
+                XMVECTOR wr = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pTwiddleReal + j));
+                XMVECTOR wi = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pTwiddleImaginary + j));
+
+                float* pTopReal = pReal + b + j;
+                float* pTopImaginary = pImaginary + b + j;
+                float* pBottomReal = pTopReal + m;
+                float* pBottomImaginary = pTopImaginary + m;
+
+                XMVECTOR ar = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pTopReal));
+                XMVECTOR ai = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pTopImaginary));
+                XMVECTOR br = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pBottomReal));
+                XMVECTOR bi = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pBottomImaginary));
+
+                // t = w b
+                XMVECTOR tr = XMVectorSubtract(XMVectorMultiply(wr, br), XMVectorMultiply(wi, bi));
+                XMVECTOR ti = XMVectorAdd(XMVectorMultiply(wr, bi), XMVectorMultiply(wi, br));
+
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pTopReal), XMVectorAdd(ar, tr));
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pTopImaginary), XMVectorAdd(ai, ti));
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pBottomReal), XMVectorSubtract(ar, tr));
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pBottomImaginary), XMVectorSubtract(ai, ti));
+            }
+        }
+    }
+}
+
+void RealFft::Forward(
+    _In_reads_(GetSize()) const float* pSamples,
+    _Out_writes_(GetBinCount()) float* pReal,
+    _Out_writes_(GetBinCount()) float* pImaginary)
+{
+    // z[n] = x[2n] + i x[2n + 1], in bit reversed order
+    for (UINT n = 0; n < _half; ++n)
+    {
+        UINT target = _bitReverse[n];
+        _real[target] = pSamples[2 * n];
+        _imaginary[target] = pSamples[2 * n + 1];
+    }
+
+    Transform();
+
+    // X[k] = E[k] + e^(-2 pi i k / size) O[k] with the transforms of the even and odd samples
+    // E[k] = (Z[k] + conj(Z[half - k])) / 2 and O[k] = -i (Z[k] - conj(Z[half - k])) / 2
+    for (UINT k = 0; k <= _half; ++k)
+    {
+        UINT a = (k == _half) ? 0 : k;
+        UINT b = (k == 0) ? 0 : _half - k;
+
+        float zr = _real[a];
+        float zi = _imaginary[a];
+        float cr = _real[b];
+        float ci = -_imaginary[b];
+
+        float evenReal = 0.5f * (zr + cr);
+        float evenImaginary = 0.5f * (zi + ci);
+        float oddReal = 0.5f * (zi - ci);
+        float oddImaginary = -0.5f * (zr - cr);
+
+        pReal[k] = evenReal + _splitReal[k] * oddReal - _splitImaginary[k] * oddImaginary;
+        pImaginary[k] = evenImaginary + _splitReal[k] * oddImaginary + _splitImaginary[k] * oddReal;
+    }
+}
+
+void RealFft::Inverse(
+    _In_reads_(GetBinCount()) const float* pReal,
+    _In_reads_(GetBinCount()) const float* pImaginary,
+    _Out_writes_(GetSize()) float* pSamples)
+{
+    // Z[k] = E[k] + i O[k] from the transforms of the even and odd samples
+    // E[k] = (X[k] + conj(X[half - k])) / 2 and O[k] = e^(2 pi i k / size) (X[k] - conj(X[half - k])) / 2
+    // the inverse is taken as conj(transform(conj(Z))) / half, so conj(Z) goes in bit reversed
+    for (UINT k = 0; k < _half; ++k)
+    {
+        float xr = pReal[k];
+        float xi = pImaginary[k];
+        float cr = pReal[_half - k];
+        float ci = -pImaginary[_half - k];
+
+        float evenReal = 0.5f * (xr + cr);
+        float evenImaginary = 0.5f * (xi + ci);
+        float dr = 0.5f * (xr - cr);
+        float di = 0.5f * (xi - ci);
+
+        // times conj(e^(-2 pi i k / size))
+        float oddReal = dr * _splitReal[k] + di * _splitImaginary[k];
+        float oddImaginary = di * _splitReal[k] - dr * _splitImaginary[k];
+
+        UINT target = _bitReverse[k];
+        _real[target] = evenReal - oddImaginary;
+        _imaginary[target] = -(evenImaginary + oddReal);
+    }
+
+    Transform();
+
+    const float scale = 1.0f / _half;
+    for (UINT n = 0; n < _half; ++n)
+    {
+        pSamples[2 * n] = _real[n] * scale;
+        pSamples[2 * n + 1] = -_imaginary[n] * scale;
+    }
+}
+
+void RealFft::ForwardReference(
+    _In_reads_(GetSize()) const float* pSamples,
+    _Out_writes_(GetBinCount()) float* pReal,
+    _Out_writes_(GetBinCount()) float* pImaginary) const
+{
+    for (UINT k = 0; k <= _half; ++k)
+    {
+        double real = 0.0;
+        double imaginary = 0.0;
+
+        for (UINT n = 0; n < _size; ++n)
+        {
+            // k n reduced first so the angle stays exact
+            double angle = -2.0 * PI * ((static_cast<UINT64>(k) * n) % _size) / _size;
+            real += pSamples[n] * cos(angle);
+            imaginary += pSamples[n] * sin(angle);
+        }
+
+        pReal[k] = static_cast<float>(real);
+        pImaginary[k] = static_cast<float>(imaginary);
+    }
+}
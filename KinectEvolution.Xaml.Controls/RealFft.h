@@ -0,0 +1,73 @@
+//------------------------------------------------------------------------------
+// <copyright file="RealFft.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // discrete fourier transform of a power of two real samples, X[k] = sum x[n] e^(-2 pi i k n / size).
+                // the samples are packed into a complex transform of half the size, done in place with radix 2
+                // butterflies 4 at a time over separate real and imaginary arrays, then split into the bins.
+                // all twiddles and the bit reversal are computed by Reset.
+                class RealFft
+                {
+                public:
+                    RealFft();
+
+                    // size is a power of two, at least 8
+                    void Reset(UINT size);
+
+                    UINT GetSize() const { return _size; }
+                    UINT GetBinCount() const { return _size / 2 + 1; }
+
+                    // bins 0 to size / 2
+                    void Forward(
+                        _In_reads_(GetSize()) const float* pSamples,
+                        _Out_writes_(GetBinCount()) float* pReal,
+                        _Out_writes_(GetBinCount()) float* pImaginary);
+
+                    // samples back from bins 0 to size / 2 of a real signal, scaled by 1 / size
+                    void Inverse(
+                        _In_reads_(GetBinCount()) const float* pReal,
+                        _In_reads_(GetBinCount()) const float* pImaginary,
+                        _Out_writes_(GetSize()) float* pSamples);
+
+                    // the same sums one term at a time, in double, to check Forward against
+                    void ForwardReference(
+                        _In_reads_(GetSize()) const float* pSamples,
+                        _Out_writes_(GetBinCount()) float* pReal,
+                        _Out_writes_(GetBinCount()) float* pImaginary) const;
+
+                private:
+                    void Transform();
+
+                private:
+                    UINT                _size;
+                    UINT                _half;          // points in the complex transform
+
+                    std::vector<UINT>   _bitReverse;
+
+                    // e^(-2 pi i j / 2m) for j < m of the stage of span m, from index m - 1 on
+                    std::vector<float>  _twiddleReal;
+                    std::vector<float>  _twiddleImaginary;
+
+                    // e^(-2 pi i k / size) for k <= size / 2, to split the half size transform
+                    std::vector<float>  _splitReal;
+                    std::vector<float>  _splitImaginary;
+
+                    std::vector<float>  _real;
+                    std::vector<float>  _imaginary;
+                };
+
+            }
+        }
+    }
+}
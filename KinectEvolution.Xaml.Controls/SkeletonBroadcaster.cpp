@@ -0,0 +1,615 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonBroadcaster.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SkeletonBroadcaster.h"
+
+#include <string>
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace Concurrency;
+using namespace Platform;
+using namespace Windows::Foundation;
+using namespace Windows::Networking;
+using namespace Windows::Networking::Sockets;
+using namespace Windows::Storage::Streams;
+
+// longest the thread sleeps with nothing to do, UDP subscribers time out in between
+static const UINT BROADCAST_WAIT_MILLISECONDS = 100;
+
+// read buffer of a TCP subscriber, anything it sends is thrown away
+static const UINT DISCARD_BUFFER_SIZE = 256;
+
+static HostName^ GetLoopback()
+{
+    return ref new HostName("127.0.0.1");
+}
+
+static String^ GetServiceName(USHORT port)
+{
+    return ref new String(std::to_wstring(port).c_str());
+}
+
+static IBuffer^ ToBuffer(_In_ const std::vector<BYTE>& bytes)
+{
+    DataWriter^ writer = ref new DataWriter();
+    writer->WriteBytes(ArrayReference<BYTE>(const_cast<BYTE*>(bytes.data()), static_cast<UINT>(bytes.size())));
+    return writer->DetachBuffer();
+}
+
+void SkeletonBroadcaster::Inbox::Post(_In_ const SocketEvent& socketEvent)
+{
+    {
+        critical_section::scoped_lock lock(Lock);
+        Events.push_back(socketEvent);
+    }
+
+    Ready.set();
+}
+
+SkeletonBroadcaster::SkeletonBroadcaster()
+    : _stopping(false)
+    , _bindSucceeded(FALSE)
+    , _history(HISTORY_FRAMES)
+    , _sequence(0)
+    , _nextSubscriberId(1)
+    , _subscriberCount(0)
+    , _encoded(ENCODED_CACHE_SIZE)
+    , _encodedNext(0)
+{
+    ZeroMemory(&_statistics, sizeof(_statistics));
+    ZeroMemory(&_publishedStatistics, sizeof(_publishedStatistics));
+}
+
+SkeletonBroadcaster::~SkeletonBroadcaster()
+{
+    Stop();
+}
+
+bool SkeletonBroadcaster::Start(_In_ const SkeletonBroadcasterParameters& parameters)
+{
+    Stop();
+
+    _parameters = parameters;
+    _parameters.MaxQueuedFrames = min(max(parameters.MaxQueuedFrames, 1u), HISTORY_FRAMES / 2);
+
+    // callbacks of the last run may still come in, they post to its inbox
+    _inbox = std::make_shared<Inbox>();
+    _inbox->HasFrame = FALSE;
+    _inbox->FramesPublished = 0;
+    _inbox->FramesReplaced = 0;
+
+    for (UINT i = 0; i < ENCODED_CACHE_SIZE; ++i)
+    {
+        _encoded[i].Bytes.clear();
+    }
+
+    _sequence = 0;
+    _nextSubscriberId = 1;
+    _subscriberCount.store(0, std::memory_order_relaxed);
+    ZeroMemory(&_statistics, sizeof(_statistics));
+    ZeroMemory(&_publishedStatistics, sizeof(_publishedStatistics));
+
+    // the sockets are bound on the thread, which is not the UI one, and binding the loopback address is quick
+    _stopping = false;
+    _bindSucceeded = FALSE;
+    _bound.reset();
+    _thread = std::thread([this]() { BroadcastLoop(); });
+    _bound.wait();
+
+    if (!_bindSucceeded)
+    {
+        Stop();
+        return false;
+    }
+
+    return true;
+}
+
+void SkeletonBroadcaster::Stop()
+{
+    if (!_thread.joinable())
+    {
+        return;
+    }
+
+    _stopping.store(true, std::memory_order_release);
+    _inbox->Ready.set();
+    _thread.join();
+}
+
+void SkeletonBroadcaster::Publish(_In_ const BodyFrameData& frame)
+{
+    if (!IsRunning())
+    {
+        return;
+    }
+
+    {
+        critical_section::scoped_lock lock(_inbox->Lock);
+
+        _inbox->FramesReplaced += _inbox->HasFrame ? 1 : 0;
+        _inbox->Frame = frame;
+        _inbox->HasFrame = TRUE;
+        ++_inbox->FramesPublished;
+    }
+
+    _inbox->Ready.set();
+}
+
+void SkeletonBroadcaster::GetStatistics(_Out_ SkeletonBroadcasterStatistics* pStatistics)
+{
+    {
+        critical_section::scoped_lock lock(_statisticsLock);
+        *pStatistics = _publishedStatistics;
+    }
+
+    if (nullptr != _inbox)
+    {
+        critical_section::scoped_lock lock(_inbox->Lock);
+
+        pStatistics->FramesPublished = _inbox->FramesPublished;
+        pStatistics->FramesDropped += _inbox->FramesReplaced;
+    }
+}
+
+void SkeletonBroadcaster::BroadcastLoop()
+{
+    _bindSucceeded = Bind() ? TRUE : FALSE;
+    _bound.set();
+
+    std::vector<SocketEvent> events;
+
+    while (_bindSucceeded && !_stopping.load(std::memory_order_acquire))
+    {
+        _inbox->Ready.wait(BROADCAST_WAIT_MILLISECONDS);
+
+        // reset before taking the events, a post after it sets the event again
+        _inbox->Ready.reset();
+
+        {
+            critical_section::scoped_lock lock(_inbox->Lock);
+            events.swap(_inbox->Events);
+        }
+
+        for (const SocketEvent& socketEvent : events)
+        {
+            HandleEvent(socketEvent);
+        }
+        events.clear();
+
+        TakeFrame();
+
+        // UDP subscribers have no connection to lose, they time out instead
+        ULONGLONG now = GetTickCount64();
+        for (auto& subscriber : _subscribers)
+        {
+            if (nullptr == subscriber.Socket && now - subscriber.LastHeard > _parameters.UdpTimeout)
+            {
+                subscriber.Closed = TRUE;
+            }
+        }
+
+        RemoveClosed();
+
+        critical_section::scoped_lock lock(_statisticsLock);
+        _publishedStatistics = _statistics;
+    }
+
+    Close();
+}
+
+bool SkeletonBroadcaster::Bind()
+{
+    std::shared_ptr<Inbox> inbox = _inbox;
+
+    try
+    {
+        if (0 != _parameters.TcpPort)
+        {
+            _listener = ref new StreamSocketListener();
+            _listener->ConnectionReceived += ref new TypedEventHandler<StreamSocketListener^, StreamSocketListenerConnectionReceivedEventArgs^>(
+                [inbox](StreamSocketListener^, StreamSocketListenerConnectionReceivedEventArgs^ args)
+            {
+                SocketEvent socketEvent(SocketEventType::Connected);
+                socketEvent.Socket = args->Socket;
+                inbox->Post(socketEvent);
+            });
+
+            create_task(_listener->BindEndpointAsync(GetLoopback(), GetServiceName(_parameters.TcpPort))).get();
+        }
+
+        if (0 != _parameters.UdpPort)
+        {
+            _datagramSocket = ref new DatagramSocket();
+            _datagramSocket->MessageReceived += ref new TypedEventHandler<DatagramSocket^, DatagramSocketMessageReceivedEventArgs^>(
+                [inbox](DatagramSocket^, DatagramSocketMessageReceivedEventArgs^ args)
+            {
+                SocketEvent socketEvent(SocketEventType::Datagram);
+
+                try
+                {
+                    DataReader^ reader = args->GetDataReader();
+                    if (sizeof(socketEvent.Datagram) != reader->UnconsumedBufferLength)
+                    {
+                        return;
+                    }
+
+                    reader->ReadBytes(ArrayReference<BYTE>(reinterpret_cast<BYTE*>(&socketEvent.Datagram), sizeof(socketEvent.Datagram)));
+                }
+                catch (Exception^)
+                {
+                    // a port that went away reports on the next receive
+                    return;
+                }
+
+                socketEvent.RemoteAddress = args->RemoteAddress;
+                socketEvent.RemotePort = args->RemotePort;
+                inbox->Post(socketEvent);
+            });
+
+            create_task(_datagramSocket->BindEndpointAsync(GetLoopback(), GetServiceName(_parameters.UdpPort))).get();
+        }
+    }
+    catch (Exception^)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void SkeletonBroadcaster::Close()
+{
+    for (auto& subscriber : _subscribers)
+    {
+        subscriber.Closed = TRUE;
+    }
+    RemoveClosed();
+
+    // deleting a socket closes it
+    delete _listener;
+    _listener = nullptr;
+
+    delete _datagramSocket;
+    _datagramSocket = nullptr;
+}
+
+void SkeletonBroadcaster::TakeFrame()
+{
+    {
+        critical_section::scoped_lock lock(_inbox->Lock);
+
+        if (!_inbox->HasFrame)
+        {
+            return;
+        }
+
+        _frame = _inbox->Frame;
+        _inbox->HasFrame = FALSE;
+    }
+
+    UINT sequence = _sequence++;
+    QuantizeSkeletonFrame(_frame, sequence, &_history[sequence % HISTORY_FRAMES]);
+
+    for (auto& subscriber : _subscribers)
+    {
+        // drop oldest, a slow subscriber only ever sees the latest frames
+        if (subscriber.Queue.size() >= _parameters.MaxQueuedFrames)
+        {
+            subscriber.Queue.pop_front();
+            ++_statistics.FramesDropped;
+        }
+        subscriber.Queue.push_back(sequence);
+
+        Flush(subscriber);
+    }
+}
+
+void SkeletonBroadcaster::HandleEvent(_In_ const SocketEvent& socketEvent)
+{
+    switch (socketEvent.Type)
+    {
+    case SocketEventType::Connected:
+        {
+            if (_subscribers.size() >= _parameters.MaxSubscribers)
+            {
+                delete socketEvent.Socket;
+                return;
+            }
+
+            // StreamSocket sends without Nagle's delay by default
+            Subscriber& subscriber = AddSubscriber();
+            subscriber.Socket = socketEvent.Socket;
+            ReadUntilClosed(_inbox, subscriber.Id, subscriber.Socket);
+        }
+        break;
+
+    case SocketEventType::Datagram:
+        ReceiveDatagram(socketEvent);
+        break;
+
+    case SocketEventType::Opened:
+        {
+            Subscriber* pSubscriber = FindSubscriber(socketEvent.SubscriberId);
+            if (nullptr == pSubscriber)
+            {
+                delete socketEvent.Output;
+                return;
+            }
+
+            pSubscriber->Output = socketEvent.Output;
+            pSubscriber->Closed |= !socketEvent.Succeeded;
+            Flush(*pSubscriber);
+        }
+        break;
+
+    case SocketEventType::Written:
+        {
+            Subscriber* pSubscriber = FindSubscriber(socketEvent.SubscriberId);
+            if (nullptr == pSubscriber)
+            {
+                return;
+            }
+
+            pSubscriber->Writing = FALSE;
+
+            if (socketEvent.Succeeded)
+            {
+                ++_statistics.FramesSent;
+                _statistics.BytesSent += socketEvent.Bytes;
+
+                // TCP delivers in order, a frame written out in full is the base of the next
+                if (nullptr != pSubscriber->Socket)
+                {
+                    pSubscriber->HasBase = TRUE;
+                    pSubscriber->BaseSequence = pSubscriber->WritingSequence;
+                }
+            }
+            else if (nullptr != pSubscriber->Socket)
+            {
+                pSubscriber->Closed = TRUE;
+                return;
+            }
+
+            // a lost datagram is as good as sent, the acknowledgements tell what arrived
+            Flush(*pSubscriber);
+        }
+        break;
+
+    case SocketEventType::Closed:
+        {
+            Subscriber* pSubscriber = FindSubscriber(socketEvent.SubscriberId);
+            if (nullptr != pSubscriber)
+            {
+                pSubscriber->Closed = TRUE;
+            }
+        }
+        break;
+    }
+}
+
+void SkeletonBroadcaster::ReceiveDatagram(_In_ const SocketEvent& socketEvent)
+{
+    const SkeletonWireDatagram& datagram = socketEvent.Datagram;
+    if (SKELETON_WIRE_MAGIC != datagram.Magic)
+    {
+        return;
+    }
+
+    Subscriber* pSubscriber = nullptr;
+    for (auto& subscriber : _subscribers)
+    {
+        if (nullptr == subscriber.Socket &&
+            subscriber.RemoteAddress->RawName == socketEvent.RemoteAddress->RawName && subscriber.RemotePort == socketEvent.RemotePort)
+        {
+            pSubscriber = &subscriber;
+            break;
+        }
+    }
+
+    if (nullptr == pSubscriber)
+    {
+        if (SKELETON_WIRE_LEAVE == datagram.Type || _subscribers.size() >= _parameters.MaxSubscribers)
+        {
+            return;
+        }
+
+        Subscriber& subscriber = AddSubscriber();
+        subscriber.RemoteAddress = socketEvent.RemoteAddress;
+        subscriber.RemotePort = socketEvent.RemotePort;
+        pSubscriber = &subscriber;
+
+        // frames queue up until the stream to the subscriber is open
+        std::shared_ptr<Inbox> inbox = _inbox;
+        UINT subscriberId = subscriber.Id;
+        create_task(_datagramSocket->GetOutputStreamAsync(socketEvent.RemoteAddress, socketEvent.RemotePort)).then(
+            [inbox, subscriberId](task<IOutputStream^> openTask)
+        {
+            SocketEvent opened(SocketEventType::Opened);
+            opened.SubscriberId = subscriberId;
+
+            try
+            {
+                opened.Output = openTask.get();
+                opened.Succeeded = TRUE;
+            }
+            catch (Exception^)
+            {
+            }
+
+            inbox->Post(opened);
+        });
+    }
+
+    pSubscriber->LastHeard = GetTickCount64();
+
+    if (SKELETON_WIRE_LEAVE == datagram.Type)
+    {
+        pSubscriber->Closed = TRUE;
+    }
+    else if (SKELETON_WIRE_ACK == datagram.Type && static_cast<INT32>(datagram.Sequence - _sequence) < 0 &&
+        (!pSubscriber->HasBase || static_cast<INT32>(datagram.Sequence - pSubscriber->BaseSequence) > 0))
+    {
+        pSubscriber->HasBase = TRUE;
+        pSubscriber->BaseSequence = datagram.Sequence;
+    }
+}
+
+void SkeletonBroadcaster::ReadUntilClosed(std::shared_ptr<Inbox> inbox, UINT subscriberId, StreamSocket^ socket)
+{
+    Buffer^ buffer = ref new Buffer(DISCARD_BUFFER_SIZE);
+
+    create_task(socket->InputStream->ReadAsync(buffer, DISCARD_BUFFER_SIZE, InputStreamOptions::Partial)).then(
+        [inbox, subscriberId, socket](task<IBuffer^> readTask)
+    {
+        BOOL closed = TRUE;
+        try
+        {
+            closed = (0 == readTask.get()->Length);
+        }
+        catch (Exception^)
+        {
+        }
+
+        if (!closed)
+        {
+            ReadUntilClosed(inbox, subscriberId, socket);
+            return;
+        }
+
+        SocketEvent socketEvent(SocketEventType::Closed);
+        socketEvent.SubscriberId = subscriberId;
+        inbox->Post(socketEvent);
+    });
+}
+
+SkeletonBroadcaster::Subscriber* SkeletonBroadcaster::FindSubscriber(UINT id)
+{
+    for (auto& subscriber : _subscribers)
+    {
+        if (subscriber.Id == id)
+        {
+            return &subscriber;
+        }
+    }
+
+    return nullptr;
+}
+
+SkeletonBroadcaster::Subscriber& SkeletonBroadcaster::AddSubscriber()
+{
+    Subscriber subscriber;
+    subscriber.Id = _nextSubscriberId++;
+    subscriber.HasBase = FALSE;
+    subscriber.BaseSequence = 0;
+    subscriber.Writing = FALSE;
+    subscriber.WritingSequence = 0;
+    subscriber.LastHeard = GetTickCount64();
+    subscriber.Closed = FALSE;
+    _subscribers.push_back(subscriber);
+
+    _subscriberCount.store(static_cast<UINT>(_subscribers.size()), std::memory_order_relaxed);
+
+    return _subscribers.back();
+}
+
+const std::vector<BYTE>& SkeletonBroadcaster::GetEncoded(UINT sequence, _In_ const Subscriber& subscriber)
+{
+    // a base the subscriber holds that is still in the history
+    BOOL keyFrame = !subscriber.HasBase ||
+        static_cast<INT32>(sequence - subscriber.BaseSequence) <= 0 ||
+        sequence - subscriber.BaseSequence >= HISTORY_FRAMES - _parameters.MaxQueuedFrames;
+    UINT baseSequence = keyFrame ? 0 : subscriber.BaseSequence;
+
+    for (UINT i = 0; i < ENCODED_CACHE_SIZE; ++i)
+    {
+        const EncodedFrame& encoded = _encoded[i];
+        if (!encoded.Bytes.empty() && encoded.Sequence == sequence && encoded.KeyFrame == keyFrame && encoded.BaseSequence == baseSequence)
+        {
+            return encoded.Bytes;
+        }
+    }
+
+    EncodedFrame& encoded = _encoded[_encodedNext];
+    _encodedNext = (_encodedNext + 1) % ENCODED_CACHE_SIZE;
+
+    encoded.Sequence = sequence;
+    encoded.BaseSequence = baseSequence;
+    encoded.KeyFrame = keyFrame;
+    encoded.Bytes.resize(SKELETON_WIRE_MAX_SIZE);
+
+    const SkeletonWireFrame* pBase = keyFrame ? nullptr : &_history[baseSequence % HISTORY_FRAMES];
+    UINT size = EncodeSkeletonFrame(_history[sequence % HISTORY_FRAMES], pBase, _parameters.Orientations, encoded.Bytes.data(), SKELETON_WIRE_MAX_SIZE);
+    ASSERT(0 != size);
+    encoded.Bytes.resize(size);
+
+    if (keyFrame)
+    {
+        ++_statistics.KeyFrames;
+    }
+
+    return encoded.Bytes;
+}
+
+void SkeletonBroadcaster::Flush(_Inout_ Subscriber& subscriber)
+{
+    // a UDP subscriber's stream may still be opening
+    IOutputStream^ output = (nullptr != subscriber.Socket) ? subscriber.Socket->OutputStream : subscriber.Output;
+    if (subscriber.Closed || subscriber.Writing || subscriber.Queue.empty() || nullptr == output)
+    {
+        return;
+    }
+
+    UINT sequence = subscriber.Queue.front();
+    subscriber.Queue.pop_front();
+
+    subscriber.Writing = TRUE;
+    subscriber.WritingSequence = sequence;
+
+    std::shared_ptr<Inbox> inbox = _inbox;
+    UINT subscriberId = subscriber.Id;
+    create_task(output->WriteAsync(ToBuffer(GetEncoded(sequence, subscriber)))).then(
+        [inbox, subscriberId](task<unsigned int> writeTask)
+    {
+        SocketEvent written(SocketEventType::Written);
+        written.SubscriberId = subscriberId;
+
+        try
+        {
+            written.Bytes = writeTask.get();
+            written.Succeeded = TRUE;
+        }
+        catch (Exception^)
+        {
+        }
+
+        inbox->Post(written);
+    });
+}
+
+void SkeletonBroadcaster::RemoveClosed()
+{
+    for (size_t i = 0; i < _subscribers.size();)
+    {
+        if (!_subscribers[i].Closed)
+        {
+            ++i;
+            continue;
+        }
+
+        // the write or read in flight completes with an error for a subscriber that is gone
+        delete _subscribers[i].Socket;
+        delete _subscribers[i].Output;
+
+        _subscribers[i] = _subscribers.back();
+        _subscribers.pop_back();
+    }
+
+    _subscriberCount.store(static_cast<UINT>(_subscribers.size()), std::memory_order_relaxed);
+}
@@ -0,0 +1,206 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonBroadcaster.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SkeletonWireFormat.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                struct SkeletonBroadcasterParameters
+                {
+                    USHORT  TcpPort;            // on the loopback address, 0 for none
+                    USHORT  UdpPort;
+                    UINT    MaxQueuedFrames;    // per subscriber, the oldest unsent frame is dropped past it
+                    UINT    MaxSubscribers;
+                    BOOL    Orientations;       // off keeps a moving body near 100 bytes a frame
+                    UINT    UdpTimeout;         // milliseconds without a datagram before a UDP subscriber is dropped
+
+                    SkeletonBroadcasterParameters()
+                        : TcpPort(8530)
+                        , UdpPort(8530)
+                        , MaxQueuedFrames(4)
+                        , MaxSubscribers(32)
+                        , Orientations(FALSE)
+                        , UdpTimeout(5000)
+                    {
+                    }
+                };
+
+                struct SkeletonBroadcasterStatistics
+                {
+                    UINT64  FramesPublished;
+                    UINT64  FramesSent;         // over all subscribers
+                    UINT64  FramesDropped;      // pushed out of a full queue, or published faster than the thread took them
+                    UINT64  KeyFrames;
+                    UINT64  BytesSent;
+                };
+
+                // sends body frames to local subscribers from a thread of its own, Publish only copies the frame.
+                // TCP subscribers connect, UDP subscribers send SKELETON_WIRE_SUBSCRIBE and then acknowledge the frames
+                // they decode. each frame is a delta against the last one the subscriber is known to hold: the last
+                // frame fully written to a TCP socket, or the last acknowledged UDP frame; with none it is a key frame.
+                // the sockets are Windows.Networking.Sockets ones, their callbacks post to the thread and only it
+                // touches the subscribers. other apps on the machine reach a Store app's loopback ports only with
+                // a loopback exemption.
+                class SkeletonBroadcaster
+                {
+                public:
+                    SkeletonBroadcaster();
+                    ~SkeletonBroadcaster();
+
+                    // false when a socket cannot be bound, waits for the thread to bind them
+                    bool Start(_In_ const SkeletonBroadcasterParameters& parameters);
+                    void Stop();
+
+                    BOOL IsRunning() const { return _thread.joinable(); }
+
+                    // from any thread, the latest frame not taken yet is replaced
+                    void Publish(_In_ const BodyFrameData& frame);
+
+                    UINT GetSubscriberCount() const { return _subscriberCount.load(std::memory_order_relaxed); }
+
+                    // from any thread, the counts may be a moment apart
+                    void GetStatistics(_Out_ SkeletonBroadcasterStatistics* pStatistics);
+
+                private:
+                    static const UINT HISTORY_FRAMES = 64;
+                    static const UINT ENCODED_CACHE_SIZE = 8;
+
+                    enum class SocketEventType
+                    {
+                        Connected,      // a TCP subscriber, in Socket
+                        Datagram,       // from RemoteAddress and RemotePort
+                        Opened,         // the output stream to a UDP subscriber, in Output
+                        Written,
+                        Closed,
+                    };
+
+                    // what a socket callback tells the thread
+                    struct SocketEvent
+                    {
+                        SocketEventType                                 Type;
+                        UINT                                            SubscriberId;
+                        BOOL                                            Succeeded;
+                        UINT                                            Bytes;
+                        Windows::Networking::Sockets::StreamSocket^     Socket;
+                        Windows::Storage::Streams::IOutputStream^       Output;
+                        Windows::Networking::HostName^                  RemoteAddress;
+                        Platform::String^                               RemotePort;
+                        SkeletonWireDatagram                            Datagram;
+
+                        explicit SocketEvent(SocketEventType type)
+                            : Type(type)
+                            , SubscriberId(0)
+                            , Succeeded(FALSE)
+                            , Bytes(0)
+                        {
+                            ZeroMemory(&Datagram, sizeof(Datagram));
+                        }
+                    };
+
+                    // shared with the socket callbacks, which may outlive the broadcaster
+                    struct Inbox
+                    {
+                        Concurrency::critical_section   Lock;
+                        Concurrency::event              Ready;
+                        std::vector<SocketEvent>        Events;
+                        BodyFrameData                   Frame;
+                        BOOL                            HasFrame;
+                        UINT64                          FramesPublished;
+                        UINT64                          FramesReplaced;
+
+                        void Post(_In_ const SocketEvent& socketEvent);
+                    };
+
+                    struct Subscriber
+                    {
+                        UINT                                            Id;
+                        Windows::Networking::Sockets::StreamSocket^     Socket;     // nullptr for UDP subscribers
+                        Windows::Storage::Streams::IOutputStream^       Output;     // nullptr until a UDP stream is open
+                        Windows::Networking::HostName^                  RemoteAddress;
+                        Platform::String^                               RemotePort;
+                        BOOL                                            HasBase;
+                        UINT                                            BaseSequence;   // last frame the subscriber holds
+                        std::deque<UINT>                                Queue;          // sequences of the frames not sent yet
+                        BOOL                                            Writing;        // one write in flight at a time
+                        UINT                                            WritingSequence;
+                        ULONGLONG                                       LastHeard;
+                        BOOL                                            Closed;
+                    };
+
+                    // subscribers with the same base share one encoding
+                    struct EncodedFrame
+                    {
+                        UINT                Sequence;
+                        UINT                BaseSequence;
+                        BOOL                KeyFrame;
+                        std::vector<BYTE>   Bytes;
+                    };
+
+                    void BroadcastLoop();
+                    bool Bind();
+                    void Close();
+
+                    void TakeFrame();
+                    void HandleEvent(_In_ const SocketEvent& socketEvent);
+                    void ReceiveDatagram(_In_ const SocketEvent& socketEvent);
+
+                    // subscribers have nothing to say over TCP, reading only finds out when they leave
+                    static void ReadUntilClosed(std::shared_ptr<Inbox> inbox, UINT subscriberId, Windows::Networking::Sockets::StreamSocket^ socket);
+
+                    Subscriber* FindSubscriber(UINT id);
+                    Subscriber& AddSubscriber();
+
+                    const std::vector<BYTE>& GetEncoded(UINT sequence, _In_ const Subscriber& subscriber);
+
+                    // starts the next queued write unless one is in flight
+                    void Flush(_Inout_ Subscriber& subscriber);
+
+                    void RemoveClosed();
+
+                private:
+                    SkeletonBroadcasterParameters   _parameters;
+                    std::shared_ptr<Inbox>          _inbox;
+                    std::thread                     _thread;
+                    std::atomic<bool>               _stopping;
+                    Concurrency::event              _bound;
+                    BOOL                            _bindSucceeded;
+
+                    // broadcast thread
+                    Windows::Networking::Sockets::StreamSocketListener^ _listener;
+                    Windows::Networking::Sockets::DatagramSocket^       _datagramSocket;
+
+                    BodyFrameData                   _frame;
+                    std::vector<SkeletonWireFrame>  _history;   // by sequence modulo HISTORY_FRAMES
+                    UINT                            _sequence;  // of the next frame
+
+                    std::vector<Subscriber>         _subscribers;
+                    UINT                            _nextSubscriberId;
+                    std::atomic<UINT>               _subscriberCount;
+                    std::vector<EncodedFrame>       _encoded;
+                    UINT                            _encodedNext;
+
+                    SkeletonBroadcasterStatistics   _statistics;
+
+                    // copied from the thread's once a pass
+                    Concurrency::critical_section   _statisticsLock;
+                    SkeletonBroadcasterStatistics   _publishedStatistics;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,477 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonInstanceBuilder.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SkeletonInstanceBuilder.h"
+
+using namespace KinectEvolution::Xaml::Controls::Base;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace WindowsPreview::Kinect;
+
+static const XMVECTOR BodyColor [] =
+{
+    { 1, 0, 0, 1 },
+    { 0, 1, 0, 1 },
+    { 0.25f, 1, 1, 1 },
+    { 1, 1, 0.25f, 1 },
+    { 1.0, 0.25f, 1, 1 },
+    { 0.5f, 0.5f, 1, 1 }
+};
+
+static const XMVECTOR JointAmbient = { 0.3f, 0.3f, 0.3f, 1.0f };
+static const XMVECTOR JointDiffuse = { 0.8f, 0.8f, 0.8f, 1.0f };
+static const XMVECTOR BodySpecular = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+// 1 + y below which the direction is taken as straight down
+static const float OPPOSITE_UP_EPSILON = 1e-6f;
+
+// radius of each batch's round cross section on the unit primitive, zero for the shapes with one level,
+// and how far up its y axis the middle of the primitive is
+static const float BatchLodRadius [] = { 0.0f, 0.5f, 1.0f, 0.3f, 0.0f, 0.5f };
+static const float BatchLodCenter [] = { 0.0f, 0.0f, 0.5f, 0.5f, 0.0f, 0.0f };
+
+inline XMVECTOR LoadLanes(_In_reads_(4) const float* pSource)
+{
+    return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource));
+}
+
+SkeletonInstanceBuilder::SkeletonInstanceBuilder()
+{
+    // enough for every body fully drawn, so building a frame does not allocate
+    static const UINT MAX_SEGMENTS = BODY_COUNT * (_countof(BodyBones) + JOINT_COUNT * 2);
+
+    for (UINT i = 0; i < static_cast<UINT>(SkeletonBatch::Count); ++i)
+    {
+        _instances[i].reserve(BODY_COUNT * JOINT_COUNT * 2);
+    }
+
+    for (UINT i = 0; i < SegmentStreamCount; ++i)
+    {
+        _segments[i].reserve(MAX_SEGMENTS + 3);
+    }
+
+    _segmentBatches.reserve(MAX_SEGMENTS + 3);
+    _segmentInstances.reserve(MAX_SEGMENTS + 3);
+}
+
+void SkeletonInstanceBuilder::Build(
+    _In_ const BodyFrameData& bodies,
+    BOOL renderBones,
+    BOOL renderJoints,
+    BOOL renderHandStates,
+    BOOL renderJointOrientations)
+{
+    for (UINT i = 0; i < static_cast<UINT>(SkeletonBatch::Count); ++i)
+    {
+        _instances[i].clear();
+    }
+
+    for (UINT i = 0; i < SegmentStreamCount; ++i)
+    {
+        _segments[i].clear();
+    }
+
+    _segmentBatches.clear();
+    _segmentInstances.clear();
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        if (!bodies.IsTracked[bodyIndex])
+        {
+            continue;
+        }
+
+        if (renderBones)
+        {
+            AddBones(bodies, bodyIndex);
+        }
+
+        if (renderJoints)
+        {
+            AddJoints(bodies, bodyIndex);
+        }
+
+        if (renderJointOrientations)
+        {
+            AddJointOrientations(bodies, bodyIndex);
+        }
+
+        if (renderHandStates)
+        {
+            AddHandStates(bodies, bodyIndex);
+        }
+    }
+
+    TransformSegments();
+
+    for (UINT i = 0; i < static_cast<UINT>(SkeletonBatch::Count); ++i)
+    {
+        _lodStart[i][0] = 0;
+        for (UINT lod = 1; lod <= PRIMITIVE_LOD_COUNT; ++lod)
+        {
+            _lodStart[i][lod] = static_cast<UINT>(_instances[i].size());
+        }
+    }
+}
+
+void SkeletonInstanceBuilder::SelectLods(FXMMATRIX view, CXMMATRIX projection, float viewportHeight)
+{
+    // a circle of n segments is at most r (1 - cos(pi / n)) ~ r pi^2 / 2n^2 inside the true one,
+    // which gives the largest radius in pixels each level draws within the error
+    float maxRadius[PRIMITIVE_LOD_COUNT];
+    for (UINT lod = 0; lod < PRIMITIVE_LOD_COUNT; ++lod)
+    {
+        float segments = static_cast<float>(PrimitiveLodSegments[lod]) / XM_PI;
+        maxRadius[lod] = 2.0f * LOD_PIXEL_ERROR * segments * segments;
+    }
+
+    XMMATRIX viewProjection = XMMatrixMultiply(view, projection);
+    float pixelsPerUnit = XMVectorGetY(projection.r[1]) * viewportHeight * 0.5f;
+
+    for (UINT i = 0; i < static_cast<UINT>(SkeletonBatch::Count); ++i)
+    {
+        std::vector<PrimitiveInstance>& instances = _instances[i];
+        UINT count = static_cast<UINT>(instances.size());
+
+        if (0 == count || 0.0f == BatchLodRadius[i])
+        {
+            continue;
+        }
+
+        UINT lodCount[PRIMITIVE_LOD_COUNT] = {};
+        _lods.resize(count);
+
+        for (UINT j = 0; j < count; ++j)
+        {
+            XMMATRIX world = XMLoadFloat4x4(&instances[j]._world);
+
+            XMVECTOR center = XMVectorMultiplyAdd(XMVectorReplicate(BatchLodCenter[i]), world.r[1], world.r[3]);
+            float depth = XMVectorGetW(XMVector3Transform(center, viewProjection));
+
+            // the x axis carries the radial scale of joints and segments alike
+            float radius = BatchLodRadius[i] * XMVectorGetX(XMVector3Length(world.r[0]));
+            float pixels = (depth > 0.0f) ? radius * pixelsPerUnit / depth : FLT_MAX;
+
+            UINT lod = 0;
+            while (lod + 1 < PRIMITIVE_LOD_COUNT && pixels <= maxRadius[lod + 1])
+            {
+                ++lod;
+            }
+
+            _lods[j] = static_cast<BYTE>(lod);
+            lodCount[lod]++;
+        }
+
+        UINT* pStart = _lodStart[i];
+        pStart[0] = 0;
+        for (UINT lod = 0; lod < PRIMITIVE_LOD_COUNT; ++lod)
+        {
+            pStart[lod + 1] = pStart[lod] + lodCount[lod];
+        }
+
+        // stable within a level, so bodies keep their draw order
+        UINT next[PRIMITIVE_LOD_COUNT];
+        memcpy(next, pStart, sizeof(next));
+
+        _sorted.resize(count);
+        for (UINT j = 0; j < count; ++j)
+        {
+            _sorted[next[_lods[j]]++] = instances[j];
+        }
+
+        instances.swap(_sorted);
+    }
+}
+
+UINT SkeletonInstanceBuilder::GetTriangleCount() const
+{
+    UINT triangles = 0;
+
+    for (UINT i = 0; i < static_cast<UINT>(SkeletonBatch::Count); ++i)
+    {
+        for (UINT lod = 0; lod < PRIMITIVE_LOD_COUNT; ++lod)
+        {
+            UINT count = GetInstanceCount(static_cast<SkeletonBatch>(i), lod);
+            if (count > 0)
+            {
+                triangles += count * GetPrimitiveGeometry(SkeletonBatchPrimitive[i], lod).GetTriangleCount();
+            }
+        }
+    }
+
+    return triangles;
+}
+
+PrimitiveInstance& SkeletonInstanceBuilder::AddInstance(SkeletonBatch batch, FXMVECTOR ambient, FXMVECTOR diffuse, FXMVECTOR specular, _Out_opt_ UINT* pIndex)
+{
+    std::vector<PrimitiveInstance>& instances = _instances[static_cast<UINT>(batch)];
+
+    if (nullptr != pIndex)
+    {
+        *pIndex = static_cast<UINT>(instances.size());
+    }
+
+    instances.resize(instances.size() + 1);
+
+    PrimitiveInstance& instance = instances.back();
+    XMStoreFloat4(&instance._ambient, ambient);
+    XMStoreFloat4(&instance._diffuse, diffuse);
+    XMStoreFloat4(&instance._specular, specular);
+
+    return instance;
+}
+
+void SkeletonInstanceBuilder::AddSegment(
+    SkeletonBatch batch,
+    FXMVECTOR start,
+    FXMVECTOR end,
+    float radialScale,
+    float axialScale,
+    GXMVECTOR ambient,
+    CXMVECTOR diffuse,
+    CXMVECTOR specular)
+{
+    UINT index = 0;
+    AddInstance(batch, ambient, diffuse, specular, &index);
+
+    XMFLOAT3 s, d;
+    XMStoreFloat3(&s, start);
+    XMStoreFloat3(&d, end - start);
+
+    _segments[StartX].push_back(s.x);
+    _segments[StartY].push_back(s.y);
+    _segments[StartZ].push_back(s.z);
+    _segments[DeltaX].push_back(d.x);
+    _segments[DeltaY].push_back(d.y);
+    _segments[DeltaZ].push_back(d.z);
+    _segments[RadialScale].push_back(radialScale);
+    _segments[AxialScale].push_back(axialScale);
+
+    _segmentBatches.push_back(batch);
+    _segmentInstances.push_back(index);
+}
+
+void SkeletonInstanceBuilder::AddBones(_In_ const BodyFrameData& bodies, UINT bodyIndex)
+{
+    for (UINT i = 0; i < _countof(BodyBones); i++)
+    {
+        UINT jointA = static_cast<UINT>(BodyBones[i].JointA);
+        UINT jointB = static_cast<UINT>(BodyBones[i].JointB);
+
+        XMVECTOR positionA = bodies.GetPosition(bodyIndex, jointA);
+        XMVECTOR positionB = bodies.GetPosition(bodyIndex, jointB);
+        if (XMVector3Equal(positionA, XMVectorZero()) || XMVector3Equal(positionB, XMVectorZero()))
+        {
+            continue;
+        }
+
+        float boneScale = DefaultBoneSize / 2; // cylinder has a radius of 1.0f so div 2 to scale correctly
+
+        if (bodies.GetTrackingState(bodyIndex, jointA) != TrackingState::Tracked || bodies.GetTrackingState(bodyIndex, jointB) != TrackingState::Tracked)
+        {
+            boneScale *= NonTrackedScale;
+        }
+
+        AddSegment(SkeletonBatch::Cylinder, positionA, positionB, boneScale, 0.0f, BodyColor[bodyIndex], JointDiffuse, BodySpecular);
+    }
+}
+
+void SkeletonInstanceBuilder::AddJoints(_In_ const BodyFrameData& bodies, UINT bodyIndex)
+{
+    for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+    {
+        XMVECTOR position = bodies.GetPosition(bodyIndex, jointIndex);
+        if (XMVector3Equal(position, XMVectorZero()))
+        {
+            continue;
+        }
+
+        SkeletonBatch batch = SkeletonBatch::Sphere;
+        float jointSize = DefaultJointSize;
+        switch (static_cast<JointType>(jointIndex))
+        {
+        case JointType::SpineBase:
+        case JointType::SpineMid:
+        case JointType::SpineShoulder:
+        case JointType::Neck:
+        case JointType::Head:
+            batch = SkeletonBatch::Pyramid;
+            jointSize *= 1.15f; // make pyramid joints a little bigger
+            break;
+        case JointType::ShoulderRight:
+        case JointType::ElbowRight:
+        case JointType::WristRight:
+        case JointType::HandRight:
+        case JointType::HandTipRight:
+        case JointType::ThumbRight:
+        case JointType::HipRight:
+        case JointType::KneeRight:
+        case JointType::AnkleRight:
+        case JointType::FootRight:
+            batch = SkeletonBatch::Cube;
+            jointSize *= 0.85f; // make cube joints a little smaller
+            break;
+        }
+
+        // render inferred and not tracked joints smaller
+        if (bodies.GetTrackingState(bodyIndex, jointIndex) != TrackingState::Tracked)
+        {
+            jointSize *= NonTrackedScale;
+        }
+
+        PrimitiveInstance& instance = AddInstance(batch, JointAmbient, JointDiffuse, BodySpecular, nullptr);
+        XMStoreFloat4x4(&instance._world, XMMatrixScaling(jointSize, jointSize, jointSize) * XMMatrixTranslationFromVector(position));
+    }
+}
+
+void SkeletonInstanceBuilder::AddJointOrientations(_In_ const BodyFrameData& bodies, UINT bodyIndex)
+{
+    for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+    {
+        XMVECTOR position = bodies.GetPosition(bodyIndex, jointIndex);
+        XMVECTOR orientation = bodies.GetOrientation(bodyIndex, jointIndex);
+        if (XMVector3Equal(position, XMVectorZero()) || XMVector4Equal(orientation, XMVectorZero()))
+        {
+            continue;
+        }
+
+        XMVECTOR normal = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), orientation);
+        if (XMVector3Equal(normal, XMVectorZero()))
+        {
+            continue;
+        }
+
+        XMVECTOR handleEnd = position + DefaultNormalHandleLength * normal;
+        XMVECTOR arrowEnd = handleEnd + DefaultNormalArrowLength * normal;
+
+        AddSegment(SkeletonBatch::Cylinder, position, handleEnd, DefaultNormalHandleSize, 0.0f, JointAmbient, JointDiffuse, BodySpecular);
+        AddSegment(SkeletonBatch::Cone, handleEnd, arrowEnd, DefaultNormalArrowLength, DefaultNormalArrowLength, JointAmbient, JointDiffuse, BodySpecular);
+    }
+}
+
+void SkeletonInstanceBuilder::AddHandStates(_In_ const BodyFrameData& bodies, UINT bodyIndex)
+{
+    const UINT hands [] =
+    {
+        static_cast<UINT>(JointType::HandLeft),
+        static_cast<UINT>(JointType::HandRight)
+    };
+
+    const HandState handStates [] =
+    {
+        bodies.HandLeftState[bodyIndex],
+        bodies.HandRightState[bodyIndex]
+    };
+
+    for (UINT i = 0; i < 2; i++)
+    {
+        XMVECTOR handPosition = bodies.GetPosition(bodyIndex, hands[i]);
+        if (XMVector3Equal(handPosition, XMVectorZero()))
+        {
+            continue; // don't render when hand position is not filled in
+        }
+
+        XMVECTOR color = NotTrackedColor;
+        if (bodies.GetTrackingState(bodyIndex, hands[i]) == TrackingState::Tracked)
+        {
+            UINT index = static_cast<int>(handStates[i]);
+
+            color = HandStateColorTable[min(index - 2, _countof(HandStateColorTable) - 1)];
+        }
+
+        // ambient only
+        PrimitiveInstance& instance = AddInstance(SkeletonBatch::HandState, color, XMVectorZero(), XMVectorZero(), nullptr);
+        XMStoreFloat4x4(&instance._world,
+            XMMatrixScaling(DefaultHandStateSize, DefaultHandStateSize, DefaultHandStateSize) *
+            XMMatrixTranslationFromVector(handPosition));
+    }
+}
+
+void SkeletonInstanceBuilder::TransformSegments()
+{
+    UINT count = static_cast<UINT>(_segmentBatches.size());
+    if (0 == count)
+    {
+        return;
+    }
+
+    // pad to whole vectors with a harmless unit segment
+    for (UINT i = count; 0 != (i & 3); ++i)
+    {
+        for (UINT stream = 0; stream < SegmentStreamCount; ++stream)
+        {
+            _segments[stream].push_back((DeltaY == stream) ? 1.0f : 0.0f);
+        }
+    }
+
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR one = XMVectorSplatOne();
+    const XMVECTOR epsilon = XMVectorReplicate(OPPOSITE_UP_EPSILON);
+
+    for (UINT i = 0; i < count; i += 4)
+    {
+        XMVECTOR dx = LoadLanes(&_segments[DeltaX][i]);
+        XMVECTOR dy = LoadLanes(&_segments[DeltaY][i]);
+        XMVECTOR dz = LoadLanes(&_segments[DeltaZ][i]);
+
+        // unit direction, up for a zero length segment
+        XMVECTOR length = XMVectorSqrt(XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz))));
+        XMVECTOR hasLength = XMVectorGreater(length, zero);
+        XMVECTOR invLength = XMVectorSelect(zero, XMVectorReciprocal(length), hasLength);
+        XMVECTOR x = dx * invLength;
+        XMVECTOR y = XMVectorSelect(one, dy * invLength, hasLength);
+        XMVECTOR z = dz * invLength;
+
+        XMVECTOR radial = LoadLanes(&_segments[RadialScale][i]);
+        XMVECTOR axial = LoadLanes(&_segments[AxialScale][i]);
+        axial = XMVectorSelect(axial, length, XMVectorLessOrEqual(axial, zero));
+
+        // rotation taking up onto the direction about their common normal, in closed form
+        XMVECTOR onePlusY = one + y;
+        XMVECTOR down = XMVectorLess(onePlusY, epsilon);
+        XMVECTOR k = XMVectorSelect(XMVectorReciprocal(onePlusY), zero, down);
+
+        XMVECTOR xzk = x * z * k;
+
+        XMVECTOR r00 = (one - x * x * k) * radial;
+        XMVECTOR r01 = XMVectorNegate(x) * radial;
+        XMVECTOR r02 = XMVectorNegate(xzk) * radial;
+
+        XMVECTOR r10 = x * axial;
+        XMVECTOR r11 = y * axial;
+        XMVECTOR r12 = z * axial;
+
+        XMVECTOR r20 = XMVectorNegate(xzk) * radial;
+        XMVECTOR r21 = XMVectorNegate(z) * radial;
+        XMVECTOR r22 = XMVectorSelect(one - z * z * k, XMVectorNegate(one), down) * radial;
+
+        XMFLOAT4 rows[9];
+        XMStoreFloat4(&rows[0], r00);
+        XMStoreFloat4(&rows[1], r01);
+        XMStoreFloat4(&rows[2], r02);
+        XMStoreFloat4(&rows[3], r10);
+        XMStoreFloat4(&rows[4], r11);
+        XMStoreFloat4(&rows[5], r12);
+        XMStoreFloat4(&rows[6], r20);
+        XMStoreFloat4(&rows[7], r21);
+        XMStoreFloat4(&rows[8], r22);
+
+        for (UINT lane = 0; lane < 4 && i + lane < count; ++lane)
+        {
+            UINT segment = i + lane;
+            XMFLOAT4X4& world = _instances[static_cast<UINT>(_segmentBatches[segment])][_segmentInstances[segment]]._world;
+
+            const float* pRows = &rows[0].x + lane;
+
+            world = XMFLOAT4X4(
+                pRows[0], pRows[4], pRows[8], 0.0f,
+                pRows[12], pRows[16], pRows[20], 0.0f,
+                pRows[24], pRows[28], pRows[32], 0.0f,
+                _segments[StartX][segment], _segments[StartY][segment], _segments[StartZ][segment], 1.0f);
+        }
+    }
+}
@@ -0,0 +1,155 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonInstanceBuilder.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+#include "PrimitiveGeometry.h"
+#include "PrimitiveInstance.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                // following the hand state color table in NuiView
+                static const DirectX::XMVECTOR HandStateColorTable [] =
+                {
+                    { 0.0f, 1.0f, 0.0f, 0.7f }, // open
+                    { 1.0f, 0.0f, 0.0f, 0.7f }, // closed
+                    { 0.0f, 0.0f, 1.0f, 0.7f }, // lasso
+                    { 0.5f, 0.5f, 0.5f, 0.5f }, // unknown
+                };
+
+                static const XMVECTOR NotTrackedColor = { 0.0f, 0.0f, 0.0f, 0.3f };
+
+                static const float DefaultJointSize = 0.05f; // diameter in world space (meters)
+                static const float DefaultBoneSize = 0.03f; // diameter in world space
+                static const float NonTrackedScale = 0.3f; // render non-tracked joints different than tracked ones
+
+                static const float DefaultNormalHandleSize = 0.01f; // diameter of the handle
+                static const float DefaultNormalHandleLength = 0.05f; // length of the handle
+                static const float DefaultNormalArrowLength = 0.05f;
+
+                static const float DefaultHandStateSize = 4 * DefaultJointSize;
+
+                // one instance array per primitive, the first five in DefaultPrimitive order
+                enum class SkeletonBatch : UINT
+                {
+                    Cube = 0,
+                    Sphere,
+                    Cylinder,
+                    Cone,
+                    Pyramid,
+                    HandState,  // spheres drawn after everything else so they blend over the bodies
+                    Count
+                };
+
+                // the primitive each batch is drawn with
+                static const Base::DefaultPrimitive SkeletonBatchPrimitive [] =
+                {
+                    Base::DefaultPrimitive::Cube,
+                    Base::DefaultPrimitive::Sphere,
+                    Base::DefaultPrimitive::Cylinder,
+                    Base::DefaultPrimitive::Cone,
+                    Base::DefaultPrimitive::Pyramid,
+                    Base::DefaultPrimitive::Sphere,
+                };
+
+                // screen error the coarser levels of detail are allowed, in pixels off the true silhouette
+                static const float LOD_PIXEL_ERROR = 0.5f;
+
+                // collects the joints, bones, orientation arrows and hand states of all bodies as primitive instances
+                class SkeletonInstanceBuilder
+                {
+                public:
+                    SkeletonInstanceBuilder();
+
+                    void Build(
+                        _In_ const BodyFrameData& bodies,
+                        BOOL renderBones,
+                        BOOL renderJoints,
+                        BOOL renderHandStates,
+                        BOOL renderJointOrientations);
+
+                    UINT GetInstanceCount(SkeletonBatch batch) const
+                    {
+                        return static_cast<UINT>(_instances[static_cast<UINT>(batch)].size());
+                    }
+
+                    // nullptr when the batch is empty
+                    const Base::PrimitiveInstance* GetInstances(SkeletonBatch batch) const
+                    {
+                        const std::vector<Base::PrimitiveInstance>& instances = _instances[static_cast<UINT>(batch)];
+                        return instances.empty() ? nullptr : &instances[0];
+                    }
+
+                    // orders the instances of each batch by level of detail, the finest first, from the radius of
+                    // their round cross section on screen. until it is called after Build all are at the finest
+                    void SelectLods(FXMMATRIX view, CXMMATRIX projection, float viewportHeight);
+
+                    UINT GetInstanceCount(SkeletonBatch batch, UINT lod) const
+                    {
+                        const UINT* pStart = _lodStart[static_cast<UINT>(batch)];
+                        return pStart[lod + 1] - pStart[lod];
+                    }
+
+                    // nullptr when the batch has no instances at the level
+                    const Base::PrimitiveInstance* GetInstances(SkeletonBatch batch, UINT lod) const
+                    {
+                        return (0 == GetInstanceCount(batch, lod)) ? nullptr : &_instances[static_cast<UINT>(batch)][_lodStart[static_cast<UINT>(batch)][lod]];
+                    }
+
+                    // triangles drawn for all batches at their levels
+                    UINT GetTriangleCount() const;
+
+                private:
+                    void AddBones(_In_ const BodyFrameData& bodies, UINT bodyIndex);
+                    void AddJoints(_In_ const BodyFrameData& bodies, UINT bodyIndex);
+                    void AddJointOrientations(_In_ const BodyFrameData& bodies, UINT bodyIndex);
+                    void AddHandStates(_In_ const BodyFrameData& bodies, UINT bodyIndex);
+
+                    Base::PrimitiveInstance& AddInstance(SkeletonBatch batch, FXMVECTOR ambient, FXMVECTOR diffuse, FXMVECTOR specular, _Out_opt_ UINT* pIndex);
+
+                    // a primitive along the y axis stretched or placed from start towards end,
+                    // as PrimitiveEffect::TransformUnitUpVector; axialScale of 0 stretches to the end
+                    void AddSegment(
+                        SkeletonBatch batch,
+                        FXMVECTOR start,
+                        FXMVECTOR end,
+                        float radialScale,
+                        float axialScale,
+                        GXMVECTOR ambient,
+                        CXMVECTOR diffuse,
+                        CXMVECTOR specular);
+
+                    // fills in the world matrices of the segments, 4 at a time
+                    void TransformSegments();
+
+                private:
+                    enum SegmentStream
+                    {
+                        StartX, StartY, StartZ,
+                        DeltaX, DeltaY, DeltaZ,
+                        RadialScale, AxialScale,
+                        SegmentStreamCount
+                    };
+
+                    std::vector<Base::PrimitiveInstance>    _instances[static_cast<UINT>(SkeletonBatch::Count)];
+                    UINT                                    _lodStart[static_cast<UINT>(SkeletonBatch::Count)][Base::PRIMITIVE_LOD_COUNT + 1];
+                    std::vector<BYTE>                       _lods;
+                    std::vector<Base::PrimitiveInstance>    _sorted;
+
+                    // segments waiting for their matrix and the instance each one belongs to
+                    std::vector<float>                      _segments[SegmentStreamCount];
+                    std::vector<SkeletonBatch>              _segmentBatches;
+                    std::vector<UINT>                       _segmentInstances;
+                };
+
+            }
+        }
+    }
+}
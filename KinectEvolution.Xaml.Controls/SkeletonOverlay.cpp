@@ -0,0 +1,324 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonOverlay.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SkeletonOverlay.h"
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace DirectX;
+using namespace Windows::Foundation;
+using namespace Windows::Foundation::Collections;
+
+using namespace WindowsPreview::Kinect;
+
+// pixels the projection may be off the mapper before the mapper is used instead
+static const float MAX_PROJECTION_ERROR = 2.0f;
+
+// camera space grid mapped to fit the color camera, meters
+static const UINT FIT_GRID_SIZE = 5;
+static const UINT FIT_GRID_DEPTHS = 4;
+
+// DIPs on screen, whatever the image is scaled by
+static const float BONE_THICKNESS = 3.0f;
+static const float JOINT_RADIUS = 3.0f;
+
+SkeletonOverlay::SkeletonOverlay(Body2DMode mode)
+    : _mode(mode)
+    , _mapperChanged(true)
+    , _checked(FALSE)
+    , _useMapper(FALSE)
+    , _projectionError(-1.0f)
+    , _cameraPoints(ref new Platform::Array<CameraSpacePoint>(BODY_JOINT_COUNT))
+    , _colorPoints(ref new Platform::Array<ColorSpacePoint>(BODY_JOINT_COUNT))
+    , _depthPoints(ref new Platform::Array<DepthSpacePoint>(BODY_JOINT_COUNT))
+    , _pixels(BODY_JOINT_COUNT)
+{
+    _mapperChangedToken.Value = 0;
+
+    _bodyData.Clear();
+    _projection.SetCamera(CameraModel::GetDefault(mode));
+    _mapped.SetCamera(CameraModel::GetDefault(mode));
+}
+
+SkeletonOverlay::~SkeletonOverlay()
+{
+    SetCoordinateMapper(nullptr);
+}
+
+void SkeletonOverlay::SetMode(Body2DMode mode)
+{
+    if (mode == _mode)
+    {
+        return;
+    }
+
+    _mode = mode;
+    _mapperChanged = true;
+}
+
+void SkeletonOverlay::SetBodySource(_In_opt_ WRK::BodyFrameSource^ source)
+{
+    if (source == _bodySource)
+    {
+        return;
+    }
+
+    // close the previous reader
+    _bodyReader = nullptr;
+    _bodyData.Clear();
+
+    _bodySource = source;
+    if (nullptr != _bodySource)
+    {
+        _bodyReader = _bodySource->OpenReader();
+    }
+}
+
+void SkeletonOverlay::SetCoordinateMapper(_In_opt_ WRK::CoordinateMapper^ mapper)
+{
+    if (mapper == _coordinateMapper)
+    {
+        return;
+    }
+
+    // unsubscribe
+    if (nullptr != _coordinateMapper)
+    {
+        _coordinateMapper->CoordinateMappingChanged -= _mapperChangedToken;
+    }
+
+    _coordinateMapper = mapper;
+    if (nullptr != _coordinateMapper)
+    {
+        // raised on the sensor's thread, the camera is fitted on the next Update
+        std::atomic<bool>* pChanged = &_mapperChanged;
+        _mapperChangedToken = _coordinateMapper->CoordinateMappingChanged +=
+            ref new TypedEventHandler<CoordinateMapper^, CoordinateMappingChangedEventArgs^>(
+                [pChanged](CoordinateMapper^, CoordinateMappingChangedEventArgs^) { *pChanged = true; });
+    }
+
+    _mapperChanged = true;
+}
+
+void SkeletonOverlay::Update()
+{
+    if (_mapperChanged.exchange(false))
+    {
+        FitCamera();
+    }
+
+    if (nullptr == _bodyReader)
+    {
+        return;
+    }
+
+    BodyFrame^ frame = _bodyReader->AcquireLatestFrame();
+    if (nullptr == frame)
+    {
+        return;
+    }
+
+    if (nullptr == _bodies)
+    {
+        _bodies = ref new Platform::Collections::Vector<Body^>(frame->BodyCount);
+    }
+
+    frame->GetAndRefreshBodyData(_bodies);
+    _bodyData.Load(_bodies, frame->RelativeTime, frame->FloorClipPlane);
+
+    bool anyTracked = false;
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        anyTracked = anyTracked || !!_bodyData.IsTracked[bodyIndex];
+    }
+
+    if (_useMapper)
+    {
+        MapWithMapper(_mapped);
+    }
+    else
+    {
+        _projection.Project(_bodyData);
+
+        // the first tracked frame after a fit checks the projection against the mapper
+        if (!_checked && anyTracked && nullptr != _coordinateMapper)
+        {
+            MapWithMapper(_mapped);
+
+            _projectionError = _projection.GetMaxDistance(_mapped);
+            _useMapper = _projectionError > MAX_PROJECTION_ERROR;
+            _checked = TRUE;
+        }
+    }
+
+    const JointProjection& projection = _useMapper ? _mapped : _projection;
+
+    _lines.clear();
+    _points.clear();
+    projection.GetBoneLines(_bodyData, _lines);
+    projection.GetJointPoints(_bodyData, _points);
+}
+
+void SkeletonOverlay::Render(_In_ ID2D1DeviceContext* pContext, float width, float height)
+{
+    if (nullptr == _trackedBrush || (_lines.empty() && _points.empty()))
+    {
+        return;
+    }
+
+    // the image fills the panel at its aspect ratio, centered
+    const CameraModel& camera = _projection.GetCamera();
+    float imageWidth = static_cast<float>(camera.Width);
+    float imageHeight = static_cast<float>(camera.Height);
+    float scale = min(width / imageWidth, height / imageHeight);
+
+    pContext->BeginDraw();
+    pContext->SetTransform(
+        D2D1::Matrix3x2F::Scale(scale, scale) *
+        D2D1::Matrix3x2F::Translation((width - imageWidth * scale) / 2.0f, (height - imageHeight * scale) / 2.0f));
+
+    for (size_t i = 0; i + 1 < _lines.size(); i += 2)
+    {
+        const OverlayVertex& start = _lines[i];
+        const OverlayVertex& end = _lines[i + 1];
+
+        pContext->DrawLine(
+            D2D1::Point2F(start.Position.x, start.Position.y),
+            D2D1::Point2F(end.Position.x, end.Position.y),
+            start.Inferred ? _inferredBrush.Get() : _trackedBrush.Get(),
+            BONE_THICKNESS / scale);
+    }
+
+    for (const OverlayVertex& point : _points)
+    {
+        pContext->FillEllipse(
+            D2D1::Ellipse(D2D1::Point2F(point.Position.x, point.Position.y), JOINT_RADIUS / scale, JOINT_RADIUS / scale),
+            point.Inferred ? _inferredBrush.Get() : _trackedBrush.Get());
+    }
+
+    pContext->SetTransform(D2D1::Matrix3x2F::Identity());
+
+    // a lost device is handled when the panel presents
+    pContext->EndDraw();
+}
+
+void SkeletonOverlay::CreateDeviceResources(_In_ ID2D1DeviceContext* pContext)
+{
+    DX::ThrowIfFailed(
+        pContext->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::LimeGreen), &_trackedBrush)
+        );
+
+    DX::ThrowIfFailed(
+        pContext->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Yellow), &_inferredBrush)
+        );
+}
+
+void SkeletonOverlay::ResetDeviceResources()
+{
+    _trackedBrush.ReleaseAndGetAddressOf();
+    _inferredBrush.ReleaseAndGetAddressOf();
+}
+
+void SkeletonOverlay::FitCamera()
+{
+    CameraModel camera = CameraModel::GetDefault(_mode);
+
+    if (nullptr != _coordinateMapper)
+    {
+        if (Body2DMode::DepthIR == _mode)
+        {
+            // all zero until the sensor has reported them
+            CameraIntrinsics intrinsics = _coordinateMapper->GetDepthCameraIntrinsics();
+            if (intrinsics.FocalLengthX > 0.0f)
+            {
+                camera = CameraModel::FromIntrinsics(intrinsics);
+            }
+        }
+        else
+        {
+            // the mapper does not report the color intrinsics, so fit them to where it puts a grid of points
+            const UINT count = FIT_GRID_SIZE * FIT_GRID_SIZE * FIT_GRID_DEPTHS;
+            auto gridPoints = ref new Platform::Array<CameraSpacePoint>(count);
+            auto gridPixels = ref new Platform::Array<ColorSpacePoint>(count);
+
+            std::vector<XMFLOAT3> points(count);
+            for (UINT i = 0; i < count; ++i)
+            {
+                UINT column = i % FIT_GRID_SIZE;
+                UINT row = (i / FIT_GRID_SIZE) % FIT_GRID_SIZE;
+                UINT depth = i / (FIT_GRID_SIZE * FIT_GRID_SIZE);
+
+                points[i] = XMFLOAT3(
+                    -1.5f + 3.0f * column / (FIT_GRID_SIZE - 1),
+                    -1.0f + 2.0f * row / (FIT_GRID_SIZE - 1),
+                    1.0f + depth);
+
+                gridPoints[i].X = points[i].x;
+                gridPoints[i].Y = points[i].y;
+                gridPoints[i].Z = points[i].z;
+            }
+
+            _coordinateMapper->MapCameraPointsToColorSpace(gridPoints, gridPixels);
+
+            std::vector<XMFLOAT2> pixels(count);
+            for (UINT i = 0; i < count; ++i)
+            {
+                pixels[i] = XMFLOAT2(gridPixels[i].X, gridPixels[i].Y);
+            }
+
+            CameraModel fitted;
+            if (CameraModel::Fit(points.data(), pixels.data(), count, camera.Width, camera.Height, &fitted))
+            {
+                camera = fitted;
+            }
+        }
+    }
+
+    _projection.SetCamera(camera);
+    _mapped.SetCamera(camera);
+
+    // checked again on the next tracked frame
+    _checked = FALSE;
+    _useMapper = FALSE;
+    _projectionError = -1.0f;
+}
+
+void SkeletonOverlay::MapWithMapper(_Out_ JointProjection& projection)
+{
+    if (nullptr == _coordinateMapper)
+    {
+        projection.Project(_bodyData);
+        return;
+    }
+
+    // one batched call for every joint of every body
+    for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+    {
+        _cameraPoints[i].X = _bodyData.PositionX[i];
+        _cameraPoints[i].Y = _bodyData.PositionY[i];
+        _cameraPoints[i].Z = _bodyData.PositionZ[i];
+    }
+
+    if (Body2DMode::DepthIR == _mode)
+    {
+        _coordinateMapper->MapCameraPointsToDepthSpace(_cameraPoints, _depthPoints);
+        for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+        {
+            _pixels[i] = XMFLOAT2(_depthPoints[i].X, _depthPoints[i].Y);
+        }
+    }
+    else
+    {
+        _coordinateMapper->MapCameraPointsToColorSpace(_cameraPoints, _colorPoints);
+        for (UINT i = 0; i < BODY_JOINT_COUNT; ++i)
+        {
+            _pixels[i] = XMFLOAT2(_colorPoints[i].X, _colorPoints[i].Y);
+        }
+    }
+
+    projection.SetPixels(_bodyData, _pixels.data());
+}
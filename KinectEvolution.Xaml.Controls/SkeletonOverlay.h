@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonOverlay.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+#include "JointProjection.h"
+
+#include <atomic>
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                // bones and joints of the tracked bodies drawn with Direct2D over a depth, IR or color image that
+                // fills the panel at its aspect ratio. the joints go through JointProjection with the camera taken
+                // from the coordinate mapper; the first tracked frame after each mapping change is also mapped by the
+                // mapper, and should the two differ by more than two pixels the mapper maps every frame.
+                class SkeletonOverlay
+                {
+                public:
+                    explicit SkeletonOverlay(Body2DMode mode);
+                    ~SkeletonOverlay();
+
+                    // which image the bodies are drawn over, the camera is fitted again on the next Update
+                    void SetMode(Body2DMode mode);
+                    Body2DMode GetMode() const { return _mode; }
+
+                    void SetBodySource(_In_opt_ WRK::BodyFrameSource^ source);
+                    WRK::BodyFrameSource^ GetBodySource() const { return _bodySource; }
+
+                    void SetCoordinateMapper(_In_opt_ WRK::CoordinateMapper^ mapper);
+                    WRK::CoordinateMapper^ GetCoordinateMapper() const { return _coordinateMapper; }
+
+                    // on the render thread, takes the latest body frame
+                    void Update();
+
+                    // the image is width x height DIPs of the panel, centered
+                    void Render(_In_ ID2D1DeviceContext* pContext, float width, float height);
+
+                    void CreateDeviceResources(_In_ ID2D1DeviceContext* pContext);
+                    void ResetDeviceResources();
+
+                    // pixels between the projection and the mapper at the last check, negative before one
+                    float GetProjectionError() const { return _projectionError; }
+
+                private:
+                    void FitCamera();
+                    void MapWithMapper(_Out_ JointProjection& projection);
+
+                private:
+                    Body2DMode                                          _mode;
+
+                    WRK::BodyFrameSource^                               _bodySource;
+                    WRK::BodyFrameReader^                               _bodyReader;
+                    Windows::Foundation::Collections::IVector<WRK::Body^>^ _bodies;
+                    BodyFrameData                                       _bodyData;
+
+                    WRK::CoordinateMapper^                              _coordinateMapper;
+                    Windows::Foundation::EventRegistrationToken         _mapperChangedToken;
+                    std::atomic<bool>                                   _mapperChanged;
+
+                    JointProjection                                     _projection;
+                    JointProjection                                     _mapped;
+                    BOOL                                                _checked;
+                    BOOL                                                _useMapper;
+                    float                                               _projectionError;
+
+                    Platform::Array<WRK::CameraSpacePoint>^             _cameraPoints;
+                    Platform::Array<WRK::ColorSpacePoint>^              _colorPoints;
+                    Platform::Array<WRK::DepthSpacePoint>^              _depthPoints;
+                    std::vector<XMFLOAT2>                               _pixels;
+
+                    std::vector<OverlayVertex>                          _lines;
+                    std::vector<OverlayVertex>                          _points;
+
+                    Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>        _trackedBrush;
+                    Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>        _inferredBrush;
+                };
+
+            }
+        }
+    }
+}
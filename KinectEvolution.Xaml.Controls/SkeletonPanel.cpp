@@ -19,6 +19,15 @@ using namespace Windows::UI::Xaml::Data;
 
 using namespace WindowsPreview::Kinect;
 
+// closest poses kept per body when matching
+static const UINT POSE_MATCH_COUNT = 4;
+
+// the last ten minutes of body frames are recorded, older blocks are dropped
+static const UINT RECORD_MAX_FRAMES = 30 * 60 * 10;
+
+// recognized gestures kept until taken, older ones are dropped
+static const size_t MAX_RECOGNIZED_GESTURES = 64;
+
 SkeletonPanel::SkeletonPanel()
     : Panel()
     , _loadingComplete(FALSE)
@@ -31,11 +40,24 @@ SkeletonPanel::SkeletonPanel()
     RenderBones = TRUE;
     RenderJoints = TRUE;
     RenderHandStates = TRUE;
+    SmoothJoints = FALSE;
+    PredictJoints = FALSE;
+    RecordBodies = FALSE;
+    _bodyStore.SetMaxFrames(RECORD_MAX_FRAMES);
+    IndexPoses = FALSE;
+    MatchPoses = FALSE;
+    RecognizeGestures = FALSE;
 }
 
 SkeletonPanel::~SkeletonPanel()
 {
     Stop();
+
+    // the shared meshes would otherwise keep the device alive
+    if (nullptr != _d3dDevice)
+    {
+        PrimitiveMesh::ReleaseDefaultPrimitives(_d3dDevice.Get());
+    }
 }
 
 void SkeletonPanel::StartRenderLoop()
@@ -80,405 +102,295 @@ BodyFrameSource^ SkeletonPanel::BodySource::get()
     return _bodySource;
 }
 
-
-void SkeletonPanel::Update(double elapsedTime)
+Audio::SpeakerAttributionSource^ SkeletonPanel::Speakers::get()
 {
-    BodyFrame^ frame = _bodyReader->AcquireLatestFrame();
-    if (nullptr != frame)
-    {
-        if (_bodies == nullptr)
-        {
-            _bodies = ref new Platform::Collections::Vector<Body^>(frame->BodyCount);
-        }
-
-        frame->GetAndRefreshBodyData(_bodies);
-
-        _floorPlane = frame->FloorClipPlane;
+    critical_section::scoped_lock lock(_criticalSection);
 
-    }
+    return _speakers;
 }
 
-void SkeletonPanel::Render()
+void SkeletonPanel::Speakers::set(_In_ Audio::SpeakerAttributionSource^ value)
 {
-    // create effect
-    PrimitiveParameter effectBone;
-    ZeroMemory(&effectBone, sizeof(effectBone));
-    effectBone._enableLighting = TRUE;
-    effectBone._specular = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
-    effectBone._power = 22.0f;
-
-    static const XMVECTOR BodyColor [] =
     {
-        { 1, 0, 0, 1 },
-        { 0, 1, 0, 1 },
-        { 0.25f, 1, 1, 1 },
-        { 1, 1, 0.25f, 1 },
-        { 1.0, 0.25f, 1, 1 },
-        { 0.5f, 0.5f, 1, 1 }
-    };
-
-    // Set render targets to the screen.
-    BeginRender(nullptr, nullptr, nullptr);
-
-    // set the blend state
-    _d3dContext->OMSetBlendState(_blendState.Get(), nullptr, 0xFFFFFF);
+        critical_section::scoped_lock lock(_criticalSection);
 
-    // bind viewport the size of the control
-    const D3D11_VIEWPORT backBufferView = CD3D11_VIEWPORT(0.0f, 0.0f, _renderTargetWidth, _renderTargetHeight);
-    _d3dContext->RSSetViewports(1, &backBufferView);
-
-    for (int i = 0; i < BODY_COUNT; ++i)
-    {
-        if (RenderBones)
+        if (_speakers == value)
         {
-            effectBone._ambient = BodyColor[i];
-            RenderBodyBones(i, &effectBone);
+            return;
         }
 
-        if (RenderJoints)
-        {
-            effectBone._ambient = XMVectorSet(0.3f, 0.3f, 0.3f, 1.0f);
-            effectBone._diffuse = XMVectorSet(0.8f, 0.8f, 0.8f, 1.0f);
-            RenderBodyJoints(i, &effectBone);
-        }
+        _speakers = value;
+    }
 
-        if (RenderJointOrientations)
-        {
-            effectBone._ambient = XMVectorSet(0.3f, 0.3f, 0.3f, 1.0f);
-            effectBone._diffuse = XMVectorSet(0.8f, 0.8f, 0.8f, 1.0f);
+    NotifyPropertyChanged("Speakers");
+}
 
-            RenderBodyJointOrientations(i, &effectBone);
-        }
+void SkeletonPanel::BroadcastBodies::set(bool value)
+{
+    critical_section::scoped_lock lock(_criticalSection);
+
+    if (value == BroadcastBodies)
+    {
+        return;
     }
 
-    for (int i = 0; i < BODY_COUNT; ++i)
+    if (value)
     {
-        if (RenderHandStates)
-        {
-            RenderBodyHandStates(i);
-        }
+        _broadcaster.Start(SkeletonBroadcasterParameters());
+    }
+    else
+    {
+        _broadcaster.Stop();
     }
 
-    EndRender();
+    NotifyPropertyChanged("BroadcastBodies");
 }
 
-void SkeletonPanel::ResetDeviceResources()
+unsigned int SkeletonPanel::AddGestureTemplate(unsigned int firstFrame, unsigned int frameCount, unsigned int bodyIndex)
 {
-    _loadingComplete = false;
+    critical_section::scoped_lock lock(_criticalSection);
 
-    Panel::ResetDeviceResources();
-}
+    if (0 == frameCount || bodyIndex >= BODY_COUNT ||
+        firstFrame < _bodyStore.GetFirstFrame() || firstFrame > _bodyStore.GetFrameCount() || frameCount > _bodyStore.GetFrameCount() - firstFrame)
+    {
+        throw ref new Platform::InvalidArgumentException();
+    }
 
-void SkeletonPanel::CreateDeviceResources()
-{
-    Panel::CreateDeviceResources();
+    std::vector<BodyFrameData> frames(frameCount);
+    _bodyStore.GetFrames(firstFrame, frameCount, frames.data());
 
-    // create blend state
-    D3D11_BLEND_DESC blendStateDesc;
-    ZeroMemory(&blendStateDesc, sizeof(D3D11_BLEND_DESC));
-    blendStateDesc.AlphaToCoverageEnable = FALSE;
-    blendStateDesc.IndependentBlendEnable = FALSE;
-    blendStateDesc.RenderTarget[0].BlendEnable = TRUE;
-    blendStateDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-    blendStateDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-    blendStateDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-    blendStateDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_SRC_ALPHA;
-    blendStateDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_DEST_ALPHA;
-    blendStateDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-    blendStateDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+    return _gestureRecognizer.AddTemplate(frames.data(), frameCount, bodyIndex, GestureTemplateParameters());
+}
 
-    DX::ThrowIfFailed(
-        _d3dDevice->CreateBlendState(&blendStateDesc, &_blendState)
-        );
+void SkeletonPanel::ClearGestureTemplates()
+{
+    critical_section::scoped_lock lock(_criticalSection);
 
-    // create effects
-    _bodyMeshEffect = ref new PrimitiveEffect();
-    _bodyMeshEffect->Initialize(_d3dDevice.Get());
+    _gestureRecognizer.ClearTemplates();
+    _recognizedGestures.clear();
 }
 
-void SkeletonPanel::CreateSizeDependentResources()
+IVectorView<GestureResult^>^ SkeletonPanel::TakeRecognizedGestures()
 {
-    Panel::CreateSizeDependentResources();
-
-    _viewMatrix = XMMatrixIdentity();
+    critical_section::scoped_lock lock(_criticalSection);
 
-    _projectionMatrix = XMMatrixPerspectiveFovLH(DirectX::XM_PI * 60.0f / 180.0f, _renderTargetWidth / _renderTargetHeight, 0.01f, 100.0f);
+    Platform::Collections::Vector<GestureResult^>^ results = ref new Platform::Collections::Vector<GestureResult^>();
+    for (const GestureMatch& match : _recognizedGestures)
+    {
+        results->Append(ref new GestureResult(match));
+    }
 
-    _loadingComplete = true;
+    _recognizedGestures.clear();
 
-    Render();
+    return results->GetView();
 }
 
-void SkeletonPanel::DoRenderBones(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect, float pBoneSizeMeters)
+IVectorView<PoseMatchResult^>^ SkeletonPanel::GetPoseMatches(unsigned int bodyIndex)
 {
-    if (nullptr == _bodies)
-    {
-        return;
-    }
-
-    Body^ body = _bodies->GetAt(bodyIndex);
-    if (nullptr == body || !body->IsTracked)
+    if (bodyIndex >= BODY_COUNT)
     {
-        return;
+        throw ref new Platform::InvalidArgumentException();
     }
 
-    if (!_bodyMeshEffect->Apply(_d3dContext.Get(), pEffect))
-    {
-        return;
-    };
+    std::vector<PoseMatch> matches;
+    _poseIndexThread.GetMatches(bodyIndex, matches);
 
-    PrimitiveMesh^ mesh = PrimitiveMesh::GetDefaultPrimitive(_d3dDevice.Get(), _d3dContext.Get(), DefaultPrimitive::Cylinder);
-    if (nullptr == mesh)
+    Platform::Collections::Vector<PoseMatchResult^>^ results = ref new Platform::Collections::Vector<PoseMatchResult^>();
+    for (const PoseMatch& match : matches)
     {
-        return;
+        results->Append(ref new PoseMatchResult(match));
     }
 
-    for (UINT i = 0; i < _countof(BodyBones); i++)
-    {
-        Joint jointA = body->Joints->Lookup(BodyBones[i].JointA);
-        Joint jointB = body->Joints->Lookup(BodyBones[i].JointB);
+    return results->GetView();
+}
+
+bool SkeletonPanel::BroadcastBodies::get()
+{
+    return 0 != _broadcaster.IsRunning();
+}
 
-        XMVECTOR positionA = XMLoadFloat3(&XMFLOAT3(jointA.Position.X, jointA.Position.Y, jointA.Position.Z));
-        XMVECTOR positionB = XMLoadFloat3(&XMFLOAT3(jointB.Position.X, jointB.Position.Y, jointB.Position.Z));
-        if (XMVector3Equal(positionA, XMVectorZero()) || XMVector3Equal(positionB, XMVectorZero()))
-        {
-            continue;
-        }
-        float boneScale = pBoneSizeMeters / 2; // cylinder has a radius of 1.0f so div 2 to scale correctly
 
-        if (jointA.TrackingState != TrackingState::Tracked || jointB.TrackingState != TrackingState::Tracked)
+void SkeletonPanel::Update(double elapsedTime)
+{
+    BodyFrame^ frame = _bodyReader->AcquireLatestFrame();
+    if (nullptr != frame)
+    {
+        if (_bodies == nullptr)
         {
-            boneScale *= NonTrackedScale;
+            _bodies = ref new Platform::Collections::Vector<Body^>(frame->BodyCount);
         }
 
-        XMMATRIX m = XMMatrixScaling(boneScale, 1.0f, boneScale) * PrimitiveEffect::TransformUnitUpVector(positionA, positionB, FALSE);
+        frame->GetAndRefreshBodyData(_bodies);
 
-        ApplyTransformWithWorldMatrix(m);
+        _floorPlane = frame->FloorClipPlane;
 
-        mesh->RenderTriangleList(_d3dContext.Get(), TRUE);
-    }
-}
+        _bodyData.Load(_bodies, frame->RelativeTime, _floorPlane);
 
-void SkeletonPanel::DoRenderJoints(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect, float pJointSizeMeters)
-{
-    if (nullptr == _bodies)
-    {
-        return;
-    }
+        // bodies keep their slot, and so their color and filter state, through short occlusions
+        _bodyTracker.Update(_bodyData);
+        _jointFilter.Update(_bodyTracker.GetTracked());
 
-    Body^ body = _bodies->GetAt(bodyIndex);
-    if (nullptr == body || !body->IsTracked)
-    {
-        return;
-    }
+        if (RecognizeGestures && _gestureRecognizer.GetTemplateCount() > 0)
+        {
+            _gestureRecognizer.Update(_bodyTracker.GetTracked());
 
-    if (!_bodyMeshEffect->Apply(_d3dContext.Get(), pEffect))
-    {
-        return;
-    };
+            const std::vector<GestureMatch>& matches = _gestureRecognizer.GetMatches();
+            _recognizedGestures.insert(_recognizedGestures.end(), matches.begin(), matches.end());
+            while (_recognizedGestures.size() > MAX_RECOGNIZED_GESTURES)
+            {
+                _recognizedGestures.pop_front();
+            }
+        }
 
-    for (auto pair : body->Joints)
-    {
-        Joint joint = pair->Value;
-        JointOrientation rotation = body->JointOrientations->Lookup(pair->Key);
+        // the render timer is the local clock the predictor matches to the sensor time
+        _bodyPredictor.AddFrame(GetSourceData(), static_cast<INT64>(_timer.GetTotalTicks()));
 
-        PrimitiveMesh^ mesh = nullptr;
-        float jointSize = pJointSizeMeters;
-        switch (pair->Key)
+        // inserts into a large index take longer than a frame, the thread does them and the searches
+        if ((MatchPoses || IndexPoses) && !_poseIndexThread.IsRunning())
         {
-        case JointType::SpineBase:
-        case JointType::SpineMid:
-        case JointType::SpineShoulder:
-        case JointType::Neck:
-        case JointType::Head:
-            mesh = PrimitiveMesh::GetDefaultPrimitive(_d3dDevice.Get(), _d3dContext.Get(), DefaultPrimitive::Pyramid);
-            jointSize *= 1.15f; // make pyramid joints a little bigger
-            break;
-        case JointType::ShoulderLeft:
-        case JointType::ElbowLeft:
-        case JointType::WristLeft:
-        case JointType::HandLeft:
-        case JointType::HandTipLeft:
-        case JointType::ThumbLeft:
-        case JointType::HipLeft:
-        case JointType::KneeLeft:
-        case JointType::AnkleLeft:
-        case JointType::FootLeft:
-            mesh = PrimitiveMesh::GetDefaultPrimitive(_d3dDevice.Get(), _d3dContext.Get(), DefaultPrimitive::Sphere);
-            break;
-        case JointType::ShoulderRight:
-        case JointType::ElbowRight:
-        case JointType::WristRight:
-        case JointType::HandRight:
-        case JointType::HandTipRight:
-        case JointType::ThumbRight:
-        case JointType::HipRight:
-        case JointType::KneeRight:
-        case JointType::AnkleRight:
-        case JointType::FootRight:
-            mesh = PrimitiveMesh::GetDefaultPrimitive(_d3dDevice.Get(), _d3dContext.Get(), DefaultPrimitive::Cube);
-            jointSize *= 0.85f; // make cube joints a little smaller
-            break;
+            _poseIndexThread.Start(PoseIndexParameters(), POSE_MATCH_COUNT);
         }
 
-        if (nullptr == mesh)
+        if (MatchPoses)
         {
-            return;
+            _poseIndexThread.Search(_bodyTracker.GetTracked());
         }
 
-        XMVECTOR position = XMLoadFloat3(&XMFLOAT3(joint.Position.X, joint.Position.Y, joint.Position.Z));
-        XMVECTOR orientation = XMLoadFloat4(&XMFLOAT4(rotation.Orientation.X, rotation.Orientation.Y, rotation.Orientation.Z, rotation.Orientation.W));
-
-        if (XMVector3Equal(position, DirectX::XMVectorZero()))
-            continue;
+        if (RecordBodies && _bodyStore.Append(_bodyData) && IndexPoses)
+        {
+            _poseIndexThread.Index(_bodyData, _bodyStore.GetFrameCount() - 1);
+        }
 
+        _broadcaster.Publish(_bodyTracker.GetTracked());
 
-        // render inferred and not tracked joints smaller
-        switch (joint.TrackingState)
+        // stamped on arrival like the audio blocks, the sensor's relative time is not on the audio clock
+        if (nullptr != _speakers)
         {
-        case TrackingState::Inferred:
-            jointSize *= NonTrackedScale;
-            break;
-        case TrackingState::NotTracked:
-            jointSize *= NonTrackedScale;
-            break;
-        }
+            Audio::SpeakerAttribution& speakers = _speakers->GetAttribution();
+            INT64 now = Audio::SpeakerAttribution::GetTime();
 
-        ApplyTransformWithWorldMatrix(XMMatrixScaling(jointSize, jointSize, jointSize) * XMMatrixTranslationFromVector(position));
+            speakers.AddBodies(_bodyTracker.GetTracked(), now);
+            speakers.Update(now);
+        }
+    }
 
-        mesh->RenderTriangleList(_d3dContext.Get(), TRUE);
+    if (PredictJoints)
+    {
+        _bodyPredictor.Predict(static_cast<INT64>(_timer.GetTotalTicks()));
     }
 }
 
-void SkeletonPanel::RenderBodyHandStates(UINT bodyIndex)
+void SkeletonPanel::Render()
 {
-    if (nullptr == _bodies)
-    {
-        return;
-    }
+    // the light direction is left at zero as in the per primitive effect, so only ambient and specular show
+    static const float SpecularPower = 22.0f;
 
-    Body^ body = _bodies->GetAt(bodyIndex);
-    if (nullptr == body || !body->IsTracked)
-    {
-        return;
-    }
+    _instanceBuilder.Build(GetBodyData(), RenderBones, RenderJoints, RenderHandStates, RenderJointOrientations);
+    _instanceBuilder.SelectLods(GetViewMatrix(), GetProjectionMatrix(), _renderTargetHeight);
 
-    // note that hand state are not rendered in the body bracket because it needs to blend with depth
-    PrimitiveMesh^ pSphereMesh = PrimitiveMesh::GetDefaultPrimitive(_d3dDevice.Get(), _d3dContext.Get(), DefaultPrimitive::Sphere);
-    if (nullptr == pSphereMesh)
-    {
-        return;
-    }
+    // Set render targets to the screen.
+    BeginRender(nullptr, nullptr, nullptr);
 
-    PrimitiveParameter effect = { 0 };
-    effect._enableLighting = TRUE;
+    // set the blend state
+    _d3dContext->OMSetBlendState(_blendState.Get(), nullptr, 0xFFFFFF);
 
-    Joint hands [] =
-    {
-        body->Joints->Lookup(JointType::HandLeft),
-        body->Joints->Lookup(JointType::HandRight)
-    };
+    // bind viewport the size of the control
+    const D3D11_VIEWPORT backBufferView = CD3D11_VIEWPORT(0.0f, 0.0f, _renderTargetWidth, _renderTargetHeight);
+    _d3dContext->RSSetViewports(1, &backBufferView);
 
-    for (UINT i = 0; i < 2; i++)
+    // one draw per primitive type and level of detail, hand states last so they blend with the bodies
+    if (_instanceEffect->Apply(_d3dContext.Get(), GetViewMatrix(), GetProjectionMatrix(), XMVectorZero(), SpecularPower))
     {
-        if (hands[i].TrackingState != TrackingState::Tracked)
+        for (UINT i = 0; i < static_cast<UINT>(SkeletonBatch::Count); ++i)
         {
-            effect._ambient = NotTrackedColor;
-        }
-        else
-        {
-            UINT index = 0;
+            SkeletonBatch batch = static_cast<SkeletonBatch>(i);
 
-            if (hands[i].JointType == JointType::HandLeft)
-            {
-                index = static_cast<int>(body->HandLeftState);
-            }
-            else
+            for (UINT lod = 0; lod < PRIMITIVE_LOD_COUNT; ++lod)
             {
-                index = static_cast<int>(body->HandRightState);
+                UINT instanceCount = _instanceBuilder.GetInstanceCount(batch, lod);
+                if (0 == instanceCount)
+                {
+                    continue;
+                }
+
+                PrimitiveMesh^ mesh = GetPrimitive(SkeletonBatchPrimitive[i], lod);
+                if (nullptr == mesh)
+                {
+                    continue;
+                }
+
+                _instanceEffect->Render(_d3dContext.Get(), mesh, _instanceBuilder.GetInstances(batch, lod), instanceCount);
             }
-
-            effect._ambient = HandStateColorTable[min(index - 2, _countof(HandStateColorTable) - 1)];
-        }
-
-        if (!_bodyMeshEffect->Apply(_d3dContext.Get(), &effect))
-        {
-            return;
-        };
-
-        XMVECTOR handPosition = XMLoadFloat3(&XMFLOAT3(hands[i].Position.X, hands[i].Position.Y, hands[i].Position.Z));
-        if (XMVector3Equal(handPosition, XMVectorZero()))
-        {
-            continue; // don't render when hand position is not filled in
         }
+    }
 
-        XMMATRIX matWorld =
-            XMMatrixScaling(DefaultHandStateSize, DefaultHandStateSize, DefaultHandStateSize) *
-            XMMatrixTranslationFromVector(handPosition);
+    EndRender();
+}
 
-        ApplyTransformWithWorldMatrix(matWorld);
+PrimitiveMesh^ SkeletonPanel::GetPrimitive(DefaultPrimitive primitiveType, UINT lod)
+{
+    UINT index = static_cast<UINT>(primitiveType) * PRIMITIVE_LOD_COUNT + lod;
 
-        pSphereMesh->RenderTriangleList(_d3dContext.Get(), TRUE);
+    // meshes live as long as the device, created the first time they are drawn
+    if (nullptr == _primitives[index])
+    {
+        _primitives[index] = PrimitiveMesh::GetDefaultPrimitive(_d3dDevice.Get(), _d3dContext.Get(), primitiveType, lod);
     }
+
+    return _primitives[index];
 }
 
-void SkeletonPanel::RenderBodyJointOrientations(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect)
+void SkeletonPanel::ResetDeviceResources()
 {
-    if (nullptr == _bodies)
-    {
-        return;
-    }
+    _loadingComplete = false;
 
-    Body^ body = _bodies->GetAt(bodyIndex);
-    if (nullptr == body || !body->IsTracked)
+    _primitives = nullptr;
+    if (nullptr != _d3dDevice)
     {
-        return;
+        PrimitiveMesh::ReleaseDefaultPrimitives(_d3dDevice.Get());
     }
 
-    if (!_bodyMeshEffect->Apply(_d3dContext.Get(), pEffect))
-    {
-        return;
-    };
+    Panel::ResetDeviceResources();
+}
 
-    PrimitiveMesh^ pArrowMesh = PrimitiveMesh::GetDefaultPrimitive(_d3dDevice.Get(), _d3dContext.Get(), DefaultPrimitive::Cone);
-    PrimitiveMesh^ pHandleMesh = PrimitiveMesh::GetDefaultPrimitive(_d3dDevice.Get(), _d3dContext.Get(), DefaultPrimitive::Cylinder);
-    if (nullptr == pArrowMesh || nullptr == pHandleMesh)
-    {
-        return;
-    }
+void SkeletonPanel::CreateDeviceResources()
+{
+    Panel::CreateDeviceResources();
 
-    for (auto pair : body->Joints)
-    {
-        Joint joint = pair->Value;
-        JointOrientation rotation = body->JointOrientations->Lookup(pair->Key);
+    // create blend state
+    D3D11_BLEND_DESC blendStateDesc;
+    ZeroMemory(&blendStateDesc, sizeof(D3D11_BLEND_DESC));
+    blendStateDesc.AlphaToCoverageEnable = FALSE;
+    blendStateDesc.IndependentBlendEnable = FALSE;
+    blendStateDesc.RenderTarget[0].BlendEnable = TRUE;
+    blendStateDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+    blendStateDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+    blendStateDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+    blendStateDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_SRC_ALPHA;
+    blendStateDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_DEST_ALPHA;
+    blendStateDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+    blendStateDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
 
-        XMVECTOR position = XMLoadFloat3(&XMFLOAT3(joint.Position.X, joint.Position.Y, joint.Position.Z));
-        XMVECTOR orientation = XMLoadFloat4(&XMFLOAT4(rotation.Orientation.X, rotation.Orientation.Y, rotation.Orientation.Z, rotation.Orientation.W));
-        if (XMVector3Equal(position, XMVectorZero()) || XMVector4Equal(orientation, XMVectorZero()))
-        {
-            continue;
-        }
+    DX::ThrowIfFailed(
+        _d3dDevice->CreateBlendState(&blendStateDesc, &_blendState)
+        );
 
-        XMVECTOR normal = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), orientation);
-        if (XMVector3Equal(normal, XMVectorZero()))
-        {
-            continue;
-        }
+    // create effects
+    _instanceEffect = ref new PrimitiveInstanceEffect();
+    _instanceEffect->Initialize(_d3dDevice.Get(), MAX_INSTANCES);
 
-        float handleLength = DefaultNormalHandleLength;
-        float handleSize = DefaultNormalHandleSize;
-        float arrowLength = DefaultNormalArrowLength;
+    _primitives = ref new Platform::Array<PrimitiveMesh^>(static_cast<UINT>(DefaultPrimitive::Count) * PRIMITIVE_LOD_COUNT);
+}
 
-        XMVECTOR handleEnd = position + handleLength * normal;
-        XMVECTOR arrowEnd = handleEnd + arrowLength * normal;
+void SkeletonPanel::CreateSizeDependentResources()
+{
+    Panel::CreateSizeDependentResources();
 
-        XMMATRIX matHandle = XMMatrixScaling(handleSize, 1.0f, handleSize) * PrimitiveEffect::TransformUnitUpVector(position, handleEnd, FALSE);
-        XMMATRIX matArrow = XMMatrixScaling(arrowLength, arrowLength, arrowLength) * PrimitiveEffect::TransformUnitUpVector(handleEnd, arrowEnd, TRUE);
+    _viewMatrix = XMMatrixIdentity();
 
-        ApplyTransformWithWorldMatrix(matHandle);
-        pHandleMesh->RenderTriangleList(_d3dContext.Get(), TRUE);
+    _projectionMatrix = XMMatrixPerspectiveFovLH(DirectX::XM_PI * 60.0f / 180.0f, _renderTargetWidth / _renderTargetHeight, 0.01f, 100.0f);
 
-        ApplyTransformWithWorldMatrix(matArrow);
-        pArrowMesh->RenderTriangleList(_d3dContext.Get(), TRUE);
-    }
+    _loadingComplete = true;
+
+    Render();
 }
@@ -8,7 +8,20 @@
 
 #include "Panel.h"
 #include "PrimitiveMesh.h"
-#include "PrimitiveEffect.h"
+#include "PrimitiveInstanceEffect.h"
+#include "BodyFrameData.h"
+#include "JointFilter.h"
+#include "BodyFrameStore.h"
+#include "BodyTracker.h"
+#include "BodyPredictor.h"
+#include "SkeletonBroadcaster.h"
+#include "JointProjection.h"
+#include "PoseIndexThread.h"
+#include "GestureRecognizer.h"
+#include "SkeletonInstanceBuilder.h"
+#include "SpeakerAttributionSource.h"
+
+#include <deque>
 
 namespace KinectEvolution {
     namespace Xaml {
@@ -18,69 +31,49 @@ namespace KinectEvolution {
                 using namespace KinectEvolution::Xaml::Controls::Base;
                 using namespace WindowsPreview::Kinect;
 
-                enum class Body2DMode
-                {
-                    DepthIR,
-                    Color,
-                };
+                // instance buffer size, larger batches are drawn in chunks
+                static const UINT MAX_INSTANCES = BODY_COUNT * JOINT_COUNT * 2;
 
-                struct Bone
+                // a template gesture performed by a tracked body
+                [Windows::Foundation::Metadata::WebHostHidden]
+                public ref class GestureResult sealed
                 {
-                    JointType JointA;
-                    JointType JointB;
-                };
+                public:
+                    // as returned by SkeletonPanel::AddGestureTemplate
+                    property unsigned int TemplateIndex { unsigned int get() { return _match.TemplateIndex; } }
+                    property unsigned int BodyIndex { unsigned int get() { return _match.BodyIndex; } }
+                    property unsigned long long TrackingId { unsigned long long get() { return _match.TrackingId; } }
 
-                static const struct Bone BodyBones [] =
-                {
-                    { JointType::SpineBase, JointType::SpineMid },
-                    { JointType::SpineMid, JointType::SpineShoulder },
-                    { JointType::SpineShoulder, JointType::Neck },
-                    { JointType::Neck, JointType::Head },
-                    { JointType::SpineShoulder, JointType::ShoulderLeft },
-                    { JointType::ShoulderLeft, JointType::ElbowLeft },
-                    { JointType::ElbowLeft, JointType::WristLeft },
-                    { JointType::WristLeft, JointType::HandLeft },
-                    { JointType::HandLeft, JointType::HandTipLeft },
-                    { JointType::WristLeft, JointType::ThumbLeft },
-                    { JointType::SpineShoulder, JointType::ShoulderRight },
-                    { JointType::ShoulderRight, JointType::ElbowRight },
-                    { JointType::ElbowRight, JointType::WristRight },
-                    { JointType::WristRight, JointType::HandRight },
-                    { JointType::HandRight, JointType::HandTipRight },
-                    { JointType::WristRight, JointType::ThumbRight },
-                    { JointType::SpineBase, JointType::HipLeft },
-                    { JointType::HipLeft, JointType::KneeLeft },
-                    { JointType::KneeLeft, JointType::AnkleLeft },
-                    { JointType::AnkleLeft, JointType::FootLeft },
-                    { JointType::SpineBase, JointType::HipRight },
-                    { JointType::HipRight, JointType::KneeRight },
-                    { JointType::KneeRight, JointType::AnkleRight },
-                    { JointType::AnkleRight, JointType::FootRight },
-                };
+                    // mean squared bone direction distance to the template, lower is closer
+                    property float Cost { float get() { return _match.Cost; } }
 
-                // following the hand state color table in NuiView
-                static const DirectX::XMVECTOR HandStateColorTable [] =
-                {
-                    { 0.0f, 1.0f, 0.0f, 0.7f }, // open
-                    { 1.0f, 0.0f, 0.0f, 0.7f }, // closed
-                    { 0.0f, 0.0f, 1.0f, 0.7f }, // lasso
-                    { 0.5f, 0.5f, 0.5f, 0.5f }, // unknown
+                internal:
+                    GestureResult(_In_ const GestureMatch& match) : _match(match) {}
+
+                private:
+                    GestureMatch _match;
                 };
 
-                static const int BODY_COUNT = 6;
-                static const int JOINT_COUNT = 25;
+                // a stored pose close to a tracked body's
+                [Windows::Foundation::Metadata::WebHostHidden]
+                public ref class PoseMatchResult sealed
+                {
+                public:
+                    property unsigned int PoseId { unsigned int get() { return _match.PoseId; } }
 
-                static const XMVECTOR NotTrackedColor = { 0.0f, 0.0f, 0.0f, 0.3f };
+                    // of the body store, may be older than its first kept frame
+                    property unsigned int FrameIndex { unsigned int get() { return _match.FrameIndex; } }
+                    property unsigned int BodyIndex { unsigned int get() { return _match.BodyIndex; } }
 
-                static const float DefaultJointSize = 0.05f; // diameter in world space (meters)
-                static const float DefaultBoneSize = 0.03f; // diameter in world space
-                static const float NonTrackedScale = 0.3f; // render non-tracked joints different than tracked ones
+                    // summed squared bone direction difference, lower is closer
+                    property float Distance { float get() { return _match.Distance; } }
 
-                static const float DefaultNormalHandleSize = 0.01f; // diameter of the handle
-                static const float DefaultNormalHandleLength = 0.05f; // length of the handle
-                static const float DefaultNormalArrowLength = 0.05f;
+                internal:
+                    PoseMatchResult(_In_ const PoseMatch& match) : _match(match) {}
 
-                static const float DefaultHandStateSize = 4 * DefaultJointSize;
+                private:
+                    PoseMatch _match;
+                };
 
                 [Windows::Foundation::Metadata::WebHostHidden]
                 public ref class SkeletonPanel sealed
@@ -100,6 +93,55 @@ namespace KinectEvolution {
                     property bool RenderHandStates;
                     property bool RenderJointOrientations;
 
+                    // render the filtered joints instead of the raw sensor data; off by default
+                    property bool SmoothJoints;
+
+                    // move the joints on to the time the frame is shown, between the 30 Hz body frames; off by default
+                    property bool PredictJoints;
+
+                    // keep the raw body frames of the last ten minutes in the compressed store
+                    property bool RecordBodies;
+
+                    // add the poses of the recorded bodies to the pose index
+                    property bool IndexPoses;
+
+                    // look up the closest indexed poses of the tracked bodies on every frame
+                    property bool MatchPoses;
+
+                    // the closest poses to the body in the slot, nearest first, as of a frame or so ago; the index is
+                    // searched and grows on a thread of its own
+                    Windows::Foundation::Collections::IVectorView<PoseMatchResult^>^ GetPoseMatches(unsigned int bodyIndex);
+
+                    // gets the tracked bodies of every frame and works out which one is speaking from the beam of an
+                    // audio panel given the same one; null for none
+                    property Audio::SpeakerAttributionSource^ Speakers
+                    {
+                        Audio::SpeakerAttributionSource^ get();
+                        void set(_In_ Audio::SpeakerAttributionSource^ value);
+                    }
+
+                    // compare the tracked bodies against the gesture templates on every frame
+                    property bool RecognizeGestures;
+
+                    // template from recorded frames [firstFrame, firstFrame + frameCount) of the body in the slot,
+                    // returns its index; throws InvalidArgumentException unless the frames are still kept
+                    unsigned int AddGestureTemplate(unsigned int firstFrame, unsigned int frameCount, unsigned int bodyIndex);
+                    void ClearGestureTemplates();
+
+                    // the gestures recognized since the last call, oldest first; the most recent are kept between calls
+                    Windows::Foundation::Collections::IVectorView<GestureResult^>^ TakeRecognizedGestures();
+
+                    // send the tracked bodies to local TCP and UDP subscribers
+                    property bool BroadcastBodies
+                    {
+                        bool get();
+                        void set(bool value);
+                    }
+
+                internal:
+                    // only read with the render loop stopped, Update appends from the render thread
+                    const BodyFrameStore& GetBodyStore() { return _bodyStore; }
+
                 protected private:
                     virtual event Windows::UI::Xaml::Data::PropertyChangedEventHandler^ PropertyChanged;
                     void NotifyPropertyChanged(Platform::String^ prop);
@@ -120,33 +162,17 @@ namespace KinectEvolution {
                 private:
                     ~SkeletonPanel();
 
-                    void DoRenderJoints(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect, float pJointSizeMeters);
-
-                    void DoRenderBones(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect, float pBoneSizeMeters);
-
-                    void RenderBodyHandStates(UINT bodyIndex);
-
-                    void RenderBodyJointOrientations(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect);
-
-                    void RenderBodyJoints(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect)
+                    const BodyFrameData& GetSourceData()
                     {
-                        DoRenderJoints(bodyIndex, pEffect, DefaultJointSize);
+                        return SmoothJoints ? _jointFilter.GetFiltered() : _bodyTracker.GetTracked();
                     }
 
-                    void RenderBodyJoints(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect, float pJointSizeMeters)
+                    const BodyFrameData& GetBodyData()
                     {
-                        DoRenderJoints(bodyIndex, pEffect, pJointSizeMeters);
+                        return PredictJoints ? _bodyPredictor.GetPredicted() : GetSourceData();
                     }
 
-                    void RenderBodyBones(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect)
-                    {
-                        DoRenderBones(bodyIndex, pEffect, DefaultBoneSize);
-                    }
-
-                    void RenderBodyBones(UINT bodyIndex, _In_opt_ const PrimitiveParameter* pEffect, float pBoneSizeMeters)
-                    {
-                        DoRenderBones(bodyIndex, pEffect, pBoneSizeMeters);
-                    }
+                    PrimitiveMesh^ GetPrimitive(DefaultPrimitive primitiveType, UINT lod);
 
                     XMMATRIX GetViewMatrix()
                     {
@@ -158,34 +184,36 @@ namespace KinectEvolution {
                         return _projectionMatrix;
                     }
 
-                    void ApplyTransformWithWorldViewMatrix(_In_ const DirectX::XMMATRIX& worldViewMatrix)
-                    {
-                        DirectX::XMMATRIX wvp = worldViewMatrix * GetProjectionMatrix();
-                        _bodyMeshEffect->ApplyTransformAll(_d3dContext.Get(), worldViewMatrix, wvp);
-                    }
-
-                    void ApplyTransformWithWorldMatrix(_In_ const DirectX::XMMATRIX& worldMatrix)
-                    {
-                        DirectX::XMMATRIX wv = worldMatrix * GetViewMatrix();
-                        ApplyTransformWithWorldViewMatrix(wv);
-                    }
-
                 private:
                     BOOL                                        _loadingComplete;
 
                     Microsoft::WRL::ComPtr<ID3D11BlendState>    _blendState;
 
-                    PrimitiveEffect^                            _bodyMeshEffect;
+                    PrimitiveInstanceEffect^                    _instanceEffect;
+                    Platform::Array<PrimitiveMesh^>^            _primitives;   // every level of every default primitive
 
                     DirectX::XMMATRIX                           _viewMatrix;
                     DirectX::XMMATRIX                           _projectionMatrix;
 
                     WRK::BodyFrameSource^                       _bodySource;
                     WRK::BodyFrameReader^                       _bodyReader;
+                    Audio::SpeakerAttributionSource^            _speakers;
 
                     Windows::Foundation::Collections::IVector<Body^>^   _bodies;
                     WRK::Vector4                                        _floorPlane;
 
+                    BodyFrameData                               _bodyData;
+                    BodyTracker                                 _bodyTracker;
+                    JointFilter                                 _jointFilter;
+                    BodyPredictor                               _bodyPredictor;
+                    BodyFrameStore                              _bodyStore;
+                    PoseIndexThread                             _poseIndexThread;
+                    GestureRecognizer                           _gestureRecognizer;
+                    std::deque<GestureMatch>                    _recognizedGestures;
+                    SkeletonBroadcaster                         _broadcaster;
+
+                    SkeletonInstanceBuilder                     _instanceBuilder;
+
                 };
 
             }
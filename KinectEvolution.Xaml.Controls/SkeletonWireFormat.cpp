@@ -0,0 +1,560 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonWireFormat.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SkeletonWireFormat.h"
+
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+
+using namespace WindowsPreview::Kinect;
+
+// quantization steps
+static const float POSITION_SCALE = 4096.0f;                // +-8 m
+static const float ROTATION_SCALE = 32767.0f * 1.41421356f; // smallest three components are within +-1/sqrt(2)
+static const float PLANE_NORMAL_SCALE = 32767.0f;
+
+static const UINT HEADER_SIZE = 32;
+static const UINT JOINT_VALUES = JOINT_COUNT * 3;
+
+inline INT16 Quantize(float value, float scale)
+{
+    float q = value * scale;
+    q = min(max(q, -32767.0f), 32767.0f);
+    return static_cast<INT16>((q < 0.0f) ? q - 0.5f : q + 0.5f);
+}
+
+// bounds checked little endian writer, the platform is little endian
+struct WireWriter
+{
+    BYTE*   Buffer;
+    UINT    Size;
+    UINT    Capacity;
+
+    bool Write(_In_reads_bytes_(size) const void* pSource, UINT size)
+    {
+        if (Size + size > Capacity)
+        {
+            Size = Capacity + 1;
+            return false;
+        }
+
+        CopyMemory(Buffer + Size, pSource, size);
+        Size += size;
+        return true;
+    }
+
+    void WriteByte(BYTE value) { Write(&value, 1); }
+
+    void WriteVarint(UINT value)
+    {
+        BYTE bytes[5];
+        UINT count = 0;
+        while (value >= 0x80)
+        {
+            bytes[count++] = static_cast<BYTE>(value | 0x80);
+            value >>= 7;
+        }
+        bytes[count++] = static_cast<BYTE>(value);
+        Write(bytes, count);
+    }
+
+    void WriteSigned(INT32 value)
+    {
+        WriteVarint(static_cast<UINT>((value << 1) ^ (value >> 31)));
+    }
+
+    bool Overflowed() const { return Size > Capacity; }
+};
+
+struct WireReader
+{
+    const BYTE* Buffer;
+    UINT        Size;
+    UINT        Offset;
+    bool        Failed;
+
+    void Read(_Out_writes_bytes_(size) void* pDestination, UINT size)
+    {
+        if (Failed || Offset + size > Size)
+        {
+            Failed = true;
+            ZeroMemory(pDestination, size);
+            return;
+        }
+
+        CopyMemory(pDestination, Buffer + Offset, size);
+        Offset += size;
+    }
+
+    BYTE ReadByte()
+    {
+        BYTE value;
+        Read(&value, 1);
+        return value;
+    }
+
+    UINT ReadVarint()
+    {
+        UINT value = 0;
+        for (UINT shift = 0; shift < 35; shift += 7)
+        {
+            BYTE b = ReadByte();
+            value |= static_cast<UINT>(b & 0x7F) << shift;
+            if (0 == (b & 0x80))
+            {
+                return value;
+            }
+        }
+
+        Failed = true;
+        return 0;
+    }
+
+    INT32 ReadSigned()
+    {
+        UINT value = ReadVarint();
+        return static_cast<INT32>(value >> 1) ^ -static_cast<INT32>(value & 1);
+    }
+};
+
+void KinectEvolution::Xaml::Controls::Skeleton::QuantizeSkeletonFrame(_In_ const BodyFrameData& frame, UINT sequence, _Out_ SkeletonWireFrame* pFrame)
+{
+    ZeroMemory(pFrame, sizeof(*pFrame));
+
+    pFrame->Sequence = sequence;
+    pFrame->RelativeTime = frame.RelativeTime;
+    pFrame->FloorClipPlane[0] = Quantize(frame.FloorClipPlane.x, PLANE_NORMAL_SCALE);
+    pFrame->FloorClipPlane[1] = Quantize(frame.FloorClipPlane.y, PLANE_NORMAL_SCALE);
+    pFrame->FloorClipPlane[2] = Quantize(frame.FloorClipPlane.z, PLANE_NORMAL_SCALE);
+    pFrame->FloorClipPlane[3] = Quantize(frame.FloorClipPlane.w, POSITION_SCALE);
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        if (!frame.IsTracked[bodyIndex])
+        {
+            continue;
+        }
+
+        SkeletonWireBody& body = pFrame->Bodies[bodyIndex];
+        body.IsTracked = TRUE;
+        body.TrackingId = frame.TrackingId[bodyIndex];
+        body.HandLeftState = static_cast<BYTE>(frame.HandLeftState[bodyIndex]) & 0xF;
+        body.HandRightState = static_cast<BYTE>(frame.HandRightState[bodyIndex]) & 0xF;
+
+        for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+        {
+            UINT i = BodyJointIndex(bodyIndex, jointIndex);
+            BYTE flags = static_cast<BYTE>(frame.TrackingState[i]) & SKELETON_JOINT_STATE_MASK;
+
+            body.Position[jointIndex * 3 + 0] = Quantize(frame.PositionX[i], POSITION_SCALE);
+            body.Position[jointIndex * 3 + 1] = Quantize(frame.PositionY[i], POSITION_SCALE);
+            body.Position[jointIndex * 3 + 2] = Quantize(frame.PositionZ[i], POSITION_SCALE);
+
+            float q[4] = { frame.OrientationX[i], frame.OrientationY[i], frame.OrientationZ[i], frame.OrientationW[i] };
+            float lengthSq = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+            if (lengthSq <= 0.0f)
+            {
+                body.JointFlags[jointIndex] = flags | SKELETON_JOINT_ZERO_ROTATION;
+                continue;
+            }
+
+            // the largest component is implied by the others, its sign made positive
+            UINT largest = 0;
+            for (UINT c = 1; c < 4; ++c)
+            {
+                if (fabsf(q[c]) > fabsf(q[largest]))
+                {
+                    largest = c;
+                }
+            }
+
+            float scale = ((q[largest] < 0.0f) ? -1.0f : 1.0f) / sqrtf(lengthSq);
+            for (UINT c = 0, k = 0; c < 4; ++c)
+            {
+                if (c != largest)
+                {
+                    body.Rotation[jointIndex * 3 + k++] = Quantize(q[c] * scale, ROTATION_SCALE);
+                }
+            }
+
+            body.JointFlags[jointIndex] = flags | static_cast<BYTE>(largest << SKELETON_JOINT_LARGEST_SHIFT);
+        }
+    }
+}
+
+void KinectEvolution::Xaml::Controls::Skeleton::DequantizeSkeletonFrame(_In_ const SkeletonWireFrame& frame, _Out_ BodyFrameData* pFrame)
+{
+    pFrame->Clear();
+
+    pFrame->RelativeTime = frame.RelativeTime;
+    pFrame->FloorClipPlane = XMFLOAT4(
+        frame.FloorClipPlane[0] / PLANE_NORMAL_SCALE,
+        frame.FloorClipPlane[1] / PLANE_NORMAL_SCALE,
+        frame.FloorClipPlane[2] / PLANE_NORMAL_SCALE,
+        frame.FloorClipPlane[3] / POSITION_SCALE);
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        const SkeletonWireBody& body = frame.Bodies[bodyIndex];
+        if (!body.IsTracked)
+        {
+            continue;
+        }
+
+        pFrame->IsTracked[bodyIndex] = TRUE;
+        pFrame->TrackingId[bodyIndex] = body.TrackingId;
+        pFrame->HandLeftState[bodyIndex] = static_cast<HandState>(body.HandLeftState);
+        pFrame->HandRightState[bodyIndex] = static_cast<HandState>(body.HandRightState);
+
+        for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+        {
+            UINT i = BodyJointIndex(bodyIndex, jointIndex);
+            BYTE flags = body.JointFlags[jointIndex];
+
+            pFrame->TrackingState[i] = static_cast<TrackingState>(flags & SKELETON_JOINT_STATE_MASK);
+            pFrame->PositionX[i] = body.Position[jointIndex * 3 + 0] / POSITION_SCALE;
+            pFrame->PositionY[i] = body.Position[jointIndex * 3 + 1] / POSITION_SCALE;
+            pFrame->PositionZ[i] = body.Position[jointIndex * 3 + 2] / POSITION_SCALE;
+
+            if (0 != (flags & SKELETON_JOINT_ZERO_ROTATION))
+            {
+                continue;
+            }
+
+            UINT largest = (flags >> SKELETON_JOINT_LARGEST_SHIFT) & 0x3;
+            float q[4];
+            float sum = 0.0f;
+            for (UINT c = 0, k = 0; c < 4; ++c)
+            {
+                if (c != largest)
+                {
+                    q[c] = body.Rotation[jointIndex * 3 + k++] / ROTATION_SCALE;
+                    sum += q[c] * q[c];
+                }
+            }
+            q[largest] = sqrtf(max(1.0f - sum, 0.0f));
+
+            pFrame->OrientationX[i] = q[0];
+            pFrame->OrientationY[i] = q[1];
+            pFrame->OrientationZ[i] = q[2];
+            pFrame->OrientationW[i] = q[3];
+        }
+    }
+}
+
+// joint flags as sent, without orientations only the tracking state goes over the wire
+inline BYTE WireJointFlags(BYTE flags, BOOL orientations)
+{
+    return orientations ? flags : static_cast<BYTE>(flags & SKELETON_JOINT_STATE_MASK);
+}
+
+inline bool IsDeltaBody(_In_ const SkeletonWireBody& body, _In_opt_ const SkeletonWireFrame* pBase, UINT bodyIndex)
+{
+    return nullptr != pBase && pBase->Bodies[bodyIndex].IsTracked && pBase->Bodies[bodyIndex].TrackingId == body.TrackingId;
+}
+
+UINT KinectEvolution::Xaml::Controls::Skeleton::EncodeSkeletonFrame(
+    _In_ const SkeletonWireFrame& frame,
+    _In_opt_ const SkeletonWireFrame* pBase,
+    BOOL orientations,
+    _Out_writes_bytes_to_(capacity, return) BYTE* pBuffer,
+    UINT capacity)
+{
+    BYTE bodyMask = 0;
+    BYTE deltaMask = 0;
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        if (frame.Bodies[bodyIndex].IsTracked)
+        {
+            bodyMask |= static_cast<BYTE>(1 << bodyIndex);
+            if (IsDeltaBody(frame.Bodies[bodyIndex], pBase, bodyIndex))
+            {
+                deltaMask |= static_cast<BYTE>(1 << bodyIndex);
+            }
+        }
+    }
+
+    BYTE flags = (nullptr == pBase) ? SKELETON_WIRE_KEYFRAME : 0;
+    if (orientations)
+    {
+        flags |= SKELETON_WIRE_ORIENTATIONS;
+    }
+
+    UINT16 magic = SKELETON_WIRE_MAGIC;
+    UINT16 size = 0;    // patched below
+    UINT baseSequence = (nullptr != pBase) ? pBase->Sequence : frame.Sequence;
+
+    WireWriter writer = { pBuffer, 0, capacity };
+    writer.Write(&magic, sizeof(magic));
+    writer.WriteByte(SKELETON_WIRE_VERSION);
+    writer.WriteByte(flags);
+    writer.Write(&size, sizeof(size));
+    writer.WriteByte(bodyMask);
+    writer.WriteByte(deltaMask);
+    writer.Write(&frame.Sequence, sizeof(frame.Sequence));
+    writer.Write(&baseSequence, sizeof(baseSequence));
+    writer.Write(&frame.RelativeTime, sizeof(frame.RelativeTime));
+    writer.Write(frame.FloorClipPlane, sizeof(frame.FloorClipPlane));
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        const SkeletonWireBody& body = frame.Bodies[bodyIndex];
+        if (!body.IsTracked)
+        {
+            continue;
+        }
+
+        BYTE hands = static_cast<BYTE>(body.HandLeftState | (body.HandRightState << 4));
+
+        if (0 == (deltaMask & (1 << bodyIndex)))
+        {
+            writer.Write(&body.TrackingId, sizeof(body.TrackingId));
+            writer.WriteByte(hands);
+            for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+            {
+                writer.WriteByte(WireJointFlags(body.JointFlags[jointIndex], orientations));
+            }
+            writer.Write(body.Position, sizeof(body.Position));
+            if (orientations)
+            {
+                writer.Write(body.Rotation, sizeof(body.Rotation));
+            }
+            continue;
+        }
+
+        // only the joint flags that changed, then every value as a difference
+        const SkeletonWireBody& base = pBase->Bodies[bodyIndex];
+
+        UINT changed = 0;
+        for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+        {
+            if (WireJointFlags(body.JointFlags[jointIndex], orientations) != WireJointFlags(base.JointFlags[jointIndex], orientations))
+            {
+                changed |= 1u << jointIndex;
+            }
+        }
+
+        writer.WriteByte(hands);
+        writer.WriteVarint(changed);
+        for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+        {
+            if (0 != (changed & (1u << jointIndex)))
+            {
+                writer.WriteByte(WireJointFlags(body.JointFlags[jointIndex], orientations));
+            }
+        }
+
+        for (UINT v = 0; v < JOINT_VALUES; ++v)
+        {
+            writer.WriteSigned(body.Position[v] - base.Position[v]);
+        }
+
+        if (orientations)
+        {
+            for (UINT v = 0; v < JOINT_VALUES; ++v)
+            {
+                writer.WriteSigned(body.Rotation[v] - base.Rotation[v]);
+            }
+        }
+    }
+
+    if (writer.Overflowed() || writer.Size > 0xFFFF)
+    {
+        return 0;
+    }
+
+    size = static_cast<UINT16>(writer.Size);
+    CopyMemory(pBuffer + 4, &size, sizeof(size));
+
+    return writer.Size;
+}
+
+bool KinectEvolution::Xaml::Controls::Skeleton::ReadSkeletonFrameHeader(_In_reads_bytes_(size) const BYTE* pBuffer, UINT size, _Out_ SkeletonWireHeader* pHeader)
+{
+    ZeroMemory(pHeader, sizeof(*pHeader));
+
+    if (size < HEADER_SIZE)
+    {
+        return false;
+    }
+
+    UINT16 magic;
+    UINT16 frameSize;
+    CopyMemory(&magic, pBuffer, sizeof(magic));
+    CopyMemory(&frameSize, pBuffer + 4, sizeof(frameSize));
+    if (SKELETON_WIRE_MAGIC != magic || SKELETON_WIRE_VERSION != pBuffer[2] || frameSize < HEADER_SIZE)
+    {
+        return false;
+    }
+
+    pHeader->Flags = pBuffer[3];
+    pHeader->Size = frameSize;
+    CopyMemory(&pHeader->Sequence, pBuffer + 8, sizeof(pHeader->Sequence));
+    CopyMemory(&pHeader->BaseSequence, pBuffer + 12, sizeof(pHeader->BaseSequence));
+
+    return true;
+}
+
+bool KinectEvolution::Xaml::Controls::Skeleton::DecodeSkeletonFrame(
+    _In_reads_bytes_(size) const BYTE* pBuffer,
+    UINT size,
+    _In_opt_ const SkeletonWireFrame* pBase,
+    _Out_ SkeletonWireFrame* pFrame)
+{
+    ZeroMemory(pFrame, sizeof(*pFrame));
+
+    SkeletonWireHeader header;
+    if (!ReadSkeletonFrameHeader(pBuffer, size, &header) || header.Size > size)
+    {
+        return false;
+    }
+
+    if (0 != (header.Flags & SKELETON_WIRE_KEYFRAME))
+    {
+        pBase = nullptr;
+    }
+    else if (nullptr == pBase || pBase->Sequence != header.BaseSequence)
+    {
+        return false;
+    }
+
+    BOOL orientations = (0 != (header.Flags & SKELETON_WIRE_ORIENTATIONS));
+
+    WireReader reader = { pBuffer, header.Size, 8, false };
+    reader.Read(&pFrame->Sequence, sizeof(pFrame->Sequence));
+    reader.Offset += sizeof(header.BaseSequence);
+    reader.Read(&pFrame->RelativeTime, sizeof(pFrame->RelativeTime));
+    reader.Read(pFrame->FloorClipPlane, sizeof(pFrame->FloorClipPlane));
+
+    BYTE bodyMask = pBuffer[6];
+    BYTE deltaMask = pBuffer[7];
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT && !reader.Failed; ++bodyIndex)
+    {
+        if (0 == (bodyMask & (1 << bodyIndex)))
+        {
+            continue;
+        }
+
+        SkeletonWireBody& body = pFrame->Bodies[bodyIndex];
+        body.IsTracked = TRUE;
+
+        if (0 == (deltaMask & (1 << bodyIndex)))
+        {
+            reader.Read(&body.TrackingId, sizeof(body.TrackingId));
+            BYTE hands = reader.ReadByte();
+            body.HandLeftState = hands & 0xF;
+            body.HandRightState = hands >> 4;
+            reader.Read(body.JointFlags, sizeof(body.JointFlags));
+            reader.Read(body.Position, sizeof(body.Position));
+            if (orientations)
+            {
+                reader.Read(body.Rotation, sizeof(body.Rotation));
+            }
+        }
+        else
+        {
+            if (nullptr == pBase || !pBase->Bodies[bodyIndex].IsTracked)
+            {
+                return false;
+            }
+
+            const SkeletonWireBody& base = pBase->Bodies[bodyIndex];
+            body.TrackingId = base.TrackingId;
+
+            BYTE hands = reader.ReadByte();
+            body.HandLeftState = hands & 0xF;
+            body.HandRightState = hands >> 4;
+
+            UINT changed = reader.ReadVarint();
+            for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+            {
+                body.JointFlags[jointIndex] = (0 != (changed & (1u << jointIndex))) ? reader.ReadByte() : WireJointFlags(base.JointFlags[jointIndex], orientations);
+            }
+
+            for (UINT v = 0; v < JOINT_VALUES; ++v)
+            {
+                body.Position[v] = static_cast<INT16>(base.Position[v] + reader.ReadSigned());
+            }
+
+            if (orientations)
+            {
+                for (UINT v = 0; v < JOINT_VALUES; ++v)
+                {
+                    body.Rotation[v] = static_cast<INT16>(base.Rotation[v] + reader.ReadSigned());
+                }
+            }
+        }
+
+        if (!orientations)
+        {
+            for (UINT jointIndex = 0; jointIndex < JOINT_COUNT; ++jointIndex)
+            {
+                body.JointFlags[jointIndex] = (body.JointFlags[jointIndex] & SKELETON_JOINT_STATE_MASK) | SKELETON_JOINT_ZERO_ROTATION;
+            }
+        }
+    }
+
+    return !reader.Failed;
+}
+
+SkeletonWireDecoder::SkeletonWireDecoder()
+    : _history(HISTORY_FRAMES)
+    , _valid(HISTORY_FRAMES)
+{
+    Reset();
+}
+
+void SkeletonWireDecoder::Reset()
+{
+    for (UINT i = 0; i < HISTORY_FRAMES; ++i)
+    {
+        _valid[i] = FALSE;
+    }
+
+    _latest = 0;
+    _hasFrame = FALSE;
+}
+
+bool SkeletonWireDecoder::Decode(_In_reads_bytes_(size) const BYTE* pBuffer, UINT size)
+{
+    SkeletonWireHeader header;
+    if (!ReadSkeletonFrameHeader(pBuffer, size, &header))
+    {
+        return false;
+    }
+
+    // frames that arrive late are of no use
+    if (_hasFrame && static_cast<INT32>(header.Sequence - _history[_latest].Sequence) <= 0)
+    {
+        return false;
+    }
+
+    const SkeletonWireFrame* pBase = nullptr;
+    if (0 == (header.Flags & SKELETON_WIRE_KEYFRAME))
+    {
+        UINT baseSlot = header.BaseSequence % HISTORY_FRAMES;
+        if (header.Sequence - header.BaseSequence >= HISTORY_FRAMES || !_valid[baseSlot] || _history[baseSlot].Sequence != header.BaseSequence)
+        {
+            return false;
+        }
+
+        pBase = &_history[baseSlot];
+    }
+
+    SkeletonWireFrame frame;
+    if (!DecodeSkeletonFrame(pBuffer, size, pBase, &frame))
+    {
+        return false;
+    }
+
+    _latest = header.Sequence % HISTORY_FRAMES;
+    _history[_latest] = frame;
+    _valid[_latest] = TRUE;
+    _hasFrame = TRUE;
+
+    return true;
+}
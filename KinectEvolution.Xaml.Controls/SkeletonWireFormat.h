@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonWireFormat.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Skeleton {
+
+                static const UINT16 SKELETON_WIRE_MAGIC = 0x4B53;
+                static const BYTE SKELETON_WIRE_VERSION = 1;
+
+                // largest encoded frame, every value of every body at its widest
+                static const UINT SKELETON_WIRE_MAX_SIZE = 4096;
+
+                // datagram types a UDP subscriber sends to the broadcaster
+                static const BYTE SKELETON_WIRE_SUBSCRIBE = 1;
+                static const BYTE SKELETON_WIRE_ACK = 2;        // Sequence decoded, later frames may be deltas against it
+                static const BYTE SKELETON_WIRE_LEAVE = 3;
+
+                struct SkeletonWireDatagram
+                {
+                    UINT16  Magic;
+                    BYTE    Type;
+                    BYTE    Reserved;
+                    UINT    Sequence;
+                };
+
+                // header flags
+                static const BYTE SKELETON_WIRE_KEYFRAME = 0x1;
+                static const BYTE SKELETON_WIRE_ORIENTATIONS = 0x2;
+
+                // joint flags of SkeletonWireBody::JointFlags
+                static const BYTE SKELETON_JOINT_STATE_MASK = 0x3;     // WRK::TrackingState
+                static const BYTE SKELETON_JOINT_LARGEST_SHIFT = 2;    // largest quaternion component
+                static const BYTE SKELETON_JOINT_ZERO_ROTATION = 0x10;
+
+                // one body quantized: positions at 1/4096 m and orientations as smallest three at 16 bits
+                struct SkeletonWireBody
+                {
+                    BOOL    IsTracked;
+                    UINT64  TrackingId;
+                    BYTE    HandLeftState;
+                    BYTE    HandRightState;
+                    BYTE    JointFlags[JOINT_COUNT];
+                    INT16   Position[JOINT_COUNT * 3];
+                    INT16   Rotation[JOINT_COUNT * 3];
+                };
+
+                struct SkeletonWireFrame
+                {
+                    UINT                Sequence;
+                    INT64               RelativeTime;
+                    INT16               FloorClipPlane[4];
+                    SkeletonWireBody    Bodies[BODY_COUNT];
+                };
+
+                struct SkeletonWireHeader
+                {
+                    BYTE    Flags;
+                    UINT    Size;           // of the whole frame in bytes
+                    UINT    Sequence;
+                    UINT    BaseSequence;   // frame the deltas are against, unless a key frame
+                };
+
+                void QuantizeSkeletonFrame(_In_ const BodyFrameData& frame, UINT sequence, _Out_ SkeletonWireFrame* pFrame);
+                void DequantizeSkeletonFrame(_In_ const SkeletonWireFrame& frame, _Out_ BodyFrameData* pFrame);
+
+                // bodies in the same slot under the same id as in the base are sent as zigzag varint deltas,
+                // the rest in full. a null base makes a key frame. returns the size, 0 when it does not fit
+                UINT EncodeSkeletonFrame(
+                    _In_ const SkeletonWireFrame& frame,
+                    _In_opt_ const SkeletonWireFrame* pBase,
+                    BOOL orientations,
+                    _Out_writes_bytes_to_(capacity, return) BYTE* pBuffer,
+                    UINT capacity);
+
+                // false when the bytes do not start with a frame header. frames go back to back over TCP, Size delimits them
+                bool ReadSkeletonFrameHeader(_In_reads_bytes_(size) const BYTE* pBuffer, UINT size, _Out_ SkeletonWireHeader* pHeader);
+
+                // pBase must be the frame named by the header's BaseSequence unless it is a key frame
+                bool DecodeSkeletonFrame(
+                    _In_reads_bytes_(size) const BYTE* pBuffer,
+                    UINT size,
+                    _In_opt_ const SkeletonWireFrame* pBase,
+                    _Out_ SkeletonWireFrame* pFrame);
+
+                // receiving end, keeps the recent frames later deltas may be against
+                class SkeletonWireDecoder
+                {
+                public:
+                    SkeletonWireDecoder();
+
+                    void Reset();
+
+                    // false for a damaged frame or one against a base no longer held
+                    bool Decode(_In_reads_bytes_(size) const BYTE* pBuffer, UINT size);
+
+                    const SkeletonWireFrame& GetFrame() const { return _history[_latest]; }
+
+                    BOOL HasFrame() const { return _hasFrame; }
+
+                private:
+                    static const UINT HISTORY_FRAMES = 64;
+
+                    std::vector<SkeletonWireFrame>  _history;   // by sequence modulo HISTORY_FRAMES
+                    std::vector<BOOL>               _valid;
+                    UINT                            _latest;
+                    BOOL                            _hasFrame;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,545 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkinnedMesh.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SkinnedMesh.h"
+
+#include <algorithm>
+#include <ppl.h>
+
+using namespace KinectEvolution::Xaml::Controls::BlockMan;
+
+// squared lengths below this are treated as zero when normalizing
+static const float MIN_LENGTH_SQUARED = 1e-12f;
+
+inline XMVECTOR LoadLanes(_In_reads_(4) const float* pSource)
+{
+    return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pSource));
+}
+
+inline void StoreLanes(_Out_writes_(4) float* pDestination, FXMVECTOR value)
+{
+    XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pDestination), value);
+}
+
+// the same member of 4 bones, one bone per lane after the transpose
+inline XMMATRIX GatherLanes(_In_reads_(4) const BYTE* pBones, _In_ const XMFLOAT4* pBase, size_t stride)
+{
+    const BYTE* pBytes = reinterpret_cast<const BYTE*>(pBase);
+
+    return XMMatrixTranspose(XMMATRIX(
+        XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pBytes + pBones[0] * stride)),
+        XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pBytes + pBones[1] * stride)),
+        XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pBytes + pBones[2] * stride)),
+        XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pBytes + pBones[3] * stride))));
+}
+
+// 1 / length of 4 vectors, 0 for the ones too short to normalize
+inline XMVECTOR InverseLength(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+{
+    XMVECTOR lengthSquared = XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, z * z));
+    XMVECTOR valid = XMVectorGreater(lengthSquared, XMVectorReplicate(MIN_LENGTH_SQUARED));
+
+    return XMVectorAndInt(XMVectorReciprocalSqrt(XMVectorMax(lengthSquared, XMVectorReplicate(MIN_LENGTH_SQUARED))), valid);
+}
+
+SkinnedMesh::SkinnedMesh()
+    : _vertexCount(0)
+    , _streamLength(0)
+    , _boneCount(0)
+{
+    ZeroMemory(_influenceStart, sizeof(_influenceStart));
+
+    // every bone at rest until the first SetPose
+    BonePose rest;
+    rest.Columns[0] = XMFLOAT4(1.0f, 0.0f, 0.0f, 0.0f);
+    rest.Columns[1] = XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f);
+    rest.Columns[2] = XMFLOAT4(0.0f, 0.0f, 1.0f, 0.0f);
+    rest.Real = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+    rest.Dual = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        for (UINT boneIndex = 0; boneIndex < BLOCK_COUNT; ++boneIndex)
+        {
+            _poses[bodyIndex][boneIndex] = rest;
+        }
+    }
+}
+
+bool SkinnedMesh::Load(_In_reads_bytes_(size) const BYTE* pData, size_t size)
+{
+    SkinnedMeshFileHeader header;
+    if (nullptr == pData || size < sizeof(header))
+    {
+        return false;
+    }
+
+    memcpy(&header, pData, sizeof(header));
+    if (SKINNED_MESH_MAGIC != header.Magic || SKINNED_MESH_VERSION != header.Version ||
+        0 == header.VertexCount || 0 != header.IndexCount % 3 ||
+        0 == header.BoneCount || header.BoneCount > BLOCK_COUNT)
+    {
+        return false;
+    }
+
+    size_t bindOffset = sizeof(header);
+    size_t vertexOffset = bindOffset + header.BoneCount * sizeof(XMFLOAT4X3);
+    size_t indexOffset = vertexOffset + static_cast<size_t>(header.VertexCount) * sizeof(SkinnedMeshFileVertex);
+    if (header.VertexCount > size / sizeof(SkinnedMeshFileVertex) || header.IndexCount > size / sizeof(UINT32) ||
+        indexOffset + static_cast<size_t>(header.IndexCount) * sizeof(UINT32) > size)
+    {
+        return false;
+    }
+
+    std::vector<SkinnedMeshFileVertex> vertices(header.VertexCount);
+    memcpy(vertices.data(), pData + vertexOffset, vertices.size() * sizeof(SkinnedMeshFileVertex));
+
+    std::vector<UINT32> indices(header.IndexCount);
+    if (header.IndexCount > 0)
+    {
+        memcpy(indices.data(), pData + indexOffset, indices.size() * sizeof(UINT32));
+    }
+
+    for (UINT32 index : indices)
+    {
+        if (index >= header.VertexCount)
+        {
+            return false;
+        }
+    }
+
+    // influences by decreasing weight, normalized, unused ones at zero
+    std::vector<BYTE> influenceCount(header.VertexCount);
+    for (UINT32 i = 0; i < header.VertexCount; ++i)
+    {
+        SkinnedMeshFileVertex& vertex = vertices[i];
+        float weights[SKINNED_MESH_INFLUENCES] = { vertex.Weights.x, vertex.Weights.y, vertex.Weights.z, vertex.Weights.w };
+        UINT order[SKINNED_MESH_INFLUENCES] = { 0, 1, 2, 3 };
+        std::sort(order, order + SKINNED_MESH_INFLUENCES, [&weights](UINT a, UINT b) { return weights[a] > weights[b]; });
+
+        float total = 0.0f;
+        BYTE bones[SKINNED_MESH_INFLUENCES] = {};
+        float sorted[SKINNED_MESH_INFLUENCES] = {};
+        BYTE count = 0;
+        for (UINT k = 0; k < SKINNED_MESH_INFLUENCES; ++k)
+        {
+            float weight = weights[order[k]];
+            if (!(weight > 0.0f))
+            {
+                break;
+            }
+
+            if (vertex.Bones[order[k]] >= header.BoneCount)
+            {
+                return false;
+            }
+
+            bones[count] = vertex.Bones[order[k]];
+            sorted[count] = weight;
+            total += weight;
+            ++count;
+        }
+
+        if (0 == count)
+        {
+            return false;
+        }
+
+        for (UINT k = 0; k < SKINNED_MESH_INFLUENCES; ++k)
+        {
+            vertex.Bones[k] = bones[k];
+        }
+        vertex.Weights = XMFLOAT4(sorted[0] / total, sorted[1] / total, sorted[2] / total, sorted[3] / total);
+        influenceCount[i] = count;
+    }
+
+    // fewest influences first, so the later slots of most groups are empty
+    std::vector<UINT32> order(header.VertexCount);
+    for (UINT32 i = 0; i < header.VertexCount; ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&influenceCount](UINT32 a, UINT32 b) { return influenceCount[a] < influenceCount[b]; });
+
+    std::vector<UINT32> remap(header.VertexCount);
+    for (UINT32 i = 0; i < header.VertexCount; ++i)
+    {
+        remap[order[i]] = i;
+    }
+
+    _vertexCount = header.VertexCount;
+    _streamLength = (_vertexCount + 3) & ~3u;
+    _boneCount = header.BoneCount;
+
+    _inverseBind.resize(_boneCount);
+    for (UINT boneIndex = 0; boneIndex < _boneCount; ++boneIndex)
+    {
+        XMFLOAT4X3 inverseBind;
+        memcpy(&inverseBind, pData + bindOffset + boneIndex * sizeof(XMFLOAT4X3), sizeof(inverseBind));
+        XMStoreFloat4x4(&_inverseBind[boneIndex], XMLoadFloat4x3(&inverseBind));
+    }
+
+    for (UINT stream = 0; stream < STREAM_COUNT; ++stream)
+    {
+        _bind[stream].assign(_streamLength, 0.0f);
+    }
+
+    // padding follows bone 0 with a zero vertex
+    for (UINT k = 0; k < SKINNED_MESH_INFLUENCES; ++k)
+    {
+        _weights[k].assign(_streamLength, 0 == k ? 1.0f : 0.0f);
+        _bones[k].assign(_streamLength, 0);
+        _influenceStart[k] = _streamLength;
+    }
+
+    _tex.resize(_vertexCount);
+
+    for (UINT32 i = 0; i < _vertexCount; ++i)
+    {
+        const SkinnedMeshFileVertex& vertex = vertices[order[i]];
+
+        _bind[STREAM_X][i] = vertex.Position.x;
+        _bind[STREAM_Y][i] = vertex.Position.y;
+        _bind[STREAM_Z][i] = vertex.Position.z;
+        _bind[STREAM_NX][i] = vertex.Normal.x;
+        _bind[STREAM_NY][i] = vertex.Normal.y;
+        _bind[STREAM_NZ][i] = vertex.Normal.z;
+        _tex[i] = vertex.Tex;
+
+        const float weights[SKINNED_MESH_INFLUENCES] = { vertex.Weights.x, vertex.Weights.y, vertex.Weights.z, vertex.Weights.w };
+        for (UINT k = 0; k < SKINNED_MESH_INFLUENCES; ++k)
+        {
+            _weights[k][i] = weights[k];
+            _bones[k][i] = vertex.Bones[k];
+
+            if (k < influenceCount[order[i]])
+            {
+                _influenceStart[k] = min(_influenceStart[k], i & ~3u);
+            }
+        }
+    }
+
+    _indices.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        _indices[i] = remap[indices[i]];
+    }
+
+    _skinned.assign(BODY_COUNT * STREAM_COUNT * _streamLength, 0.0f);
+
+    return true;
+}
+
+void SkinnedMesh::SetPose(UINT bodyIndex, _In_ const BlockManKinematics& kinematics, CXMMATRIX model)
+{
+    if (bodyIndex >= BODY_COUNT)
+    {
+        return;
+    }
+
+    // the blocks draw as mesh * model * block, the mesh is skinned to mesh * (model * block * model^-1) and
+    // then drawn with the model, which keeps the bone transforms rigid under a mirroring model
+    XMMATRIX mirror = model;
+    mirror.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+    XMMATRIX mirrorInverse = XMMatrixInverse(nullptr, mirror);
+
+    for (UINT boneIndex = 0; boneIndex < BLOCK_COUNT; ++boneIndex)
+    {
+        XMMATRIX block = kinematics.GetBlockTransform(bodyIndex, boneIndex);
+
+        // without the block scale
+        XMMATRIX frame = XMMATRIX(
+            XMVector3Normalize(block.r[0]),
+            XMVector3Normalize(block.r[1]),
+            XMVector3Normalize(block.r[2]),
+            block.r[3]);
+
+        XMMATRIX pose = mirror * frame * mirrorInverse;
+        if (boneIndex < _boneCount)
+        {
+            pose = XMLoadFloat4x4(&_inverseBind[boneIndex]) * pose;
+        }
+
+        BonePose& bonePose = _poses[bodyIndex][boneIndex];
+
+        XMMATRIX columns = XMMatrixTranspose(pose);
+        for (UINT j = 0; j < 3; ++j)
+        {
+            XMStoreFloat4(&bonePose.Columns[j], columns.r[j]);
+        }
+
+        // dual = translation * real / 2
+        XMVECTOR real = XMQuaternionNormalize(XMQuaternionRotationMatrix(pose));
+        XMVECTOR translation = XMVectorAndInt(pose.r[3], g_XMMaskXYZ);
+        XMVECTOR dual = XMQuaternionMultiply(real, translation) * XMVectorReplicate(0.5f);
+
+        XMStoreFloat4(&bonePose.Real, real);
+        XMStoreFloat4(&bonePose.Dual, dual);
+    }
+}
+
+void SkinnedMesh::Skin(UINT bodyMask, SkinningMode mode)
+{
+    if (0 == _vertexCount)
+    {
+        return;
+    }
+
+    UINT bodies[BODY_COUNT];
+    UINT bodyCount = 0;
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        if (0 != (bodyMask & (1u << bodyIndex)))
+        {
+            bodies[bodyCount++] = bodyIndex;
+        }
+    }
+
+    UINT blockCount = (_streamLength + VERTEX_BLOCK - 1) / VERTEX_BLOCK;
+
+    Concurrency::parallel_for(0u, bodyCount * blockCount, [&](UINT item)
+    {
+        UINT bodyIndex = bodies[item / blockCount];
+        UINT first = (item % blockCount) * VERTEX_BLOCK;
+        UINT last = min(first + VERTEX_BLOCK, _streamLength);
+
+        if (SkinningMode::DualQuaternion == mode)
+        {
+            SkinDualQuaternion(bodyIndex, first, last);
+        }
+        else
+        {
+            SkinLinear(bodyIndex, first, last);
+        }
+    });
+}
+
+void SkinnedMesh::SkinLinear(UINT bodyIndex, UINT first, UINT last)
+{
+    const XMFLOAT4* pColumns = &_poses[bodyIndex][0].Columns[0];
+
+    float* pX = GetStream(bodyIndex, STREAM_X);
+    float* pY = GetStream(bodyIndex, STREAM_Y);
+    float* pZ = GetStream(bodyIndex, STREAM_Z);
+    float* pNX = GetStream(bodyIndex, STREAM_NX);
+    float* pNY = GetStream(bodyIndex, STREAM_NY);
+    float* pNZ = GetStream(bodyIndex, STREAM_NZ);
+
+    for (UINT i = first; i < last; i += 4)
+    {
+        // blend[j].r[i] holds m_ij of the blended matrix for 4 vertices
+        XMMATRIX blend[3];
+        for (UINT j = 0; j < 3; ++j)
+        {
+            XMVECTOR weight = LoadLanes(&_weights[0][i]);
+            XMMATRIX column = GatherLanes(&_bones[0][i], &pColumns[j], sizeof(BonePose));
+
+            blend[j] = XMMATRIX(weight * column.r[0], weight * column.r[1], weight * column.r[2], weight * column.r[3]);
+        }
+
+        for (UINT k = 1; k < SKINNED_MESH_INFLUENCES && i >= _influenceStart[k]; ++k)
+        {
+            XMVECTOR weight = LoadLanes(&_weights[k][i]);
+
+            for (UINT j = 0; j < 3; ++j)
+            {
+                XMMATRIX column = GatherLanes(&_bones[k][i], &pColumns[j], sizeof(BonePose));
+
+                for (UINT row = 0; row < 4; ++row)
+                {
+                    blend[j].r[row] = XMVectorMultiplyAdd(weight, column.r[row], blend[j].r[row]);
+                }
+            }
+        }
+
+        XMVECTOR x = LoadLanes(&_bind[STREAM_X][i]);
+        XMVECTOR y = LoadLanes(&_bind[STREAM_Y][i]);
+        XMVECTOR z = LoadLanes(&_bind[STREAM_Z][i]);
+        XMVECTOR nx = LoadLanes(&_bind[STREAM_NX][i]);
+        XMVECTOR ny = LoadLanes(&_bind[STREAM_NY][i]);
+        XMVECTOR nz = LoadLanes(&_bind[STREAM_NZ][i]);
+
+        XMVECTOR position[3];
+        XMVECTOR normal[3];
+        for (UINT j = 0; j < 3; ++j)
+        {
+            position[j] = XMVectorMultiplyAdd(x, blend[j].r[0], XMVectorMultiplyAdd(y, blend[j].r[1], XMVectorMultiplyAdd(z, blend[j].r[2], blend[j].r[3])));
+            normal[j] = XMVectorMultiplyAdd(nx, blend[j].r[0], XMVectorMultiplyAdd(ny, blend[j].r[1], nz * blend[j].r[2]));
+        }
+
+        // a blend of rotations is not a rotation, the normals come out short
+        XMVECTOR scale = InverseLength(normal[0], normal[1], normal[2]);
+
+        StoreLanes(&pX[i], position[0]);
+        StoreLanes(&pY[i], position[1]);
+        StoreLanes(&pZ[i], position[2]);
+        StoreLanes(&pNX[i], normal[0] * scale);
+        StoreLanes(&pNY[i], normal[1] * scale);
+        StoreLanes(&pNZ[i], normal[2] * scale);
+    }
+}
+
+void SkinnedMesh::SkinDualQuaternion(UINT bodyIndex, UINT first, UINT last)
+{
+    const XMFLOAT4* pReal = &_poses[bodyIndex][0].Real;
+    const XMFLOAT4* pDual = &_poses[bodyIndex][0].Dual;
+
+    float* pX = GetStream(bodyIndex, STREAM_X);
+    float* pY = GetStream(bodyIndex, STREAM_Y);
+    float* pZ = GetStream(bodyIndex, STREAM_Z);
+    float* pNX = GetStream(bodyIndex, STREAM_NX);
+    float* pNY = GetStream(bodyIndex, STREAM_NY);
+    float* pNZ = GetStream(bodyIndex, STREAM_NZ);
+
+    const XMVECTOR two = XMVectorReplicate(2.0f);
+
+    for (UINT i = first; i < last; i += 4)
+    {
+        // lanes of x, y, z and w of the blended real and dual parts
+        XMVECTOR weight = LoadLanes(&_weights[0][i]);
+        XMMATRIX pivot = GatherLanes(&_bones[0][i], pReal, sizeof(BonePose));
+        XMMATRIX dual = GatherLanes(&_bones[0][i], pDual, sizeof(BonePose));
+
+        XMVECTOR r[4];
+        XMVECTOR d[4];
+        for (UINT c = 0; c < 4; ++c)
+        {
+            r[c] = weight * pivot.r[c];
+            d[c] = weight * dual.r[c];
+        }
+
+        for (UINT k = 1; k < SKINNED_MESH_INFLUENCES && i >= _influenceStart[k]; ++k)
+        {
+            weight = LoadLanes(&_weights[k][i]);
+            XMMATRIX real = GatherLanes(&_bones[k][i], pReal, sizeof(BonePose));
+            dual = GatherLanes(&_bones[k][i], pDual, sizeof(BonePose));
+
+            // q and -q are the same rotation, take the one on the side of the first influence
+            XMVECTOR dot = XMVectorMultiplyAdd(real.r[0], pivot.r[0], XMVectorMultiplyAdd(real.r[1], pivot.r[1],
+                XMVectorMultiplyAdd(real.r[2], pivot.r[2], real.r[3] * pivot.r[3])));
+            weight = XMVectorSelect(weight, XMVectorNegate(weight), XMVectorLess(dot, XMVectorZero()));
+
+            for (UINT c = 0; c < 4; ++c)
+            {
+                r[c] = XMVectorMultiplyAdd(weight, real.r[c], r[c]);
+                d[c] = XMVectorMultiplyAdd(weight, dual.r[c], d[c]);
+            }
+        }
+
+        XMVECTOR lengthSquared = XMVectorMultiplyAdd(r[0], r[0], XMVectorMultiplyAdd(r[1], r[1], XMVectorMultiplyAdd(r[2], r[2], r[3] * r[3])));
+        XMVECTOR inverse = XMVectorReciprocalSqrt(XMVectorMax(lengthSquared, XMVectorReplicate(MIN_LENGTH_SQUARED)));
+        for (UINT c = 0; c < 4; ++c)
+        {
+            r[c] = r[c] * inverse;
+            d[c] = d[c] * inverse;
+        }
+
+        // translation = 2 (rw dv - dw rv + rv x dv)
+        XMVECTOR tx = two * (r[3] * d[0] - d[3] * r[0] + r[1] * d[2] - r[2] * d[1]);
+        XMVECTOR ty = two * (r[3] * d[1] - d[3] * r[1] + r[2] * d[0] - r[0] * d[2]);
+        XMVECTOR tz = two * (r[3] * d[2] - d[3] * r[2] + r[0] * d[1] - r[1] * d[0]);
+
+        XMVECTOR p[2][3] =
+        {
+            { LoadLanes(&_bind[STREAM_X][i]), LoadLanes(&_bind[STREAM_Y][i]), LoadLanes(&_bind[STREAM_Z][i]) },
+            { LoadLanes(&_bind[STREAM_NX][i]), LoadLanes(&_bind[STREAM_NY][i]), LoadLanes(&_bind[STREAM_NZ][i]) },
+        };
+
+        // v + rw u + rv x u with u = 2 rv x v
+        for (UINT n = 0; n < 2; ++n)
+        {
+            XMVECTOR ux = two * (r[1] * p[n][2] - r[2] * p[n][1]);
+            XMVECTOR uy = two * (r[2] * p[n][0] - r[0] * p[n][2]);
+            XMVECTOR uz = two * (r[0] * p[n][1] - r[1] * p[n][0]);
+
+            p[n][0] = XMVectorMultiplyAdd(r[3], ux, p[n][0]) + (r[1] * uz - r[2] * uy);
+            p[n][1] = XMVectorMultiplyAdd(r[3], uy, p[n][1]) + (r[2] * ux - r[0] * uz);
+            p[n][2] = XMVectorMultiplyAdd(r[3], uz, p[n][2]) + (r[0] * uy - r[1] * ux);
+        }
+
+        StoreLanes(&pX[i], p[0][0] + tx);
+        StoreLanes(&pY[i], p[0][1] + ty);
+        StoreLanes(&pZ[i], p[0][2] + tz);
+        StoreLanes(&pNX[i], p[1][0]);
+        StoreLanes(&pNY[i], p[1][1]);
+        StoreLanes(&pNZ[i], p[1][2]);
+    }
+}
+
+void SkinnedMesh::WriteVertices(UINT bodyIndex, _Out_writes_(GetVertexCount()) SkinnedVertex* pVertices) const
+{
+    const float* pX = GetStream(bodyIndex, STREAM_X);
+    const float* pY = GetStream(bodyIndex, STREAM_Y);
+    const float* pZ = GetStream(bodyIndex, STREAM_Z);
+    const float* pNX = GetStream(bodyIndex, STREAM_NX);
+    const float* pNY = GetStream(bodyIndex, STREAM_NY);
+    const float* pNZ = GetStream(bodyIndex, STREAM_NZ);
+
+    for (UINT i = 0; i < _vertexCount; ++i)
+    {
+        pVertices[i].Position = XMFLOAT3(pX[i], pY[i], pZ[i]);
+        pVertices[i].Normal = XMFLOAT3(pNX[i], pNY[i], pNZ[i]);
+        pVertices[i].Tex = _tex[i];
+    }
+}
+
+void SkinnedMesh::SkinReference(UINT bodyIndex, UINT vertexIndex, SkinningMode mode, _Out_ XMFLOAT3* pPosition, _Out_ XMFLOAT3* pNormal) const
+{
+    XMVECTOR position = XMVectorSet(_bind[STREAM_X][vertexIndex], _bind[STREAM_Y][vertexIndex], _bind[STREAM_Z][vertexIndex], 1.0f);
+    XMVECTOR normal = XMVectorSet(_bind[STREAM_NX][vertexIndex], _bind[STREAM_NY][vertexIndex], _bind[STREAM_NZ][vertexIndex], 0.0f);
+
+    if (SkinningMode::DualQuaternion == mode)
+    {
+        const BonePose& pivot = _poses[bodyIndex][_bones[0][vertexIndex]];
+
+        XMVECTOR real = XMVectorZero();
+        XMVECTOR dual = XMVectorZero();
+        for (UINT k = 0; k < SKINNED_MESH_INFLUENCES; ++k)
+        {
+            const BonePose& pose = _poses[bodyIndex][_bones[k][vertexIndex]];
+            float weight = _weights[k][vertexIndex];
+            if (XMVectorGetX(XMVector4Dot(XMLoadFloat4(&pose.Real), XMLoadFloat4(&pivot.Real))) < 0.0f)
+            {
+                weight = -weight;
+            }
+
+            real += XMLoadFloat4(&pose.Real) * weight;
+            dual += XMLoadFloat4(&pose.Dual) * weight;
+        }
+
+        float length = XMVectorGetX(XMVector4Length(real));
+        real /= length;
+        dual /= length;
+
+        // translation = 2 dual * conjugate(real)
+        XMVECTOR translation = XMQuaternionMultiply(XMQuaternionConjugate(real), dual) * XMVectorReplicate(2.0f);
+
+        XMStoreFloat3(pPosition, XMVector3Rotate(position, real) + translation);
+        XMStoreFloat3(pNormal, XMVector3Rotate(normal, real));
+        return;
+    }
+
+    XMMATRIX blend = XMMATRIX(XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero());
+    for (UINT k = 0; k < SKINNED_MESH_INFLUENCES; ++k)
+    {
+        const BonePose& pose = _poses[bodyIndex][_bones[k][vertexIndex]];
+        XMMATRIX matrix = XMMatrixTranspose(XMMATRIX(
+            XMLoadFloat4(&pose.Columns[0]),
+            XMLoadFloat4(&pose.Columns[1]),
+            XMLoadFloat4(&pose.Columns[2]),
+            XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f)));
+
+        float weight = _weights[k][vertexIndex];
+        for (UINT row = 0; row < 4; ++row)
+        {
+            blend.r[row] += matrix.r[row] * weight;
+        }
+    }
+
+    XMStoreFloat3(pPosition, XMVector3Transform(position, blend));
+    XMStoreFloat3(pNormal, XMVector3Normalize(XMVector3TransformNormal(normal, blend)));
+}
@@ -0,0 +1,144 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkinnedMesh.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BlockManKinematics.h"
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace BlockMan {
+
+                static const UINT32 SKINNED_MESH_MAGIC = 0x4E4B534B;   // 'KSKN'
+                static const UINT32 SKINNED_MESH_VERSION = 1;
+
+                static const UINT SKINNED_MESH_INFLUENCES = 4;
+
+                // file layout: the header, BoneCount inverse bind transforms, VertexCount vertices and IndexCount
+                // UINT32 indices of a triangle list, all little endian. bone i follows block i of g_SkeletonBlocks;
+                // its inverse bind transform takes the mesh into the block's frame with every joint orientation the
+                // identity, the frame being the block's rotation and origin without its scale
+                struct SkinnedMeshFileHeader
+                {
+                    UINT32  Magic;
+                    UINT32  Version;
+                    UINT32  VertexCount;
+                    UINT32  IndexCount;
+                    UINT32  BoneCount;
+                };
+
+                struct SkinnedMeshFileVertex
+                {
+                    DirectX::XMFLOAT3   Position;
+                    DirectX::XMFLOAT3   Normal;
+                    DirectX::XMFLOAT2   Tex;
+                    BYTE                Bones[SKINNED_MESH_INFLUENCES];
+                    DirectX::XMFLOAT4   Weights;
+                };
+
+                // the layout BlockManEffect draws
+                struct SkinnedVertex
+                {
+                    DirectX::XMFLOAT3   Position;
+                    DirectX::XMFLOAT3   Normal;
+                    DirectX::XMFLOAT2   Tex;
+                };
+
+                enum class SkinningMode
+                {
+                    Linear,             // blends the bone matrices, joints lose volume when they bend far
+                    DualQuaternion,     // blends rigid transforms, keeps the volume at the cost of a few more operations
+                };
+
+                // skins one mesh for every body on the CPU, so the avatars need no vertex shader skinning.
+                // the vertices are kept as separate x, y and z streams and skinned 4 at a time; the bodies and
+                // blocks of vertices are spread over the worker threads. vertices are ordered by their number of
+                // influences when loaded, so most groups of 4 skip the unused influences.
+                class SkinnedMesh
+                {
+                public:
+                    SkinnedMesh();
+
+                    // false for a damaged file or bones outside the block hierarchy
+                    bool Load(_In_reads_bytes_(size) const BYTE* pData, size_t size);
+
+                    BOOL IsLoaded() const { return _vertexCount > 0; }
+
+                    UINT GetVertexCount() const { return _vertexCount; }
+                    const std::vector<UINT32>& GetIndices() const { return _indices; }
+
+                    // bone transforms from the solved blocks of a body. the mesh is posed in the body's space and
+                    // mirrored by model afterwards, so model must be a rotation or reflection for the transforms to
+                    // stay rigid; its translation is ignored
+                    void SetPose(UINT bodyIndex, _In_ const BlockManKinematics& kinematics, DirectX::CXMMATRIX model);
+
+                    // skins the bodies whose bit is set in bodyMask
+                    void Skin(UINT bodyMask, SkinningMode mode);
+
+                    // skinned vertices of a body, before the model transform
+                    void WriteVertices(UINT bodyIndex, _Out_writes_(GetVertexCount()) SkinnedVertex* pVertices) const;
+
+                    // one vertex without vectors or threads, to check the skinned streams against
+                    void SkinReference(UINT bodyIndex, UINT vertexIndex, SkinningMode mode, _Out_ DirectX::XMFLOAT3* pPosition, _Out_ DirectX::XMFLOAT3* pNormal) const;
+
+                private:
+                    // vertices handed to one worker
+                    static const UINT VERTEX_BLOCK = 2048;
+
+                    enum Stream
+                    {
+                        STREAM_X,
+                        STREAM_Y,
+                        STREAM_Z,
+                        STREAM_NX,
+                        STREAM_NY,
+                        STREAM_NZ,
+                        STREAM_COUNT,
+                    };
+
+                    // a bone transform as the columns (m0j, m1j, m2j, m3j) of its matrix, and as a dual quaternion
+                    struct BonePose
+                    {
+                        DirectX::XMFLOAT4   Columns[3];
+                        DirectX::XMFLOAT4   Real;
+                        DirectX::XMFLOAT4   Dual;
+                    };
+
+                    float* GetStream(UINT bodyIndex, Stream stream) { return &_skinned[(bodyIndex * STREAM_COUNT + stream) * _streamLength]; }
+                    const float* GetStream(UINT bodyIndex, Stream stream) const { return &_skinned[(bodyIndex * STREAM_COUNT + stream) * _streamLength]; }
+
+                    void SkinLinear(UINT bodyIndex, UINT first, UINT last);
+                    void SkinDualQuaternion(UINT bodyIndex, UINT first, UINT last);
+
+                private:
+                    UINT                        _vertexCount;
+                    UINT                        _streamLength;      // vertices rounded up to whole groups of 4
+                    UINT                        _boneCount;
+
+                    std::vector<DirectX::XMFLOAT4X4>    _inverseBind;
+
+                    // bind pose streams
+                    std::vector<float>          _bind[STREAM_COUNT];
+                    std::vector<float>          _weights[SKINNED_MESH_INFLUENCES];
+                    std::vector<BYTE>           _bones[SKINNED_MESH_INFLUENCES];
+                    UINT                        _influenceStart[SKINNED_MESH_INFLUENCES];  // first group using each influence
+
+                    std::vector<DirectX::XMFLOAT2>  _tex;
+                    std::vector<UINT32>         _indices;
+
+                    BonePose                    _poses[BODY_COUNT][BLOCK_COUNT];
+
+                    // STREAM_COUNT streams per body
+                    std::vector<float>          _skinned;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,263 @@
+//------------------------------------------------------------------------------
+// <copyright file="SpeakerAttribution.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SpeakerAttribution.h"
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+using namespace KinectEvolution::Xaml::Controls::Skeleton;
+using namespace Concurrency;
+
+// the beam's range, where it points when the speech comes from none of the bodies
+static const float BEAM_RANGE = 100.0f * XM_PI / 180.0f;
+
+// speech activity is taken over the last 0.3 sec of the window
+static const UINT RECENT_SLOTS = 9;
+
+// a body frame may land in the slot after its own when the frames jitter
+static const UINT BODY_SLOT_SEARCH = 2;
+
+INT64 SpeakerAttribution::GetTime()
+{
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return static_cast<INT64>(static_cast<double>(counter.QuadPart) * 1e7 / static_cast<double>(frequency.QuadPart));
+}
+
+INT64 SpeakerAttribution::GetSlot(INT64 time)
+{
+    return time / SPEAKER_SLOT_TICKS;
+}
+
+SpeakerAttribution::SpeakerAttribution()
+    : _beamAngleFlipped(FALSE)
+{
+    Reset(1.0f, 0.1f, 0.15f);
+}
+
+void SpeakerAttribution::Reset(float windowSeconds, float delaySeconds, float beamDeviation)
+{
+    ASSERT(windowSeconds > 0.0f && delaySeconds >= 0.0f && beamDeviation > 0.0f);
+
+    critical_section::scoped_lock lock(_lock);
+
+    const float slotsPerSecond = 1e7f / SPEAKER_SLOT_TICKS;
+
+    _delaySlots = min(static_cast<UINT>(delaySeconds * slotsPerSecond + 0.5f), SPEAKER_SLOT_COUNT / 2);
+    _windowSlots = min(max(static_cast<UINT>(windowSeconds * slotsPerSecond + 0.5f), 1u), SPEAKER_SLOT_COUNT - _delaySlots - BODY_SLOT_SEARCH - 1);
+    _recentSlots = min(RECENT_SLOTS, _windowSlots);
+    _beamDeviation = beamDeviation;
+
+    for (UINT i = 0; i < SPEAKER_SLOT_COUNT; ++i)
+    {
+        _beams[i].Slot = -1;
+        _bodies[i].Slot = -1;
+    }
+
+    ZeroMemory(&_result, sizeof(_result));
+}
+
+void SpeakerAttribution::SetBeamAngleFlipped(BOOL flipped)
+{
+    critical_section::scoped_lock lock(_lock);
+
+    _beamAngleFlipped = flipped;
+}
+
+BOOL SpeakerAttribution::IsBeamAngleFlipped() const
+{
+    critical_section::scoped_lock lock(_lock);
+
+    return _beamAngleFlipped;
+}
+
+void SpeakerAttribution::AddBeam(INT64 time, float beamAngle, float beamAngleConfidence, BOOL speaking)
+{
+    INT64 slot = GetSlot(time);
+
+    critical_section::scoped_lock lock(_lock);
+
+    if (_beamAngleFlipped)
+    {
+        beamAngle = -beamAngle;
+    }
+
+    BeamSlot& beam = _beams[slot & (SPEAKER_SLOT_COUNT - 1)];
+    if (beam.Slot != slot)
+    {
+        beam.Slot = slot;
+        beam.AngleSum = 0.0f;
+        beam.ConfidenceSum = 0.0f;
+        beam.Count = 0;
+        beam.Speaking = FALSE;
+    }
+
+    beam.AngleSum += beamAngle * beamAngleConfidence;
+    beam.ConfidenceSum += beamAngleConfidence;
+    beam.Count++;
+    beam.Speaking = beam.Speaking || speaking;
+}
+
+void SpeakerAttribution::AddBodies(_In_ const BodyFrameData& bodies, INT64 time)
+{
+    const UINT head = static_cast<UINT>(WRK::JointType::Head);
+
+    INT64 slot = GetSlot(time);
+
+    critical_section::scoped_lock lock(_lock);
+
+    BodySlot& entry = _bodies[slot & (SPEAKER_SLOT_COUNT - 1)];
+    entry.Slot = slot;
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        entry.TrackingId[bodyIndex] = bodies.IsTracked[bodyIndex] ? bodies.TrackingId[bodyIndex] : 0;
+        entry.HasHead[bodyIndex] = bodies.IsTracked[bodyIndex] && (WRK::TrackingState::NotTracked != bodies.GetTrackingState(bodyIndex, head));
+
+        // the head's direction in the plane of the array
+        UINT i = BodyJointIndex(bodyIndex, head);
+        entry.Azimuth[bodyIndex] = entry.HasHead[bodyIndex] ? atan2f(bodies.PositionX[i], bodies.PositionZ[i]) : 0.0f;
+    }
+}
+
+const SpeakerAttribution::BodySlot* SpeakerAttribution::FindBodies(INT64 slot) const
+{
+    for (UINT back = 0; back <= BODY_SLOT_SEARCH; ++back)
+    {
+        const BodySlot& entry = _bodies[(slot - back) & (SPEAKER_SLOT_COUNT - 1)];
+        if (entry.Slot == slot - back)
+        {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+void SpeakerAttribution::Update(INT64 time)
+{
+    critical_section::scoped_lock lock(_lock);
+
+    const INT64 last = GetSlot(time) - _delaySlots;
+    const INT64 first = last - _windowSlots + 1;
+
+    ZeroMemory(&_result, sizeof(_result));
+    _result.Time = time;
+
+    // who is there at the end of the window; earlier slots only count for the same person in the same slot
+    const BodySlot* pCurrent = FindBodies(last);
+    if (nullptr == pCurrent)
+    {
+        return;
+    }
+
+    memcpy(_result.TrackingId, pCurrent->TrackingId, sizeof(_result.TrackingId));
+
+    // for each body, the log likelihood of the beams of the speech slots if that body were the talker: about
+    // its head by the beam's spread as far as the beam is confident, anywhere in range otherwise
+    const float uniform = 1.0f / BEAM_RANGE;
+    const float normal = 1.0f / (sqrtf(XM_2PI) * _beamDeviation);
+    const float spread = -0.5f / (_beamDeviation * _beamDeviation);
+
+    double logLikelihood[BODY_COUNT] = {};
+    double noSpeakerLogLikelihood = 0.0;
+    UINT speechSlots = 0;
+    UINT recentSpeechSlots = 0;
+
+    for (INT64 slot = first; slot <= last; ++slot)
+    {
+        const BeamSlot& beam = _beams[slot & (SPEAKER_SLOT_COUNT - 1)];
+        if (beam.Slot != slot || !beam.Speaking || beam.ConfidenceSum <= 0.0f)
+        {
+            continue;
+        }
+
+        float angle = beam.AngleSum / beam.ConfidenceSum;
+        float confidence = min(beam.ConfidenceSum / beam.Count, 1.0f);
+
+        speechSlots++;
+        if (slot > last - static_cast<INT64>(_recentSlots))
+        {
+            recentSpeechSlots++;
+        }
+
+        noSpeakerLogLikelihood += logf(uniform);
+
+        const BodySlot* pBodies = FindBodies(slot);
+
+        for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+        {
+            UINT64 trackingId = pCurrent->TrackingId[bodyIndex];
+            if (0 == trackingId)
+            {
+                continue;
+            }
+
+            float likelihood = uniform;
+            if (nullptr != pBodies && pBodies->TrackingId[bodyIndex] == trackingId && pBodies->HasHead[bodyIndex])
+            {
+                float error = angle - pBodies->Azimuth[bodyIndex];
+                likelihood = confidence * normal * expf(spread * error * error) + (1.0f - confidence) * uniform;
+            }
+
+            logLikelihood[bodyIndex] += logf(likelihood);
+        }
+    }
+
+    if (0 == recentSpeechSlots)
+    {
+        return;
+    }
+
+    // equal priors on each tracked body and on nobody
+    double maxLogLikelihood = noSpeakerLogLikelihood;
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        if (0 != pCurrent->TrackingId[bodyIndex])
+        {
+            maxLogLikelihood = max(maxLogLikelihood, logLikelihood[bodyIndex]);
+        }
+    }
+
+    double posterior[BODY_COUNT] = {};
+    double noSpeakerPosterior = exp(noSpeakerLogLikelihood - maxLogLikelihood);
+    double total = noSpeakerPosterior;
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        if (0 != pCurrent->TrackingId[bodyIndex])
+        {
+            posterior[bodyIndex] = exp(logLikelihood[bodyIndex] - maxLogLikelihood);
+            total += posterior[bodyIndex];
+        }
+    }
+
+    // someone is speaking as often as the recent slots had speech
+    float activity = static_cast<float>(recentSpeechSlots) / _recentSlots;
+
+    for (UINT bodyIndex = 0; bodyIndex < BODY_COUNT; ++bodyIndex)
+    {
+        _result.Probability[bodyIndex] = activity * static_cast<float>(posterior[bodyIndex] / total);
+    }
+
+    _result.NoSpeakerProbability = activity * static_cast<float>(noSpeakerPosterior / total);
+    _result.SpeechActivity = activity;
+}
+
+void SpeakerAttribution::GetResult(_Out_ SpeakerAttributionResult* pResult) const
+{
+    critical_section::scoped_lock lock(_lock);
+
+    *pResult = _result;
+}
+
+float SpeakerAttribution::GetProbability(UINT bodyIndex) const
+{
+    critical_section::scoped_lock lock(_lock);
+
+    return _result.Probability[bodyIndex];
+}
@@ -0,0 +1,107 @@
+//------------------------------------------------------------------------------
+// <copyright file="SpeakerAttribution.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "BodyFrameData.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // both streams are binned into slots of one body frame, 100 ns ticks
+                static const INT64 SPEAKER_SLOT_TICKS = 333333;
+
+                // slots kept of each stream, enough for the window and the delay
+                static const UINT SPEAKER_SLOT_COUNT = 64;
+
+                struct SpeakerAttributionResult
+                {
+                    UINT64  TrackingId[Skeleton::BODY_COUNT];
+                    float   Probability[Skeleton::BODY_COUNT];  // the body is the one speaking, 0 for untracked slots
+                    float   NoSpeakerProbability;               // the speech comes from none of the tracked bodies
+                    float   SpeechActivity;                     // share of the recent slots with speech
+                    INT64   Time;                               // end of the window
+                };
+
+                // works out which tracked body is speaking from where the audio beam points. the microphone array
+                // is taken to lie along camera space x, so the beam angle is an azimuth in the sensor's xz plane,
+                // and each body's head has one too. the beam is taken as positive towards +x, as DirectionOfArrival
+                // reports it for microphones at KinectMicrophonePositions; the sensor's own AudioBeam has not been
+                // checked against tracked heads, so SetBeamAngleFlipped turns it the other way. both streams go into rings of slots one
+                // body frame long, found from a time in O(1) by the slot number; Update compares the beam to every
+                // head over the slots of a sliding window that had speech and turns the agreement into a
+                // probability per body. one producer per stream and any thread may update, a lock is held briefly.
+                class SpeakerAttribution
+                {
+                public:
+                    SpeakerAttribution();
+
+                    // the window Update looks back over, ending delay before the time it is given so that both
+                    // streams have arrived; beamDeviation is the spread of the beam about the talker's head, radians
+                    void Reset(float windowSeconds, float delaySeconds, float beamDeviation);
+
+                    // beam angles added from here on are negated first
+                    void SetBeamAngleFlipped(BOOL flipped);
+                    BOOL IsBeamAngleFlipped() const;
+
+                    // the sensor's beam at time, and whether there was speech in the audio it came with
+                    void AddBeam(INT64 time, float beamAngle, float beamAngleConfidence, BOOL speaking);
+
+                    // the head azimuths of the bodies of a frame at time
+                    void AddBodies(_In_ const Skeleton::BodyFrameData& bodies, INT64 time);
+
+                    // recomputes the probabilities for the window ending delay before time
+                    void Update(INT64 time);
+
+                    void GetResult(_Out_ SpeakerAttributionResult* pResult) const;
+                    float GetProbability(UINT bodyIndex) const;
+
+                    // 100 ns ticks of the performance counter, the clock both live streams are stamped with
+                    static INT64 GetTime();
+
+                private:
+                    struct BeamSlot
+                    {
+                        INT64   Slot;           // slot number the entry holds, or -1
+                        float   AngleSum;       // weighted by confidence
+                        float   ConfidenceSum;
+                        UINT    Count;
+                        BOOL    Speaking;
+                    };
+
+                    struct BodySlot
+                    {
+                        INT64   Slot;
+                        UINT64  TrackingId[Skeleton::BODY_COUNT];
+                        float   Azimuth[Skeleton::BODY_COUNT];      // radians, with a head joint
+                        BOOL    HasHead[Skeleton::BODY_COUNT];
+                    };
+
+                    static INT64 GetSlot(INT64 time);
+
+                    const BodySlot* FindBodies(INT64 slot) const;
+
+                private:
+                    mutable Concurrency::critical_section _lock;
+
+                    BeamSlot                    _beams[SPEAKER_SLOT_COUNT];
+                    BodySlot                    _bodies[SPEAKER_SLOT_COUNT];
+
+                    UINT                        _windowSlots;
+                    UINT                        _delaySlots;
+                    UINT                        _recentSlots;   // the end of the window the speech activity is taken over
+                    float                       _beamDeviation;
+                    BOOL                        _beamAngleFlipped;
+
+                    SpeakerAttributionResult    _result;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,55 @@
+//------------------------------------------------------------------------------
+// <copyright file="SpeakerAttributionSource.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SpeakerAttributionSource.h"
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+using namespace Windows::Foundation::Collections;
+
+IVectorView<float>^ SpeakerAttributionSource::SpeakingProbabilities::get()
+{
+    SpeakerAttributionResult result;
+    _attribution.GetResult(&result);
+
+    Platform::Collections::Vector<float>^ probabilities = ref new Platform::Collections::Vector<float>(result.Probability, result.Probability + Skeleton::BODY_COUNT);
+    return probabilities->GetView();
+}
+
+IVectorView<unsigned long long>^ SpeakerAttributionSource::TrackingIds::get()
+{
+    SpeakerAttributionResult result;
+    _attribution.GetResult(&result);
+
+    Platform::Collections::Vector<unsigned long long>^ trackingIds = ref new Platform::Collections::Vector<unsigned long long>(result.TrackingId, result.TrackingId + Skeleton::BODY_COUNT);
+    return trackingIds->GetView();
+}
+
+float SpeakerAttributionSource::NoSpeakerProbability::get()
+{
+    SpeakerAttributionResult result;
+    _attribution.GetResult(&result);
+
+    return result.NoSpeakerProbability;
+}
+
+float SpeakerAttributionSource::SpeechActivity::get()
+{
+    SpeakerAttributionResult result;
+    _attribution.GetResult(&result);
+
+    return result.SpeechActivity;
+}
+
+bool SpeakerAttributionSource::FlipBeamAngle::get()
+{
+    return FALSE != _attribution.IsBeamAngleFlipped();
+}
+
+void SpeakerAttributionSource::FlipBeamAngle::set(bool value)
+{
+    _attribution.SetBeamAngleFlipped(value ? TRUE : FALSE);
+}
@@ -0,0 +1,60 @@
+//------------------------------------------------------------------------------
+// <copyright file="SpeakerAttributionSource.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpeakerAttribution.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // which tracked body is speaking, shared by an audio panel and a skeleton panel given the same one:
+                // the audio panel adds the beam, the skeleton panel adds the bodies and updates it on every frame
+                [Windows::Foundation::Metadata::WebHostHidden]
+                public ref class SpeakerAttributionSource sealed
+                {
+                public:
+                    SpeakerAttributionSource() {}
+
+                    // the body in each slot is the one speaking, 0 for untracked slots, as of the last body frame
+                    property Windows::Foundation::Collections::IVectorView<float>^ SpeakingProbabilities
+                    {
+                        Windows::Foundation::Collections::IVectorView<float>^ get();
+                    }
+
+                    // of the bodies in the slots the probabilities are for, 0 for untracked slots
+                    property Windows::Foundation::Collections::IVectorView<unsigned long long>^ TrackingIds
+                    {
+                        Windows::Foundation::Collections::IVectorView<unsigned long long>^ get();
+                    }
+
+                    // the speech comes from none of the tracked bodies
+                    property float NoSpeakerProbability { float get(); }
+
+                    // share of the last 0.3 sec with speech
+                    property float SpeechActivity { float get(); }
+
+                    // the beam is taken as positive towards camera space +x; set when the sensor reports it the
+                    // other way round and the speech goes to the body mirrored about the sensor's axis
+                    property bool FlipBeamAngle
+                    {
+                        bool get();
+                        void set(bool value);
+                    }
+
+                internal:
+                    SpeakerAttribution& GetAttribution() { return _attribution; }
+
+                private:
+                    SpeakerAttribution _attribution;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------
+// <copyright file="Spectrogram.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Spectrogram.h"
+#include "AudioEnergy.h"
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+static const double PI = 3.14159265358979323846;
+
+Spectrogram::Spectrogram()
+    : _hopSize(0)
+    , _binStride(0)
+    , _minEnergy(0.0f)
+    , _minPower(0.0f)
+    , _powerScale(0.0f)
+    , _frameCount(0)
+    , _columnCount(0)
+    , _nextColumn(0)
+    , _columnsWritten(0)
+{
+}
+
+void Spectrogram::Reset(UINT fftSize, UINT hopSize, UINT columnCount, float minEnergy)
+{
+    ASSERT(hopSize > 0 && hopSize <= fftSize && columnCount > 0 && minEnergy < 0.0f);
+
+    _fft.Reset(fftSize);
+    _hopSize = hopSize;
+    _binStride = (_fft.GetBinCount() + 3) & ~3;
+    _minEnergy = minEnergy;
+    _minPower = powf(10.0f, minEnergy / 10.0f);
+
+    // periodic Hann window
+    double windowSum = 0.0;
+    _window.resize(fftSize);
+    for (UINT n = 0; n < fftSize; ++n)
+    {
+        _window[n] = static_cast<float>(0.5 - 0.5 * cos(2.0 * PI * n / fftSize));
+        windowSum += _window[n];
+    }
+
+    // a sine of amplitude a peaks at a sum / 2, and its mean square is a^2 / 2
+    _powerScale = static_cast<float>(2.0 / (windowSum * windowSum));
+
+    _frame.assign(fftSize, 0.0f);
+    _frameCount = 0;
+
+    _windowed.resize(fftSize);
+    _real.resize(_binStride);
+    _imaginary.resize(_binStride);
+    _power.assign(_binStride, 0.0f);
+
+    _columnCount = columnCount;
+    _image.assign(columnCount * _binStride, 0.0f);
+    _nextColumn = 0;
+    _columnsWritten = 0;
+}
+
+UINT Spectrogram::Process(_In_reads_(sampleCount) const float* pSamples, UINT sampleCount)
+{
+    const UINT fftSize = _fft.GetSize();
+    UINT columns = 0;
+
+    while (sampleCount > 0)
+    {
+        UINT count = min(sampleCount, fftSize - _frameCount);
+        memcpy(&_frame[_frameCount], pSamples, count * sizeof(float));
+
+        _frameCount += count;
+        pSamples += count;
+        sampleCount -= count;
+
+        if (_frameCount == fftSize)
+        {
+            AddColumn();
+            columns++;
+
+            // keep the overlap for the next frame
+            memmove(&_frame[0], &_frame[_hopSize], (fftSize - _hopSize) * sizeof(float));
+            _frameCount -= _hopSize;
+        }
+    }
+
+    return columns;
+}
+
+void Spectrogram::AddColumn()
+{
+    const UINT fftSize = _fft.GetSize();
+
+    for (UINT n = 0; n < fftSize; n += 4)
+    {
+        XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&_frame[n]));
+        XMVECTOR w = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&_window[n]));
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&_windowed[n]), XMVectorMultiply(x, w));
+    }
+
+    _fft.Forward(_windowed.data(), _real.data(), _imaginary.data());
+
+    // the padding bins past the last one stay silent
+    for (UINT k = _fft.GetBinCount(); k < _binStride; ++k)
+    {
+        _real[k] = 0.0f;
+        _imaginary[k] = 0.0f;
+    }
+
+    float* pColumn = &_image[_nextColumn * _binStride];
+
+    const XMVECTOR one = XMVectorSplatOne();
+    const XMVECTOR scale = XMVectorReplicate(_powerScale);
+    const XMVECTOR minPower = XMVectorReplicate(_minPower);
+    const XMVECTOR invMinEnergy = XMVectorReplicate(1.0f / _minEnergy);
+
+    for (UINT k = 0; k < _binStride; k += 4)
+    {
+        XMVECTOR real = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&_real[k]));
+        XMVECTOR imaginary = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&_imaginary[k]));
+        XMVECTOR power = XMVectorMultiply(XMVectorMultiplyAdd(real, real, XMVectorMultiply(imaginary, imaginary)), scale);
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&_power[k]), power);
+
+        // (minEnergy - dB) / minEnergy
+        XMVECTOR energy = XMVectorSubtract(one, XMVectorMultiply(XMVectorDecibels(XMVectorMax(power, minPower)), invMinEnergy));
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(pColumn + k), energy);
+    }
+
+    _nextColumn = (_nextColumn + 1) % _columnCount;
+    _columnsWritten++;
+}
+
+const float* Spectrogram::GetColumn(UINT age) const
+{
+    ASSERT(age < _columnCount);
+
+    UINT column = (_nextColumn + _columnCount - 1 - age) % _columnCount;
+    return &_image[column * _binStride];
+}
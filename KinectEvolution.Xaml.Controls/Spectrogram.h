@@ -0,0 +1,73 @@
+//------------------------------------------------------------------------------
+// <copyright file="Spectrogram.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "RealFft.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // short time fourier transform of the sample stream: every hop samples the last fftSize are Hann
+                // windowed and transformed, and the power of each bin goes into a ring of columns in dB, mapped from
+                // [minEnergy, 0] dB onto [0, 1]. a sine shows in its bin at its mean square, like the energy display.
+                class Spectrogram
+                {
+                public:
+                    Spectrogram();
+
+                    // fftSize is a power of two, hopSize at most fftSize
+                    void Reset(UINT fftSize, UINT hopSize, UINT columnCount, float minEnergy);
+
+                    UINT GetFftSize() const { return _fft.GetSize(); }
+                    UINT GetHopSize() const { return _hopSize; }
+                    UINT GetBinCount() const { return _fft.GetBinCount(); }
+                    UINT GetColumnCount() const { return _columnCount; }
+                    UINT64 GetColumnsWritten() const { return _columnsWritten; }
+
+                    // returns the columns added
+                    UINT Process(_In_reads_(sampleCount) const float* pSamples, UINT sampleCount);
+
+                    // GetBinCount values from bin 0, age 0 is the newest column
+                    const float* GetColumn(UINT age) const;
+
+                    // mean square power of each bin of the newest frame
+                    const float* GetPower() const { return _power.data(); }
+
+                private:
+                    void AddColumn();
+
+                private:
+                    RealFft             _fft;
+                    UINT                _hopSize;
+                    UINT                _binStride;     // bins rounded up to whole vectors
+                    float               _minEnergy;
+                    float               _minPower;
+                    float               _powerScale;    // 2 / (sum of the window)^2
+
+                    // the last fftSize samples, oldest first
+                    std::vector<float>  _window;
+                    std::vector<float>  _frame;
+                    UINT                _frameCount;
+
+                    std::vector<float>  _windowed;
+                    std::vector<float>  _real;
+                    std::vector<float>  _imaginary;
+                    std::vector<float>  _power;
+
+                    // columnCount columns of _binStride values
+                    std::vector<float>  _image;
+                    UINT                _columnCount;
+                    UINT                _nextColumn;
+                    UINT64              _columnsWritten;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,218 @@
+//------------------------------------------------------------------------------
+// <copyright file="SpscRing.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Base {
+
+                // unread values in place, the second span continues from the start of the storage
+                template<typename T>
+                struct RingSpan
+                {
+                    const T*    pFirst;
+                    UINT        FirstCount;
+                    const T*    pSecond;
+                    UINT        SecondCount;
+
+                    UINT GetCount() const { return FirstCount + SecondCount; }
+                };
+
+                struct RingStatistics
+                {
+                    UINT64  Written;
+                    UINT64  Read;
+                    UINT64  Dropped;        // values the producer had no room for
+                    UINT64  Overruns;       // writes that dropped any
+                    UINT    MaxFill;        // most values waiting at once
+                };
+
+                // single producer, single consumer ring of values copied in place. neither side waits for the other:
+                // the producer drops what does not fit and counts it, the consumer reads what has been published.
+                // the write and read counts only grow, each side publishes its own with release and reads the
+                // other's with acquire, so a value is complete before the consumer sees it and is read before
+                // the producer reuses its slot.
+                template<typename T>
+                class SpscRing
+                {
+                public:
+                    SpscRing()
+                        : _capacity(0)
+                        , _mask(0)
+                        , _writeCount(0)
+                        , _dropped(0)
+                        , _overruns(0)
+                        , _maxFill(0)
+                        , _written(0)
+                        , _readCount(0)
+                        , _read(0)
+                    {
+                    }
+
+                    // empties the ring, only while neither side is running
+                    void Reset(UINT minCapacity)
+                    {
+                        _capacity = 1;
+                        while (_capacity < minCapacity)
+                        {
+                            _capacity <<= 1;
+                        }
+
+                        _mask = _capacity - 1;
+                        _storage.assign(_capacity, T());
+
+                        _writeCount.store(0);
+                        _dropped.store(0);
+                        _overruns.store(0);
+                        _maxFill.store(0);
+                        _written.store(0);
+                        _readCount.store(0);
+                        _read.store(0);
+                    }
+
+                    UINT GetCapacity() const { return _capacity; }
+
+                    // producer: values are written into the storage from the write index on, wrapping at the
+                    // capacity, for at most the free count, then published with EndWrite
+                    UINT GetFreeCount() const
+                    {
+                        // the consumer is done with every slot before its read count
+                        UINT readCount = _readCount.load(std::memory_order_acquire);
+                        UINT writeCount = _writeCount.load(std::memory_order_relaxed);
+
+                        return _capacity - (writeCount - readCount);
+                    }
+
+                    UINT GetWriteIndex() const { return _writeCount.load(std::memory_order_relaxed) & _mask; }
+                    T* GetStorage() { return _storage.data(); }
+
+                    void EndWrite(UINT count)
+                    {
+                        if (0 == count)
+                        {
+                            return;
+                        }
+
+                        UINT writeCount = _writeCount.load(std::memory_order_relaxed) + count;
+                        UINT fill = writeCount - _readCount.load(std::memory_order_relaxed);
+                        ASSERT(fill <= _capacity);
+
+                        // the values are in place before the consumer can see the new count
+                        _writeCount.store(writeCount, std::memory_order_release);
+
+                        _written.store(_written.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+                        if (fill > _maxFill.load(std::memory_order_relaxed))
+                        {
+                            _maxFill.store(fill, std::memory_order_relaxed);
+                        }
+                    }
+
+                    // copies what fits of count values, wrapping at the end of the storage, publishes them and
+                    // drops the rest; returns the values written
+                    UINT Write(_In_reads_(count) const T* pValues, UINT count)
+                    {
+                        UINT written = min(count, GetFreeCount());
+                        UINT index = GetWriteIndex();
+                        UINT firstCount = min(written, _capacity - index);
+
+                        std::copy(pValues, pValues + firstCount, _storage.begin() + index);
+                        std::copy(pValues + firstCount, pValues + written, _storage.begin());
+                        EndWrite(written);
+                        AddDropped(count - written);
+
+                        return written;
+                    }
+
+                    void AddDropped(UINT count)
+                    {
+                        if (0 == count)
+                        {
+                            return;
+                        }
+
+                        _dropped.store(_dropped.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+                        _overruns.store(_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    }
+
+                    // consumer: up to maxCount of the oldest unread values, valid until EndRead releases them
+                    UINT GetReadableCount() const
+                    {
+                        UINT writeCount = _writeCount.load(std::memory_order_acquire);
+                        UINT readCount = _readCount.load(std::memory_order_relaxed);
+
+                        return writeCount - readCount;
+                    }
+
+                    RingSpan<T> BeginRead(UINT maxCount) const
+                    {
+                        UINT count = min(maxCount, GetReadableCount());
+                        UINT index = _readCount.load(std::memory_order_relaxed) & _mask;
+
+                        RingSpan<T> span;
+                        span.pFirst = &_storage[index];
+                        span.FirstCount = min(count, _capacity - index);
+                        span.pSecond = &_storage[0];
+                        span.SecondCount = count - span.FirstCount;
+
+                        return span;
+                    }
+
+                    void EndRead(UINT count)
+                    {
+                        if (0 == count)
+                        {
+                            return;
+                        }
+
+                        ASSERT(count <= GetReadableCount());
+
+                        // the values are read before the producer can reuse their slots
+                        _readCount.store(_readCount.load(std::memory_order_relaxed) + count, std::memory_order_release);
+
+                        _read.store(_read.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+                    }
+
+                    // from either side, the counts may be a moment apart
+                    void GetStatistics(_Out_ RingStatistics* pStatistics) const
+                    {
+                        pStatistics->Written = _written.load(std::memory_order_relaxed);
+                        pStatistics->Read = _read.load(std::memory_order_relaxed);
+                        pStatistics->Dropped = _dropped.load(std::memory_order_relaxed);
+                        pStatistics->Overruns = _overruns.load(std::memory_order_relaxed);
+                        pStatistics->MaxFill = _maxFill.load(std::memory_order_relaxed);
+                    }
+
+                private:
+                    static const UINT CACHE_LINE = 64;
+
+                    std::vector<T>          _storage;
+                    UINT                    _capacity;      // a power of two
+                    UINT                    _mask;
+
+                    // producer
+                    BYTE                    _producerPadding[CACHE_LINE];
+                    std::atomic<UINT>       _writeCount;
+                    std::atomic<UINT64>     _dropped;
+                    std::atomic<UINT64>     _overruns;
+                    std::atomic<UINT>       _maxFill;
+                    std::atomic<UINT64>     _written;
+
+                    // consumer
+                    BYTE                    _consumerPadding[CACHE_LINE];
+                    std::atomic<UINT>       _readCount;
+                    std::atomic<UINT64>     _read;
+                };
+
+            }
+        }
+    }
+}
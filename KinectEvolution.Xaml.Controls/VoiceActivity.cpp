@@ -0,0 +1,290 @@
+//------------------------------------------------------------------------------
+// <copyright file="VoiceActivity.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "VoiceActivity.h"
+#include "AudioEnergy.h"
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+static const double PI = 3.14159265358979323846;
+
+static const float FRAME_SECONDS = 0.016f;
+static const float BAND_LOW_HZ = 300.0f;
+static const float BAND_HIGH_HZ = 4000.0f;
+
+// above the noise floor to start and to keep speaking, dB
+static const float ONSET_DB = 9.0f;
+static const float OFFSET_DB = 5.0f;
+
+// voiced frames have a peaky spectrum and few sign changes
+static const float VOICED_FLATNESS_DB = -6.0f;
+static const float VOICED_ZERO_CROSSING_RATE = 0.25f;
+
+static const float ONSET_SECONDS = 0.048f;
+static const float HANGOVER_SECONDS = 0.3f;
+
+// the floor follows quiet frames down quickly and creeps up, dB per frame
+static const float FLOOR_FALL = 0.3f;
+static const float FLOOR_RISE_DB = 0.05f;
+static const float MIN_ENERGY_DB = -90.0f;
+
+static const UINT SEGMENT_QUEUE_LENGTH = 16;
+
+VoiceActivityDetector::VoiceActivityDetector()
+    : _sampleRate(0)
+    , _bandFirst(0)
+    , _bandCount(0)
+    , _onsetFrames(0)
+    , _hangoverFrames(0)
+    , _frameCount(0)
+    , _sample(0)
+    , _speaking(FALSE)
+    , _candidateRun(0)
+    , _candidateVoiced(FALSE)
+    , _candidateStart(0)
+    , _quietRun(0)
+    , _lastActiveEnd(0)
+    , _beamWeight(0.0f)
+    , _beamSum(0.0f)
+    , _confidenceSum(0.0f)
+    , _segmentFrames(0)
+    , _segmentRead(0)
+    , _segmentWrite(0)
+{
+    ZeroMemory(&_features, sizeof(_features));
+    ZeroMemory(&_segment, sizeof(_segment));
+}
+
+void VoiceActivityDetector::Reset(UINT sampleRate)
+{
+    _sampleRate = sampleRate;
+
+    UINT frameSize = 8;
+    while (frameSize < sampleRate * FRAME_SECONDS)
+    {
+        frameSize <<= 1;
+    }
+    _fft.Reset(frameSize);
+
+    float frameSeconds = static_cast<float>(frameSize) / sampleRate;
+    _onsetFrames = max(1u, static_cast<UINT>(ONSET_SECONDS / frameSeconds + 0.5f));
+    _hangoverFrames = max(1u, static_cast<UINT>(HANGOVER_SECONDS / frameSeconds + 0.5f));
+
+    // the band rounded out to whole vectors, inside the bins
+    float binsPerHz = static_cast<float>(frameSize) / sampleRate;
+    _bandFirst = static_cast<UINT>(BAND_LOW_HZ * binsPerHz) & ~3u;
+    UINT bandEnd = min((static_cast<UINT>(BAND_HIGH_HZ * binsPerHz) + 3) & ~3u, frameSize / 2);
+    _bandCount = bandEnd - _bandFirst;
+
+    _window.resize(frameSize);
+    for (UINT n = 0; n < frameSize; ++n)
+    {
+        _window[n] = static_cast<float>(0.5 - 0.5 * cos(2.0 * PI * n / frameSize));
+    }
+
+    _frame.assign(frameSize, 0.0f);
+    _windowed.resize(frameSize);
+    _real.resize(_fft.GetBinCount());
+    _imaginary.resize(_fft.GetBinCount());
+    _frameCount = 0;
+    _sample = 0;
+
+    ZeroMemory(&_features, sizeof(_features));
+    _features.NoiseFloor = MIN_ENERGY_DB;
+    _speaking = FALSE;
+    _candidateRun = 0;
+    _candidateVoiced = FALSE;
+    _quietRun = 0;
+
+    _segments.resize(SEGMENT_QUEUE_LENGTH);
+    _segmentRead = 0;
+    _segmentWrite = 0;
+}
+
+void VoiceActivityDetector::Process(
+    _In_reads_(sampleCount) const float* pSamples,
+    UINT sampleCount,
+    float beamAngle,
+    float beamAngleConfidence)
+{
+    const UINT frameSize = _fft.GetSize();
+
+    while (sampleCount > 0)
+    {
+        UINT count = min(sampleCount, frameSize - _frameCount);
+        memcpy(&_frame[_frameCount], pSamples, count * sizeof(float));
+
+        _frameCount += count;
+        pSamples += count;
+        sampleCount -= count;
+
+        if (_frameCount == frameSize)
+        {
+            ProcessFrame(beamAngle, beamAngleConfidence);
+
+            _frameCount = 0;
+            _sample += frameSize;
+        }
+    }
+}
+
+void VoiceActivityDetector::ProcessFrame(float beamAngle, float beamAngleConfidence)
+{
+    const UINT frameSize = _fft.GetSize();
+
+    // energy and zero crossings of the samples as they are
+    float sumOfSquares = 0.0f;
+    UINT crossings = 0;
+    for (UINT n = 0; n < frameSize; ++n)
+    {
+        sumOfSquares += _frame[n] * _frame[n];
+        _windowed[n] = _frame[n] * _window[n];
+    }
+    for (UINT n = 1; n < frameSize; ++n)
+    {
+        crossings += ((_frame[n - 1] < 0.0f) != (_frame[n] < 0.0f)) ? 1 : 0;
+    }
+
+    _features.Energy = max(MIN_ENERGY_DB, 10.0f * log10f(max(sumOfSquares / frameSize, 1e-30f)));
+    _features.ZeroCrossingRate = static_cast<float>(crossings) / (frameSize - 1);
+
+    // the floor starts at the first frame
+    if (0 == _sample)
+    {
+        _features.NoiseFloor = _features.Energy;
+    }
+
+    // flatness over the speech band, the mean of the logs 4 bins at a time
+    _fft.Forward(_windowed.data(), _real.data(), _imaginary.data());
+
+    const XMVECTOR tiny = XMVectorReplicate(1e-30f);
+    XMVECTOR powerSum = XMVectorZero();
+    XMVECTOR decibelSum = XMVectorZero();
+    for (UINT k = _bandFirst; k < _bandFirst + _bandCount; k += 4)
+    {
+        XMVECTOR real = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&_real[k]));
+        XMVECTOR imaginary = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&_imaginary[k]));
+        XMVECTOR power = XMVectorMax(XMVectorMultiplyAdd(real, real, XMVectorMultiply(imaginary, imaginary)), tiny);
+
+        powerSum = XMVectorAdd(powerSum, power);
+        decibelSum = XMVectorAdd(decibelSum, XMVectorDecibels(power));
+    }
+
+    XMFLOAT4 powers, decibels;
+    XMStoreFloat4(&powers, powerSum);
+    XMStoreFloat4(&decibels, decibelSum);
+    float meanPower = (powers.x + powers.y + powers.z + powers.w) / _bandCount;
+    float meanDecibels = (decibels.x + decibels.y + decibels.z + decibels.w) / _bandCount;
+    _features.Flatness = meanDecibels - 10.0f * log10f(meanPower);
+
+    BOOL candidate = (_features.Energy > _features.NoiseFloor + ONSET_DB);
+    BOOL active = (_features.Energy > _features.NoiseFloor + OFFSET_DB);
+    BOOL voiced = (_features.Flatness < VOICED_FLATNESS_DB && _features.ZeroCrossingRate < VOICED_ZERO_CROSSING_RATE);
+
+    UINT64 frameEnd = _sample + frameSize;
+
+    if (!_speaking)
+    {
+        if (candidate)
+        {
+            if (0 == _candidateRun++)
+            {
+                _candidateStart = _sample;
+                _candidateVoiced = FALSE;
+            }
+            _candidateVoiced |= voiced;
+
+            if (_candidateRun >= _onsetFrames && _candidateVoiced)
+            {
+                StartSegment(_candidateStart);
+            }
+        }
+        else
+        {
+            _candidateRun = 0;
+        }
+    }
+
+    if (_speaking)
+    {
+        _segmentFrames++;
+        _segment.PeakEnergy = max(_segment.PeakEnergy, _features.Energy);
+        _beamSum += beamAngle * beamAngleConfidence;
+        _beamWeight += beamAngleConfidence;
+        _confidenceSum += beamAngleConfidence;
+
+        if (active)
+        {
+            _quietRun = 0;
+            _lastActiveEnd = frameEnd;
+        }
+        else if (++_quietRun >= _hangoverFrames)
+        {
+            EndSegment();
+        }
+    }
+
+    // the floor only rises while nobody speaks, and then slowly
+    if (_features.Energy < _features.NoiseFloor)
+    {
+        _features.NoiseFloor += (_features.Energy - _features.NoiseFloor) * FLOOR_FALL;
+    }
+    else if (!_speaking)
+    {
+        _features.NoiseFloor += min(_features.Energy - _features.NoiseFloor, FLOOR_RISE_DB);
+    }
+}
+
+void VoiceActivityDetector::StartSegment(UINT64 startSample)
+{
+    _speaking = TRUE;
+    _candidateRun = 0;
+    _quietRun = 0;
+
+    ZeroMemory(&_segment, sizeof(_segment));
+    _segment.StartSample = startSample;
+    _segment.PeakEnergy = MIN_ENERGY_DB;
+    _lastActiveEnd = startSample;
+
+    _beamSum = 0.0f;
+    _beamWeight = 0.0f;
+    _confidenceSum = 0.0f;
+    _segmentFrames = 0;
+}
+
+void VoiceActivityDetector::EndSegment()
+{
+    _speaking = FALSE;
+
+    // the hangover is not part of the speech
+    _segment.EndSample = _lastActiveEnd;
+    _segment.StartTime = static_cast<INT64>(_segment.StartSample * 10000000 / _sampleRate);
+    _segment.EndTime = static_cast<INT64>(_segment.EndSample * 10000000 / _sampleRate);
+    _segment.BeamAngle = (_beamWeight > 0.0f) ? _beamSum / _beamWeight : 0.0f;
+    _segment.BeamAngleConfidence = (_segmentFrames > 0) ? _confidenceSum / _segmentFrames : 0.0f;
+
+    _segments[_segmentWrite % SEGMENT_QUEUE_LENGTH] = _segment;
+    _segmentWrite++;
+
+    if (_segmentWrite - _segmentRead > SEGMENT_QUEUE_LENGTH)
+    {
+        _segmentRead = _segmentWrite - SEGMENT_QUEUE_LENGTH;
+    }
+}
+
+BOOL VoiceActivityDetector::PopSegment(_Out_ SpeechSegment* pSegment)
+{
+    if (_segmentRead == _segmentWrite)
+    {
+        return FALSE;
+    }
+
+    *pSegment = _segments[_segmentRead % SEGMENT_QUEUE_LENGTH];
+    _segmentRead++;
+
+    return TRUE;
+}
@@ -0,0 +1,104 @@
+//------------------------------------------------------------------------------
+// <copyright file="VoiceActivity.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "RealFft.h"
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                struct SpeechSegment
+                {
+                    UINT64  StartSample;            // [StartSample, EndSample) from the start of the stream
+                    UINT64  EndSample;
+                    INT64   StartTime;              // 100 ns ticks from the start of the stream
+                    INT64   EndTime;
+                    float   BeamAngle;              // radians like AudioBeam::BeamAngle, mean weighted by confidence
+                    float   BeamAngleConfidence;    // mean over the segment
+                    float   PeakEnergy;             // dB
+                };
+
+                struct VoiceActivityFeatures
+                {
+                    float   Energy;                 // mean square in dB
+                    float   NoiseFloor;             // dB
+                    float   Flatness;               // geometric over arithmetic mean of the speech band power, dB
+                    float   ZeroCrossingRate;       // sign changes per sample
+                };
+
+                // streaming voice activity detection over frames of 16 msec. a frame is a speech candidate when its
+                // energy is well above the adaptive noise floor, and voiced when its speech band spectrum is also
+                // far from flat with few zero crossings. speech starts after a run of candidates holding a voiced
+                // frame and ends once the energy has stayed below a lower threshold for the hangover.
+                // all storage is allocated by Reset.
+                class VoiceActivityDetector
+                {
+                public:
+                    VoiceActivityDetector();
+
+                    void Reset(UINT sampleRate);
+
+                    UINT GetFrameSize() const { return _fft.GetSize(); }
+                    BOOL IsSpeaking() const { return _speaking; }
+                    const VoiceActivityFeatures& GetFeatures() const { return _features; }
+
+                    // the beam is the one the samples came from
+                    void Process(
+                        _In_reads_(sampleCount) const float* pSamples,
+                        UINT sampleCount,
+                        float beamAngle,
+                        float beamAngleConfidence);
+
+                    // oldest finished segment first. when they are not taken the oldest are overwritten
+                    BOOL PopSegment(_Out_ SpeechSegment* pSegment);
+
+                private:
+                    void ProcessFrame(float beamAngle, float beamAngleConfidence);
+                    void StartSegment(UINT64 startSample);
+                    void EndSegment();
+
+                private:
+                    RealFft             _fft;
+                    UINT                _sampleRate;
+                    UINT                _bandFirst;         // speech band bins, a whole number of vectors
+                    UINT                _bandCount;
+                    UINT                _onsetFrames;
+                    UINT                _hangoverFrames;
+
+                    std::vector<float>  _window;
+                    std::vector<float>  _frame;
+                    std::vector<float>  _windowed;
+                    std::vector<float>  _real;
+                    std::vector<float>  _imaginary;
+                    UINT                _frameCount;
+                    UINT64              _sample;            // stream position of the start of the frame
+
+                    VoiceActivityFeatures _features;
+                    BOOL                _speaking;
+                    UINT                _candidateRun;
+                    BOOL                _candidateVoiced;
+                    UINT64              _candidateStart;
+                    UINT                _quietRun;
+
+                    SpeechSegment       _segment;
+                    UINT64              _lastActiveEnd;
+                    float               _beamWeight;
+                    float               _beamSum;
+                    float               _confidenceSum;
+                    UINT                _segmentFrames;
+
+                    std::vector<SpeechSegment> _segments;
+                    UINT                _segmentRead;
+                    UINT                _segmentWrite;
+                };
+
+            }
+        }
+    }
+}
@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+// <copyright file="WaveFile.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "WaveFile.h"
+
+using namespace KinectEvolution::Xaml::Controls::Audio;
+
+static UINT32 ReadUInt32(_In_reads_bytes_(4) const BYTE* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<UINT32>(p[3]) << 24);
+}
+
+static WORD ReadUInt16(_In_reads_bytes_(2) const BYTE* p)
+{
+    return static_cast<WORD>(p[0] | (p[1] << 8));
+}
+
+static void WriteUInt32(_Out_writes_bytes_(4) BYTE* p, UINT32 value)
+{
+    p[0] = static_cast<BYTE>(value);
+    p[1] = static_cast<BYTE>(value >> 8);
+    p[2] = static_cast<BYTE>(value >> 16);
+    p[3] = static_cast<BYTE>(value >> 24);
+}
+
+static void WriteUInt16(_Out_writes_bytes_(2) BYTE* p, WORD value)
+{
+    p[0] = static_cast<BYTE>(value);
+    p[1] = static_cast<BYTE>(value >> 8);
+}
+
+void KinectEvolution::Xaml::Controls::Audio::BuildWaveHeader(
+    WaveSampleFormat format,
+    UINT channelCount,
+    UINT sampleRate,
+    UINT32 dataSize,
+    UINT32 trailingSize,
+    _Out_writes_bytes_(WAVE_HEADER_SIZE) BYTE* pHeader)
+{
+    WORD bits = (WaveSampleFormat::Pcm16 == format) ? 16 : 32;
+    WORD blockAlign = static_cast<WORD>(channelCount * bits / 8);
+
+    // the data chunk is padded to a word
+    memcpy(pHeader, "RIFF", 4);
+    WriteUInt32(pHeader + 4, WAVE_HEADER_SIZE - 8 + dataSize + (dataSize & 1) + trailingSize);
+    memcpy(pHeader + 8, "WAVE", 4);
+
+    memcpy(pHeader + 12, "fmt ", 4);
+    WriteUInt32(pHeader + 16, 16);
+    WriteUInt16(pHeader + 20, (WaveSampleFormat::Pcm16 == format) ? WAVE_TAG_PCM : WAVE_TAG_FLOAT);
+    WriteUInt16(pHeader + 22, static_cast<WORD>(channelCount));
+    WriteUInt32(pHeader + 24, sampleRate);
+    WriteUInt32(pHeader + 28, sampleRate * blockAlign);
+    WriteUInt16(pHeader + 32, blockAlign);
+    WriteUInt16(pHeader + 34, bits);
+
+    memcpy(pHeader + 36, "data", 4);
+    WriteUInt32(pHeader + 40, dataSize);
+}
+
+WaveFile::WaveFile()
+    : _channelCount(0)
+    , _sampleRate(0)
+    , _frameCount(0)
+{
+}
+
+bool WaveFile::Load(_In_reads_bytes_(size) const BYTE* pData, size_t size)
+{
+    _channelCount = 0;
+    _sampleRate = 0;
+    _frameCount = 0;
+    _samples.clear();
+
+    if (nullptr == pData || size < 12 || 0 != memcmp(pData, "RIFF", 4) || 0 != memcmp(pData + 8, "WAVE", 4))
+    {
+        return false;
+    }
+
+    WORD tag = 0;
+    WORD channels = 0;
+    UINT32 sampleRate = 0;
+    WORD bits = 0;
+    const BYTE* pSamples = nullptr;
+    size_t dataSize = 0;
+
+    // chunks are word aligned
+    size_t offset = 12;
+    while (offset + 8 <= size)
+    {
+        const BYTE* pChunk = pData + offset;
+        size_t chunkSize = ReadUInt32(pChunk + 4);
+        size_t available = size - offset - 8;
+
+        if (0 == memcmp(pChunk, "fmt ", 4) && chunkSize >= 16 && chunkSize <= available)
+        {
+            tag = ReadUInt16(pChunk + 8);
+            channels = ReadUInt16(pChunk + 10);
+            sampleRate = ReadUInt32(pChunk + 12);
+            bits = ReadUInt16(pChunk + 22);
+
+            // the sub format GUID starts with the plain tag
+            if (WAVE_TAG_EXTENSIBLE == tag && chunkSize >= 40)
+            {
+                tag = ReadUInt16(pChunk + 32);
+            }
+        }
+        else if (0 == memcmp(pChunk, "data", 4))
+        {
+            // recorders that stopped early leave the size too large
+            pSamples = pChunk + 8;
+            dataSize = min(chunkSize, available);
+        }
+
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    BOOL pcm16 = (WAVE_TAG_PCM == tag && 16 == bits);
+    BOOL float32 = (WAVE_TAG_FLOAT == tag && 32 == bits);
+    if (nullptr == pSamples || 0 == channels || 0 == sampleRate || !(pcm16 || float32))
+    {
+        return false;
+    }
+
+    UINT frameSize = channels * bits / 8;
+    UINT frameCount = static_cast<UINT>(dataSize / frameSize);
+    if (0 == frameCount)
+    {
+        return false;
+    }
+
+    _channelCount = channels;
+    _sampleRate = sampleRate;
+    _frameCount = frameCount;
+    _samples.resize(static_cast<size_t>(channels) * frameCount);
+
+    // interleaved frames into one array per channel
+    for (UINT channel = 0; channel < _channelCount; ++channel)
+    {
+        float* pChannel = &_samples[channel * _frameCount];
+
+        if (pcm16)
+        {
+            const BYTE* pSample = pSamples + channel * 2;
+            for (UINT frame = 0; frame < _frameCount; ++frame, pSample += frameSize)
+            {
+                pChannel[frame] = static_cast<SHORT>(ReadUInt16(pSample)) * (1.0f / 32768.0f);
+            }
+        }
+        else
+        {
+            const BYTE* pSample = pSamples + channel * 4;
+            for (UINT frame = 0; frame < _frameCount; ++frame, pSample += frameSize)
+            {
+                memcpy(&pChannel[frame], pSample, sizeof(float));
+            }
+        }
+    }
+
+    return true;
+}
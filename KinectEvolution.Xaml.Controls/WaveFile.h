@@ -0,0 +1,69 @@
+//------------------------------------------------------------------------------
+// <copyright file="WaveFile.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+namespace KinectEvolution {
+    namespace Xaml {
+        namespace Controls {
+            namespace Audio {
+
+                // format tags of the RIFF WAVE fmt chunk
+                static const WORD WAVE_TAG_PCM = 0x0001;
+                static const WORD WAVE_TAG_FLOAT = 0x0003;
+                static const WORD WAVE_TAG_EXTENSIBLE = 0xFFFE;
+
+                enum class WaveSampleFormat
+                {
+                    Pcm16,
+                    Float32
+                };
+
+                // RIFF, fmt and data chunk headers
+                static const UINT WAVE_HEADER_SIZE = 44;
+
+                // the headers of a file of dataSize bytes of samples followed by trailingSize bytes of other chunks
+                void BuildWaveHeader(
+                    WaveSampleFormat format,
+                    UINT channelCount,
+                    UINT sampleRate,
+                    UINT32 dataSize,
+                    UINT32 trailingSize,
+                    _Out_writes_bytes_(WAVE_HEADER_SIZE) BYTE* pHeader);
+
+                // a RIFF WAVE recording read into one array of float samples per channel
+                class WaveFile
+                {
+                public:
+                    WaveFile();
+
+                    // 16 bit PCM or 32 bit float, plain or extensible, any number of channels
+                    bool Load(_In_reads_bytes_(size) const BYTE* pData, size_t size);
+
+                    BOOL IsLoaded() const { return _frameCount > 0; }
+
+                    UINT GetChannelCount() const { return _channelCount; }
+                    UINT GetSampleRate() const { return _sampleRate; }
+                    UINT GetFrameCount() const { return _frameCount; }
+
+                    // GetFrameCount samples in [-1, 1]
+                    const float* GetChannel(UINT channel) const { return &_samples[channel * _frameCount]; }
+
+                private:
+                    UINT                _channelCount;
+                    UINT                _sampleRate;
+                    UINT                _frameCount;
+
+                    // channel after channel
+                    std::vector<float>  _samples;
+                };
+
+            }
+        }
+    }
+}
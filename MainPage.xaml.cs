@@ -154,6 +154,7 @@ namespace KinectEvolution
                 DepthSource = this.kinectSSensor.DepthFrameSource,
                 InfraredSource = this.kinectSSensor.InfraredFrameSource,
                 ColorSource = this.kinectSSensor.ColorFrameSource,
+                BodySource = this.kinectSSensor.BodyFrameSource,
                 PanelMode = this.lastCameraPanel
             };
 